@@ -0,0 +1,285 @@
+﻿#include <gtest/gtest.h>
+
+#include <random>
+
+#include "AtlasRectPacker.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 小さなマテリアルテクスチャを想定したランダムなサイズを作る
+	/// </summary>
+	std::vector<AtlasRectSize> CreateRandomSizes(uint32_t count, uint32_t seed)
+	{
+		std::mt19937 engine(seed);
+		std::uniform_int_distribution<uint32_t> size(5, 200);
+
+		std::vector<AtlasRectSize> sizes(count);
+		for (auto& rect : sizes)
+		{
+			rect.Width = size(engine);
+			rect.Height = size(engine);
+		}
+		return sizes;
+	}
+
+	/// <summary>
+	/// パディングを含めた矩形が重なっているかどうか
+	/// </summary>
+	bool IsOverlapped(const AtlasPlacement& a, const AtlasPlacement& b, uint32_t padding)
+	{
+		if (a.Page != b.Page)
+		{
+			return false;
+		}
+
+		return a.X - padding < b.X + b.Width + padding
+			&& b.X - padding < a.X + a.Width + padding
+			&& a.Y - padding < b.Y + b.Height + padding
+			&& b.Y - padding < a.Y + a.Height + padding;
+	}
+
+	/// <summary>
+	/// 全ての配置がアラインメントされ, ページに収まり, 互いに重ならないことを確認する
+	/// </summary>
+	void ExpectValidPlacements(const std::vector<AtlasPlacement>& placements, const AtlasPackDesc& desc, const AtlasPackReport& report)
+	{
+		auto alignment = CalcAtlasAlignment(desc);
+		auto padding = CalcAtlasPadding(desc);
+
+		for (size_t i = 0; i < placements.size(); ++i)
+		{
+			const auto& p = placements[i];
+			ASSERT_TRUE(p.IsPacked()) << "rect " << i;
+			EXPECT_LT(p.Page, report.PageCount);
+			EXPECT_EQ(p.X % alignment, 0u);
+			EXPECT_EQ(p.Y % alignment, 0u);
+			EXPECT_EQ(p.Width % alignment, 0u);
+			EXPECT_EQ(p.Height % alignment, 0u);
+			EXPECT_GE(p.X, padding);
+			EXPECT_GE(p.Y, padding);
+			EXPECT_LE(p.X + p.Width + padding, report.PageSize);
+			EXPECT_LE(p.Y + p.Height + padding, report.PageSize);
+
+			for (size_t j = i + 1; j < placements.size(); ++j)
+			{
+				EXPECT_FALSE(IsOverlapped(p, placements[j], padding)) << "rect " << i << " and " << j;
+			}
+		}
+	}
+}
+
+TEST(AtlasRectPacker, PacksRandomRectsWithoutOverlap)
+{
+	const ATLAS_HEURISTIC heuristics[] = { ATLAS_HEURISTIC_SKYLINE_BL, ATLAS_HEURISTIC_SKYLINE_BF };
+
+	for (auto heuristic : heuristics)
+	{
+		AtlasPackDesc desc;
+		desc.Heuristic = heuristic;
+
+		auto sizes = CreateRandomSizes(64, 7);
+
+		std::vector<AtlasPlacement> placements;
+		AtlasPackReport report;
+		ASSERT_TRUE(PackAtlasRects(sizes, desc, placements, &report));
+
+		EXPECT_EQ(report.InputCount, 64u);
+		EXPECT_EQ(report.PackedCount, 64u);
+		ASSERT_EQ(placements.size(), sizes.size());
+		ExpectValidPlacements(placements, desc, report);
+
+		// アラインメント後のサイズは元のサイズ以上で, 1単位未満しか大きくならない
+		auto alignment = CalcAtlasAlignment(desc);
+		for (size_t i = 0; i < sizes.size(); ++i)
+		{
+			EXPECT_GE(placements[i].Width, sizes[i].Width);
+			EXPECT_LT(placements[i].Width, sizes[i].Width + alignment);
+			EXPECT_GE(placements[i].Height, sizes[i].Height);
+			EXPECT_LT(placements[i].Height, sizes[i].Height + alignment);
+		}
+	}
+}
+
+TEST(AtlasRectPacker, SinglePageUsesSmallestPowerOfTwo)
+{
+	AtlasPackDesc desc;
+	desc.MipCount = 1;
+	desc.Gutter = 0;
+
+	std::vector<AtlasRectSize> sizes(4, AtlasRectSize{ 64, 64 });
+
+	std::vector<AtlasPlacement> placements;
+	AtlasPackReport report;
+	ASSERT_TRUE(PackAtlasRects(sizes, desc, placements, &report));
+
+	EXPECT_EQ(report.PageCount, 1u);
+	EXPECT_EQ(report.PageSize, 128u);
+	EXPECT_DOUBLE_EQ(report.CalcEfficiency(), 1.0);
+	ExpectValidPlacements(placements, desc, report);
+}
+
+TEST(AtlasRectPacker, OverflowAddsFullSizePages)
+{
+	AtlasPackDesc desc;
+	desc.PageSize = 256;
+	desc.MipCount = 1;
+	desc.Gutter = 0;
+
+	// 1ページに4つしか入らないので3ページになる
+	std::vector<AtlasRectSize> sizes(10, AtlasRectSize{ 128, 128 });
+
+	std::vector<AtlasPlacement> placements;
+	AtlasPackReport report;
+	ASSERT_TRUE(PackAtlasRects(sizes, desc, placements, &report));
+
+	EXPECT_EQ(report.PageCount, 3u);
+	EXPECT_EQ(report.PageSize, 256u);
+	EXPECT_EQ(report.PageTexels, 3ull * 256 * 256);
+	ExpectValidPlacements(placements, desc, report);
+}
+
+TEST(AtlasRectPacker, OversizedRectIsNotPacked)
+{
+	AtlasPackDesc desc;
+	desc.PageSize = 256;
+
+	std::vector<AtlasRectSize> sizes = { { 32, 32 }, { 256, 16 }, { 48, 40 } };
+
+	std::vector<AtlasPlacement> placements;
+	AtlasPackReport report;
+	EXPECT_FALSE(PackAtlasRects(sizes, desc, placements, &report));
+
+	EXPECT_EQ(report.InputCount, 3u);
+	EXPECT_EQ(report.PackedCount, 2u);
+	EXPECT_TRUE(placements[0].IsPacked());
+	EXPECT_FALSE(placements[1].IsPacked());
+	EXPECT_TRUE(placements[2].IsPacked());
+}
+
+TEST(AtlasRectPacker, ReportsOccupancy)
+{
+	AtlasPackDesc desc;
+	auto sizes = CreateRandomSizes(100, 3);
+
+	std::vector<AtlasPlacement> placements;
+	AtlasPackReport report;
+	ASSERT_TRUE(PackAtlasRects(sizes, desc, placements, &report));
+
+	auto padding = CalcAtlasPadding(desc);
+
+	uint64_t sourceTexels = 0;
+	uint64_t contentTexels = 0;
+	uint64_t paddedTexels = 0;
+	for (size_t i = 0; i < sizes.size(); ++i)
+	{
+		sourceTexels += uint64_t(sizes[i].Width) * sizes[i].Height;
+		contentTexels += uint64_t(placements[i].Width) * placements[i].Height;
+		paddedTexels += uint64_t(placements[i].Width + padding * 2) * (placements[i].Height + padding * 2);
+	}
+
+	EXPECT_EQ(report.SourceTexels, sourceTexels);
+	EXPECT_EQ(report.ContentTexels, contentTexels);
+	EXPECT_EQ(report.PaddedTexels, paddedTexels);
+	EXPECT_EQ(report.PageTexels, uint64_t(report.PageSize) * report.PageSize * report.PageCount);
+	EXPECT_LE(report.PaddedTexels, report.PageTexels);
+	EXPECT_GT(report.CalcEfficiency(), 0.0);
+	EXPECT_LE(report.CalcEfficiency(), 1.0);
+}
+
+TEST(AtlasRectPacker, BlitFillsGutterWithEdgeTexels)
+{
+	AtlasPackDesc desc;
+	desc.MipCount = 2;
+	desc.Gutter = 1;
+
+	AtlasPlacement placement;
+	placement.Page = 0;
+	placement.X = 4;
+	placement.Y = 4;
+	placement.Width = 4;
+	placement.Height = 4;
+
+	// 各テクセルに自身の座標を格納する
+	std::vector<CpuImage> sourceMips(2);
+	for (auto mip = 0u; mip < 2; ++mip)
+	{
+		auto size = 4u >> mip;
+		sourceMips[mip].Resize(size, size);
+		for (auto y = 0u; y < size; ++y)
+		{
+			for (auto x = 0u; x < size; ++x)
+			{
+				sourceMips[mip].GetRow(y)[x] = XMFLOAT4(float(x), float(y), float(mip), 1.0f);
+			}
+		}
+	}
+
+	std::vector<CpuImage> pageMips(2);
+	pageMips[0].Resize(16, 16);
+	pageMips[1].Resize(8, 8);
+	for (auto& mip : pageMips)
+	{
+		std::fill(mip.Pixels.begin(), mip.Pixels.end(), XMFLOAT4(-1.0f, -1.0f, -1.0f, 0.0f));
+	}
+
+	BlitAtlasMips(sourceMips, placement, desc, pageMips);
+
+	// ミップ0のパディングは2テクセル, ミップ1は1テクセル
+	for (auto mip = 0u; mip < 2; ++mip)
+	{
+		auto x0 = int(placement.X >> mip);
+		auto y0 = int(placement.Y >> mip);
+		auto size = int(placement.Width >> mip);
+		auto g = int(CalcAtlasPadding(desc) >> mip);
+
+		for (auto y = -g; y < size + g; ++y)
+		{
+			for (auto x = -g; x < size + g; ++x)
+			{
+				const auto& texel = pageMips[mip].GetRow(uint32_t(y0 + y))[x0 + x];
+				EXPECT_EQ(texel.x, float(std::clamp(x, 0, size - 1))) << "mip " << mip << " (" << x << ", " << y << ")";
+				EXPECT_EQ(texel.y, float(std::clamp(y, 0, size - 1))) << "mip " << mip << " (" << x << ", " << y << ")";
+				EXPECT_EQ(texel.z, float(mip));
+			}
+		}
+
+		// ガターの外側は書き換えない
+		EXPECT_EQ(pageMips[mip].GetRow(uint32_t(y0 - g - 1))[x0].w, 0.0f);
+		EXPECT_EQ(pageMips[mip].GetRow(uint32_t(y0))[x0 + size + g].w, 0.0f);
+	}
+}
+
+TEST(AtlasRectPacker, RemapsMeshUVIntoPlacement)
+{
+	ResMesh mesh;
+	mesh.MaterialId = 0;
+	mesh.Vertices.resize(3);
+	mesh.Vertices[0].TexCoord = XMFLOAT2(0.0f, 0.0f);
+	mesh.Vertices[1].TexCoord = XMFLOAT2(1.0f, 0.5f);
+	mesh.Vertices[2].TexCoord = XMFLOAT2(0.25f, 1.0f);
+	EXPECT_TRUE(IsUVInUnitRange(mesh));
+
+	AtlasPlacement placement;
+	placement.Page = 0;
+	placement.X = 64;
+	placement.Y = 128;
+	placement.Width = 32;
+	placement.Height = 64;
+
+	RemapMeshUV(mesh, placement.CalcUVScaleBias(256));
+
+	EXPECT_FLOAT_EQ(mesh.Vertices[0].TexCoord.x, 64.0f / 256.0f);
+	EXPECT_FLOAT_EQ(mesh.Vertices[0].TexCoord.y, 128.0f / 256.0f);
+	EXPECT_FLOAT_EQ(mesh.Vertices[1].TexCoord.x, 96.0f / 256.0f);
+	EXPECT_FLOAT_EQ(mesh.Vertices[1].TexCoord.y, 160.0f / 256.0f);
+	EXPECT_FLOAT_EQ(mesh.Vertices[2].TexCoord.x, 72.0f / 256.0f);
+	EXPECT_FLOAT_EQ(mesh.Vertices[2].TexCoord.y, 192.0f / 256.0f);
+
+	// ラップするテクスチャ座標はアトラスにできない
+	ResMesh wrapped = mesh;
+	wrapped.Vertices[0].TexCoord = XMFLOAT2(1.5f, 0.0f);
+	EXPECT_FALSE(IsUVInUnitRange(wrapped));
+}
@@ -0,0 +1,326 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "BloomCPU.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 倍精度のRGB画像 (基準画像の計算用)
+	/// </summary>
+	struct GoldenImage
+	{
+		uint32_t			Width = 0;
+		uint32_t			Height = 0;
+		std::vector<double>	Texels;		// RGB
+
+		void Resize(uint32_t width, uint32_t height)
+		{
+			Width = width;
+			Height = height;
+			Texels.assign(size_t(width) * height * 3, 0.0);
+		}
+
+		double* At(int x, int y)
+		{
+			x = std::clamp(x, 0, int(Width) - 1);
+			y = std::clamp(y, 0, int(Height) - 1);
+			return &Texels[(size_t(y) * Width + x) * 3];
+		}
+	};
+
+	/// <summary>
+	/// テクセル中心を基準にクランプしてバイリニアサンプリングする
+	/// </summary>
+	void SampleGolden(GoldenImage& image, double u, double v, double* result)
+	{
+		auto fx = u * image.Width - 0.5;
+		auto fy = v * image.Height - 0.5;
+		auto x0 = int(std::floor(fx));
+		auto y0 = int(std::floor(fy));
+		auto tx = fx - x0;
+		auto ty = fy - y0;
+
+		for (auto c = 0; c < 3; ++c)
+		{
+			auto c0 = image.At(x0, y0)[c] * (1.0 - tx) + image.At(x0 + 1, y0)[c] * tx;
+			auto c1 = image.At(x0, y0 + 1)[c] * (1.0 - tx) + image.At(x0 + 1, y0 + 1)[c] * tx;
+			result[c] = c0 * (1.0 - ty) + c1 * ty;
+		}
+	}
+
+	/// <summary>
+	/// GPU版と同じ手順のブルームを, 最適化や並列化をせずに倍精度で求める
+	/// 輝度抽出と縮小 ---> 各レベルの分離ガウスブラー ---> 小さいレベルから順に拡大加算
+	/// </summary>
+	CpuImage BuildGoldenBloom(const CpuImage& scene, const BloomParam& param)
+	{
+		GoldenImage source;
+		source.Resize(scene.Width, scene.Height);
+		for (size_t i = 0; i < scene.Pixels.size(); ++i)
+		{
+			source.Texels[i * 3 + 0] = scene.Pixels[i].x;
+			source.Texels[i * 3 + 1] = scene.Pixels[i].y;
+			source.Texels[i * 3 + 2] = scene.Pixels[i].z;
+		}
+
+		auto levelCount = CalcBloomLevelCount(scene.Width, scene.Height, param.LevelCount);
+
+		// ガウス関数のウェイト (中心以外は左右で2回使う)
+		double weights[BloomTapCount];
+		double total = 0.0;
+		for (auto i = 0u; i < BloomTapCount; ++i)
+		{
+			weights[i] = std::exp(-double(i * i) / (2.0 * param.Sigma * param.Sigma));
+			total += (i == 0) ? weights[i] : 2.0 * weights[i];
+		}
+		for (auto& weight : weights)
+		{
+			weight /= total;
+		}
+
+		std::vector<GoldenImage> levels(levelCount);
+		for (auto i = 0u; i < levelCount; ++i)
+		{
+			auto& src = (i == 0) ? source : levels[i - 1];
+			auto& dst = levels[i];
+			dst.Resize(std::max(scene.Width >> (i + 1), 1u), std::max(scene.Height >> (i + 1), 1u));
+
+			for (auto y = 0u; y < dst.Height; ++y)
+			{
+				for (auto x = 0u; x < dst.Width; ++x)
+				{
+					auto texel = dst.At(int(x), int(y));
+					SampleGolden(src, (x + 0.5) / dst.Width, (y + 0.5) / dst.Height, texel);
+
+					if (i == 0)
+					{
+						double brightness = std::max(texel[0], std::max(texel[1], texel[2]));
+						double knee = param.Knee;
+						auto soft = std::clamp(brightness - param.Threshold + knee, 0.0, 2.0 * knee);
+						soft = soft * soft / (4.0 * knee + 1e-5);
+						auto contribution = std::max(soft, brightness - param.Threshold) / std::max(brightness, 1e-5);
+						for (auto c = 0; c < 3; ++c)
+						{
+							texel[c] *= contribution;
+						}
+					}
+				}
+			}
+		}
+
+		for (auto& level : levels)
+		{
+			for (auto pass = 0; pass < 2; ++pass)
+			{
+				auto blurred = level;
+				for (auto y = 0; y < int(level.Height); ++y)
+				{
+					for (auto x = 0; x < int(level.Width); ++x)
+					{
+						for (auto c = 0; c < 3; ++c)
+						{
+							auto sum = weights[0] * level.At(x, y)[c];
+							for (auto i = 1; i < int(BloomTapCount); ++i)
+							{
+								sum += (pass == 0)
+									? weights[i] * (level.At(x - i, y)[c] + level.At(x + i, y)[c])
+									: weights[i] * (level.At(x, y - i)[c] + level.At(x, y + i)[c]);
+							}
+							blurred.At(x, y)[c] = sum;
+						}
+					}
+				}
+				level = blurred;
+			}
+		}
+
+		for (auto i = levelCount - 1; i > 0; --i)
+		{
+			auto& dst = levels[i - 1];
+			for (auto y = 0u; y < dst.Height; ++y)
+			{
+				for (auto x = 0u; x < dst.Width; ++x)
+				{
+					double color[3];
+					SampleGolden(levels[i], (x + 0.5) / dst.Width, (y + 0.5) / dst.Height, color);
+					for (auto c = 0; c < 3; ++c)
+					{
+						dst.At(int(x), int(y))[c] += color[c];
+					}
+				}
+			}
+		}
+
+		CpuImage result;
+		result.Resize(levels[0].Width, levels[0].Height);
+		for (size_t i = 0; i < result.Pixels.size(); ++i)
+		{
+			result.Pixels[i] = XMFLOAT4(
+				float(levels[0].Texels[i * 3 + 0]),
+				float(levels[0].Texels[i * 3 + 1]),
+				float(levels[0].Texels[i * 3 + 2]),
+				1.0f);
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// 暗いグラデーションに明るい点を散らしたシーンを作る (奇数サイズで端数の縮小も確認する)
+	/// </summary>
+	CpuImage CreateScene(uint32_t width, uint32_t height)
+	{
+		CpuImage scene;
+		scene.Resize(width, height);
+
+		for (auto y = 0u; y < height; ++y)
+		{
+			for (auto x = 0u; x < width; ++x)
+			{
+				auto value = 0.5f * float(x + y) / float(width + height);
+				scene.GetRow(y)[x] = XMFLOAT4(value, value * 0.8f, value * 1.2f, 1.0f);
+			}
+		}
+
+		for (auto i = 0u; i < 24; ++i)
+		{
+			auto x = (i * 37u + 5u) % width;
+			auto y = (i * 23u + 3u) % height;
+			auto value = 1.0f + float(i % 7) * 2.0f;
+			scene.GetRow(y)[x] = XMFLOAT4(value, value * 0.7f, value * 0.4f, 1.0f);
+		}
+
+		return scene;
+	}
+}
+
+TEST(BloomCPU, LevelCountStopsAtOneTexel)
+{
+	EXPECT_EQ(CalcBloomLevelCount(1280, 720, 5), 5u);
+	EXPECT_EQ(CalcBloomLevelCount(1280, 720, 100), BloomMaxLevelCount);
+	EXPECT_EQ(CalcBloomLevelCount(1280, 720, 0), 1u);
+	EXPECT_EQ(CalcBloomLevelCount(64, 8, 8), 3u);
+	EXPECT_EQ(CalcBloomLevelCount(1, 1, 8), 1u);
+
+	EXPECT_EQ(CalcBloomLevelSize(1280, 0), 640u);
+	EXPECT_EQ(CalcBloomLevelSize(721, 1), 180u);
+	EXPECT_EQ(CalcBloomLevelSize(4, 5), 1u);
+}
+
+TEST(BloomCPU, WeightsAreNormalized)
+{
+	for (auto sigma : { 0.5f, 1.0f, 2.5f, 8.0f })
+	{
+		auto weights = CalcBloomWeights(sigma);
+		ASSERT_EQ(weights.size(), size_t(BloomTapCount));
+
+		auto sum = weights[0];
+		for (auto i = 1u; i < BloomTapCount; ++i)
+		{
+			EXPECT_LT(weights[i], weights[i - 1]);
+			sum += 2.0f * weights[i];
+		}
+		EXPECT_NEAR(sum, 1.0f, 1e-6f) << "sigma " << sigma;
+	}
+}
+
+TEST(BloomCPU, ThresholdKeepsOnlyBrightPart)
+{
+	const float threshold = 0.8f;
+	const float knee = 0.2f;
+
+	// しきい値 - knee 以下は0
+	auto dark = ApplyBloomThreshold(XMVectorSet(0.5f, 0.4f, 0.3f, 1.0f), threshold, knee);
+	EXPECT_EQ(XMVectorGetX(dark), 0.0f);
+
+	// しきい値 + knee 以上は (輝度 - しきい値) / 輝度 の割合を残す
+	auto bright = ApplyBloomThreshold(XMVectorSet(4.0f, 2.0f, 1.0f, 1.0f), threshold, knee);
+	EXPECT_NEAR(XMVectorGetX(bright), 4.0f * 3.2f / 4.0f, 1e-5f);
+	EXPECT_NEAR(XMVectorGetY(bright), 2.0f * 3.2f / 4.0f, 1e-5f);
+
+	// しきい値付近は連続的に増える
+	auto previous = 0.0f;
+	for (auto value = 0.5f; value < 1.5f; value += 0.01f)
+	{
+		auto result = XMVectorGetX(ApplyBloomThreshold(XMVectorReplicate(value), threshold, knee));
+		EXPECT_GE(result, previous - 1e-6f) << "value " << value;
+		EXPECT_LT(result - previous, 0.05f) << "value " << value;
+		previous = result;
+	}
+}
+
+TEST(BloomCPU, ConstantSceneSumsEveryLevel)
+{
+	// 一定の画像はブラーと拡大で変化しないので, 抽出した値がレベル数だけ加算される
+	CpuImage scene;
+	scene.Resize(64, 32);
+	std::fill(scene.Pixels.begin(), scene.Pixels.end(), XMFLOAT4(2.0f, 2.0f, 2.0f, 1.0f));
+
+	BloomParam param;
+	param.LevelCount = 4;
+
+	std::vector<CpuImage> levels;
+	BuildBloomCPU(scene, param, levels);
+
+	ASSERT_EQ(levels.size(), 4u);
+	EXPECT_EQ(levels[0].Width, 32u);
+	EXPECT_EQ(levels[0].Height, 16u);
+
+	auto extracted = XMVectorGetX(ApplyBloomThreshold(XMVectorReplicate(2.0f), param.Threshold, param.Knee));
+	for (const auto& pixel : levels[0].Pixels)
+	{
+		EXPECT_NEAR(pixel.x, extracted * 4.0f, 1e-4f);
+		EXPECT_NEAR(pixel.z, extracted * 4.0f, 1e-4f);
+		EXPECT_EQ(pixel.w, 1.0f);
+	}
+}
+
+TEST(BloomCPU, MatchesGoldenImage)
+{
+	auto scene = CreateScene(97, 61);
+
+	BloomParam param;
+	param.LevelCount = 4;
+	param.Sigma = 2.0f;
+
+	auto golden = BuildGoldenBloom(scene, param);
+
+	std::vector<CpuImage> levels;
+	BuildBloomCPU(scene, param, levels, nullptr, 4);
+
+	auto error = CompareImages(golden, levels[0]);
+	ASSERT_GE(error.RMSE, 0.0) << "size mismatch";
+
+	// 単精度の丸め誤差以内で一致する
+	EXPECT_LT(error.MaxError, 1e-4);
+	EXPECT_GT(error.PSNR, 90.0);
+}
+
+TEST(BloomCPU, ResultIsIndependentOfThreadCount)
+{
+	auto scene = CreateScene(128, 72);
+
+	BloomParam param;
+	param.LevelCount = BloomMaxLevelCount;
+
+	std::vector<CpuImage> single;
+	std::vector<CpuImage> multi;
+	std::vector<BloomLevelTiming> timings;
+	BuildBloomCPU(scene, param, single, nullptr, 1);
+	BuildBloomCPU(scene, param, multi, &timings, 4);
+
+	ASSERT_EQ(single.size(), multi.size());
+	ASSERT_EQ(timings.size(), multi.size());
+	for (size_t i = 0; i < single.size(); ++i)
+	{
+		EXPECT_EQ(timings[i].Width, multi[i].Width);
+		EXPECT_EQ(timings[i].Height, multi[i].Height);
+
+		auto error = CompareImages(single[i], multi[i]);
+		EXPECT_EQ(error.MaxError, 0.0) << "level " << i;
+	}
+}
@@ -0,0 +1,167 @@
+﻿#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "CascadedShadow.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 値が間隔の整数倍かどうか
+	/// </summary>
+	bool IsMultipleOf(float value, float step, float tolerance)
+	{
+		auto ratio = value / step;
+		return fabsf(ratio - roundf(ratio)) <= tolerance;
+	}
+
+	XMFLOAT4X4 CreateView(const XMFLOAT3& eye, const XMFLOAT3& target)
+	{
+		XMFLOAT4X4 view;
+		XMStoreFloat4x4(&view, XMMatrixLookAtRH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		return view;
+	}
+
+	/// <summary>
+	/// テスト共通のカメラとライト
+	/// </summary>
+	class CascadedShadowTest : public ::testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			XMStoreFloat4x4(&m_Proj, XMMatrixPerspectiveFovRH(XMConvertToRadians(37.5f), 16.0f / 9.0f, 0.1f, 1000.0f));
+			m_View = CreateView(XMFLOAT3(0.3f, 0.4f, 1.0f), XMFLOAT3(0.0f, 0.0f, 0.0f));
+			FitShadowCascades(m_View, m_Proj, m_LightDirection, m_Desc, nullptr, 0, m_Cascades);
+		}
+
+		ShadowCascadeDesc	m_Desc;
+		XMFLOAT3			m_LightDirection = XMFLOAT3(-0.3f, -1.0f, -0.4f);
+		XMFLOAT4X4			m_View;
+		XMFLOAT4X4			m_Proj;
+		ShadowCascade		m_Cascades[MaxShadowCascadeCount];
+	};
+}
+
+TEST(CascadeSplits, MonotonicAndCoversRange)
+{
+	float splits[MaxShadowCascadeCount + 1];
+	ComputeCascadeSplits(0.1f, 10.0f, MaxShadowCascadeCount, 0.75f, splits);
+
+	EXPECT_EQ(splits[0], 0.1f);
+	EXPECT_EQ(splits[MaxShadowCascadeCount], 10.0f);
+	for (auto i = 0u; i < MaxShadowCascadeCount; ++i)
+	{
+		EXPECT_LT(splits[i], splits[i + 1]) << "split " << i;
+	}
+}
+
+TEST(CascadeSplits, LogarithmicOnly)
+{
+	// 対数分割のみの場合は隣接する分割の比が一定
+	float splits[3];
+	ComputeCascadeSplits(1.0f, 100.0f, 2, 1.0f, splits);
+
+	EXPECT_NEAR(splits[1], 10.0f, 1e-3f);
+}
+
+TEST_F(CascadedShadowTest, ContainsSplitCorners)
+{
+	// 分割範囲の8頂点がカスケードに収まる
+	for (auto i = 0u; i < m_Desc.CascadeCount; ++i)
+	{
+		XMFLOAT3 corners[8];
+		ComputeFrustumCorners(m_View, m_Proj, m_Cascades[i].SplitNear, m_Cascades[i].SplitFar, corners);
+
+		auto viewProj = XMLoadFloat4x4(&m_Cascades[i].ViewProj);
+		for (auto j = 0; j < 8; ++j)
+		{
+			XMFLOAT3 p;
+			XMStoreFloat3(&p, XMVector3TransformCoord(XMLoadFloat3(&corners[j]), viewProj));
+
+			const auto eps = 1e-4f;
+			EXPECT_LE(fabsf(p.x), 1.0f + eps) << "cascade " << i << ", corner " << j;
+			EXPECT_LE(fabsf(p.y), 1.0f + eps) << "cascade " << i << ", corner " << j;
+			EXPECT_GE(p.z, -eps) << "cascade " << i << ", corner " << j;
+			EXPECT_LE(p.z, 1.0f + eps) << "cascade " << i << ", corner " << j;
+		}
+	}
+}
+
+TEST_F(CascadedShadowTest, TranslationIsTexelSnapped)
+{
+	// カメラを平行移動しても, 範囲はテクセル単位でしか動かず大きさも変わらない
+	auto offset = XMFLOAT3(0.0123f, 0.0047f, -0.0071f);
+	auto moved = CreateView(XMFLOAT3(0.3f + offset.x, 0.4f + offset.y, 1.0f + offset.z), offset);
+
+	ShadowCascade movedCascades[MaxShadowCascadeCount];
+	FitShadowCascades(moved, m_Proj, m_LightDirection, m_Desc, nullptr, 0, movedCascades);
+
+	for (auto i = 0u; i < m_Desc.CascadeCount; ++i)
+	{
+		const auto& a = m_Cascades[i];
+		const auto& b = movedCascades[i];
+
+		EXPECT_TRUE(IsMultipleOf(b.BoundsMin.x - a.BoundsMin.x, a.TexelSize, 1e-2f))
+			<< "cascade " << i << ", dx = " << (b.BoundsMin.x - a.BoundsMin.x) << ", texel = " << a.TexelSize;
+		EXPECT_TRUE(IsMultipleOf(b.BoundsMin.y - a.BoundsMin.y, a.TexelSize, 1e-2f))
+			<< "cascade " << i << ", dy = " << (b.BoundsMin.y - a.BoundsMin.y) << ", texel = " << a.TexelSize;
+		EXPECT_EQ(a.TexelSize, b.TexelSize) << "cascade " << i;
+		EXPECT_NEAR(b.BoundsMax.x - b.BoundsMin.x, a.BoundsMax.x - a.BoundsMin.x, a.TexelSize * 1e-2f) << "cascade " << i;
+	}
+}
+
+TEST_F(CascadedShadowTest, RotationKeepsSize)
+{
+	// カメラを回転しても大きさは変わらない
+	auto angle = XMConvertToRadians(40.0f);
+	auto eye = XMFLOAT3(0.3f * cosf(angle) + 1.0f * sinf(angle), 0.4f, -0.3f * sinf(angle) + 1.0f * cosf(angle));
+	auto rotated = CreateView(eye, XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+	ShadowCascade rotatedCascades[MaxShadowCascadeCount];
+	FitShadowCascades(rotated, m_Proj, m_LightDirection, m_Desc, nullptr, 0, rotatedCascades);
+
+	for (auto i = 0u; i < m_Desc.CascadeCount; ++i)
+	{
+		EXPECT_EQ(rotatedCascades[i].Radius, m_Cascades[i].Radius) << "cascade " << i;
+	}
+}
+
+TEST_F(CascadedShadowTest, CullsCastersOutsideCascade)
+{
+	XMFLOAT3 corners[8];
+	ComputeFrustumCorners(m_View, m_Proj, m_Cascades[0].SplitNear, m_Cascades[0].SplitFar, corners);
+
+	auto center = XMVectorZero();
+	for (auto i = 0; i < 8; ++i)
+	{
+		center = XMVectorAdd(center, XMLoadFloat3(&corners[i]));
+	}
+	center = XMVectorScale(center, 1.0f / 8.0f);
+
+	// 0: 分割範囲の中心, 1: 範囲外で光源側にあるが影を落とす位置, 2: 横方向に離れた位置
+	XMFLOAT3 positions[3];
+	XMStoreFloat3(&positions[0], center);
+	XMStoreFloat3(&positions[1], XMVectorSubtract(center, XMVectorScale(XMVector3Normalize(XMLoadFloat3(&m_LightDirection)), 50.0f)));
+	XMStoreFloat3(&positions[2], XMVectorAdd(center, XMVectorSet(100.0f, 0.0f, 0.0f, 0.0f)));
+
+	ShadowCasterBounds casters[3];
+	for (auto i = 0; i < 3; ++i)
+	{
+		const auto size = 0.01f;
+		casters[i].Min = XMFLOAT3(positions[i].x - size, positions[i].y - size, positions[i].z - size);
+		casters[i].Max = XMFLOAT3(positions[i].x + size, positions[i].y + size, positions[i].z + size);
+	}
+
+	ShadowCascade cascade;
+	auto lightView = CreateShadowLightView(m_LightDirection);
+	FitShadowCascade(lightView, corners, casters, 3, m_Desc.Resolution, m_Desc.DepthMargin, cascade);
+
+	std::vector<uint32_t> visible;
+	CullShadowCasters(cascade, casters, 3, visible);
+
+	EXPECT_EQ(visible, (std::vector<uint32_t>{ 0, 1 }));
+}
@@ -0,0 +1,202 @@
+﻿#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "ClusterLightScene.h"
+
+using namespace DirectX;
+
+namespace
+{
+	void ExpectSameGrid(const ClusterLightGrid& actual, const ClusterLightGrid& expected)
+	{
+		EXPECT_EQ(actual.OverflowCount, expected.OverflowCount);
+		EXPECT_EQ(actual.LightIndices, expected.LightIndices);
+		ASSERT_EQ(actual.Ranges.size(), expected.Ranges.size());
+		for (size_t i = 0; i < expected.Ranges.size(); ++i)
+		{
+			EXPECT_EQ(actual.Ranges[i].Offset, expected.Ranges[i].Offset) << "cluster " << i;
+			EXPECT_EQ(actual.Ranges[i].Count, expected.Ranges[i].Count) << "cluster " << i;
+		}
+	}
+
+	/// <summary>
+	/// クラスターのライトの番号を取得する
+	/// </summary>
+	std::vector<uint32_t> GetClusterLights(const ClusterLightGrid& grid, uint32_t cluster)
+	{
+		const auto& range = grid.Ranges[cluster];
+		return std::vector<uint32_t>(
+			grid.LightIndices.begin() + range.Offset,
+			grid.LightIndices.begin() + range.Offset + range.Count);
+	}
+}
+
+TEST(ClusterLightAssignment, BoundsCoverFrustum)
+{
+	ClusterGridDesc desc;
+	auto scene = BuildClusterLightScene(desc, 0, 1);
+
+	ClusterBounds bounds;
+	BuildClusterBounds(scene.Proj, desc, bounds);
+
+	EXPECT_EQ(bounds.TileStride % 4, 0u);
+	EXPECT_GE(bounds.TileStride, desc.GetTileCount());
+	EXPECT_EQ(bounds.DepthSign, -1.0f);
+	ASSERT_EQ(bounds.MinX.size(), size_t(bounds.TileStride) * desc.SliceCount);
+
+	// 最初のスライスは近クリップ面から, 最後のスライスは遠クリップ面まで
+	EXPECT_NEAR(bounds.MaxZ[0], -desc.NearZ, 1e-4f);
+	auto last = (desc.SliceCount - 1) * bounds.TileStride;
+	EXPECT_NEAR(bounds.MinZ[last], -desc.FarZ, desc.FarZ * 1e-4f);
+
+	for (auto slice = 0u; slice < desc.SliceCount; ++slice)
+	{
+		for (auto tile = 0u; tile < bounds.TileStride; ++tile)
+		{
+			auto element = slice * bounds.TileStride + tile;
+			if (tile < desc.GetTileCount())
+			{
+				EXPECT_LE(bounds.MinX[element], bounds.MaxX[element]);
+				EXPECT_LE(bounds.MinY[element], bounds.MaxY[element]);
+				EXPECT_LE(bounds.MinZ[element], bounds.MaxZ[element]);
+			}
+			else
+			{
+				// 余りの要素はどのライトとも重ならない
+				EXPECT_GT(bounds.MinX[element], bounds.MaxX[element]);
+			}
+		}
+	}
+}
+
+TEST(ClusterLightAssignment, SimdMatchesReference)
+{
+	ClusterGridDesc desc;
+	auto scene = BuildClusterLightScene(desc, 2048, 1);
+
+	ClusterBounds bounds;
+	BuildClusterBounds(scene.Proj, desc, bounds);
+
+	ClusterLightGrid reference;
+	AssignClusterLightsReference(bounds, desc, scene.View, scene.Lights.data(), uint32_t(scene.Lights.size()), reference);
+	EXPECT_FALSE(reference.LightIndices.empty());
+
+	for (auto threadCount : { 1u, 2u, 4u, 0u })
+	{
+		ClusterLightGrid grid;
+		AssignClusterLights(bounds, desc, scene.View, scene.Lights.data(), uint32_t(scene.Lights.size()), grid, threadCount);
+		ExpectSameGrid(grid, reference);
+	}
+}
+
+TEST(ClusterLightAssignment, PointLightReachesItsCluster)
+{
+	ClusterGridDesc desc;
+	auto scene = BuildClusterLightScene(desc, 0, 1);
+
+	ClusterBounds bounds;
+	BuildClusterBounds(scene.Proj, desc, bounds);
+
+	// 画面中央, 深度10の小さいライト
+	auto light = MakeClusterPointLight(XMFLOAT3(0.0f, 0.0f, -10.0f), 0.01f, XMFLOAT3(1.0f, 1.0f, 1.0f), 1.0f);
+
+	ClusterLightGrid grid;
+	AssignClusterLights(bounds, desc, scene.View, &light, 1, grid);
+
+	auto params = GetClusterShaderParams(desc, 1600.0f, 900.0f, 1);
+	auto tileX = uint32_t(800.0f * params.TileScaleX);
+	auto tileY = uint32_t(450.0f * params.TileScaleY);
+	auto slice = uint32_t(logf(10.0f) * params.SliceScale + params.SliceBias);
+	auto cluster = (slice * desc.TileCountY + tileY) * desc.TileCountX + tileX;
+
+	EXPECT_EQ(GetClusterLights(grid, cluster), std::vector<uint32_t>{ 0 });
+	EXPECT_LE(grid.LightIndices.size(), 8u);
+}
+
+TEST(ClusterLightAssignment, SpotLightIsCulledByCone)
+{
+	ClusterGridDesc desc;
+	auto scene = BuildClusterLightScene(desc, 0, 1);
+
+	ClusterBounds bounds;
+	BuildClusterBounds(scene.Proj, desc, bounds);
+
+	// カメラの方を照らす細いスポットライトは, ライトより奥のクラスターに入らない
+	auto position = XMFLOAT3(0.0f, 0.0f, -20.0f);
+	auto color = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	auto spot = MakeClusterSpotLight(position, XMFLOAT3(0.0f, 0.0f, 1.0f), 50.0f, color, 1.0f, 0.05f, 0.1f);
+	auto point = MakeClusterPointLight(position, 50.0f, color, 1.0f);
+
+	ClusterLightGrid spotGrid;
+	ClusterLightGrid pointGrid;
+	AssignClusterLights(bounds, desc, scene.View, &spot, 1, spotGrid);
+	AssignClusterLights(bounds, desc, scene.View, &point, 1, pointGrid);
+
+	EXPECT_FALSE(spotGrid.LightIndices.empty());
+	EXPECT_LT(spotGrid.LightIndices.size(), pointGrid.LightIndices.size());
+
+	for (auto cluster = 0u; cluster < desc.GetClusterCount(); ++cluster)
+	{
+		if (spotGrid.Ranges[cluster].Count == 0)
+		{
+			continue;
+		}
+
+		// 円錐で残ったクラスターは球でも残る
+		EXPECT_EQ(pointGrid.Ranges[cluster].Count, 1u) << "cluster " << cluster;
+
+		auto slice = cluster / desc.GetTileCount();
+		auto element = slice * bounds.TileStride + cluster % desc.GetTileCount();
+		EXPECT_GE(bounds.CenterZ[element] + bounds.Radius[element], position.z) << "cluster " << cluster;
+	}
+}
+
+TEST(ClusterLightAssignment, OverflowIsCounted)
+{
+	ClusterGridDesc desc;
+	desc.TileCountX = 1;
+	desc.TileCountY = 1;
+	desc.SliceCount = 1;
+	auto scene = BuildClusterLightScene(desc, 0, 1);
+
+	ClusterBounds bounds;
+	BuildClusterBounds(scene.Proj, desc, bounds);
+
+	std::vector<ClusterLight> lights(MaxLightsPerCluster + 10,
+		MakeClusterPointLight(XMFLOAT3(0.0f, 0.0f, -5.0f), 1.0f, XMFLOAT3(1.0f, 1.0f, 1.0f), 1.0f));
+
+	ClusterLightGrid grid;
+	AssignClusterLights(bounds, desc, scene.View, lights.data(), uint32_t(lights.size()), grid);
+
+	ASSERT_EQ(grid.Ranges.size(), 1u);
+	EXPECT_EQ(grid.Ranges[0].Count, MaxLightsPerCluster);
+	EXPECT_EQ(grid.OverflowCount, 10u);
+
+	// 番号の昇順に並ぶ
+	auto indices = GetClusterLights(grid, 0);
+	for (auto i = 0u; i < indices.size(); ++i)
+	{
+		EXPECT_EQ(indices[i], i);
+	}
+}
+
+TEST(ClusterLightAssignment, EmptyLightsProduceEmptyRanges)
+{
+	ClusterGridDesc desc;
+	auto scene = BuildClusterLightScene(desc, 0, 1);
+
+	ClusterBounds bounds;
+	BuildClusterBounds(scene.Proj, desc, bounds);
+
+	ClusterLightGrid grid;
+	AssignClusterLights(bounds, desc, scene.View, nullptr, 0, grid);
+
+	ASSERT_EQ(grid.Ranges.size(), desc.GetClusterCount());
+	EXPECT_TRUE(grid.LightIndices.empty());
+	for (const auto& range : grid.Ranges)
+	{
+		EXPECT_EQ(range.Count, 0u);
+	}
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "ClusterLightAssignment.h"
+
+/// <summary>
+/// 原点から -z 方向を向くカメラと, 視錐台の中に配置したライト (半分はスポットライト)
+/// </summary>
+struct ClusterLightScene
+{
+	DirectX::XMFLOAT4X4			View;
+	DirectX::XMFLOAT4X4			Proj;
+	std::vector<ClusterLight>	Lights;
+};
+
+/// <summary>
+/// ライトの割り当てを計測/検証するシーンを作る
+/// </summary>
+/// <param name="desc">分割数</param>
+/// <param name="lightCount">ライトの数</param>
+/// <param name="seed">乱数シード</param>
+inline ClusterLightScene BuildClusterLightScene(const ClusterGridDesc& desc, uint32_t lightCount, uint32_t seed)
+{
+	using namespace DirectX;
+
+	// シーンと同じ右手系の射影
+	ClusterLightScene scene;
+	XMStoreFloat4x4(&scene.View, XMMatrixIdentity());
+	XMStoreFloat4x4(&scene.Proj, XMMatrixPerspectiveFovRH(XMConvertToRadians(60.0f), 16.0f / 9.0f, desc.NearZ, desc.FarZ));
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	auto tanY = tanf(XMConvertToRadians(30.0f));
+	auto tanX = tanY * 16.0f / 9.0f;
+
+	scene.Lights.resize(lightCount);
+	for (auto i = 0u; i < lightCount; ++i)
+	{
+		auto depth = 1.0f + 199.0f * unit(rng);
+		auto position = XMFLOAT3(
+			(2.0f * unit(rng) - 1.0f) * tanX * depth,
+			(2.0f * unit(rng) - 1.0f) * tanY * depth,
+			-depth);
+		auto radius = 0.5f + 7.5f * unit(rng);
+		auto color = XMFLOAT3(unit(rng), unit(rng), unit(rng));
+
+		if (i & 1)
+		{
+			XMFLOAT3 forward;
+			XMStoreFloat3(&forward, XMVector3Normalize(XMVectorSet(2.0f * unit(rng) - 1.0f, 2.0f * unit(rng) - 1.0f, 2.0f * unit(rng) - 1.0f, 0.0f)));
+
+			auto outerAngle = XMConvertToRadians(10.0f + 50.0f * unit(rng));
+			scene.Lights[i] = MakeClusterSpotLight(position, forward, radius, color, 100.0f, outerAngle * 0.5f, outerAngle);
+		}
+		else
+		{
+			scene.Lights[i] = MakeClusterPointLight(position, radius, color, 100.0f);
+		}
+	}
+
+	return scene;
+}
@@ -0,0 +1,137 @@
+﻿#include <gtest/gtest.h>
+
+#include <random>
+
+#include "CommandAllocatorTracker.h"
+
+namespace
+{
+	/// <summary>
+	/// フェンスの完了を遅延させたGPUを模擬する
+	/// </summary>
+	struct TrackerSimulation
+	{
+		uint32_t	FrameCount;
+		uint32_t	ThreadCount;
+		uint32_t	Latency;		// フェンスが完了するまでのフレーム数
+		uint32_t	Seed;			// 各スレッドが記録するかどうかを決める乱数のシード
+	};
+
+	class CommandAllocatorTrackerSimulation : public ::testing::TestWithParam<TrackerSimulation>
+	{
+	};
+}
+
+TEST_P(CommandAllocatorTrackerSimulation, NeverReusesBusyAllocator)
+{
+	const auto& param = GetParam();
+
+	CommandAllocatorTracker tracker;
+	tracker.Init(param.ThreadCount);
+
+	std::mt19937 rng(param.Seed);
+	std::uniform_int_distribution<uint32_t> dist(0, 3);
+
+	// busyUntil[thread][index] : アロケータを最後に使ったフレームのフェンス値
+	std::vector<std::vector<uint64_t>> busyUntil(param.ThreadCount);
+
+	for (auto frame = 0u; frame < param.FrameCount; ++frame)
+	{
+		// フレーム番号 + 1 をシグナルし, Latency フレーム遅れて完了する
+		auto fenceValue = uint64_t(frame) + 1;
+		auto completedValue = (fenceValue > param.Latency + 1) ? fenceValue - param.Latency - 1 : 0;
+
+		for (auto t = 0u; t < param.ThreadCount; ++t)
+		{
+			// 記録しないフレームがあっても再利用順が崩れないことを確かめる
+			if (t != 0 && dist(rng) == 0)
+			{
+				continue;
+			}
+
+			auto created = false;
+			auto index = tracker.Acquire(t, completedValue, created);
+
+			if (created)
+			{
+				ASSERT_EQ(index, busyUntil[t].size()) << "thread " << t;
+				busyUntil[t].push_back(0);
+			}
+			else
+			{
+				ASSERT_LE(busyUntil[t][index], completedValue) << "thread " << t << ", index " << index << ", frame " << frame;
+			}
+
+			busyUntil[t][index] = fenceValue;
+		}
+
+		tracker.Retire(fenceValue);
+	}
+
+	// アロケータはGPUの遅延分 + 記録中の1つあれば足りる
+	for (auto t = 0u; t < param.ThreadCount; ++t)
+	{
+		EXPECT_LE(tracker.GetAllocatorCount(t), param.Latency + 1) << "thread " << t;
+	}
+
+	EXPECT_GT(tracker.GetReuseCount(0), 0u);
+}
+
+INSTANTIATE_TEST_SUITE_P(Latency, CommandAllocatorTrackerSimulation, ::testing::Values(
+	TrackerSimulation{ 1000, 8, 0, 1 },
+	TrackerSimulation{ 1000, 8, 1, 2 },
+	TrackerSimulation{ 1000, 8, 2, 1 },
+	TrackerSimulation{ 1000, 4, 3, 3 }));
+
+TEST(CommandAllocatorTracker, ReusesOnlyAfterCompletion)
+{
+	CommandAllocatorTracker tracker;
+	tracker.Init(1);
+
+	auto created = false;
+	EXPECT_EQ(tracker.Acquire(0, 0, created), 0u);
+	EXPECT_TRUE(created);
+	tracker.Retire(1);
+
+	// フェンス値 1 が未完了なので新しいアロケータを割り当てる
+	EXPECT_EQ(tracker.Acquire(0, 0, created), 1u);
+	EXPECT_TRUE(created);
+	tracker.Retire(2);
+	EXPECT_EQ(tracker.GetPendingCount(0, 0), 2u);
+	EXPECT_EQ(tracker.GetPendingCount(0, 1), 1u);
+
+	// フェンス値 1 が完了すると最初のアロケータを再利用する
+	EXPECT_EQ(tracker.Acquire(0, 1, created), 0u);
+	EXPECT_FALSE(created);
+	EXPECT_EQ(tracker.GetReuseCount(0), 1u);
+	EXPECT_EQ(tracker.GetAllocatorCount(0), 2u);
+}
+
+TEST(CommandAllocatorTracker, SortsSubmitEntriesDeterministically)
+{
+	std::vector<CommandListSubmitEntry> entries = {
+		{ 2, 0, 0, nullptr },
+		{ 1, 3, 1, nullptr },
+		{ 1, 3, 0, nullptr },
+		{ 0, 5, 0, nullptr },
+		{ 1, 1, 0, nullptr },
+	};
+
+	SortCommandListSubmitEntries(entries);
+
+	const uint32_t expected[][3] = {
+		{ 0, 5, 0 },
+		{ 1, 1, 0 },
+		{ 1, 3, 0 },
+		{ 1, 3, 1 },
+		{ 2, 0, 0 },
+	};
+
+	ASSERT_EQ(entries.size(), 5u);
+	for (auto i = 0u; i < entries.size(); ++i)
+	{
+		EXPECT_EQ(entries[i].Order, expected[i][0]) << "entry " << i;
+		EXPECT_EQ(entries[i].Thread, expected[i][1]) << "entry " << i;
+		EXPECT_EQ(entries[i].Sequence, expected[i][2]) << "entry " << i;
+	}
+}
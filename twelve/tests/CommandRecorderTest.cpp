@@ -0,0 +1,194 @@
+﻿#include <gtest/gtest.h>
+
+#include "CommandRecorder.h"
+
+namespace
+{
+	/// <summary>
+	/// 呼び出しを数えるだけのコマンドリスト
+	/// </summary>
+	struct CountingCommandList
+	{
+		uint32_t	Calls[COMMAND_STATE_COUNT] = {};
+		uint32_t	DrawCount = 0;
+		uint32_t	LastConstants[4] = {};
+
+		void SetGraphicsRootSignature(ID3D12RootSignature*) { Calls[COMMAND_STATE_ROOT_SIGNATURE]++; }
+		void SetPipelineState(ID3D12PipelineState*) { Calls[COMMAND_STATE_PIPELINE]++; }
+		void SetGraphicsRootDescriptorTable(UINT, D3D12_GPU_DESCRIPTOR_HANDLE) { Calls[COMMAND_STATE_ROOT_PARAMETER]++; }
+		void SetGraphicsRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) { Calls[COMMAND_STATE_ROOT_PARAMETER]++; }
+		void SetGraphicsRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) { Calls[COMMAND_STATE_ROOT_PARAMETER]++; }
+		void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY) { Calls[COMMAND_STATE_TOPOLOGY]++; }
+		void IASetVertexBuffers(UINT, UINT, const D3D12_VERTEX_BUFFER_VIEW*) { Calls[COMMAND_STATE_VERTEX_BUFFER]++; }
+		void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW*) { Calls[COMMAND_STATE_INDEX_BUFFER]++; }
+		void RSSetViewports(UINT, const D3D12_VIEWPORT*) { Calls[COMMAND_STATE_VIEWPORT]++; }
+		void RSSetScissorRects(UINT, const D3D12_RECT*) { Calls[COMMAND_STATE_SCISSOR]++; }
+		void OMSetRenderTargets(UINT, const D3D12_CPU_DESCRIPTOR_HANDLE*, BOOL, const D3D12_CPU_DESCRIPTOR_HANDLE*) { Calls[COMMAND_STATE_RENDER_TARGET]++; }
+		void SetDescriptorHeaps(UINT, ID3D12DescriptorHeap* const*) { Calls[COMMAND_STATE_DESCRIPTOR_HEAP]++; }
+		void DrawInstanced(UINT, UINT, UINT, UINT) { DrawCount++; }
+		void DrawIndexedInstanced(UINT, UINT, UINT, INT, UINT) { DrawCount++; }
+
+		void SetGraphicsRoot32BitConstants(UINT, UINT count, const void* pData, UINT offset)
+		{
+			Calls[COMMAND_STATE_ROOT_PARAMETER]++;
+			memcpy(LastConstants + offset, pData, sizeof(uint32_t) * count);
+		}
+	};
+
+	using TestRecorder = BasicCommandRecorder<CountingCommandList>;
+
+	template<typename T>
+	T* FakePointer(uintptr_t value)
+	{
+		return reinterpret_cast<T*>(value);
+	}
+
+	const D3D12_VERTEX_BUFFER_VIEW MeshA[2] = { { 0x10000, 1024, 44 }, { 0x20000, 64, 64 } };
+	const D3D12_VERTEX_BUFFER_VIEW MeshB[2] = { { 0x30000, 2048, 44 }, { 0x20000, 64, 64 } };
+	const D3D12_INDEX_BUFFER_VIEW IndexA = { 0x40000, 256, DXGI_FORMAT_R32_UINT };
+	const D3D12_INDEX_BUFFER_VIEW IndexB = { 0x50000, 512, DXGI_FORMAT_R32_UINT };
+}
+
+TEST(CommandRecorder, FiltersRepeatedState)
+{
+	CountingCommandList list;
+	TestRecorder recorder(&list);
+
+	auto pRootSignature = FakePointer<ID3D12RootSignature>(0x100);
+	auto pHeap = FakePointer<ID3D12DescriptorHeap>(0x500);
+
+	D3D12_VIEWPORT viewport = { 0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 1.0f };
+	D3D12_RECT scissor = { 0, 0, 1280, 720 };
+	D3D12_CPU_DESCRIPTOR_HANDLE rtv = { 0x1000 };
+	D3D12_CPU_DESCRIPTOR_HANDLE dsv = { 0x2000 };
+
+	// 同じ状態を2回設定すると2回目は省略される
+	for (auto i = 0; i < 2; ++i)
+	{
+		recorder.SetDescriptorHeaps(1, &pHeap);
+		recorder.OMSetRenderTargets(1, &rtv, FALSE, &dsv);
+		recorder.RSSetViewports(1, &viewport);
+		recorder.RSSetScissorRects(1, &scissor);
+		recorder.SetGraphicsRootSignature(pRootSignature);
+		recorder.SetGraphicsRootDescriptorTable(0, D3D12_GPU_DESCRIPTOR_HANDLE{ 0x10 });
+		recorder.SetGraphicsRootShaderResourceView(1, 0x8000);
+	}
+
+	EXPECT_EQ(list.Calls[COMMAND_STATE_DESCRIPTOR_HEAP], 1u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_RENDER_TARGET], 1u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_VIEWPORT], 1u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_SCISSOR], 1u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_ROOT_SIGNATURE], 1u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_ROOT_PARAMETER], 2u);
+
+	// 値が変わると発行される
+	D3D12_RECT tile = { 0, 0, 256, 256 };
+	recorder.RSSetScissorRects(1, &tile);
+	recorder.OMSetRenderTargets(0, nullptr, FALSE, &dsv);
+	recorder.SetGraphicsRootShaderResourceView(1, 0x9000);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_SCISSOR], 2u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_RENDER_TARGET], 2u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_ROOT_PARAMETER], 3u);
+
+	// 統計値は発行数とコマンドリストの呼び出し数が一致する
+	const auto& stats = recorder.GetStats();
+	for (auto i = 0; i < COMMAND_STATE_COUNT; ++i)
+	{
+		EXPECT_EQ(stats.Issued[i], list.Calls[i]) << "state " << i;
+	}
+	EXPECT_GT(stats.GetFilteredCount(), 0u);
+}
+
+TEST(CommandRecorder, RootSignatureChangeResetsRootParameters)
+{
+	CountingCommandList list;
+	TestRecorder recorder(&list);
+
+	recorder.SetGraphicsRootSignature(FakePointer<ID3D12RootSignature>(0x100));
+	recorder.SetGraphicsRootDescriptorTable(0, D3D12_GPU_DESCRIPTOR_HANDLE{ 0x10 });
+	recorder.SetGraphicsRootSignature(FakePointer<ID3D12RootSignature>(0x200));
+	recorder.SetGraphicsRootDescriptorTable(0, D3D12_GPU_DESCRIPTOR_HANDLE{ 0x10 });
+
+	EXPECT_EQ(list.Calls[COMMAND_STATE_ROOT_PARAMETER], 2u);
+}
+
+TEST(CommandRecorder, MeshDrawsSkipUnchangedState)
+{
+	CountingCommandList list;
+	TestRecorder recorder(&list);
+
+	auto pPipelineA = FakePointer<ID3D12PipelineState>(0x300);
+	auto pPipelineB = FakePointer<ID3D12PipelineState>(0x400);
+
+	struct DrawItem
+	{
+		ID3D12PipelineState*			pPipeline;
+		const D3D12_VERTEX_BUFFER_VIEW*	pVertexBuffers;
+		const D3D12_INDEX_BUFFER_VIEW*	pIndexBuffer;
+		uint32_t						Constants[2];
+	};
+
+	const DrawItem items[] = {
+		{ pPipelineA, MeshA, &IndexA, { 0, 1 } },
+		{ pPipelineA, MeshA, &IndexA, { 0, 1 } },	// 全て同じ
+		{ pPipelineA, MeshB, &IndexB, { 1, 1 } },	// メッシュのみ変化
+		{ pPipelineB, MeshB, &IndexB, { 1, 2 } },	// パイプラインとマテリアルが変化
+	};
+
+	for (const auto& item : items)
+	{
+		recorder.SetPipelineState(item.pPipeline);
+		recorder.SetGraphicsRoot32BitConstants(10, 2, item.Constants, 0);
+		recorder.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		recorder.IASetVertexBuffers(0, 2, item.pVertexBuffers);
+		recorder.IASetIndexBuffer(item.pIndexBuffer);
+		recorder.DrawIndexedInstanced(36, 1, 0, 0, 0);
+	}
+
+	EXPECT_EQ(list.Calls[COMMAND_STATE_PIPELINE], 2u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_ROOT_PARAMETER], 3u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_TOPOLOGY], 1u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_VERTEX_BUFFER], 2u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_INDEX_BUFFER], 2u);
+	EXPECT_EQ(list.DrawCount, 4u);
+	EXPECT_EQ(recorder.GetStats().DrawCount, 4u);
+	EXPECT_EQ(list.LastConstants[0], 1u);
+	EXPECT_EQ(list.LastConstants[1], 2u);
+
+	// ルート定数の一部を書き換えた後は, 前回と異なる範囲の設定を省略しない
+	const uint32_t drawId = 7;
+	recorder.SetGraphicsRoot32BitConstants(10, 1, &drawId, 0);
+	recorder.SetGraphicsRoot32BitConstants(10, 2, items[3].Constants, 0);
+	EXPECT_EQ(list.LastConstants[0], 1u);
+	EXPECT_EQ(list.LastConstants[1], 2u);
+}
+
+TEST(CommandRecorder, InvalidateReissuesEverything)
+{
+	CountingCommandList list;
+	TestRecorder recorder(&list);
+
+	auto pPipeline = FakePointer<ID3D12PipelineState>(0x300);
+	const uint32_t constants[2] = { 3, 4 };
+
+	recorder.SetPipelineState(pPipeline);
+	recorder.SetGraphicsRoot32BitConstants(10, 2, constants, 0);
+	recorder.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	recorder.IASetVertexBuffers(0, 2, MeshA);
+	recorder.IASetIndexBuffer(&IndexA);
+
+	// 間接描画のようにコマンドリストを直接変更した後は, 同じ値でも設定し直す
+	recorder.Invalidate();
+
+	recorder.SetPipelineState(pPipeline);
+	recorder.SetGraphicsRoot32BitConstants(10, 2, constants, 0);
+	recorder.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	recorder.IASetVertexBuffers(0, 2, MeshA);
+	recorder.IASetIndexBuffer(&IndexA);
+
+	EXPECT_EQ(list.Calls[COMMAND_STATE_PIPELINE], 2u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_ROOT_PARAMETER], 2u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_TOPOLOGY], 2u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_VERTEX_BUFFER], 2u);
+	EXPECT_EQ(list.Calls[COMMAND_STATE_INDEX_BUFFER], 2u);
+}
@@ -0,0 +1,104 @@
+﻿#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "CubeMapImage.h"
+
+using namespace DirectX;
+
+TEST(CubeMapImage, MipCount)
+{
+	EXPECT_EQ(CalcMipCount(1), 1u);
+	EXPECT_EQ(CalcMipCount(2), 2u);
+	EXPECT_EQ(CalcMipCount(256), 9u);
+	EXPECT_EQ(CalcMipCount(300), 9u);
+}
+
+TEST(CubeMapImage, FaceUVInvertsDirection)
+{
+	for (auto face = 0u; face < 6; ++face)
+	{
+		for (auto u : { 0.1f, 0.5f, 0.9f })
+		{
+			for (auto v : { 0.2f, 0.5f, 0.8f })
+			{
+				uint32_t resultFace = 0;
+				float resultU = 0.0f;
+				float resultV = 0.0f;
+				CalcCubeFaceUV(CalcCubeDirection(face, u, v), resultFace, resultU, resultV);
+
+				EXPECT_EQ(resultFace, face);
+				EXPECT_NEAR(resultU, u, 1e-5f) << "face " << face;
+				EXPECT_NEAR(resultV, v, 1e-5f) << "face " << face;
+			}
+		}
+	}
+}
+
+TEST(CubeMapImage, BilinearWrapsOnlyWhenRequested)
+{
+	CpuImage image;
+	image.Resize(2, 1);
+	image.Pixels[0] = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	image.Pixels[1] = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+
+	// 左端の外側はラップすると右端と補間する
+	EXPECT_NEAR(XMVectorGetX(SampleBilinear(image, 0.0f, 0.5f, true)), 0.5f, 1e-6f);
+	EXPECT_NEAR(XMVectorGetX(SampleBilinear(image, 0.0f, 0.5f, false)), 0.0f, 1e-6f);
+	EXPECT_NEAR(XMVectorGetX(SampleBilinear(image, 0.5f, 0.5f, false)), 0.5f, 1e-6f);
+}
+
+TEST(CubeMapImage, MipsAverageTexels)
+{
+	CpuCubeMap cube;
+	cube.Resize(4, CalcMipCount(4));
+
+	for (auto face = 0u; face < 6; ++face)
+	{
+		auto& image = cube.GetImage(face, 0);
+		for (auto i = 0u; i < image.Pixels.size(); ++i)
+		{
+			auto value = float(i + face);
+			image.Pixels[i] = XMFLOAT4(value, value, value, 1.0f);
+		}
+	}
+
+	GenerateCubeMips(cube);
+
+	for (auto face = 0u; face < 6; ++face)
+	{
+		// 最小ミップは面全体の平均
+		const auto& last = cube.GetImage(face, cube.MipCount - 1);
+		ASSERT_EQ(last.Width, 1u);
+		EXPECT_NEAR(last.Pixels[0].x, 7.5f + float(face), 1e-5f);
+
+		const auto& mip1 = cube.GetImage(face, 1);
+		EXPECT_NEAR(mip1.Pixels[0].x, (0.0f + 1.0f + 4.0f + 5.0f) / 4.0f + float(face), 1e-5f);
+	}
+}
+
+TEST(CubeMapImage, CompareImages)
+{
+	CpuImage reference;
+	reference.Resize(4, 4);
+	for (auto& pixel : reference.Pixels)
+	{
+		pixel = XMFLOAT4(2.0f, 1.0f, 0.5f, 1.0f);
+	}
+
+	auto same = CompareImages(reference, reference);
+	EXPECT_EQ(same.RMSE, 0.0);
+	EXPECT_TRUE(std::isinf(same.PSNR));
+
+	auto target = reference;
+	target.Pixels[5].x += 0.2f;
+
+	auto error = CompareImages(reference, target);
+	EXPECT_NEAR(error.MaxError, 0.2, 1e-6);
+	EXPECT_NEAR(error.RMSE, sqrt(0.04 / 48.0), 1e-6);
+	EXPECT_NEAR(error.PSNR, 20.0 * log10(2.0 / error.RMSE), 1e-6);
+
+	CpuImage other;
+	other.Resize(2, 2);
+	EXPECT_LT(CompareImages(reference, other).RMSE, 0.0);
+}
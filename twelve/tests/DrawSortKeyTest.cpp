@@ -0,0 +1,197 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "DrawSortKey.h"
+
+namespace
+{
+	/// <summary>
+	/// 数パス, 数十のパイプライン, 千程度のマテリアルに分散したキーを作る
+	/// </summary>
+	std::vector<uint64_t> CreateSceneKeys(uint32_t count, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::vector<uint64_t> keys(count);
+		for (auto i = 0u; i < count; ++i)
+		{
+			DrawKeyFields fields;
+			fields.Pass = rng() % 3;
+			fields.Pipeline = rng() % 32;
+			fields.Material = rng() % 1024;
+			fields.Depth = rng() % (1u << DrawKeyDepthBits);
+			fields.Mesh = i;
+			keys[i] = EncodeDrawKey(fields);
+		}
+		return keys;
+	}
+
+	/// <summary>
+	/// 64ビット全体に分散したキーを作る
+	/// </summary>
+	std::vector<uint64_t> CreateRandomKeys(uint32_t count, uint32_t seed)
+	{
+		std::mt19937_64 rng(seed);
+		std::vector<uint64_t> keys(count);
+		for (auto& key : keys)
+		{
+			key = rng();
+		}
+		return keys;
+	}
+
+	void ExpectSortedLikeStdSort(const std::vector<uint64_t>& source, uint32_t threadCount)
+	{
+		auto reference = source;
+		std::sort(reference.begin(), reference.end());
+
+		std::vector<uint64_t> work;
+
+		auto serial = source;
+		RadixSortDrawKeys(serial, work);
+		EXPECT_EQ(serial, reference) << "serial, " << source.size() << " keys";
+
+		auto parallel = source;
+		RadixSortDrawKeysParallel(parallel, work, threadCount);
+		EXPECT_EQ(parallel, reference) << "parallel, " << source.size() << " keys, " << threadCount << " threads";
+	}
+}
+
+TEST(DrawSortKey, EncodeDecodeRoundTrip)
+{
+	DrawKeyFields fields;
+	fields.Pass = 5;
+	fields.Pipeline = 1000;
+	fields.Material = 40000;
+	fields.Depth = 12345;
+	fields.Mesh = 654321;
+
+	auto decoded = DecodeDrawKey(EncodeDrawKey(fields));
+	EXPECT_EQ(decoded.Pass, fields.Pass);
+	EXPECT_EQ(decoded.Pipeline, fields.Pipeline);
+	EXPECT_EQ(decoded.Material, fields.Material);
+	EXPECT_EQ(decoded.Depth, fields.Depth);
+	EXPECT_EQ(decoded.Mesh, fields.Mesh);
+}
+
+TEST(DrawSortKey, EncodeTruncatesOverflowingFields)
+{
+	// ビット数を超える部分は隣のフィールドに漏れない
+	DrawKeyFields fields;
+	fields.Material = (1u << DrawKeyMaterialBits) | 7;
+
+	auto decoded = DecodeDrawKey(EncodeDrawKey(fields));
+	EXPECT_EQ(decoded.Material, 7u);
+	EXPECT_EQ(decoded.Pipeline, 0u);
+}
+
+TEST(DrawSortKey, HigherFieldsDominateOrder)
+{
+	DrawKeyFields a;
+	a.Pass = 0;
+	a.Pipeline = (1u << DrawKeyPipelineBits) - 1;
+	a.Material = (1u << DrawKeyMaterialBits) - 1;
+	a.Depth = (1u << DrawKeyDepthBits) - 1;
+	a.Mesh = (1u << DrawKeyMeshBits) - 1;
+
+	DrawKeyFields b;
+	b.Pass = 1;
+
+	EXPECT_LT(EncodeDrawKey(a), EncodeDrawKey(b));
+
+	DrawKeyFields c = b;
+	c.Material = 1;
+	DrawKeyFields d = b;
+	d.Pipeline = 1;
+	EXPECT_LT(EncodeDrawKey(c), EncodeDrawKey(d));
+}
+
+TEST(DrawSortKey, QuantizeDepthIsMonotonic)
+{
+	const auto maxBucket = (1u << DrawKeyDepthBits) - 1;
+
+	EXPECT_EQ(QuantizeDrawDepth(0.05f, 0.1f, 100.0f, false), 0u);
+	EXPECT_EQ(QuantizeDrawDepth(200.0f, 0.1f, 100.0f, false), maxBucket);
+
+	auto prev = 0u;
+	for (auto depth = 0.1f; depth < 100.0f; depth *= 1.5f)
+	{
+		auto bucket = QuantizeDrawDepth(depth, 0.1f, 100.0f, false);
+		EXPECT_GE(bucket, prev) << "depth " << depth;
+		EXPECT_EQ(QuantizeDrawDepth(depth, 0.1f, 100.0f, true), maxBucket - bucket) << "depth " << depth;
+		prev = bucket;
+	}
+
+	// 不正なクリップ面
+	EXPECT_EQ(QuantizeDrawDepth(1.0f, 0.0f, 100.0f, false), 0u);
+	EXPECT_EQ(QuantizeDrawDepth(1.0f, 10.0f, 1.0f, false), 0u);
+}
+
+TEST(DrawSortKey, RadixSortMatchesStdSort)
+{
+	for (auto count : { 0u, 1u, 2u, 17u, 1000u, 100000u })
+	{
+		ExpectSortedLikeStdSort(CreateRandomKeys(count, count + 1), 4);
+		ExpectSortedLikeStdSort(CreateSceneKeys(count, count + 2), 4);
+	}
+}
+
+TEST(DrawSortKey, ParallelRadixSortIsThreadCountIndependent)
+{
+	auto keys = CreateSceneKeys(200000, 7);
+	for (auto threadCount : { 1u, 2u, 3u, 8u, 0u })
+	{
+		ExpectSortedLikeStdSort(keys, threadCount);
+	}
+}
+
+TEST(DrawSortKey, RadixSortHandlesTrivialPasses)
+{
+	// 上位のフィールドが全て同じ場合は該当するパスを省略する
+	std::vector<uint64_t> keys(50000);
+	std::mt19937 rng(3);
+	for (auto& key : keys)
+	{
+		DrawKeyFields fields;
+		fields.Pass = 2;
+		fields.Pipeline = 9;
+		fields.Mesh = rng() % (1u << DrawKeyMeshBits);
+		key = EncodeDrawKey(fields);
+	}
+
+	ExpectSortedLikeStdSort(keys, 4);
+}
+
+TEST(DrawSortKey, SortingReducesStateChanges)
+{
+	auto keys = CreateSceneKeys(10000, 1);
+	auto before = CountDrawStateChanges(keys.data(), keys.size());
+
+	std::sort(keys.begin(), keys.end());
+	auto after = CountDrawStateChanges(keys.data(), keys.size());
+
+	// 並べ替えた後はパスごとに1回ずつ切り替わる
+	EXPECT_EQ(after.Pass, 3u);
+	EXPECT_LE(after.Pipeline, 3u * 32);
+	EXPECT_LT(after.GetTotal(), before.GetTotal());
+}
+
+TEST(DrawSortKey, CountsStateChanges)
+{
+	DrawKeyFields a;
+	DrawKeyFields b = a;
+	b.Material = 1;
+	DrawKeyFields c = b;
+	c.Pipeline = 1;
+
+	const uint64_t keys[] = { EncodeDrawKey(a), EncodeDrawKey(a), EncodeDrawKey(b), EncodeDrawKey(c) };
+	auto changes = CountDrawStateChanges(keys, 4);
+
+	// 最初の描画は全て切り替えとして数える
+	EXPECT_EQ(changes.Pass, 1u);
+	EXPECT_EQ(changes.Pipeline, 2u);
+	EXPECT_EQ(changes.Material, 2u);
+	EXPECT_EQ(CountDrawStateChanges(keys, 0).GetTotal(), 0u);
+}
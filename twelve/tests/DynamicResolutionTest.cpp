@@ -0,0 +1,289 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Constants.h"
+#include "DynamicResolution.h"
+
+namespace
+{
+	// 予算超過とみなすGPU時間 [ms] (60Hz)
+	constexpr double FrameBudgetMilliseconds = 1000.0 / 60.0;
+
+	// シミュレートするフレーム数
+	constexpr uint32_t FrameCount = 600;
+
+	/// <summary>
+	/// 動的解像度のシミュレーション結果 (フレームごと)
+	/// </summary>
+	struct SimResult
+	{
+		std::vector<float>	Scales;		// フレームの記録に使ったスケール
+		std::vector<double>	GpuMs;		// フレームのGPU時間 [ms]
+	};
+
+	/// <summary>
+	/// フレームごとのGPUの負荷を与えて動的解像度をシミュレートする
+	/// GPU時間は 固定の時間 + 最大解像度での画素の時間 * 画素数の割合 とし, delay フレーム後に報告する (実機と同じ遅れ)
+	/// </summary>
+	SimResult Simulate(
+		const DynamicResolutionDesc& desc,
+		uint32_t delay,
+		const std::vector<double>& fixedMs,
+		const std::vector<double>& pixelMs)
+	{
+		SimResult result;
+
+		DynamicResolutionController controller;
+		if (!controller.Init(desc) || fixedMs.size() != pixelMs.size())
+		{
+			return result;
+		}
+
+		const auto count = fixedMs.size();
+		result.Scales.resize(count);
+		result.GpuMs.resize(count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			// 実機と同じく, フレームバッファを再利用する時に読み戻したGPU時間で更新してから記録する
+			if (i >= delay)
+			{
+				controller.Update(result.GpuMs[i - delay]);
+			}
+
+			// 描画範囲はピクセル単位に丸めるので, 画素の時間も丸めた画素数に比例させる
+			uint32_t width = 0;
+			uint32_t height = 0;
+			ComputeDynamicResolutionSize(controller.GetScale(), Constants::WindowWidth, Constants::WindowHeight, width, height);
+			auto area = double(width) * double(height) / (double(Constants::WindowWidth) * double(Constants::WindowHeight));
+
+			result.Scales[i] = controller.GetScale();
+			result.GpuMs[i] = fixedMs[i] + pixelMs[i] * area;
+		}
+
+		return result;
+	}
+
+	/// <summary>
+	/// シミュレーション結果の区間 [begin, end) の統計
+	/// </summary>
+	struct SimStats
+	{
+		double		MeanMs = 0.0;
+		float		MinScale = 0.0f;
+		float		MaxScale = 0.0f;
+		uint32_t	OverBudget = 0;		// 予算を超えたフレーム数
+		uint32_t	Changes = 0;		// スケールが変わった回数
+	};
+
+	SimStats ComputeStats(const SimResult& sim, size_t begin, size_t end)
+	{
+		SimStats stats;
+		end = std::min(end, sim.GpuMs.size());
+		if (begin >= end)
+		{
+			return stats;
+		}
+
+		stats.MinScale = sim.Scales[begin];
+		stats.MaxScale = sim.Scales[begin];
+
+		for (auto i = begin; i < end; ++i)
+		{
+			stats.MeanMs += sim.GpuMs[i];
+			stats.MinScale = std::min(stats.MinScale, sim.Scales[i]);
+			stats.MaxScale = std::max(stats.MaxScale, sim.Scales[i]);
+
+			if (sim.GpuMs[i] > FrameBudgetMilliseconds)
+			{
+				stats.OverBudget++;
+			}
+			if (i > begin && sim.Scales[i] != sim.Scales[i - 1])
+			{
+				stats.Changes++;
+			}
+		}
+
+		stats.MeanMs /= double(end - begin);
+
+		return stats;
+	}
+
+	/// <summary>
+	/// 区間 [begin, end) で最初に条件を満たしたフレームまでの数を求める (満たさない場合は区間の長さ)
+	/// </summary>
+	template<typename Predicate>
+	uint32_t CountFramesUntil(const SimResult& sim, size_t begin, size_t end, Predicate predicate)
+	{
+		end = std::min(end, sim.GpuMs.size());
+		for (auto i = begin; i < end; ++i)
+		{
+			if (predicate(sim.Scales[i], sim.GpuMs[i]))
+			{
+				return uint32_t(i - begin);
+			}
+		}
+
+		return uint32_t(end - begin);
+	}
+
+	/// <summary>
+	/// 負荷の列 (固定の時間と画素の時間) を作る
+	/// </summary>
+	template<typename Generator>
+	void MakeLoad(std::vector<double>& fixedMs, std::vector<double>& pixelMs, Generator generator)
+	{
+		fixedMs.resize(FrameCount);
+		pixelMs.resize(FrameCount);
+		for (auto i = 0u; i < FrameCount; ++i)
+		{
+			generator(i, fixedMs[i], pixelMs[i]);
+		}
+	}
+}
+
+TEST(DynamicResolution, HeavySceneConvergesWithoutOscillation)
+{
+	DynamicResolutionDesc desc;
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> jitter(-1.0, 1.0);
+
+	// 最大解像度では予算を超えるので, 画素数を減らして目標に収める
+	std::vector<double> fixedMs, pixelMs;
+	MakeLoad(fixedMs, pixelMs, [&](uint32_t, double& fixed, double& pixel)
+	{
+		fixed = 2.0 + 0.2 * jitter(rng);
+		pixel = 20.0 * (1.0 + 0.05 * jitter(rng));
+	});
+
+	// GPU時間の報告の遅れ (フレームバッファ数) によらず収束し, 振動しない
+	for (auto delay = 1u; delay <= Constants::MaxFrameCount; ++delay)
+	{
+		auto stats = ComputeStats(Simulate(desc, delay, fixedMs, pixelMs), FrameCount / 2, FrameCount);
+
+		EXPECT_LE(stats.MeanMs, desc.TargetMilliseconds * (1.0 + desc.DeadZone)) << "delay " << delay;
+		EXPECT_GE(stats.MeanMs, desc.TargetMilliseconds * (1.0 - 2.0 * desc.DeadZone)) << "delay " << delay;
+		EXPECT_EQ(stats.OverBudget, 0u) << "delay " << delay;
+		EXPECT_LE(stats.Changes, FrameCount / 50) << "delay " << delay;
+	}
+}
+
+TEST(DynamicResolution, LightSceneKeepsMaxScale)
+{
+	DynamicResolutionDesc desc;
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> jitter(-1.0, 1.0);
+
+	// 最大解像度でも目標に収まるので, スケールは上限のまま変えない
+	std::vector<double> fixedMs, pixelMs;
+	MakeLoad(fixedMs, pixelMs, [&](uint32_t, double& fixed, double& pixel)
+	{
+		fixed = 1.0;
+		pixel = 8.0 * (1.0 + 0.05 * jitter(rng));
+	});
+
+	auto stats = ComputeStats(Simulate(desc, Constants::MaxFrameCount, fixedMs, pixelMs), 0, FrameCount);
+
+	EXPECT_EQ(stats.MinScale, desc.MaxScale);
+}
+
+TEST(DynamicResolution, LoadSpikeSettlesAndRecovers)
+{
+	DynamicResolutionDesc desc;
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<double> jitter(-1.0, 1.0);
+
+	const auto spikeBegin = FrameCount / 3;
+	const auto spikeEnd = 2 * FrameCount / 3;
+
+	// 途中の区間だけ負荷が3倍になる
+	std::vector<double> fixedMs, pixelMs;
+	MakeLoad(fixedMs, pixelMs, [&](uint32_t i, double& fixed, double& pixel)
+	{
+		auto spike = (i >= spikeBegin && i < spikeEnd) ? 3.0 : 1.0;
+		fixed = 2.0;
+		pixel = 10.0 * spike * (1.0 + 0.05 * jitter(rng));
+	});
+
+	auto sim = Simulate(desc, Constants::MaxFrameCount, fixedMs, pixelMs);
+	auto stats = ComputeStats(sim, spikeBegin + (spikeEnd - spikeBegin) / 2, spikeEnd);
+
+	auto settleFrames = CountFramesUntil(sim, spikeBegin, spikeEnd, [](float, double ms)
+	{
+		return ms <= FrameBudgetMilliseconds;
+	});
+	auto recoverFrames = CountFramesUntil(sim, spikeEnd, FrameCount, [&desc](float scale, double)
+	{
+		return scale >= desc.MaxScale;
+	});
+
+	EXPECT_LE(settleFrames, 30u);
+	EXPECT_EQ(stats.OverBudget, 0u);
+	EXPECT_LE(recoverFrames, 120u);
+}
+
+TEST(DynamicResolution, OverloadClampsToMinScale)
+{
+	DynamicResolutionDesc desc;
+
+	// 下限まで下げても目標に収まらない
+	std::vector<double> fixedMs, pixelMs;
+	MakeLoad(fixedMs, pixelMs, [](uint32_t, double& fixed, double& pixel)
+	{
+		fixed = 4.0;
+		pixel = 60.0;
+	});
+
+	auto stats = ComputeStats(Simulate(desc, Constants::MaxFrameCount, fixedMs, pixelMs), FrameCount / 2, FrameCount);
+
+	EXPECT_EQ(stats.MinScale, desc.MinScale);
+	EXPECT_EQ(stats.MaxScale, desc.MinScale);
+}
+
+TEST(DynamicResolution, DeadZoneDoesNotKickScale)
+{
+	// 刻みを細かくして, 画素数のわずかな変化もスケールに現れるようにする
+	DynamicResolutionDesc desc;
+	desc.ScaleStep = 1.0f / 4096.0f;
+
+	DynamicResolutionController controller;
+	ASSERT_TRUE(controller.Init(desc));
+
+	// 予算超過で下げた後, 目標付近 (不感帯の内側) に入ったらスケールは変えない
+	controller.Update(desc.TargetMilliseconds * 1.3);
+	auto scale = controller.Update(desc.TargetMilliseconds * 1.2);
+	ASSERT_LT(scale, desc.MaxScale);
+
+	for (auto i = 0; i < 10; ++i)
+	{
+		auto ms = desc.TargetMilliseconds * (1.0 + ((i & 1) ? 0.5 : -0.5) * desc.DeadZone);
+		EXPECT_EQ(controller.Update(ms), scale) << "frame " << i;
+	}
+
+	// 不感帯を出た後は誤差の向きにだけ動く
+	EXPECT_LT(controller.Update(desc.TargetMilliseconds * 1.2), scale);
+}
+
+TEST(DynamicResolution, SizeIsClampedToTarget)
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	ComputeDynamicResolutionSize(1.0f, Constants::WindowWidth, Constants::WindowHeight, width, height);
+	EXPECT_EQ(width, Constants::WindowWidth);
+	EXPECT_EQ(height, Constants::WindowHeight);
+
+	ComputeDynamicResolutionSize(0.5f, Constants::WindowWidth, Constants::WindowHeight, width, height);
+	EXPECT_EQ(width, Constants::WindowWidth / 2);
+	EXPECT_EQ(height, Constants::WindowHeight / 2);
+
+	ComputeDynamicResolutionSize(0.0f, Constants::WindowWidth, Constants::WindowHeight, width, height);
+	EXPECT_EQ(width, 1u);
+	EXPECT_EQ(height, 1u);
+}
@@ -0,0 +1,272 @@
+﻿#include <gtest/gtest.h>
+
+#include "FrameGraph.h"
+#include "RandomFrameGraph.h"
+
+namespace
+{
+	FrameGraphTextureDesc MakeTextureDesc(uint64_t sizeInBytes)
+	{
+		FrameGraphTextureDesc desc;
+		desc.Width = 256;
+		desc.Height = 256;
+		desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+		desc.SizeInBytes = sizeInBytes;
+		return desc;
+	}
+
+	/// <summary>
+	/// パスの前のバリアから, 指定したリソースの状態遷移を探す
+	/// </summary>
+	const FrameGraphBarrier* FindTransition(const std::vector<FrameGraphBarrier>& barriers, FrameGraphHandle resource)
+	{
+		for (const auto& barrier : barriers)
+		{
+			if (barrier.Type == FRAME_GRAPH_BARRIER_TRANSITION && barrier.Resource == resource)
+			{
+				return &barrier;
+			}
+		}
+
+		return nullptr;
+	}
+}
+
+TEST(FrameGraph, CullsPassesWithoutOutput)
+{
+	FrameGraph graph;
+	auto backBuffer = graph.ImportResource("BackBuffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+	auto used = graph.CreateTexture("Used", MakeTextureDesc(65536));
+	auto unused = graph.CreateTexture("Unused", MakeTextureDesc(65536));
+
+	auto unusedPass = graph.AddPass("Unused", nullptr);
+	graph.Write(unusedPass, unused, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	auto scene = graph.AddPass("Scene", nullptr);
+	graph.Write(scene, used, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	auto sideEffect = graph.AddPass("SideEffect", nullptr, true);
+
+	auto present = graph.AddPass("Present", nullptr);
+	graph.Read(present, used, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(present, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	ASSERT_TRUE(graph.Compile());
+	EXPECT_TRUE(graph.Validate());
+
+	EXPECT_TRUE(graph.IsPassCulled(unusedPass));
+	EXPECT_FALSE(graph.IsPassCulled(scene));
+	EXPECT_FALSE(graph.IsPassCulled(sideEffect));
+	EXPECT_FALSE(graph.IsPassCulled(present));
+	EXPECT_EQ(graph.GetExecutionOrder(), (std::vector<uint32_t>{ scene, sideEffect, present }));
+	EXPECT_FALSE(graph.IsResourceUsed(unused));
+
+	EXPECT_EQ(graph.GetStats().CulledPassCount, 1u);
+	EXPECT_EQ(graph.GetStats().CulledResourceCount, 1u);
+}
+
+TEST(FrameGraph, CullsChainsFeedingCulledPasses)
+{
+	// 削除されたパスだけが読み込むリソースを書き込むパスも削除される
+	FrameGraph graph;
+	auto a = graph.CreateTexture("A", MakeTextureDesc(65536));
+	auto b = graph.CreateTexture("B", MakeTextureDesc(65536));
+
+	auto first = graph.AddPass("First", nullptr);
+	graph.Write(first, a, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	auto second = graph.AddPass("Second", nullptr);
+	graph.Read(second, a, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(second, b, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	ASSERT_TRUE(graph.Compile());
+	EXPECT_TRUE(graph.IsPassCulled(first));
+	EXPECT_TRUE(graph.IsPassCulled(second));
+	EXPECT_TRUE(graph.GetExecutionOrder().empty());
+}
+
+TEST(FrameGraph, InsertsTransitions)
+{
+	FrameGraph graph;
+	auto backBuffer = graph.ImportResource("BackBuffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+	auto color = graph.CreateTexture("Color", MakeTextureDesc(65536));
+
+	auto scene = graph.AddPass("Scene", nullptr);
+	graph.Write(scene, color, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	auto present = graph.AddPass("Present", nullptr);
+	graph.Read(present, color, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(present, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	ASSERT_TRUE(graph.Compile());
+	EXPECT_TRUE(graph.Validate());
+
+	auto colorBarrier = FindTransition(graph.GetBarriers(present), color);
+	ASSERT_NE(colorBarrier, nullptr);
+	EXPECT_EQ(colorBarrier->StateBefore, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	EXPECT_EQ(colorBarrier->StateAfter, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+	auto backBufferBarrier = FindTransition(graph.GetBarriers(present), backBuffer);
+	ASSERT_NE(backBufferBarrier, nullptr);
+	EXPECT_EQ(backBufferBarrier->StateBefore, D3D12_RESOURCE_STATE_PRESENT);
+	EXPECT_EQ(backBufferBarrier->StateAfter, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	// インポートしたリソースは終了時の状態に戻す
+	auto finalBarrier = FindTransition(graph.GetFinalBarriers(), backBuffer);
+	ASSERT_NE(finalBarrier, nullptr);
+	EXPECT_EQ(finalBarrier->StateBefore, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	EXPECT_EQ(finalBarrier->StateAfter, D3D12_RESOURCE_STATE_PRESENT);
+}
+
+TEST(FrameGraph, MergesConsecutiveReads)
+{
+	// 連続する読み込みは1回の遷移で両方の状態にする
+	FrameGraph graph;
+	auto output = graph.ImportResource("Output", D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	auto color = graph.CreateTexture("Color", MakeTextureDesc(65536));
+
+	auto scene = graph.AddPass("Scene", nullptr);
+	graph.Write(scene, color, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	auto pixel = graph.AddPass("Pixel", nullptr);
+	graph.Read(pixel, color, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(pixel, output, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	auto compute = graph.AddPass("Compute", nullptr);
+	graph.Read(compute, color, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	graph.Write(compute, output, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	ASSERT_TRUE(graph.Compile());
+	EXPECT_TRUE(graph.Validate());
+
+	auto barrier = FindTransition(graph.GetBarriers(pixel), color);
+	ASSERT_NE(barrier, nullptr);
+	EXPECT_EQ(barrier->StateAfter, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	EXPECT_EQ(FindTransition(graph.GetBarriers(compute), color), nullptr);
+	EXPECT_EQ(graph.GetStats().MergedReadCount, 1u);
+
+	// 同じ状態でのUAVへの連続した書き込みにはUAVバリアを挟む
+	auto uavBarrier = false;
+	for (const auto& b : graph.GetBarriers(compute))
+	{
+		uavBarrier |= (b.Type == FRAME_GRAPH_BARRIER_UAV && b.Resource == output);
+	}
+	EXPECT_TRUE(uavBarrier);
+}
+
+TEST(FrameGraph, SplitsBarrierAcrossIdlePasses)
+{
+	// 書き込みから読み込みまでの間に別のパスがある場合は分割バリアにする
+	FrameGraph graph;
+	auto backBuffer = graph.ImportResource("BackBuffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+	auto shadow = graph.CreateTexture("Shadow", MakeTextureDesc(65536));
+	auto color = graph.CreateTexture("Color", MakeTextureDesc(65536));
+
+	auto shadowPass = graph.AddPass("Shadow", nullptr);
+	graph.Write(shadowPass, shadow, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	auto other = graph.AddPass("Other", nullptr);
+	graph.Write(other, color, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	auto lighting = graph.AddPass("Lighting", nullptr);
+	graph.Read(lighting, shadow, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Read(lighting, color, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(lighting, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	ASSERT_TRUE(graph.Compile());
+	EXPECT_TRUE(graph.Validate());
+
+	auto begin = FindTransition(graph.GetBarriers(other), shadow);
+	ASSERT_NE(begin, nullptr);
+	EXPECT_EQ(begin->Flags, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY);
+
+	auto end = FindTransition(graph.GetBarriers(lighting), shadow);
+	ASSERT_NE(end, nullptr);
+	EXPECT_EQ(end->Flags, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY);
+	EXPECT_EQ(graph.GetStats().SplitBarrierCount, 1u);
+}
+
+TEST(FrameGraph, AliasesDisjointLifetimes)
+{
+	// A -> B -> C の連鎖では A と C の寿命が重ならないので同じメモリを使う
+	FrameGraph graph;
+	auto backBuffer = graph.ImportResource("BackBuffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+	auto a = graph.CreateTexture("A", MakeTextureDesc(4 * 65536));
+	auto b = graph.CreateTexture("B", MakeTextureDesc(4 * 65536));
+	auto c = graph.CreateTexture("C", MakeTextureDesc(4 * 65536));
+
+	auto passA = graph.AddPass("A", nullptr);
+	graph.Write(passA, a, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	auto passB = graph.AddPass("B", nullptr);
+	graph.Read(passB, a, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(passB, b, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	auto passC = graph.AddPass("C", nullptr);
+	graph.Read(passC, b, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(passC, c, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	auto present = graph.AddPass("Present", nullptr);
+	graph.Read(present, c, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(present, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	ASSERT_TRUE(graph.Compile());
+	EXPECT_TRUE(graph.Validate());
+
+	EXPECT_EQ(graph.GetHeapOffset(a), graph.GetHeapOffset(c));
+	EXPECT_NE(graph.GetHeapOffset(a), graph.GetHeapOffset(b));
+	EXPECT_EQ(graph.GetStats().HeapSize, 8u * 65536);
+	EXPECT_EQ(graph.GetStats().UnaliasedSize, 12u * 65536);
+
+	// C はメモリを引き継ぐので, 最初に使うパスの前にエイリアシングバリアがある
+	auto aliasing = false;
+	for (const auto& barrier : graph.GetBarriers(passC))
+	{
+		if (barrier.Type == FRAME_GRAPH_BARRIER_ALIASING && barrier.Resource == c)
+		{
+			aliasing = true;
+			EXPECT_EQ(barrier.AliasBefore, a);
+		}
+	}
+	EXPECT_TRUE(aliasing);
+}
+
+TEST(FrameGraph, RejectsReadBeforeWrite)
+{
+	FrameGraph graph;
+	auto backBuffer = graph.ImportResource("BackBuffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+	auto color = graph.CreateTexture("Color", MakeTextureDesc(65536));
+
+	auto present = graph.AddPass("Present", nullptr);
+	graph.Read(present, color, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(present, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	EXPECT_FALSE(graph.Compile());
+	EXPECT_FALSE(graph.IsCompiled());
+}
+
+TEST(FrameGraph, RejectsWriteStateForRead)
+{
+	FrameGraph graph;
+	auto backBuffer = graph.ImportResource("BackBuffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+	auto pass = graph.AddPass("Pass", nullptr);
+	graph.Read(pass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	EXPECT_FALSE(graph.Compile());
+}
+
+TEST(FrameGraph, RandomGraphsValidate)
+{
+	FrameGraph graph;
+	for (auto seed = 1u; seed <= 8; ++seed)
+	{
+		BuildRandomFrameGraph(graph, 200, seed);
+		ASSERT_TRUE(graph.Compile()) << "seed " << seed;
+		EXPECT_TRUE(graph.Validate()) << "seed " << seed;
+
+		// エイリアシングでヒープは小さくなる
+		const auto& stats = graph.GetStats();
+		EXPECT_LT(stats.HeapSize, stats.UnaliasedSize) << "seed " << seed;
+	}
+}
@@ -0,0 +1,265 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "FramePacer.h"
+
+namespace
+{
+	// 自動で許容するスループットの低下 (FramePacer.cpp の MaxSerialThroughputLoss と同じ値)
+	constexpr double MaxSerialThroughputLoss = 0.1;
+
+	const uint32_t SimulationFrames = 600;
+
+	/// <summary>
+	/// フレームペーシングのシミュレーション結果
+	/// </summary>
+	struct FramePacingSimResult
+	{
+		double		FrameMs = 0.0;			// GPUの完了間隔の平均 [ms]
+		double		LatencyMs = 0.0;		// 記録開始からGPUの完了までの平均 [ms]
+		double		CpuWaitMs = 0.0;		// CPUが待機した合計 [ms]
+		double		GpuIdleMs = 0.0;		// GPUが提出を待った合計 [ms]
+		uint32_t	FinalLatency = 0;		// 最後のフレームでのレイテンシ
+		uint32_t	SlotViolations = 0;		// 完了前のフレームバッファを再利用した数 (0でなければならない)
+	};
+
+	/// <summary>
+	/// フレームごとのCPU/GPU時間を与えてペーシングをシミュレートする
+	/// GPUは提出順に1フレームずつ処理し, GPU時間はフレームバッファを再利用する時に報告する (実機と同じ遅れ)
+	/// </summary>
+	FramePacingSimResult SimulateFramePacing(
+		FramePacingMode mode,
+		uint32_t frameCount,
+		const std::vector<double>& cpuMs,
+		const std::vector<double>& gpuMs)
+	{
+		FramePacingSimResult result;
+
+		FramePacer pacer;
+		if (!pacer.Init(frameCount, mode) || cpuMs.size() != gpuMs.size() || cpuMs.empty())
+		{
+			return result;
+		}
+
+		const auto count = cpuMs.size();
+		const auto measureBegin = count / 2;	// 後半のフレームで集計する
+
+		std::vector<double> gpuEnd(count, 0.0);
+
+		double cpuTime = 0.0;
+		double gpuFree = 0.0;
+		double latencySum = 0.0;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto start = cpuTime;
+
+			// フェンス値はフレーム番号 + 1
+			auto waitValue = pacer.GetWaitValue();
+			if (waitValue > 0)
+			{
+				auto done = gpuEnd[size_t(waitValue - 1)];
+				if (done > start)
+				{
+					if (i >= measureBegin)
+					{
+						result.CpuWaitMs += done - start;
+					}
+					start = done;
+				}
+			}
+
+			// 同じフレームバッファを前回使ったフレームは完了していなければならない
+			if (i >= frameCount)
+			{
+				if (gpuEnd[i - frameCount] > start)
+				{
+					result.SlotViolations++;
+				}
+
+				// 実機と同じく, 再利用する時に読み戻したGPU時間を報告する
+				pacer.ReportGpuTime(gpuMs[i - frameCount]);
+			}
+
+			auto submit = start + cpuMs[i];
+			if (submit > gpuFree && i > 0 && i >= measureBegin)
+			{
+				result.GpuIdleMs += submit - gpuFree;
+			}
+
+			gpuEnd[i] = std::max(submit, gpuFree) + gpuMs[i];
+			gpuFree = gpuEnd[i];
+
+			pacer.Submit(uint64_t(i) + 1, cpuMs[i]);
+			cpuTime = submit;
+
+			if (i >= measureBegin)
+			{
+				latencySum += gpuEnd[i] - start;
+			}
+		}
+
+		auto measured = count - measureBegin;
+		if (measured > 1)
+		{
+			result.FrameMs = (gpuEnd[count - 1] - gpuEnd[measureBegin]) / double(measured - 1);
+		}
+		result.LatencyMs = latencySum / double(measured);
+		result.FinalLatency = pacer.GetLatency();
+
+		return result;
+	}
+
+	/// <summary>
+	/// シミュレーションの状況
+	/// </summary>
+	struct Scenario
+	{
+		const char*			Name;
+		std::vector<double>	Cpu;
+		std::vector<double>	Gpu;
+	};
+
+	enum SCENARIO
+	{
+		SCENARIO_GPU_BOUND = 0,		// CPUが軽い場合は直列化しても周期はほとんど変わらない
+		SCENARIO_BALANCED_JITTER,	// CPUの揺らぎが大きい場合は先行させないとGPUが待つ
+		SCENARIO_CPU_BOUND,
+
+		SCENARIO_COUNT
+	};
+
+	const std::vector<Scenario>& GetScenarios()
+	{
+		static std::vector<Scenario> scenarios;
+		if (scenarios.empty())
+		{
+			scenarios.resize(SCENARIO_COUNT);
+			scenarios[SCENARIO_GPU_BOUND].Name = "GpuBound";
+			scenarios[SCENARIO_BALANCED_JITTER].Name = "BalancedJitter";
+			scenarios[SCENARIO_CPU_BOUND].Name = "CpuBound";
+
+			std::mt19937 rng(1);
+			std::uniform_real_distribution<double> jitter(-1.0, 1.0);
+
+			for (auto i = 0u; i < SimulationFrames; ++i)
+			{
+				scenarios[SCENARIO_GPU_BOUND].Cpu.push_back(1.0);
+				scenarios[SCENARIO_GPU_BOUND].Gpu.push_back(16.0);
+
+				scenarios[SCENARIO_BALANCED_JITTER].Cpu.push_back(10.0 + 4.0 * jitter(rng));
+				scenarios[SCENARIO_BALANCED_JITTER].Gpu.push_back(12.0 + 1.0 * jitter(rng));
+
+				scenarios[SCENARIO_CPU_BOUND].Cpu.push_back(16.0);
+				scenarios[SCENARIO_CPU_BOUND].Gpu.push_back(4.0);
+			}
+		}
+
+		return scenarios;
+	}
+
+	/// <summary>
+	/// 3フレームバッファで全ての方針をシミュレートする
+	/// </summary>
+	class FramePacingScenario : public ::testing::TestWithParam<SCENARIO>
+	{
+	protected:
+		void SetUp() override
+		{
+			const auto& scenario = GetScenarios()[GetParam()];
+			for (auto mode = 0; mode < FRAME_PACING_COUNT; ++mode)
+			{
+				m_Sims[mode] = SimulateFramePacing(FramePacingMode(mode), 3, scenario.Cpu, scenario.Gpu);
+			}
+		}
+
+		FramePacingSimResult m_Sims[FRAME_PACING_COUNT];
+	};
+
+	std::string GetScenarioName(const ::testing::TestParamInfo<SCENARIO>& info)
+	{
+		return GetScenarios()[info.param].Name;
+	}
+}
+
+TEST(FramePacer, NeverReusesBusyFrameBuffer)
+{
+	// どの方針, フレームバッファ数でも完了前のフレームバッファを再利用しない
+	for (auto frameCount = Constants::MinFrameCount; frameCount <= Constants::MaxFrameCount; ++frameCount)
+	{
+		for (const auto& scenario : GetScenarios())
+		{
+			for (auto mode = 0; mode < FRAME_PACING_COUNT; ++mode)
+			{
+				auto sim = SimulateFramePacing(FramePacingMode(mode), frameCount, scenario.Cpu, scenario.Gpu);
+				EXPECT_EQ(sim.SlotViolations, 0u) << scenario.Name << ", mode " << mode << ", frameCount " << frameCount;
+			}
+		}
+	}
+}
+
+TEST(FramePacer, LatencyStaysWithinFrameCount)
+{
+	EXPECT_EQ(ComputeFramePacingLatency(3, 1.0, 0.0, 16.0, 0.0), 1u);
+	EXPECT_GE(ComputeFramePacingLatency(3, 10.0, 3.0, 12.0, 1.0), 2u);
+	EXPECT_LE(ComputeFramePacingLatency(2, 30.0, 10.0, 30.0, 10.0), 2u);
+	EXPECT_LE(ComputeFramePacingLatency(4, 30.0, 10.0, 30.0, 10.0), 4u);
+}
+
+TEST_P(FramePacingScenario, FixedModesBoundLatencyAndThroughput)
+{
+	// 固定の方針は遅延とスループットの両端になる
+	const auto& latency = m_Sims[FRAME_PACING_LATENCY];
+	const auto& throughput = m_Sims[FRAME_PACING_THROUGHPUT];
+
+	EXPECT_LE(latency.LatencyMs, throughput.LatencyMs + 1e-6);
+	EXPECT_LE(throughput.FrameMs, latency.FrameMs + 1e-6);
+}
+
+TEST_P(FramePacingScenario, AutoKeepsThroughputWithLowerLatency)
+{
+	// 自動はスループットをほぼ保ったまま, 遅延は先行させる場合以下になる
+	const auto& throughput = m_Sims[FRAME_PACING_THROUGHPUT];
+	const auto& automatic = m_Sims[FRAME_PACING_AUTO];
+
+	EXPECT_LE(automatic.FrameMs, throughput.FrameMs * (1.0 + MaxSerialThroughputLoss));
+	EXPECT_LE(automatic.LatencyMs, throughput.LatencyMs + 1e-6);
+}
+
+INSTANTIATE_TEST_SUITE_P(FramePacer, FramePacingScenario,
+	::testing::Values(SCENARIO_GPU_BOUND, SCENARIO_BALANCED_JITTER, SCENARIO_CPU_BOUND),
+	GetScenarioName);
+
+TEST(FramePacer, AutoSerializesWhenGpuBound)
+{
+	// GPU律速でCPUが軽い場合は直列化を選び, 遅延を大きく減らす
+	const auto& scenario = GetScenarios()[SCENARIO_GPU_BOUND];
+	auto automatic = SimulateFramePacing(FRAME_PACING_AUTO, 3, scenario.Cpu, scenario.Gpu);
+	auto throughput = SimulateFramePacing(FRAME_PACING_THROUGHPUT, 3, scenario.Cpu, scenario.Gpu);
+
+	EXPECT_EQ(automatic.FinalLatency, 1u);
+	EXPECT_LE(automatic.LatencyMs, throughput.LatencyMs * 0.5);
+}
+
+TEST(FramePacer, AutoRunsAheadWithJitter)
+{
+	// 揺らぎがある場合は先行させてスループットを保つ
+	const auto& scenario = GetScenarios()[SCENARIO_BALANCED_JITTER];
+	auto automatic = SimulateFramePacing(FRAME_PACING_AUTO, 3, scenario.Cpu, scenario.Gpu);
+
+	EXPECT_GE(automatic.FinalLatency, 2u);
+}
+
+TEST(FramePacer, CpuBoundNeverWaits)
+{
+	// CPU律速ではフレームバッファに空きがある限り待たない
+	const auto& scenario = GetScenarios()[SCENARIO_CPU_BOUND];
+	auto automatic = SimulateFramePacing(FRAME_PACING_AUTO, 3, scenario.Cpu, scenario.Gpu);
+	auto throughput = SimulateFramePacing(FRAME_PACING_THROUGHPUT, 3, scenario.Cpu, scenario.Gpu);
+
+	EXPECT_EQ(throughput.CpuWaitMs, 0.0);
+	EXPECT_EQ(automatic.CpuWaitMs, 0.0);
+}
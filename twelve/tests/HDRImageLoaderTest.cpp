@@ -0,0 +1,200 @@
+﻿#include <gtest/gtest.h>
+
+#include <DirectXPackedVector.h>
+#include <string>
+#include <vector>
+
+#include "HDRImageLoader.h"
+
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	/// <summary>
+	/// 走査線ごとに値が変わるRGBEのピクセルを求める
+	/// </summary>
+	void GetTestPixel(uint32_t x, uint32_t y, uint8_t rgbe[4])
+	{
+		rgbe[0] = uint8_t(64 + x);
+		rgbe[1] = uint8_t(128 + y);
+		rgbe[2] = uint8_t(200 - x);
+		rgbe[3] = uint8_t(128 + (x & 3));
+	}
+
+	/// <summary>
+	/// Radiance HDR のファイルの内容を作る
+	/// </summary>
+	/// <param name="rle">新形式のランレングス圧縮で書き込む場合はtrue</param>
+	/// <param name="bottomUp">下から上への走査線の順 (+Y) で書き込む場合はtrue</param>
+	std::vector<uint8_t> CreateRGBE(uint32_t width, uint32_t height, bool rle, bool bottomUp)
+	{
+		std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n";
+		header += (bottomUp ? "+Y " : "-Y ") + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+
+		std::vector<uint8_t> data(header.begin(), header.end());
+		for (auto row = 0u; row < height; ++row)
+		{
+			// 画像の上から下の順に並べた場合の行
+			auto y = bottomUp ? (height - 1 - row) : row;
+
+			if (!rle)
+			{
+				for (auto x = 0u; x < width; ++x)
+				{
+					uint8_t rgbe[4];
+					GetTestPixel(x, y, rgbe);
+					data.insert(data.end(), rgbe, rgbe + 4);
+				}
+				continue;
+			}
+
+			data.push_back(2);
+			data.push_back(2);
+			data.push_back(uint8_t(width >> 8));
+			data.push_back(uint8_t(width & 0xff));
+
+			// 緑 (走査線内で一定) はラン, それ以外は非連続の値として書き込む
+			for (auto c = 0u; c < 4; ++c)
+			{
+				uint8_t first[4];
+				GetTestPixel(0, y, first);
+
+				if (c == 1)
+				{
+					for (auto x = 0u; x < width; x += 127)
+					{
+						auto count = std::min(127u, width - x);
+						data.push_back(uint8_t(128 + count));
+						data.push_back(first[c]);
+					}
+					continue;
+				}
+
+				for (auto x = 0u; x < width; x += 128)
+				{
+					auto count = std::min(128u, width - x);
+					data.push_back(uint8_t(count));
+					for (auto i = 0u; i < count; ++i)
+					{
+						uint8_t rgbe[4];
+						GetTestPixel(x + i, y, rgbe);
+						data.push_back(rgbe[c]);
+					}
+				}
+			}
+		}
+
+		return data;
+	}
+
+	/// <summary>
+	/// ピクセルが GetTestPixel() の値を復号したものと一致することを確かめる
+	/// </summary>
+	void ExpectTestPixels(const CpuImageHalf& image, uint32_t width, uint32_t height)
+	{
+		ASSERT_EQ(image.Width, width);
+		ASSERT_EQ(image.Height, height);
+
+		for (auto y = 0u; y < height; ++y)
+		{
+			auto pRow = image.GetRow(y);
+			for (auto x = 0u; x < width; ++x)
+			{
+				uint8_t rgbe[4];
+				GetTestPixel(x, y, rgbe);
+
+				auto scale = std::ldexp(1.0f, int(rgbe[3]) - 136);
+				for (auto c = 0; c < 3; ++c)
+				{
+					auto expected = (float(rgbe[c]) + 0.5f) * scale;
+					EXPECT_NEAR(XMConvertHalfToFloat(pRow[x * 4 + c]), expected, expected * 1e-3f) << "x " << x << ", y " << y << ", c " << c;
+				}
+				EXPECT_EQ(XMConvertHalfToFloat(pRow[x * 4 + 3]), 1.0f);
+			}
+		}
+	}
+}
+
+TEST(HDRImageLoader, DecodesFlatScanlines)
+{
+	auto data = CreateRGBE(5, 3, false, false);
+
+	CpuImageHalf image;
+	ASSERT_TRUE(DecodeRGBE(data.data(), data.size(), image, 1));
+	ExpectTestPixels(image, 5, 3);
+}
+
+TEST(HDRImageLoader, DecodesRunLengthScanlines)
+{
+	auto data = CreateRGBE(300, 4, true, false);
+	auto flat = CreateRGBE(300, 4, false, false);
+	ASSERT_LT(data.size(), flat.size());
+
+	CpuImageHalf image;
+	ASSERT_TRUE(DecodeRGBE(data.data(), data.size(), image, 1));
+	ExpectTestPixels(image, 300, 4);
+
+	CpuImageHalf flatImage;
+	ASSERT_TRUE(DecodeRGBE(flat.data(), flat.size(), flatImage, 1));
+	EXPECT_EQ(image.Pixels, flatImage.Pixels);
+}
+
+TEST(HDRImageLoader, FlipsBottomUpImages)
+{
+	auto data = CreateRGBE(16, 7, false, true);
+
+	CpuImageHalf image;
+	ASSERT_TRUE(DecodeRGBE(data.data(), data.size(), image, 1));
+	ExpectTestPixels(image, 16, 7);
+}
+
+TEST(HDRImageLoader, ParallelDecodeMatchesSingleThread)
+{
+	auto data = CreateRGBE(257, 64, true, false);
+
+	CpuImageHalf single;
+	ASSERT_TRUE(DecodeRGBE(data.data(), data.size(), single, 1));
+
+	for (auto threadCount : { 2u, 4u, 0u })
+	{
+		CpuImageHalf multi;
+		ASSERT_TRUE(DecodeRGBE(data.data(), data.size(), multi, threadCount));
+		EXPECT_EQ(multi.Pixels, single.Pixels) << threadCount << " threads";
+	}
+}
+
+TEST(HDRImageLoader, RejectsInvalidRGBE)
+{
+	CpuImageHalf image;
+
+	std::string signature = "P6\n1 1\n255\n";
+	EXPECT_FALSE(DecodeRGBE(reinterpret_cast<const uint8_t*>(signature.data()), signature.size(), image, 1));
+
+	std::string format = "#?RADIANCE\nFORMAT=32-bit_rle_xyze\n\n-Y 1 +X 1\n";
+	EXPECT_FALSE(DecodeRGBE(reinterpret_cast<const uint8_t*>(format.data()), format.size(), image, 1));
+
+	// 走査線が途中で終わる
+	auto truncated = CreateRGBE(64, 8, true, false);
+	truncated.resize(truncated.size() - 10);
+	EXPECT_FALSE(DecodeRGBE(truncated.data(), truncated.size(), image, 1));
+
+	EXPECT_FALSE(DecodeRGBE(nullptr, 0, image, 1));
+}
+
+TEST(HDRImageLoader, RejectsInvalidEXR)
+{
+	CpuImageHalf image;
+
+	const uint8_t garbage[] = { 0x76, 0x2f, 0x31, 0x01, 0x02, 0x00, 0x00, 0x00, 0xff };
+	EXPECT_FALSE(DecodeEXR(garbage, sizeof(garbage), image, 1));
+	EXPECT_FALSE(DecodeEXR(garbage, 3, image, 1));
+}
+
+TEST(HDRImageLoader, DetectsExtensions)
+{
+	EXPECT_TRUE(IsHDRImageFile(L"Assets/sky.hdr"));
+	EXPECT_TRUE(IsHDRImageFile(L"Assets/SKY.EXR"));
+	EXPECT_FALSE(IsHDRImageFile(L"Assets/sky.png"));
+	EXPECT_FALSE(IsHDRImageFile(L"hdr"));
+	EXPECT_FALSE(IsHDRImageFile(nullptr));
+}
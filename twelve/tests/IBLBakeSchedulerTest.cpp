@@ -0,0 +1,254 @@
+﻿#include <gtest/gtest.h>
+
+#include "IBLBakeScheduler.h"
+
+namespace
+{
+	/// <summary>
+	/// テストから時刻を進める時計
+	/// </summary>
+	class FakeClock : public IBLBakeScheduler::Clock
+	{
+	public:
+		double GetMilliseconds() const override
+		{
+			return Now;
+		}
+
+		double Now = 0.0;
+	};
+
+	const uint32_t MipCount = 5;
+	const uint32_t ItemCount = 6 + 6 * MipCount;
+
+	/// <summary>
+	/// 全ての処理単位に同じ実測コストを通知する
+	/// </summary>
+	void ReportAllCosts(IBLBakeScheduler& scheduler, double milliseconds)
+	{
+		scheduler.ReportCost({ true, 0, 0 }, milliseconds);
+		for (auto mip = 0u; mip < MipCount; ++mip)
+		{
+			scheduler.ReportCost({ false, 0, mip }, milliseconds);
+		}
+	}
+
+	/// <summary>
+	/// 1フレーム分を処理する. 処理単位はGPUで非同期に実行されるため, 払い出しの間は時計を進めない
+	/// </summary>
+	/// <param name="elapsed">払い出しを始めるまでにフレーム内で経過した時間</param>
+	/// <returns>今フレームで払い出された処理単位の数</returns>
+	uint32_t RunFrame(IBLBakeScheduler& scheduler, FakeClock& clock, double elapsed, bool& completed)
+	{
+		scheduler.BeginFrame();
+		clock.Now += elapsed;
+
+		auto count = 0u;
+		IBLBakeScheduler::WorkItem item;
+		while (scheduler.Acquire(item))
+		{
+			count++;
+		}
+
+		completed = scheduler.EndFrame();
+		return count;
+	}
+}
+
+TEST(IBLBakeScheduler, RejectsInvalidArguments)
+{
+	IBLBakeScheduler scheduler;
+	EXPECT_FALSE(scheduler.Init(0, 2.0, 4));
+	EXPECT_FALSE(scheduler.Init(MipCount, 0.0, 4));
+	EXPECT_FALSE(scheduler.Init(MipCount, 2.0, 0));
+}
+
+TEST(IBLBakeScheduler, IssuesDiffuseThenSpecularInOrder)
+{
+	FakeClock clock;
+	IBLBakeScheduler scheduler;
+	ASSERT_TRUE(scheduler.Init(MipCount, 100.0, ItemCount, &clock));
+	ASSERT_EQ(scheduler.GetItemCount(), ItemCount);
+
+	ReportAllCosts(scheduler, 0.0);
+	scheduler.Request();
+	scheduler.BeginFrame();
+
+	IBLBakeScheduler::WorkItem item;
+	for (auto face = 0u; face < 6; ++face)
+	{
+		ASSERT_TRUE(scheduler.Acquire(item));
+		EXPECT_TRUE(item.Diffuse);
+		EXPECT_EQ(item.Face, face);
+	}
+
+	for (auto face = 0u; face < 6; ++face)
+	{
+		for (auto mip = 0u; mip < MipCount; ++mip)
+		{
+			ASSERT_TRUE(scheduler.Acquire(item));
+			EXPECT_FALSE(item.Diffuse);
+			EXPECT_EQ(item.Face, face);
+			EXPECT_EQ(item.Mip, mip);
+		}
+	}
+
+	EXPECT_FALSE(scheduler.Acquire(item));
+	EXPECT_TRUE(scheduler.EndFrame());
+}
+
+TEST(IBLBakeScheduler, IdleUntilRequested)
+{
+	FakeClock clock;
+	IBLBakeScheduler scheduler;
+	ASSERT_TRUE(scheduler.Init(MipCount, 2.0, 4, &clock));
+
+	bool completed;
+	EXPECT_EQ(RunFrame(scheduler, clock, 0.0, completed), 0u);
+	EXPECT_FALSE(completed);
+	EXPECT_FALSE(scheduler.IsBaking());
+}
+
+TEST(IBLBakeScheduler, UnmeasuredCostIssuesOnePerFrame)
+{
+	// 未計測の推定コストは予算全体なので, 最低保証の1つだけが払い出される
+	FakeClock clock;
+	IBLBakeScheduler scheduler;
+	ASSERT_TRUE(scheduler.Init(MipCount, 2.0, 4, &clock));
+	scheduler.Request();
+
+	bool completed;
+	EXPECT_EQ(RunFrame(scheduler, clock, 0.0, completed), 1u);
+	EXPECT_FALSE(completed);
+}
+
+TEST(IBLBakeScheduler, StaysWithinTimeSlice)
+{
+	// 実測コスト 0.5ms, 予算 2ms なら1フレームに4つまで
+	FakeClock clock;
+	IBLBakeScheduler scheduler;
+	ASSERT_TRUE(scheduler.Init(MipCount, 2.0, 8, &clock));
+	ReportAllCosts(scheduler, 0.5);
+	scheduler.Request();
+
+	bool completed;
+	EXPECT_EQ(RunFrame(scheduler, clock, 0.0, completed), 4u);
+	EXPECT_FALSE(completed);
+}
+
+TEST(IBLBakeScheduler, ElapsedFrameTimeReducesBudget)
+{
+	// フレームの開始から時間が経っている場合は, 残りの予算に収まる分だけ払い出す
+	FakeClock clock;
+	IBLBakeScheduler scheduler;
+	ASSERT_TRUE(scheduler.Init(MipCount, 2.0, 8, &clock));
+	ReportAllCosts(scheduler, 0.25);
+	scheduler.Request();
+
+	// 1.5ms 経過後は 0.25ms の処理が2つまで収まる
+	bool completed;
+	EXPECT_EQ(RunFrame(scheduler, clock, 1.5, completed), 2u);
+}
+
+TEST(IBLBakeScheduler, OverBudgetItemStillProgresses)
+{
+	// 予算を超える処理単位でも1フレームに1つは払い出す
+	FakeClock clock;
+	IBLBakeScheduler scheduler;
+	ASSERT_TRUE(scheduler.Init(MipCount, 1.0, 4, &clock));
+	ReportAllCosts(scheduler, 3.0);
+	scheduler.Request();
+
+	bool completed = false;
+	auto frames = 0u;
+	while (!completed && frames < 2 * ItemCount)
+	{
+		EXPECT_EQ(RunFrame(scheduler, clock, 0.0, completed), 1u);
+		frames++;
+	}
+
+	EXPECT_TRUE(completed);
+	EXPECT_EQ(frames, ItemCount);
+}
+
+TEST(IBLBakeScheduler, RespectsMaxItemsPerFrame)
+{
+	FakeClock clock;
+	IBLBakeScheduler scheduler;
+	ASSERT_TRUE(scheduler.Init(MipCount, 100.0, 3, &clock));
+	ReportAllCosts(scheduler, 0.0);
+	scheduler.Request();
+
+	bool completed;
+	EXPECT_EQ(RunFrame(scheduler, clock, 0.0, completed), 3u);
+}
+
+TEST(IBLBakeScheduler, CompletesAllItems)
+{
+	FakeClock clock;
+	IBLBakeScheduler scheduler;
+	ASSERT_TRUE(scheduler.Init(MipCount, 2.0, 8, &clock));
+	ReportAllCosts(scheduler, 0.5);
+	scheduler.Request();
+
+	auto issued = 0u;
+	auto completions = 0u;
+	for (auto frame = 0u; frame < ItemCount; ++frame)
+	{
+		bool completed;
+		issued += RunFrame(scheduler, clock, 0.0, completed);
+		completions += completed ? 1 : 0;
+	}
+
+	// 1フレームに4つずつなので, 36個は9フレームで完了し, 完了は1度だけ通知される
+	EXPECT_EQ(issued, ItemCount);
+	EXPECT_EQ(scheduler.GetIssuedCount(), ItemCount);
+	EXPECT_EQ(scheduler.GetFrameCount(), 9u);
+	EXPECT_EQ(completions, 1u);
+	EXPECT_FALSE(scheduler.IsBaking());
+}
+
+TEST(IBLBakeScheduler, RequestRestartsBake)
+{
+	FakeClock clock;
+	IBLBakeScheduler scheduler;
+	ASSERT_TRUE(scheduler.Init(MipCount, 2.0, 8, &clock));
+	ReportAllCosts(scheduler, 0.5);
+	scheduler.Request();
+
+	bool completed;
+	RunFrame(scheduler, clock, 0.0, completed);
+	RunFrame(scheduler, clock, 0.0, completed);
+	ASSERT_EQ(scheduler.GetIssuedCount(), 8u);
+
+	scheduler.Request();
+	EXPECT_TRUE(scheduler.IsBaking());
+	EXPECT_EQ(scheduler.GetIssuedCount(), 0u);
+	EXPECT_EQ(scheduler.GetFrameCount(), 0u);
+
+	IBLBakeScheduler::WorkItem item;
+	scheduler.BeginFrame();
+	ASSERT_TRUE(scheduler.Acquire(item));
+	EXPECT_TRUE(item.Diffuse);
+	EXPECT_EQ(item.Face, 0u);
+}
+
+TEST(IBLBakeScheduler, SmoothsReportedCost)
+{
+	FakeClock clock;
+	IBLBakeScheduler scheduler;
+	ASSERT_TRUE(scheduler.Init(MipCount, 2.0, 8, &clock));
+
+	IBLBakeScheduler::WorkItem item = { false, 3, 1 };
+	EXPECT_EQ(scheduler.GetEstimatedCost(item), 2.0);
+
+	// 初回は実測値, 以降は指数移動平均 (係数 0.25)
+	scheduler.ReportCost(item, 1.0);
+	EXPECT_DOUBLE_EQ(scheduler.GetEstimatedCost(item), 1.0);
+	scheduler.ReportCost(item, 3.0);
+	EXPECT_DOUBLE_EQ(scheduler.GetEstimatedCost(item), 1.5);
+
+	// 面が違っても同じミップなら推定コストを共有し, 別のミップには影響しない
+	EXPECT_DOUBLE_EQ(scheduler.GetEstimatedCost({ false, 0, 1 }), 1.5);
+	EXPECT_EQ(scheduler.GetEstimatedCost({ false, 3, 2 }), 2.0);
+}
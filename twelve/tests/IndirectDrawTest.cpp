@@ -0,0 +1,164 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "DrawSortKey.h"
+#include "IndirectDrawArgs.h"
+
+namespace
+{
+	struct IndirectDrawScene
+	{
+		std::vector<IndirectDrawSource>	Sources;
+		std::vector<uint64_t>			Keys;	// ソート済み
+	};
+
+	/// <summary>
+	/// マテリアルとパイプラインに分散した描画を作る (アドレスは実在しない)
+	/// </summary>
+	IndirectDrawScene CreateScene(uint32_t drawCount, uint32_t pipelineCount, uint32_t materialCount, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+
+		IndirectDrawScene scene;
+		scene.Sources.resize(drawCount);
+		scene.Keys.resize(drawCount);
+		for (auto i = 0u; i < drawCount; ++i)
+		{
+			auto& source = scene.Sources[i];
+			source.VertexBuffer.BufferLocation = 0x100000000ull + uint64_t(i) * 0x100000ull;
+			source.VertexBuffer.SizeInBytes = 44 * 64;
+			source.VertexBuffer.StrideInBytes = 44;
+			source.InstanceBuffer.BufferLocation = 0x400000000ull + uint64_t(i) * 0x1000ull;
+			source.InstanceBuffer.SizeInBytes = 64;
+			source.InstanceBuffer.StrideInBytes = 64;
+			source.IndexBuffer.BufferLocation = 0x800000000ull + uint64_t(i) * 0x100000ull;
+			source.IndexBuffer.SizeInBytes = 3 * 32 * sizeof(uint32_t);
+			source.IndexBuffer.Format = DXGI_FORMAT_R32_UINT;
+			source.IndexCount = 3 * (1 + rng() % 1024);
+			source.InstanceCount = 1 + rng() % 4;
+			source.MaterialId = rng() % materialCount;
+
+			DrawKeyFields fields;
+			fields.Pipeline = rng() % pipelineCount;
+			fields.Material = source.MaterialId;
+			fields.Depth = rng() % (1u << DrawKeyDepthBits);
+			fields.Mesh = i;
+			scene.Keys[i] = EncodeDrawKey(fields);
+		}
+
+		std::sort(scene.Keys.begin(), scene.Keys.end());
+		return scene;
+	}
+
+	/// <summary>
+	/// 範囲が全ての描画を隙間なく覆い, 範囲内のキーが同じパイプライン (とマテリアル) であることを確かめる
+	/// </summary>
+	void ExpectBucketsCover(const std::vector<uint64_t>& keys, const std::vector<IndirectDrawBucket>& buckets, bool splitMaterial)
+	{
+		uint32_t next = 0;
+		for (const auto& bucket : buckets)
+		{
+			ASSERT_EQ(bucket.Offset, next);
+			ASSERT_GT(bucket.Count, 0u);
+
+			auto first = DecodeDrawKey(keys[bucket.Offset]);
+			EXPECT_EQ(bucket.Pipeline, first.Pipeline);
+			EXPECT_EQ(bucket.Material, first.Material);
+			EXPECT_EQ(bucket.FirstMesh, first.Mesh);
+
+			for (auto i = bucket.Offset; i < bucket.Offset + bucket.Count; ++i)
+			{
+				auto fields = DecodeDrawKey(keys[i]);
+				EXPECT_EQ(fields.Pipeline, bucket.Pipeline) << "key " << i;
+				if (splitMaterial)
+				{
+					EXPECT_EQ(fields.Material, bucket.Material) << "key " << i;
+				}
+			}
+
+			next += bucket.Count;
+		}
+
+		EXPECT_EQ(next, uint32_t(keys.size()));
+	}
+}
+
+TEST(IndirectDraw, BucketsSplitByMaterial)
+{
+	auto scene = CreateScene(5000, 4, 16, 1);
+
+	std::vector<IndirectDrawBucket> buckets;
+	BuildIndirectDrawBuckets(scene.Keys.data(), scene.Keys.size(), buckets);
+	ExpectBucketsCover(scene.Keys, buckets, true);
+
+	// 隣り合う範囲は必ずパイプラインかマテリアルが異なる
+	for (size_t i = 1; i < buckets.size(); ++i)
+	{
+		EXPECT_TRUE(buckets[i].Pipeline != buckets[i - 1].Pipeline || buckets[i].Material != buckets[i - 1].Material);
+	}
+}
+
+TEST(IndirectDraw, BindlessBucketsSplitByPipelineOnly)
+{
+	auto scene = CreateScene(5000, 4, 16, 2);
+
+	std::vector<IndirectDrawBucket> buckets;
+	BuildIndirectDrawBuckets(scene.Keys.data(), scene.Keys.size(), buckets, false);
+	ExpectBucketsCover(scene.Keys, buckets, false);
+	EXPECT_EQ(buckets.size(), 4u);
+}
+
+TEST(IndirectDraw, BucketsOfEmptyKeys)
+{
+	std::vector<IndirectDrawBucket> buckets(3);
+	BuildIndirectDrawBuckets(nullptr, 0, buckets);
+	EXPECT_TRUE(buckets.empty());
+}
+
+TEST(IndirectDraw, ArgsFollowKeyOrder)
+{
+	auto scene = CreateScene(1000, 4, 16, 3);
+
+	std::vector<IndirectDrawArgs> args(scene.Keys.size());
+	WriteIndirectDrawArgs(scene.Keys.data(), 0, scene.Keys.size(), scene.Sources.data(), args.data());
+
+	for (size_t i = 0; i < scene.Keys.size(); ++i)
+	{
+		auto mesh = DecodeDrawKey(scene.Keys[i]).Mesh;
+		const auto& source = scene.Sources[mesh];
+
+		EXPECT_EQ(args[i].DrawId, mesh);
+		EXPECT_EQ(args[i].MaterialId, source.MaterialId);
+		EXPECT_EQ(args[i].VertexBuffer.BufferLocation, source.VertexBuffer.BufferLocation);
+		EXPECT_EQ(args[i].InstanceBuffer.BufferLocation, source.InstanceBuffer.BufferLocation);
+		EXPECT_EQ(args[i].IndexBuffer.BufferLocation, source.IndexBuffer.BufferLocation);
+		EXPECT_EQ(args[i].Draw.IndexCountPerInstance, source.IndexCount);
+		EXPECT_EQ(args[i].Draw.InstanceCount, source.InstanceCount);
+		EXPECT_EQ(args[i].Draw.StartIndexLocation, 0u);
+		EXPECT_EQ(args[i].Draw.BaseVertexLocation, 0);
+		EXPECT_EQ(args[i].Draw.StartInstanceLocation, 0u);
+	}
+}
+
+TEST(IndirectDraw, ParallelArgsMatchSerial)
+{
+	auto scene = CreateScene(50000, 8, 64, 4);
+	auto count = scene.Keys.size();
+
+	std::vector<IndirectDrawArgs> serial(count);
+	WriteIndirectDrawArgs(scene.Keys.data(), 0, count, scene.Sources.data(), serial.data());
+
+	for (auto threadCount : { 1u, 2u, 4u, 7u, 0u })
+	{
+		// 書き込まれない部分が残っていれば一致しない
+		std::vector<IndirectDrawArgs> parallel(count);
+		memset(parallel.data(), 0xcd, sizeof(IndirectDrawArgs) * count);
+
+		WriteIndirectDrawArgsParallel(scene.Keys.data(), count, scene.Sources.data(), parallel.data(), threadCount);
+		EXPECT_EQ(memcmp(serial.data(), parallel.data(), sizeof(IndirectDrawArgs) * count), 0) << threadCount << " threads";
+	}
+}
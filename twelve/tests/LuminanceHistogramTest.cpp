@@ -0,0 +1,213 @@
+﻿#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+
+#include "LuminanceHistogram.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// グレーのピクセルを指定の数ずつ並べた画像を作る
+	/// </summary>
+	/// <param name="values">(輝度, ピクセル数) の組</param>
+	CpuImage CreateLuminanceImage(std::initializer_list<std::pair<float, uint32_t>> values)
+	{
+		uint32_t count = 0;
+		for (const auto& value : values)
+		{
+			count += value.second;
+		}
+
+		CpuImage image;
+		image.Resize(count, 1);
+
+		auto row = image.GetRow(0);
+		for (const auto& value : values)
+		{
+			for (auto i = 0u; i < value.second; ++i)
+			{
+				*row++ = XMFLOAT4(value.first, value.first, value.first, 1.0f);
+			}
+		}
+		return image;
+	}
+
+	/// <summary>
+	/// グレーの輝度が入るビンの中央の輝度 (log2)
+	/// </summary>
+	float CalcGrayBinLog2(float value)
+	{
+		return CalcLuminanceHistogramBinLog2(CalcLuminanceHistogramBin(value, value, value));
+	}
+}
+
+TEST(LuminanceHistogram, ZeroNegativeAndNaNGoToBinZero)
+{
+	EXPECT_EQ(CalcLuminanceHistogramBin(0.0f, 0.0f, 0.0f), 0u);
+	EXPECT_EQ(CalcLuminanceHistogramBin(-1.0f, -2.0f, -3.0f), 0u);
+
+	auto nan = std::numeric_limits<float>::quiet_NaN();
+	EXPECT_EQ(CalcLuminanceHistogramBin(nan, nan, nan), 0u);
+}
+
+TEST(LuminanceHistogram, GrayBinsFollowLog2)
+{
+	// 1段あたり8ビンなので, ビンの中央は元の輝度から 1/8 段以内になる
+	// (チャンネルは 1/1024 単位に丸めるので, 丸め誤差が小さい 1/16 以上で確認する)
+	auto previous = 0u;
+	for (auto log2Value = -4.0f; log2Value <= 11.0f; log2Value += 0.0625f)
+	{
+		auto value = std::exp2(log2Value);
+		auto bin = CalcLuminanceHistogramBin(value, value, value);
+
+		EXPECT_GE(bin, previous) << "log2 = " << log2Value;
+		EXPECT_LT(bin, LuminanceHistogramBinCount);
+		EXPECT_NEAR(CalcLuminanceHistogramBinLog2(bin), log2Value, 1.0f / LuminanceHistogramBinsPerStop) << "log2 = " << log2Value;
+		previous = bin;
+	}
+
+	// 1は 2^18 の最初のビンに入る
+	EXPECT_EQ(CalcLuminanceHistogramBin(1.0f, 1.0f, 1.0f), 1u + 18u * LuminanceHistogramBinsPerStop);
+
+	// 上限でクランプされてもビン数を超えない
+	EXPECT_LT(CalcLuminanceHistogramBin(1e9f, 1e9f, 1e9f), LuminanceHistogramBinCount);
+}
+
+TEST(LuminanceHistogram, ChannelsUseLumaWeights)
+{
+	auto red = CalcLuminanceHistogramBin(1.0f, 0.0f, 0.0f);
+	auto green = CalcLuminanceHistogramBin(0.0f, 1.0f, 0.0f);
+	auto blue = CalcLuminanceHistogramBin(0.0f, 0.0f, 1.0f);
+
+	EXPECT_GT(green, red);
+	EXPECT_GT(red, blue);
+	EXPECT_NEAR(CalcLuminanceHistogramBinLog2(green), std::log2(0.7152f), 1.0f / LuminanceHistogramBinsPerStop);
+	EXPECT_NEAR(CalcLuminanceHistogramBinLog2(red), std::log2(0.2126f), 1.0f / LuminanceHistogramBinsPerStop);
+	EXPECT_NEAR(CalcLuminanceHistogramBinLog2(blue), std::log2(0.0722f), 1.0f / LuminanceHistogramBinsPerStop);
+}
+
+TEST(LuminanceHistogram, HistogramCountsEveryPixel)
+{
+	CpuImage image;
+	image.Resize(37, 29);
+	for (auto y = 0u; y < image.Height; ++y)
+	{
+		for (auto x = 0u; x < image.Width; ++x)
+		{
+			auto value = std::exp2(float(x) * 0.5f - 10.0f) * float(y % 3);
+			image.GetRow(y)[x] = XMFLOAT4(value, value * 0.5f, value * 2.0f, 1.0f);
+		}
+	}
+
+	std::vector<uint32_t> expected(LuminanceHistogramBinCount, 0);
+	for (const auto& pixel : image.Pixels)
+	{
+		expected[CalcLuminanceHistogramBin(pixel.x, pixel.y, pixel.z)]++;
+	}
+
+	std::vector<uint32_t> single;
+	std::vector<uint32_t> multi;
+	BuildLuminanceHistogram(image, single, 1);
+	BuildLuminanceHistogram(image, multi, 4);
+
+	EXPECT_EQ(single, expected);
+	EXPECT_EQ(multi, expected);
+
+	AutoExposureReport report;
+	EXPECT_TRUE(CompareLuminanceHistogram(image, expected.data(), AutoExposureParam(), report));
+	EXPECT_EQ(report.PixelCount, uint64_t(image.Width) * image.Height);
+	EXPECT_EQ(report.MismatchBins, 0u);
+
+	// 1ビンでもずれていれば検出する
+	expected[CalcLuminanceHistogramBin(1.0f, 1.0f, 1.0f)] += 3;
+	EXPECT_FALSE(CompareLuminanceHistogram(image, expected.data(), AutoExposureParam(), report));
+	EXPECT_EQ(report.MismatchBins, 1u);
+	EXPECT_EQ(report.MaxCountDiff, 3u);
+}
+
+TEST(LuminanceHistogram, PercentilesClipOutliers)
+{
+	// 暗い10%と明るい5%を除外すると, 中間グレーだけが残る
+	auto image = CreateLuminanceImage({ { 1e-4f, 10 }, { 0.18f, 85 }, { 1000.0f, 5 } });
+
+	std::vector<uint32_t> histogram;
+	BuildLuminanceHistogram(image, histogram);
+
+	AutoExposureParam param;
+	param.LowPercent = 0.1f;
+	param.HighPercent = 0.95f;
+	EXPECT_FLOAT_EQ(CalcHistogramAverageLog2(histogram.data(), param), CalcGrayBinLog2(0.18f));
+
+	// 除外しない場合は外れ値に引っ張られる
+	param.LowPercent = 0.0f;
+	param.HighPercent = 1.0f;
+	auto average = CalcHistogramAverageLog2(histogram.data(), param);
+	auto expected = (10.0f * CalcGrayBinLog2(1e-4f) + 85.0f * CalcGrayBinLog2(0.18f) + 5.0f * CalcGrayBinLog2(1000.0f)) / 100.0f;
+	EXPECT_NEAR(average, expected, 1e-4f);
+}
+
+TEST(LuminanceHistogram, PercentilesWeightPartialBins)
+{
+	// 範囲 [25%, 75%) は2つのビンに半分ずつかかる
+	auto image = CreateLuminanceImage({ { 0.05f, 50 }, { 2.0f, 50 } });
+
+	std::vector<uint32_t> histogram;
+	BuildLuminanceHistogram(image, histogram);
+
+	AutoExposureParam param;
+	param.LowPercent = 0.25f;
+	param.HighPercent = 0.75f;
+
+	auto expected = 0.5f * (CalcGrayBinLog2(0.05f) + CalcGrayBinLog2(2.0f));
+	EXPECT_NEAR(CalcHistogramAverageLog2(histogram.data(), param), expected, 1e-5f);
+
+	// 範囲の幅が0の場合は下限の位置のビンになる
+	param.LowPercent = 0.8f;
+	param.HighPercent = 0.8f;
+	EXPECT_FLOAT_EQ(CalcHistogramAverageLog2(histogram.data(), param), CalcGrayBinLog2(2.0f));
+
+	// 空のヒストグラムは0
+	std::vector<uint32_t> empty(LuminanceHistogramBinCount, 0);
+	EXPECT_EQ(CalcHistogramAverageLog2(empty.data(), param), 0.0f);
+}
+
+TEST(LuminanceHistogram, TargetExposureMapsAverageToKey)
+{
+	AutoExposureParam param;
+
+	EXPECT_NEAR(CalcTargetExposure(std::log2(param.KeyValue), param), 1.0f, 1e-6f);
+	EXPECT_NEAR(CalcTargetExposure(std::log2(param.KeyValue) - 2.0f, param), 4.0f, 1e-5f);
+
+	// 範囲外はクランプする
+	EXPECT_FLOAT_EQ(CalcTargetExposure(-40.0f, param), std::exp2(param.MaxLog2Exposure));
+	EXPECT_FLOAT_EQ(CalcTargetExposure(40.0f, param), std::exp2(param.MinLog2Exposure));
+}
+
+TEST(LuminanceHistogram, AdaptationStepsInLog2Space)
+{
+	AutoExposureParam param;
+	param.SpeedUp = 3.0f;
+	param.SpeedDown = 1.0f;
+
+	// 経過時間が0なら変化しない, 十分長ければ目標に達する
+	EXPECT_FLOAT_EQ(AdaptExposure(1.0f, 4.0f, 0.0f, param), 1.0f);
+	EXPECT_NEAR(AdaptExposure(1.0f, 4.0f, 100.0f, param), 4.0f, 1e-5f);
+
+	// 1ステップで log2 の差の 1 - exp(-dt * speed) だけ近づく
+	auto dt = 1.0f / 60.0f;
+	auto up = AdaptExposure(1.0f, 4.0f, dt, param);
+	EXPECT_NEAR(std::log2(up), 2.0f * (1.0f - std::exp(-dt * param.SpeedUp)), 1e-5f);
+
+	auto down = AdaptExposure(4.0f, 1.0f, dt, param);
+	EXPECT_NEAR(std::log2(down), 2.0f - 2.0f * (1.0f - std::exp(-dt * param.SpeedDown)), 1e-5f);
+
+	// 明るくする方向の方が速い
+	EXPECT_GT(std::log2(up), 2.0f - std::log2(down));
+
+	// 負の経過時間は0として扱い, 初期値が無効な場合は目標をそのまま使う
+	EXPECT_FLOAT_EQ(AdaptExposure(2.0f, 8.0f, -1.0f, param), 2.0f);
+	EXPECT_FLOAT_EQ(AdaptExposure(0.0f, 8.0f, dt, param), 8.0f);
+}
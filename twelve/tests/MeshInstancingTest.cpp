@@ -0,0 +1,237 @@
+﻿#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#include "MeshInstancing.h"
+
+namespace
+{
+	/// <summary>
+	/// 乱数で頂点とインデックスを作ったメッシュを生成する
+	/// </summary>
+	ResMesh MakeMesh(std::mt19937& rng, uint32_t materialId)
+	{
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		std::uniform_int_distribution<uint32_t> triangles(1, 8);
+
+		ResMesh mesh;
+		mesh.MaterialId = materialId;
+
+		auto vertexCount = triangles(rng) * 3;
+		for (auto i = 0u; i < vertexCount; ++i)
+		{
+			mesh.Vertices.emplace_back(
+				DirectX::XMFLOAT3(dist(rng), dist(rng), dist(rng)),
+				DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f),
+				DirectX::XMFLOAT2(dist(rng), dist(rng)),
+				DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f));
+			mesh.Indices.push_back(i);
+		}
+
+		return mesh;
+	}
+
+	MeshInstance MakeTranslation(float x, float y, float z)
+	{
+		MeshInstance instance;
+		DirectX::XMStoreFloat4x4(&instance.World, DirectX::XMMatrixTranslation(x, y, z));
+		return instance;
+	}
+
+	/// <summary>
+	/// 同じデータを複数回含むメッシュの並び (ノード階層を辿って読み込んだ結果を模したもの)
+	/// </summary>
+	struct InstancedScene
+	{
+		std::vector<ResMesh> Meshes;
+		std::vector<uint32_t> Expected;		// 元のメッシュ番号 -> まとめた後のメッシュ番号
+		uint32_t UniqueCount = 0;
+
+		InstancedScene(uint32_t uniqueCount, uint32_t copyCount, uint32_t seed)
+			: UniqueCount(uniqueCount)
+		{
+			std::mt19937 rng(seed);
+			std::uniform_int_distribution<uint32_t> pick(0, uniqueCount - 1);
+
+			std::vector<ResMesh> unique;
+			for (auto i = 0u; i < uniqueCount; ++i)
+			{
+				unique.push_back(MakeMesh(rng, i % 4));
+			}
+
+			// 各メッシュが少なくとも1回は現れるように, 先頭に一通り並べてから乱数で複製する
+			std::vector<uint32_t> source;
+			for (auto i = 0u; i < uniqueCount; ++i)
+			{
+				source.push_back(i);
+			}
+			for (auto i = 0u; i < copyCount; ++i)
+			{
+				source.push_back(pick(rng));
+			}
+			std::shuffle(source.begin(), source.end(), rng);
+
+			// 最初に現れた順にまとめた後の番号が振られる
+			std::vector<uint32_t> order(uniqueCount, UINT32_MAX);
+			uint32_t next = 0;
+			for (size_t i = 0; i < source.size(); ++i)
+			{
+				auto id = source[i];
+				if (order[id] == UINT32_MAX)
+				{
+					order[id] = next++;
+				}
+
+				auto mesh = unique[id];
+				mesh.Instances.push_back(MakeTranslation(float(i), 0.0f, 0.0f));
+				Meshes.push_back(std::move(mesh));
+				Expected.push_back(order[id]);
+			}
+		}
+	};
+}
+
+TEST(MeshInstancingTest, HashMatchesForSameData)
+{
+	std::mt19937 rng(1);
+	auto a = MakeMesh(rng, 0);
+	auto b = a;
+	b.Instances.push_back(MakeTranslation(1.0f, 2.0f, 3.0f));
+
+	// インスタンスのデータはハッシュ値と比較に含めない
+	EXPECT_EQ(ComputeMeshDataHash(a), ComputeMeshDataHash(b));
+	EXPECT_TRUE(IsSameMeshData(a, b));
+
+	b.Vertices[0].Position.x += 1.0f;
+	EXPECT_NE(ComputeMeshDataHash(a), ComputeMeshDataHash(b));
+	EXPECT_FALSE(IsSameMeshData(a, b));
+}
+
+TEST(MeshInstancingTest, GroupCounts)
+{
+	InstancedScene scene(16, 256, 1);
+	auto meshes = scene.Meshes;
+
+	std::vector<uint32_t> remap;
+	auto removed = DeduplicateMeshes(meshes, remap);
+
+	EXPECT_EQ(meshes.size(), scene.UniqueCount);
+	EXPECT_EQ(removed, uint32_t(scene.Meshes.size() - scene.UniqueCount));
+
+	// まとめたメッシュのインスタンス数の合計は元のメッシュ数と一致する
+	std::vector<uint32_t> counts(meshes.size(), 0);
+	for (auto index : remap)
+	{
+		counts[index]++;
+	}
+
+	size_t instanceCount = 0;
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		EXPECT_EQ(meshes[i].Instances.size(), counts[i]) << "mesh " << i;
+		instanceCount += meshes[i].Instances.size();
+	}
+	EXPECT_EQ(instanceCount, scene.Meshes.size());
+}
+
+TEST(MeshInstancingTest, PreservesFirstAppearanceOrder)
+{
+	InstancedScene scene(16, 256, 2);
+	auto meshes = scene.Meshes;
+
+	std::vector<uint32_t> remap;
+	DeduplicateMeshes(meshes, remap);
+
+	ASSERT_EQ(remap.size(), scene.Meshes.size());
+	EXPECT_EQ(remap, scene.Expected);
+
+	// まとめた後のメッシュは対応する元のメッシュとデータが一致する
+	for (size_t i = 0; i < scene.Meshes.size(); ++i)
+	{
+		ASSERT_LT(remap[i], meshes.size());
+		EXPECT_TRUE(IsSameMeshData(meshes[remap[i]], scene.Meshes[i])) << "source " << i;
+	}
+}
+
+TEST(MeshInstancingTest, PreservesInstanceTransforms)
+{
+	InstancedScene scene(16, 256, 3);
+	auto meshes = scene.Meshes;
+
+	std::vector<uint32_t> remap;
+	DeduplicateMeshes(meshes, remap);
+
+	// 元のメッシュ i の変換は X = i の平行移動なので, 元の順序のまま移されていれば昇順に並ぶ
+	std::vector<size_t> cursor(meshes.size(), 0);
+	for (size_t i = 0; i < scene.Meshes.size(); ++i)
+	{
+		const auto& instances = meshes[remap[i]].Instances;
+		auto& at = cursor[remap[i]];
+		ASSERT_LT(at, instances.size());
+
+		const auto& expected = scene.Meshes[i].Instances[0].World;
+		const auto& actual = instances[at].World;
+		EXPECT_EQ(memcmp(&expected, &actual, sizeof(expected)), 0) << "source " << i;
+		EXPECT_FLOAT_EQ(actual._41, float(i));
+
+		at++;
+	}
+}
+
+TEST(MeshInstancingTest, EmptyInstancesBecomeIdentity)
+{
+	std::mt19937 rng(4);
+	auto base = MakeMesh(rng, 0);
+
+	std::vector<ResMesh> meshes(3, base);
+	meshes[1].Instances.push_back(MakeTranslation(5.0f, 0.0f, 0.0f));
+
+	std::vector<uint32_t> remap;
+	EXPECT_EQ(DeduplicateMeshes(meshes, remap), 2u);
+	ASSERT_EQ(meshes.size(), 1u);
+	ASSERT_EQ(meshes[0].Instances.size(), 3u);
+
+	DirectX::XMFLOAT4X4 identity;
+	DirectX::XMStoreFloat4x4(&identity, DirectX::XMMatrixIdentity());
+
+	EXPECT_EQ(memcmp(&meshes[0].Instances[0].World, &identity, sizeof(identity)), 0);
+	EXPECT_FLOAT_EQ(meshes[0].Instances[1].World._41, 5.0f);
+	EXPECT_EQ(memcmp(&meshes[0].Instances[2].World, &identity, sizeof(identity)), 0);
+}
+
+TEST(MeshInstancingTest, DifferentMaterialIsNotMerged)
+{
+	std::mt19937 rng(5);
+	auto a = MakeMesh(rng, 0);
+	auto b = a;
+	b.MaterialId = 1;
+
+	std::vector<ResMesh> meshes = { a, b, a };
+
+	std::vector<uint32_t> remap;
+	EXPECT_EQ(DeduplicateMeshes(meshes, remap), 1u);
+	ASSERT_EQ(meshes.size(), 2u);
+	EXPECT_EQ(meshes[0].MaterialId, 0u);
+	EXPECT_EQ(meshes[1].MaterialId, 1u);
+	EXPECT_EQ(remap, (std::vector<uint32_t>{ 0, 1, 0 }));
+}
+
+TEST(MeshInstancingTest, StatsReflectMerging)
+{
+	InstancedScene scene(16, 256, 6);
+	auto meshes = scene.Meshes;
+
+	auto before = ComputeMeshInstancingStats(meshes);
+	std::vector<uint32_t> remap;
+	DeduplicateMeshes(meshes, remap);
+	auto after = ComputeMeshInstancingStats(meshes);
+
+	// 描画されるインスタンスと焼き込んだ場合のサイズは変わらず, 描画数とインスタンス化した場合のサイズが減る
+	EXPECT_EQ(before.MeshCount, uint32_t(scene.Meshes.size()));
+	EXPECT_EQ(after.MeshCount, scene.UniqueCount);
+	EXPECT_EQ(after.InstanceCount, before.InstanceCount);
+	EXPECT_EQ(after.BakedBytes, before.BakedBytes);
+	EXPECT_LT(after.InstancedBytes, before.InstancedBytes);
+}
@@ -0,0 +1,147 @@
+﻿#include <gtest/gtest.h>
+
+#include <climits>
+#include <cstring>
+#include <functional>
+
+#include "PipelineKey.h"
+
+namespace
+{
+	const uint64_t RootHash = 0x1234;
+
+	/// <summary>
+	/// DXBCヘッダーを模したバイトコード (A と Copy は同じ内容, B はチェックサムのみ異なる)
+	/// </summary>
+	struct ShaderBlobs
+	{
+		uint8_t A[64] = { 'D', 'X', 'B', 'C' };
+		uint8_t B[64] = { 'D', 'X', 'B', 'C' };
+		uint8_t Copy[64];
+
+		ShaderBlobs()
+		{
+			for (auto i = 4; i < 20; ++i)
+			{
+				A[i] = uint8_t(i);
+				B[i] = uint8_t(i * 3);
+			}
+			memcpy(Copy, A, sizeof(A));
+		}
+	};
+
+	const ShaderBlobs Shaders;
+
+	const D3D12_INPUT_ELEMENT_DESC Elements[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+
+	const D3D12_INPUT_ELEMENT_DESC ElementsAppend[] = {
+		{ "position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		{ "TexCoord", 0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+	};
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC CreateBaseDesc()
+	{
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+		desc.VS = { Shaders.A, sizeof(Shaders.A) };
+		desc.PS = { Shaders.B, sizeof(Shaders.B) };
+		desc.InputLayout = { Elements, 2 };
+		desc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+		desc.SampleMask = UINT_MAX;
+		desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+		desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+		desc.RasterizerState.DepthClipEnable = TRUE;
+		desc.DepthStencilState.DepthEnable = FALSE;
+		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+		desc.NumRenderTargets = 1;
+		desc.RTVFormats[0] = DXGI_FORMAT_R10G10B10A2_UNORM;
+		desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+		desc.SampleDesc.Count = 1;
+		return desc;
+	}
+
+	/// <summary>
+	/// 基準の構成設定を1項目だけ変えたもの
+	/// </summary>
+	struct KeyCase
+	{
+		const char*																Name;
+		std::function<void(D3D12_GRAPHICS_PIPELINE_STATE_DESC&, uint64_t&)>	Modify;
+	};
+
+	std::ostream& operator<<(std::ostream& stream, const KeyCase& c)
+	{
+		return stream << c.Name;
+	}
+
+	uint64_t ComputeCaseKey(const KeyCase& c)
+	{
+		auto desc = CreateBaseDesc();
+		auto rootHash = RootHash;
+		c.Modify(desc, rootHash);
+		return ComputeGraphicsPipelineKey(desc, rootHash);
+	}
+
+	class PipelineKeySame : public ::testing::TestWithParam<KeyCase>
+	{
+	};
+
+	class PipelineKeyDifferent : public ::testing::TestWithParam<KeyCase>
+	{
+	};
+}
+
+TEST_P(PipelineKeySame, IgnoresFieldsWithoutEffect)
+{
+	EXPECT_EQ(ComputeCaseKey(GetParam()), ComputeGraphicsPipelineKey(CreateBaseDesc(), RootHash));
+}
+
+TEST_P(PipelineKeyDifferent, DistinguishesFieldsWithEffect)
+{
+	EXPECT_NE(ComputeCaseKey(GetParam()), ComputeGraphicsPipelineKey(CreateBaseDesc(), RootHash));
+}
+
+// 同じパイプラインになるもの
+INSTANTIATE_TEST_SUITE_P(PipelineKey, PipelineKeySame, ::testing::Values(
+	KeyCase{ "ShaderCopy", [](auto& d, auto&) { d.VS = { Shaders.Copy, sizeof(Shaders.Copy) }; } },
+	KeyCase{ "UnusedRTVFormat", [](auto& d, auto&) { d.RTVFormats[3] = DXGI_FORMAT_R8G8B8A8_UNORM; } },
+	KeyCase{ "UnusedBlendTarget", [](auto& d, auto&) { d.BlendState.RenderTarget[1].BlendEnable = TRUE; } },
+	KeyCase{ "DisabledBlendFactor", [](auto& d, auto&) { d.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA; } },
+	KeyCase{ "DisabledDepthFunc", [](auto& d, auto&) { d.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER; } },
+	KeyCase{ "DisabledStencilMask", [](auto& d, auto&) { d.DepthStencilState.StencilReadMask = 0x0f; } },
+	KeyCase{ "AppendAligned", [](auto& d, auto&) { d.InputLayout = { ElementsAppend, 2 }; } },
+	KeyCase{ "NodeMask", [](auto& d, auto&) { d.NodeMask = 1; } },
+	KeyCase{ "CachedPSO", [](auto& d, auto&) { d.CachedPSO = { Shaders.B, sizeof(Shaders.B) }; } },
+	KeyCase{ "SingleIndependentBlend", [](auto& d, auto&) { d.BlendState.IndependentBlendEnable = TRUE; } }));
+
+// 異なるパイプラインになるもの
+INSTANTIATE_TEST_SUITE_P(PipelineKey, PipelineKeyDifferent, ::testing::Values(
+	KeyCase{ "RootSignature", [](auto&, auto& rootHash) { rootHash = RootHash + 1; } },
+	KeyCase{ "ShaderChecksum", [](auto& d, auto&) { d.VS = { Shaders.B, sizeof(Shaders.B) }; } },
+	KeyCase{ "RTVFormat", [](auto& d, auto&) { d.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT; } },
+	KeyCase{ "CullMode", [](auto& d, auto&) { d.RasterizerState.CullMode = D3D12_CULL_MODE_BACK; } },
+	KeyCase{ "BlendEnable", [](auto& d, auto&) { d.BlendState.RenderTarget[0].BlendEnable = TRUE; } },
+	KeyCase{ "DepthEnable", [](auto& d, auto&) { d.DepthStencilState.DepthEnable = TRUE; } },
+	KeyCase{ "DSVFormat", [](auto& d, auto&) { d.DSVFormat = DXGI_FORMAT_UNKNOWN; } },
+	KeyCase{ "InputElementCount", [](auto& d, auto&) { d.InputLayout = { Elements, 1 }; } }));
+
+TEST(PipelineKey, SeparatesComputeFromGraphics)
+{
+	// 同じシェーダーでもコンピュートとグラフィックスは区別する
+	D3D12_COMPUTE_PIPELINE_STATE_DESC compute = {};
+	compute.CS = { Shaders.A, sizeof(Shaders.A) };
+	auto computeKey = ComputeComputePipelineKey(compute, RootHash);
+
+	compute.CS = { Shaders.Copy, sizeof(Shaders.Copy) };
+	EXPECT_EQ(computeKey, ComputeComputePipelineKey(compute, RootHash));
+	EXPECT_NE(computeKey, ComputeGraphicsPipelineKey(CreateBaseDesc(), RootHash));
+}
+
+TEST(PipelineKey, ShaderHashUsesDxbcChecksum)
+{
+	EXPECT_EQ(ComputeShaderHash({ nullptr, 0 }), 0u);
+	EXPECT_EQ(ComputeShaderHash({ Shaders.A, sizeof(Shaders.A) }), ComputeShaderHash({ Shaders.Copy, sizeof(Shaders.Copy) }));
+	EXPECT_NE(ComputeShaderHash({ Shaders.A, sizeof(Shaders.A) }), ComputeShaderHash({ Shaders.B, sizeof(Shaders.B) }));
+}
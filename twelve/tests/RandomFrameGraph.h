@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "FrameGraph.h"
+
+/// <summary>
+/// ランダムなフレームグラフを構築する (テストとベンチマークで共用する)
+/// 各パスは直近に書き込まれたリソースから読み込み, 一時テクスチャを1つ書き込む. 最後のパスでバックバッファに合成する
+/// </summary>
+/// <param name="graph">構築先 (リセットしてから構築する)</param>
+/// <param name="passCount">パス数</param>
+/// <param name="seed">乱数のシード</param>
+inline void BuildRandomFrameGraph(FrameGraph& graph, uint32_t passCount, uint32_t seed)
+{
+	const uint32_t bytesPerPixel[] = { 4, 8, 16 };
+	const D3D12_RESOURCE_STATES readStates[] = {
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_STATE_COPY_SOURCE,
+	};
+
+	passCount = std::max(passCount, 2u);
+	std::mt19937 rng(seed);
+
+	graph.Reset();
+	auto backBuffer = graph.ImportResource("BackBuffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+
+	std::vector<FrameGraphHandle> outputs;
+	char name[64];
+
+	for (auto p = 0u; p + 1 < passCount; ++p)
+	{
+		snprintf(name, sizeof(name), "Pass%u", p);
+		auto pass = graph.AddPass(name, nullptr, (rng() % 64) == 0);
+
+		// 直近に書き込まれたリソースから読み込む (局所性のある依存関係)
+		if (!outputs.empty())
+		{
+			auto readCount = 1 + rng() % 3;
+			for (auto i = 0u; i < readCount; ++i)
+			{
+				auto window = std::min<size_t>(outputs.size(), 16);
+				auto index = outputs.size() - 1 - rng() % window;
+				graph.Read(pass, outputs[index], readStates[rng() % std::size(readStates)]);
+			}
+		}
+
+		FrameGraphTextureDesc desc;
+		desc.Width = 1280 >> (rng() % 3);
+		desc.Height = 720 >> (rng() % 3);
+		desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+		desc.SizeInBytes = (uint64_t(desc.Width) * desc.Height * bytesPerPixel[rng() % 3] + 65535) / 65536 * 65536;
+
+		snprintf(name, sizeof(name), "Texture%u", p);
+		auto texture = graph.CreateTexture(name, desc);
+
+		auto uav = (rng() % 4) == 0;
+		graph.Write(pass, texture, uav ? D3D12_RESOURCE_STATE_UNORDERED_ACCESS : D3D12_RESOURCE_STATE_RENDER_TARGET);
+		outputs.push_back(texture);
+	}
+
+	auto present = graph.AddPass("Present", nullptr);
+	graph.Read(present, outputs.back(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	graph.Write(present, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+}
@@ -0,0 +1,241 @@
+﻿#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "ShadowAtlasCache.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 割り当てたタイルがアトラスからはみ出さず, 互いに重ならないことを確かめる
+	/// </summary>
+	void ExpectTilesDisjoint(const ShadowAtlasCache& cache, const ShadowAtlasSettings& settings, uint32_t lightCount)
+	{
+		auto cellCount = settings.AtlasSize / settings.MinTileSize;
+		std::vector<uint32_t> occupancy(size_t(cellCount) * cellCount, UINT32_MAX);
+
+		for (auto i = 0u; i < lightCount; ++i)
+		{
+			auto tile = cache.GetTile(i);
+			if (tile.Size == 0)
+			{
+				continue;
+			}
+
+			ASSERT_LE(tile.X + tile.Size, settings.AtlasSize) << "light " << i;
+			ASSERT_LE(tile.Y + tile.Size, settings.AtlasSize) << "light " << i;
+
+			for (auto y = tile.Y / settings.MinTileSize; y < (tile.Y + tile.Size) / settings.MinTileSize; ++y)
+			{
+				for (auto x = tile.X / settings.MinTileSize; x < (tile.X + tile.Size) / settings.MinTileSize; ++x)
+				{
+					auto& cell = occupancy[size_t(y) * cellCount + x];
+					EXPECT_EQ(cell, UINT32_MAX) << "light " << i << " overlaps light " << cell;
+					cell = i;
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// 原点の周りに並べたライトを, 周回するカメラから見る
+	/// </summary>
+	class ShadowAtlasScene
+	{
+	public:
+		ShadowAtlasScene(uint32_t lightCount, uint32_t seed)
+			: m_Positions(lightCount)
+			, m_Radii(lightCount)
+			, m_Importances(lightCount)
+			, m_Versions(lightCount, 0)
+		{
+			std::mt19937 rng(seed);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+			for (auto i = 0u; i < lightCount; ++i)
+			{
+				m_Positions[i] = XMFLOAT3(4.0f * unit(rng) - 2.0f, 2.0f * unit(rng) - 0.5f, 4.0f * unit(rng) - 2.0f);
+				m_Radii[i] = 0.1f + 0.2f * unit(rng);
+				m_Importances[i] = 0.5f + unit(rng);
+			}
+
+			XMStoreFloat4x4(&m_Proj, XMMatrixPerspectiveFovRH(XMConvertToRadians(37.5f), 16.0f / 9.0f, 0.1f, 1000.0f));
+		}
+
+		/// <summary>
+		/// カメラの角度からライトの要求を求め, キャッシュを更新する
+		/// </summary>
+		void Update(const ShadowAtlasSettings& settings, ShadowAtlasCache& cache, float angle, uint32_t renderBudget, std::vector<uint32_t>& renderList)
+		{
+			auto eye = XMVectorSet(2.5f * sinf(angle), 0.8f, 2.5f * cosf(angle), 1.0f);
+
+			XMFLOAT4X4 view;
+			XMStoreFloat4x4(&view, XMMatrixLookAtRH(eye, XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+
+			m_Requests.clear();
+			for (auto i = 0u; i < uint32_t(m_Positions.size()); ++i)
+			{
+				auto coverage = ComputeShadowLightCoverage(view, m_Proj, m_Positions[i], m_Radii[i]);
+				auto request = ComputeShadowLightRequest(settings, i, m_Versions[i], coverage, m_Importances[i], 720.0f);
+				if (request.Size > 0)
+				{
+					m_Requests.push_back(request);
+				}
+			}
+
+			cache.Update(m_Requests.data(), uint32_t(m_Requests.size()), renderBudget, renderList);
+		}
+
+		void Touch(uint32_t lightId) { ++m_Versions[lightId]; }
+
+	private:
+		std::vector<XMFLOAT3>			m_Positions;
+		std::vector<float>				m_Radii;
+		std::vector<float>				m_Importances;
+		std::vector<uint32_t>			m_Versions;
+		std::vector<ShadowLightRequest>	m_Requests;
+		XMFLOAT4X4						m_Proj;
+	};
+}
+
+TEST(ShadowAtlasAllocator, FreeingAllTilesMergesToRoot)
+{
+	ShadowAtlasAllocator allocator;
+	ASSERT_TRUE(allocator.Init(4096, 64));
+
+	std::mt19937 rng(1);
+	std::vector<uint32_t> nodes;
+
+	for (auto i = 0u; i < 20000; ++i)
+	{
+		if (!nodes.empty() && (rng() & 1))
+		{
+			auto slot = rng() % nodes.size();
+			allocator.Free(nodes[slot]);
+			nodes[slot] = nodes.back();
+			nodes.pop_back();
+		}
+		else
+		{
+			auto node = allocator.Allocate(64u << (rng() % 5));
+			if (node != ShadowAtlasInvalidNode)
+			{
+				nodes.push_back(node);
+			}
+		}
+	}
+
+	for (auto node : nodes)
+	{
+		allocator.Free(node);
+	}
+
+	EXPECT_EQ(allocator.GetUsedArea(), 0ull);
+	EXPECT_NE(allocator.Allocate(4096), ShadowAtlasInvalidNode);
+	EXPECT_EQ(allocator.GetUsedArea(), 4096ull * 4096ull);
+}
+
+TEST(ShadowAtlasAllocator, RoundsAndClampsSizes)
+{
+	ShadowAtlasAllocator allocator;
+	ASSERT_TRUE(allocator.Init(1024, 64));
+
+	EXPECT_EQ(allocator.GetTile(allocator.Allocate(100)).Size, 128u);
+	EXPECT_EQ(allocator.GetTile(allocator.Allocate(1)).Size, 64u);
+
+	// 残りの領域に収まらない大きさは割り当てない
+	EXPECT_EQ(allocator.Allocate(1024), ShadowAtlasInvalidNode);
+}
+
+TEST(ShadowAtlasAllocator, RejectsInvalidSizes)
+{
+	ShadowAtlasAllocator allocator;
+	EXPECT_FALSE(allocator.Init(1000, 64));
+	EXPECT_FALSE(allocator.Init(1024, 2048));
+}
+
+TEST(ShadowAtlasCache, TilesNeverOverlapWhileCameraMoves)
+{
+	const auto lightCount = 512u;
+
+	ShadowAtlasSettings settings;
+	ShadowAtlasCache cache;
+	ASSERT_TRUE(cache.Init(settings, lightCount));
+
+	ShadowAtlasScene scene(lightCount, 1);
+	std::vector<uint32_t> renderList;
+
+	for (auto frame = 0u; frame < 120; ++frame)
+	{
+		scene.Update(settings, cache, 0.02f * float(frame), 8, renderList);
+		EXPECT_LE(renderList.size(), 8u);
+		ExpectTilesDisjoint(cache, settings, lightCount);
+	}
+
+	EXPECT_GT(cache.GetStats().AllocatedCount, 0u);
+}
+
+TEST(ShadowAtlasCache, StaticCameraRendersOnlyChangedLights)
+{
+	const auto lightCount = 256u;
+
+	ShadowAtlasSettings settings;
+	ShadowAtlasCache cache;
+	ASSERT_TRUE(cache.Init(settings, lightCount));
+
+	ShadowAtlasScene scene(lightCount, 2);
+	std::vector<uint32_t> renderList;
+
+	// 描画待ちがなくなるまで止まったカメラで更新する
+	auto drained = false;
+	for (auto frame = 0u; frame < 240 && !drained; ++frame)
+	{
+		scene.Update(settings, cache, 0.5f, 8, renderList);
+		drained = (frame > settings.RetainFrames && cache.GetStats().PendingCount == 0 && renderList.empty());
+	}
+	ASSERT_TRUE(drained);
+
+	for (auto frame = 0u; frame < 10; ++frame)
+	{
+		scene.Update(settings, cache, 0.5f, 8, renderList);
+		EXPECT_TRUE(renderList.empty()) << "frame " << frame;
+	}
+
+	auto changed = UINT32_MAX;
+	for (auto i = 0u; i < lightCount; ++i)
+	{
+		if (cache.IsReady(i))
+		{
+			changed = i;
+			break;
+		}
+	}
+	ASSERT_NE(changed, UINT32_MAX);
+
+	// バージョンを変えたライトだけ描画し直す
+	scene.Touch(changed);
+	scene.Update(settings, cache, 0.5f, 8, renderList);
+	EXPECT_EQ(renderList, std::vector<uint32_t>{ changed });
+
+	scene.Update(settings, cache, 0.5f, 8, renderList);
+	EXPECT_TRUE(renderList.empty());
+}
+
+TEST(ShadowAtlasCache, RequestSizeFollowsCoverage)
+{
+	ShadowAtlasSettings settings;
+
+	auto none = ComputeShadowLightRequest(settings, 0, 0, 0.0f, 1.0f, 720.0f);
+	auto small = ComputeShadowLightRequest(settings, 0, 0, 0.05f, 1.0f, 720.0f);
+	auto large = ComputeShadowLightRequest(settings, 0, 0, 0.8f, 1.0f, 720.0f);
+	auto huge = ComputeShadowLightRequest(settings, 0, 0, 10.0f, 1.0f, 4320.0f);
+
+	EXPECT_EQ(none.Size, 0u);
+	EXPECT_GE(small.Size, settings.MinTileSize);
+	EXPECT_GT(large.Size, small.Size);
+	EXPECT_LE(huge.Size, settings.MaxTileSize);
+	EXPECT_GT(large.Priority, small.Priority);
+}
@@ -0,0 +1,103 @@
+﻿#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "SphereMapProjection.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 各テクセルに自身のテクスチャ座標 (u, v) を格納したスフィアマップを作る
+	/// </summary>
+	CpuImage CreateCoordinateMap(uint32_t width)
+	{
+		CpuImage image;
+		image.Resize(width, width / 2);
+
+		for (auto y = 0u; y < image.Height; ++y)
+		{
+			auto row = image.GetRow(y);
+			for (auto x = 0u; x < image.Width; ++x)
+			{
+				row[x] = XMFLOAT4((float(x) + 0.5f) / float(image.Width), (float(y) + 0.5f) / float(image.Height), 0.0f, 1.0f);
+			}
+		}
+
+		return image;
+	}
+}
+
+TEST(SphereMapProjection, CubeSizeIsPowerOfTwoQuarterWidth)
+{
+	EXPECT_EQ(CalcSphereMapCubeSize(4096), 1024u);
+	EXPECT_EQ(CalcSphereMapCubeSize(3000), 1024u);
+	EXPECT_EQ(CalcSphereMapCubeSize(2048), 512u);
+	EXPECT_EQ(CalcSphereMapCubeSize(4), 1u);
+	EXPECT_EQ(CalcSphereMapCubeSize(0), 1u);
+}
+
+TEST(SphereMapProjection, ConstantMapStaysConstant)
+{
+	CpuImage sphereMap;
+	sphereMap.Resize(64, 32);
+	for (auto& pixel : sphereMap.Pixels)
+	{
+		pixel = XMFLOAT4(0.25f, 0.5f, 2.0f, 1.0f);
+	}
+
+	CpuCubeMap cube;
+	ConvertSphereMapToCube(sphereMap, 16, cube);
+
+	ASSERT_EQ(cube.Size, 16u);
+	ASSERT_EQ(cube.MipCount, 5u);
+	for (auto face = 0u; face < 6; ++face)
+	{
+		for (auto mip = 0u; mip < cube.MipCount; ++mip)
+		{
+			for (const auto& pixel : cube.GetImage(face, mip).Pixels)
+			{
+				EXPECT_NEAR(pixel.x, 0.25f, 1e-5f);
+				EXPECT_NEAR(pixel.y, 0.5f, 1e-5f);
+				EXPECT_NEAR(pixel.z, 2.0f, 1e-5f);
+			}
+		}
+	}
+}
+
+TEST(SphereMapProjection, TexelsSampleTheirDirection)
+{
+	auto sphereMap = CreateCoordinateMap(512);
+
+	const auto size = 32u;
+	CpuCubeMap cube;
+	ConvertSphereMapToCube(sphereMap, size, cube);
+
+	for (auto face = 0u; face < 6; ++face)
+	{
+		const auto& image = cube.GetImage(face, 0);
+		for (auto y = 0u; y < size; ++y)
+		{
+			for (auto x = 0u; x < size; ++x)
+			{
+				XMFLOAT3 dir;
+				XMStoreFloat3(&dir, CalcCubeDirection(face, (float(x) + 0.5f) / size, (float(y) + 0.5f) / size));
+
+				// Z軸を反転した正距円筒図法の座標 (極と経度の継ぎ目付近は補間で値が混ざるので除く)
+				auto u = atan2f(dir.x, -dir.z) / XM_2PI;
+				u = (u < 0.0f) ? u + 1.0f : u;
+				auto v = 0.5f - asinf(dir.y) / XM_PI;
+
+				if (u < 0.01f || u > 0.99f || v < 0.01f || v > 0.99f)
+				{
+					continue;
+				}
+
+				const auto& texel = image.GetRow(y)[x];
+				EXPECT_NEAR(texel.x, u, 2e-3f) << "face " << face << ", x " << x << ", y " << y;
+				EXPECT_NEAR(texel.y, v, 2e-3f) << "face " << face << ", x " << x << ", y " << y;
+			}
+		}
+	}
+}
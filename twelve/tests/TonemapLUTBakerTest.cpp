@@ -0,0 +1,128 @@
+﻿#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "TonemapLUTBaker.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// トーンマップと色空間を指定したパラメータを作る (HDRは1000nit)
+	/// </summary>
+	TonemapParam CreateParam(int type, int colorSpace)
+	{
+		TonemapParam param;
+		param.Type = type;
+		param.ColorSpace = colorSpace;
+		param.BaseLuminance = 100.0f;
+		param.MaxLuminance = (colorSpace == COLOR_SPACE_BT2100_PQ) ? 1000.0f : 100.0f;
+		return param;
+	}
+
+	const int TonemapTypes[] = { TONEMAP_NONE, TONEMAP_REINHARD, TONEMAP_GT };
+}
+
+TEST(TonemapLUTBaker, CoordCoversDomain)
+{
+	const int colorSpaces[] = { COLOR_SPACE_BT709, COLOR_SPACE_BT2100_PQ };
+	for (auto colorSpace : colorSpaces)
+	{
+		auto domain = GetTonemapLUTDomain(colorSpace);
+		auto maxValue = std::exp2(domain.Log2Max) - domain.GetOffset();
+
+		EXPECT_FLOAT_EQ(CalcTonemapLUTCoord(domain, 0.0f), 0.0f);
+		EXPECT_FLOAT_EQ(CalcTonemapLUTCoord(domain, -1.0f), 0.0f);
+		EXPECT_NEAR(CalcTonemapLUTCoord(domain, maxValue), 1.0f, 1e-6f);
+		EXPECT_FLOAT_EQ(CalcTonemapLUTCoord(domain, maxValue * 4.0f), 1.0f);
+		EXPECT_LT(CalcTonemapLUTCoord(domain, 0.18f), CalcTonemapLUTCoord(domain, 1.0f));
+	}
+}
+
+TEST(TonemapLUTBaker, SDRMatchesReferenceWithinTwoLSB8)
+{
+	for (auto type : TonemapTypes)
+	{
+		auto param = CreateParam(type, COLOR_SPACE_BT709);
+
+		std::vector<uint16_t> texels;
+		BakeTonemapLUT(param, TonemapLUTSizeSDR, texels);
+		ASSERT_EQ(texels.size(), size_t(TonemapLUTSizeSDR) * TonemapLUTSizeSDR * TonemapLUTSizeSDR * 4);
+
+		auto error = ValidateTonemapLUT(param, texels, TonemapLUTSizeSDR);
+		EXPECT_LT(error.MaxErrorLSB8, 2.0) << "type " << type;
+		EXPECT_LT(error.RMSE * 255.0, 0.5) << "type " << type;
+	}
+}
+
+TEST(TonemapLUTBaker, HDRMatchesReferenceWithinTwoLSB10)
+{
+	for (auto type : TonemapTypes)
+	{
+		auto param = CreateParam(type, COLOR_SPACE_BT2100_PQ);
+
+		std::vector<uint16_t> texels;
+		BakeTonemapLUT(param, TonemapLUTSizeHDR, texels);
+
+		auto error = ValidateTonemapLUT(param, texels, TonemapLUTSizeHDR);
+		EXPECT_LT(error.MaxErrorLSB10, 2.0) << "type " << type;
+		EXPECT_LT(error.RMSE * 1023.0, 0.5) << "type " << type;
+	}
+}
+
+TEST(TonemapLUTBaker, LatticePointsMatchReference)
+{
+	const uint32_t size = 8;
+
+	for (auto type : TonemapTypes)
+	{
+		auto param = CreateParam(type, COLOR_SPACE_BT2100_PQ);
+		auto domain = GetTonemapLUTDomain(param.ColorSpace);
+
+		std::vector<uint16_t> texels;
+		BakeTonemapLUT(param, size, texels);
+
+		// テクセル i の入力値
+		auto latticeValue = [&](uint32_t i)
+		{
+			auto u = float(i) / float(size - 1);
+			return (i == 0) ? 0.0f : std::exp2(domain.Log2Min + u * (domain.Log2Max - domain.Log2Min)) - domain.GetOffset();
+		};
+
+		// 3軸ともテクセルの位置では補間されないので, 半精度の丸め誤差だけになる
+		for (auto i = 0u; i < size; ++i)
+		{
+			XMFLOAT3 color(latticeValue(i), latticeValue(size - 1 - i), 0.0f);
+
+			auto reference = EvaluateTonemapReference(param, color);
+			auto sampled = SampleTonemapLUT(param, texels, size, color);
+
+			EXPECT_NEAR(sampled.x, reference.x, 1e-3f + std::abs(reference.x) * 1e-3f) << "type " << type << ", texel " << i;
+			EXPECT_NEAR(sampled.y, reference.y, 1e-3f + std::abs(reference.y) * 1e-3f) << "type " << type << ", texel " << i;
+			EXPECT_NEAR(sampled.z, reference.z, 1e-3f + std::abs(reference.z) * 1e-3f) << "type " << type << ", texel " << i;
+		}
+	}
+}
+
+TEST(TonemapLUTBaker, BakeIsIndependentOfThreadCount)
+{
+	auto param = CreateParam(TONEMAP_GT, COLOR_SPACE_BT709);
+
+	std::vector<uint16_t> single;
+	std::vector<uint16_t> multi;
+	BakeTonemapLUT(param, TonemapLUTSizeSDR, single, 1);
+	BakeTonemapLUT(param, TonemapLUTSizeSDR, multi, 4);
+
+	EXPECT_EQ(single, multi);
+}
+
+TEST(TonemapLUTBaker, ValidationDetectsWrongCurve)
+{
+	// GTでベイクしたLUTをReinhardとして検証すると大きな誤差になる
+	std::vector<uint16_t> texels;
+	BakeTonemapLUT(CreateParam(TONEMAP_GT, COLOR_SPACE_BT709), TonemapLUTSizeSDR, texels);
+
+	auto error = ValidateTonemapLUT(CreateParam(TONEMAP_REINHARD, COLOR_SPACE_BT709), texels, TonemapLUTSizeSDR);
+	EXPECT_GT(error.MaxErrorLSB8, 8.0);
+}
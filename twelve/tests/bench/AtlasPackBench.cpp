@@ -0,0 +1,57 @@
+﻿#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "AtlasRectPacker.h"
+#include "Bench.h"
+#include "Logger.h"
+
+bool RunAtlasPackBenchmark(int argc, char** argv)
+{
+	auto rectCount = GetBenchmarkArgument(argc, argv, 0, 256);
+	auto iterations = std::max(GetBenchmarkArgument(argc, argv, 1, 16), 1u);
+	auto seed = GetBenchmarkArgument(argc, argv, 2, 1);
+
+	// 小さなマテリアルテクスチャを想定して 16 - 256 の2の累乗と半端なサイズを混ぜる
+	std::mt19937 engine(seed);
+	std::uniform_int_distribution<uint32_t> exponent(4, 8);
+	std::uniform_int_distribution<uint32_t> odd(0, 3);
+
+	std::vector<AtlasRectSize> sizes(rectCount);
+	for (auto& size : sizes)
+	{
+		size.Width = 1u << exponent(engine);
+		size.Height = 1u << exponent(engine);
+
+		if (odd(engine) == 0)
+		{
+			size.Width = size.Width * 3 / 4;
+		}
+	}
+
+	const ATLAS_HEURISTIC heuristics[] = { ATLAS_HEURISTIC_SKYLINE_BL, ATLAS_HEURISTIC_SKYLINE_BF };
+	const wchar_t* names[] = { L"Skyline BL", L"Skyline BF" };
+
+	ILOG("Info : Atlas Packing. %u rects, %u iterations", rectCount, iterations);
+
+	for (auto h = 0; h < 2; ++h)
+	{
+		AtlasPackDesc desc;
+		desc.Heuristic = heuristics[h];
+
+		AtlasPackReport report;
+		std::vector<AtlasPlacement> placements;
+
+		auto start = std::chrono::steady_clock::now();
+		for (auto i = 0u; i < iterations; ++i)
+		{
+			PackAtlasRects(sizes, desc, placements, &report);
+		}
+		auto elapsed = GetElapsedMilliseconds(start) / iterations;
+
+		ILOG("  %ls : %.3f ms", names[h], elapsed);
+		LogAtlasPackReport(names[h], report);
+	}
+
+	return true;
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+/// <summary>
+/// 経過時間をミリ秒で取得する
+/// </summary>
+inline double GetElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+{
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/// <summary>
+/// 引数を整数として取得する
+/// </summary>
+/// <param name="argc">引数の数</param>
+/// <param name="argv">引数</param>
+/// <param name="index">取得する引数の番号</param>
+/// <param name="defaultValue">省略された場合の値</param>
+inline uint32_t GetBenchmarkArgument(int argc, char** argv, int index, uint32_t defaultValue)
+{
+	return (index < argc) ? uint32_t(strtoul(argv[index], nullptr, 10)) : defaultValue;
+}
+
+//-----------------------------------------------------------------------------
+// 各ベンチマーク. argv はベンチマーク名に続く引数で, 結果はログに出力する
+//-----------------------------------------------------------------------------
+bool RunAtlasPackBenchmark(int argc, char** argv);
+bool RunBloomBenchmark(int argc, char** argv);
+bool RunClusterLightBenchmark(int argc, char** argv);
+bool RunDrawKeySortBenchmark(int argc, char** argv);
+bool RunFrameGraphBenchmark(int argc, char** argv);
+bool RunHDRImageLoaderBenchmark(int argc, char** argv);
+bool RunIndirectDrawBenchmark(int argc, char** argv);
+bool RunShadowAtlasBenchmark(int argc, char** argv);
+bool RunSphereMapBenchmark(int argc, char** argv);
+bool RunTonemapLUTBenchmark(int argc, char** argv);
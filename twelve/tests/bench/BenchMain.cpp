@@ -0,0 +1,75 @@
+﻿#include <cstdio>
+#include <cstring>
+
+#include "Bench.h"
+
+namespace
+{
+	/// <summary>
+	/// ベンチマークの登録情報
+	/// </summary>
+	struct Benchmark
+	{
+		const char*	Name;
+		const char*	Usage;
+		bool		RequiresArgument;	// 引数を省略できない場合はtrue (all では実行しない)
+		bool		(*Run)(int argc, char** argv);
+	};
+
+	const Benchmark Benchmarks[] = {
+		{ "atlas", "[rectCount=256] [iterations=16] [seed=1]", false, RunAtlasPackBenchmark },
+		{ "bloom", "[width=1280] [height=720] [iterations=8]", false, RunBloomBenchmark },
+		{ "cluster", "[lightCount=4096] [seed=1]", false, RunClusterLightBenchmark },
+		{ "drawkey", "[count=1048576] [seed=1]", false, RunDrawKeySortBenchmark },
+		{ "framegraph", "[passCount=500] [iterations=16] [seed=1]", false, RunFrameGraphBenchmark },
+		{ "hdrimage", "<directory>", true, RunHDRImageLoaderBenchmark },
+		{ "indirect", "[drawCount=65536] [materialCount=64] [seed=1]", false, RunIndirectDrawBenchmark },
+		{ "shadowatlas", "[lightCount=1024] [frameCount=240] [seed=1]", false, RunShadowAtlasBenchmark },
+		{ "spheremap", "[maxSize=1024] [image.hdr|image.exr]", false, RunSphereMapBenchmark },
+		{ "tonemaplut", "[iterations=8]", false, RunTonemapLUTBenchmark },
+	};
+
+	void PrintUsage()
+	{
+		printf("usage: twelve_bench <name> [args...]\n");
+		printf("       twelve_bench all\n\n");
+		for (const auto& benchmark : Benchmarks)
+		{
+			printf("  %-12s %s\n", benchmark.Name, benchmark.Usage);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// 引数を省略できるものを全て既定値で実行する
+	if (strcmp(argv[1], "all") == 0)
+	{
+		auto succeeded = true;
+		for (const auto& benchmark : Benchmarks)
+		{
+			if (!benchmark.RequiresArgument)
+			{
+				succeeded &= benchmark.Run(0, nullptr);
+			}
+		}
+		return succeeded ? 0 : 1;
+	}
+
+	for (const auto& benchmark : Benchmarks)
+	{
+		if (strcmp(argv[1], benchmark.Name) == 0)
+		{
+			return benchmark.Run(argc - 2, argv + 2) ? 0 : 1;
+		}
+	}
+
+	PrintUsage();
+	return 1;
+}
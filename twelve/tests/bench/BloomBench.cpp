@@ -0,0 +1,93 @@
+﻿#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "BloomCPU.h"
+#include "Logger.h"
+#include "ParallelFor.h"
+
+using namespace DirectX;
+
+bool RunBloomBenchmark(int argc, char** argv)
+{
+	auto width = std::max(GetBenchmarkArgument(argc, argv, 0, 1280), 2u);
+	auto height = std::max(GetBenchmarkArgument(argc, argv, 1, 720), 2u);
+	auto iterations = std::max(GetBenchmarkArgument(argc, argv, 2, 8), 1u);
+
+	// 暗い背景に明るい点光源を散らしたシーンを合成する
+	CpuImage scene;
+	scene.Resize(width, height);
+	{
+		std::mt19937 rng(1);
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+		for (auto& pixel : scene.Pixels)
+		{
+			auto value = dist(rng) * 0.5f;
+			pixel = XMFLOAT4(value, value, value, 1.0f);
+		}
+
+		for (auto i = 0u; i < (width * height) / 256; ++i)
+		{
+			auto x = uint32_t(dist(rng) * float(width - 1));
+			auto y = uint32_t(dist(rng) * float(height - 1));
+			auto value = 1.0f + dist(rng) * 15.0f;
+			scene.GetRow(y)[x] = XMFLOAT4(value, value * 0.8f, value * 0.6f, 1.0f);
+		}
+	}
+
+	BloomParam param;
+	param.LevelCount = BloomMaxLevelCount;
+
+	const uint32_t threadCounts[] = { 1, GetWorkerThreadCount() };
+
+	ILOG("Info : Bloom. %ux%u, %u iterations, %u taps", width, height, iterations, BloomTapCount);
+
+	for (auto threadCount : threadCounts)
+	{
+		std::vector<CpuImage> levels;
+		std::vector<BloomLevelTiming> total;
+
+		for (auto n = 0u; n < iterations; ++n)
+		{
+			std::vector<BloomLevelTiming> timings;
+			BuildBloomCPU(scene, param, levels, &timings, threadCount);
+
+			if (total.empty())
+			{
+				total = timings;
+				continue;
+			}
+
+			for (size_t i = 0; i < timings.size(); ++i)
+			{
+				total[i].DownsampleMs += timings[i].DownsampleMs;
+				total[i].BlurMs += timings[i].BlurMs;
+				total[i].UpsampleMs += timings[i].UpsampleMs;
+			}
+		}
+
+		auto sum = 0.0;
+		for (auto& timing : total)
+		{
+			sum += timing.DownsampleMs + timing.BlurMs + timing.UpsampleMs;
+		}
+		sum /= iterations;
+
+		ILOG("  %u threads : total %.3f ms", threadCount, sum);
+
+		for (size_t i = 0; i < total.size(); ++i)
+		{
+			auto down = total[i].DownsampleMs / iterations;
+			auto blur = total[i].BlurMs / iterations;
+			auto up = total[i].UpsampleMs / iterations;
+			auto level = down + blur + up;
+
+			ILOG("    Level %zu (%4ux%4u) : down %.3f ms, blur %.3f ms, up %.3f ms (%.1f %%)",
+				i, total[i].Width, total[i].Height, down, blur, up, (sum > 0.0) ? level * 100.0 / sum : 0.0);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,92 @@
+﻿#include <algorithm>
+#include <cstring>
+
+#include "Bench.h"
+#include "ClusterLightScene.h"
+#include "Logger.h"
+
+namespace
+{
+	/// <summary>
+	/// ライトの割り当てをデバイスなしで計測してログに出力する
+	/// 1つずつ判定した結果と, SIMDとワーカースレッドで判定した結果が一致することも確かめる
+	/// </summary>
+	/// <param name="lightCount">ライトの数</param>
+	/// <param name="seed">乱数シード</param>
+	/// <returns>結果が一致した場合はtrue</returns>
+	bool BenchmarkClusterLightAssignment(uint32_t lightCount, uint32_t seed)
+	{
+		if (lightCount == 0)
+		{
+			ELOG("Error : Invalid Argument.");
+			return false;
+		}
+
+		ClusterGridDesc desc;
+		auto scene = BuildClusterLightScene(desc, lightCount, seed);
+		const auto* pLights = scene.Lights.data();
+
+		ClusterBounds bounds;
+		auto start = std::chrono::steady_clock::now();
+		BuildClusterBounds(scene.Proj, desc, bounds);
+		auto boundsMs = GetElapsedMilliseconds(start);
+
+		ClusterLightGrid reference;
+		start = std::chrono::steady_clock::now();
+		AssignClusterLightsReference(bounds, desc, scene.View, pLights, lightCount, reference);
+		auto referenceMs = GetElapsedMilliseconds(start);
+
+		// 作業領域の確保を除くため, 1回割り当ててから計測する
+		ClusterLightGrid serial;
+		AssignClusterLights(bounds, desc, scene.View, pLights, lightCount, serial, 1);
+		start = std::chrono::steady_clock::now();
+		AssignClusterLights(bounds, desc, scene.View, pLights, lightCount, serial, 1);
+		auto serialMs = GetElapsedMilliseconds(start);
+
+		ClusterLightGrid parallel;
+		AssignClusterLights(bounds, desc, scene.View, pLights, lightCount, parallel);
+		start = std::chrono::steady_clock::now();
+		AssignClusterLights(bounds, desc, scene.View, pLights, lightCount, parallel);
+		auto parallelMs = GetElapsedMilliseconds(start);
+
+		auto result = true;
+		for (const auto* pGrid : { &serial, &parallel })
+		{
+			if (pGrid->OverflowCount != reference.OverflowCount
+				|| pGrid->LightIndices != reference.LightIndices
+				|| memcmp(pGrid->Ranges.data(), reference.Ranges.data(), sizeof(ClusterRange) * reference.Ranges.size()) != 0)
+			{
+				ELOG("Error : Cluster Light Assignment Mismatch.");
+				result = false;
+			}
+		}
+
+		uint32_t maxCount = 0;
+		for (const auto& range : reference.Ranges)
+		{
+			maxCount = std::max(maxCount, range.Count);
+		}
+
+		ILOG("Info : Cluster Light Assignment (%u lights, %u clusters) : bounds = %.3f ms, reference = %.3f ms, simd = %.3f ms, simd parallel = %.3f ms",
+			lightCount,
+			desc.GetClusterCount(),
+			boundsMs,
+			referenceMs,
+			serialMs,
+			parallelMs);
+		ILOG("Info : Cluster Light Lists : indices = %zu, average = %.2f, max = %u, overflow = %u",
+			reference.LightIndices.size(),
+			double(reference.LightIndices.size()) / desc.GetClusterCount(),
+			maxCount,
+			reference.OverflowCount);
+
+		return result;
+	}
+}
+
+bool RunClusterLightBenchmark(int argc, char** argv)
+{
+	return BenchmarkClusterLightAssignment(
+		GetBenchmarkArgument(argc, argv, 0, 4096),
+		GetBenchmarkArgument(argc, argv, 1, 1));
+}
@@ -0,0 +1,86 @@
+﻿#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "DrawSortKey.h"
+#include "Logger.h"
+#include "ParallelFor.h"
+
+namespace
+{
+	/// <summary>
+	/// 描画ソートキーの並べ替えを計測してログに出力する
+	/// std::sort, RadixSortDrawKeys(), RadixSortDrawKeysParallel() の時間と, 並べ替え前後の状態の切り替え回数を比較する
+	/// </summary>
+	/// <param name="count">キーの数</param>
+	/// <param name="seed">乱数シード</param>
+	/// <returns>並べ替えの結果が一致した場合はtrue</returns>
+	bool BenchmarkDrawKeySort(uint32_t count, uint32_t seed)
+	{
+		if (count == 0)
+		{
+			ELOG("Error : Invalid Argument.");
+			return false;
+		}
+
+		// 数パス, 数十のパイプライン, 千程度のマテリアルに分散したシーンを想定する
+		std::mt19937 rng(seed);
+		std::vector<uint64_t> source(count);
+		for (auto i = 0u; i < count; ++i)
+		{
+			DrawKeyFields fields;
+			fields.Pass = rng() % 3;
+			fields.Pipeline = rng() % 32;
+			fields.Material = rng() % 1024;
+			fields.Depth = rng() % (1u << DrawKeyDepthBits);
+			fields.Mesh = i;
+			source[i] = EncodeDrawKey(fields);
+		}
+
+		auto reference = source;
+		auto start = std::chrono::steady_clock::now();
+		std::sort(reference.begin(), reference.end());
+		auto stdMs = GetElapsedMilliseconds(start);
+
+		std::vector<uint64_t> work;
+
+		auto serial = source;
+		start = std::chrono::steady_clock::now();
+		RadixSortDrawKeys(serial, work);
+		auto serialMs = GetElapsedMilliseconds(start);
+
+		auto parallel = source;
+		start = std::chrono::steady_clock::now();
+		RadixSortDrawKeysParallel(parallel, work);
+		auto parallelMs = GetElapsedMilliseconds(start);
+
+		auto result = true;
+		if (serial != reference || parallel != reference)
+		{
+			ELOG("Error : Radix Sort Result Mismatch. serial = %s, parallel = %s",
+				(serial == reference) ? "OK" : "NG",
+				(parallel == reference) ? "OK" : "NG");
+			result = false;
+		}
+
+		auto before = CountDrawStateChanges(source.data(), source.size());
+		auto after = CountDrawStateChanges(reference.data(), reference.size());
+
+		ILOG("Info : Draw Key Sort (%u keys) : std::sort = %.2f ms, radix = %.2f ms, radix parallel = %.2f ms (%u threads)",
+			count, stdMs, serialMs, parallelMs, GetWorkerThreadCount());
+		ILOG("Info : Draw State Changes : pass %u -> %u, pipeline %u -> %u, material %u -> %u",
+			before.Pass, after.Pass,
+			before.Pipeline, after.Pipeline,
+			before.Material, after.Material);
+
+		return result;
+	}
+}
+
+bool RunDrawKeySortBenchmark(int argc, char** argv)
+{
+	return BenchmarkDrawKeySort(
+		GetBenchmarkArgument(argc, argv, 0, 1u << 20),
+		GetBenchmarkArgument(argc, argv, 1, 1));
+}
@@ -0,0 +1,65 @@
+﻿#include <algorithm>
+
+#include "Bench.h"
+#include "FrameGraph.h"
+#include "Logger.h"
+#include "RandomFrameGraph.h"
+
+namespace
+{
+	/// <summary>
+	/// ランダムに生成したグラフでコンパイル時間と統計値を計測してログに出力する
+	/// </summary>
+	/// <param name="passCount">パス数</param>
+	/// <param name="iterations">繰り返し回数</param>
+	/// <param name="seed">乱数のシード</param>
+	bool BenchmarkFrameGraph(uint32_t passCount, uint32_t iterations, uint32_t seed)
+	{
+		passCount = std::max(passCount, 2u);
+		iterations = std::max(iterations, 1u);
+
+		double buildTime = 0.0;
+		double compileTime = 0.0;
+		auto valid = true;
+		FrameGraph graph;
+
+		for (auto n = 0u; n < iterations; ++n)
+		{
+			// 毎回同じグラフを構築する (フレームごとに構築し直す使い方を想定)
+			auto start = std::chrono::steady_clock::now();
+			BuildRandomFrameGraph(graph, passCount, seed);
+			buildTime += GetElapsedMilliseconds(start);
+
+			start = std::chrono::steady_clock::now();
+			if (!graph.Compile())
+			{
+				ELOG("Error : FrameGraph::Compile() Failed.");
+				return false;
+			}
+			compileTime += GetElapsedMilliseconds(start);
+
+			valid = valid && graph.Validate();
+		}
+
+		auto& stats = graph.GetStats();
+
+		ILOG("FrameGraph Benchmark : %u passes, %u iterations", passCount, iterations);
+		ILOG("  build %.3f ms, compile %.3f ms, validation %s", buildTime / iterations, compileTime / iterations, valid ? "OK" : "NG");
+		ILOG("  passes %u (culled %u), resources %u (culled %u)",
+			stats.PassCount, stats.CulledPassCount, stats.ResourceCount, stats.CulledResourceCount);
+		ILOG("  transitions %u (split %u, merged reads %u), aliasing %u, batches %u",
+			stats.TransitionCount, stats.SplitBarrierCount, stats.MergedReadCount, stats.AliasingBarrierCount, stats.BarrierBatchCount);
+		ILOG("  heap %.2f MB (unaliased %.2f MB)",
+			double(stats.HeapSize) / (1024.0 * 1024.0), double(stats.UnaliasedSize) / (1024.0 * 1024.0));
+
+		return valid;
+	}
+}
+
+bool RunFrameGraphBenchmark(int argc, char** argv)
+{
+	return BenchmarkFrameGraph(
+		GetBenchmarkArgument(argc, argv, 0, 500),
+		GetBenchmarkArgument(argc, argv, 1, 16),
+		GetBenchmarkArgument(argc, argv, 2, 1));
+}
@@ -0,0 +1,114 @@
+﻿#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "Bench.h"
+#include "HDRImageLoader.h"
+#include "Logger.h"
+#include "ParallelFor.h"
+
+namespace
+{
+	/// <summary>
+	/// ファイルの内容を全て読み込む
+	/// </summary>
+	bool ReadFileData(const std::filesystem::path& path, std::vector<uint8_t>& data)
+	{
+		std::ifstream stream(path, std::ios::binary | std::ios::ate);
+		if (!stream)
+		{
+			return false;
+		}
+
+		auto size = size_t(stream.tellg());
+		stream.seekg(0, std::ios::beg);
+
+		data.resize(size);
+		return size == 0 || bool(stream.read(reinterpret_cast<char*>(data.data()), std::streamsize(size)));
+	}
+
+	/// <summary>
+	/// ディレクトリ以下の .hdr / .exr ファイルの復号時間を1スレッドと全スレッドで計測してログに出力する
+	/// </summary>
+	/// <param name="directory">検索するディレクトリ</param>
+	/// <returns>ディレクトリが存在し, 全てのファイルを復号できた場合はtrue</returns>
+	bool BenchmarkHDRImageLoader(const std::filesystem::path& directory)
+	{
+		std::error_code ec;
+		if (!std::filesystem::is_directory(directory, ec))
+		{
+			ELOG("Error : Directory Not Found. path = %s", directory.string().c_str());
+			return false;
+		}
+
+		auto threads = GetWorkerThreadCount();
+		ILOG("Info : HDR Image Loader. directory = %s, threads = %u", directory.string().c_str(), threads);
+
+		auto result = true;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, ec))
+		{
+			const auto& path = entry.path();
+			if (!entry.is_regular_file() || !IsHDRImageFile(path.wstring().c_str()))
+			{
+				continue;
+			}
+
+			// ファイル読み込みは計測に含めない
+			std::vector<uint8_t> data;
+			if (!ReadFileData(path, data))
+			{
+				ELOG("Error : File Read Failed. path = %s", path.string().c_str());
+				result = false;
+				continue;
+			}
+
+			auto extension = path.extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(tolower(c)); });
+
+			auto isEXR = (extension == ".exr");
+			CpuImageHalf image;
+
+			auto decode = [&](uint32_t threadCount)
+			{
+				return isEXR
+					? DecodeEXR(data.data(), data.size(), image, threadCount)
+					: DecodeRGBE(data.data(), data.size(), image, threadCount);
+			};
+
+			auto start = std::chrono::steady_clock::now();
+			if (!decode(1))
+			{
+				result = false;
+				continue;
+			}
+			auto single = GetElapsedMilliseconds(start);
+
+			start = std::chrono::steady_clock::now();
+			decode(threads);
+			auto multi = GetElapsedMilliseconds(start);
+
+			auto pixels = double(image.Width) * image.Height;
+			auto megaBytes = double(data.size()) / (1024.0 * 1024.0);
+
+			ILOG("  %s : %ux%u, %.1f MB, 1 thread = %8.2f ms, %2u threads = %8.2f ms (x%.2f), %.1f Mpixel/s, %.1f MB/s",
+				path.filename().string().c_str(), image.Width, image.Height, megaBytes,
+				single, threads, multi, single / multi,
+				pixels / (multi * 1000.0), megaBytes / (multi / 1000.0));
+		}
+
+		return result;
+	}
+}
+
+bool RunHDRImageLoaderBenchmark(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	return BenchmarkHDRImageLoader(std::filesystem::path(argv[0]));
+}
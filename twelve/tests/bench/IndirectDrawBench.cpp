@@ -0,0 +1,118 @@
+﻿#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "DrawSortKey.h"
+#include "IndirectDrawArgs.h"
+#include "Logger.h"
+
+namespace
+{
+	// 直接描画での1描画あたりのAPI呼び出し数 (描画番号, トポロジー, 頂点バッファ, インデックスバッファ, 描画)
+	constexpr uint32_t DirectCallsPerDraw = 5;
+
+	// マテリアルの切り替えで設定するディスクリプタテーブルの数
+	constexpr uint32_t TablesPerMaterial = 3;
+
+	/// <summary>
+	/// 引数レコードの作成をデバイスなしで計測してログに出力する
+	/// 直接描画と間接描画で記録するAPI呼び出しの数も比較する
+	/// </summary>
+	/// <param name="drawCount">描画数</param>
+	/// <param name="materialCount">マテリアル数</param>
+	/// <param name="seed">乱数シード</param>
+	/// <returns>逐次と並列の結果が一致した場合はtrue</returns>
+	bool BenchmarkIndirectDrawArgs(uint32_t drawCount, uint32_t materialCount, uint32_t seed)
+	{
+		if (drawCount == 0 || drawCount > (1u << DrawKeyMeshBits) || materialCount == 0)
+		{
+			ELOG("Error : Invalid Argument.");
+			return false;
+		}
+
+		std::mt19937 rng(seed);
+
+		// メッシュごとの元データ (アドレスは実在しないがレコードの作成には影響しない)
+		std::vector<IndirectDrawSource> sources(drawCount);
+		for (auto i = 0u; i < drawCount; ++i)
+		{
+			auto vertexCount = 64 + rng() % 4096;
+			auto indexCount = 3 * (32 + rng() % 8192);
+
+			sources[i].VertexBuffer.BufferLocation = 0x100000000ull + uint64_t(i) * 0x100000ull;
+			sources[i].VertexBuffer.SizeInBytes = vertexCount * 44;
+			sources[i].VertexBuffer.StrideInBytes = 44;
+			sources[i].InstanceBuffer.BufferLocation = 0x400000000ull + uint64_t(i) * 0x1000ull;
+			sources[i].InstanceBuffer.SizeInBytes = 64;
+			sources[i].InstanceBuffer.StrideInBytes = 64;
+			sources[i].IndexBuffer.BufferLocation = 0x800000000ull + uint64_t(i) * 0x100000ull;
+			sources[i].IndexBuffer.SizeInBytes = indexCount * sizeof(uint32_t);
+			sources[i].IndexBuffer.Format = DXGI_FORMAT_R32_UINT;
+			sources[i].IndexCount = indexCount;
+			sources[i].MaterialId = i % materialCount;
+		}
+
+		std::vector<uint64_t> keys(drawCount);
+		for (auto i = 0u; i < drawCount; ++i)
+		{
+			DrawKeyFields fields;
+			fields.Material = i % materialCount;
+			fields.Depth = rng() % (1u << DrawKeyDepthBits);
+			fields.Mesh = i;
+			keys[i] = EncodeDrawKey(fields);
+		}
+
+		std::vector<uint64_t> work;
+		RadixSortDrawKeysParallel(keys, work);
+
+		std::vector<IndirectDrawBucket> buckets;
+		auto start = std::chrono::steady_clock::now();
+		BuildIndirectDrawBuckets(keys.data(), keys.size(), buckets);
+		auto bucketMs = GetElapsedMilliseconds(start);
+
+		std::vector<IndirectDrawArgs> serial(drawCount);
+		start = std::chrono::steady_clock::now();
+		WriteIndirectDrawArgs(keys.data(), 0, keys.size(), sources.data(), serial.data());
+		auto serialMs = GetElapsedMilliseconds(start);
+
+		std::vector<IndirectDrawArgs> parallel(drawCount);
+		start = std::chrono::steady_clock::now();
+		WriteIndirectDrawArgsParallel(keys.data(), keys.size(), sources.data(), parallel.data());
+		auto parallelMs = GetElapsedMilliseconds(start);
+
+		auto result = true;
+		if (memcmp(serial.data(), parallel.data(), sizeof(IndirectDrawArgs) * drawCount) != 0)
+		{
+			ELOG("Error : Indirect Draw Args Mismatch.");
+			result = false;
+		}
+
+		std::vector<IndirectDrawBucket> bindlessBuckets;
+		BuildIndirectDrawBuckets(keys.data(), keys.size(), bindlessBuckets, false);
+
+		auto bucketCount = uint32_t(buckets.size());
+		auto directCalls = drawCount * DirectCallsPerDraw + bucketCount * TablesPerMaterial;
+		auto indirectCalls = bucketCount * (1 + TablesPerMaterial);
+		auto bindlessCalls = uint32_t(bindlessBuckets.size());
+
+		ILOG("Info : Indirect Draw Args (%u draws, %u buckets) : bucket = %.3f ms, write = %.3f ms, write parallel = %.3f ms (%.1f MB)",
+			drawCount,
+			bucketCount,
+			bucketMs,
+			serialMs,
+			parallelMs,
+			double(sizeof(IndirectDrawArgs)) * drawCount / (1024.0 * 1024.0));
+		ILOG("Info : Indirect Draw API Calls : direct = %u, indirect = %u, indirect bindless = %u", directCalls, indirectCalls, bindlessCalls);
+
+		return result;
+	}
+}
+
+bool RunIndirectDrawBenchmark(int argc, char** argv)
+{
+	return BenchmarkIndirectDrawArgs(
+		GetBenchmarkArgument(argc, argv, 0, 1u << 16),
+		GetBenchmarkArgument(argc, argv, 1, 64),
+		GetBenchmarkArgument(argc, argv, 2, 1));
+}
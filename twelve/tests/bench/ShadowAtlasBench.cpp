@@ -0,0 +1,255 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "Logger.h"
+#include "ShadowAtlasCache.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 割り当てとキャッシュの更新をデバイスなしで計測してログに出力する
+	/// 割り当てたタイルが重ならないことと, カメラが止まっている間は描画し直さないことも確かめる
+	/// </summary>
+	/// <param name="lightCount">ライトの数</param>
+	/// <param name="frameCount">計測するフレーム数 (前半でカメラを回し, 後半で止める. 2 * (RetainFrames + 3) 以上)</param>
+	/// <param name="seed">乱数シード</param>
+	/// <returns>確認が全て成功した場合はtrue</returns>
+	bool BenchmarkShadowAtlas(uint32_t lightCount, uint32_t frameCount, uint32_t seed)
+	{
+		// カメラが止まった後に, 保持期間が過ぎて静止状態になり, ライトを1つ変化させて描画し直すまでのフレームが必要
+		ShadowAtlasSettings settings;
+		auto minFrameCount = 2 * (settings.RetainFrames + 3);
+		if (frameCount < minFrameCount)
+		{
+			ELOG("Error : frameCount must be at least %u for the cache to settle. (frameCount = %u)", minFrameCount, frameCount);
+			return false;
+		}
+
+		auto succeeded = true;
+
+		// 割り当てと解放を繰り返し, 全て解放すると根が空くことを確かめる
+		{
+			ShadowAtlasAllocator allocator;
+			if (!allocator.Init(4096, 64))
+			{
+				return false;
+			}
+
+			std::mt19937 rng(seed);
+			std::uniform_int_distribution<uint32_t> sizeDist(0, 4);
+			std::vector<uint32_t> nodes;
+
+			const auto opCount = 100000u;
+			auto start = std::chrono::steady_clock::now();
+			for (auto i = 0u; i < opCount; ++i)
+			{
+				if (!nodes.empty() && (rng() & 1))
+				{
+					auto slot = rng() % nodes.size();
+					allocator.Free(nodes[slot]);
+					nodes[slot] = nodes.back();
+					nodes.pop_back();
+				}
+				else
+				{
+					auto node = allocator.Allocate(64u << sizeDist(rng));
+					if (node != ShadowAtlasInvalidNode)
+					{
+						nodes.push_back(node);
+					}
+				}
+			}
+			auto opMs = GetElapsedMilliseconds(start);
+
+			for (auto node : nodes)
+			{
+				allocator.Free(node);
+			}
+
+			auto root = allocator.Allocate(4096);
+			if (allocator.GetUsedArea() != 4096ull * 4096ull || root == ShadowAtlasInvalidNode)
+			{
+				ELOG("Error : Shadow atlas nodes were not merged after freeing all tiles.");
+				succeeded = false;
+			}
+
+			ILOG("Info : Shadow Atlas Allocator. ops = %u, time = %.3f ms (%.1f ns/op)", opCount, opMs, opMs * 1e6 / opCount);
+		}
+
+		// ライトを並べ, カメラが回る間と止まった後でキャッシュを更新する
+		ShadowAtlasCache cache;
+		if (!cache.Init(settings, lightCount))
+		{
+			return false;
+		}
+
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<XMFLOAT3> positions(lightCount);
+		std::vector<float> radii(lightCount);
+		std::vector<float> importances(lightCount);
+		std::vector<uint32_t> versions(lightCount, 0);
+		for (auto i = 0u; i < lightCount; ++i)
+		{
+			positions[i] = XMFLOAT3(4.0f * unit(rng) - 2.0f, 2.0f * unit(rng) - 0.5f, 4.0f * unit(rng) - 2.0f);
+			radii[i] = 0.1f + 0.2f * unit(rng);
+			importances[i] = 0.5f + unit(rng);
+		}
+
+		XMFLOAT4X4 proj;
+		XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovRH(XMConvertToRadians(37.5f), 16.0f / 9.0f, 0.1f, 1000.0f));
+
+		const auto screenHeight = 720.0f;
+		const auto renderBudget = 8u;
+		auto moveFrames = frameCount / 2;
+
+		std::vector<ShadowLightRequest> requests;
+		std::vector<uint32_t> renderList;
+		std::vector<uint8_t> occupancy;
+
+		auto cellCount = settings.AtlasSize / settings.MinTileSize;
+		auto totalMs = 0.0;
+		auto maxMs = 0.0;
+		auto renderCount = 0u;
+		auto staticRenderCount = 0u;
+		auto drained = false;
+		auto changedLight = UINT32_MAX;
+		auto changedRendered = false;
+
+		for (auto frame = 0u; frame < frameCount; ++frame)
+		{
+			auto angle = 0.02f * float(std::min(frame, moveFrames));
+			auto eye = XMVectorSet(2.5f * sinf(angle), 0.8f, 2.5f * cosf(angle), 1.0f);
+
+			XMFLOAT4X4 view;
+			XMStoreFloat4x4(&view, XMMatrixLookAtRH(eye, XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+
+			// 止まってから描画待ちがなくなった後, 1つのライトを変化させる
+			if (drained && changedLight == UINT32_MAX)
+			{
+				for (auto i = 0u; i < lightCount; ++i)
+				{
+					if (cache.IsReady(i))
+					{
+						changedLight = i;
+						++versions[i];
+						break;
+					}
+				}
+			}
+
+			auto start = std::chrono::steady_clock::now();
+
+			requests.clear();
+			for (auto i = 0u; i < lightCount; ++i)
+			{
+				auto coverage = ComputeShadowLightCoverage(view, proj, positions[i], radii[i]);
+				auto request = ComputeShadowLightRequest(settings, i, versions[i], coverage, importances[i], screenHeight);
+				if (request.Size > 0)
+				{
+					requests.push_back(request);
+				}
+			}
+
+			cache.Update(requests.data(), uint32_t(requests.size()), renderBudget, renderList);
+
+			auto ms = GetElapsedMilliseconds(start);
+			totalMs += ms;
+			maxMs = std::max(maxMs, ms);
+			renderCount += uint32_t(renderList.size());
+
+			if (frame >= moveFrames)
+			{
+				if (drained && changedLight != UINT32_MAX)
+				{
+					// 変化させたライトだけが描画し直される
+					for (auto id : renderList)
+					{
+						if (id == changedLight)
+						{
+							changedRendered = true;
+						}
+						else
+						{
+							++staticRenderCount;
+						}
+					}
+				}
+
+				// 見えなくなったライトの解放で空いた領域による拡大が終わった後を静止状態とする
+				drained |= (frame > moveFrames + settings.RetainFrames && cache.GetStats().PendingCount == 0 && renderList.empty());
+			}
+
+			// 割り当てたタイルがアトラスからはみ出さず, 互いに重ならないことを確かめる
+			occupancy.assign(size_t(cellCount) * cellCount, 0);
+			for (auto i = 0u; i < lightCount; ++i)
+			{
+				auto tile = cache.GetTile(i);
+				if (tile.Size == 0)
+				{
+					continue;
+				}
+
+				if (tile.X + tile.Size > settings.AtlasSize || tile.Y + tile.Size > settings.AtlasSize)
+				{
+					ELOG("Error : Shadow atlas tile is out of range. (light = %u)", i);
+					succeeded = false;
+					continue;
+				}
+
+				for (auto y = tile.Y / settings.MinTileSize; y < (tile.Y + tile.Size) / settings.MinTileSize; ++y)
+				{
+					for (auto x = tile.X / settings.MinTileSize; x < (tile.X + tile.Size) / settings.MinTileSize; ++x)
+					{
+						auto& cell = occupancy[size_t(y) * cellCount + x];
+						if (cell != 0)
+						{
+							ELOG("Error : Shadow atlas tiles overlap. (light = %u, frame = %u)", i, frame);
+							succeeded = false;
+						}
+						cell = 1;
+					}
+				}
+			}
+		}
+
+		if (!drained || changedLight == UINT32_MAX)
+		{
+			// 描画待ちが残っている場合は再描画の確認ができないので, 別の結果として扱う
+			ELOG("Error : Shadow atlas cache did not settle within %u frames. (pending = %u)", frameCount, cache.GetStats().PendingCount);
+			succeeded = false;
+		}
+		else if (!changedRendered || staticRenderCount != 0)
+		{
+			ELOG("Error : Shadow atlas cache re-rendered unchanged lights. (changed = %d, extra = %u)",
+				changedRendered ? 1 : 0, staticRenderCount);
+			succeeded = false;
+		}
+
+		const auto& stats = cache.GetStats();
+		ILOG("Info : Shadow Atlas Cache. lights = %u, frames = %u, update = %.3f ms (max %.3f ms), renders = %u, allocated = %u, usage = %.1f %%",
+			lightCount,
+			frameCount,
+			totalMs / std::max(frameCount, 1u),
+			maxMs,
+			renderCount,
+			stats.AllocatedCount,
+			100.0 * double(stats.UsedArea) / (double(settings.AtlasSize) * settings.AtlasSize));
+
+		return succeeded;
+	}
+}
+
+bool RunShadowAtlasBenchmark(int argc, char** argv)
+{
+	return BenchmarkShadowAtlas(
+		GetBenchmarkArgument(argc, argv, 0, 1024),
+		GetBenchmarkArgument(argc, argv, 1, 240),
+		GetBenchmarkArgument(argc, argv, 2, 1));
+}
@@ -0,0 +1,103 @@
+﻿#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <string>
+
+#include "Bench.h"
+#include "HDRImageLoader.h"
+#include "Logger.h"
+#include "ParallelFor.h"
+#include "SphereMapProjection.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	/// <summary>
+	/// 空のようなグラデーションのスフィアマップを作る
+	/// </summary>
+	void CreateSphereMap(uint32_t width, CpuImage& image)
+	{
+		image.Resize(width, width / 2);
+
+		for (auto y = 0u; y < image.Height; ++y)
+		{
+			auto row = image.GetRow(y);
+			auto v = (float(y) + 0.5f) / float(image.Height);
+
+			for (auto x = 0u; x < image.Width; ++x)
+			{
+				auto u = (float(x) + 0.5f) / float(image.Width);
+				auto sun = powf(std::max(0.0f, cosf(XM_2PI * (u - 0.3f)) * sinf(XM_PI * v)), 64.0f);
+				row[x] = XMFLOAT4(0.2f + 0.8f * (1.0f - v) + 20.0f * sun, 0.4f + 0.6f * (1.0f - v) + 18.0f * sun, 1.0f - 0.5f * v + 15.0f * sun, 1.0f);
+			}
+		}
+	}
+
+	/// <summary>
+	/// .hdr / .exr を RGBA32F で読み込む
+	/// </summary>
+	bool LoadSphereMap(const char* path, CpuImage& image)
+	{
+		CpuImageHalf half;
+		if (!LoadHDRImage(std::filesystem::path(path).wstring().c_str(), half))
+		{
+			return false;
+		}
+
+		image.Resize(half.Width, half.Height);
+		XMConvertHalfToFloatStream(&image.Pixels[0].x, sizeof(float), half.Pixels.data(), sizeof(HALF), half.Pixels.size());
+
+		return true;
+	}
+
+	/// <summary>
+	/// 解像度ごとの変換時間を計測してログに出力する
+	/// </summary>
+	/// <param name="sphereMap">スフィアマップ</param>
+	/// <param name="maxSize">計測する最大のキューブマップサイズ</param>
+	void BenchmarkSphereMapConverter(const CpuImage& sphereMap, uint32_t maxSize)
+	{
+		ILOG("Info : Sphere Map Converter. source = %ux%u, threads = %u",
+			sphereMap.Width, sphereMap.Height, GetWorkerThreadCount());
+
+		for (auto size = 64u; size <= maxSize; size <<= 1)
+		{
+			CpuCubeMap cube;
+
+			auto start = std::chrono::steady_clock::now();
+			ConvertSphereMapToCube(sphereMap, size, cube);
+			auto elapsed = GetElapsedMilliseconds(start);
+
+			auto texels = 6.0 * double(size) * double(size);
+			ILOG("  size = %4u, mips = %2u, time = %8.3f ms, %.1f Mtexel/s",
+				size, cube.MipCount, elapsed, texels / (elapsed * 1000.0));
+		}
+	}
+}
+
+bool RunSphereMapBenchmark(int argc, char** argv)
+{
+	auto maxSize = GetBenchmarkArgument(argc, argv, 0, 1024);
+
+	// 画像を指定しない場合は 4096x2048 の合成画像を使う
+	CpuImage sphereMap;
+	if (argc >= 2)
+	{
+		if (!LoadSphereMap(argv[1], sphereMap))
+		{
+			ELOG("Error : LoadHDRImage() Failed. path = %s", argv[1]);
+			return false;
+		}
+	}
+	else
+	{
+		CreateSphereMap(4096, sphereMap);
+	}
+
+	BenchmarkSphereMapConverter(sphereMap, maxSize);
+
+	return true;
+}
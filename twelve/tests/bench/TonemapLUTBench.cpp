@@ -0,0 +1,84 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Bench.h"
+#include "Logger.h"
+#include "ParallelFor.h"
+#include "TonemapLUTBaker.h"
+
+using namespace DirectX;
+
+bool RunTonemapLUTBenchmark(int argc, char** argv)
+{
+	auto iterations = std::max(GetBenchmarkArgument(argc, argv, 0, 8), 1u);
+
+	const uint32_t sizes[] = { TonemapLUTSizeSDR, TonemapLUTSizeHDR };
+	const int types[] = { TONEMAP_NONE, TONEMAP_REINHARD, TONEMAP_GT };
+	const char* typeNames[] = { "None", "Reinhard", "GT" };
+	const int colorSpaces[] = { COLOR_SPACE_BT709, COLOR_SPACE_BT2100_PQ };
+	const char* colorSpaceNames[] = { "BT.709", "BT.2100 PQ" };
+
+	ILOG("Info : Tonemap LUT. %u iterations, threads = %u", iterations, GetWorkerThreadCount());
+
+	for (auto size : sizes)
+	{
+		for (auto c = 0; c < 2; ++c)
+		{
+			for (auto t = 0; t < 3; ++t)
+			{
+				TonemapParam param;
+				param.Type = types[t];
+				param.ColorSpace = colorSpaces[c];
+				param.BaseLuminance = 100.0f;
+				param.MaxLuminance = (colorSpaces[c] == COLOR_SPACE_BT2100_PQ) ? 1000.0f : 100.0f;
+
+				std::vector<uint16_t> texels;
+
+				// SIMD版 (並列)
+				auto start = std::chrono::steady_clock::now();
+				for (auto i = 0u; i < iterations; ++i)
+				{
+					BakeTonemapLUT(param, size, texels);
+				}
+				auto simdTime = GetElapsedMilliseconds(start) / iterations;
+
+				// 基準実装 (1スレッド)
+				start = std::chrono::steady_clock::now();
+				{
+					auto domain = GetTonemapLUTDomain(param.ColorSpace);
+					auto scale = (domain.Log2Max - domain.Log2Min) / float(size - 1);
+
+					std::vector<float> values(size_t(size) * size * size * 3);
+					auto index = 0u;
+					for (auto b = 0u; b < size; ++b)
+					{
+						for (auto g = 0u; g < size; ++g)
+						{
+							for (auto r = 0u; r < size; ++r)
+							{
+								XMFLOAT3 color(
+									std::exp2(domain.Log2Min + r * scale) - domain.GetOffset(),
+									std::exp2(domain.Log2Min + g * scale) - domain.GetOffset(),
+									std::exp2(domain.Log2Min + b * scale) - domain.GetOffset());
+								auto value = EvaluateTonemapReference(param, color);
+								values[index++] = value.x;
+								values[index++] = value.y;
+								values[index++] = value.z;
+							}
+						}
+					}
+				}
+				auto referenceTime = GetElapsedMilliseconds(start);
+
+				auto error = ValidateTonemapLUT(param, texels, size);
+
+				ILOG("  %u^3 %-10s %-8s : bake %.3f ms (reference %.3f ms), max error %.5f (%.2f LSB8, %.2f LSB10), RMSE %.6f",
+					size, colorSpaceNames[c], typeNames[t], simdTime, referenceTime,
+					error.MaxError, error.MaxErrorLSB8, error.MaxErrorLSB10, error.RMSE);
+			}
+		}
+	}
+
+	return true;
+}
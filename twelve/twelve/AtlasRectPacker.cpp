@@ -0,0 +1,303 @@
+﻿#include "AtlasRectPacker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "Logger.h"
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imgui/imstb_rectpack.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 経過時間をミリ秒で取得する
+	/// </summary>
+	double GetElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	/// <summary>
+	/// 値を指定の倍数に切り上げる
+	/// </summary>
+	uint32_t AlignUp(uint32_t value, uint32_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	/// <summary>
+	/// 値以上の最小の2の累乗を求める
+	/// </summary>
+	uint32_t NextPow2(uint32_t value)
+	{
+		uint32_t result = 1;
+		while (result < value)
+		{
+			result <<= 1;
+		}
+		return result;
+	}
+
+	/// <summary>
+	/// 1ページに矩形を配置する
+	/// </summary>
+	/// <returns>配置できた矩形数</returns>
+	uint32_t PackPage(std::vector<stbrp_rect>& rects, uint32_t pageSize, ATLAS_HEURISTIC heuristic)
+	{
+		if (rects.empty())
+		{
+			return 0;
+		}
+
+		std::vector<stbrp_node> nodes(pageSize);
+
+		stbrp_context context = {};
+		stbrp_init_target(&context, int(pageSize), int(pageSize), nodes.data(), int(nodes.size()));
+		stbrp_setup_heuristic(&context, (heuristic == ATLAS_HEURISTIC_SKYLINE_BF)
+			? STBRP_HEURISTIC_Skyline_BF_sortHeight
+			: STBRP_HEURISTIC_Skyline_BL_sortHeight);
+		stbrp_pack_rects(&context, rects.data(), int(rects.size()));
+
+		uint32_t count = 0;
+		for (const auto& rect : rects)
+		{
+			if (rect.was_packed)
+			{
+				count++;
+			}
+		}
+		return count;
+	}
+}
+
+bool PackAtlasRects
+(
+	const std::vector<AtlasRectSize>& sizes,
+	const AtlasPackDesc& desc,
+	std::vector<AtlasPlacement>& placements,
+	AtlasPackReport* pReport
+)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	auto alignment = CalcAtlasAlignment(desc);
+	auto padding = CalcAtlasPadding(desc);
+
+	AtlasPackReport report;
+	report.InputCount = uint32_t(sizes.size());
+
+	placements.assign(sizes.size(), AtlasPlacement());
+
+	// 幅と高さをアラインメント単位にそろえてパディングを加える
+	// 全ての矩形がアラインメントの倍数になるので, スカイライン上の配置位置も倍数になる
+	std::vector<stbrp_rect> rects;
+	rects.reserve(sizes.size());
+
+	uint64_t totalTexels = 0;
+	for (size_t i = 0; i < sizes.size(); ++i)
+	{
+		auto w = AlignUp(std::max(sizes[i].Width, 1u), alignment);
+		auto h = AlignUp(std::max(sizes[i].Height, 1u), alignment);
+
+		placements[i].Width = w;
+		placements[i].Height = h;
+
+		report.SourceTexels += uint64_t(sizes[i].Width) * sizes[i].Height;
+
+		stbrp_rect rect = {};
+		rect.id = int(i);
+		rect.w = int(w + padding * 2);
+		rect.h = int(h + padding * 2);
+
+		// ページに収まらないものは配置しない
+		if (uint32_t(rect.w) > desc.PageSize || uint32_t(rect.h) > desc.PageSize)
+		{
+			continue;
+		}
+
+		totalTexels += uint64_t(rect.w) * rect.h;
+		rects.push_back(rect);
+	}
+
+	auto storeResult = [&](const std::vector<stbrp_rect>& packed, uint32_t page)
+	{
+		for (const auto& rect : packed)
+		{
+			if (!rect.was_packed)
+			{
+				continue;
+			}
+
+			auto& placement = placements[rect.id];
+			placement.Page = page;
+			placement.X = uint32_t(rect.x) + padding;
+			placement.Y = uint32_t(rect.y) + padding;
+
+			report.PackedCount++;
+			report.ContentTexels += uint64_t(placement.Width) * placement.Height;
+			report.PaddedTexels += uint64_t(rect.w) * rect.h;
+		}
+	};
+
+	// 1ページに収まる場合は収まる最小のサイズを探す
+	auto pageSize = NextPow2(uint32_t(std::ceil(std::sqrt(double(totalTexels)))));
+	pageSize = std::max(pageSize, alignment);
+
+	auto isSinglePage = false;
+	for (; pageSize <= desc.PageSize && !rects.empty(); pageSize <<= 1)
+	{
+		auto trial = rects;
+		if (PackPage(trial, pageSize, desc.Heuristic) == trial.size())
+		{
+			storeResult(trial, 0);
+			report.PageCount = 1;
+			report.PageSize = pageSize;
+			isSinglePage = true;
+			break;
+		}
+	}
+
+	// 収まらない場合は最大サイズのページを追加していく
+	if (!isSinglePage && !rects.empty())
+	{
+		report.PageSize = desc.PageSize;
+
+		auto remaining = rects;
+		while (!remaining.empty())
+		{
+			auto count = PackPage(remaining, desc.PageSize, desc.Heuristic);
+			if (count == 0)
+			{
+				break;
+			}
+
+			storeResult(remaining, report.PageCount);
+			report.PageCount++;
+
+			std::vector<stbrp_rect> next;
+			for (const auto& rect : remaining)
+			{
+				if (!rect.was_packed)
+				{
+					auto retry = rect;
+					retry.x = retry.y = 0;
+					retry.was_packed = 0;
+					next.push_back(retry);
+				}
+			}
+			remaining.swap(next);
+		}
+	}
+
+	report.PageTexels = uint64_t(report.PageSize) * report.PageSize * report.PageCount;
+	report.PackMilliseconds = GetElapsedMilliseconds(start);
+
+	if (pReport != nullptr)
+	{
+		*pReport = report;
+	}
+
+	return report.PackedCount == report.InputCount;
+}
+
+void BlitAtlasMips
+(
+	const std::vector<CpuImage>& sourceMips,
+	const AtlasPlacement& placement,
+	const AtlasPackDesc& desc,
+	std::vector<CpuImage>& pageMips
+)
+{
+	auto padding = CalcAtlasPadding(desc);
+	auto mipCount = std::min<size_t>(std::min<size_t>(sourceMips.size(), pageMips.size()), desc.MipCount);
+
+	for (size_t mip = 0; mip < mipCount; ++mip)
+	{
+		const auto& src = sourceMips[mip];
+		auto& dst = pageMips[mip];
+
+		auto x0 = int(placement.X >> mip);
+		auto y0 = int(placement.Y >> mip);
+		auto w = int(placement.Width >> mip);
+		auto h = int(placement.Height >> mip);
+		auto g = int(padding >> mip);
+
+		if (src.Width != uint32_t(w) || src.Height != uint32_t(h))
+		{
+			continue;
+		}
+
+		// ガターは端のテクセルを延長して埋める (バイリニア補間で隣の矩形がにじまないようにする)
+		for (auto y = -g; y < h + g; ++y)
+		{
+			auto dy = y0 + y;
+			if (dy < 0 || dy >= int(dst.Height))
+			{
+				continue;
+			}
+
+			auto pSrc = src.GetRow(uint32_t(std::clamp(y, 0, h - 1)));
+			auto pDst = dst.GetRow(uint32_t(dy));
+
+			for (auto x = -g; x < w + g; ++x)
+			{
+				auto dx = x0 + x;
+				if (dx < 0 || dx >= int(dst.Width))
+				{
+					continue;
+				}
+
+				pDst[dx] = pSrc[std::clamp(x, 0, w - 1)];
+			}
+		}
+	}
+}
+
+bool IsUVInUnitRange(const ResMesh& mesh, float epsilon)
+{
+	for (const auto& vertex : mesh.Vertices)
+	{
+		const auto& uv = vertex.TexCoord;
+		if (uv.x < -epsilon || uv.x > 1.0f + epsilon || uv.y < -epsilon || uv.y > 1.0f + epsilon)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void RemapMeshUV(ResMesh& mesh, const XMFLOAT4& scaleBias)
+{
+	for (auto& vertex : mesh.Vertices)
+	{
+		auto u = std::clamp(vertex.TexCoord.x, 0.0f, 1.0f);
+		auto v = std::clamp(vertex.TexCoord.y, 0.0f, 1.0f);
+		vertex.TexCoord.x = u * scaleBias.x + scaleBias.z;
+		vertex.TexCoord.y = v * scaleBias.y + scaleBias.w;
+	}
+}
+
+void LogAtlasPackReport(const wchar_t* name, const AtlasPackReport& report)
+{
+	ILOG("TextureAtlasPacker : %ls -> %u page(s) of %ux%u%s", name, report.PageCount, report.PageSize, report.PageSize, report.CacheHit ? " (cache hit)" : "");
+	ILOG("  Rects       %u / %u packed", report.PackedCount, report.InputCount);
+	if (report.SourceTextureCount > 0)
+	{
+		ILOG("  Textures    %u -> %u (descriptors and root table changes)", report.SourceTextureCount, report.AtlasTextureCount);
+	}
+	ILOG("  Efficiency  %.1f%% (content), %.1f%% (with padding)",
+		100.0 * report.CalcEfficiency(),
+		(report.PageTexels > 0) ? 100.0 * double(report.PaddedTexels) / double(report.PageTexels) : 0.0);
+	ILOG("  Texels      source %llu, content %llu, page %llu",
+		(unsigned long long)report.SourceTexels,
+		(unsigned long long)report.ContentTexels,
+		(unsigned long long)report.PageTexels);
+	ILOG("  Time        pack %.3f ms, build %.3f ms", report.PackMilliseconds, report.BuildMilliseconds);
+}
@@ -0,0 +1,157 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CubeMapImage.h"
+#include "ResMesh.h"
+
+/// <summary>
+/// 矩形の配置方法 (imgui/imstb_rectpack.h のスカイライン法)
+/// </summary>
+enum ATLAS_HEURISTIC
+{
+	ATLAS_HEURISTIC_SKYLINE_BL = 0,	// できるだけ下に配置する (Bottom-Left)
+	ATLAS_HEURISTIC_SKYLINE_BF,		// 隙間が最小になる位置に配置する (Best-Fit)
+};
+
+/// <summary>
+/// アトラスの設定
+/// </summary>
+struct AtlasPackDesc
+{
+	uint32_t		PageSize = 2048;						// ページの最大サイズ (2の累乗)
+	uint32_t		MaxSourceSize = 512;					// これより大きいテクスチャはまとめない
+	uint32_t		MipCount = 4;							// ガターを保証するミップレベル数 (アトラスのミップ数)
+	uint32_t		Gutter = 1;								// 各ミップで確保するガターのテクセル数
+	ATLAS_HEURISTIC	Heuristic = ATLAS_HEURISTIC_SKYLINE_BL;	// 配置方法
+};
+
+/// <summary>
+/// 矩形の位置とサイズをそろえる単位 (最下位ミップで1テクセルになるようにする)
+/// </summary>
+inline uint32_t CalcAtlasAlignment(const AtlasPackDesc& desc)
+{
+	return 1u << (desc.MipCount - 1);
+}
+
+/// <summary>
+/// ミップレベル0で確保する片側のパディング (最下位ミップで Gutter テクセルになるようにする)
+/// </summary>
+inline uint32_t CalcAtlasPadding(const AtlasPackDesc& desc)
+{
+	return desc.Gutter << (desc.MipCount - 1);
+}
+
+/// <summary>
+/// 配置する矩形のサイズ
+/// </summary>
+struct AtlasRectSize
+{
+	uint32_t	Width = 0;		// 横幅
+	uint32_t	Height = 0;		// 縦幅
+};
+
+/// <summary>
+/// 矩形の配置結果
+/// </summary>
+struct AtlasPlacement
+{
+	uint32_t	Page = UINT32_MAX;	// ページ番号 (配置できなかった場合は UINT32_MAX)
+	uint32_t	X = 0;				// パディングを除いた左上のX座標 (ミップレベル0)
+	uint32_t	Y = 0;				// パディングを除いた左上のY座標 (ミップレベル0)
+	uint32_t	Width = 0;			// パディングを除いた横幅 (アラインメント済み)
+	uint32_t	Height = 0;			// パディングを除いた縦幅 (アラインメント済み)
+
+	bool IsPacked() const { return Page != UINT32_MAX; }
+
+	/// <summary>
+	/// [0, 1] のテクスチャ座標をページ内の座標に変換するスケールとバイアスを求める
+	/// </summary>
+	/// <param name="pageSize">ページのサイズ</param>
+	/// <returns>(スケールU, スケールV, バイアスU, バイアスV)</returns>
+	DirectX::XMFLOAT4 CalcUVScaleBias(uint32_t pageSize) const
+	{
+		auto inv = 1.0f / float(pageSize);
+		return DirectX::XMFLOAT4(Width * inv, Height * inv, X * inv, Y * inv);
+	}
+};
+
+/// <summary>
+/// アトラスの作成結果
+/// </summary>
+struct AtlasPackReport
+{
+	uint32_t	InputCount = 0;				// 入力の矩形数
+	uint32_t	PackedCount = 0;			// 配置できた矩形数
+	uint32_t	PageCount = 0;				// ページ数
+	uint32_t	PageSize = 0;				// ページのサイズ
+	uint64_t	SourceTexels = 0;			// 入力のテクセル数
+	uint64_t	ContentTexels = 0;			// 配置した矩形のテクセル数 (アラインメント後, パディングを除く)
+	uint64_t	PaddedTexels = 0;			// 配置した矩形のテクセル数 (パディングを含む)
+	uint64_t	PageTexels = 0;				// ページの合計テクセル数
+	uint32_t	SourceTextureCount = 0;		// まとめる前のテクスチャ数 (ディスクリプタ数)
+	uint32_t	AtlasTextureCount = 0;		// まとめた後のテクスチャ数 (ディスクリプタ数)
+	double		PackMilliseconds = 0.0;		// 配置にかかった時間
+	double		BuildMilliseconds = 0.0;	// ページの作成にかかった時間
+	bool		CacheHit = false;			// キャッシュにヒットしたかどうか
+
+	/// <summary>
+	/// ページ内で矩形が占める割合 (パディングを除く)
+	/// </summary>
+	double CalcEfficiency() const
+	{
+		return (PageTexels > 0) ? double(ContentTexels) / double(PageTexels) : 0.0;
+	}
+};
+
+/// <summary>
+/// 矩形をアトラスのページに配置する
+/// 矩形はアラインメント単位に切り上げてパディングを加え, 1ページに収まる場合は収まる最小の2の累乗サイズのページを使う
+/// 収まらない場合は PageSize のページを必要なだけ追加する
+/// </summary>
+/// <param name="sizes">矩形のサイズ</param>
+/// <param name="desc">アトラスの設定</param>
+/// <param name="placements">配置結果の格納先 (sizes と同じ並び)</param>
+/// <param name="pReport">作成結果の格納先 (nullptrの場合は格納しない)</param>
+/// <returns>全ての矩形を配置できた場合はtrue</returns>
+bool PackAtlasRects(
+	const std::vector<AtlasRectSize>& sizes,
+	const AtlasPackDesc& desc,
+	std::vector<AtlasPlacement>& placements,
+	AtlasPackReport* pReport = nullptr);
+
+/// <summary>
+/// 入力画像のミップをページのミップに書き込み, 周囲のガターを端のテクセルで埋める
+/// </summary>
+/// <param name="sourceMips">配置サイズの入力画像のミップ (desc.MipCount 個)</param>
+/// <param name="placement">配置結果</param>
+/// <param name="desc">アトラスの設定</param>
+/// <param name="pageMips">ページのミップ (desc.MipCount 個)</param>
+void BlitAtlasMips(
+	const std::vector<CpuImage>& sourceMips,
+	const AtlasPlacement& placement,
+	const AtlasPackDesc& desc,
+	std::vector<CpuImage>& pageMips);
+
+/// <summary>
+/// メッシュのテクスチャ座標が全て [0, 1] に収まっているかどうか (ラップするメッシュはアトラスにできない)
+/// </summary>
+/// <param name="mesh">メッシュ</param>
+/// <param name="epsilon">許容誤差</param>
+/// <returns>収まっている場合はtrue</returns>
+bool IsUVInUnitRange(const ResMesh& mesh, float epsilon = 1e-4f);
+
+/// <summary>
+/// メッシュのテクスチャ座標をアトラスのページ内の座標に書き換える
+/// </summary>
+/// <param name="mesh">メッシュ</param>
+/// <param name="scaleBias">AtlasPlacement::CalcUVScaleBias() の結果</param>
+void RemapMeshUV(ResMesh& mesh, const DirectX::XMFLOAT4& scaleBias);
+
+/// <summary>
+/// アトラスの作成結果 (充填率, ディスクリプタ数, 処理時間) をログに出力する
+/// </summary>
+/// <param name="name">ログに表示する名前</param>
+/// <param name="report">作成結果</param>
+void LogAtlasPackReport(const wchar_t* name, const AtlasPackReport& report);
@@ -0,0 +1,425 @@
+﻿#include "AutoExposure.h"
+
+#include <algorithm>
+#include <DirectXHelpers.h>
+#include <DirectXTex.h>
+
+#include "CubeMapUtil.h"
+#include "Logger.h"
+
+namespace
+{
+#include "../Compiled/LuminanceHistogramCS.inc"
+
+	// スレッドグループの1辺のサイズ (LuminanceHistogramCS.hlsl と同じ)
+	static const uint32_t ThreadSize = 16;
+
+	// ヒストグラムのバイト数
+	static const uint32_t HistogramBytes = LuminanceHistogramBinCount * sizeof(uint32_t);
+
+	struct alignas(256) CbHistogram
+	{
+		uint32_t	Width;		// 入力の横幅
+		uint32_t	Height;		// 入力の縦幅
+	};
+}
+
+AutoExposure::AutoExposure()
+	: m_pHandleUAV(nullptr)
+	, m_pPoolRes(nullptr)
+	, m_Width(0)
+	, m_Height(0)
+	, m_Recorded()
+	, m_LastFrameIndex(UINT32_MAX)
+	, m_Exposure(1.0f)
+	, m_AverageLog2(0.0f)
+{
+}
+
+AutoExposure::~AutoExposure()
+{
+	Term();
+}
+
+bool AutoExposure::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, uint32_t width, uint32_t height, PipelineCache* pPipelineCache)
+{
+	if (pDevice == nullptr || pPoolRes == nullptr || width == 0 || height == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	m_pPoolRes = pPoolRes;
+	m_pPoolRes->AddRef();
+
+	m_Width = width;
+	m_Height = height;
+
+	// ルートシグネチャの生成
+	{
+		RootSignature::Desc desc;
+		desc.Begin(3)
+			.SetCBV(ShaderStage::ALL, 0, 0)
+			.SetSRV(ShaderStage::ALL, 1, 0)
+			.SetUAV(ShaderStage::ALL, 2, 0)
+			.End();
+
+		if (!m_RootSignature.Init(pDevice, desc.GetDesc()))
+		{
+			ELOG("Error : RootSignature::Init() Failed.");
+			return false;
+		}
+	}
+
+	// パイプラインステートの生成
+	{
+		D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
+		desc.pRootSignature = m_RootSignature.GetPtr();
+		desc.CS = { LuminanceHistogramCS, sizeof(LuminanceHistogramCS) };
+
+		if (!CreateComputePipeline(pDevice, pPipelineCache, desc, m_RootSignature.GetHash(), m_pPSO.GetAddressOf()))
+		{
+			return false;
+		}
+	}
+
+	// バッファの生成
+	if (!CreateBuffer(pDevice, D3D12_HEAP_TYPE_DEFAULT, HistogramBytes,
+		D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST, m_pHistogram))
+	{
+		return false;
+	}
+
+	if (!CreateBuffer(pDevice, D3D12_HEAP_TYPE_UPLOAD, HistogramBytes,
+		D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, m_pZero))
+	{
+		return false;
+	}
+
+	if (!CreateBuffer(pDevice, D3D12_HEAP_TYPE_READBACK, uint64_t(HistogramBytes) * Constants::MaxFrameCount,
+		D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, m_pReadback))
+	{
+		return false;
+	}
+
+	// クリア用のバッファをゼロで埋める
+	{
+		void* ptr = nullptr;
+		auto hr = m_pZero->Map(0, nullptr, &ptr);
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Resource::Map() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		memset(ptr, 0, HistogramBytes);
+		m_pZero->Unmap(0, nullptr);
+	}
+
+	// アンオーダードアクセスビューの生成
+	{
+		m_pHandleUAV = m_pPoolRes->AllocHandle();
+		if (m_pHandleUAV == nullptr)
+		{
+			ELOG("Error : Descriptor Handle is full.");
+			return false;
+		}
+
+		D3D12_UNORDERED_ACCESS_VIEW_DESC desc = {};
+		desc.Format = DXGI_FORMAT_R32_TYPELESS;
+		desc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+		desc.Buffer.FirstElement = 0;
+		desc.Buffer.NumElements = LuminanceHistogramBinCount;
+		desc.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_RAW;
+
+		pDevice->CreateUnorderedAccessView(m_pHistogram.Get(), nullptr, &desc, m_pHandleUAV->HandleCPU);
+	}
+
+	// 定数バッファの生成
+	{
+		for (auto i = 0u; i < Constants::MaxFrameCount; ++i)
+		{
+			if (!m_CB[i].Init(pDevice, m_pPoolRes, sizeof(CbHistogram)))
+			{
+				ELOG("Error : ConstantBuffer::Init() Failed.");
+				return false;
+			}
+
+			auto ptr = m_CB[i].GetPtr<CbHistogram>();
+			ptr->Width = m_Width;
+			ptr->Height = m_Height;
+		}
+	}
+
+	for (auto& recorded : m_Recorded)
+	{
+		recorded = false;
+	}
+
+	m_LastFrameIndex = UINT32_MAX;
+	m_Histogram.assign(LuminanceHistogramBinCount, 0);
+	m_Exposure = 1.0f;
+	m_AverageLog2 = 0.0f;
+
+	return true;
+}
+
+void AutoExposure::Term()
+{
+	for (auto& cb : m_CB)
+	{
+		cb.Term();
+	}
+
+	if (m_pHandleUAV != nullptr && m_pPoolRes != nullptr)
+	{
+		m_pPoolRes->FreeHandle(m_pHandleUAV);
+		m_pHandleUAV = nullptr;
+	}
+
+	if (m_pPoolRes != nullptr)
+	{
+		m_pPoolRes->Release();
+		m_pPoolRes = nullptr;
+	}
+
+	m_pHistogram.Reset();
+	m_pZero.Reset();
+	m_pReadback.Reset();
+	m_pPSO.Reset();
+	m_RootSignature.Term();
+
+	m_Histogram.clear();
+	m_Width = 0;
+	m_Height = 0;
+}
+
+void AutoExposure::Update(uint32_t frameIndex, float deltaTime)
+{
+	if (m_pReadback == nullptr || frameIndex >= Constants::MaxFrameCount || !m_Recorded[frameIndex])
+	{
+		return;
+	}
+
+	// 読み戻し (このフレーム番号を再利用する前に Present() でGPUの完了を待っているため, 内容は確定している)
+	{
+		D3D12_RANGE range = {};
+		range.Begin = SIZE_T(HistogramBytes) * frameIndex;
+		range.End = range.Begin + HistogramBytes;
+
+		uint8_t* ptr = nullptr;
+		auto hr = m_pReadback->Map(0, &range, reinterpret_cast<void**>(&ptr));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Resource::Map() Failed. retcode = 0x%x", hr);
+			return;
+		}
+
+		memcpy(m_Histogram.data(), ptr + range.Begin, HistogramBytes);
+
+		D3D12_RANGE written = {};
+		m_pReadback->Unmap(0, &written);
+	}
+
+	// 露出を順応させる
+	m_AverageLog2 = CalcHistogramAverageLog2(m_Histogram.data(), m_Param);
+	auto target = CalcTargetExposure(m_AverageLog2, m_Param);
+	m_Exposure = AdaptExposure(m_Exposure, target, deltaTime, m_Param);
+}
+
+void AutoExposure::Dispatch(ID3D12GraphicsCommandList* pCmd, D3D12_GPU_DESCRIPTOR_HANDLE handleSRV, uint32_t frameIndex, uint32_t width, uint32_t height)
+{
+	if (pCmd == nullptr || m_pPSO == nullptr || frameIndex >= Constants::MaxFrameCount)
+	{
+		return;
+	}
+
+	// 描画範囲の更新
+	width = (width == 0) ? m_Width : std::min(width, m_Width);
+	height = (height == 0) ? m_Height : std::min(height, m_Height);
+	{
+		auto ptr = m_CB[frameIndex].GetPtr<CbHistogram>();
+		ptr->Width = width;
+		ptr->Height = height;
+	}
+
+	// ヒストグラムをクリア
+	if (m_LastFrameIndex != UINT32_MAX)
+	{
+		DirectX::TransitionResource(pCmd, m_pHistogram.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+	}
+
+	pCmd->CopyBufferRegion(m_pHistogram.Get(), 0, m_pZero.Get(), 0, HistogramBytes);
+
+	DirectX::TransitionResource(pCmd, m_pHistogram.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	// ヒストグラムを求める
+	pCmd->SetComputeRootSignature(m_RootSignature.GetPtr());
+	pCmd->SetComputeRootDescriptorTable(0, m_CB[frameIndex].GetHandleGPU());
+	pCmd->SetComputeRootDescriptorTable(1, handleSRV);
+	pCmd->SetComputeRootDescriptorTable(2, m_pHandleUAV->HandleGPU);
+	pCmd->SetPipelineState(m_pPSO.Get());
+	pCmd->Dispatch((width + ThreadSize - 1) / ThreadSize, (height + ThreadSize - 1) / ThreadSize, 1);
+
+	// 読み戻し用バッファにコピー
+	DirectX::TransitionResource(pCmd, m_pHistogram.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+	pCmd->CopyBufferRegion(m_pReadback.Get(), uint64_t(HistogramBytes) * frameIndex, m_pHistogram.Get(), 0, HistogramBytes);
+
+	m_Recorded[frameIndex] = true;
+	m_LastFrameIndex = frameIndex;
+}
+
+bool AutoExposure::Capture
+(
+	ID3D12CommandQueue* pQueue,
+	ID3D12Resource* pColor,
+	D3D12_RESOURCE_STATES state,
+	const wchar_t* colorPath,
+	const wchar_t* histogramPath
+)
+{
+	if (pQueue == nullptr || pColor == nullptr || colorPath == nullptr || histogramPath == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	if (m_LastFrameIndex == UINT32_MAX)
+	{
+		ELOG("Error : Histogram is not recorded yet.");
+		return false;
+	}
+
+	// シーンカラーを保存
+	{
+		DirectX::ScratchImage image;
+		auto hr = DirectX::CaptureTexture(pQueue, pColor, false, image, state, state);
+		if (FAILED(hr))
+		{
+			ELOG("Error : DirectX::CaptureTexture() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		hr = DirectX::SaveToDDSFile(
+			image.GetImages(),
+			image.GetImageCount(),
+			image.GetMetadata(),
+			DirectX::DDS_FLAGS_NONE,
+			colorPath);
+		if (FAILED(hr))
+		{
+			ELOG("Error : DirectX::SaveToDDSFile() Failed. path = %ls, retcode = 0x%x", colorPath, hr);
+			return false;
+		}
+	}
+
+	// 同じフレームのヒストグラムを保存
+	{
+		D3D12_RANGE range = {};
+		range.Begin = SIZE_T(HistogramBytes) * m_LastFrameIndex;
+		range.End = range.Begin + HistogramBytes;
+
+		uint8_t* ptr = nullptr;
+		auto hr = m_pReadback->Map(0, &range, reinterpret_cast<void**>(&ptr));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Resource::Map() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		auto result = SaveLuminanceHistogram(histogramPath, reinterpret_cast<const uint32_t*>(ptr + range.Begin));
+
+		D3D12_RANGE written = {};
+		m_pReadback->Unmap(0, &written);
+
+		if (!result)
+		{
+			ELOG("Error : SaveLuminanceHistogram() Failed. path = %ls", histogramPath);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool AutoExposure::CreateBuffer
+(
+	ID3D12Device* pDevice,
+	D3D12_HEAP_TYPE heapType,
+	uint64_t size,
+	D3D12_RESOURCE_FLAGS flags,
+	D3D12_RESOURCE_STATES state,
+	ComPtr<ID3D12Resource>& result
+)
+{
+	D3D12_HEAP_PROPERTIES props = {};
+	props.Type = heapType;
+	props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+	D3D12_RESOURCE_DESC desc = {};
+	desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	desc.Width = size;
+	desc.Height = 1;
+	desc.DepthOrArraySize = 1;
+	desc.MipLevels = 1;
+	desc.Format = DXGI_FORMAT_UNKNOWN;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	desc.Flags = flags;
+
+	auto hr = pDevice->CreateCommittedResource(
+		&props,
+		D3D12_HEAP_FLAG_NONE,
+		&desc,
+		state,
+		nullptr,
+		IID_PPV_ARGS(result.ReleaseAndGetAddressOf()));
+	if (FAILED(hr))
+	{
+		ELOG("Error : ID3D12Device::CreateCommittedResource() Failed. retcode = 0x%x", hr);
+		return false;
+	}
+
+	return true;
+}
+
+bool ValidateExposureCapture
+(
+	const wchar_t* colorPath,
+	const wchar_t* histogramPath,
+	const AutoExposureParam& param,
+	AutoExposureReport& report
+)
+{
+	report = AutoExposureReport();
+
+	if (colorPath == nullptr || histogramPath == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	CpuImage image;
+	if (!LoadImageRGBA32F(colorPath, image))
+	{
+		ELOG("Error : LoadImageRGBA32F() Failed. path = %ls", colorPath);
+		return false;
+	}
+
+	std::vector<uint32_t> captured;
+	if (!LoadLuminanceHistogram(histogramPath, captured))
+	{
+		ELOG("Error : LoadLuminanceHistogram() Failed. path = %ls", histogramPath);
+		return false;
+	}
+
+	auto result = CompareLuminanceHistogram(image, captured.data(), param, report);
+
+	ILOG("Info : Exposure Capture Validation. pixels = %llu, mismatch bins = %u, max diff = %llu, average log2 = %.3f, exposure = %.4f",
+		report.PixelCount, report.MismatchBins, report.MaxCountDiff, report.AverageLog2, report.TargetExposure);
+
+	return result;
+}
@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <vector>
+
+#include "ComPtr.h"
+#include "Constants.h"
+#include "ConstantBuffer.h"
+#include "DescriptorPool.h"
+#include "RootSignature.h"
+#include "PipelineCache.h"
+#include "LuminanceHistogram.h"
+
+/// <summary>
+/// 輝度ヒストグラムによる自動露出
+/// ヒストグラムはコンピュートシェーダで求めて読み戻し, 露出の順応はCPUで行う
+/// 読み戻しは同じフレーム番号の次の描画時に行うので, 露出は FrameCount フレーム遅れて反映される
+/// </summary>
+class AutoExposure
+{
+public:
+	AutoExposure();
+	~AutoExposure();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="pPoolRes">ディスクリプタプール (CBV/SRV/UAV)</param>
+	/// <param name="width">入力の横幅</param>
+	/// <param name="height">入力の縦幅</param>
+	/// <param name="pPipelineCache">パイプラインキャッシュ (nullptrの場合は直接生成する)</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, uint32_t width, uint32_t height, PipelineCache* pPipelineCache = nullptr);
+
+	void Term();
+
+	/// <summary>
+	/// 前回同じフレーム番号で記録したヒストグラムを読み戻し, 露出を順応させる
+	/// GPUの完了を待ったあとに呼ぶこと
+	/// </summary>
+	/// <param name="frameIndex">フレーム番号</param>
+	/// <param name="deltaTime">前回の呼び出しからの経過時間 [s]</param>
+	void Update(uint32_t frameIndex, float deltaTime);
+
+	/// <summary>
+	/// ヒストグラムを求めるコマンドを記録する
+	/// 入力は D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE の状態であること
+	/// 動的解像度で描画範囲が入力より小さい場合は, 左上の描画範囲のみを対象にする
+	/// </summary>
+	/// <param name="pCmd">コマンドリスト</param>
+	/// <param name="handleSRV">入力のSRV</param>
+	/// <param name="frameIndex">フレーム番号</param>
+	/// <param name="width">描画範囲の横幅 (0の場合は初期化時の横幅)</param>
+	/// <param name="height">描画範囲の縦幅 (0の場合は初期化時の縦幅)</param>
+	void Dispatch(ID3D12GraphicsCommandList* pCmd, D3D12_GPU_DESCRIPTOR_HANDLE handleSRV, uint32_t frameIndex, uint32_t width = 0, uint32_t height = 0);
+
+	/// <summary>
+	/// 最後に記録したフレームのヒストグラムとシーンカラーをファイルに保存する (ValidateExposureCapture() で検証する)
+	/// GPUの完了を待ったあとに呼ぶこと
+	/// </summary>
+	/// <param name="pQueue">コマンドキュー</param>
+	/// <param name="pColor">シーンカラー</param>
+	/// <param name="state">シーンカラーの現在の状態</param>
+	/// <param name="colorPath">シーンカラーの保存先 (DDS)</param>
+	/// <param name="histogramPath">ヒストグラムの保存先</param>
+	/// <returns>保存に成功した場合はtrue</returns>
+	bool Capture(
+		ID3D12CommandQueue* pQueue,
+		ID3D12Resource* pColor,
+		D3D12_RESOURCE_STATES state,
+		const wchar_t* colorPath,
+		const wchar_t* histogramPath);
+
+	float GetExposure() const { return m_Exposure; }
+	float GetAverageLog2() const { return m_AverageLog2; }
+	const std::vector<uint32_t>& GetHistogram() const { return m_Histogram; }
+	AutoExposureParam& GetParam() { return m_Param; }
+
+private:
+	RootSignature				m_RootSignature;
+	ComPtr<ID3D12PipelineState>	m_pPSO;
+	ComPtr<ID3D12Resource>		m_pHistogram;					// ヒストグラム (UAV)
+	ComPtr<ID3D12Resource>		m_pZero;						// クリア用のゼロで埋めたバッファ
+	ComPtr<ID3D12Resource>		m_pReadback;					// 読み戻し用バッファ (フレームごと)
+	DescriptorHandle*			m_pHandleUAV;
+	DescriptorPool*				m_pPoolRes;
+	ConstantBuffer				m_CB[Constants::MaxFrameCount];	// 描画範囲 (フレームごと)
+	uint32_t					m_Width;
+	uint32_t					m_Height;
+	bool						m_Recorded[Constants::MaxFrameCount];	// フレームごとに記録済みかどうか
+	uint32_t					m_LastFrameIndex;				// 最後に記録したフレーム番号
+	std::vector<uint32_t>		m_Histogram;					// 最後に読み戻したヒストグラム
+	AutoExposureParam			m_Param;
+	float						m_Exposure;						// 順応させた露出
+	float						m_AverageLog2;					// 最後に求めた平均輝度 (log2)
+
+	/// <summary>
+	/// バッファを生成する
+	/// </summary>
+	bool CreateBuffer(
+		ID3D12Device* pDevice,
+		D3D12_HEAP_TYPE heapType,
+		uint64_t size,
+		D3D12_RESOURCE_FLAGS flags,
+		D3D12_RESOURCE_STATES state,
+		ComPtr<ID3D12Resource>& result);
+
+	AutoExposure(const AutoExposure&) = delete;
+	void operator=(const AutoExposure&) = delete;
+};
+
+/// <summary>
+/// AutoExposure::Capture() で保存したシーンカラーからヒストグラムを求め, 同じフレームでGPUが求めたヒストグラムと比較する
+/// </summary>
+/// <param name="colorPath">シーンカラーのDDSファイルパス</param>
+/// <param name="histogramPath">GPUのヒストグラムのファイルパス (uint32_t が LuminanceHistogramBinCount 個)</param>
+/// <param name="param">自動露出の設定</param>
+/// <param name="report">検証結果の格納先</param>
+/// <returns>全てのビンが一致した場合はtrue</returns>
+bool ValidateExposureCapture(
+	const wchar_t* colorPath,
+	const wchar_t* histogramPath,
+	const AutoExposureParam& param,
+	AutoExposureReport& report);
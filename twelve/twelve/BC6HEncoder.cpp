@@ -0,0 +1,771 @@
+﻿#include "BC6HEncoder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <DirectXPackedVector.h>
+
+#include "ParallelFor.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const int MaxHalf = 0x7BFF;				// 半精度の最大有限値 (65504) のビット表現
+	const uint32_t IndexCount = 16;			// 4bitインデックスの補間段数
+	const uint32_t IndexOffset = 65;		// インデックスの開始ビット位置
+	const uint32_t RefineIterations = 2;	// 最小二乗法によるエンドポイントの再計算回数
+
+	// 4bitインデックスの補間ウェイト (64が2つ目のエンドポイント)
+	const int Weights[IndexCount] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	/// <summary>
+	/// 1リージョンのモードの情報
+	/// </summary>
+	struct ModeInfo
+	{
+		uint32_t	Mode;			// モード番号のビット列 (5bit)
+		int			EndpointBits;	// 1つ目のエンドポイントのビット数
+		int			DeltaBits;		// 2つ目のエンドポイント (または差分) のビット数
+		bool		Transformed;	// 2つ目のエンドポイントを差分で格納するかどうか
+	};
+
+	const ModeInfo Modes[] = {
+		{ 0x03, 10, 10, false },	// モード11
+		{ 0x07, 11,  9, true  },	// モード12
+		{ 0x0B, 12,  8, true  },	// モード13
+		{ 0x0F, 16,  4, true  },	// モード14
+	};
+
+	const uint32_t ModeCount = uint32_t(_countof(Modes));
+
+	/// <summary>
+	/// 量子化済みのエンドポイント
+	/// </summary>
+	struct Endpoints
+	{
+		int A[3];
+		int B[3];
+	};
+
+	/// <summary>
+	/// 圧縮途中のブロックの状態
+	/// </summary>
+	struct BlockState
+	{
+		uint32_t	ModeIndex = 0;
+		Endpoints	Ends = {};
+		uint8_t		Indices[16] = {};
+		float		Error = FLT_MAX;
+	};
+
+	/// <summary>
+	/// エンドポイントのビットの並びを列挙する
+	/// フィールド番号 0-2 は1つ目のエンドポイントのRGB, 3-5 は2つ目のエンドポイント (または差分) のRGB
+	/// 1つ目のエンドポイントの10bitを超える部分は差分の後ろに上位ビットから順に格納される
+	/// </summary>
+	template<typename Func>
+	void VisitLayout(const ModeInfo& mode, const Func& func)
+	{
+		for (auto c = 0; c < 3; ++c)
+		{
+			for (auto bit = 0; bit < 10; ++bit)
+			{
+				func(c, bit);
+			}
+		}
+
+		for (auto c = 0; c < 3; ++c)
+		{
+			for (auto bit = 0; bit < mode.DeltaBits; ++bit)
+			{
+				func(3 + c, bit);
+			}
+
+			for (auto bit = mode.EndpointBits - 1; bit >= 10; --bit)
+			{
+				func(c, bit);
+			}
+		}
+	}
+
+	/// <summary>
+	/// 128bitのブロックへLSBから順にビットを書き込む
+	/// </summary>
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(uint8_t* pBlock)
+			: m_pBlock(pBlock)
+			, m_Pos(0)
+		{
+			memset(m_pBlock, 0, BC6HBlockSize);
+		}
+
+		void Write(uint32_t value, uint32_t count)
+		{
+			for (auto i = 0u; i < count; ++i, ++m_Pos)
+			{
+				m_pBlock[m_Pos >> 3] |= uint8_t(((value >> i) & 1) << (m_Pos & 7));
+			}
+		}
+
+	private:
+		uint8_t*	m_pBlock;
+		uint32_t	m_Pos;
+	};
+
+	/// <summary>
+	/// 128bitのブロックからLSBから順にビットを読み込む
+	/// </summary>
+	class BitReader
+	{
+	public:
+		explicit BitReader(const uint8_t* pBlock)
+			: m_pBlock(pBlock)
+			, m_Pos(0)
+		{
+		}
+
+		uint32_t Read(uint32_t count)
+		{
+			uint32_t value = 0;
+			for (auto i = 0u; i < count; ++i, ++m_Pos)
+			{
+				value |= uint32_t((m_pBlock[m_Pos >> 3] >> (m_Pos & 7)) & 1) << i;
+			}
+			return value;
+		}
+
+		void Seek(uint32_t pos)
+		{
+			m_Pos = pos;
+		}
+
+	private:
+		const uint8_t*	m_pBlock;
+		uint32_t		m_Pos;
+	};
+
+	/// <summary>
+	/// 量子化されたエンドポイントを16bitに戻す (BC6H_UF16 の仕様)
+	/// </summary>
+	inline int Unquantize(int q, int bits)
+	{
+		if (bits >= 15)
+		{
+			return q;
+		}
+		if (q == 0)
+		{
+			return 0;
+		}
+		if (q == (1 << bits) - 1)
+		{
+			return 0xFFFF;
+		}
+		return ((q << 16) + 0x8000) >> bits;
+	}
+
+	/// <summary>
+	/// 補間結果を半精度のビット表現に変換する (BC6H_UF16 の仕様)
+	/// </summary>
+	inline int FinishUnquantize(int v)
+	{
+		return (v * 31) >> 6;
+	}
+
+	/// <summary>
+	/// 16bitの値を指定ビット数に量子化する (Unquantize() の結果が最も近くなる値を選ぶ)
+	/// </summary>
+	inline int Quantize(float x, int bits)
+	{
+		auto maxValue = (1 << bits) - 1;
+		auto base = std::clamp(int(x * float(1 << bits) / 65536.0f), 0, maxValue);
+
+		auto best = base;
+		auto bestError = FLT_MAX;
+		for (auto q = std::max(base - 1, 0); q <= std::min(base + 1, maxValue); ++q)
+		{
+			auto error = std::fabs(float(Unquantize(q, bits)) - x);
+			if (error < bestError)
+			{
+				best = q;
+				bestError = error;
+			}
+		}
+
+		return best;
+	}
+
+	/// <summary>
+	/// 差分を符号付きの指定ビット数に収まるように巡回させる
+	/// 収まらない場合はfalse (アンカーの入れ替えで符号が反転しても収まるように範囲は対称にする)
+	/// </summary>
+	inline bool WrapDelta(int a, int b, int endpointBits, int deltaBits, int& delta)
+	{
+		auto period = 1 << endpointBits;
+		delta = b - a;
+		if (delta >= period / 2)
+		{
+			delta -= period;
+		}
+		else if (delta < -period / 2)
+		{
+			delta += period;
+		}
+
+		auto limit = (1 << (deltaBits - 1)) - 1;
+		return (-limit <= delta) && (delta <= limit);
+	}
+
+	/// <summary>
+	/// エンドポイントがモードで表現可能かどうか
+	/// </summary>
+	inline bool IsRepresentable(const ModeInfo& mode, const Endpoints& ends)
+	{
+		if (!mode.Transformed)
+		{
+			return true;
+		}
+
+		for (auto c = 0; c < 3; ++c)
+		{
+			int delta;
+			if (!WrapDelta(ends.A[c], ends.B[c], mode.EndpointBits, mode.DeltaBits, delta))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// エンドポイントから補間される16色を求める (半精度のビット表現)
+	/// </summary>
+	inline void BuildPalette(const ModeInfo& mode, const Endpoints& ends, XMVECTOR* pPalette)
+	{
+		int ua[3];
+		int ub[3];
+		for (auto c = 0; c < 3; ++c)
+		{
+			ua[c] = Unquantize(ends.A[c], mode.EndpointBits);
+			ub[c] = Unquantize(ends.B[c], mode.EndpointBits);
+		}
+
+		for (auto i = 0u; i < IndexCount; ++i)
+		{
+			auto w = Weights[i];
+			int value[3];
+			for (auto c = 0; c < 3; ++c)
+			{
+				value[c] = FinishUnquantize((ua[c] * (64 - w) + ub[c] * w + 32) >> 6);
+			}
+
+			pPalette[i] = XMVectorSet(float(value[0]), float(value[1]), float(value[2]), 0.0f);
+		}
+	}
+
+	/// <summary>
+	/// 各ピクセルに最も近い補間色を選び, 二乗誤差の合計を返す
+	/// </summary>
+	inline float Evaluate(const ModeInfo& mode, const Endpoints& ends, const XMVECTOR* pHalf, uint8_t* pIndices)
+	{
+		XMVECTOR palette[IndexCount];
+		BuildPalette(mode, ends, palette);
+
+		auto total = 0.0f;
+		for (auto i = 0; i < 16; ++i)
+		{
+			auto bestIndex = 0u;
+			auto bestError = FLT_MAX;
+			for (auto j = 0u; j < IndexCount; ++j)
+			{
+				auto error = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(pHalf[i], palette[j])));
+				if (error < bestError)
+				{
+					bestIndex = j;
+					bestError = error;
+				}
+			}
+
+			pIndices[i] = uint8_t(bestIndex);
+			total += bestError;
+		}
+
+		return total;
+	}
+
+	/// <summary>
+	/// 補間空間のエンドポイントを量子化して評価し, より良ければ結果を更新する
+	/// </summary>
+	inline void TryEndpoints(uint32_t modeIndex, const Endpoints& ends, const XMVECTOR* pHalf, BlockState& state)
+	{
+		const auto& mode = Modes[modeIndex];
+		if (!IsRepresentable(mode, ends))
+		{
+			return;
+		}
+
+		uint8_t indices[16];
+		auto error = Evaluate(mode, ends, pHalf, indices);
+		if (error < state.Error)
+		{
+			state.ModeIndex = modeIndex;
+			state.Ends = ends;
+			state.Error = error;
+			memcpy(state.Indices, indices, sizeof(indices));
+		}
+	}
+
+	/// <summary>
+	/// 補間空間 (16bit) のエンドポイントを量子化する
+	/// </summary>
+	inline Endpoints QuantizeEndpoints(const ModeInfo& mode, FXMVECTOR a, FXMVECTOR b)
+	{
+		XMFLOAT4 fa;
+		XMFLOAT4 fb;
+		XMStoreFloat4(&fa, a);
+		XMStoreFloat4(&fb, b);
+
+		const float va[3] = { fa.x, fa.y, fa.z };
+		const float vb[3] = { fb.x, fb.y, fb.z };
+
+		Endpoints ends;
+		for (auto c = 0; c < 3; ++c)
+		{
+			ends.A[c] = Quantize(va[c], mode.EndpointBits);
+			ends.B[c] = Quantize(vb[c], mode.EndpointBits);
+		}
+		return ends;
+	}
+
+	/// <summary>
+	/// インデックスを固定して, 補間空間のエンドポイントを最小二乗法で求め直す
+	/// </summary>
+	inline bool RefitEndpoints(const XMVECTOR* pTarget, const uint8_t* pIndices, XMVECTOR& a, XMVECTOR& b)
+	{
+		auto aa = 0.0f;
+		auto ab = 0.0f;
+		auto bb = 0.0f;
+		auto ax = XMVectorZero();
+		auto bx = XMVectorZero();
+
+		for (auto i = 0; i < 16; ++i)
+		{
+			auto beta = float(Weights[pIndices[i]]) / 64.0f;
+			auto alpha = 1.0f - beta;
+
+			aa += alpha * alpha;
+			ab += alpha * beta;
+			bb += beta * beta;
+			ax = XMVectorMultiplyAdd(XMVectorReplicate(alpha), pTarget[i], ax);
+			bx = XMVectorMultiplyAdd(XMVectorReplicate(beta), pTarget[i], bx);
+		}
+
+		auto det = aa * bb - ab * ab;
+		if (std::fabs(det) < 1e-6f)
+		{
+			return false;
+		}
+
+		auto invDet = 1.0f / det;
+		auto lo = XMVectorZero();
+		auto hi = XMVectorReplicate(65535.0f);
+
+		a = XMVectorClamp(XMVectorScale(XMVectorSubtract(XMVectorScale(ax, bb), XMVectorScale(bx, ab)), invDet), lo, hi);
+		b = XMVectorClamp(XMVectorScale(XMVectorSubtract(XMVectorScale(bx, aa), XMVectorScale(ax, ab)), invDet), lo, hi);
+		return true;
+	}
+
+	/// <summary>
+	/// 主成分の方向に沿った両端を初期エンドポイントとして求める
+	/// </summary>
+	inline void FindPrincipalEndpoints(const XMVECTOR* pTarget, XMVECTOR& a, XMVECTOR& b)
+	{
+		auto mean = XMVectorZero();
+		for (auto i = 0; i < 16; ++i)
+		{
+			mean = XMVectorAdd(mean, pTarget[i]);
+		}
+		mean = XMVectorScale(mean, 1.0f / 16.0f);
+
+		// 共分散行列 (対称なので6要素)
+		float cov[6] = {};
+		for (auto i = 0; i < 16; ++i)
+		{
+			XMFLOAT4 d;
+			XMStoreFloat4(&d, XMVectorSubtract(pTarget[i], mean));
+			cov[0] += d.x * d.x;
+			cov[1] += d.x * d.y;
+			cov[2] += d.x * d.z;
+			cov[3] += d.y * d.y;
+			cov[4] += d.y * d.z;
+			cov[5] += d.z * d.z;
+		}
+
+		// べき乗法で最大固有値の固有ベクトルを求める
+		auto axis = XMVectorSet(0.57735f, 0.57735f, 0.57735f, 0.0f);
+		for (auto iter = 0; iter < 8; ++iter)
+		{
+			XMFLOAT4 v;
+			XMStoreFloat4(&v, axis);
+			auto next = XMVectorSet(
+				cov[0] * v.x + cov[1] * v.y + cov[2] * v.z,
+				cov[1] * v.x + cov[3] * v.y + cov[4] * v.z,
+				cov[2] * v.x + cov[4] * v.y + cov[5] * v.z,
+				0.0f);
+
+			auto lengthSq = XMVectorGetX(XMVector3LengthSq(next));
+			if (lengthSq < 1e-12f)
+			{
+				break;
+			}
+
+			axis = XMVectorScale(next, 1.0f / std::sqrt(lengthSq));
+		}
+
+		auto minT = FLT_MAX;
+		auto maxT = -FLT_MAX;
+		for (auto i = 0; i < 16; ++i)
+		{
+			auto t = XMVectorGetX(XMVector3Dot(XMVectorSubtract(pTarget[i], mean), axis));
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		auto lo = XMVectorZero();
+		auto hi = XMVectorReplicate(65535.0f);
+		a = XMVectorClamp(XMVectorMultiplyAdd(XMVectorReplicate(minT), axis, mean), lo, hi);
+		b = XMVectorClamp(XMVectorMultiplyAdd(XMVectorReplicate(maxT), axis, mean), lo, hi);
+	}
+
+	/// <summary>
+	/// ブロックをビット列に格納する
+	/// </summary>
+	void PackBlock(const BlockState& state, uint8_t* pBlock)
+	{
+		const auto& mode = Modes[state.ModeIndex];
+
+		int fields[6];
+		for (auto c = 0; c < 3; ++c)
+		{
+			fields[c] = state.Ends.A[c];
+
+			if (mode.Transformed)
+			{
+				int delta;
+				WrapDelta(state.Ends.A[c], state.Ends.B[c], mode.EndpointBits, mode.DeltaBits, delta);
+				fields[3 + c] = delta & ((1 << mode.DeltaBits) - 1);
+			}
+			else
+			{
+				fields[3 + c] = state.Ends.B[c];
+			}
+		}
+
+		BitWriter writer(pBlock);
+		writer.Write(mode.Mode, 5);
+
+		VisitLayout(mode, [&](int field, int bit)
+		{
+			writer.Write(uint32_t(fields[field] >> bit) & 1, 1);
+		});
+
+		// アンカー (先頭ピクセル) のインデックスは最上位ビットを省略する
+		writer.Write(state.Indices[0], 3);
+		for (auto i = 1; i < 16; ++i)
+		{
+			writer.Write(state.Indices[i], 4);
+		}
+	}
+
+	/// <summary>
+	/// 画像からブロックのピクセルを取り出す (範囲外は端のピクセルを複製する)
+	/// </summary>
+	inline void LoadBlock(const CpuImage& image, uint32_t bx, uint32_t by, XMFLOAT4* pPixels)
+	{
+		for (auto y = 0u; y < 4; ++y)
+		{
+			auto sy = std::min(by * 4 + y, image.Height - 1);
+			auto pRow = image.GetRow(sy);
+			for (auto x = 0u; x < 4; ++x)
+			{
+				auto sx = std::min(bx * 4 + x, image.Width - 1);
+				pPixels[y * 4 + x] = pRow[sx];
+			}
+		}
+	}
+
+	/// <summary>
+	/// 展開したブロックを画像に書き込む (範囲外は捨てる)
+	/// </summary>
+	inline void StoreBlock(const XMFLOAT4* pPixels, uint32_t bx, uint32_t by, CpuImage& image)
+	{
+		for (auto y = 0u; y < 4 && by * 4 + y < image.Height; ++y)
+		{
+			auto pRow = image.GetRow(by * 4 + y);
+			for (auto x = 0u; x < 4 && bx * 4 + x < image.Width; ++x)
+			{
+				pRow[bx * 4 + x] = pPixels[y * 4 + x];
+			}
+		}
+	}
+}
+
+void EncodeBC6HBlock(const XMFLOAT4* pPixels, uint8_t* pBlock)
+{
+	// 半精度のビット表現 (誤差の評価に使う) と, そこから逆算した補間空間の値 (エンドポイントの推定に使う)
+	XMVECTOR half[16];
+	XMVECTOR target[16];
+
+	auto lo = XMVectorZero();
+	auto hi = XMVectorReplicate(65504.0f);
+	auto toInterp = XMVectorReplicate(64.0f / 31.0f);
+
+	for (auto i = 0; i < 16; ++i)
+	{
+		// NaNは0にする (XMVectorClampはNaNを通すため先に置き換える)
+		auto v = XMLoadFloat4(&pPixels[i]);
+		v = XMVectorSelect(v, lo, XMVectorIsNaN(v));
+		v = XMVectorClamp(v, lo, hi);
+
+		XMFLOAT4 f;
+		XMStoreFloat4(&f, v);
+
+		auto r = std::min(int(PackedVector::XMConvertFloatToHalf(f.x)), MaxHalf);
+		auto g = std::min(int(PackedVector::XMConvertFloatToHalf(f.y)), MaxHalf);
+		auto b = std::min(int(PackedVector::XMConvertFloatToHalf(f.z)), MaxHalf);
+
+		half[i] = XMVectorSet(float(r), float(g), float(b), 0.0f);
+		target[i] = XMVectorMultiply(half[i], toInterp);
+	}
+
+	XMVECTOR a;
+	XMVECTOR b;
+	FindPrincipalEndpoints(target, a, b);
+
+	BlockState best;
+
+	for (auto m = 0u; m < ModeCount; ++m)
+	{
+		const auto& mode = Modes[m];
+
+		BlockState state;
+		TryEndpoints(m, QuantizeEndpoints(mode, a, b), half, state);
+
+		// 選ばれたインデックスでエンドポイントを求め直す
+		auto ra = a;
+		auto rb = b;
+		for (auto iter = 0u; iter < RefineIterations && state.Error < FLT_MAX; ++iter)
+		{
+			if (!RefitEndpoints(target, state.Indices, ra, rb))
+			{
+				break;
+			}
+
+			TryEndpoints(m, QuantizeEndpoints(mode, ra, rb), half, state);
+		}
+
+		if (state.Error < best.Error)
+		{
+			best = state;
+		}
+	}
+
+	// 最良のモードでエンドポイントを1ずつ動かして改善を試みる
+	{
+		const auto& mode = Modes[best.ModeIndex];
+		auto maxValue = (1 << mode.EndpointBits) - 1;
+
+		for (auto c = 0; c < 6; ++c)
+		{
+			for (auto step = -1; step <= 1; step += 2)
+			{
+				auto ends = best.Ends;
+				auto& value = (c < 3) ? ends.A[c] : ends.B[c - 3];
+				value += step;
+				if (value < 0 || value > maxValue)
+				{
+					continue;
+				}
+
+				TryEndpoints(best.ModeIndex, ends, half, best);
+			}
+		}
+	}
+
+	// アンカーのインデックスの最上位ビットが0になるようにエンドポイントを入れ替える
+	// ウェイトは対称なので誤差は変わらない
+	if (best.Indices[0] >= IndexCount / 2)
+	{
+		std::swap(best.Ends.A, best.Ends.B);
+		for (auto& index : best.Indices)
+		{
+			index = uint8_t(IndexCount - 1 - index);
+		}
+	}
+
+	PackBlock(best, pBlock);
+}
+
+bool DecodeBC6HBlock(const uint8_t* pBlock, XMFLOAT4* pPixels)
+{
+	BitReader reader(pBlock);
+
+	const ModeInfo* pMode = nullptr;
+	auto modeBits = reader.Read(5);
+	for (auto& mode : Modes)
+	{
+		if (mode.Mode == modeBits)
+		{
+			pMode = &mode;
+			break;
+		}
+	}
+
+	if (pMode == nullptr)
+	{
+		for (auto i = 0; i < 16; ++i)
+		{
+			pPixels[i] = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+		return false;
+	}
+
+	int fields[6] = {};
+	VisitLayout(*pMode, [&](int field, int bit)
+	{
+		fields[field] |= int(reader.Read(1)) << bit;
+	});
+
+	int ua[3];
+	int ub[3];
+	auto mask = (1 << pMode->EndpointBits) - 1;
+	for (auto c = 0; c < 3; ++c)
+	{
+		auto b = fields[3 + c];
+		if (pMode->Transformed)
+		{
+			// 差分を符号拡張して1つ目のエンドポイントに加える
+			auto signBit = 1 << (pMode->DeltaBits - 1);
+			auto delta = (b & (signBit - 1)) - (b & signBit);
+			b = (fields[c] + delta) & mask;
+		}
+
+		ua[c] = Unquantize(fields[c], pMode->EndpointBits);
+		ub[c] = Unquantize(b, pMode->EndpointBits);
+	}
+
+	reader.Seek(IndexOffset);
+	for (auto i = 0; i < 16; ++i)
+	{
+		auto w = Weights[reader.Read((i == 0) ? 3 : 4)];
+
+		float value[3];
+		for (auto c = 0; c < 3; ++c)
+		{
+			auto bits = FinishUnquantize((ua[c] * (64 - w) + ub[c] * w + 32) >> 6);
+			value[c] = PackedVector::XMConvertHalfToFloat(PackedVector::HALF(bits));
+		}
+
+		pPixels[i] = XMFLOAT4(value[0], value[1], value[2], 1.0f);
+	}
+
+	return true;
+}
+
+void EncodeBC6H(const CpuImage& image, uint8_t* pBlocks, uint32_t threadCount)
+{
+	if (image.Width == 0 || image.Height == 0)
+	{
+		return;
+	}
+
+	auto blocksX = (image.Width + 3) / 4;
+	auto blocksY = (image.Height + 3) / 4;
+
+	ParallelFor(0, blocksY, [&](uint32_t by)
+	{
+		XMFLOAT4 pixels[16];
+		for (auto bx = 0u; bx < blocksX; ++bx)
+		{
+			LoadBlock(image, bx, by, pixels);
+			EncodeBC6HBlock(pixels, pBlocks + (size_t(by) * blocksX + bx) * BC6HBlockSize);
+		}
+	}, threadCount);
+}
+
+bool DecodeBC6H(const uint8_t* pBlocks, uint32_t width, uint32_t height, CpuImage& result)
+{
+	result.Resize(width, height);
+
+	auto blocksX = (width + 3) / 4;
+	auto blocksY = (height + 3) / 4;
+	auto succeeded = true;
+
+	for (auto by = 0u; by < blocksY; ++by)
+	{
+		for (auto bx = 0u; bx < blocksX; ++bx)
+		{
+			XMFLOAT4 pixels[16];
+			succeeded &= DecodeBC6HBlock(pBlocks + (size_t(by) * blocksX + bx) * BC6HBlockSize, pixels);
+			StoreBlock(pixels, bx, by, result);
+		}
+	}
+
+	return succeeded;
+}
+
+void EncodeBC6HCube(const CpuCubeMap& cube, std::vector<uint8_t>& blocks, uint32_t threadCount)
+{
+	// 各画像の先頭ブロック番号を求めておき, 全ての面とミップのブロックをまとめて分配する
+	// (下位のミップは小さいため画像単位で分配すると並列度が足りない)
+	std::vector<uint32_t> offsets(cube.Images.size() + 1, 0);
+	for (size_t i = 0; i < cube.Images.size(); ++i)
+	{
+		offsets[i + 1] = offsets[i] + CalcBC6HBlockCount(cube.Images[i].Width, cube.Images[i].Height);
+	}
+
+	blocks.resize(size_t(offsets.back()) * BC6HBlockSize);
+
+	ParallelFor(0, offsets.back(), [&](uint32_t block)
+	{
+		auto it = std::upper_bound(offsets.begin(), offsets.end(), block) - 1;
+		auto imageIndex = size_t(it - offsets.begin());
+
+		const auto& image = cube.Images[imageIndex];
+		auto local = block - *it;
+		auto blocksX = (image.Width + 3) / 4;
+
+		XMFLOAT4 pixels[16];
+		LoadBlock(image, local % blocksX, local / blocksX, pixels);
+		EncodeBC6HBlock(pixels, blocks.data() + size_t(block) * BC6HBlockSize);
+	}, threadCount);
+}
+
+bool DecodeBC6HCube(const std::vector<uint8_t>& blocks, uint32_t size, uint32_t mipCount, CpuCubeMap& result)
+{
+	result.Resize(size, mipCount);
+
+	size_t offset = 0;
+	for (auto& image : result.Images)
+	{
+		auto byteCount = size_t(CalcBC6HBlockCount(image.Width, image.Height)) * BC6HBlockSize;
+		if (offset + byteCount > blocks.size())
+		{
+			return false;
+		}
+
+		if (!DecodeBC6H(blocks.data() + offset, image.Width, image.Height, image))
+		{
+			return false;
+		}
+
+		offset += byteCount;
+	}
+
+	return true;
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "CubeMapUtil.h"
+
+/// <summary>
+/// BC6H (DXGI_FORMAT_BC6H_UF16) の1ブロックあたりのバイト数
+/// </summary>
+static const uint32_t BC6HBlockSize = 16;
+
+/// <summary>
+/// 4x4ピクセルを BC6H_UF16 の1ブロックに圧縮する
+/// 1リージョンのモード (10.10, 11.9, 12.8, 16.4) を全て試し, 半精度のビット表現上の二乗誤差が最小のものを選択する
+/// 負の値とNaNは0に, 半精度の最大値を超える値は最大値にクランプする
+/// </summary>
+/// <param name="pPixels">16ピクセル分の入力 (行優先)</param>
+/// <param name="pBlock">出力先 (16バイト)</param>
+void EncodeBC6HBlock(const DirectX::XMFLOAT4* pPixels, uint8_t* pBlock);
+
+/// <summary>
+/// BC6H_UF16 の1ブロックを展開する
+/// 対応するのは EncodeBC6HBlock() が出力する1リージョンのモードのみ
+/// </summary>
+/// <param name="pBlock">入力 (16バイト)</param>
+/// <param name="pPixels">16ピクセル分の出力先 (行優先, アルファは1)</param>
+/// <returns>対応しているモードの場合はtrue</returns>
+bool DecodeBC6HBlock(const uint8_t* pBlock, DirectX::XMFLOAT4* pPixels);
+
+/// <summary>
+/// 画像のブロック数を求める (4の倍数でない場合は切り上げ)
+/// </summary>
+/// <param name="width">横幅</param>
+/// <param name="height">縦幅</param>
+/// <returns>ブロック数</returns>
+inline uint32_t CalcBC6HBlockCount(uint32_t width, uint32_t height)
+{
+	return ((width + 3) / 4) * ((height + 3) / 4);
+}
+
+/// <summary>
+/// 画像を BC6H_UF16 に圧縮する
+/// 画像の端で4x4に満たないブロックは端のピクセルを複製して埋める
+/// </summary>
+/// <param name="image">入力画像</param>
+/// <param name="pBlocks">出力先 (CalcBC6HBlockCount() * BC6HBlockSize バイト, 行優先のブロック列)</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+void EncodeBC6H(const CpuImage& image, uint8_t* pBlocks, uint32_t threadCount = 0);
+
+/// <summary>
+/// BC6H_UF16 のブロック列を展開する
+/// </summary>
+/// <param name="pBlocks">入力ブロック列</param>
+/// <param name="width">画像の横幅</param>
+/// <param name="height">画像の縦幅</param>
+/// <param name="result">展開結果の格納先</param>
+/// <returns>全てのブロックが対応しているモードの場合はtrue</returns>
+bool DecodeBC6H(const uint8_t* pBlocks, uint32_t width, uint32_t height, CpuImage& result);
+
+/// <summary>
+/// キューブマップを BC6H_UF16 に圧縮する
+/// 全ての面とミップのブロックをまとめてスレッドに分配する
+/// </summary>
+/// <param name="cube">入力キューブマップ</param>
+/// <param name="blocks">出力先 (Images と同じ並びで各画像のブロック列を連結する)</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+void EncodeBC6HCube(const CpuCubeMap& cube, std::vector<uint8_t>& blocks, uint32_t threadCount = 0);
+
+/// <summary>
+/// EncodeBC6HCube() で圧縮したブロック列を展開する
+/// </summary>
+/// <param name="blocks">入力ブロック列</param>
+/// <param name="size">1面の横幅</param>
+/// <param name="mipCount">ミップレベル数</param>
+/// <param name="result">展開結果の格納先</param>
+/// <returns>展開に成功した場合はtrue</returns>
+bool DecodeBC6HCube(const std::vector<uint8_t>& blocks, uint32_t size, uint32_t mipCount, CpuCubeMap& result);
@@ -13,6 +13,10 @@ struct VSInput
     float3 Normal : NORMAL; // @xNgł.
     float2 TexCoord : TEXCOORD; // eNX`Wł.
     float3 Tangent : TANGENT; // ڐxNgł.
+    float4 InstanceWorld0 : INSTANCE_WORLD0; // CX^X̃[hs1sڂł.
+    float4 InstanceWorld1 : INSTANCE_WORLD1; // CX^X̃[hs2sڂł.
+    float4 InstanceWorld2 : INSTANCE_WORLD2; // CX^X̃[hs3sڂł.
+    float4 InstanceWorld3 : INSTANCE_WORLD3; // CX^X̃[hs4sڂł.
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -43,6 +47,15 @@ cbuffer CbMesh : register(b1)
     float4x4 World : packoffset(c0); // [hsł.
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// CbDraw constant buffer
+///////////////////////////////////////////////////////////////////////////////
+cbuffer CbDraw : register(b3)
+{
+    uint DrawId; // `ԍł ([g萔, Ԑڕ`ł͈obt@ݒ肳܂).
+    uint MaterialId; // }eAԍł (oChX`Ŏgp܂).
+};
+
 //-----------------------------------------------------------------------------
 //      _VF[_̃CGg[|Cgł.
 //-----------------------------------------------------------------------------
@@ -50,7 +63,10 @@ VSOutput main(VSInput input)
 {
     VSOutput output = (VSOutput) 0;
 
-    float4 localPos = float4(input.Position, 1.0f);
+    // CX^X̕ϊ͍sxNg`Ȃ̂ō|܂.
+    float4x4 instanceWorld = float4x4(input.InstanceWorld0, input.InstanceWorld1, input.InstanceWorld2, input.InstanceWorld3);
+
+    float4 localPos = mul(float4(input.Position, 1.0f), instanceWorld);
     float4 worldPos = mul(World, localPos);
     float4 viewPos = mul(View, worldPos);
     float4 projPos = mul(Proj, viewPos);
@@ -60,8 +76,8 @@ VSOutput main(VSInput input)
     output.WorldPos = worldPos.xyz;
 
     // xNg
-    float3 N = normalize(mul((float3x3) World, input.Normal));
-    float3 T = normalize(mul((float3x3) World, input.Tangent));
+    float3 N = normalize(mul((float3x3) World, mul(input.Normal, (float3x3) instanceWorld)));
+    float3 T = normalize(mul((float3x3) World, mul(input.Tangent, (float3x3) instanceWorld)));
     float3 B = normalize(cross(N, T));
 
     // ϊs̋ts.
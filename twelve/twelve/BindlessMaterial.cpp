@@ -0,0 +1,157 @@
+﻿#include "BindlessMaterial.h"
+
+#include "DescriptorPool.h"
+#include "Logger.h"
+#include "Material.h"
+
+BindlessMaterialTable::BindlessMaterialTable()
+	: m_pHandle(nullptr)
+	, m_pPool(nullptr)
+{
+}
+
+BindlessMaterialTable::~BindlessMaterialTable()
+{
+	Term();
+}
+
+bool BindlessMaterialTable::Init(
+	ID3D12Device* pDevice,
+	DescriptorPool* pPool,
+	const Material& material)
+{
+	if (pDevice == nullptr || pPool == nullptr || material.GetCount() == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	Term();
+
+	m_pPool = pPool;
+	m_pPool->AddRef();
+
+	// テクスチャの番号を求める (設定されていない用途はダミーテクスチャを参照する)
+	auto dummyIndex = pPool->GetHandleIndex(material.GetDummyTextureHandle());
+	if (dummyIndex == UINT32_MAX)
+	{
+		ELOG("Error : Dummy Texture Not Found.");
+		return false;
+	}
+
+	auto getIndex = [&](size_t index, Material::TEXTURE_USAGE usage)
+	{
+		auto result = pPool->GetHandleIndex(material.GetTextureHandle(index, usage));
+		return (result == UINT32_MAX) ? dummyIndex : result;
+	};
+
+	m_Data.resize(material.GetCount());
+	for (size_t i = 0; i < m_Data.size(); ++i)
+	{
+		auto& data = m_Data[i];
+		data = {};
+		data.BaseColorMap = getIndex(i, TU_BASE_COLOR);
+		data.ORMMap = getIndex(i, TU_ORM);
+		data.NormalMap = getIndex(i, TU_NORMAL);
+	}
+
+	// 構造化バッファの生成
+	{
+		D3D12_HEAP_PROPERTIES prop = {};
+		prop.Type = D3D12_HEAP_TYPE_UPLOAD;
+		prop.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		prop.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		prop.CreationNodeMask = 1;
+		prop.VisibleNodeMask = 1;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Alignment = 0;
+		desc.Width = UINT64(sizeof(BindlessMaterialData) * m_Data.size());
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		auto hr = pDevice->CreateCommittedResource(
+			&prop,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(m_pBuffer.GetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreateCommittedResource() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		void* ptr = nullptr;
+		hr = m_pBuffer->Map(0, nullptr, &ptr);
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Resource::Map() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		memcpy(ptr, m_Data.data(), sizeof(BindlessMaterialData) * m_Data.size());
+
+		m_pBuffer->Unmap(0, nullptr);
+	}
+
+	// シェーダーリソースビューの生成
+	{
+		m_pHandle = pPool->AllocHandle();
+		if (m_pHandle == nullptr)
+		{
+			ELOG("Error : DescriptorPool::AllocHandle() Failed.");
+			return false;
+		}
+
+		D3D12_SHADER_RESOURCE_VIEW_DESC desc = {};
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+		desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		desc.Buffer.FirstElement = 0;
+		desc.Buffer.NumElements = UINT(m_Data.size());
+		desc.Buffer.StructureByteStride = sizeof(BindlessMaterialData);
+		desc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+
+		pDevice->CreateShaderResourceView(m_pBuffer.Get(), &desc, m_pHandle->HandleCPU);
+	}
+
+	return true;
+}
+
+void BindlessMaterialTable::Term()
+{
+	m_pBuffer.Reset();
+
+	if (m_pHandle != nullptr && m_pPool != nullptr)
+	{
+		m_pPool->FreeHandle(m_pHandle);
+		m_pHandle = nullptr;
+	}
+
+	if (m_pPool != nullptr)
+	{
+		m_pPool->Release();
+		m_pPool = nullptr;
+	}
+
+	m_Data.clear();
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE BindlessMaterialTable::GetHandleGPU() const
+{
+	if (m_pHandle == nullptr)
+	{
+		return D3D12_GPU_DESCRIPTOR_HANDLE();
+	}
+
+	return m_pHandle->HandleGPU;
+}
@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <cstdint>
+#include <vector>
+
+#include "ComPtr.h"
+
+class DescriptorHandle;
+class DescriptorPool;
+class Material;
+
+/// <summary>
+/// バインドレス描画でシェーダーが参照するマテリアルのデータ (StructuredBuffer の要素)
+/// テクスチャはリソース用ディスクリプタヒープの先頭からの番号で参照する
+/// 従来の描画と同じ見た目にするため, マテリアルの係数は持たずテクスチャのみを参照する
+/// </summary>
+struct BindlessMaterialData
+{
+	uint32_t	BaseColorMap;	// ベースカラーマップの番号
+	uint32_t	ORMMap;			// ORMマップの番号
+	uint32_t	NormalMap;		// 法線マップの番号
+	uint32_t	Reserved;
+};
+
+static_assert(sizeof(BindlessMaterialData) == 16, "BindlessMaterialData must match the shader layout.");
+
+/// <summary>
+/// 全マテリアルのデータをまとめた構造化バッファ
+/// 描画ごとにはルート定数でマテリアル番号だけを渡すので, マテリアル数に応じてルート引数は増えない
+/// </summary>
+class BindlessMaterialTable
+{
+public:
+	BindlessMaterialTable();
+	~BindlessMaterialTable();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="pPool">リソース用のディスクリプタプール (テクスチャと同じシェーダー可視ヒープ)</param>
+	/// <param name="material">テクスチャを設定済みのマテリアル</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Init(
+		ID3D12Device* pDevice,
+		DescriptorPool* pPool,
+		const Material& material);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// 構造化バッファのシェーダーリソースビューを取得する
+	/// </summary>
+	D3D12_GPU_DESCRIPTOR_HANDLE GetHandleGPU() const;
+
+	uint32_t GetCount() const { return uint32_t(m_Data.size()); }
+
+	const BindlessMaterialData& GetData(size_t index) const { return m_Data[index]; }
+
+private:
+	ComPtr<ID3D12Resource>				m_pBuffer;	// 構造化バッファ (アップロードヒープ. 初期化時のみ書き込む)
+	DescriptorHandle*					m_pHandle;	// シェーダーリソースビュー
+	DescriptorPool*						m_pPool;	// ディスクリプタプール
+	std::vector<BindlessMaterialData>	m_Data;		// 書き込んだデータ
+
+	BindlessMaterialTable(const BindlessMaterialTable&) = delete;
+	void operator=(const BindlessMaterialTable&) = delete;
+};
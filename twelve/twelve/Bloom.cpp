@@ -0,0 +1,472 @@
+﻿#include "Bloom.h"
+
+#include <algorithm>
+#include <cstring>
+#include <SimpleMath.h>
+#include <CommonStates.h>
+#include <DirectXHelpers.h>
+#include <DirectXTex.h>
+
+#include "CubeMapUtil.h"
+#include "Logger.h"
+
+using namespace DirectX::SimpleMath;
+
+namespace
+{
+#include "../Compiled/QuadVS.inc"
+#include "../Compiled/BloomDownsamplePS.inc"
+#include "../Compiled/BloomBlurPS.inc"
+#include "../Compiled/BloomUpsamplePS.inc"
+
+	struct alignas(256) CbBloom
+	{
+		DirectX::XMFLOAT4	Weights[2];		// ガウスウェイト (先頭が中心)
+		DirectX::XMFLOAT2	DstInvSize;		// 出力のテクセルサイズ
+		DirectX::XMINT2		Direction;		// ブラーの方向
+		float				Threshold;		// 輝度抽出のしきい値 (負の場合は抽出しない)
+		float				Knee;			// しきい値付近をなめらかにつなぐ幅
+		DirectX::XMFLOAT2	SrcUVScale;		// 入力の描画範囲のテクスチャ座標のスケール
+	};
+
+	static_assert(BloomTapCount <= 8, "Bloom tap count exceeds CbBloom::Weights.");
+
+	/// <summary>
+	/// 定数バッファを設定する
+	/// </summary>
+	void SetBloomCB(
+		ConstantBuffer& cb,
+		const std::vector<float>& weights,
+		uint32_t width,
+		uint32_t height,
+		int directionX,
+		int directionY,
+		float threshold,
+		float knee)
+	{
+		auto ptr = cb.GetPtr<CbBloom>();
+		memset(ptr->Weights, 0, sizeof(ptr->Weights));
+		memcpy(ptr->Weights, weights.data(), sizeof(float) * weights.size());
+		ptr->DstInvSize = DirectX::XMFLOAT2(1.0f / float(width), 1.0f / float(height));
+		ptr->Direction = DirectX::XMINT2(directionX, directionY);
+		ptr->Threshold = threshold;
+		ptr->Knee = knee;
+		ptr->SrcUVScale = DirectX::XMFLOAT2(1.0f, 1.0f);
+	}
+}
+
+Bloom::Bloom()
+	: m_LevelCount(0)
+{
+	for (auto i = 0u; i < BloomMaxLevelCount; ++i)
+	{
+		m_LevelState[i] = D3D12_RESOURCE_STATE_RENDER_TARGET;
+	}
+}
+
+Bloom::~Bloom()
+{
+	Term();
+}
+
+bool Bloom::Init
+(
+	ID3D12Device* pDevice,
+	DescriptorPool* pPoolRes,
+	DescriptorPool* pPoolRTV,
+	uint32_t width,
+	uint32_t height,
+	const BloomParam& param,
+	PipelineCache* pPipelineCache
+)
+{
+	if (pDevice == nullptr || pPoolRes == nullptr || pPoolRTV == nullptr || width == 0 || height == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	m_Param = param;
+	m_LevelCount = CalcBloomLevelCount(width, height, param.LevelCount);
+
+	// 頂点バッファの生成
+	{
+		struct Vertex
+		{
+			Vector2 Position;
+			Vector2 TexCoord;
+		};
+
+		// テクスチャ座標はシェーダーで SV_POSITION から求めるので使用しない
+		Vertex vertices[] = {
+			{ Vector2(-1.0f,  1.0f), Vector2(0.0f, 0.0f) },
+			{ Vector2(3.0f,  1.0f), Vector2(2.0f, 0.0f) },
+			{ Vector2(-1.0f, -3.0f), Vector2(0.0f, 2.0f) },
+		};
+
+		if (!m_QuadVB.Init<Vertex>(pDevice, 3, vertices))
+		{
+			ELOG("Error : VertexBuffer::Init() Failed.");
+			return false;
+		}
+	}
+
+	// ルートシグネチャの生成
+	{
+		RootSignature::Desc desc;
+		desc.Begin(2)
+			.SetCBV(ShaderStage::PS, 0, 0)
+			.SetSRV(ShaderStage::PS, 1, 0)
+			.AddStaticSmp(ShaderStage::PS, 0, SamplerState::LinearClamp)
+			.AllowIL()
+			.End();
+
+		if (!m_RootSignature.Init(pDevice, desc.GetDesc()))
+		{
+			ELOG("Error : RootSignature::Init() Failed.");
+			return false;
+		}
+	}
+
+	// パイプラインステートの生成
+	{
+		D3D12_INPUT_ELEMENT_DESC elements[] = {
+			{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+		};
+
+		// 拡大加算用のブレンドステート (アルファはシェーダーで0を出力する)
+		D3D12_BLEND_DESC additive = DirectX::CommonStates::Opaque;
+		additive.RenderTarget[0].BlendEnable = TRUE;
+		additive.RenderTarget[0].SrcBlend = D3D12_BLEND_ONE;
+		additive.RenderTarget[0].DestBlend = D3D12_BLEND_ONE;
+		additive.RenderTarget[0].BlendOp = D3D12_BLEND_OP_ADD;
+		additive.RenderTarget[0].SrcBlendAlpha = D3D12_BLEND_ONE;
+		additive.RenderTarget[0].DestBlendAlpha = D3D12_BLEND_ONE;
+		additive.RenderTarget[0].BlendOpAlpha = D3D12_BLEND_OP_ADD;
+
+		struct PipelineEntry
+		{
+			D3D12_SHADER_BYTECODE			PS;
+			D3D12_BLEND_DESC				Blend;
+			ComPtr<ID3D12PipelineState>*	pPSO;
+		};
+
+		PipelineEntry entries[] = {
+			{ { BloomDownsamplePS, sizeof(BloomDownsamplePS) }, DirectX::CommonStates::Opaque, &m_pDownsamplePSO },
+			{ { BloomBlurPS, sizeof(BloomBlurPS) }, DirectX::CommonStates::Opaque, &m_pBlurPSO },
+			{ { BloomUpsamplePS, sizeof(BloomUpsamplePS) }, additive, &m_pUpsamplePSO },
+		};
+
+		for (auto& entry : entries)
+		{
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+			desc.InputLayout = { elements, _countof(elements) };
+			desc.pRootSignature = m_RootSignature.GetPtr();
+			desc.VS = { QuadVS, sizeof(QuadVS) };
+			desc.PS = entry.PS;
+			desc.RasterizerState = DirectX::CommonStates::CullNone;
+			desc.BlendState = entry.Blend;
+			desc.DepthStencilState = DirectX::CommonStates::DepthNone;
+			desc.SampleMask = UINT_MAX;
+			desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+			desc.NumRenderTargets = 1;
+			desc.RTVFormats[0] = Format;
+			desc.DSVFormat = DXGI_FORMAT_UNKNOWN;
+			desc.SampleDesc.Count = 1;
+			desc.SampleDesc.Quality = 0;
+
+			if (!CreateGraphicsPipeline(pDevice, pPipelineCache, desc, m_RootSignature.GetHash(), entry.pPSO->GetAddressOf()))
+			{
+				return false;
+			}
+		}
+	}
+
+	// 各レベルのレンダーターゲットの生成
+	{
+		float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+		for (auto i = 0u; i < m_LevelCount; ++i)
+		{
+			auto w = CalcBloomLevelSize(width, i);
+			auto h = CalcBloomLevelSize(height, i);
+
+			if (!m_Level[i].Init(pDevice, pPoolRTV, pPoolRes, w, h, Format, clearColor))
+			{
+				ELOG("Error : ColorTarget::Init() Failed.");
+				return false;
+			}
+
+			if (!m_Temp[i].Init(pDevice, pPoolRTV, pPoolRes, w, h, Format, clearColor))
+			{
+				ELOG("Error : ColorTarget::Init() Failed.");
+				return false;
+			}
+
+			m_LevelState[i] = D3D12_RESOURCE_STATE_RENDER_TARGET;
+		}
+	}
+
+	// 定数バッファの生成 (輝度抽出以外は初期化時に確定する)
+	{
+		auto weights = CalcBloomWeights(m_Param.Sigma);
+
+		for (auto i = 0u; i < Constants::MaxFrameCount; ++i)
+		{
+			if (!m_PrefilterCB[i].Init(pDevice, pPoolRes, sizeof(CbBloom)))
+			{
+				ELOG("Error : ConstantBuffer::Init() Failed.");
+				return false;
+			}
+
+			SetBloomCB(m_PrefilterCB[i], weights,
+				CalcBloomLevelSize(width, 0), CalcBloomLevelSize(height, 0),
+				0, 0, m_Param.Threshold, m_Param.Knee);
+		}
+
+		for (auto i = 0u; i < m_LevelCount; ++i)
+		{
+			auto w = CalcBloomLevelSize(width, i);
+			auto h = CalcBloomLevelSize(height, i);
+
+			if (!m_DownsampleCB[i].Init(pDevice, pPoolRes, sizeof(CbBloom))
+				|| !m_BlurCB[i][0].Init(pDevice, pPoolRes, sizeof(CbBloom))
+				|| !m_BlurCB[i][1].Init(pDevice, pPoolRes, sizeof(CbBloom))
+				|| !m_UpsampleCB[i].Init(pDevice, pPoolRes, sizeof(CbBloom)))
+			{
+				ELOG("Error : ConstantBuffer::Init() Failed.");
+				return false;
+			}
+
+			SetBloomCB(m_DownsampleCB[i], weights, w, h, 0, 0, -1.0f, 0.0f);
+			SetBloomCB(m_BlurCB[i][0], weights, w, h, 1, 0, -1.0f, 0.0f);
+			SetBloomCB(m_BlurCB[i][1], weights, w, h, 0, 1, -1.0f, 0.0f);
+			SetBloomCB(m_UpsampleCB[i], weights, w, h, 0, 0, -1.0f, 0.0f);
+		}
+	}
+
+	return true;
+}
+
+void Bloom::Term()
+{
+	for (auto i = 0u; i < Constants::MaxFrameCount; ++i)
+	{
+		m_PrefilterCB[i].Term();
+	}
+
+	for (auto i = 0u; i < BloomMaxLevelCount; ++i)
+	{
+		m_DownsampleCB[i].Term();
+		m_BlurCB[i][0].Term();
+		m_BlurCB[i][1].Term();
+		m_UpsampleCB[i].Term();
+		m_Level[i].Term();
+		m_Temp[i].Term();
+		m_LevelState[i] = D3D12_RESOURCE_STATE_RENDER_TARGET;
+	}
+
+	m_QuadVB.Term();
+	m_pDownsamplePSO.Reset();
+	m_pBlurPSO.Reset();
+	m_pUpsamplePSO.Reset();
+	m_RootSignature.Term();
+
+	m_LevelCount = 0;
+}
+
+void Bloom::Draw(ID3D12GraphicsCommandList* pCmd, D3D12_GPU_DESCRIPTOR_HANDLE handleSRV, uint32_t frameIndex, const DirectX::XMFLOAT2& srcUVScale)
+{
+	if (m_LevelCount == 0)
+	{
+		return;
+	}
+
+	// 輝度抽出のパラメータを更新
+	{
+		auto ptr = m_PrefilterCB[frameIndex].GetPtr<CbBloom>();
+		ptr->Threshold = std::max(m_Param.Threshold, 0.0f);
+		ptr->Knee = m_Param.Knee;
+		ptr->SrcUVScale = srcUVScale;
+	}
+
+	pCmd->SetGraphicsRootSignature(m_RootSignature.GetPtr());
+	pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	auto vbView = m_QuadVB.GetView();
+	pCmd->IASetVertexBuffers(0, 1, &vbView);
+
+	// 輝度抽出と縮小 (縮小はブラー前の画像から行う)
+	for (auto i = 0u; i < m_LevelCount; ++i)
+	{
+		TransitionLevel(pCmd, i, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+		if (i == 0)
+		{
+			DrawQuad(pCmd, m_pDownsamplePSO.Get(), m_Level[0], m_PrefilterCB[frameIndex].GetHandleGPU(), handleSRV);
+		}
+		else
+		{
+			DrawQuad(pCmd, m_pDownsamplePSO.Get(), m_Level[i], m_DownsampleCB[i].GetHandleGPU(), m_Level[i - 1].GetHandleSRV()->HandleGPU);
+		}
+
+		TransitionLevel(pCmd, i, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	}
+
+	// 各レベルのガウスブラー (横方向は作業用のターゲットに書き出す)
+	for (auto i = 0u; i < m_LevelCount; ++i)
+	{
+		DrawQuad(pCmd, m_pBlurPSO.Get(), m_Temp[i], m_BlurCB[i][0].GetHandleGPU(), m_Level[i].GetHandleSRV()->HandleGPU);
+
+		DirectX::TransitionResource(
+			pCmd,
+			m_Temp[i].GetResource(),
+			D3D12_RESOURCE_STATE_RENDER_TARGET,
+			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+		TransitionLevel(pCmd, i, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		DrawQuad(pCmd, m_pBlurPSO.Get(), m_Level[i], m_BlurCB[i][1].GetHandleGPU(), m_Temp[i].GetHandleSRV()->HandleGPU);
+		TransitionLevel(pCmd, i, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+		DirectX::TransitionResource(
+			pCmd,
+			m_Temp[i].GetResource(),
+			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+			D3D12_RESOURCE_STATE_RENDER_TARGET);
+	}
+
+	// 小さいレベルから順に拡大加算
+	for (auto i = m_LevelCount - 1; i > 0; --i)
+	{
+		TransitionLevel(pCmd, i - 1, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		DrawQuad(pCmd, m_pUpsamplePSO.Get(), m_Level[i - 1], m_UpsampleCB[i - 1].GetHandleGPU(), m_Level[i].GetHandleSRV()->HandleGPU);
+		TransitionLevel(pCmd, i - 1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	}
+}
+
+bool Bloom::Capture(ID3D12CommandQueue* pQueue, const wchar_t* path)
+{
+	if (pQueue == nullptr || path == nullptr || m_LevelCount == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	DirectX::ScratchImage image;
+	auto hr = DirectX::CaptureTexture(pQueue, m_Level[0].GetResource(), false, image, m_LevelState[0], m_LevelState[0]);
+	if (FAILED(hr))
+	{
+		ELOG("Error : DirectX::CaptureTexture() Failed. retcode = 0x%x", hr);
+		return false;
+	}
+
+	hr = DirectX::SaveToDDSFile(
+		image.GetImages(),
+		image.GetImageCount(),
+		image.GetMetadata(),
+		DirectX::DDS_FLAGS_NONE,
+		path);
+	if (FAILED(hr))
+	{
+		ELOG("Error : DirectX::SaveToDDSFile() Failed. path = %ls, retcode = 0x%x", path, hr);
+		return false;
+	}
+
+	return true;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE Bloom::GetHandleGPU() const
+{
+	return m_Level[0].GetHandleSRV()->HandleGPU;
+}
+
+void Bloom::DrawQuad
+(
+	ID3D12GraphicsCommandList* pCmd,
+	ID3D12PipelineState* pPSO,
+	ColorTarget& target,
+	D3D12_GPU_DESCRIPTOR_HANDLE handleCBV,
+	D3D12_GPU_DESCRIPTOR_HANDLE handleSRV
+)
+{
+	auto desc = target.GetDesc();
+
+	D3D12_VIEWPORT viewport = {};
+	viewport.Width = float(desc.Width);
+	viewport.Height = float(desc.Height);
+	viewport.MinDepth = 0.0f;
+	viewport.MaxDepth = 1.0f;
+
+	D3D12_RECT scissor = {};
+	scissor.right = LONG(desc.Width);
+	scissor.bottom = LONG(desc.Height);
+
+	auto handleRTV = target.GetHandleRTV()->HandleCPU;
+	pCmd->OMSetRenderTargets(1, &handleRTV, FALSE, nullptr);
+
+	pCmd->SetPipelineState(pPSO);
+	pCmd->SetGraphicsRootDescriptorTable(0, handleCBV);
+	pCmd->SetGraphicsRootDescriptorTable(1, handleSRV);
+	pCmd->RSSetViewports(1, &viewport);
+	pCmd->RSSetScissorRects(1, &scissor);
+	pCmd->DrawInstanced(3, 1, 0, 0);
+}
+
+void Bloom::TransitionLevel(ID3D12GraphicsCommandList* pCmd, uint32_t level, D3D12_RESOURCE_STATES state)
+{
+	if (m_LevelState[level] == state)
+	{
+		return;
+	}
+
+	DirectX::TransitionResource(pCmd, m_Level[level].GetResource(), m_LevelState[level], state);
+	m_LevelState[level] = state;
+}
+
+bool ValidateBloomCapture
+(
+	const wchar_t* scenePath,
+	const wchar_t* bloomPath,
+	const BloomParam& param,
+	double minPSNR,
+	ImageError& error
+)
+{
+	error = ImageError();
+
+	if (scenePath == nullptr || bloomPath == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	CpuImage scene;
+	if (!LoadImageRGBA32F(scenePath, scene))
+	{
+		ELOG("Error : LoadImageRGBA32F() Failed. path = %ls", scenePath);
+		return false;
+	}
+
+	CpuImage captured;
+	if (!LoadImageRGBA32F(bloomPath, captured))
+	{
+		ELOG("Error : LoadImageRGBA32F() Failed. path = %ls", bloomPath);
+		return false;
+	}
+
+	std::vector<CpuImage> levels;
+	BuildBloomCPU(scene, param, levels);
+
+	error = CompareImages(levels[0], captured);
+	if (error.RMSE < 0.0)
+	{
+		ELOG("Error : Bloom Capture Size Mismatch. reference = %ux%u, captured = %ux%u",
+			levels[0].Width, levels[0].Height, captured.Width, captured.Height);
+		return false;
+	}
+
+	ILOG("Info : Bloom Capture Validation. RMSE = %.6f, Max = %.6f, PSNR = %.2f dB",
+		error.RMSE, error.MaxError, error.PSNR);
+
+	return error.PSNR >= minPSNR;
+}
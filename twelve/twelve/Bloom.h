@@ -0,0 +1,133 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <DirectXMath.h>
+
+#include "ComPtr.h"
+#include "Constants.h"
+#include "ColorTarget.h"
+#include "ConstantBuffer.h"
+#include "DescriptorPool.h"
+#include "RootSignature.h"
+#include "PipelineCache.h"
+#include "VertexBuffer.h"
+#include "BloomCPU.h"
+
+/// <summary>
+/// 縮小ピラミッドによるブルーム
+/// 輝度抽出と縮小 ---> 各レベルのガウスブラー (横, 縦) ---> 小さいレベルから順に拡大加算 の順に処理する
+/// 同じ処理をCPUで行う BuildBloomCPU() と比較して検証できる
+/// </summary>
+class Bloom
+{
+public:
+	static const DXGI_FORMAT Format = DXGI_FORMAT_R16G16B16A16_FLOAT;	// 各レベルのフォーマット
+
+	Bloom();
+	~Bloom();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="pPoolRes">ディスクリプタプール (CBV/SRV/UAV)</param>
+	/// <param name="pPoolRTV">ディスクリプタプール (RTV)</param>
+	/// <param name="width">入力の横幅</param>
+	/// <param name="height">入力の縦幅</param>
+	/// <param name="param">パラメータ</param>
+	/// <param name="pPipelineCache">パイプラインキャッシュ (nullptrの場合は直接生成する)</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Init(
+		ID3D12Device* pDevice,
+		DescriptorPool* pPoolRes,
+		DescriptorPool* pPoolRTV,
+		uint32_t width,
+		uint32_t height,
+		const BloomParam& param,
+		PipelineCache* pPipelineCache = nullptr);
+
+	void Term();
+
+	/// <summary>
+	/// ブルームを求めるコマンドを記録する
+	/// 入力は D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE の状態であること
+	/// 記録後, 結果 (GetHandleGPU()) は D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE の状態になる
+	/// </summary>
+	/// <param name="pCmd">コマンドリスト</param>
+	/// <param name="handleSRV">入力のSRV</param>
+	/// <param name="frameIndex">フレーム番号</param>
+	/// <param name="srcUVScale">入力の描画範囲のテクスチャ座標のスケール (動的解像度で左上のみに描画した場合)</param>
+	void Draw(ID3D12GraphicsCommandList* pCmd, D3D12_GPU_DESCRIPTOR_HANDLE handleSRV, uint32_t frameIndex, const DirectX::XMFLOAT2& srcUVScale = DirectX::XMFLOAT2(1.0f, 1.0f));
+
+	/// <summary>
+	/// 最後に求めたブルームをファイルに保存する (ValidateBloomCapture() で検証する)
+	/// GPUの完了を待ったあとに呼ぶこと
+	/// </summary>
+	/// <param name="pQueue">コマンドキュー</param>
+	/// <param name="path">保存先 (DDS)</param>
+	/// <returns>保存に成功した場合はtrue</returns>
+	bool Capture(ID3D12CommandQueue* pQueue, const wchar_t* path);
+
+	/// <summary>
+	/// 結果のSRVを取得する (入力の1/2のサイズ)
+	/// </summary>
+	D3D12_GPU_DESCRIPTOR_HANDLE GetHandleGPU() const;
+
+	/// <summary>
+	/// 結果のリソースを取得する (フレームグラフへのインポート用)
+	/// </summary>
+	ID3D12Resource* GetResource() const { return m_Level[0].GetResource(); }
+
+	uint32_t GetLevelCount() const { return m_LevelCount; }
+	BloomParam& GetParam() { return m_Param; }
+
+private:
+	RootSignature				m_RootSignature;
+	ComPtr<ID3D12PipelineState>	m_pDownsamplePSO;
+	ComPtr<ID3D12PipelineState>	m_pBlurPSO;
+	ComPtr<ID3D12PipelineState>	m_pUpsamplePSO;
+	VertexBuffer				m_QuadVB;
+	ColorTarget					m_Level[BloomMaxLevelCount];			// 各レベル (レベル0が最終結果)
+	ColorTarget					m_Temp[BloomMaxLevelCount];				// 横ブラーの結果
+	D3D12_RESOURCE_STATES		m_LevelState[BloomMaxLevelCount];		// 各レベルの現在の状態
+	ConstantBuffer				m_PrefilterCB[Constants::MaxFrameCount];	// 輝度抽出 (フレームごと)
+	ConstantBuffer				m_DownsampleCB[BloomMaxLevelCount];
+	ConstantBuffer				m_BlurCB[BloomMaxLevelCount][2];		// 横, 縦
+	ConstantBuffer				m_UpsampleCB[BloomMaxLevelCount];
+	BloomParam					m_Param;
+	uint32_t					m_LevelCount;
+
+	/// <summary>
+	/// 全画面を1回描画する
+	/// </summary>
+	void DrawQuad(
+		ID3D12GraphicsCommandList* pCmd,
+		ID3D12PipelineState* pPSO,
+		ColorTarget& target,
+		D3D12_GPU_DESCRIPTOR_HANDLE handleCBV,
+		D3D12_GPU_DESCRIPTOR_HANDLE handleSRV);
+
+	/// <summary>
+	/// レベルの状態を遷移させる (同じ状態の場合は何もしない)
+	/// </summary>
+	void TransitionLevel(ID3D12GraphicsCommandList* pCmd, uint32_t level, D3D12_RESOURCE_STATES state);
+
+	Bloom(const Bloom&) = delete;
+	void operator=(const Bloom&) = delete;
+};
+
+/// <summary>
+/// Bloom::Capture() で保存したブルームを, 同じシーンカラーからCPUで求めた結果と比較する
+/// </summary>
+/// <param name="scenePath">シーンカラー (DDS)</param>
+/// <param name="bloomPath">GPUで求めたブルーム (DDS)</param>
+/// <param name="param">パラメータ</param>
+/// <param name="minPSNR">許容する最小のPSNR [dB]</param>
+/// <param name="error">誤差の格納先</param>
+/// <returns>PSNRが minPSNR 以上の場合はtrue</returns>
+bool ValidateBloomCapture(
+	const wchar_t* scenePath,
+	const wchar_t* bloomPath,
+	const BloomParam& param,
+	double minPSNR,
+	ImageError& error);
@@ -0,0 +1,43 @@
+//-----------------------------------------------------------------------------
+// File : BloomBlurPS.hlsl
+// Desc : Pixel Shader For Bloom Gaussian Blur.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "BloomUtil.hlsli"
+
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const int TapCount = 8; // 中心を含む片側のタップ数です (BloomTapCount と同じ).
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+float4 main(const VSOutput input) : SV_TARGET0
+{
+    int2 size;
+    SrcMap.GetDimensions(size.x, size.y);
+
+    int2 pos = int2(input.Position.xy);
+    int2 last = size - 1;
+
+    // 端はクランプしてフェッチします.
+    float3 result = SrcMap.Load(int3(pos, 0)).rgb * Weights[0].x;
+
+    [unroll]
+    for (int i = 1; i < TapCount; ++i)
+    {
+        float weight = Weights[i >> 2][i & 3];
+        float3 c0 = SrcMap.Load(int3(clamp(pos - Direction * i, 0, last), 0)).rgb;
+        float3 c1 = SrcMap.Load(int3(clamp(pos + Direction * i, 0, last), 0)).rgb;
+        result += (c0 + c1) * weight;
+    }
+
+    return float4(result, 1.0f);
+}
@@ -0,0 +1,261 @@
+﻿#include "BloomCPU.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "ParallelFor.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 経過時間をミリ秒で取得する
+	/// </summary>
+	double GetElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	/// <summary>
+	/// 出力のテクセル中心で入力をバイリニアサンプリングして縮小する (クランプ)
+	/// threshold が負の場合は輝度抽出を行わない
+	/// </summary>
+	void Downsample(const CpuImage& src, CpuImage& dst, float threshold, float knee, uint32_t threadCount)
+	{
+		auto invWidth = 1.0f / float(dst.Width);
+		auto invHeight = 1.0f / float(dst.Height);
+
+		ParallelFor(0, dst.Height, [&](uint32_t y)
+		{
+			auto row = dst.GetRow(y);
+			auto v = (float(y) + 0.5f) * invHeight;
+
+			for (auto x = 0u; x < dst.Width; ++x)
+			{
+				auto u = (float(x) + 0.5f) * invWidth;
+				auto color = SampleBilinear(src, u, v, false);
+
+				if (threshold >= 0.0f)
+				{
+					color = ApplyBloomThreshold(color, threshold, knee);
+				}
+
+				XMStoreFloat4(&row[x], XMVectorSetW(color, 1.0f));
+			}
+		}, threadCount);
+	}
+
+	/// <summary>
+	/// 横方向のガウスブラー (端はクランプ)
+	/// </summary>
+	void BlurHorizontal(const CpuImage& src, CpuImage& dst, const std::vector<float>& weights, uint32_t threadCount)
+	{
+		auto last = int(src.Width) - 1;
+		auto taps = int(weights.size());
+
+		ParallelFor(0, src.Height, [&](uint32_t y)
+		{
+			auto srcRow = src.GetRow(y);
+			auto dstRow = dst.GetRow(y);
+
+			for (auto x = 0; x <= last; ++x)
+			{
+				auto sum = XMVectorScale(XMLoadFloat4(&srcRow[x]), weights[0]);
+
+				for (auto i = 1; i < taps; ++i)
+				{
+					auto c0 = XMLoadFloat4(&srcRow[std::max(x - i, 0)]);
+					auto c1 = XMLoadFloat4(&srcRow[std::min(x + i, last)]);
+					sum = XMVectorMultiplyAdd(XMVectorAdd(c0, c1), XMVectorReplicate(weights[i]), sum);
+				}
+
+				XMStoreFloat4(&dstRow[x], XMVectorSetW(sum, 1.0f));
+			}
+		}, threadCount);
+	}
+
+	/// <summary>
+	/// 縦方向のガウスブラー (端はクランプ)
+	/// </summary>
+	void BlurVertical(const CpuImage& src, CpuImage& dst, const std::vector<float>& weights, uint32_t threadCount)
+	{
+		auto last = int(src.Height) - 1;
+		auto taps = int(weights.size());
+
+		ParallelFor(0, src.Height, [&](uint32_t y)
+		{
+			auto dstRow = dst.GetRow(y);
+
+			// 行単位で積和するので, 列方向のアクセスでもキャッシュ効率が落ちない
+			for (auto x = 0u; x < src.Width; ++x)
+			{
+				XMStoreFloat4(&dstRow[x], XMVectorScale(XMLoadFloat4(&src.GetRow(y)[x]), weights[0]));
+			}
+
+			for (auto i = 1; i < taps; ++i)
+			{
+				auto row0 = src.GetRow(uint32_t(std::max(int(y) - i, 0)));
+				auto row1 = src.GetRow(uint32_t(std::min(int(y) + i, last)));
+				auto weight = XMVectorReplicate(weights[i]);
+
+				for (auto x = 0u; x < src.Width; ++x)
+				{
+					auto sum = XMLoadFloat4(&dstRow[x]);
+					sum = XMVectorMultiplyAdd(XMVectorAdd(XMLoadFloat4(&row0[x]), XMLoadFloat4(&row1[x])), weight, sum);
+					XMStoreFloat4(&dstRow[x], sum);
+				}
+			}
+
+			for (auto x = 0u; x < src.Width; ++x)
+			{
+				dstRow[x].w = 1.0f;
+			}
+		}, threadCount);
+	}
+
+	/// <summary>
+	/// 小さいレベルを出力のテクセル中心でバイリニアサンプリングして加算する
+	/// </summary>
+	void UpsampleAdd(const CpuImage& src, CpuImage& dst, uint32_t threadCount)
+	{
+		auto invWidth = 1.0f / float(dst.Width);
+		auto invHeight = 1.0f / float(dst.Height);
+
+		ParallelFor(0, dst.Height, [&](uint32_t y)
+		{
+			auto row = dst.GetRow(y);
+			auto v = (float(y) + 0.5f) * invHeight;
+
+			for (auto x = 0u; x < dst.Width; ++x)
+			{
+				auto u = (float(x) + 0.5f) * invWidth;
+				auto color = XMVectorSetW(SampleBilinear(src, u, v, false), 0.0f);
+
+				XMStoreFloat4(&row[x], XMVectorAdd(XMLoadFloat4(&row[x]), color));
+			}
+		}, threadCount);
+	}
+}
+
+uint32_t CalcBloomLevelCount(uint32_t width, uint32_t height, uint32_t levelCount)
+{
+	levelCount = std::min(std::max(levelCount, 1u), BloomMaxLevelCount);
+
+	// 最小レベルの短辺が1テクセル以上になるようにする
+	auto size = std::min(width, height);
+	auto count = 0u;
+	while (count < levelCount && (size >> (count + 1)) > 0)
+	{
+		count++;
+	}
+
+	return std::max(count, 1u);
+}
+
+std::vector<float> CalcBloomWeights(float sigma)
+{
+	sigma = std::max(sigma, 1e-3f);
+
+	std::vector<float> weights(BloomTapCount);
+	auto total = 0.0f;
+	for (auto i = 0u; i < BloomTapCount; ++i)
+	{
+		auto x = float(i);
+		weights[i] = expf(-x * x / (2.0f * sigma * sigma));
+		total += weights[i];
+	}
+
+	// 中心以外は左右の2回使われる
+	total = total * 2.0f - weights[0];
+	for (auto& weight : weights)
+	{
+		weight /= total;
+	}
+
+	return weights;
+}
+
+XMVECTOR ApplyBloomThreshold(FXMVECTOR color, float threshold, float knee)
+{
+	// しきい値付近は2次曲線でなめらかにつなぐ
+	auto brightness = std::max(XMVectorGetX(color), std::max(XMVectorGetY(color), XMVectorGetZ(color)));
+	auto soft = std::min(std::max(brightness - threshold + knee, 0.0f), 2.0f * knee);
+	soft = soft * soft / (4.0f * knee + 1e-5f);
+
+	auto contribution = std::max(soft, brightness - threshold) / std::max(brightness, 1e-5f);
+	return XMVectorScale(color, contribution);
+}
+
+void BuildBloomCPU
+(
+	const CpuImage& scene,
+	const BloomParam& param,
+	std::vector<CpuImage>& levels,
+	std::vector<BloomLevelTiming>* pTimings,
+	uint32_t threadCount
+)
+{
+	auto levelCount = CalcBloomLevelCount(scene.Width, scene.Height, param.LevelCount);
+	auto weights = CalcBloomWeights(param.Sigma);
+
+	levels.resize(levelCount);
+	for (auto i = 0u; i < levelCount; ++i)
+	{
+		levels[i].Resize(CalcBloomLevelSize(scene.Width, i), CalcBloomLevelSize(scene.Height, i));
+	}
+
+	std::vector<BloomLevelTiming> timings(levelCount);
+	for (auto i = 0u; i < levelCount; ++i)
+	{
+		timings[i].Width = levels[i].Width;
+		timings[i].Height = levels[i].Height;
+	}
+
+	// 輝度抽出と縮小 (縮小はブラー前の画像から行う)
+	for (auto i = 0u; i < levelCount; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		if (i == 0)
+		{
+			Downsample(scene, levels[0], std::max(param.Threshold, 0.0f), param.Knee, threadCount);
+		}
+		else
+		{
+			Downsample(levels[i - 1], levels[i], -1.0f, 0.0f, threadCount);
+		}
+
+		timings[i].DownsampleMs = GetElapsedMilliseconds(start);
+	}
+
+	// 各レベルのガウスブラー
+	CpuImage temp;
+	for (auto i = 0u; i < levelCount; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		temp.Resize(levels[i].Width, levels[i].Height);
+		BlurHorizontal(levels[i], temp, weights, threadCount);
+		BlurVertical(temp, levels[i], weights, threadCount);
+
+		timings[i].BlurMs = GetElapsedMilliseconds(start);
+	}
+
+	// 小さいレベルから順に拡大加算
+	for (auto i = levelCount - 1; i > 0; --i)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		UpsampleAdd(levels[i], levels[i - 1], threadCount);
+
+		timings[i - 1].UpsampleMs = GetElapsedMilliseconds(start);
+	}
+
+	if (pTimings != nullptr)
+	{
+		*pTimings = std::move(timings);
+	}
+}
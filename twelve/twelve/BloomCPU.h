@@ -0,0 +1,95 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "CubeMapImage.h"
+
+/// <summary>
+/// ブルームの最大レベル数
+/// </summary>
+const uint32_t BloomMaxLevelCount = 8;
+
+/// <summary>
+/// ブラーのタップ数 (中心を含む片側の数. シェーダーの float4 Weights[2] に収まる数)
+/// </summary>
+const uint32_t BloomTapCount = 8;
+
+/// <summary>
+/// ブルームのパラメータ
+/// LevelCount と Sigma は初期化時のみ, それ以外は毎フレーム反映される
+/// </summary>
+struct BloomParam
+{
+	uint32_t	LevelCount = 5;			// 縮小レベル数 (1/2 から 1/2^LevelCount まで)
+	float		Threshold = 0.8f;		// 輝度抽出のしきい値 (max(r, g, b) と比較する)
+	float		Knee = 0.2f;			// しきい値付近をなめらかにつなぐ幅
+	float		Sigma = 2.5f;			// ガウスブラーの標準偏差 [テクセル]
+	float		Intensity = 0.15f;		// 合成時の強さ
+};
+
+/// <summary>
+/// レベルごとの処理時間
+/// </summary>
+struct BloomLevelTiming
+{
+	uint32_t	Width = 0;				// 横幅
+	uint32_t	Height = 0;				// 縦幅
+	double		DownsampleMs = 0.0;		// 縮小 (レベル0は輝度抽出を含む) [ms]
+	double		BlurMs = 0.0;			// 横と縦のブラー [ms]
+	double		UpsampleMs = 0.0;		// 1つ下のレベルの拡大加算 [ms]
+};
+
+/// <summary>
+/// 入力サイズから実際に使用するレベル数を求める (最小レベルが1x1を下回らないように制限する)
+/// </summary>
+/// <param name="width">入力の横幅</param>
+/// <param name="height">入力の縦幅</param>
+/// <param name="levelCount">要求するレベル数</param>
+/// <returns>レベル数</returns>
+uint32_t CalcBloomLevelCount(uint32_t width, uint32_t height, uint32_t levelCount);
+
+/// <summary>
+/// レベルのサイズを求める (レベル0が入力の1/2)
+/// </summary>
+/// <param name="size">入力のサイズ</param>
+/// <param name="level">レベル</param>
+/// <returns>サイズ</returns>
+inline uint32_t CalcBloomLevelSize(uint32_t size, uint32_t level)
+{
+	auto result = size >> (level + 1);
+	return (result == 0) ? 1 : result;
+}
+
+/// <summary>
+/// ブラーのウェイトを求める (GetGaussianWeights() と同じ式で, 中心が先頭)
+/// </summary>
+/// <param name="sigma">標準偏差 [テクセル]</param>
+/// <returns>BloomTapCount 個のウェイト</returns>
+std::vector<float> CalcBloomWeights(float sigma);
+
+/// <summary>
+/// しきい値より明るい成分を抽出する (BloomDownsamplePS.hlsl と同じ計算)
+/// </summary>
+/// <param name="color">入力カラー</param>
+/// <param name="threshold">しきい値</param>
+/// <param name="knee">しきい値付近をなめらかにつなぐ幅</param>
+/// <returns>抽出したカラー</returns>
+DirectX::XMVECTOR ApplyBloomThreshold(DirectX::FXMVECTOR color, float threshold, float knee);
+
+/// <summary>
+/// GPU版 (Bloom) と同じ手順でブルームのピラミッドを求める
+/// 輝度抽出と縮小 ---> 各レベルのガウスブラー (横, 縦) ---> 小さいレベルから順に拡大加算
+/// </summary>
+/// <param name="scene">シーンカラー</param>
+/// <param name="param">パラメータ</param>
+/// <param name="levels">各レベルの格納先 (levels[0] が最終的なブルーム)</param>
+/// <param name="pTimings">レベルごとの処理時間の格納先 (nullptrの場合は計測しない)</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+void BuildBloomCPU(
+	const CpuImage& scene,
+	const BloomParam& param,
+	std::vector<CpuImage>& levels,
+	std::vector<BloomLevelTiming>* pTimings = nullptr,
+	uint32_t threadCount = 0);
@@ -0,0 +1,41 @@
+//-----------------------------------------------------------------------------
+// File : BloomDownsamplePS.hlsl
+// Desc : Pixel Shader For Bloom Downsample.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "BloomUtil.hlsli"
+
+
+//-----------------------------------------------------------------------------
+//      しきい値より明るい成分を抽出します (BloomCPU.cpp の ApplyBloomThreshold() と同じ計算).
+//-----------------------------------------------------------------------------
+float3 ApplyThreshold(float3 color)
+{
+    // しきい値付近は2次曲線でなめらかにつなぎます.
+    float brightness = max(color.r, max(color.g, color.b));
+    float soft = clamp(brightness - Threshold + Knee, 0.0f, 2.0f * Knee);
+    soft = soft * soft / (4.0f * Knee + 1e-5f);
+
+    float contribution = max(soft, brightness - Threshold) / max(brightness, 1e-5f);
+    return color * contribution;
+}
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+float4 main(const VSOutput input) : SV_TARGET0
+{
+    // 出力のテクセル中心でバイリニアサンプリングして縮小します.
+    float3 color = SrcMap.SampleLevel(SrcSmp, CalcSrcTexCoord(input.Position), 0.0f).rgb;
+
+    if (Threshold >= 0.0f)
+    {
+        color = ApplyThreshold(color);
+    }
+
+    return float4(color, 1.0f);
+}
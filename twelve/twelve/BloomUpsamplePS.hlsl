@@ -0,0 +1,23 @@
+//-----------------------------------------------------------------------------
+// File : BloomUpsamplePS.hlsl
+// Desc : Pixel Shader For Bloom Upsample.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "BloomUtil.hlsli"
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+float4 main(const VSOutput input) : SV_TARGET0
+{
+    // 1つ小さいレベルを出力のテクセル中心でバイリニアサンプリングし, 加算合成します.
+    float3 color = SrcMap.SampleLevel(SrcSmp, CalcTexCoord(input.Position), 0.0f).rgb;
+
+    // アルファは加算しません.
+    return float4(color, 0.0f);
+}
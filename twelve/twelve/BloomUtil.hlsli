@@ -0,0 +1,54 @@
+//-----------------------------------------------------------------------------
+// File : BloomUtil.hlsli
+// Desc : Bloom Utility.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+// VSOutput structure
+///////////////////////////////////////////////////////////////////////////////
+struct VSOutput
+{
+    float4 Position : SV_POSITION;
+    float2 TexCoord : TEXCOORD;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CbBloom constant buffer
+///////////////////////////////////////////////////////////////////////////////
+cbuffer CbBloom : register(b0)
+{
+    float4 Weights[2]; // ガウスウェイトです(先頭が中心).
+    float2 DstInvSize; // 出力のテクセルサイズです.
+    int2 Direction; // ブラーの方向です.
+    float Threshold; // 輝度抽出のしきい値です(負の場合は抽出しません).
+    float Knee; // しきい値付近をなめらかにつなぐ幅です.
+    float2 SrcUVScale; // 入力の描画範囲のテクスチャ座標のスケールです(動的解像度).
+};
+
+//-----------------------------------------------------------------------------
+// Textures and Samplers.
+//-----------------------------------------------------------------------------
+Texture2D SrcMap : register(t0);
+SamplerState SrcSmp : register(s0);
+
+
+//-----------------------------------------------------------------------------
+//      出力のテクセル中心のテクスチャ座標を求めます.
+//-----------------------------------------------------------------------------
+float2 CalcTexCoord(float4 position)
+{
+    // SV_POSITION はピクセル中心 (x + 0.5, y + 0.5) なので, そのままテクセル中心になります.
+    return position.xy * DstInvSize;
+}
+
+//-----------------------------------------------------------------------------
+//      出力のテクセル中心に対応する入力のテクスチャ座標を求めます.
+//-----------------------------------------------------------------------------
+float2 CalcSrcTexCoord(float4 position)
+{
+    // 入力の描画範囲が小さい場合は範囲内に縮め, 範囲外を参照しないように半テクセル内側でクランプします.
+    float2 size;
+    SrcMap.GetDimensions(size.x, size.y);
+    return min(CalcTexCoord(position) * SrcUVScale, SrcUVScale - 0.5f / size);
+}
@@ -0,0 +1,289 @@
+﻿#include "CascadedShadow.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// ワールド空間のバウンディングボックスをライト空間のバウンディングボックスに変換する
+	/// </summary>
+	void TransformBounds(const XMFLOAT4X4& lightView, const ShadowCasterBounds& bounds, XMFLOAT3& minimum, XMFLOAT3& maximum)
+	{
+		auto center = XMFLOAT3(
+			(bounds.Min.x + bounds.Max.x) * 0.5f,
+			(bounds.Min.y + bounds.Max.y) * 0.5f,
+			(bounds.Min.z + bounds.Max.z) * 0.5f);
+		auto extent = XMFLOAT3(
+			(bounds.Max.x - bounds.Min.x) * 0.5f,
+			(bounds.Max.y - bounds.Min.y) * 0.5f,
+			(bounds.Max.z - bounds.Min.z) * 0.5f);
+
+		// 行ベクトル形式なので, 各軸の広がりは列の絶対値との内積になる
+		const auto& m = lightView;
+		auto cx = center.x * m._11 + center.y * m._21 + center.z * m._31 + m._41;
+		auto cy = center.x * m._12 + center.y * m._22 + center.z * m._32 + m._42;
+		auto cz = center.x * m._13 + center.y * m._23 + center.z * m._33 + m._43;
+		auto ex = extent.x * fabsf(m._11) + extent.y * fabsf(m._21) + extent.z * fabsf(m._31);
+		auto ey = extent.x * fabsf(m._12) + extent.y * fabsf(m._22) + extent.z * fabsf(m._32);
+		auto ez = extent.x * fabsf(m._13) + extent.y * fabsf(m._23) + extent.z * fabsf(m._33);
+
+		minimum = XMFLOAT3(cx - ex, cy - ey, cz - ez);
+		maximum = XMFLOAT3(cx + ex, cy + ey, cz + ez);
+	}
+}
+
+void ComputeCascadeSplits(float nearZ, float farZ, uint32_t count, float lambda, float* pSplits)
+{
+	if (pSplits == nullptr || count == 0)
+	{
+		return;
+	}
+
+	auto ratio = farZ / nearZ;
+
+	for (auto i = 0u; i <= count; ++i)
+	{
+		auto p = float(i) / float(count);
+		auto logSplit = nearZ * powf(ratio, p);
+		auto linearSplit = nearZ + (farZ - nearZ) * p;
+
+		pSplits[i] = lambda * logSplit + (1.0f - lambda) * linearSplit;
+	}
+
+	// 端は誤差なく一致させる
+	pSplits[0] = nearZ;
+	pSplits[count] = farZ;
+}
+
+XMFLOAT4X4 CreateShadowLightView(const XMFLOAT3& lightDirection)
+{
+	auto dir = XMVector3Normalize(XMLoadFloat3(&lightDirection));
+
+	// 照射方向が上方向とほぼ平行な場合は別の軸を上方向にする
+	auto up = (fabsf(XMVectorGetY(dir)) > 0.99f)
+		? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f)
+		: XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	XMFLOAT4X4 result;
+	XMStoreFloat4x4(&result, XMMatrixLookToRH(XMVectorZero(), dir, up));
+	return result;
+}
+
+void ComputeFrustumCorners(const XMFLOAT4X4& view, const XMFLOAT4X4& proj, float nearZ, float farZ, XMFLOAT3 corners[8])
+{
+	auto invView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&view));
+	auto depthSign = (proj._34 < 0.0f) ? -1.0f : 1.0f;
+	const float depths[2] = { nearZ, farZ };
+
+	for (auto i = 0; i < 8; ++i)
+	{
+		// 正規化デバイス座標の4隅をビュー空間に戻す (BuildClusterBounds() と同じ計算)
+		auto ndcX = (i & 1) ? 1.0f : -1.0f;
+		auto ndcY = (i & 2) ? 1.0f : -1.0f;
+		auto z = depthSign * depths[i >> 2];
+		auto w = z * proj._34 + proj._44;
+		auto px = (ndcX * w - z * proj._31 - proj._41) / proj._11;
+		auto py = (ndcY * w - z * proj._32 - proj._42) / proj._22;
+
+		XMStoreFloat3(&corners[i], XMVector3TransformCoord(XMVectorSet(px, py, z, 1.0f), invView));
+	}
+}
+
+void FitShadowCascade
+(
+	const XMFLOAT4X4&	lightView,
+	const XMFLOAT3		corners[8],
+	const ShadowCasterBounds* pCasters,
+	uint32_t			casterCount,
+	uint32_t			resolution,
+	float				depthMargin,
+	ShadowCascade&		cascade
+)
+{
+	auto view = XMLoadFloat4x4(&lightView);
+
+	// 分割範囲を囲む球 (カメラが回転しても半径は変わらない)
+	auto center = XMVectorZero();
+	for (auto i = 0; i < 8; ++i)
+	{
+		center = XMVectorAdd(center, XMLoadFloat3(&corners[i]));
+	}
+	center = XMVectorScale(center, 1.0f / 8.0f);
+
+	auto radius = 0.0f;
+	for (auto i = 0; i < 8; ++i)
+	{
+		auto d = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&corners[i]), center)));
+		radius = std::max(radius, d);
+	}
+
+	// 誤差で大きさが揺れないように切り上げる
+	radius = ceilf(radius * 1024.0f) / 1024.0f;
+
+	auto texelSize = (2.0f * radius) / float(std::max(resolution, 1u));
+
+	// 横方向はテクセル単位にスナップし, 幅は常に直径にする
+	XMFLOAT3 lightCenter;
+	XMStoreFloat3(&lightCenter, XMVector3TransformCoord(center, view));
+
+	auto minX = floorf((lightCenter.x - radius) / texelSize) * texelSize;
+	auto minY = floorf((lightCenter.y - radius) / texelSize) * texelSize;
+	auto maxX = minX + 2.0f * radius;
+	auto maxY = minY + 2.0f * radius;
+
+	// 受ける側の奥行き
+	auto receiverMinZ = FLT_MAX;
+	auto receiverMaxZ = -FLT_MAX;
+	for (auto i = 0; i < 8; ++i)
+	{
+		auto z = XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(&corners[i]), view));
+		receiverMinZ = std::min(receiverMinZ, z);
+		receiverMaxZ = std::max(receiverMaxZ, z);
+	}
+
+	// 横方向の範囲に入る影を落とすオブジェクトの奥行き
+	auto casterMinZ = FLT_MAX;
+	auto casterMaxZ = -FLT_MAX;
+	for (auto i = 0u; i < casterCount; ++i)
+	{
+		XMFLOAT3 bmin, bmax;
+		TransformBounds(lightView, pCasters[i], bmin, bmax);
+
+		if (bmax.x < minX || bmin.x > maxX || bmax.y < minY || bmin.y > maxY)
+		{
+			continue;
+		}
+
+		casterMinZ = std::min(casterMinZ, bmin.z);
+		casterMaxZ = std::max(casterMaxZ, bmax.z);
+	}
+
+	// ライト空間は -z が照射方向なので, 光源側 (手前) は z の大きい方
+	// 手前は影を落とすオブジェクトまで広げ, 奥はオブジェクトがない部分を削る (受ける側より奥には広げない)
+	auto maxZ = std::max(receiverMaxZ, casterMaxZ) + depthMargin;
+	auto minZ = (casterMinZ <= casterMaxZ) ? std::max(receiverMinZ, casterMinZ) : receiverMinZ;
+	minZ = std::min(minZ, maxZ - depthMargin) - depthMargin;
+
+	auto proj = XMMatrixOrthographicOffCenterRH(minX, maxX, minY, maxY, -maxZ, -minZ);
+
+	cascade.View = lightView;
+	XMStoreFloat4x4(&cascade.Proj, proj);
+	XMStoreFloat4x4(&cascade.ViewProj, XMMatrixMultiply(view, proj));
+	cascade.TexelSize = texelSize;
+	cascade.Radius = radius;
+	cascade.BoundsMin = XMFLOAT3(minX, minY, minZ);
+	cascade.BoundsMax = XMFLOAT3(maxX, maxY, maxZ);
+}
+
+void FitShadowCascades
+(
+	const XMFLOAT4X4&			view,
+	const XMFLOAT4X4&			proj,
+	const XMFLOAT3&				lightDirection,
+	const ShadowCascadeDesc&	desc,
+	const ShadowCasterBounds*	pCasters,
+	uint32_t					casterCount,
+	ShadowCascade*				pCascades
+)
+{
+	auto count = std::min(desc.CascadeCount, MaxShadowCascadeCount);
+	if (pCascades == nullptr || count == 0)
+	{
+		return;
+	}
+
+	float splits[MaxShadowCascadeCount + 1];
+	ComputeCascadeSplits(desc.NearZ, desc.FarZ, count, desc.SplitLambda, splits);
+
+	auto lightView = CreateShadowLightView(lightDirection);
+
+	for (auto i = 0u; i < count; ++i)
+	{
+		XMFLOAT3 corners[8];
+		ComputeFrustumCorners(view, proj, splits[i], splits[i + 1], corners);
+
+		FitShadowCascade(lightView, corners, pCasters, casterCount, desc.Resolution, desc.DepthMargin, pCascades[i]);
+		pCascades[i].SplitNear = splits[i];
+		pCascades[i].SplitFar = splits[i + 1];
+	}
+}
+
+void CullShadowCasters(const ShadowCascade& cascade, const ShadowCasterBounds* pCasters, uint32_t casterCount, std::vector<uint32_t>& visible)
+{
+	visible.clear();
+
+	for (auto i = 0u; i < casterCount; ++i)
+	{
+		XMFLOAT3 bmin, bmax;
+		TransformBounds(cascade.View, pCasters[i], bmin, bmax);
+
+		if (bmax.x < cascade.BoundsMin.x || bmin.x > cascade.BoundsMax.x
+		 || bmax.y < cascade.BoundsMin.y || bmin.y > cascade.BoundsMax.y
+		 || bmax.z < cascade.BoundsMin.z || bmin.z > cascade.BoundsMax.z)
+		{
+			continue;
+		}
+
+		visible.push_back(i);
+	}
+}
+
+void GetShadowCascadeTile(uint32_t index, uint32_t resolution, uint32_t& x, uint32_t& y)
+{
+	x = (index & 1) * resolution;
+	y = ((index >> 1) & 1) * resolution;
+}
+
+ShadowShaderParams GetShadowShaderParams
+(
+	const ShadowCascade*		pCascades,
+	const ShadowCascadeDesc&	desc,
+	const XMFLOAT3&				lightDirection,
+	const XMFLOAT3&				lightColor,
+	float						lightIntensity
+)
+{
+	ShadowShaderParams result = {};
+
+	auto count = (pCascades != nullptr) ? std::min(desc.CascadeCount, MaxShadowCascadeCount) : 0u;
+	auto atlasSize = float(desc.Resolution * 2);
+
+	XMStoreFloat3(&result.LightDirection, XMVector3Normalize(XMLoadFloat3(&lightDirection)));
+	result.LightColor = lightColor;
+	result.LightIntensity = lightIntensity;
+	result.CascadeCount = count;
+	result.AtlasTexelSize = 1.0f / atlasSize;
+
+	for (auto i = 0u; i < MaxShadowCascadeCount; ++i)
+	{
+		if (i >= count)
+		{
+			XMStoreFloat4x4(&result.ViewProj[i], XMMatrixIdentity());
+			continue;
+		}
+
+		// 正規化デバイス座標をアトラス内のタイルのテクスチャ座標に変換する (深度はそのまま)
+		uint32_t x, y;
+		GetShadowCascadeTile(i, desc.Resolution, x, y);
+
+		auto scale = 0.5f * float(desc.Resolution) / atlasSize;
+		auto tile = XMMatrixScaling(scale, -scale, 1.0f);
+		tile.r[3] = XMVectorSet(
+			(float(x) + 0.5f * float(desc.Resolution)) / atlasSize,
+			(float(y) + 0.5f * float(desc.Resolution)) / atlasSize,
+			0.0f,
+			1.0f);
+
+		XMStoreFloat4x4(&result.ViewProj[i], XMMatrixMultiply(XMLoadFloat4x4(&pCascades[i].ViewProj), tile));
+
+		// 法線方向のオフセットはテクセルの対角線の長さにする
+		(&result.SplitFar.x)[i] = pCascades[i].SplitFar;
+		(&result.NormalOffset.x)[i] = pCascades[i].TexelSize * 1.5f;
+	}
+
+	return result;
+}
@@ -0,0 +1,172 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// カスケードの最大数 (シェーダーの定数バッファの配列数と一致させる)
+constexpr uint32_t MaxShadowCascadeCount = 4;
+
+/// <summary>
+/// カスケードシャドウマップの構成設定
+/// </summary>
+struct ShadowCascadeDesc
+{
+	uint32_t	CascadeCount = 4;		// カスケード数 (MaxShadowCascadeCount 以下)
+	uint32_t	Resolution = 2048;		// 1つのカスケードの解像度 [texel]
+	float		NearZ = 0.1f;			// 影を落とす範囲の開始距離 (ビュー空間)
+	float		FarZ = 10.0f;			// 影を落とす範囲の終了距離 (ビュー空間)
+	float		SplitLambda = 0.75f;	// 対数分割と線形分割の混合率 (1.0f で対数分割のみ)
+	float		DepthMargin = 0.01f;	// 光源方向の範囲に加える余白
+};
+
+/// <summary>
+/// 影を落とすオブジェクトのワールド空間のバウンディングボックス
+/// </summary>
+struct ShadowCasterBounds
+{
+	DirectX::XMFLOAT3	Min;	// 最小値
+	DirectX::XMFLOAT3	Max;	// 最大値
+};
+
+/// <summary>
+/// 1つのカスケードの変換と範囲
+/// ライトのビュー行列は回転のみで, 範囲はライト空間 (右手系, 光源方向が -z) で持つ
+/// </summary>
+struct ShadowCascade
+{
+	DirectX::XMFLOAT4X4	View;			// ライトのビュー行列
+	DirectX::XMFLOAT4X4	Proj;			// 正射影行列
+	DirectX::XMFLOAT4X4	ViewProj;		// ビュー射影行列
+	float				SplitNear;		// 分割範囲の開始距離 (ビュー空間)
+	float				SplitFar;		// 分割範囲の終了距離 (ビュー空間)
+	float				TexelSize;		// 1テクセルのワールド空間の大きさ
+	float				Radius;			// 分割範囲を囲む球の半径
+	DirectX::XMFLOAT3	BoundsMin;		// 射影する範囲の最小値 (ライト空間)
+	DirectX::XMFLOAT3	BoundsMax;		// 射影する範囲の最大値 (ライト空間)
+};
+
+/// <summary>
+/// シェーダー用のパラメータ (IBLPS.hlsl の CbCamera と並びを一致させる)
+/// </summary>
+struct ShadowShaderParams
+{
+	DirectX::XMFLOAT4X4	ViewProj[MaxShadowCascadeCount];	// ワールド空間からアトラスのテクスチャ座標と深度への変換
+	DirectX::XMFLOAT4	SplitFar;							// 各カスケードの終了距離 (ビュー空間)
+	DirectX::XMFLOAT4	NormalOffset;						// 各カスケードの法線方向のオフセット (ワールド空間)
+	DirectX::XMFLOAT3	LightDirection;						// ライトの照射方向
+	float				LightIntensity;						// ライトの強度
+	DirectX::XMFLOAT3	LightColor;							// ライトの色
+	uint32_t			CascadeCount;						// カスケード数 (0の場合は評価しない)
+	float				AtlasTexelSize;						// アトラスの1テクセルのテクスチャ座標の大きさ
+	float				Padding[3];							// パディング
+};
+
+static_assert(sizeof(ShadowShaderParams) == 336, "ShadowShaderParams layout mismatch.");
+
+/// <summary>
+/// 分割距離を求める (対数分割と線形分割を混合する実用分割法)
+/// </summary>
+/// <param name="nearZ">開始距離</param>
+/// <param name="farZ">終了距離</param>
+/// <param name="count">分割数</param>
+/// <param name="lambda">対数分割の割合</param>
+/// <param name="pSplits">分割距離の格納先 (count + 1 個, 先頭は nearZ, 末尾は farZ)</param>
+void ComputeCascadeSplits(float nearZ, float farZ, uint32_t count, float lambda, float* pSplits);
+
+/// <summary>
+/// ライトのビュー行列を求める (原点を通る回転のみの行列なので, テクセルへのスナップがカメラの移動で揺れない)
+/// </summary>
+/// <param name="lightDirection">ライトの照射方向</param>
+DirectX::XMFLOAT4X4 CreateShadowLightView(const DirectX::XMFLOAT3& lightDirection);
+
+/// <summary>
+/// カメラの視錐台の一部の8頂点をワールド空間で求める
+/// </summary>
+/// <param name="view">カメラのビュー行列</param>
+/// <param name="proj">カメラの射影行列</param>
+/// <param name="nearZ">開始距離 (ビュー空間)</param>
+/// <param name="farZ">終了距離 (ビュー空間)</param>
+/// <param name="corners">頂点の格納先</param>
+void ComputeFrustumCorners(
+	const DirectX::XMFLOAT4X4& view,
+	const DirectX::XMFLOAT4X4& proj,
+	float nearZ,
+	float farZ,
+	DirectX::XMFLOAT3 corners[8]);
+
+/// <summary>
+/// 1つのカスケードを分割範囲に合わせる
+/// 横方向は分割範囲を囲む球で大きさを固定してテクセル単位にスナップし, 奥行きは影を落とすオブジェクトまで広げて受ける側の範囲までに絞る
+/// </summary>
+/// <param name="lightView">ライトのビュー行列</param>
+/// <param name="corners">分割範囲の8頂点 (ワールド空間)</param>
+/// <param name="pCasters">影を落とすオブジェクト</param>
+/// <param name="casterCount">影を落とすオブジェクトの数</param>
+/// <param name="resolution">カスケードの解像度</param>
+/// <param name="depthMargin">光源方向の範囲に加える余白</param>
+/// <param name="cascade">結果の格納先 (分割距離は呼び出し側で設定する)</param>
+void FitShadowCascade(
+	const DirectX::XMFLOAT4X4& lightView,
+	const DirectX::XMFLOAT3 corners[8],
+	const ShadowCasterBounds* pCasters,
+	uint32_t casterCount,
+	uint32_t resolution,
+	float depthMargin,
+	ShadowCascade& cascade);
+
+/// <summary>
+/// 全てのカスケードをカメラに合わせる
+/// </summary>
+/// <param name="view">カメラのビュー行列</param>
+/// <param name="proj">カメラの射影行列</param>
+/// <param name="lightDirection">ライトの照射方向</param>
+/// <param name="desc">構成設定</param>
+/// <param name="pCasters">影を落とすオブジェクト</param>
+/// <param name="casterCount">影を落とすオブジェクトの数</param>
+/// <param name="pCascades">結果の格納先 (desc.CascadeCount 個)</param>
+void FitShadowCascades(
+	const DirectX::XMFLOAT4X4& view,
+	const DirectX::XMFLOAT4X4& proj,
+	const DirectX::XMFLOAT3& lightDirection,
+	const ShadowCascadeDesc& desc,
+	const ShadowCasterBounds* pCasters,
+	uint32_t casterCount,
+	ShadowCascade* pCascades);
+
+/// <summary>
+/// カスケードの範囲に入る影を落とすオブジェクトを求める
+/// </summary>
+/// <param name="cascade">カスケード</param>
+/// <param name="pCasters">影を落とすオブジェクト</param>
+/// <param name="casterCount">影を落とすオブジェクトの数</param>
+/// <param name="visible">範囲に入るオブジェクトの番号の格納先</param>
+void CullShadowCasters(
+	const ShadowCascade& cascade,
+	const ShadowCasterBounds* pCasters,
+	uint32_t casterCount,
+	std::vector<uint32_t>& visible);
+
+/// <summary>
+/// アトラス内のカスケードの配置 (2x2 のタイルに並べる) のテクセル位置を求める
+/// </summary>
+/// <param name="index">カスケード番号</param>
+/// <param name="resolution">カスケードの解像度</param>
+/// <param name="x">左端の格納先</param>
+/// <param name="y">上端の格納先</param>
+void GetShadowCascadeTile(uint32_t index, uint32_t resolution, uint32_t& x, uint32_t& y);
+
+/// <summary>
+/// シェーダー用のパラメータを求める
+/// </summary>
+/// <param name="pCascades">カスケード</param>
+/// <param name="desc">構成設定</param>
+/// <param name="lightDirection">ライトの照射方向</param>
+/// <param name="lightColor">ライトの色</param>
+/// <param name="lightIntensity">ライトの強度</param>
+ShadowShaderParams GetShadowShaderParams(
+	const ShadowCascade* pCascades,
+	const ShadowCascadeDesc& desc,
+	const DirectX::XMFLOAT3& lightDirection,
+	const DirectX::XMFLOAT3& lightColor,
+	float lightIntensity);
@@ -0,0 +1,113 @@
+//-----------------------------------------------------------------------------
+// File : CascadedShadow.hlsli
+// Desc : Cascaded Shadow Map.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#ifndef CASCADED_SHADOW_HLSLI
+#define CASCADED_SHADOW_HLSLI
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "BRDF.hlsli"
+
+//-----------------------------------------------------------------------------
+// Textures and Samplers
+//-----------------------------------------------------------------------------
+// カスケードシャドウマップのアトラス (2x2 のタイルにカスケードを並べています).
+Texture2D ShadowMap : register(t10);
+SamplerComparisonState ShadowSmp : register(s6);
+
+// ※ ShadowViewProj などのパラメータは, インクルード元の CbCamera で宣言します.
+
+//-----------------------------------------------------------------------------
+//      ビュー空間の深度からカスケード番号を求めます (範囲外の場合は ShadowCascadeCount).
+//-----------------------------------------------------------------------------
+uint SelectShadowCascade(float viewDepth)
+{
+    for (uint i = 0; i < ShadowCascadeCount; ++i)
+    {
+        if (viewDepth < ShadowSplitFar[i])
+        {
+            return i;
+        }
+    }
+
+    return ShadowCascadeCount;
+}
+
+//-----------------------------------------------------------------------------
+//      カスケードシャドウマップから可視率を求めます (3x3 の比較サンプル).
+//-----------------------------------------------------------------------------
+float SampleCascadedShadow(float3 worldPos, float3 N, float viewDepth)
+{
+    uint cascade = SelectShadowCascade(viewDepth);
+    if (cascade >= ShadowCascadeCount)
+    {
+        return 1.0f;
+    }
+
+    // 自己遮蔽を抑えるため, 法線方向にテクセルの大きさだけずらしてから変換します.
+    float3 pos = worldPos + N * ShadowNormalOffset[cascade];
+    float4 shadowPos = mul(ShadowViewProj[cascade], float4(pos, 1.0f));
+
+    // 隣のタイルをサンプルしないように, カスケードのタイル内に制限します (CPU の GetShadowCascadeTile() と同じ配置).
+    float2 tileMin = float2(cascade & 1, (cascade >> 1) & 1) * 0.5f;
+    float2 tileMax = tileMin + 0.5f;
+    float2 margin = ShadowAtlasTexelSize * 1.5f;
+    float2 uv = clamp(shadowPos.xy, tileMin + margin, tileMax - margin);
+
+    float visibility = 0.0f;
+
+    [unroll]
+    for (int y = -1; y <= 1; ++y)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; ++x)
+        {
+            float2 offset = float2(x, y) * ShadowAtlasTexelSize;
+            visibility += ShadowMap.SampleCmpLevelZero(ShadowSmp, uv + offset, shadowPos.z);
+        }
+    }
+
+    return visibility / 9.0f;
+}
+
+//-----------------------------------------------------------------------------
+//      影を考慮して太陽光を評価します.
+//-----------------------------------------------------------------------------
+float3 EvaluateSunLight
+(
+    float4 svPosition, // SV_Position.
+    float3 worldPos, // ワールド空間の位置.
+    float3 N, // 法線ベクトル.
+    float3 V, // 視線ベクトル (カメラに向かう方向).
+    float3 Kd, // 拡散反射率.
+    float3 Ks, // 鏡面反射率.
+    float roughness // 線形ラフネス.
+)
+{
+    if (ShadowCascadeCount == 0)
+    {
+        return 0.0f;
+    }
+
+    float3 L = -SunDirection;
+    float NL = saturate(dot(N, L));
+    if (NL <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    float3 H = normalize(V + L);
+    float NV = saturate(dot(N, V));
+    float NH = saturate(dot(N, H));
+
+    // SV_Position.w はビュー空間の深度です.
+    float shadow = SampleCascadedShadow(worldPos, N, svPosition.w);
+
+    float3 brdf = ComputeLambert(Kd) + ComputeGGX(Ks, roughness, NH, NV, NL);
+    return brdf * NL * SunColor * SunIntensity * shadow;
+}
+
+#endif//CASCADED_SHADOW_HLSLI
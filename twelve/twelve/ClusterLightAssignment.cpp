@@ -0,0 +1,430 @@
+﻿#include "ClusterLightAssignment.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "ParallelFor.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// SIMDで同時に判定するクラスターの数
+	constexpr uint32_t ClusterLaneCount = 4;
+
+	/// <summary>
+	/// ライトの位置と照射方向をビュー空間に変換する
+	/// </summary>
+	void TransformClusterLights(const XMFLOAT4X4& view, const ClusterLight* pLights, uint32_t count, ClusterLightGrid& grid)
+	{
+		auto matrix = XMLoadFloat4x4(&view);
+
+		grid.ViewSpheres.resize(count);
+		grid.ViewAxes.resize(count);
+
+		for (auto i = 0u; i < count; ++i)
+		{
+			const auto& light = pLights[i];
+
+			auto position = XMVector3TransformCoord(XMLoadFloat3(&light.Position), matrix);
+			auto forward = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&light.Forward), matrix));
+
+			XMStoreFloat4(&grid.ViewSpheres[i], XMVectorSetW(position, light.Radius));
+			XMStoreFloat4(&grid.ViewAxes[i], XMVectorSetW(forward, light.CosOuterAngle));
+		}
+	}
+
+	/// <summary>
+	/// クラスターとライトが重なるかどうかを判定する (AssignClusterLights() のSIMDの判定と同じ順で計算する)
+	/// </summary>
+	bool TestClusterLight(const ClusterBounds& bounds, uint32_t element, const XMFLOAT4& sphere, const XMFLOAT4& axis, bool spot)
+	{
+		// 球とバウンディングボックスの距離
+		auto dx = std::max(0.0f, bounds.MinX[element] - sphere.x) + std::max(0.0f, sphere.x - bounds.MaxX[element]);
+		auto dy = std::max(0.0f, bounds.MinY[element] - sphere.y) + std::max(0.0f, sphere.y - bounds.MaxY[element]);
+		auto dz = std::max(0.0f, bounds.MinZ[element] - sphere.z) + std::max(0.0f, sphere.z - bounds.MaxZ[element]);
+		auto distSq = dx * dx + dy * dy + dz * dz;
+		if (!(distSq <= sphere.w * sphere.w))
+		{
+			return false;
+		}
+
+		if (!spot)
+		{
+			return true;
+		}
+
+		// 円錐とクラスターの外接球
+		auto sinAngle = sqrtf(std::max(0.0f, 1.0f - axis.w * axis.w));
+		auto radius = bounds.Radius[element];
+		auto vx = bounds.CenterX[element] - sphere.x;
+		auto vy = bounds.CenterY[element] - sphere.y;
+		auto vz = bounds.CenterZ[element] - sphere.z;
+		auto lenSq = vx * vx + vy * vy + vz * vz;
+		auto v1Len = vx * axis.x + vy * axis.y + vz * axis.z;
+		auto distClosest = axis.w * sqrtf(std::max(lenSq - v1Len * v1Len, 0.0f)) - v1Len * sinAngle;
+
+		return (distClosest <= radius) && (v1Len <= sphere.w + radius) && (v1Len >= -radius);
+	}
+}
+
+ClusterLight MakeClusterPointLight(
+	const XMFLOAT3& position,
+	float radius,
+	const XMFLOAT3& color,
+	float intensity)
+{
+	ClusterLight result = {};
+	result.Position = position;
+	result.InvSqrRadius = 1.0f / (radius * radius);
+	result.Color = color;
+	result.Intensity = intensity;
+	result.Forward = XMFLOAT3(0.0f, 0.0f, 1.0f);
+	result.Type = CLUSTER_LIGHT_POINT;
+	result.Radius = radius;
+	result.CosOuterAngle = -1.0f;
+
+	return result;
+}
+
+ClusterLight MakeClusterSpotLight(
+	const XMFLOAT3& position,
+	const XMFLOAT3& forward,
+	float radius,
+	const XMFLOAT3& color,
+	float intensity,
+	float innerAngle,
+	float outerAngle)
+{
+	auto cosInnerAngle = cosf(innerAngle);
+	auto cosOuterAngle = cosf(outerAngle);
+
+	ClusterLight result = {};
+	result.Position = position;
+	result.InvSqrRadius = 1.0f / (radius * radius);
+	result.Color = color;
+	result.Intensity = intensity;
+	result.Forward = forward;
+	result.AngleScale = 1.0f / XMMax(0.001f, (cosInnerAngle - cosOuterAngle));
+	result.AngleOffset = -cosOuterAngle * result.AngleScale;
+	result.Type = CLUSTER_LIGHT_SPOT;
+	result.Radius = radius;
+	result.CosOuterAngle = cosOuterAngle;
+
+	return result;
+}
+
+void BuildClusterBounds(const XMFLOAT4X4& proj, const ClusterGridDesc& desc, ClusterBounds& bounds)
+{
+	auto tileCount = desc.GetTileCount();
+
+	bounds.TileStride = (tileCount + ClusterLaneCount - 1) / ClusterLaneCount * ClusterLaneCount;
+	bounds.DepthSign = (proj._34 < 0.0f) ? -1.0f : 1.0f;
+
+	auto size = size_t(bounds.TileStride) * desc.SliceCount;
+
+	// 余りの要素は最小値が最大値より大きい範囲にして, どのライトとも重ならないようにする
+	bounds.MinX.assign(size, FLT_MAX);
+	bounds.MinY.assign(size, FLT_MAX);
+	bounds.MinZ.assign(size, FLT_MAX);
+	bounds.MaxX.assign(size, -FLT_MAX);
+	bounds.MaxY.assign(size, -FLT_MAX);
+	bounds.MaxZ.assign(size, -FLT_MAX);
+	bounds.CenterX.assign(size, 0.0f);
+	bounds.CenterY.assign(size, 0.0f);
+	bounds.CenterZ.assign(size, 0.0f);
+	bounds.Radius.assign(size, 0.0f);
+
+	auto ratio = desc.FarZ / desc.NearZ;
+
+	for (auto slice = 0u; slice < desc.SliceCount; ++slice)
+	{
+		// 奥行きは指数的に分割する (シェーダーでは対数でスライス番号を求める)
+		float depths[2] = {
+			desc.NearZ * powf(ratio, float(slice) / float(desc.SliceCount)),
+			desc.NearZ * powf(ratio, float(slice + 1) / float(desc.SliceCount)),
+		};
+
+		for (auto y = 0u; y < desc.TileCountY; ++y)
+		{
+			for (auto x = 0u; x < desc.TileCountX; ++x)
+			{
+				// タイルの正規化デバイス座標 (yは画面の上から下に向かう)
+				float ndcX[2] = {
+					-1.0f + 2.0f * float(x) / float(desc.TileCountX),
+					-1.0f + 2.0f * float(x + 1) / float(desc.TileCountX),
+				};
+				float ndcY[2] = {
+					1.0f - 2.0f * float(y + 1) / float(desc.TileCountY),
+					1.0f - 2.0f * float(y) / float(desc.TileCountY),
+				};
+
+				auto minimum = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+				auto maximum = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+				// スライスの前後の面の4隅をビュー空間に戻す
+				for (auto i = 0; i < 8; ++i)
+				{
+					auto z = bounds.DepthSign * depths[i >> 2];
+					auto w = z * proj._34 + proj._44;
+					auto px = (ndcX[i & 1] * w - z * proj._31 - proj._41) / proj._11;
+					auto py = (ndcY[(i >> 1) & 1] * w - z * proj._32 - proj._42) / proj._22;
+
+					minimum = XMFLOAT3(std::min(minimum.x, px), std::min(minimum.y, py), std::min(minimum.z, z));
+					maximum = XMFLOAT3(std::max(maximum.x, px), std::max(maximum.y, py), std::max(maximum.z, z));
+				}
+
+				auto element = slice * bounds.TileStride + y * desc.TileCountX + x;
+				bounds.MinX[element] = minimum.x;
+				bounds.MinY[element] = minimum.y;
+				bounds.MinZ[element] = minimum.z;
+				bounds.MaxX[element] = maximum.x;
+				bounds.MaxY[element] = maximum.y;
+				bounds.MaxZ[element] = maximum.z;
+
+				auto extentX = 0.5f * (maximum.x - minimum.x);
+				auto extentY = 0.5f * (maximum.y - minimum.y);
+				auto extentZ = 0.5f * (maximum.z - minimum.z);
+				bounds.CenterX[element] = minimum.x + extentX;
+				bounds.CenterY[element] = minimum.y + extentY;
+				bounds.CenterZ[element] = minimum.z + extentZ;
+				bounds.Radius[element] = sqrtf(extentX * extentX + extentY * extentY + extentZ * extentZ);
+			}
+		}
+	}
+}
+
+void AssignClusterLights(
+	const ClusterBounds& bounds,
+	const ClusterGridDesc& desc,
+	const XMFLOAT4X4& view,
+	const ClusterLight* pLights,
+	uint32_t count,
+	ClusterLightGrid& grid,
+	uint32_t threadCount)
+{
+	auto tileCount = desc.GetTileCount();
+	auto clusterCount = desc.GetClusterCount();
+
+	grid.Ranges.resize(clusterCount);
+	grid.Counts.assign(clusterCount, 0);
+	grid.Slots.resize(size_t(clusterCount) * MaxLightsPerCluster);
+	grid.SliceLights.resize(desc.SliceCount);
+	grid.OverflowCount = 0;
+
+	for (auto& lights : grid.SliceLights)
+	{
+		lights.clear();
+	}
+
+	TransformClusterLights(view, pLights, count, grid);
+
+	// 奥行きが重なるスライスにライトを振り分ける
+	// 境界の丸め誤差で漏れないように前後に1スライス広げる (余分な分はクラスターとの判定で外れる)
+	auto sliceScale = float(desc.SliceCount) / logf(desc.FarZ / desc.NearZ);
+	auto lastSlice = int(desc.SliceCount) - 1;
+
+	for (auto i = 0u; i < count; ++i)
+	{
+		const auto& sphere = grid.ViewSpheres[i];
+		auto depth = bounds.DepthSign * sphere.z;
+
+		// カメラの後ろにあるライト
+		if (depth + sphere.w <= 0.0f)
+		{
+			continue;
+		}
+
+		auto minDepth = depth - sphere.w;
+		auto maxDepth = depth + sphere.w;
+
+		auto first = (minDepth <= desc.NearZ) ? 0 : int(floorf(logf(minDepth / desc.NearZ) * sliceScale)) - 1;
+		auto last = (maxDepth <= desc.NearZ) ? 0 : int(floorf(logf(maxDepth / desc.NearZ) * sliceScale)) + 1;
+
+		first = std::min(std::max(first, 0), lastSlice);
+		last = std::min(std::max(last, 0), lastSlice);
+
+		for (auto slice = first; slice <= last; ++slice)
+		{
+			grid.SliceLights[slice].push_back(i);
+		}
+	}
+
+	// スライスごとにワーカースレッドで判定する (スライスが異なればクラスターは重ならない)
+	ParallelFor(0, desc.SliceCount, [&](uint32_t slice)
+	{
+		auto zero = XMVectorZero();
+		auto sliceElement = slice * bounds.TileStride;
+		auto sliceCluster = slice * tileCount;
+
+		for (auto lightIndex : grid.SliceLights[slice])
+		{
+			const auto& sphere = grid.ViewSpheres[lightIndex];
+			const auto& axis = grid.ViewAxes[lightIndex];
+			auto spot = (pLights[lightIndex].Type == CLUSTER_LIGHT_SPOT);
+
+			auto cx = XMVectorReplicate(sphere.x);
+			auto cy = XMVectorReplicate(sphere.y);
+			auto cz = XMVectorReplicate(sphere.z);
+			auto range = XMVectorReplicate(sphere.w);
+			auto rangeSq = XMVectorMultiply(range, range);
+			auto ax = XMVectorReplicate(axis.x);
+			auto ay = XMVectorReplicate(axis.y);
+			auto az = XMVectorReplicate(axis.z);
+			auto cosAngle = XMVectorReplicate(axis.w);
+			auto sinAngle = XMVectorReplicate(sqrtf(std::max(0.0f, 1.0f - axis.w * axis.w)));
+
+			for (auto tile = 0u; tile < tileCount; tile += ClusterLaneCount)
+			{
+				auto element = sliceElement + tile;
+
+				// 球とバウンディングボックスの距離
+				auto dx = XMVectorAdd(
+					XMVectorMax(zero, XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.MinX[element])), cx)),
+					XMVectorMax(zero, XMVectorSubtract(cx, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.MaxX[element])))));
+				auto dy = XMVectorAdd(
+					XMVectorMax(zero, XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.MinY[element])), cy)),
+					XMVectorMax(zero, XMVectorSubtract(cy, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.MaxY[element])))));
+				auto dz = XMVectorAdd(
+					XMVectorMax(zero, XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.MinZ[element])), cz)),
+					XMVectorMax(zero, XMVectorSubtract(cz, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.MaxZ[element])))));
+				auto distSq = XMVectorAdd(XMVectorAdd(XMVectorMultiply(dx, dx), XMVectorMultiply(dy, dy)), XMVectorMultiply(dz, dz));
+
+				auto mask = XMVectorLessOrEqual(distSq, rangeSq);
+				if (XMVector4EqualInt(mask, zero))
+				{
+					continue;
+				}
+
+				// 円錐とクラスターの外接球
+				if (spot)
+				{
+					auto radius = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.Radius[element]));
+					auto vx = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.CenterX[element])), cx);
+					auto vy = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.CenterY[element])), cy);
+					auto vz = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.CenterZ[element])), cz);
+					auto lenSq = XMVectorAdd(XMVectorAdd(XMVectorMultiply(vx, vx), XMVectorMultiply(vy, vy)), XMVectorMultiply(vz, vz));
+					auto v1Len = XMVectorAdd(XMVectorAdd(XMVectorMultiply(vx, ax), XMVectorMultiply(vy, ay)), XMVectorMultiply(vz, az));
+					auto distClosest = XMVectorSubtract(
+						XMVectorMultiply(cosAngle, XMVectorSqrt(XMVectorMax(XMVectorSubtract(lenSq, XMVectorMultiply(v1Len, v1Len)), zero))),
+						XMVectorMultiply(v1Len, sinAngle));
+
+					mask = XMVectorAndInt(mask, XMVectorLessOrEqual(distClosest, radius));
+					mask = XMVectorAndInt(mask, XMVectorLessOrEqual(v1Len, XMVectorAdd(range, radius)));
+					mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(v1Len, XMVectorNegate(radius)));
+				}
+
+				uint32_t lanes[ClusterLaneCount];
+				XMStoreInt4(lanes, mask);
+
+				auto laneCount = std::min(ClusterLaneCount, tileCount - tile);
+				for (auto lane = 0u; lane < laneCount; ++lane)
+				{
+					if (lanes[lane] == 0)
+					{
+						continue;
+					}
+
+					// 最大数を超えた分も数えておき, 詰める時に超過数として記録する
+					auto cluster = sliceCluster + tile + lane;
+					auto& n = grid.Counts[cluster];
+					if (n < MaxLightsPerCluster)
+					{
+						grid.Slots[size_t(cluster) * MaxLightsPerCluster + n] = lightIndex;
+					}
+					n++;
+				}
+			}
+		}
+	}, threadCount);
+
+	// クラスターごとの範囲を求める
+	uint32_t offset = 0;
+	for (auto i = 0u; i < clusterCount; ++i)
+	{
+		auto n = std::min(grid.Counts[i], MaxLightsPerCluster);
+		grid.OverflowCount += grid.Counts[i] - n;
+		grid.Ranges[i].Offset = offset;
+		grid.Ranges[i].Count = n;
+		offset += n;
+	}
+
+	// 一時リストを詰める
+	grid.LightIndices.resize(offset);
+	ParallelFor(0, desc.SliceCount, [&](uint32_t slice)
+	{
+		for (auto i = slice * tileCount; i < (slice + 1) * tileCount; ++i)
+		{
+			const auto& range = grid.Ranges[i];
+			if (range.Count > 0)
+			{
+				memcpy(&grid.LightIndices[range.Offset], &grid.Slots[size_t(i) * MaxLightsPerCluster], sizeof(uint32_t) * range.Count);
+			}
+		}
+	}, threadCount);
+}
+
+void AssignClusterLightsReference(
+	const ClusterBounds& bounds,
+	const ClusterGridDesc& desc,
+	const XMFLOAT4X4& view,
+	const ClusterLight* pLights,
+	uint32_t count,
+	ClusterLightGrid& grid)
+{
+	auto tileCount = desc.GetTileCount();
+
+	grid.Ranges.resize(desc.GetClusterCount());
+	grid.LightIndices.clear();
+	grid.OverflowCount = 0;
+
+	TransformClusterLights(view, pLights, count, grid);
+
+	for (auto slice = 0u; slice < desc.SliceCount; ++slice)
+	{
+		for (auto tile = 0u; tile < tileCount; ++tile)
+		{
+			auto& range = grid.Ranges[slice * tileCount + tile];
+			range.Offset = uint32_t(grid.LightIndices.size());
+			range.Count = 0;
+
+			for (auto i = 0u; i < count; ++i)
+			{
+				auto spot = (pLights[i].Type == CLUSTER_LIGHT_SPOT);
+				if (!TestClusterLight(bounds, slice * bounds.TileStride + tile, grid.ViewSpheres[i], grid.ViewAxes[i], spot))
+				{
+					continue;
+				}
+
+				if (range.Count < MaxLightsPerCluster)
+				{
+					grid.LightIndices.push_back(i);
+					range.Count++;
+				}
+				else
+				{
+					grid.OverflowCount++;
+				}
+			}
+		}
+	}
+}
+
+ClusterShaderParams GetClusterShaderParams(const ClusterGridDesc& desc, float width, float height, uint32_t lightCount)
+{
+	auto logRatio = logf(desc.FarZ / desc.NearZ);
+
+	ClusterShaderParams result = {};
+	result.TileCountX = desc.TileCountX;
+	result.TileCountY = desc.TileCountY;
+	result.SliceCount = desc.SliceCount;
+	result.LightCount = lightCount;
+	result.TileScaleX = float(desc.TileCountX) / std::max(width, 1.0f);
+	result.TileScaleY = float(desc.TileCountY) / std::max(height, 1.0f);
+	result.SliceScale = float(desc.SliceCount) / logRatio;
+	result.SliceBias = -float(desc.SliceCount) * logf(desc.NearZ) / logRatio;
+
+	return result;
+}
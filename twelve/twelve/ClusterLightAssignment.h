@@ -0,0 +1,188 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// クラスターで扱うライトの種類
+/// </summary>
+enum CLUSTER_LIGHT_TYPE
+{
+	CLUSTER_LIGHT_POINT = 0,	// ポイントライト
+	CLUSTER_LIGHT_SPOT,			// スポットライト
+};
+
+// 1つのクラスターに割り当てるライトの最大数 (超えた分は割り当てず, 数だけ記録する)
+constexpr uint32_t MaxLightsPerCluster = 256;
+
+/// <summary>
+/// クラスターで参照するライトのデータ (ClusteredLighting.hlsli の構造化バッファと並びを一致させる)
+/// 位置と照射方向はワールド空間で持ち, 減衰のパラメータは CbLight と同じ形式にする
+/// </summary>
+struct ClusterLight
+{
+	DirectX::XMFLOAT3	Position;		// 位置
+	float				InvSqrRadius;	// 逆二乗半径
+	DirectX::XMFLOAT3	Color;			// 色
+	float				Intensity;		// 強度
+	DirectX::XMFLOAT3	Forward;		// 照射方向 (スポットライトのみ)
+	float				AngleScale;		// 角度減衰のスケール ( 1.0f / (cosInner - cosOuter) )
+	float				AngleOffset;	// 角度減衰のオフセット ( -cosOuter * AngleScale )
+	uint32_t			Type;			// ライトの種類 (CLUSTER_LIGHT_TYPE)
+	float				Radius;			// 影響半径 (クラスターへの割り当てに使う)
+	float				CosOuterAngle;	// 外側の角度の余弦 (クラスターへの割り当てに使う)
+};
+
+static_assert(sizeof(ClusterLight) == 64, "ClusterLight layout mismatch.");
+
+/// <summary>
+/// ポイントライトを作成する
+/// </summary>
+/// <param name="position">位置</param>
+/// <param name="radius">影響半径</param>
+/// <param name="color">色</param>
+/// <param name="intensity">強度</param>
+ClusterLight MakeClusterPointLight(
+	const DirectX::XMFLOAT3& position,
+	float radius,
+	const DirectX::XMFLOAT3& color,
+	float intensity);
+
+/// <summary>
+/// スポットライトを作成する
+/// </summary>
+/// <param name="position">位置</param>
+/// <param name="forward">照射方向 (正規化済み)</param>
+/// <param name="radius">影響半径</param>
+/// <param name="color">色</param>
+/// <param name="intensity">強度</param>
+/// <param name="innerAngle">内側の角度 [rad]</param>
+/// <param name="outerAngle">外側の角度 [rad]</param>
+ClusterLight MakeClusterSpotLight(
+	const DirectX::XMFLOAT3& position,
+	const DirectX::XMFLOAT3& forward,
+	float radius,
+	const DirectX::XMFLOAT3& color,
+	float intensity,
+	float innerAngle,
+	float outerAngle);
+
+/// <summary>
+/// クラスター (視錐台を画面のタイルと奥行きのスライスで分割したフロクセル) の分割数
+/// 奥行きは近クリップ面から遠クリップ面までを指数的に分割する
+/// </summary>
+struct ClusterGridDesc
+{
+	uint32_t	TileCountX = 16;	// 横の分割数
+	uint32_t	TileCountY = 9;		// 縦の分割数
+	uint32_t	SliceCount = 24;	// 奥行きの分割数
+	float		NearZ = 0.1f;		// 近クリップ面までの距離
+	float		FarZ = 1000.0f;		// 遠クリップ面までの距離
+
+	uint32_t GetTileCount() const { return TileCountX * TileCountY; }
+	uint32_t GetClusterCount() const { return TileCountX * TileCountY * SliceCount; }
+};
+
+/// <summary>
+/// クラスターのビュー空間のバウンディングボックス
+/// SIMDで4個ずつ判定するためにSoAで持ち, スライスごとにタイル数を4の倍数に切り上げて並べる
+/// </summary>
+struct ClusterBounds
+{
+	uint32_t			TileStride = 0;				// スライスあたりの要素数 (4の倍数, 余りは必ず外れる範囲で埋める)
+	float				DepthSign = -1.0f;			// ビュー空間のz座標から深度への符号 (右手系は-1)
+	std::vector<float>	MinX, MinY, MinZ;			// 最小値
+	std::vector<float>	MaxX, MaxY, MaxZ;			// 最大値
+	std::vector<float>	CenterX, CenterY, CenterZ;	// 外接球の中心 (スポットライトの判定に使う)
+	std::vector<float>	Radius;						// 外接球の半径
+};
+
+/// <summary>
+/// クラスターごとのライトの範囲 (ClusteredLighting.hlsli の構造化バッファと並びを一致させる)
+/// </summary>
+struct ClusterRange
+{
+	uint32_t	Offset;	// ライト番号リストの開始位置
+	uint32_t	Count;	// ライトの数
+};
+
+/// <summary>
+/// ライトの割り当て結果 (作業領域も含め, フレームをまたいで使い回す)
+/// クラスター番号は (スライス * TileCountY + y) * TileCountX + x で, 各クラスターのライトは番号の昇順に並ぶ
+/// </summary>
+struct ClusterLightGrid
+{
+	std::vector<ClusterRange>			Ranges;				// クラスターごとの範囲
+	std::vector<uint32_t>				LightIndices;		// 詰めたライト番号のリスト
+	uint32_t							OverflowCount = 0;	// 最大数を超えて割り当てなかった数
+
+	std::vector<uint32_t>				Counts;				// 作業領域 : クラスターごとの割り当て数
+	std::vector<uint32_t>				Slots;				// 作業領域 : クラスターごとに MaxLightsPerCluster 個の一時リスト
+	std::vector<std::vector<uint32_t>>	SliceLights;		// 作業領域 : スライスごとに奥行きが重なるライトの番号
+	std::vector<DirectX::XMFLOAT4>		ViewSpheres;		// 作業領域 : ビュー空間の位置と影響半径
+	std::vector<DirectX::XMFLOAT4>		ViewAxes;			// 作業領域 : ビュー空間の照射方向と外側の角度の余弦
+};
+
+/// <summary>
+/// 射影行列からクラスターのビュー空間のバウンディングボックスを求める
+/// </summary>
+/// <param name="proj">射影行列 (行ベクトル形式. 右手系/左手系のどちらでもよい)</param>
+/// <param name="desc">分割数</param>
+/// <param name="bounds">バウンディングボックスの格納先</param>
+void BuildClusterBounds(const DirectX::XMFLOAT4X4& proj, const ClusterGridDesc& desc, ClusterBounds& bounds);
+
+/// <summary>
+/// ライトをクラスターに割り当てる
+/// ライトを奥行きでスライスに振り分けた後, スライスごとにワーカースレッドで4クラスターずつ球 (スポットライトは円錐) と判定する
+/// </summary>
+/// <param name="bounds">クラスターのバウンディングボックス</param>
+/// <param name="desc">分割数 (バウンディングボックスを求めたものと同じ)</param>
+/// <param name="view">ビュー行列</param>
+/// <param name="pLights">ライト</param>
+/// <param name="count">ライトの数</param>
+/// <param name="grid">割り当て結果の格納先</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+void AssignClusterLights(
+	const ClusterBounds& bounds,
+	const ClusterGridDesc& desc,
+	const DirectX::XMFLOAT4X4& view,
+	const ClusterLight* pLights,
+	uint32_t count,
+	ClusterLightGrid& grid,
+	uint32_t threadCount = 0);
+
+/// <summary>
+/// 全てのクラスターと全てのライトを1つずつ判定して割り当てる (検証用)
+/// </summary>
+void AssignClusterLightsReference(
+	const ClusterBounds& bounds,
+	const ClusterGridDesc& desc,
+	const DirectX::XMFLOAT4X4& view,
+	const ClusterLight* pLights,
+	uint32_t count,
+	ClusterLightGrid& grid);
+
+/// <summary>
+/// シェーダーでクラスター番号を求めるためのパラメータ (CbCamera の末尾に並べる)
+/// </summary>
+struct ClusterShaderParams
+{
+	uint32_t	TileCountX;		// 横の分割数
+	uint32_t	TileCountY;		// 縦の分割数
+	uint32_t	SliceCount;		// 奥行きの分割数
+	uint32_t	LightCount;		// ライトの数 (0の場合はクラスターのライティングを行わない)
+	float		TileScaleX;		// ピクセル座標からタイル番号への倍率
+	float		TileScaleY;		// ピクセル座標からタイル番号への倍率
+	float		SliceScale;		// スライス番号 = log(深度) * SliceScale + SliceBias
+	float		SliceBias;
+};
+
+/// <summary>
+/// シェーダー用のパラメータを求める
+/// </summary>
+/// <param name="desc">分割数</param>
+/// <param name="width">描画先の幅</param>
+/// <param name="height">描画先の高さ</param>
+/// <param name="lightCount">ライトの数</param>
+ClusterShaderParams GetClusterShaderParams(const ClusterGridDesc& desc, float width, float height, uint32_t lightCount);
@@ -0,0 +1,222 @@
+﻿#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Logger.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 永続的にマップするアップロードバッファを生成する
+	/// </summary>
+	bool CreateMappedBuffer(ID3D12Device* pDevice, uint64_t size, ComPtr<ID3D12Resource>& buffer, void** ppMapped)
+	{
+		D3D12_HEAP_PROPERTIES props = {};
+		props.Type = D3D12_HEAP_TYPE_UPLOAD;
+		props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Width = size;
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		auto hr = pDevice->CreateCommittedResource(
+			&props,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(buffer.ReleaseAndGetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreateCommittedResource() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		hr = buffer->Map(0, nullptr, ppMapped);
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Resource::Map() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		return true;
+	}
+}
+
+ClusteredLighting::ClusteredLighting()
+	: m_BoundsProj()
+	, m_HasBounds(false)
+	, m_pLights(nullptr)
+	, m_pRanges(nullptr)
+	, m_pIndices(nullptr)
+	, m_MaxLightCount(0)
+	, m_MaxIndexCount(0)
+	, m_LightCount(0)
+{
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+	Term();
+}
+
+bool ClusteredLighting::Init(ID3D12Device* pDevice, const ClusterGridDesc& desc, uint32_t maxLightCount, uint32_t maxIndexCount)
+{
+	if (pDevice == nullptr || desc.GetClusterCount() == 0 || desc.NearZ <= 0.0f || desc.FarZ <= desc.NearZ
+		|| maxLightCount == 0 || maxIndexCount == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	Term();
+
+	// フレームごとの領域を並べて確保する
+	auto frameCount = uint64_t(Constants::MaxFrameCount);
+
+	if (!CreateMappedBuffer(pDevice, sizeof(ClusterLight) * maxLightCount * frameCount, m_pLightBuffer, reinterpret_cast<void**>(&m_pLights)))
+	{
+		return false;
+	}
+
+	if (!CreateMappedBuffer(pDevice, sizeof(ClusterRange) * desc.GetClusterCount() * frameCount, m_pRangeBuffer, reinterpret_cast<void**>(&m_pRanges)))
+	{
+		return false;
+	}
+
+	if (!CreateMappedBuffer(pDevice, sizeof(uint32_t) * maxIndexCount * frameCount, m_pIndexBuffer, reinterpret_cast<void**>(&m_pIndices)))
+	{
+		return false;
+	}
+
+	m_Desc = desc;
+	m_HasBounds = false;
+	m_MaxLightCount = maxLightCount;
+	m_MaxIndexCount = maxIndexCount;
+	m_LightCount = 0;
+
+	return true;
+}
+
+void ClusteredLighting::Term()
+{
+	if (m_pLightBuffer != nullptr && m_pLights != nullptr)
+	{
+		m_pLightBuffer->Unmap(0, nullptr);
+	}
+
+	if (m_pRangeBuffer != nullptr && m_pRanges != nullptr)
+	{
+		m_pRangeBuffer->Unmap(0, nullptr);
+	}
+
+	if (m_pIndexBuffer != nullptr && m_pIndices != nullptr)
+	{
+		m_pIndexBuffer->Unmap(0, nullptr);
+	}
+
+	m_pLights = nullptr;
+	m_pRanges = nullptr;
+	m_pIndices = nullptr;
+	m_pLightBuffer.Reset();
+	m_pRangeBuffer.Reset();
+	m_pIndexBuffer.Reset();
+
+	m_Grid = ClusterLightGrid();
+	m_HasBounds = false;
+	m_MaxLightCount = 0;
+	m_MaxIndexCount = 0;
+	m_LightCount = 0;
+}
+
+void ClusteredLighting::Update(
+	uint32_t frameIndex,
+	const XMFLOAT4X4& view,
+	const XMFLOAT4X4& proj,
+	const ClusterLight* pLights,
+	uint32_t count)
+{
+	if (m_pLights == nullptr || frameIndex >= Constants::MaxFrameCount)
+	{
+		return;
+	}
+
+	if (pLights == nullptr)
+	{
+		count = 0;
+	}
+
+	count = std::min(count, m_MaxLightCount);
+
+	// 射影行列が変わった場合のみバウンディングボックスを求め直す
+	if (!m_HasBounds || memcmp(&m_BoundsProj, &proj, sizeof(proj)) != 0)
+	{
+		BuildClusterBounds(proj, m_Desc, m_Bounds);
+		m_BoundsProj = proj;
+		m_HasBounds = true;
+	}
+
+	AssignClusterLights(m_Bounds, m_Desc, view, pLights, count, m_Grid);
+
+	auto clusterCount = m_Desc.GetClusterCount();
+	auto pDstLights = m_pLights + size_t(frameIndex) * m_MaxLightCount;
+	auto pDstRanges = m_pRanges + size_t(frameIndex) * clusterCount;
+	auto pDstIndices = m_pIndices + size_t(frameIndex) * m_MaxIndexCount;
+
+	if (count > 0)
+	{
+		memcpy(pDstLights, pLights, sizeof(ClusterLight) * count);
+	}
+
+	// ライト番号リストが最大長を超えた場合は, 超えた分のクラスターのライトを減らす
+	auto indexCount = std::min(uint32_t(m_Grid.LightIndices.size()), m_MaxIndexCount);
+	for (auto i = 0u; i < clusterCount; ++i)
+	{
+		auto range = m_Grid.Ranges[i];
+		range.Count = (range.Offset >= indexCount) ? 0 : std::min(range.Count, indexCount - range.Offset);
+		pDstRanges[i] = range;
+	}
+
+	if (indexCount > 0)
+	{
+		memcpy(pDstIndices, m_Grid.LightIndices.data(), sizeof(uint32_t) * indexCount);
+	}
+
+	m_LightCount = count;
+}
+
+void ClusteredLighting::SetRootParameters(
+	CommandRecorder& recorder,
+	uint32_t frameIndex,
+	uint32_t lightParam,
+	uint32_t rangeParam,
+	uint32_t indexParam) const
+{
+	if (m_pLightBuffer == nullptr || frameIndex >= Constants::MaxFrameCount)
+	{
+		return;
+	}
+
+	auto clusterCount = m_Desc.GetClusterCount();
+
+	recorder.SetGraphicsRootShaderResourceView(lightParam, m_pLightBuffer->GetGPUVirtualAddress() + sizeof(ClusterLight) * m_MaxLightCount * frameIndex);
+	recorder.SetGraphicsRootShaderResourceView(rangeParam, m_pRangeBuffer->GetGPUVirtualAddress() + sizeof(ClusterRange) * clusterCount * frameIndex);
+	recorder.SetGraphicsRootShaderResourceView(indexParam, m_pIndexBuffer->GetGPUVirtualAddress() + sizeof(uint32_t) * m_MaxIndexCount * frameIndex);
+}
+
+ClusterShaderParams ClusteredLighting::GetShaderParams(float width, float height) const
+{
+	return GetClusterShaderParams(m_Desc, width, height, m_LightCount);
+}
@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <DirectXMath.h>
+#include <cstdint>
+
+#include "ClusterLightAssignment.h"
+#include "CommandRecorder.h"
+#include "ComPtr.h"
+#include "Constants.h"
+
+/// <summary>
+/// クラスタードフォワードのライトの割り当てと, フレームごとのライトのバッファ (アップロードヒープ)
+/// バッファはルートSRVで設定するので, ディスクリプタは使わない
+/// </summary>
+class ClusteredLighting
+{
+public:
+	ClusteredLighting();
+	~ClusteredLighting();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="desc">分割数</param>
+	/// <param name="maxLightCount">1フレームの最大ライト数</param>
+	/// <param name="maxIndexCount">1フレームのライト番号リストの最大長</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Init(ID3D12Device* pDevice, const ClusterGridDesc& desc, uint32_t maxLightCount, uint32_t maxIndexCount);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// ライトをクラスターに割り当て, フレームのバッファに書き込む
+	/// 射影行列が変わった場合のみバウンディングボックスを求め直す
+	/// </summary>
+	/// <param name="frameIndex">フレーム番号</param>
+	/// <param name="view">ビュー行列</param>
+	/// <param name="proj">射影行列</param>
+	/// <param name="pLights">ライト</param>
+	/// <param name="count">ライトの数 (最大数を超えた分は使わない)</param>
+	void Update(
+		uint32_t frameIndex,
+		const DirectX::XMFLOAT4X4& view,
+		const DirectX::XMFLOAT4X4& proj,
+		const ClusterLight* pLights,
+		uint32_t count);
+
+	/// <summary>
+	/// フレームのバッファをルートSRVに設定する
+	/// </summary>
+	/// <param name="recorder">コマンドレコーダー</param>
+	/// <param name="frameIndex">フレーム番号</param>
+	/// <param name="lightParam">ライトのバッファの引数番号</param>
+	/// <param name="rangeParam">クラスターごとの範囲のバッファの引数番号</param>
+	/// <param name="indexParam">ライト番号リストのバッファの引数番号</param>
+	void SetRootParameters(
+		CommandRecorder& recorder,
+		uint32_t frameIndex,
+		uint32_t lightParam,
+		uint32_t rangeParam,
+		uint32_t indexParam) const;
+
+	/// <summary>
+	/// シェーダー用のパラメータを取得する
+	/// </summary>
+	/// <param name="width">描画先の幅</param>
+	/// <param name="height">描画先の高さ</param>
+	ClusterShaderParams GetShaderParams(float width, float height) const;
+
+	const ClusterLightGrid& GetGrid() const { return m_Grid; }
+	uint32_t GetLightCount() const { return m_LightCount; }
+
+private:
+	ClusterGridDesc			m_Desc;				// 分割数
+	ClusterBounds			m_Bounds;			// クラスターのバウンディングボックス
+	DirectX::XMFLOAT4X4		m_BoundsProj;		// バウンディングボックスを求めた射影行列
+	bool					m_HasBounds;		// バウンディングボックスを求めたかどうか
+	ClusterLightGrid		m_Grid;				// 割り当て結果
+	ComPtr<ID3D12Resource>	m_pLightBuffer;		// ライト (フレームごとに最大ライト数分)
+	ComPtr<ID3D12Resource>	m_pRangeBuffer;		// クラスターごとの範囲 (フレームごとにクラスター数分)
+	ComPtr<ID3D12Resource>	m_pIndexBuffer;		// ライト番号リスト (フレームごとに最大長分)
+	ClusterLight*			m_pLights;			// マップした先頭
+	ClusterRange*			m_pRanges;			// マップした先頭
+	uint32_t*				m_pIndices;			// マップした先頭
+	uint32_t				m_MaxLightCount;	// 1フレームの最大ライト数
+	uint32_t				m_MaxIndexCount;	// 1フレームのライト番号リストの最大長
+	uint32_t				m_LightCount;		// 最後に書き込んだライトの数
+
+	ClusteredLighting(const ClusteredLighting&) = delete;
+	void operator=(const ClusteredLighting&) = delete;
+};
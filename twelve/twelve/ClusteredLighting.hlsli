@@ -0,0 +1,155 @@
+//-----------------------------------------------------------------------------
+// File : ClusteredLighting.hlsli
+// Desc : Clustered Forward Lighting.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#ifndef CLUSTERED_LIGHTING_HLSLI
+#define CLUSTERED_LIGHTING_HLSLI
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "BRDF.hlsli"
+#include "ShadowAtlas.hlsli"
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+#ifndef CLUSTER_MIN_DIST
+#define CLUSTER_MIN_DIST    (0.01)  // 距離減衰の最小距離.
+#endif//CLUSTER_MIN_DIST
+
+#define CLUSTER_LIGHT_POINT (0)     // ポイントライト.
+#define CLUSTER_LIGHT_SPOT  (1)     // スポットライト.
+
+///////////////////////////////////////////////////////////////////////////////
+// ClusterLight structure
+///////////////////////////////////////////////////////////////////////////////
+struct ClusterLight
+{
+    float3 Position; // ライトの位置です.
+    float InvSqrRadius; // ライト半径の2乗の逆数です.
+    float3 Color; // ライトカラーです.
+    float Intensity; // ライト強度です.
+    float3 Forward; // スポットライトの照射方向です.
+    float AngleScale; // スポットライトの角度減衰スケールです.
+    float AngleOffset; // スポットライトの角度減衰オフセットです.
+    uint Type; // ライトの種類です.
+    float Radius; // 影響半径です (割り当てにのみ使用します).
+    float CosOuterAngle; // 外側の角度の余弦です (割り当てにのみ使用します).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ClusterRange structure
+///////////////////////////////////////////////////////////////////////////////
+struct ClusterRange
+{
+    uint Offset; // ライト番号リストの開始位置です.
+    uint Count; // ライトの数です.
+};
+
+//-----------------------------------------------------------------------------
+// Buffers
+//-----------------------------------------------------------------------------
+// ライト (ワールド空間).
+StructuredBuffer<ClusterLight> ClusterLights : register(t7);
+
+// クラスターごとのライトの範囲.
+StructuredBuffer<ClusterRange> ClusterRanges : register(t8);
+
+// 詰めたライト番号のリスト.
+StructuredBuffer<uint> ClusterLightIndices : register(t9);
+
+// ※ ClusterTileCountX などのパラメータは, インクルード元の CbCamera で宣言します.
+
+//-----------------------------------------------------------------------------
+//      ピクセル位置と深度からクラスター番号を求めます.
+//-----------------------------------------------------------------------------
+uint ComputeClusterIndex(float4 svPosition)
+{
+    // 奥行きはCPUと同じく近クリップ面から指数的に分割されています (SV_Position.w はビュー空間の深度).
+    uint2 tile = min(uint2(svPosition.xy * float2(ClusterTileScaleX, ClusterTileScaleY)), uint2(ClusterTileCountX - 1, ClusterTileCountY - 1));
+    float slice = clamp(floor(log(svPosition.w) * ClusterSliceScale + ClusterSliceBias), 0.0f, float(ClusterSliceCount - 1));
+
+    return (uint(slice) * ClusterTileCountY + tile.y) * ClusterTileCountX + tile.x;
+}
+
+//-----------------------------------------------------------------------------
+//      距離減衰を求めます [Lagarde, Rousiers 2014].
+//-----------------------------------------------------------------------------
+float ClusterDistanceAttenuation(float3 unnormalizedLightVector, float invSqrAttRadius)
+{
+    float sqrDist = dot(unnormalizedLightVector, unnormalizedLightVector);
+    float attenuation = 1.0f / (max(sqrDist, CLUSTER_MIN_DIST * CLUSTER_MIN_DIST));
+
+    float factor = sqrDist * invSqrAttRadius;
+    float smoothFactor = saturate(1.0f - factor * factor);
+
+    return attenuation * smoothFactor * smoothFactor;
+}
+
+//-----------------------------------------------------------------------------
+//      スポットライトの角度減衰を求めます.
+//-----------------------------------------------------------------------------
+float ClusterAngleAttenuation(float3 lightDir, float3 lightForward, float lightAngleScale, float lightAngleOffset)
+{
+    float attenuation = saturate(dot(lightDir, lightForward) * lightAngleScale + lightAngleOffset);
+    return attenuation * attenuation;
+}
+
+//-----------------------------------------------------------------------------
+//      ピクセルが含まれるクラスターのライトを評価します.
+//-----------------------------------------------------------------------------
+float3 EvaluateClusteredLights
+(
+    float4 svPosition, // SV_Position.
+    float3 worldPos, // ワールド空間の位置.
+    float3 N, // 法線ベクトル.
+    float3 V, // 視線ベクトル (カメラに向かう方向).
+    float3 Kd, // 拡散反射率.
+    float3 Ks, // 鏡面反射率.
+    float roughness // 線形ラフネス.
+)
+{
+    float3 result = 0.0f;
+
+    if (ClusterLightCount == 0)
+    {
+        return result;
+    }
+
+    ClusterRange range = ClusterRanges[ComputeClusterIndex(svPosition)];
+    float NV = saturate(dot(N, V));
+
+    for (uint i = 0; i < range.Count; ++i)
+    {
+        uint lightIndex = ClusterLightIndices[range.Offset + i];
+        ClusterLight light = ClusterLights[lightIndex];
+
+        float3 unnormalizedLightVector = light.Position - worldPos;
+        float3 L = normalize(unnormalizedLightVector);
+        float att = ClusterDistanceAttenuation(unnormalizedLightVector, light.InvSqrRadius);
+
+        if (light.Type == CLUSTER_LIGHT_SPOT)
+        {
+            att *= ClusterAngleAttenuation(-L, light.Forward, light.AngleScale, light.AngleOffset);
+
+            // 影の届かないピクセルではサンプルしません.
+            if (att > 0.0f)
+            {
+                att *= SampleSpotShadow(lightIndex, worldPos, N, length(unnormalizedLightVector));
+            }
+        }
+
+        float3 H = normalize(V + L);
+        float NL = saturate(dot(N, L));
+        float NH = saturate(dot(N, H));
+
+        float3 brdf = ComputeLambert(Kd) + ComputeGGX(Ks, roughness, NH, NV, NL);
+        result += brdf * NL * light.Color * light.Intensity * att;
+    }
+
+    return result;
+}
+
+#endif//CLUSTERED_LIGHTING_HLSLI
@@ -0,0 +1,92 @@
+﻿#include "CommandAllocatorTracker.h"
+
+#include <algorithm>
+
+void SortCommandListSubmitEntries(std::vector<CommandListSubmitEntry>& entries)
+{
+	std::sort(entries.begin(), entries.end(), [](const CommandListSubmitEntry& a, const CommandListSubmitEntry& b)
+	{
+		if (a.Order != b.Order)
+		{
+			return a.Order < b.Order;
+		}
+
+		if (a.Thread != b.Thread)
+		{
+			return a.Thread < b.Thread;
+		}
+
+		return a.Sequence < b.Sequence;
+	});
+}
+
+CommandAllocatorTracker::CommandAllocatorTracker()
+{
+}
+
+CommandAllocatorTracker::~CommandAllocatorTracker()
+{
+	Term();
+}
+
+void CommandAllocatorTracker::Init(uint32_t threadCount)
+{
+	m_Threads.clear();
+	m_Threads.resize(threadCount);
+}
+
+void CommandAllocatorTracker::Term()
+{
+	m_Threads.clear();
+	m_Threads.shrink_to_fit();
+}
+
+uint32_t CommandAllocatorTracker::Acquire(uint32_t thread, uint64_t completedValue, bool& created)
+{
+	auto& state = m_Threads[thread];
+
+	// フェンス値の昇順に並んでいるので, 先頭が未完了なら再利用できるものはない
+	if (!state.Retired.empty() && state.Retired.front().FenceValue <= completedValue)
+	{
+		auto index = state.Retired.front().Index;
+		state.Retired.pop_front();
+		state.Acquired.push_back(index);
+		state.ReuseCount++;
+
+		created = false;
+		return index;
+	}
+
+	auto index = state.AllocatorCount++;
+	state.Acquired.push_back(index);
+
+	created = true;
+	return index;
+}
+
+void CommandAllocatorTracker::Retire(uint64_t fenceValue)
+{
+	for (auto& state : m_Threads)
+	{
+		for (auto index : state.Acquired)
+		{
+			state.Retired.push_back({ index, fenceValue });
+		}
+
+		state.Acquired.clear();
+	}
+}
+
+uint32_t CommandAllocatorTracker::GetPendingCount(uint32_t thread, uint64_t completedValue) const
+{
+	auto count = 0u;
+	for (auto& retired : m_Threads[thread].Retired)
+	{
+		if (retired.FenceValue > completedValue)
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/// <summary>
+/// 提出待ちのコマンドリスト
+/// </summary>
+struct CommandListSubmitEntry
+{
+	uint32_t			Order = 0;			// 提出順のキー (小さいものから実行する)
+	uint32_t			Thread = 0;			// 記録したスレッド番号
+	uint32_t			Sequence = 0;		// スレッド内で割り当てた順番
+	ID3D12CommandList*	pList = nullptr;	// コマンドリスト
+};
+
+/// <summary>
+/// 提出順に並べ替える (Order, Thread, Sequence の順に比較するので, 記録したスレッドによらず結果は一定になる)
+/// </summary>
+/// <param name="entries">提出待ちのコマンドリスト</param>
+void SortCommandListSubmitEntries(std::vector<CommandListSubmitEntry>& entries);
+
+/// <summary>
+/// スレッドごとのコマンドアロケータの再利用を管理する (デバイスに依存しない部分)
+/// アロケータはフレームの終わりにフェンス値と紐づけて退役させ, フェンスがその値に達したものから再利用する
+/// Acquire() はスレッド番号が異なれば並列に呼び出してよい
+/// </summary>
+class CommandAllocatorTracker
+{
+public:
+	CommandAllocatorTracker();
+	~CommandAllocatorTracker();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="threadCount">スレッド数</param>
+	void Init(uint32_t threadCount);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// アロケータを取得する
+	/// </summary>
+	/// <param name="thread">スレッド番号</param>
+	/// <param name="completedValue">GPUが完了したフェンス値</param>
+	/// <param name="created">新しいアロケータを割り当てた場合はtrue (呼び出し側で生成する)</param>
+	/// <returns>スレッド内のアロケータ番号</returns>
+	uint32_t Acquire(uint32_t thread, uint64_t completedValue, bool& created);
+
+	/// <summary>
+	/// 前回の Retire() 以降に取得したアロケータを退役させる
+	/// </summary>
+	/// <param name="fenceValue">このフレームのコマンドの完了時にシグナルされるフェンス値</param>
+	void Retire(uint64_t fenceValue);
+
+	uint32_t GetThreadCount() const { return uint32_t(m_Threads.size()); }
+	uint32_t GetAllocatorCount(uint32_t thread) const { return m_Threads[thread].AllocatorCount; }
+	uint64_t GetReuseCount(uint32_t thread) const { return m_Threads[thread].ReuseCount; }
+
+	/// <summary>
+	/// GPUの完了を待っているアロケータの数を取得する
+	/// </summary>
+	uint32_t GetPendingCount(uint32_t thread, uint64_t completedValue) const;
+
+private:
+	struct RetiredAllocator
+	{
+		uint32_t	Index;
+		uint64_t	FenceValue;
+	};
+
+	struct ThreadState
+	{
+		std::deque<RetiredAllocator>	Retired;			// 退役したアロケータ (フェンス値の昇順)
+		std::vector<uint32_t>			Acquired;			// このフレームで取得したアロケータ
+		uint32_t						AllocatorCount = 0;
+		uint64_t						ReuseCount = 0;
+	};
+
+	std::vector<ThreadState>	m_Threads;
+};
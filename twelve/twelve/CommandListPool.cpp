@@ -0,0 +1,169 @@
+﻿#include "CommandListPool.h"
+
+#include "Logger.h"
+
+CommandListPool::CommandListPool()
+	: m_pDevice(nullptr)
+	, m_Type(D3D12_COMMAND_LIST_TYPE_DIRECT)
+	, m_CompletedValue(0)
+{
+}
+
+CommandListPool::~CommandListPool()
+{
+	Term();
+}
+
+bool CommandListPool::Init(ID3D12Device* pDevice, D3D12_COMMAND_LIST_TYPE type, uint32_t threadCount)
+{
+	if (pDevice == nullptr || threadCount == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	m_pDevice = pDevice;
+	m_Type = type;
+	m_CompletedValue = 0;
+
+	m_Tracker.Init(threadCount);
+	m_Contexts.resize(threadCount);
+
+	return true;
+}
+
+void CommandListPool::Term()
+{
+	m_Contexts.clear();
+	m_Contexts.shrink_to_fit();
+
+	m_Tracker.Term();
+
+	m_SubmitEntries.clear();
+	m_SubmitLists.clear();
+
+	m_pDevice.Reset();
+}
+
+void CommandListPool::BeginFrame(uint64_t completedValue)
+{
+	m_CompletedValue = completedValue;
+}
+
+ID3D12GraphicsCommandList* CommandListPool::Allocate(uint32_t thread, uint32_t order)
+{
+	if (thread >= m_Contexts.size())
+	{
+		ELOG("Error : Invalid Argument.");
+		return nullptr;
+	}
+
+	auto& context = m_Contexts[thread];
+
+	// スレッドの最初のリストでアロケータを決める (同じスレッドのリストは順に記録するので共有できる)
+	if (context.AllocatorIndex == UINT32_MAX)
+	{
+		auto created = false;
+		auto index = m_Tracker.Acquire(thread, m_CompletedValue, created);
+
+		if (created)
+		{
+			context.pAllocators.resize(index + 1);
+		}
+
+		// 生成に失敗したままのものも作り直す
+		if (context.pAllocators[index] == nullptr)
+		{
+			auto hr = m_pDevice->CreateCommandAllocator(m_Type, IID_PPV_ARGS(context.pAllocators[index].GetAddressOf()));
+			if (FAILED(hr))
+			{
+				ELOG("Error : ID3D12Device::CreateCommandAllocator() Failed. retcode = 0x%x", hr);
+				return nullptr;
+			}
+		}
+		else
+		{
+			auto hr = context.pAllocators[index]->Reset();
+			if (FAILED(hr))
+			{
+				ELOG("Error : ID3D12CommandAllocator::Reset() Failed. retcode = 0x%x", hr);
+				return nullptr;
+			}
+		}
+
+		context.AllocatorIndex = index;
+	}
+
+	auto pAllocator = context.pAllocators[context.AllocatorIndex].Get();
+	auto sequence = uint32_t(context.Entries.size());
+
+	// 提出済みのリストはGPUの完了を待たずにリセットできる
+	if (sequence < context.pCmdLists.size())
+	{
+		auto hr = context.pCmdLists[sequence]->Reset(pAllocator, nullptr);
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12GraphicsCommandList::Reset() Failed. retcode = 0x%x", hr);
+			return nullptr;
+		}
+	}
+	else
+	{
+		ComPtr<ID3D12GraphicsCommandList> pCmdList;
+		auto hr = m_pDevice->CreateCommandList(0, m_Type, pAllocator, nullptr, IID_PPV_ARGS(pCmdList.GetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreateCommandList() Failed. retcode = 0x%x", hr);
+			return nullptr;
+		}
+
+		context.pCmdLists.push_back(pCmdList);
+	}
+
+	auto pCmdList = context.pCmdLists[sequence].Get();
+
+	CommandListSubmitEntry entry;
+	entry.Order = order;
+	entry.Thread = thread;
+	entry.Sequence = sequence;
+	entry.pList = pCmdList;
+	context.Entries.push_back(entry);
+
+	return pCmdList;
+}
+
+void CommandListPool::Submit(ID3D12CommandQueue* pQueue)
+{
+	m_SubmitEntries.clear();
+
+	for (auto& context : m_Contexts)
+	{
+		m_SubmitEntries.insert(m_SubmitEntries.end(), context.Entries.begin(), context.Entries.end());
+	}
+
+	if (m_SubmitEntries.empty())
+	{
+		return;
+	}
+
+	SortCommandListSubmitEntries(m_SubmitEntries);
+
+	m_SubmitLists.clear();
+	for (auto& entry : m_SubmitEntries)
+	{
+		m_SubmitLists.push_back(entry.pList);
+	}
+
+	pQueue->ExecuteCommandLists(UINT(m_SubmitLists.size()), m_SubmitLists.data());
+}
+
+void CommandListPool::EndFrame(uint64_t fenceValue)
+{
+	m_Tracker.Retire(fenceValue);
+
+	for (auto& context : m_Contexts)
+	{
+		context.Entries.clear();
+		context.AllocatorIndex = UINT32_MAX;
+	}
+}
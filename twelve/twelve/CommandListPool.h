@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <cstdint>
+#include <vector>
+
+#include "CommandAllocatorTracker.h"
+#include "ComPtr.h"
+
+/// <summary>
+/// スレッドごとにコマンドリストとアロケータを割り当てるプール
+/// フレームの流れ
+///  BeginFrame() ---> Allocate() で取得したリストに記録して Close() (スレッドごとに並列可) ---> Submit() ---> EndFrame()
+/// 同じスレッド番号の Allocate() を複数のスレッドから同時に呼び出さないこと
+/// </summary>
+class CommandListPool
+{
+public:
+	CommandListPool();
+	~CommandListPool();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="type">コマンドリストタイプ</param>
+	/// <param name="threadCount">記録するスレッドの数</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Init(ID3D12Device* pDevice, D3D12_COMMAND_LIST_TYPE type, uint32_t threadCount);
+
+	/// <summary>
+	/// 終了処理 (GPUの完了を待ってから呼ぶこと)
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// フレームを開始する
+	/// </summary>
+	/// <param name="completedValue">GPUが完了したフェンス値</param>
+	void BeginFrame(uint64_t completedValue);
+
+	/// <summary>
+	/// リセット処理を行ったコマンドリストを取得する
+	/// </summary>
+	/// <param name="thread">スレッド番号</param>
+	/// <param name="order">提出順のキー</param>
+	/// <returns>コマンドリスト (失敗した場合はnullptr)</returns>
+	ID3D12GraphicsCommandList* Allocate(uint32_t thread, uint32_t order);
+
+	/// <summary>
+	/// 取得したコマンドリストを提出順に並べて1回の ExecuteCommandLists() で実行する
+	/// </summary>
+	/// <param name="pQueue">コマンドキュー</param>
+	void Submit(ID3D12CommandQueue* pQueue);
+
+	/// <summary>
+	/// フレームを終了する
+	/// </summary>
+	/// <param name="fenceValue">このフレームのコマンドの完了時にシグナルされるフェンス値</param>
+	void EndFrame(uint64_t fenceValue);
+
+	uint32_t GetThreadCount() const { return uint32_t(m_Contexts.size()); }
+
+private:
+	struct ThreadContext
+	{
+		std::vector<ComPtr<ID3D12CommandAllocator>>		pAllocators;
+		std::vector<ComPtr<ID3D12GraphicsCommandList>>	pCmdLists;
+		std::vector<CommandListSubmitEntry>				Entries;						// このフレームで取得したリスト
+		uint32_t										AllocatorIndex = UINT32_MAX;	// このフレームで使うアロケータ
+	};
+
+	ComPtr<ID3D12Device>				m_pDevice;
+	D3D12_COMMAND_LIST_TYPE				m_Type;
+	CommandAllocatorTracker				m_Tracker;
+	std::vector<ThreadContext>			m_Contexts;
+	uint64_t							m_CompletedValue;
+	std::vector<CommandListSubmitEntry>	m_SubmitEntries;	// 提出用の作業領域
+	std::vector<ID3D12CommandList*>		m_SubmitLists;		// 提出用の作業領域
+
+	CommandListPool(const CommandListPool&) = delete;
+	void operator=(const CommandListPool&) = delete;
+};
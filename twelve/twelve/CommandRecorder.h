@@ -0,0 +1,505 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <cstdint>
+#include <cstring>
+
+/// <summary>
+/// 記録する状態の種類 (統計値の分類に使う)
+/// </summary>
+enum COMMAND_STATE_TYPE
+{
+	COMMAND_STATE_ROOT_SIGNATURE = 0,	// ルートシグネチャ
+	COMMAND_STATE_PIPELINE,				// パイプラインステート
+	COMMAND_STATE_ROOT_PARAMETER,		// ルート引数 (ディスクリプタテーブル, ルートSRV/CBV, ルート定数)
+	COMMAND_STATE_TOPOLOGY,				// プリミティブトポロジー
+	COMMAND_STATE_VERTEX_BUFFER,		// 頂点バッファ
+	COMMAND_STATE_INDEX_BUFFER,			// インデックスバッファ
+	COMMAND_STATE_VIEWPORT,				// ビューポート
+	COMMAND_STATE_SCISSOR,				// シザー矩形
+	COMMAND_STATE_RENDER_TARGET,		// レンダーターゲット
+	COMMAND_STATE_DESCRIPTOR_HEAP,		// ディスクリプタヒープ
+
+	COMMAND_STATE_COUNT,
+};
+
+/// <summary>
+/// 状態設定の発行数と省略数
+/// </summary>
+struct CommandRecorderStats
+{
+	uint32_t	Issued[COMMAND_STATE_COUNT] = {};	// コマンドリストに発行した数
+	uint32_t	Filtered[COMMAND_STATE_COUNT] = {};	// 設定済みの値と同じため省略した数
+	uint32_t	DrawCount = 0;						// 描画コマンドの数
+
+	void Add(const CommandRecorderStats& other)
+	{
+		for (auto i = 0; i < COMMAND_STATE_COUNT; ++i)
+		{
+			Issued[i] += other.Issued[i];
+			Filtered[i] += other.Filtered[i];
+		}
+		DrawCount += other.DrawCount;
+	}
+
+	uint32_t GetIssuedCount() const
+	{
+		auto result = 0u;
+		for (auto i = 0; i < COMMAND_STATE_COUNT; ++i)
+		{
+			result += Issued[i];
+		}
+		return result;
+	}
+
+	uint32_t GetFilteredCount() const
+	{
+		auto result = 0u;
+		for (auto i = 0; i < COMMAND_STATE_COUNT; ++i)
+		{
+			result += Filtered[i];
+		}
+		return result;
+	}
+};
+
+/// <summary>
+/// 設定済みの状態を覚えておき, 同じ値の設定を省略してコマンドリストに記録する
+/// コマンドリストの型はテンプレート引数にし, デバイスなしで同じ名前のメソッドを持つ型に差し替えられるようにする
+/// コマンドリストを直接操作した場合は Invalidate() で覚えている状態を破棄すること
+/// </summary>
+template<typename ListType>
+class BasicCommandRecorder
+{
+public:
+	static constexpr uint32_t MaxRootParameterCount = 32;	// 状態を覚えるルート引数の数 (超えた番号は常に発行する)
+	static constexpr uint32_t MaxRootConstantCount = 4;		// 状態を覚えるルート定数の数 (超えた場合は常に発行する)
+	static constexpr uint32_t MaxVertexBufferCount = 4;		// 状態を覚える頂点バッファのスロット数
+	static constexpr uint32_t MaxRenderTargetCount = 8;		// 状態を覚えるレンダーターゲットの数
+
+	explicit BasicCommandRecorder(ListType* pCmd = nullptr)
+		: m_pCmd(pCmd)
+	{
+		Invalidate();
+	}
+
+	/// <summary>
+	/// 記録先のコマンドリストを設定する (状態は破棄し, 統計値は残す)
+	/// </summary>
+	void Reset(ListType* pCmd)
+	{
+		m_pCmd = pCmd;
+		Invalidate();
+	}
+
+	/// <summary>
+	/// 覚えている状態を全て破棄する (次の設定は必ず発行される)
+	/// </summary>
+	void Invalidate()
+	{
+		m_pRootSignature = nullptr;
+		m_pPipelineState = nullptr;
+		m_HasTopology = false;
+		m_Topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+		m_HasIndexBuffer = false;
+		m_IndexBuffer = {};
+		m_HasViewport = false;
+		m_Viewport = {};
+		m_HasScissor = false;
+		m_Scissor = {};
+		m_HasRenderTargets = false;
+		m_RenderTargetCount = 0;
+		m_HasDepthStencil = false;
+		m_DepthStencil = {};
+		m_HasDescriptorHeaps = false;
+		m_DescriptorHeapCount = 0;
+		memset(m_RenderTargets, 0, sizeof(m_RenderTargets));
+		memset(m_DescriptorHeaps, 0, sizeof(m_DescriptorHeaps));
+		memset(m_VertexBufferValid, 0, sizeof(m_VertexBufferValid));
+		memset(m_VertexBuffers, 0, sizeof(m_VertexBuffers));
+		InvalidateRootParameters();
+	}
+
+	void SetGraphicsRootSignature(ID3D12RootSignature* pRootSignature)
+	{
+		if (pRootSignature != nullptr && pRootSignature == m_pRootSignature)
+		{
+			Filter(COMMAND_STATE_ROOT_SIGNATURE);
+			return;
+		}
+
+		// ルートシグネチャが変わるとルート引数は全て無効になる
+		m_pCmd->SetGraphicsRootSignature(pRootSignature);
+		m_pRootSignature = pRootSignature;
+		InvalidateRootParameters();
+		Issue(COMMAND_STATE_ROOT_SIGNATURE);
+	}
+
+	void SetPipelineState(ID3D12PipelineState* pPipelineState)
+	{
+		if (pPipelineState != nullptr && pPipelineState == m_pPipelineState)
+		{
+			Filter(COMMAND_STATE_PIPELINE);
+			return;
+		}
+
+		m_pCmd->SetPipelineState(pPipelineState);
+		m_pPipelineState = pPipelineState;
+		Issue(COMMAND_STATE_PIPELINE);
+	}
+
+	void SetGraphicsRootDescriptorTable(UINT index, D3D12_GPU_DESCRIPTOR_HANDLE handle)
+	{
+		if (MatchRootParameter(index, ROOT_PARAM_TABLE, handle.ptr))
+		{
+			Filter(COMMAND_STATE_ROOT_PARAMETER);
+			return;
+		}
+
+		m_pCmd->SetGraphicsRootDescriptorTable(index, handle);
+		StoreRootParameter(index, ROOT_PARAM_TABLE, handle.ptr);
+		Issue(COMMAND_STATE_ROOT_PARAMETER);
+	}
+
+	void SetGraphicsRootShaderResourceView(UINT index, D3D12_GPU_VIRTUAL_ADDRESS address)
+	{
+		if (MatchRootParameter(index, ROOT_PARAM_SRV, address))
+		{
+			Filter(COMMAND_STATE_ROOT_PARAMETER);
+			return;
+		}
+
+		m_pCmd->SetGraphicsRootShaderResourceView(index, address);
+		StoreRootParameter(index, ROOT_PARAM_SRV, address);
+		Issue(COMMAND_STATE_ROOT_PARAMETER);
+	}
+
+	void SetGraphicsRootConstantBufferView(UINT index, D3D12_GPU_VIRTUAL_ADDRESS address)
+	{
+		if (MatchRootParameter(index, ROOT_PARAM_CBV, address))
+		{
+			Filter(COMMAND_STATE_ROOT_PARAMETER);
+			return;
+		}
+
+		m_pCmd->SetGraphicsRootConstantBufferView(index, address);
+		StoreRootParameter(index, ROOT_PARAM_CBV, address);
+		Issue(COMMAND_STATE_ROOT_PARAMETER);
+	}
+
+	void SetGraphicsRoot32BitConstants(UINT index, UINT count, const void* pData, UINT offset)
+	{
+		// 前回と同じ範囲に同じ値を設定する場合のみ省略する
+		auto cacheable = (index < MaxRootParameterCount && count > 0 && count <= MaxRootConstantCount);
+		if (cacheable)
+		{
+			const auto& param = m_RootParameters[index];
+			if (param.Type == ROOT_PARAM_CONSTANTS
+			 && param.Value == (uint64_t(offset) << 32 | count)
+			 && memcmp(param.Constants, pData, sizeof(uint32_t) * count) == 0)
+			{
+				Filter(COMMAND_STATE_ROOT_PARAMETER);
+				return;
+			}
+		}
+
+		m_pCmd->SetGraphicsRoot32BitConstants(index, count, pData, offset);
+		Issue(COMMAND_STATE_ROOT_PARAMETER);
+
+		if (cacheable)
+		{
+			auto& param = m_RootParameters[index];
+			param.Type = ROOT_PARAM_CONSTANTS;
+			param.Value = uint64_t(offset) << 32 | count;
+			memcpy(param.Constants, pData, sizeof(uint32_t) * count);
+		}
+		else if (index < MaxRootParameterCount)
+		{
+			m_RootParameters[index].Type = ROOT_PARAM_NONE;
+		}
+	}
+
+	void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+	{
+		if (m_HasTopology && m_Topology == topology)
+		{
+			Filter(COMMAND_STATE_TOPOLOGY);
+			return;
+		}
+
+		m_pCmd->IASetPrimitiveTopology(topology);
+		m_HasTopology = true;
+		m_Topology = topology;
+		Issue(COMMAND_STATE_TOPOLOGY);
+	}
+
+	void IASetVertexBuffers(UINT startSlot, UINT count, const D3D12_VERTEX_BUFFER_VIEW* pViews)
+	{
+		auto cacheable = (pViews != nullptr && startSlot + count <= MaxVertexBufferCount);
+		if (cacheable)
+		{
+			auto same = true;
+			for (auto i = 0u; i < count && same; ++i)
+			{
+				same = m_VertexBufferValid[startSlot + i] && IsSame(m_VertexBuffers[startSlot + i], pViews[i]);
+			}
+
+			if (same)
+			{
+				Filter(COMMAND_STATE_VERTEX_BUFFER);
+				return;
+			}
+		}
+
+		m_pCmd->IASetVertexBuffers(startSlot, count, pViews);
+		Issue(COMMAND_STATE_VERTEX_BUFFER);
+
+		for (auto i = 0u; i < count && startSlot + i < MaxVertexBufferCount; ++i)
+		{
+			m_VertexBufferValid[startSlot + i] = cacheable;
+			if (cacheable)
+			{
+				m_VertexBuffers[startSlot + i] = pViews[i];
+			}
+		}
+	}
+
+	void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* pView)
+	{
+		if (pView != nullptr && m_HasIndexBuffer && IsSame(m_IndexBuffer, *pView))
+		{
+			Filter(COMMAND_STATE_INDEX_BUFFER);
+			return;
+		}
+
+		m_pCmd->IASetIndexBuffer(pView);
+		m_HasIndexBuffer = (pView != nullptr);
+		if (pView != nullptr)
+		{
+			m_IndexBuffer = *pView;
+		}
+		Issue(COMMAND_STATE_INDEX_BUFFER);
+	}
+
+	void RSSetViewports(UINT count, const D3D12_VIEWPORT* pViewports)
+	{
+		// 1つだけ設定する場合のみ覚える
+		if (count == 1 && m_HasViewport && IsSame(m_Viewport, pViewports[0]))
+		{
+			Filter(COMMAND_STATE_VIEWPORT);
+			return;
+		}
+
+		m_pCmd->RSSetViewports(count, pViewports);
+		m_HasViewport = (count == 1);
+		if (count == 1)
+		{
+			m_Viewport = pViewports[0];
+		}
+		Issue(COMMAND_STATE_VIEWPORT);
+	}
+
+	void RSSetScissorRects(UINT count, const D3D12_RECT* pRects)
+	{
+		if (count == 1 && m_HasScissor && IsSame(m_Scissor, pRects[0]))
+		{
+			Filter(COMMAND_STATE_SCISSOR);
+			return;
+		}
+
+		m_pCmd->RSSetScissorRects(count, pRects);
+		m_HasScissor = (count == 1);
+		if (count == 1)
+		{
+			m_Scissor = pRects[0];
+		}
+		Issue(COMMAND_STATE_SCISSOR);
+	}
+
+	void OMSetRenderTargets(
+		UINT count,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* pRenderTargets,
+		BOOL singleHandleToDescriptorRange,
+		const D3D12_CPU_DESCRIPTOR_HANDLE* pDepthStencil)
+	{
+		// 連続したディスクリプタの指定は覚えない
+		auto cacheable = (!singleHandleToDescriptorRange && count <= MaxRenderTargetCount && (count == 0 || pRenderTargets != nullptr));
+		if (cacheable && m_HasRenderTargets && m_RenderTargetCount == count && m_HasDepthStencil == (pDepthStencil != nullptr))
+		{
+			auto same = (pDepthStencil == nullptr || m_DepthStencil.ptr == pDepthStencil->ptr);
+			for (auto i = 0u; i < count && same; ++i)
+			{
+				same = (m_RenderTargets[i].ptr == pRenderTargets[i].ptr);
+			}
+
+			if (same)
+			{
+				Filter(COMMAND_STATE_RENDER_TARGET);
+				return;
+			}
+		}
+
+		m_pCmd->OMSetRenderTargets(count, pRenderTargets, singleHandleToDescriptorRange, pDepthStencil);
+		Issue(COMMAND_STATE_RENDER_TARGET);
+
+		m_HasRenderTargets = cacheable;
+		if (cacheable)
+		{
+			m_RenderTargetCount = count;
+			for (auto i = 0u; i < count; ++i)
+			{
+				m_RenderTargets[i] = pRenderTargets[i];
+			}
+
+			m_HasDepthStencil = (pDepthStencil != nullptr);
+			m_DepthStencil = (pDepthStencil != nullptr) ? *pDepthStencil : D3D12_CPU_DESCRIPTOR_HANDLE();
+		}
+	}
+
+	void SetDescriptorHeaps(UINT count, ID3D12DescriptorHeap* const* ppHeaps)
+	{
+		if (count <= 2 && m_HasDescriptorHeaps && m_DescriptorHeapCount == count)
+		{
+			auto same = true;
+			for (auto i = 0u; i < count && same; ++i)
+			{
+				same = (m_DescriptorHeaps[i] == ppHeaps[i]);
+			}
+
+			if (same)
+			{
+				Filter(COMMAND_STATE_DESCRIPTOR_HEAP);
+				return;
+			}
+		}
+
+		// ヒープが変わるとディスクリプタテーブルは参照先が変わるので覚え直す
+		m_pCmd->SetDescriptorHeaps(count, ppHeaps);
+		Issue(COMMAND_STATE_DESCRIPTOR_HEAP);
+		InvalidateRootParameters();
+
+		m_HasDescriptorHeaps = (count <= 2);
+		m_DescriptorHeapCount = count;
+		for (auto i = 0u; i < count && i < 2; ++i)
+		{
+			m_DescriptorHeaps[i] = ppHeaps[i];
+		}
+	}
+
+	void DrawInstanced(UINT vertexCount, UINT instanceCount, UINT startVertex, UINT startInstance)
+	{
+		m_pCmd->DrawInstanced(vertexCount, instanceCount, startVertex, startInstance);
+		m_Stats.DrawCount++;
+	}
+
+	void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+	{
+		m_pCmd->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+		m_Stats.DrawCount++;
+	}
+
+	/// <summary>
+	/// 統計値をクリアする
+	/// </summary>
+	void ResetStats() { m_Stats = CommandRecorderStats(); }
+
+	ListType* GetCommandList() const { return m_pCmd; }
+	const CommandRecorderStats& GetStats() const { return m_Stats; }
+
+private:
+	enum ROOT_PARAM_TYPE : uint32_t
+	{
+		ROOT_PARAM_NONE = 0,	// 不明 (次の設定は必ず発行する)
+		ROOT_PARAM_TABLE,		// ディスクリプタテーブル
+		ROOT_PARAM_SRV,			// ルートSRV
+		ROOT_PARAM_CBV,			// ルートCBV
+		ROOT_PARAM_CONSTANTS,	// ルート定数 (Value は開始位置と数)
+	};
+
+	struct RootParameter
+	{
+		ROOT_PARAM_TYPE	Type;								// 種類
+		uint64_t		Value;								// ハンドル, アドレス, またはルート定数の範囲
+		uint32_t		Constants[MaxRootConstantCount];	// ルート定数の値
+	};
+
+	ListType*						m_pCmd;										// 記録先のコマンドリスト
+	ID3D12RootSignature*			m_pRootSignature;							// ルートシグネチャ
+	ID3D12PipelineState*			m_pPipelineState;							// パイプラインステート
+	RootParameter					m_RootParameters[MaxRootParameterCount];	// ルート引数
+	bool							m_HasTopology;								// トポロジーを設定済みかどうか
+	D3D12_PRIMITIVE_TOPOLOGY		m_Topology;									// トポロジー
+	bool							m_VertexBufferValid[MaxVertexBufferCount];	// 頂点バッファを設定済みかどうか
+	D3D12_VERTEX_BUFFER_VIEW		m_VertexBuffers[MaxVertexBufferCount];		// 頂点バッファ
+	bool							m_HasIndexBuffer;							// インデックスバッファを設定済みかどうか
+	D3D12_INDEX_BUFFER_VIEW			m_IndexBuffer;								// インデックスバッファ
+	bool							m_HasViewport;								// ビューポートを設定済みかどうか
+	D3D12_VIEWPORT					m_Viewport;									// ビューポート
+	bool							m_HasScissor;								// シザー矩形を設定済みかどうか
+	D3D12_RECT						m_Scissor;									// シザー矩形
+	bool							m_HasRenderTargets;							// レンダーターゲットを設定済みかどうか
+	uint32_t						m_RenderTargetCount;						// レンダーターゲットの数
+	D3D12_CPU_DESCRIPTOR_HANDLE		m_RenderTargets[MaxRenderTargetCount];		// レンダーターゲット
+	bool							m_HasDepthStencil;							// 深度ステンシルを設定したかどうか
+	D3D12_CPU_DESCRIPTOR_HANDLE		m_DepthStencil;								// 深度ステンシル
+	bool							m_HasDescriptorHeaps;						// ディスクリプタヒープを設定済みかどうか
+	uint32_t						m_DescriptorHeapCount;						// ディスクリプタヒープの数
+	ID3D12DescriptorHeap*			m_DescriptorHeaps[2];						// ディスクリプタヒープ (リソース用とサンプラー用)
+	CommandRecorderStats			m_Stats;									// 統計値
+
+	void InvalidateRootParameters()
+	{
+		for (auto& param : m_RootParameters)
+		{
+			param.Type = ROOT_PARAM_NONE;
+			param.Value = 0;
+		}
+	}
+
+	bool MatchRootParameter(UINT index, ROOT_PARAM_TYPE type, uint64_t value) const
+	{
+		return index < MaxRootParameterCount
+			&& m_RootParameters[index].Type == type
+			&& m_RootParameters[index].Value == value;
+	}
+
+	void StoreRootParameter(UINT index, ROOT_PARAM_TYPE type, uint64_t value)
+	{
+		if (index < MaxRootParameterCount)
+		{
+			m_RootParameters[index].Type = type;
+			m_RootParameters[index].Value = value;
+		}
+	}
+
+	void Issue(COMMAND_STATE_TYPE type) { m_Stats.Issued[type]++; }
+	void Filter(COMMAND_STATE_TYPE type) { m_Stats.Filtered[type]++; }
+
+	static bool IsSame(const D3D12_VERTEX_BUFFER_VIEW& a, const D3D12_VERTEX_BUFFER_VIEW& b)
+	{
+		return a.BufferLocation == b.BufferLocation && a.SizeInBytes == b.SizeInBytes && a.StrideInBytes == b.StrideInBytes;
+	}
+
+	static bool IsSame(const D3D12_INDEX_BUFFER_VIEW& a, const D3D12_INDEX_BUFFER_VIEW& b)
+	{
+		return a.BufferLocation == b.BufferLocation && a.SizeInBytes == b.SizeInBytes && a.Format == b.Format;
+	}
+
+	static bool IsSame(const D3D12_VIEWPORT& a, const D3D12_VIEWPORT& b)
+	{
+		return a.TopLeftX == b.TopLeftX && a.TopLeftY == b.TopLeftY
+			&& a.Width == b.Width && a.Height == b.Height
+			&& a.MinDepth == b.MinDepth && a.MaxDepth == b.MaxDepth;
+	}
+
+	static bool IsSame(const D3D12_RECT& a, const D3D12_RECT& b)
+	{
+		return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+	}
+
+	BasicCommandRecorder(const BasicCommandRecorder&) = delete;
+	void operator=(const BasicCommandRecorder&) = delete;
+};
+
+// コマンドリストに記録するレコーダー
+using CommandRecorder = BasicCommandRecorder<ID3D12GraphicsCommandList>;
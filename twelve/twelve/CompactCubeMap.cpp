@@ -0,0 +1,332 @@
+﻿#include "CompactCubeMap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <DirectXTex.h>
+#include <DirectXPackedVector.h>
+
+#include "BC6HEncoder.h"
+#include "ParallelFor.h"
+#include "Logger.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const double MinBC6HPSNR = 40.0;		// BC6H を採用するPSNRの下限 [dB]
+	const double ReferenceWhite = 100.0;	// 1.0に対応する輝度 [cd/m^2]
+
+	/// <summary>
+	/// 経過時間をミリ秒で取得する
+	/// </summary>
+	double GetElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	/// <summary>
+	/// PQ (SMPTE ST 2084) の逆EOTF
+	/// </summary>
+	double EncodePQ(double nits)
+	{
+		const double m1 = 2610.0 / 16384.0;
+		const double m2 = 2523.0 / 4096.0 * 128.0;
+		const double c1 = 3424.0 / 4096.0;
+		const double c2 = 2413.0 / 4096.0 * 32.0;
+		const double c3 = 2392.0 / 4096.0 * 32.0;
+
+		auto y = std::clamp(nits / 10000.0, 0.0, 1.0);
+		auto p = pow(y, m1);
+		return pow((c1 + c2 * p) / (1.0 + c3 * p), m2);
+	}
+
+	/// <summary>
+	/// BT.709の線形RGBを ICtCp に変換する (Ct は ΔE_ITP 用に0.5倍する)
+	/// </summary>
+	void ToITP(FXMVECTOR rgb, double itp[3])
+	{
+		XMFLOAT4 c;
+		XMStoreFloat4(&c, rgb);
+
+		// BT.709 -> BT.2020
+		auto r = 0.6274 * c.x + 0.3293 * c.y + 0.0433 * c.z;
+		auto g = 0.0691 * c.x + 0.9195 * c.y + 0.0114 * c.z;
+		auto b = 0.0164 * c.x + 0.0880 * c.y + 0.8956 * c.z;
+
+		// BT.2020 -> LMS
+		auto l = (1688.0 * r + 2146.0 * g + 262.0 * b) / 4096.0;
+		auto m = (683.0 * r + 2951.0 * g + 462.0 * b) / 4096.0;
+		auto s = (99.0 * r + 309.0 * g + 3688.0 * b) / 4096.0;
+
+		auto lp = EncodePQ(l * ReferenceWhite);
+		auto mp = EncodePQ(m * ReferenceWhite);
+		auto sp = EncodePQ(s * ReferenceWhite);
+
+		itp[0] = 0.5 * lp + 0.5 * mp;
+		itp[1] = 0.5 * (6610.0 * lp - 13613.0 * mp + 7003.0 * sp) / 4096.0;
+		itp[2] = (17933.0 * lp - 17390.0 * mp - 543.0 * sp) / 4096.0;
+	}
+
+	/// <summary>
+	/// 画像1枚分の誤差の集計値
+	/// </summary>
+	struct ErrorSum
+	{
+		double		SquaredSum = 0.0;
+		double		MaxError = 0.0;
+		double		Peak = 0.0;
+		double		DeltaESum = 0.0;
+		double		MaxDeltaE = 0.0;
+		uint64_t	Count = 0;
+	};
+
+	/// <summary>
+	/// 全ての面とミップの誤差を画像単位で並列に集計する
+	/// </summary>
+	void MeasureError(const CpuCubeMap& reference, const CpuCubeMap& target, CompactCubeMapReport& report, uint32_t threadCount)
+	{
+		std::vector<ErrorSum> sums(reference.Images.size());
+
+		ParallelFor(0, uint32_t(reference.Images.size()), [&](uint32_t index)
+		{
+			const auto& ref = reference.Images[index];
+			const auto& tgt = target.Images[index];
+			auto& sum = sums[index];
+
+			for (size_t i = 0; i < ref.Pixels.size(); ++i)
+			{
+				auto a = XMLoadFloat4(&ref.Pixels[i]);
+				auto b = XMLoadFloat4(&tgt.Pixels[i]);
+
+				XMFLOAT4 fa;
+				XMFLOAT4 diff;
+				XMStoreFloat4(&fa, a);
+				XMStoreFloat4(&diff, XMVectorAbs(XMVectorSubtract(a, b)));
+
+				sum.SquaredSum += double(diff.x) * diff.x + double(diff.y) * diff.y + double(diff.z) * diff.z;
+				sum.MaxError = std::max(sum.MaxError, double(std::max({ diff.x, diff.y, diff.z })));
+				sum.Peak = std::max(sum.Peak, double(std::max({ fa.x, fa.y, fa.z })));
+
+				auto deltaE = CalcDeltaEITP(a, b);
+				sum.DeltaESum += deltaE;
+				sum.MaxDeltaE = std::max(sum.MaxDeltaE, deltaE);
+			}
+
+			sum.Count = ref.Pixels.size();
+		}, threadCount);
+
+		ErrorSum total;
+		for (auto& sum : sums)
+		{
+			total.SquaredSum += sum.SquaredSum;
+			total.MaxError = std::max(total.MaxError, sum.MaxError);
+			total.Peak = std::max(total.Peak, sum.Peak);
+			total.DeltaESum += sum.DeltaESum;
+			total.MaxDeltaE = std::max(total.MaxDeltaE, sum.MaxDeltaE);
+			total.Count += sum.Count;
+		}
+
+		report.Error = ImageError();
+		report.MeanDeltaE = 0.0;
+		report.MaxDeltaE = 0.0;
+		if (total.Count == 0)
+		{
+			return;
+		}
+
+		report.Error.RMSE = sqrt(total.SquaredSum / double(total.Count * 3));
+		report.Error.MaxError = total.MaxError;
+		report.Error.PSNR = (report.Error.RMSE > 0.0)
+			? 20.0 * log10(((total.Peak > 0.0) ? total.Peak : 1.0) / report.Error.RMSE)
+			: std::numeric_limits<double>::infinity();
+		report.MeanDeltaE = total.DeltaESum / double(total.Count);
+		report.MaxDeltaE = total.MaxDeltaE;
+	}
+
+	/// <summary>
+	/// キューブマップのテクセル数を求める
+	/// </summary>
+	uint64_t CountTexels(const CpuCubeMap& cube)
+	{
+		uint64_t count = 0;
+		for (auto& image : cube.Images)
+		{
+			count += uint64_t(image.Width) * image.Height;
+		}
+		return count;
+	}
+
+	/// <summary>
+	/// BC6H のブロック列をDDSファイルに保存する
+	/// </summary>
+	bool SaveBC6HCube(const wchar_t* path, const std::vector<uint8_t>& blocks, uint32_t size, uint32_t mipCount)
+	{
+		ScratchImage scratch;
+		auto hr = scratch.InitializeCube(DXGI_FORMAT_BC6H_UF16, size, size, 1, mipCount);
+		if (FAILED(hr))
+		{
+			ELOG("Error : ScratchImage::InitializeCube() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		// ブロック列は Images と同じ (面, ミップ) の順に並んでいる
+		size_t offset = 0;
+		for (auto face = 0u; face < 6; ++face)
+		{
+			auto w = size;
+			for (auto mip = 0u; mip < mipCount; ++mip)
+			{
+				auto pImage = scratch.GetImage(mip, face, 0);
+				auto rowBytes = size_t((w + 3) / 4) * BC6HBlockSize;
+				auto rowCount = (w + 3) / 4;
+
+				for (auto row = 0u; row < rowCount; ++row)
+				{
+					memcpy(pImage->pixels + pImage->rowPitch * row, blocks.data() + offset, rowBytes);
+					offset += rowBytes;
+				}
+
+				w = (w > 1) ? (w >> 1) : 1;
+			}
+		}
+
+		hr = SaveToDDSFile(
+			scratch.GetImages(),
+			scratch.GetImageCount(),
+			scratch.GetMetadata(),
+			DDS_FLAGS_NONE,
+			path);
+		if (FAILED(hr))
+		{
+			ELOG("Error : DirectX::SaveToDDSFile() Failed. path = %ls, retcode = 0x%x", path, hr);
+			return false;
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// DXGIフォーマットの表示名
+	/// </summary>
+	const char* GetFormatName(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC6H_UF16:				return "BC6H_UF16";
+		case DXGI_FORMAT_R11G11B10_FLOAT:		return "R11G11B10_FLOAT";
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:	return "R16G16B16A16_FLOAT";
+		default:								return "UNKNOWN";
+		}
+	}
+}
+
+double CalcDeltaEITP(FXMVECTOR reference, FXMVECTOR target)
+{
+	double a[3];
+	double b[3];
+	ToITP(reference, a);
+	ToITP(target, b);
+
+	auto di = a[0] - b[0];
+	auto dt = a[1] - b[1];
+	auto dp = a[2] - b[2];
+	return 720.0 * sqrt(di * di + dt * dt + dp * dp);
+}
+
+bool SaveCubeMapCompact(const wchar_t* path, const CpuCubeMap& cube, CompactCubeMapReport* pReport, uint32_t threadCount)
+{
+	if (path == nullptr || cube.Size == 0 || cube.MipCount == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	auto texelCount = CountTexels(cube);
+
+	CompactCubeMapReport report;
+	report.SourceBytes = texelCount * 8;
+
+	// BC6H は最上位ミップの横幅が4の倍数である必要がある
+	if (cube.Size % 4 == 0)
+	{
+		std::vector<uint8_t> blocks;
+		EncodeBC6HCube(cube, blocks, threadCount);
+
+		CpuCubeMap decoded;
+		if (DecodeBC6HCube(blocks, cube.Size, cube.MipCount, decoded))
+		{
+			MeasureError(cube, decoded, report, threadCount);
+
+			if (report.Error.PSNR >= MinBC6HPSNR)
+			{
+				report.Format = DXGI_FORMAT_BC6H_UF16;
+				report.CompactBytes = blocks.size();
+				report.EncodeTime = GetElapsedMilliseconds(start);
+
+				if (!SaveBC6HCube(path, blocks, cube.Size, cube.MipCount))
+				{
+					return false;
+				}
+
+				if (pReport != nullptr)
+				{
+					*pReport = report;
+				}
+				return true;
+			}
+
+			ILOG("CompactCubeMap : BC6H rejected. PSNR = %.2f dB (< %.1f dB)", report.Error.PSNR, MinBC6HPSNR);
+		}
+	}
+
+	// R11G11B10_FLOAT で保存する (誤差の計測用に同じ量子化を施したものを作る)
+	CpuCubeMap packed = cube;
+	ParallelFor(0, uint32_t(packed.Images.size()), [&](uint32_t index)
+	{
+		for (auto& pixel : packed.Images[index].Pixels)
+		{
+			PackedVector::XMFLOAT3PK value;
+			PackedVector::XMStoreFloat3PK(&value, XMLoadFloat4(&pixel));
+			XMStoreFloat4(&pixel, PackedVector::XMLoadFloat3PK(&value));
+		}
+	}, threadCount);
+
+	MeasureError(cube, packed, report, threadCount);
+
+	report.Format = DXGI_FORMAT_R11G11B10_FLOAT;
+	report.CompactBytes = texelCount * 4;
+	report.EncodeTime = GetElapsedMilliseconds(start);
+
+	if (!SaveCubeMapToDDS(path, cube, DXGI_FORMAT_R11G11B10_FLOAT))
+	{
+		return false;
+	}
+
+	if (pReport != nullptr)
+	{
+		*pReport = report;
+	}
+	return true;
+}
+
+void LogCompactCubeMapReport(const wchar_t* name, const CompactCubeMapReport& report)
+{
+	auto saved = double(report.SourceBytes) - double(report.CompactBytes);
+	auto ratio = (report.SourceBytes > 0) ? 100.0 * saved / double(report.SourceBytes) : 0.0;
+
+	ILOG("CompactCubeMap : %ls -> %s", name, GetFormatName(report.Format));
+	ILOG("  Memory  %.2f MB (RGBA16F) -> %.2f MB, %.2f MB saved (%.1f%%)",
+		double(report.SourceBytes) / (1024.0 * 1024.0),
+		double(report.CompactBytes) / (1024.0 * 1024.0),
+		saved / (1024.0 * 1024.0),
+		ratio);
+	ILOG("  Error   RMSE = %.6f, MaxError = %.6f, PSNR = %.2f dB, dE_ITP mean = %.3f, max = %.3f",
+		report.Error.RMSE, report.Error.MaxError, report.Error.PSNR, report.MeanDeltaE, report.MaxDeltaE);
+	ILOG("  Time    %.3f ms", report.EncodeTime);
+}
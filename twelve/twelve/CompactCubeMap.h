@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include "CubeMapUtil.h"
+
+/// <summary>
+/// HDRキューブマップを圧縮フォーマットで保存した結果
+/// </summary>
+struct CompactCubeMapReport
+{
+	DXGI_FORMAT	Format = DXGI_FORMAT_UNKNOWN;	// 保存したフォーマット
+	uint64_t	SourceBytes = 0;				// RGBA16F で保存した場合のバイト数
+	uint64_t	CompactBytes = 0;				// 保存したフォーマットでのバイト数
+	ImageError	Error;							// 全ての面とミップをまとめたRGB成分の誤差
+	double		MeanDeltaE = 0.0;				// ΔE_ITP の平均
+	double		MaxDeltaE = 0.0;				// ΔE_ITP の最大
+	double		EncodeTime = 0.0;				// 圧縮と誤差の計測にかかった時間 [ms]
+};
+
+/// <summary>
+/// 2色の色差 ΔE_ITP (ITU-R BT.2124) を求める
+/// 入力はBT.709の線形RGBで, 1.0を 100 cd/m^2 として扱う
+/// </summary>
+/// <param name="reference">基準色</param>
+/// <param name="target">比較する色</param>
+/// <returns>色差 (1でおおよそ知覚できる差)</returns>
+double CalcDeltaEITP(DirectX::FXMVECTOR reference, DirectX::FXMVECTOR target);
+
+/// <summary>
+/// HDRキューブマップを BC6H_UF16 で圧縮してDDSファイルに保存する
+/// 1面の横幅が4の倍数でない場合や, 圧縮後のPSNRが基準に満たない場合は R11G11B10_FLOAT で保存する
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="cube">キューブマップ</param>
+/// <param name="pReport">保存結果の格納先 (nullptrの場合は格納しない)</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+/// <returns>保存に成功した場合はtrue</returns>
+bool SaveCubeMapCompact(const wchar_t* path, const CpuCubeMap& cube, CompactCubeMapReport* pReport = nullptr, uint32_t threadCount = 0);
+
+/// <summary>
+/// 保存結果 (フォーマット, 削減したメモリ量, 誤差) をログに出力する
+/// </summary>
+/// <param name="name">ログに表示する名前</param>
+/// <param name="report">保存結果</param>
+void LogCompactCubeMapReport(const wchar_t* name, const CompactCubeMapReport& report);
@@ -11,8 +11,11 @@ namespace Constants
 	/*const unsigned int WindowWidth = 960;
 	const unsigned int WindowHeight = 540;*/
 
-	// フレームバッファ数
-	static const uint32_t FrameCount = 2;
+	// フレームバッファ数 (同時に処理するフレーム数) の範囲と既定値
+	// フレームごとのリソースは最大数で確保し, 実際の数は起動時に選ぶ
+	static const uint32_t MinFrameCount = 2;
+	static const uint32_t MaxFrameCount = 4;
+	static const uint32_t DefaultFrameCount = 2;
 }  // namespace Constants
 
 #endif  // CONSTANTS_H
@@ -0,0 +1,296 @@
+﻿#include "CubeMapImage.h"
+
+#include <cmath>
+#include <limits>
+
+#include "ParallelFor.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 誤差の集計値
+	/// </summary>
+	struct ErrorAccumulator
+	{
+		double SquaredSum = 0.0;
+		double MaxError = 0.0;
+		double Peak = 0.0;
+		size_t Count = 0;
+
+		/// <summary>
+		/// 画像1枚分の誤差を加算する
+		/// </summary>
+		void Add(const CpuImage& reference, const CpuImage& target)
+		{
+			for (size_t i = 0; i < reference.Pixels.size(); ++i)
+			{
+				const float* r = &reference.Pixels[i].x;
+				const float* t = &target.Pixels[i].x;
+
+				for (auto c = 0; c < 3; ++c)
+				{
+					auto diff = fabs(double(r[c]) - double(t[c]));
+					SquaredSum += diff * diff;
+					MaxError = (diff > MaxError) ? diff : MaxError;
+					Peak = (double(r[c]) > Peak) ? double(r[c]) : Peak;
+				}
+			}
+
+			Count += reference.Pixels.size() * 3;
+		}
+
+		/// <summary>
+		/// 統計値を求める
+		/// </summary>
+		ImageError GetResult() const
+		{
+			ImageError result;
+			if (Count == 0)
+			{
+				return result;
+			}
+
+			result.RMSE = sqrt(SquaredSum / double(Count));
+			result.MaxError = MaxError;
+			result.PSNR = (result.RMSE > 0.0)
+				? 20.0 * log10(((Peak > 0.0) ? Peak : 1.0) / result.RMSE)
+				: std::numeric_limits<double>::infinity();
+
+			return result;
+		}
+	};
+}
+
+void CpuImage::Resize(uint32_t width, uint32_t height)
+{
+	Width = width;
+	Height = height;
+	Pixels.resize(size_t(width) * height);
+}
+
+void CpuCubeMap::Resize(uint32_t size, uint32_t mipCount)
+{
+	Size = size;
+	MipCount = mipCount;
+	Images.resize(6 * size_t(mipCount));
+
+	for (auto face = 0u; face < 6; ++face)
+	{
+		auto w = size;
+		for (auto mip = 0u; mip < mipCount; ++mip)
+		{
+			GetImage(face, mip).Resize(w, w);
+			w = (w > 1) ? (w >> 1) : 1;
+		}
+	}
+}
+
+uint32_t CalcMipCount(uint32_t size)
+{
+	uint32_t result = 1;
+	while (size > 1)
+	{
+		size >>= 1;
+		result++;
+	}
+
+	return result;
+}
+
+XMVECTOR CalcCubeDirection(uint32_t face, float u, float v)
+{
+	auto x = u * 2.0f - 1.0f;
+	auto y = 1.0f - v * 2.0f;
+
+	XMVECTOR dir;
+	switch (face)
+	{
+		case 0: { dir = XMVectorSet( 1.0f,  y,   -x,     0.0f); } break;
+		case 1: { dir = XMVectorSet(-1.0f,  y,    x,     0.0f); } break;
+		case 2: { dir = XMVectorSet( x,     1.0f, -y,    0.0f); } break;
+		case 3: { dir = XMVectorSet( x,    -1.0f,  y,    0.0f); } break;
+		case 4: { dir = XMVectorSet( x,     y,    1.0f,  0.0f); } break;
+		default: { dir = XMVectorSet(-x,    y,   -1.0f,  0.0f); } break;
+	}
+
+	return XMVector3Normalize(dir);
+}
+
+void CalcCubeFaceUV(FXMVECTOR dir, uint32_t& face, float& u, float& v)
+{
+	XMFLOAT3 d;
+	XMStoreFloat3(&d, dir);
+
+	auto ax = fabsf(d.x);
+	auto ay = fabsf(d.y);
+	auto az = fabsf(d.z);
+
+	float ma, sc, tc;
+	if (ax >= ay && ax >= az)
+	{
+		face = (d.x >= 0.0f) ? 0 : 1;
+		ma = ax;
+		sc = (d.x >= 0.0f) ? -d.z : d.z;
+		tc = -d.y;
+	}
+	else if (ay >= az)
+	{
+		face = (d.y >= 0.0f) ? 2 : 3;
+		ma = ay;
+		sc = d.x;
+		tc = (d.y >= 0.0f) ? d.z : -d.z;
+	}
+	else
+	{
+		face = (d.z >= 0.0f) ? 4 : 5;
+		ma = az;
+		sc = (d.z >= 0.0f) ? d.x : -d.x;
+		tc = -d.y;
+	}
+
+	auto invMa = (ma > 0.0f) ? (1.0f / ma) : 0.0f;
+	u = 0.5f * (sc * invMa + 1.0f);
+	v = 0.5f * (tc * invMa + 1.0f);
+}
+
+XMVECTOR SampleBilinear(const CpuImage& image, float u, float v, bool wrapU)
+{
+	auto w = int(image.Width);
+	auto h = int(image.Height);
+
+	// テクセル中心を基準とした座標に変換
+	auto fx = u * float(w) - 0.5f;
+	auto fy = v * float(h) - 0.5f;
+
+	auto x0 = int(floorf(fx));
+	auto y0 = int(floorf(fy));
+	auto tx = fx - float(x0);
+	auto ty = fy - float(y0);
+
+	auto x1 = x0 + 1;
+	auto y1 = y0 + 1;
+
+	if (wrapU)
+	{
+		x0 = ((x0 % w) + w) % w;
+		x1 = ((x1 % w) + w) % w;
+	}
+	else
+	{
+		x0 = (x0 < 0) ? 0 : ((x0 >= w) ? w - 1 : x0);
+		x1 = (x1 < 0) ? 0 : ((x1 >= w) ? w - 1 : x1);
+	}
+
+	y0 = (y0 < 0) ? 0 : ((y0 >= h) ? h - 1 : y0);
+	y1 = (y1 < 0) ? 0 : ((y1 >= h) ? h - 1 : y1);
+
+	auto row0 = image.GetRow(uint32_t(y0));
+	auto row1 = image.GetRow(uint32_t(y1));
+
+	auto c00 = XMLoadFloat4(&row0[x0]);
+	auto c10 = XMLoadFloat4(&row0[x1]);
+	auto c01 = XMLoadFloat4(&row1[x0]);
+	auto c11 = XMLoadFloat4(&row1[x1]);
+
+	auto c0 = XMVectorLerp(c00, c10, tx);
+	auto c1 = XMVectorLerp(c01, c11, tx);
+
+	return XMVectorLerp(c0, c1, ty);
+}
+
+XMVECTOR SampleCube(const CpuCubeMap& cube, FXMVECTOR dir, float lod)
+{
+	uint32_t face;
+	float u, v;
+	CalcCubeFaceUV(dir, face, u, v);
+
+	auto maxLod = float(cube.MipCount - 1);
+	lod = (lod < 0.0f) ? 0.0f : ((lod > maxLod) ? maxLod : lod);
+
+	auto mip0 = uint32_t(lod);
+	auto mip1 = (mip0 + 1 < cube.MipCount) ? mip0 + 1 : mip0;
+	auto t = lod - float(mip0);
+
+	auto c0 = SampleBilinear(cube.GetImage(face, mip0), u, v, false);
+	if (t <= 0.0f || mip0 == mip1)
+	{
+		return c0;
+	}
+
+	auto c1 = SampleBilinear(cube.GetImage(face, mip1), u, v, false);
+	return XMVectorLerp(c0, c1, t);
+}
+
+void GenerateCubeMips(CpuCubeMap& cube)
+{
+	const auto quarter = XMVectorReplicate(0.25f);
+
+	for (auto mip = 1u; mip < cube.MipCount; ++mip)
+	{
+		auto size = cube.GetImage(0, mip).Width;
+
+		// 面と行単位で並列化
+		ParallelFor(0, 6 * size, [&](uint32_t index)
+		{
+			auto face = index / size;
+			auto y = index % size;
+
+			const auto& src = cube.GetImage(face, mip - 1);
+			auto& dst = cube.GetImage(face, mip);
+
+			auto sy0 = (y * 2 < src.Height) ? y * 2 : src.Height - 1;
+			auto sy1 = (y * 2 + 1 < src.Height) ? y * 2 + 1 : src.Height - 1;
+
+			auto srcRow0 = src.GetRow(sy0);
+			auto srcRow1 = src.GetRow(sy1);
+			auto dstRow = dst.GetRow(y);
+
+			for (auto x = 0u; x < dst.Width; ++x)
+			{
+				auto sx0 = (x * 2 < src.Width) ? x * 2 : src.Width - 1;
+				auto sx1 = (x * 2 + 1 < src.Width) ? x * 2 + 1 : src.Width - 1;
+
+				auto c = XMVectorAdd(
+					XMVectorAdd(XMLoadFloat4(&srcRow0[sx0]), XMLoadFloat4(&srcRow0[sx1])),
+					XMVectorAdd(XMLoadFloat4(&srcRow1[sx0]), XMLoadFloat4(&srcRow1[sx1])));
+
+				XMStoreFloat4(&dstRow[x], XMVectorMultiply(c, quarter));
+			}
+		});
+	}
+}
+
+ImageError CompareImages(const CpuImage& reference, const CpuImage& target)
+{
+	if (reference.Width != target.Width || reference.Height != target.Height)
+	{
+		ImageError result;
+		result.RMSE = -1.0;
+		return result;
+	}
+
+	ErrorAccumulator acc;
+	acc.Add(reference, target);
+
+	return acc.GetResult();
+}
+
+ImageError CompareCubeMaps(const CpuCubeMap& reference, const CpuCubeMap& target, uint32_t mip)
+{
+	if (reference.Size != target.Size || mip >= reference.MipCount || mip >= target.MipCount)
+	{
+		ImageError result;
+		result.RMSE = -1.0;
+		return result;
+	}
+
+	ErrorAccumulator acc;
+	for (auto face = 0u; face < 6; ++face)
+	{
+		acc.Add(reference.GetImage(face, mip), target.GetImage(face, mip));
+	}
+
+	return acc.GetResult();
+}
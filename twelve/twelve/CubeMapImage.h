@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+/// <summary>
+/// CPU側で扱う浮動小数点画像 (RGBA32F)
+/// </summary>
+struct CpuImage
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<DirectX::XMFLOAT4> Pixels;
+
+	/// <summary>
+	/// 画像サイズを変更する
+	/// </summary>
+	/// <param name="width">横幅</param>
+	/// <param name="height">縦幅</param>
+	void Resize(uint32_t width, uint32_t height);
+
+	DirectX::XMFLOAT4* GetRow(uint32_t y) { return Pixels.data() + size_t(y) * Width; }
+	const DirectX::XMFLOAT4* GetRow(uint32_t y) const { return Pixels.data() + size_t(y) * Width; }
+};
+
+/// <summary>
+/// CPU側で扱うキューブマップ
+/// 画像は Images[face * MipCount + mip] の順に格納する (DDSの並びと同じ)
+/// </summary>
+struct CpuCubeMap
+{
+	uint32_t Size = 0;
+	uint32_t MipCount = 0;
+	std::vector<CpuImage> Images;
+
+	/// <summary>
+	/// キューブマップのサイズを変更する
+	/// </summary>
+	/// <param name="size">1面の横幅</param>
+	/// <param name="mipCount">ミップレベル数</param>
+	void Resize(uint32_t size, uint32_t mipCount);
+
+	CpuImage& GetImage(uint32_t face, uint32_t mip) { return Images[face * MipCount + mip]; }
+	const CpuImage& GetImage(uint32_t face, uint32_t mip) const { return Images[face * MipCount + mip]; }
+};
+
+/// <summary>
+/// 画像の誤差の統計値
+/// </summary>
+struct ImageError
+{
+	double RMSE = 0.0;		// 二乗平均平方根誤差
+	double MaxError = 0.0;	// 最大絶対誤差
+	double PSNR = 0.0;		// ピーク信号対雑音比 [dB] (ピークは基準画像の最大値)
+};
+
+/// <summary>
+/// 1x1まで縮小した場合のミップレベル数を計算する
+/// </summary>
+/// <param name="size">最大ミップの横幅</param>
+/// <returns>ミップレベル数</returns>
+uint32_t CalcMipCount(uint32_t size);
+
+/// <summary>
+/// キューブマップの面とテクスチャ座標から方向ベクトルを求める
+/// BakeUtil.hlsli の CalcDirection() と同じ規約 (D3Dのキューブマップ規約)
+/// </summary>
+/// <param name="face">面番号 (+X, -X, +Y, -Y, +Z, -Z)</param>
+/// <param name="u">テクスチャ座標U [0, 1]</param>
+/// <param name="v">テクスチャ座標V [0, 1]</param>
+/// <returns>正規化された方向ベクトル</returns>
+DirectX::XMVECTOR CalcCubeDirection(uint32_t face, float u, float v);
+
+/// <summary>
+/// 方向ベクトルからキューブマップの面とテクスチャ座標を求める
+/// </summary>
+/// <param name="dir">方向ベクトル (正規化されていなくてもよい)</param>
+/// <param name="face">面番号の格納先</param>
+/// <param name="u">テクスチャ座標Uの格納先</param>
+/// <param name="v">テクスチャ座標Vの格納先</param>
+void CalcCubeFaceUV(DirectX::FXMVECTOR dir, uint32_t& face, float& u, float& v);
+
+/// <summary>
+/// バイリニア補間でサンプリングする
+/// </summary>
+/// <param name="image">画像</param>
+/// <param name="u">テクスチャ座標U</param>
+/// <param name="v">テクスチャ座標V</param>
+/// <param name="wrapU">U方向をラップするかどうか (falseの場合はクランプ)</param>
+/// <returns>サンプリング結果</returns>
+DirectX::XMVECTOR SampleBilinear(const CpuImage& image, float u, float v, bool wrapU);
+
+/// <summary>
+/// キューブマップをトライリニア補間でサンプリングする
+/// 面の境界は面内でクランプする
+/// </summary>
+/// <param name="cube">キューブマップ</param>
+/// <param name="dir">方向ベクトル</param>
+/// <param name="lod">ミップレベル</param>
+/// <returns>サンプリング結果</returns>
+DirectX::XMVECTOR SampleCube(const CpuCubeMap& cube, DirectX::FXMVECTOR dir, float lod);
+
+/// <summary>
+/// ミップレベル0から下位のミップマップを2x2ボックスフィルタで生成する
+/// </summary>
+/// <param name="cube">キューブマップ</param>
+void GenerateCubeMips(CpuCubeMap& cube);
+
+/// <summary>
+/// 2枚の画像のRGB成分の誤差を求める
+/// </summary>
+/// <param name="reference">基準画像</param>
+/// <param name="target">比較する画像</param>
+/// <returns>誤差の統計値 (サイズが異なる場合はRMSEが負の値)</returns>
+ImageError CompareImages(const CpuImage& reference, const CpuImage& target);
+
+/// <summary>
+/// 2つのキューブマップの指定ミップレベルについて, 6面まとめたRGB成分の誤差を求める
+/// </summary>
+/// <param name="reference">基準キューブマップ</param>
+/// <param name="target">比較するキューブマップ</param>
+/// <param name="mip">ミップレベル</param>
+/// <returns>誤差の統計値 (サイズが異なる場合はRMSEが負の値)</returns>
+ImageError CompareCubeMaps(const CpuCubeMap& reference, const CpuCubeMap& target, uint32_t mip);
@@ -0,0 +1,369 @@
+﻿#include "CubeMapUtil.h"
+
+#include <cstring>
+#include <string>
+#include <DirectXTex.h>
+#include <DirectXPackedVector.h>
+
+#include "HDRImageLoader.h"
+#include "Logger.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// ファイルパスの拡張子を小文字で取得する
+	/// </summary>
+	std::wstring GetExtension(const wchar_t* path)
+	{
+		std::wstring result(path);
+		auto pos = result.find_last_of(L'.');
+		if (pos == std::wstring::npos)
+		{
+			return std::wstring();
+		}
+
+		result = result.substr(pos + 1);
+		for (auto& c : result) { c = towlower(c); }
+
+		return result;
+	}
+
+	/// <summary>
+	/// RGBA32F の DirectXTex 画像を CpuImage にコピーする
+	/// </summary>
+	void CopyFromImage(const Image& src, CpuImage& dst)
+	{
+		dst.Resize(uint32_t(src.width), uint32_t(src.height));
+
+		for (auto y = 0u; y < dst.Height; ++y)
+		{
+			memcpy(dst.GetRow(y), src.pixels + src.rowPitch * y, sizeof(XMFLOAT4) * dst.Width);
+		}
+	}
+
+	/// <summary>
+	/// CpuImage を RGBA32F の DirectXTex 画像にコピーする
+	/// </summary>
+	void CopyToImage(const CpuImage& src, const Image& dst)
+	{
+		for (auto y = 0u; y < src.Height; ++y)
+		{
+			memcpy(dst.pixels + dst.rowPitch * y, src.GetRow(y), sizeof(XMFLOAT4) * src.Width);
+		}
+	}
+
+	/// <summary>
+	/// 必要に応じてフォーマットを変換 (ブロック圧縮) してDDSファイルに保存する
+	/// </summary>
+	bool SaveScratchImage(const wchar_t* path, const ScratchImage& image, DXGI_FORMAT format)
+	{
+		const ScratchImage* pSave = &image;
+
+		ScratchImage converted;
+		if (IsCompressed(format))
+		{
+			auto hr = Compress(
+				image.GetImages(),
+				image.GetImageCount(),
+				image.GetMetadata(),
+				format,
+				TEX_COMPRESS_PARALLEL,
+				TEX_THRESHOLD_DEFAULT,
+				converted);
+			if (FAILED(hr))
+			{
+				ELOG("Error : DirectX::Compress() Failed. retcode = 0x%x", hr);
+				return false;
+			}
+
+			pSave = &converted;
+		}
+		else if (format != image.GetMetadata().format)
+		{
+			auto hr = Convert(
+				image.GetImages(),
+				image.GetImageCount(),
+				image.GetMetadata(),
+				format,
+				TEX_FILTER_DEFAULT,
+				TEX_THRESHOLD_DEFAULT,
+				converted);
+			if (FAILED(hr))
+			{
+				ELOG("Error : DirectX::Convert() Failed. retcode = 0x%x", hr);
+				return false;
+			}
+
+			pSave = &converted;
+		}
+
+		auto hr = SaveToDDSFile(
+			pSave->GetImages(),
+			pSave->GetImageCount(),
+			pSave->GetMetadata(),
+			DDS_FLAGS_NONE,
+			path);
+		if (FAILED(hr))
+		{
+			ELOG("Error : DirectX::SaveToDDSFile() Failed. path = %ls, retcode = 0x%x", path, hr);
+			return false;
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// 圧縮の展開とフォーマット変換を行い RGBA32F にする
+	/// </summary>
+	bool ConvertToRGBA32F(ScratchImage& image)
+	{
+		if (IsCompressed(image.GetMetadata().format))
+		{
+			ScratchImage decompressed;
+			auto hr = Decompress(
+				image.GetImages(),
+				image.GetImageCount(),
+				image.GetMetadata(),
+				DXGI_FORMAT_R32G32B32A32_FLOAT,
+				decompressed);
+			if (FAILED(hr))
+			{
+				ELOG("Error : DirectX::Decompress() Failed. retcode = 0x%x", hr);
+				return false;
+			}
+
+			image = std::move(decompressed);
+		}
+
+		if (image.GetMetadata().format != DXGI_FORMAT_R32G32B32A32_FLOAT)
+		{
+			ScratchImage converted;
+			auto hr = Convert(
+				image.GetImages(),
+				image.GetImageCount(),
+				image.GetMetadata(),
+				DXGI_FORMAT_R32G32B32A32_FLOAT,
+				TEX_FILTER_DEFAULT,
+				TEX_THRESHOLD_DEFAULT,
+				converted);
+			if (FAILED(hr))
+			{
+				ELOG("Error : DirectX::Convert() Failed. retcode = 0x%x", hr);
+				return false;
+			}
+
+			image = std::move(converted);
+		}
+
+		return true;
+	}
+}
+
+bool LoadImageRGBA32F(const wchar_t* path, CpuImage& image)
+{
+	if (path == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	// .hdr / .exr は独自のデコーダーで並列に復号する
+	if (IsHDRImageFile(path))
+	{
+		CpuImageHalf half;
+		if (!LoadHDRImage(path, half))
+		{
+			return false;
+		}
+
+		image.Resize(half.Width, half.Height);
+		PackedVector::XMConvertHalfToFloatStream(
+			reinterpret_cast<float*>(image.Pixels.data()),
+			sizeof(float),
+			half.Pixels.data(),
+			sizeof(uint16_t),
+			half.Pixels.size());
+		return true;
+	}
+
+	auto ext = GetExtension(path);
+
+	TexMetadata metadata = {};
+	ScratchImage scratch;
+	HRESULT hr = S_OK;
+
+	if (ext == L"dds")
+	{
+		hr = LoadFromDDSFile(path, DDS_FLAGS_NONE, &metadata, scratch);
+	}
+	else
+	{
+		hr = LoadFromWICFile(path, WIC_FLAGS_NONE, &metadata, scratch);
+	}
+
+	if (FAILED(hr))
+	{
+		ELOG("Error : Image Load Failed. path = %ls, retcode = 0x%x", path, hr);
+		return false;
+	}
+
+	if (!ConvertToRGBA32F(scratch))
+	{
+		return false;
+	}
+
+	CopyFromImage(*scratch.GetImage(0, 0, 0), image);
+	return true;
+}
+
+bool SaveImageToDDS(const wchar_t* path, const CpuImage& image, DXGI_FORMAT format)
+{
+	if (path == nullptr || image.Width == 0 || image.Height == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	ScratchImage scratch;
+	auto hr = scratch.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, image.Width, image.Height, 1, 1);
+	if (FAILED(hr))
+	{
+		ELOG("Error : ScratchImage::Initialize2D() Failed. retcode = 0x%x", hr);
+		return false;
+	}
+
+	CopyToImage(image, *scratch.GetImage(0, 0, 0));
+
+	return SaveScratchImage(path, scratch, format);
+}
+
+bool SaveMipChainToDDS(const wchar_t* path, const std::vector<CpuImage>& mips, DXGI_FORMAT format)
+{
+	if (path == nullptr || mips.empty() || mips[0].Width == 0 || mips[0].Height == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	ScratchImage scratch;
+	auto hr = scratch.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, mips[0].Width, mips[0].Height, 1, mips.size());
+	if (FAILED(hr))
+	{
+		ELOG("Error : ScratchImage::Initialize2D() Failed. retcode = 0x%x", hr);
+		return false;
+	}
+
+	for (size_t mip = 0; mip < mips.size(); ++mip)
+	{
+		const auto& dst = *scratch.GetImage(mip, 0, 0);
+		if (dst.width != mips[mip].Width || dst.height != mips[mip].Height)
+		{
+			ELOG("Error : Invalid Mip Size. mip = %zu", mip);
+			return false;
+		}
+
+		CopyToImage(mips[mip], dst);
+	}
+
+	return SaveScratchImage(path, scratch, format);
+}
+
+bool SaveCubeMapToDDS(const wchar_t* path, const CpuCubeMap& cube, DXGI_FORMAT format)
+{
+	if (path == nullptr || cube.Size == 0 || cube.MipCount == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	ScratchImage scratch;
+	auto hr = scratch.InitializeCube(DXGI_FORMAT_R32G32B32A32_FLOAT, cube.Size, cube.Size, 1, cube.MipCount);
+	if (FAILED(hr))
+	{
+		ELOG("Error : ScratchImage::InitializeCube() Failed. retcode = 0x%x", hr);
+		return false;
+	}
+
+	for (auto face = 0u; face < 6; ++face)
+	{
+		for (auto mip = 0u; mip < cube.MipCount; ++mip)
+		{
+			CopyToImage(cube.GetImage(face, mip), *scratch.GetImage(mip, face, 0));
+		}
+	}
+
+	return SaveScratchImage(path, scratch, format);
+}
+
+bool LoadCubeMapFromDDS(const wchar_t* path, CpuCubeMap& cube)
+{
+	if (path == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	TexMetadata metadata = {};
+	ScratchImage scratch;
+
+	auto hr = LoadFromDDSFile(path, DDS_FLAGS_NONE, &metadata, scratch);
+	if (FAILED(hr))
+	{
+		ELOG("Error : DirectX::LoadFromDDSFile() Failed. path = %ls, retcode = 0x%x", path, hr);
+		return false;
+	}
+
+	if (!LoadFromScratchImage(scratch, cube))
+	{
+		ELOG("Error : LoadFromScratchImage() Failed. path = %ls", path);
+		return false;
+	}
+
+	return true;
+}
+
+bool LoadFromScratchImage(ScratchImage& image, CpuImage& result)
+{
+	if (image.GetImageCount() == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	if (!ConvertToRGBA32F(image))
+	{
+		return false;
+	}
+
+	CopyFromImage(*image.GetImage(0, 0, 0), result);
+	return true;
+}
+
+bool LoadFromScratchImage(ScratchImage& image, CpuCubeMap& result)
+{
+	const auto& metadata = image.GetMetadata();
+	if (!metadata.IsCubemap() || metadata.width != metadata.height)
+	{
+		ELOG("Error : Not Cube Map.");
+		return false;
+	}
+
+	if (!ConvertToRGBA32F(image))
+	{
+		return false;
+	}
+
+	result.Resize(uint32_t(metadata.width), uint32_t(metadata.mipLevels));
+
+	for (auto face = 0u; face < 6; ++face)
+	{
+		for (auto mip = 0u; mip < result.MipCount; ++mip)
+		{
+			CopyFromImage(*image.GetImage(mip, face, 0), result.GetImage(face, mip));
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <dxgiformat.h>
+#include <DirectXMath.h>
+
+#include "CubeMapImage.h"
+
+namespace DirectX
+{
+	class ScratchImage;
+}
+
+/// <summary>
+/// 画像ファイルを読み込み RGBA32F に変換する (DDS / HDR / WIC形式)
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="image">画像の格納先</param>
+/// <returns>読み込みに成功した場合はtrue</returns>
+bool LoadImageRGBA32F(const wchar_t* path, CpuImage& image);
+
+/// <summary>
+/// 画像をDDSファイルに保存する
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="image">画像</param>
+/// <param name="format">保存するフォーマット</param>
+/// <returns>保存に成功した場合はtrue</returns>
+bool SaveImageToDDS(const wchar_t* path, const CpuImage& image, DXGI_FORMAT format);
+
+/// <summary>
+/// ミップマップを持つ画像をDDSファイルに保存する
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="mips">ミップマップ (各ミップは上位ミップの半分のサイズ)</param>
+/// <param name="format">保存するフォーマット (ブロック圧縮フォーマットの場合は圧縮する)</param>
+/// <returns>保存に成功した場合はtrue</returns>
+bool SaveMipChainToDDS(const wchar_t* path, const std::vector<CpuImage>& mips, DXGI_FORMAT format);
+
+/// <summary>
+/// キューブマップをDDSファイルに保存する
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="cube">キューブマップ</param>
+/// <param name="format">保存するフォーマット</param>
+/// <returns>保存に成功した場合はtrue</returns>
+bool SaveCubeMapToDDS(const wchar_t* path, const CpuCubeMap& cube, DXGI_FORMAT format);
+
+/// <summary>
+/// キューブマップをDDSファイルから読み込み RGBA32F に変換する
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="cube">キューブマップの格納先</param>
+/// <returns>読み込みに成功した場合はtrue</returns>
+bool LoadCubeMapFromDDS(const wchar_t* path, CpuCubeMap& cube);
+
+/// <summary>
+/// DirectXTex の画像を RGBA32F に変換して CpuImage に格納する (変換は image 上で行う)
+/// </summary>
+/// <param name="image">画像 (先頭の画像のみ使用する)</param>
+/// <param name="result">画像の格納先</param>
+/// <returns>変換に成功した場合はtrue</returns>
+bool LoadFromScratchImage(DirectX::ScratchImage& image, CpuImage& result);
+
+/// <summary>
+/// DirectXTex のキューブマップを RGBA32F に変換して CpuCubeMap に格納する (変換は image 上で行う)
+/// </summary>
+/// <param name="image">キューブマップ</param>
+/// <param name="result">キューブマップの格納先</param>
+/// <returns>変換に成功した場合はtrue</returns>
+bool LoadFromScratchImage(DirectX::ScratchImage& image, CpuCubeMap& result);
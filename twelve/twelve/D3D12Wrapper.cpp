@@ -8,10 +8,18 @@
 #include <DirectXHelpers.h>
 #include <SimpleMath.h>
 #include <algorithm>
+#include <array>
+#include <map>
+#include <random>
 
 #include "InputSystem.h"
 #include "FileUtil.h" 
 #include "Logger.h"
+#include "ORMTexturePacker.h"
+#include "NormalMipGenerator.h"
+#include "TonemapLUTBaker.h"
+#include "ParallelFor.h"
+#include "DrawSortKey.h"
 
 using namespace DirectX::SimpleMath;
 
@@ -32,25 +40,19 @@ namespace
 			* std::max(0, std::min(ay2, by2) - std::max(ay1, by1));
 	}
 
-	enum COLOR_SPACE_TYPE
-	{
-		COLOR_SPACE_BT709,      // ITU-R BT.709
-		COLOR_SPACE_BT2100_PQ,  // ITU-R BT.2100 PQ System
-	};
-
-	enum TONEMAP_TYPE
-	{
-		TONEMAP_NONE = 0,   // トーンマップなし
-		TONEMAP_REINHARD,   // Reinhardトーンマップ
-		TONEMAP_GT,         // GTトーンマップ
-	};
-
 	struct alignas(256) CbTonemap
 	{
 		int     Type;               // トーンマップタイプ
 		int     ColorSpace;         // 出力色空間
 		float   BaseLuminance;      // 基準輝度値[nit]
 		float   MaxLuminance;       // 最大輝度値[nit]
+		float   LutOffset;          // LUTの入力に加算するオフセット
+		float   LutLog2Min;         // LUTの入力の下限(log2)
+		float   LutInvLog2Range;    // LUTの入力の範囲(log2)の逆数
+		float   LutUVScale;         // テクセル中心に合わせるためのスケール
+		float   Exposure;           // 露出 (シーンのカラーに乗算する値)
+		float   BloomIntensity;     // ブルームの合成の強さ
+		Vector2 SceneUVScale;       // シーンカラーの描画範囲のテクスチャ座標のスケール (動的解像度)
 	};
 
 	struct alignas(256) CbMesh
@@ -71,6 +73,8 @@ namespace
 		float LightIntensity;
 		float Padding;
 		Vector3 LightDirection;
+		int UseSHIrradiance;
+		Vector4 SHCoeffs[9];
 	};
 
 	struct alignas(256) CbDirectionalLight
@@ -95,7 +99,10 @@ namespace
 
 	struct alignas(256) CbCamera
 	{
-		Vector3 CameraPosition;		// カメラの位置
+		Vector3 CameraPosition;			// カメラの位置
+		float	Padding;				// パディング
+		ClusterShaderParams Cluster;	// クラスター番号を求めるためのパラメータ
+		ShadowShaderParams Shadow;		// 太陽光とカスケードシャドウマップのパラメータ
 	};
 
 	struct alignas(256) CbMaterial
@@ -106,6 +113,45 @@ namespace
 		float   Metallic;		// 金属度
 	};
 
+	const double IBLRebakeBudget = 1.0;	// IBLの再ベイクに使用する1フレームあたりの予算 [ms]
+	const double BloomCaptureMinPSNR = 40.0;	// キャプチャしたブルームとCPUでの計算結果の許容する最小のPSNR [dB] (半精度の丸め誤差程度)
+
+	const DXGI_FORMAT SceneColorFormat = DXGI_FORMAT_R10G10B10A2_UNORM;	// シーンカラーのフォーマット
+	const DXGI_FORMAT SceneDepthFormat = DXGI_FORMAT_D32_FLOAT;			// シーン深度のフォーマット
+
+	const size_t MinMeshesPerCommandList = 64;	// 1つのコマンドリストに記録するメッシュの最小数 (少ない場合はスレッドを分けない)
+
+	const float SceneNearZ = 0.1f;		// シーンの近クリップ面
+	const float SceneFarZ = 1000.0f;	// シーンの遠クリップ面
+
+	const uint32_t SceneClusterLightCount = 1024;		// クラスタードライティングで配置するライトの数
+	const uint32_t SceneClusterIndicesPerCluster = 32;	// ライト番号リストの長さ (1クラスターあたりの平均)
+
+	// 描画ソートキーのパスとパイプラインの番号
+	const uint32_t DrawPassOpaque = 0;
+	const uint32_t ScenePipelineIBL = 0;
+	const uint32_t ScenePipelineBindless = 1;
+
+	// シーン用ルートシグネチャの引数番号
+	const uint32_t SceneDrawConstantsParam = 10;	// 描画番号とマテリアル番号のルート定数 (間接描画でも更新する)
+	const uint32_t SceneClusterLightParam = 11;		// クラスタードライティングのライト (ルートSRV)
+	const uint32_t SceneClusterRangeParam = 12;		// クラスターごとのライトの範囲 (ルートSRV)
+	const uint32_t SceneClusterIndexParam = 13;		// クラスターのライト番号リスト (ルートSRV)
+	const uint32_t SceneShadowMapParam = 14;		// カスケードシャドウマップのアトラス
+	const uint32_t SceneSpotShadowDataParam = 15;	// スポットライトの影のデータ (ルートSRV)
+	const uint32_t SceneSpotShadowMapParam = 16;	// スポットライトの影のアトラス
+	const uint32_t SceneTextureArrayParam = 17;		// バインドレス用のテクスチャ配列 (リソース用ヒープ全体)
+	const uint32_t SceneMaterialTableParam = 18;	// バインドレス用のマテリアルのデータ
+
+	// 太陽光とカスケードシャドウマップ
+	const DXGI_FORMAT ShadowMapFormat = DXGI_FORMAT_D32_FLOAT;	// シャドウマップのフォーマット
+	const Vector3 SunDirection = Vector3(-0.3f, -1.0f, -0.4f);	// 太陽光の照射方向
+	const Vector3 SunColor = Vector3(1.0f, 0.95f, 0.9f);		// 太陽光の色
+	const float SunIntensity = 3.0f;							// 太陽光の強度
+
+	// スポットライトの影のアトラス (大きさは画面上の大きさに合わせ, 最大で MaxTileSize)
+	const uint32_t SpotShadowAtlasSize = 4096;					// アトラスの一辺の大きさ
+
 	UINT16 inline GetChromaticityCoord(double value)
 	{
 		return static_cast<UINT16>(value * 50000.0);
@@ -122,55 +168,42 @@ namespace
 		return result;
 	}
 
-	CbLight ComputeSpotLight
-	(
-		int lightType,
-		const Vector3& dir,
-		const Vector3& pos,
-		float radius,
-		const Vector3& color,
-		float intensity,
-		float innerAngle,
-		float outerAngle
-	)
-	{
-		auto cosInnerAngle = cosf(innerAngle);
-		auto cosOuterAngle = cosf(outerAngle);
-
-		CbLight result;
-		result.LightPosition = pos;
-		result.LightInvSqrRadius = 1.0f / (radius * radius);
-		result.LightColor = color;
-		result.LightIntensity = intensity;
-		result.LightForward = dir;
-		result.LightAngleScale = 1.0f / DirectX::XMMax(0.001f, (cosInnerAngle - cosOuterAngle));
-		result.LightAngleOffset = -cosOuterAngle * result.LightAngleScale;
-		result.LightType = lightType;
-
-		return result;
-	}
-
-	Vector3 CalcLightColor(float time)
+	/// <summary>
+	/// クラスタードライティングで使うライトをシーンの周りに配置する (半分はスポットライト)
+	/// </summary>
+	std::vector<ClusterLight> CreateSceneClusterLights(uint32_t count, uint32_t seed)
 	{
-		auto c = fmodf(time, 3.0f);
-		auto result = Vector3(0.25, 0.25, 0.25);
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
 
-		if (c < 1.0f)
-		{
-			result.x += 1.0f - c;
-			result.y += c;
-		}
-		else if (c < 2.0f)
+		std::vector<ClusterLight> result(count);
+		for (auto i = 0u; i < count; ++i)
 		{
-			c -= 1.0f;
-			result.y += 1.0f - c;
-			result.z += c;
-		}
-		else
-		{
-			c -= 2.0f;
-			result.z += 1.0f - c;
-			result.x += c;
+			auto position = DirectX::XMFLOAT3(
+				4.0f * unit(rng) - 2.0f,
+				2.0f * unit(rng) - 0.5f,
+				4.0f * unit(rng) - 2.0f);
+			auto radius = 0.1f + 0.2f * unit(rng);
+			auto color = DirectX::XMFLOAT3(unit(rng), unit(rng), unit(rng));
+
+			if (i & 1)
+			{
+				auto dir = Vector3(2.0f * unit(rng) - 1.0f, -1.0f, 2.0f * unit(rng) - 1.0f);
+				dir.Normalize();
+
+				result[i] = MakeClusterSpotLight(
+					position,
+					dir,
+					radius,
+					color,
+					2.0f,
+					DirectX::XMConvertToRadians(15.0f),
+					DirectX::XMConvertToRadians(35.0f));
+			}
+			else
+			{
+				result[i] = MakeClusterPointLight(position, radius, color, 2.0f);
+			}
 		}
 
 		return result;
@@ -183,17 +216,36 @@ D3D12Wrapper::D3D12Wrapper()
 	, m_pDevice(nullptr)
 	, m_pQueue(nullptr)
 	, m_pSwapChain(nullptr)
+	, m_FrameCount(Constants::DefaultFrameCount)
 	, m_FrameIndex(0)
 	, m_BackBufferFormat(DXGI_FORMAT_R10G10B10A2_UNORM)
+	, m_SceneColorHandle(FrameGraphInvalidHandle)
+	, m_SceneDepthHandle(FrameGraphInvalidHandle)
+	, m_BloomHandle(FrameGraphInvalidHandle)
+	, m_BackBufferHandle(FrameGraphInvalidHandle)
+	, m_ShadowMapHandle(FrameGraphInvalidHandle)
+	, m_SpotShadowMapHandle(FrameGraphInvalidHandle)
+	, m_ScenePass(0)
 	, m_TonemapType(TONEMAP_GT)
 	, m_ColorSpace(COLOR_SPACE_BT709)
 	, m_BaseLuminance(100.0f)
 	, m_MaxLuminance(100.0f)
 	, m_Exposure(1.0f)
+	, m_UseAutoExposure(true)
 	, m_LightType(0)
+	, m_UseCpuCubeMap(false)
+	, m_HasIrradianceSH(false)
+	, m_UseSHIrradiance(false)
 	, m_CameraRotateX(0.0f)
 	, m_CameraRotateY(4.8f)
 	, m_CameraDistance(1.0f)
+	, m_UseIndirectDraw(true)
+	, m_SupportBindless(false)
+	, m_UseBindless(false)
+	, m_UseClusteredLights(false)
+	, m_UseShadows(false)
+	, m_UseSpotShadows(false)
+	, m_UseDynamicResolution(false)
 	, m_RotateAngle(0.0f)
 {
 }
@@ -202,9 +254,10 @@ D3D12Wrapper::~D3D12Wrapper()
 {
 }
 
-bool D3D12Wrapper::Initialize(HWND hWind)
+bool D3D12Wrapper::Initialize(HWND hWind, uint32_t frameCount)
 {
 	m_hWnd = hWind;
+	m_FrameCount = std::clamp(frameCount, Constants::MinFrameCount, Constants::MaxFrameCount);
 
 	InitializeDebug();
 
@@ -301,7 +354,7 @@ bool D3D12Wrapper::Initialize(HWND hWind)
 		desc.SampleDesc.Count = 1;
 		desc.SampleDesc.Quality = 0;
 		desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-		desc.BufferCount = Constants::FrameCount;
+		desc.BufferCount = m_FrameCount;
 		desc.OutputWindow = m_hWnd;
 		desc.Windowed = TRUE;
 		desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
@@ -337,7 +390,7 @@ bool D3D12Wrapper::Initialize(HWND hWind)
 
 		desc.NodeMask = 1;
 		desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-		desc.NumDescriptors = 512;
+		desc.NumDescriptors = 1024;	// IBLのベイク用定数バッファをフレーム番号ごとに持つ分 (MaxFrameCount * MipCount * 6) を含む
 		desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 
 		if (!DescriptorPool::Create(m_pDevice.Get(), &desc, &m_pPool[POOL_TYPE_RES]))
@@ -375,7 +428,13 @@ bool D3D12Wrapper::Initialize(HWND hWind)
 
 	// コマンドリストの生成
 	{
-		if (!m_CommandList.Init(m_pDevice.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT, Constants::FrameCount))
+		if (!m_CommandList.Init(m_pDevice.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT, m_FrameCount))
+		{
+			return false;
+		}
+
+		// 描画はワーカースレッドごとにコマンドリストとアロケータを割り当てる
+		if (!m_CommandListPool.Init(m_pDevice.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT, GetWorkerThreadCount()))
 		{
 			return false;
 		}
@@ -383,7 +442,7 @@ bool D3D12Wrapper::Initialize(HWND hWind)
 
 	// レンダーターゲットビューの生成
 	{
-		for (auto i = 0u; i < Constants::FrameCount; ++i)
+		for (auto i = 0u; i < m_FrameCount; ++i)
 		{
 			if (!m_RenderTarget[i].InitFromBackBuffer(m_pDevice.Get(), m_pPool[POOL_TYPE_RTV], true, i, m_pSwapChain.Get()))
 			{
@@ -406,6 +465,23 @@ bool D3D12Wrapper::Initialize(HWND hWind)
 		{
 			return false;
 		}
+
+		// 先行フレーム数はCPU/GPUの処理時間から選ぶ
+		if (!m_FramePacer.Init(m_FrameCount, FRAME_PACING_AUTO))
+		{
+			return false;
+		}
+
+		if (!m_GpuTimer.Init(m_pDevice.Get(), m_pQueue.Get()))
+		{
+			return false;
+		}
+
+		// シーンの描画解像度はGPU時間から決める (有効にするまでは最大解像度)
+		if (!m_DynamicResolution.Init(DynamicResolutionDesc()))
+		{
+			return false;
+		}
 	}
 
 	// ビューポートの設定
@@ -426,6 +502,8 @@ bool D3D12Wrapper::Initialize(HWND hWind)
 		m_Scissor.bottom = Constants::WindowHeight;
 	}
 
+	UpdateSceneViewport();
+
 	return true;
 }
 
@@ -436,9 +514,11 @@ void D3D12Wrapper::Terminate()
 
 	// フェンスの破棄
 	m_Fence.Term();
+	m_FramePacer.Term();
+	m_GpuTimer.Term();
 
 	// レンダーターゲットビューの破棄
-	for (auto i = 0u; i < Constants::FrameCount; ++i)
+	for (auto i = 0u; i < m_FrameCount; ++i)
 	{
 		m_RenderTarget[i].Term();
 	}
@@ -448,6 +528,7 @@ void D3D12Wrapper::Terminate()
 
 	// コマンドリストの破棄
 	m_CommandList.Term();
+	m_CommandListPool.Term();
 
 	for (auto i = 0; i < POOL_COUNT; ++i)
 	{
@@ -483,93 +564,108 @@ void D3D12Wrapper::Render()
 		auto aspect = static_cast<float>(Constants::WindowWidth) / static_cast<float>(Constants::WindowHeight);
 
 		m_View = Matrix::CreateLookAt(m_CameraPos, Vector3::Zero, Vector3::UnitY);
-		m_Proj = Matrix::CreatePerspectiveFieldOfView(fovY, aspect, 0.1f, 1000.0f);
+		m_Proj = Matrix::CreatePerspectiveFieldOfView(fovY, aspect, SceneNearZ, SceneFarZ);
+	}
+
+	// 前回同じフレーム番号で計測したGPU時間をペーシングと動的解像度に反映する
+	{
+		double gpuMilliseconds = 0.0;
+		if (m_GpuTimer.Resolve(m_FrameIndex, gpuMilliseconds))
+		{
+			m_FramePacer.ReportGpuTime(gpuMilliseconds);
+
+			if (m_UseDynamicResolution)
+			{
+				m_DynamicResolution.Update(gpuMilliseconds);
+			}
+		}
+
+		UpdateSceneViewport();
+	}
+
+	// 自動露出の更新 (前回同じフレーム番号で求めたヒストグラムから露出を順応させる)
+	{
+		auto currTime = std::chrono::steady_clock::now();
+		auto deltaTime = std::chrono::duration<float>(currTime - m_LastFrameTime).count();
+		m_LastFrameTime = currTime;
+
+		if (m_UseAutoExposure)
+		{
+			m_AutoExposure.Update(m_FrameIndex, deltaTime);
+			m_Exposure = m_AutoExposure.GetExposure();
+		}
 	}
 
-	// コマンドの記録を開始
-	auto pCmd = m_CommandList.Reset();
+	// トーンマップのLUTの更新 (パラメータが変わった場合は記録の前にベイクし, アップロードはフレームのコマンドリストに記録する)
+	{
+		TonemapParam param;
+		param.Type = m_TonemapType;
+		param.ColorSpace = m_ColorSpace;
+		param.BaseLuminance = m_BaseLuminance;
+		param.MaxLuminance = m_MaxLuminance;
+
+		if (!m_TonemapLUT.Update(param, m_Fence.GetCompletedValue()))
+		{
+			ELOG("Error : TonemapLUT::Update() Failed.");
+		}
+	}
+
+	m_CommandListPool.BeginFrame(m_Fence.GetCompletedValue());
+	m_RecorderStats = CommandRecorderStats();
 
 	ID3D12DescriptorHeap* const pHeaps[] = {
 		m_pPool[POOL_TYPE_RES]->GetHeap()
 	};
 
-	pCmd->SetDescriptorHeaps(1, pHeaps);
-
+	// シーン描画のパスまでを記録する
+	auto split = m_FrameGraph.GetExecutionIndex(m_ScenePass) + 1;
 	{
-		// ディスクリプタを取得
-		auto handleRTV = m_SceneColorTarget.GetHandleRTV();
-		auto handleDSV = m_SceneDepthTarget.GetHandleDSV();
-
-		// 書き込み用リソースバリアを設定
-		DirectX::TransitionResource(
-			pCmd,
-			m_SceneColorTarget.GetResource(),
-			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-			D3D12_RESOURCE_STATE_RENDER_TARGET);
+		auto pCmd = m_CommandListPool.Allocate(0, 0);
 
-		// レンダーゲットの設定
-		pCmd->OMSetRenderTargets(1, &handleRTV->HandleCPU, FALSE, &handleDSV->HandleCPU);
+		pCmd->SetDescriptorHeaps(1, pHeaps);
 
-		// レンダーターゲットをクリア.
-		m_SceneColorTarget.ClearView(pCmd);
-		m_SceneDepthTarget.ClearView(pCmd);
+		m_GpuTimer.Begin(pCmd, m_FrameIndex);
 
-		// ビューポート設定
-		pCmd->RSSetViewports(1, &m_Viewport);
-		pCmd->RSSetScissorRects(1, &m_Scissor);
+		// IBLの再ベイクを予算の範囲で進める
+		m_IBLBaker.UpdateRebake(pCmd, m_FrameIndex);
 
-		// 背景描画
-		m_SkyBox.Draw(pCmd, m_SphereMapConverter.GetCubeMapHandleGPU(), m_View, m_Proj, 100.0f);
+		// ベイクし直したトーンマップのLUTをアップロードする (表のLUTはこのフレームの完了まで使い続ける)
+		m_TonemapLUT.RecordUpload(pCmd, m_FrameIndex, m_Fence.GetNextValue());
 
-		//DrawScene(pCmd);
-		DrawIBL(pCmd);
+		// シャドウマップからトーンマップまでをフレームグラフで実行する (バリアはグラフが発行する)
+		m_FrameGraphExecutor.SetImportedResource(m_BloomHandle, m_Bloom.GetResource());
+		m_FrameGraphExecutor.SetImportedResource(m_BackBufferHandle, m_RenderTarget[m_FrameIndex].GetResource());
+		m_FrameGraphExecutor.SetImportedResource(m_ShadowMapHandle, m_ShadowMap.GetResource());
+		m_FrameGraphExecutor.SetImportedResource(m_SpotShadowMapHandle, m_SpotShadowMap.GetResource());
+		m_FrameGraphExecutor.Execute(pCmd, 0, split);
 
-		// 読み込み用リソースバリアを設定
-		DirectX::TransitionResource(
-			pCmd,
-			m_SceneColorTarget.GetResource(),
-			D3D12_RESOURCE_STATE_RENDER_TARGET,
-			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		pCmd->Close();
 	}
 
+	// 描画順を並べ替え, メッシュをワーカースレッドで記録する
+	// 間接描画の場合は引数レコードをワーカースレッドで書き込み, マテリアルごとに ExecuteIndirect() を発行する
+	BuildDrawKeys();
+	RadixSortDrawKeysParallel(m_DrawKeys, m_DrawKeyWork);
+	auto order = (m_UseIndirectDraw && m_DrawKeys.size() <= m_IndirectDraw.GetMaxDrawCount())
+		? RecordMeshesIndirect(1)
+		: RecordMeshes(1);
 
-	// フレームバッファに描画
+	// 残りのパスを記録する
 	{
-		// 書き込み用リソースバリアを設定
-		DirectX::TransitionResource(
-			pCmd,
-			m_RenderTarget[m_FrameIndex].GetResource(),
-			D3D12_RESOURCE_STATE_PRESENT,
-			D3D12_RESOURCE_STATE_RENDER_TARGET);
+		auto pCmd = m_CommandListPool.Allocate(0, order);
 
-		// ディスクリプタを取得
-		auto handleRTV = m_RenderTarget[m_FrameIndex].GetHandleRTV();
-		auto handleDSV = m_DepthTarget.GetHandleDSV();
-
-		// レンダーターゲットの設定
-		pCmd->OMSetRenderTargets(1, &handleRTV->HandleCPU, FALSE, &handleDSV->HandleCPU);
+		pCmd->SetDescriptorHeaps(1, pHeaps);
 
-		// レンダーターゲットをクリア
-		m_RenderTarget[m_FrameIndex].ClearView(pCmd);
-		m_DepthTarget.ClearView(pCmd);
+		m_FrameGraphExecutor.Execute(pCmd, split, UINT32_MAX);
 
-		// トーンマップを適用
-		DrawTonemap(pCmd);
+		m_GpuTimer.End(pCmd, m_FrameIndex);
 
-		// 表示用リソースバリアを設定
-		DirectX::TransitionResource(
-			pCmd,
-			m_RenderTarget[m_FrameIndex].GetResource(),
-			D3D12_RESOURCE_STATE_RENDER_TARGET,
-			D3D12_RESOURCE_STATE_PRESENT);
+		pCmd->Close();
 	}
 
-	// コマンドの記録を終了
-	pCmd->Close();
-
-	// コマンドを実行
-	ID3D12CommandList* ppCmdLists[] = { pCmd };
-	m_pQueue->ExecuteCommandLists(1, ppCmdLists);
+	// 提出順に並べて1回で実行する
+	m_CommandListPool.Submit(m_pQueue.Get());
+	m_CommandListPool.EndFrame(m_Fence.GetNextValue());
 
 	// 画面に表示
 	Present(1);
@@ -607,6 +703,149 @@ void D3D12Wrapper::ProcessInput(const InputState& state)
 		m_TonemapType = TONEMAP_GT;
 	}
 
+	// 自動露出の切り替え (無効にした場合は露出を1に戻す)
+	if (state.keyboard.GetKeyState('E') == ButtonState::Pressed)
+	{
+		m_UseAutoExposure = !m_UseAutoExposure;
+		if (!m_UseAutoExposure)
+		{
+			m_Exposure = 1.0f;
+		}
+		printf_s("Auto Exposure : %s\n", m_UseAutoExposure ? "On" : "Off");
+	}
+
+	// 自動露出の検証用にシーンカラーとヒストグラムを保存し, CPUで求めたヒストグラムと比較する
+	if (state.keyboard.GetKeyState('C') == ButtonState::Pressed)
+	{
+		// 検証はシーンカラー全体と比較するので, 動的解像度で描画範囲を縮小している場合は保存しない
+		if (m_UseDynamicResolution)
+		{
+			printf_s("Capture : Skipped (dynamic resolution is ON)\n");
+		}
+		else
+		{
+			if (m_AutoExposure.Capture(
+				m_pQueue.Get(),
+				m_FrameGraphExecutor.GetResource(m_SceneColorHandle),
+				m_FrameGraph.GetFinalState(m_SceneColorHandle),
+				L"ExposureCapture.dds",
+				L"ExposureCapture.hist"))
+			{
+				printf_s("Exposure Capture : Saved (average log2 = %.3f, exposure = %.4f)\n",
+					m_AutoExposure.GetAverageLog2(), m_AutoExposure.GetExposure());
+
+				AutoExposureReport report;
+				auto matched = ValidateExposureCapture(L"ExposureCapture.dds", L"ExposureCapture.hist", m_AutoExposure.GetParam(), report);
+				printf_s("Exposure Capture : %s (mismatch bins = %u)\n", matched ? "Matched" : "Mismatched", report.MismatchBins);
+			}
+
+			// 同じシーンカラーから求めたブルームも保存し, CPUで求めた結果と比較する
+			if (m_Bloom.Capture(m_pQueue.Get(), L"BloomCapture.dds"))
+			{
+				printf_s("Bloom Capture : Saved (%u levels)\n", m_Bloom.GetLevelCount());
+
+				ImageError error;
+				auto matched = ValidateBloomCapture(L"ExposureCapture.dds", L"BloomCapture.dds", m_Bloom.GetParam(), BloomCaptureMinPSNR, error);
+				printf_s("Bloom Capture : %s (PSNR = %.2f dB)\n", matched ? "Matched" : "Mismatched", error.PSNR);
+			}
+		}
+	}
+
+	// ディフューズIBLの評価方法の切り替え (SH9 / Diffuse LDキューブマップ)
+	if (state.keyboard.GetKeyState('I') == ButtonState::Pressed && m_HasIrradianceSH)
+	{
+		m_UseSHIrradiance = !m_UseSHIrradiance;
+		printf_s("IBL Diffuse : %s\n", m_UseSHIrradiance ? "SH9" : "Diffuse LD Cube Map");
+	}
+
+	// IBLの再ベイク (複数フレームに分割して実行し, 完了時に切り替える)
+	if (state.keyboard.GetKeyState('B') == ButtonState::Pressed)
+	{
+		auto desc = m_UseCpuCubeMap ? m_CubeMap.GetDesc() : m_SphereMapConverter.GetCubeMapDesc();
+		m_IBLBaker.RequestRebake(uint32_t(desc.Width), desc.MipLevels, GetCubeMapHandleGPU());
+
+		// 再ベイクしたDiffuse LD項を確認できるようにSH9による評価は無効にする
+		m_UseSHIrradiance = false;
+		printf_s("IBL Rebake : Requested\n");
+	}
+
+	// フレームペーシングの方針の切り替え (遅延優先 / スループット優先 / 自動)
+	if (state.keyboard.GetKeyState('P') == ButtonState::Pressed)
+	{
+		static const char* ModeNames[] = { "Latency", "Throughput", "Auto" };
+
+		auto mode = FramePacingMode((m_FramePacer.GetMode() + 1) % FRAME_PACING_COUNT);
+		m_FramePacer.SetMode(mode);
+		printf_s("Frame Pacing : %s (frames in flight = %u / %u, cpu = %.2f ms, gpu = %.2f ms)\n",
+			ModeNames[mode],
+			m_FramePacer.GetLatency(),
+			m_FramePacer.GetFrameCount(),
+			m_FramePacer.GetCpuTime(),
+			m_FramePacer.GetGpuTime());
+	}
+
+	// 動的解像度の切り替え (無効にした場合は最大解像度に戻す)
+	if (state.keyboard.GetKeyState('U') == ButtonState::Pressed)
+	{
+		m_UseDynamicResolution = !m_UseDynamicResolution;
+		m_DynamicResolution.Reset();
+		printf_s("Dynamic Resolution : %s (target = %.1f ms, scale = %.2f - %.2f)\n",
+			m_UseDynamicResolution ? "ON" : "OFF",
+			m_DynamicResolution.GetDesc().TargetMilliseconds,
+			m_DynamicResolution.GetDesc().MinScale,
+			m_DynamicResolution.GetDesc().MaxScale);
+	}
+
+	// メッシュの描画方法の切り替え (ExecuteIndirect() / 直接描画)
+	if (state.keyboard.GetKeyState('X') == ButtonState::Pressed)
+	{
+		m_UseIndirectDraw = !m_UseIndirectDraw;
+		printf_s("Indirect Draw : %s\n", m_UseIndirectDraw ? "ON" : "OFF");
+	}
+
+	// マテリアルの参照方法の切り替え (バインドレス / ディスクリプタテーブル)
+	if (state.keyboard.GetKeyState('M') == ButtonState::Pressed && m_SupportBindless)
+	{
+		m_UseBindless = !m_UseBindless;
+		printf_s("Bindless Material : %s\n", m_UseBindless ? "ON" : "OFF");
+	}
+
+	// クラスタードライティングの切り替え
+	if (state.keyboard.GetKeyState('K') == ButtonState::Pressed)
+	{
+		m_UseClusteredLights = !m_UseClusteredLights;
+		printf_s("Clustered Lights : %s (%u lights)\n", m_UseClusteredLights ? "ON" : "OFF", uint32_t(m_ClusterLights.size()));
+	}
+
+	// 太陽光とカスケードシャドウマップの切り替え
+	if (state.keyboard.GetKeyState('O') == ButtonState::Pressed)
+	{
+		m_UseShadows = !m_UseShadows;
+		printf_s("Cascaded Shadows : %s (%u cascades)\n", m_UseShadows ? "ON" : "OFF", m_ShadowDesc.CascadeCount);
+	}
+
+	// 前回のフレームの状態設定の発行数と省略数を表示
+	if (state.keyboard.GetKeyState('T') == ButtonState::Pressed)
+	{
+		printf_s("Command Recorder : issued = %u, filtered = %u (pipeline %u / %u, root parameter %u / %u, vertex buffer %u / %u), draws = %u\n",
+			m_RecorderStats.GetIssuedCount(),
+			m_RecorderStats.GetFilteredCount(),
+			m_RecorderStats.Issued[COMMAND_STATE_PIPELINE],
+			m_RecorderStats.Filtered[COMMAND_STATE_PIPELINE],
+			m_RecorderStats.Issued[COMMAND_STATE_ROOT_PARAMETER],
+			m_RecorderStats.Filtered[COMMAND_STATE_ROOT_PARAMETER],
+			m_RecorderStats.Issued[COMMAND_STATE_VERTEX_BUFFER],
+			m_RecorderStats.Filtered[COMMAND_STATE_VERTEX_BUFFER],
+			m_RecorderStats.DrawCount);
+	}
+
+	// スポットライトの影の切り替え (クラスタードライティングが有効な場合のみ描画する)
+	if (state.keyboard.GetKeyState('J') == ButtonState::Pressed)
+	{
+		m_UseSpotShadows = !m_UseSpotShadows;
+		printf_s("Spot Light Shadows : %s (atlas %u)\n", m_UseSpotShadows ? "ON" : "OFF", SpotShadowAtlasSize);
+	}
+
 	// スポットライトの計算手法の切り替え
 	if (state.keyboard.GetKeyState('L') == ButtonState::Pressed)
 	{
@@ -670,6 +909,22 @@ void D3D12Wrapper::ProcessInput(const InputState& state)
 
 bool D3D12Wrapper::InitializeGraphicsPipeline()
 {
+	// パイプラインキャッシュの初期化 (ライブラリが使えない環境でもメモリ上のキャッシュとして動作する)
+	if (!m_PipelineCache.Init(m_pDevice.Get(), L"Cache/PipelineLibrary.bin"))
+	{
+		ELOG("Error : PipelineCache::Init() Failed.");
+		return false;
+	}
+
+	// バインドレス描画の対応状況を確認する
+	// リソース用ヒープ全体を1つのテクスチャ配列として参照するので, 大きなSRVテーブルを扱える Resource Binding Tier 2 以上が必要
+	{
+		D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+		auto hr = m_pDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options));
+		m_SupportBindless = SUCCEEDED(hr) && options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2;
+		m_UseBindless = m_SupportBindless;
+	}
+
 	// メッシュをロード
 	{
 		std::wstring path;
@@ -686,8 +941,8 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		std::vector<ResMesh> resMesh;
 		std::vector<ResMaterial> resMaterial;
 
-		// メッシュリソースをロード
-		if (!LoadMesh(path.c_str(), resMesh, resMaterial))
+		// メッシュリソースをロード (同じデータのメッシュはインスタンスとしてまとめる)
+		if (!LoadMesh(path.c_str(), resMesh, resMaterial, MESH_IMPORT_INSTANCED))
 		{
 			ELOG("Error : Load Mesh Failed. filepath = %ls", path.c_str());
 			return false;
@@ -742,14 +997,18 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 			std::wstring path = dir + resMaterial[i].BaseColorMap;
 			m_Material.SetTexture(i, TU_BASE_COLOR, path, batch);
 
-			path = dir + resMaterial[i].NormalMap;
-			m_Material.SetTexture(i, TU_NORMAL, path, batch);
-
-			path = dir + resMaterial[i].MetallicMap;
-			m_Material.SetTexture(i, TU_METALLIC, path, batch);
+			std::wstring normalMap;
+			if (CookNormalMap(dir, resMaterial[i].NormalMap, normalMap))
+			{
+				path = dir + normalMap;
+				m_Material.SetTexture(i, TU_NORMAL, path, batch);
+			}
 
-			path = dir + resMaterial[i].RoughnessMap;
-			m_Material.SetTexture(i, TU_ROUGHNESS, path, batch);
+			if (PackMaterialORM(dir, resMaterial[i]))
+			{
+				path = dir + resMaterial[i].ORMMap;
+				m_Material.SetTexture(i, TU_ORM, path, batch);
+			}
 		}*/
 
 		{
@@ -760,9 +1019,36 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 			m_Material.SetTexture(0, TU_NORMAL, dir + L"wall_n.dds", batch);*/
 
 			m_Material.SetTexture(0, TU_BASE_COLOR, L"Assets/matball/gold_bc.dds", batch);
-			m_Material.SetTexture(0, TU_METALLIC, L"Assets/matball/gold_m.dds", batch);
-			m_Material.SetTexture(0, TU_ROUGHNESS, L"Assets/matball/gold_r.dds", batch);
-			m_Material.SetTexture(0, TU_NORMAL, L"Assets/matball/gold_n.dds", batch);
+
+			// 法線マップのミップを再正規化し, AO・粗さ・金属度を1枚のORMテクスチャにまとめる
+			// 粗さのミップには法線マップのミップで失われる分散を加算してスペキュラーエイリアシングを抑える
+			std::wstring ormDir = L"Assets/matball/";
+			std::wstring normalMap;
+			if (!CookNormalMap(ormDir, L"gold_n.dds", normalMap))
+			{
+				ELOG("Error : CookNormalMap() Failed.");
+				return false;
+			}
+
+			m_Material.SetTexture(0, TU_NORMAL, ormDir + normalMap, batch);
+
+			ResMaterial ormMaterial = {};
+			ormMaterial.NormalMap = L"gold_n.dds";
+			ormMaterial.MetallicMap = L"gold_m.dds";
+			ormMaterial.RoughnessMap = L"gold_r.dds";
+			ormMaterial.OcclusionMap = L"gold_ao.dds";
+			ormMaterial.Metallic = 0.0f;
+			ormMaterial.Roughness = 1.0f;
+
+			ORMPackReport ormReport;
+			if (!PackMaterialORM(ormDir, ormMaterial, &ormReport))
+			{
+				ELOG("Error : PackMaterialORM() Failed.");
+				return false;
+			}
+			LogORMPackReport(ormMaterial.ORMMap.c_str(), ormReport);
+
+			m_Material.SetTexture(0, TU_ORM, ormDir + ormMaterial.ORMMap, batch);
 		}
 
 		// バッチ終了
@@ -770,12 +1056,63 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 
 		// バッチ完了を待機
 		future.wait();
+
+		// マテリアルのソート用の番号を決める (アトラスを共有して同じディスクリプタテーブルになるものは同じ番号にする)
+		{
+			std::map<std::array<UINT64, 3>, uint32_t> ids;
+
+			m_MaterialSortIds.resize(m_Material.GetCount());
+			for (size_t i = 0; i < m_MaterialSortIds.size(); ++i)
+			{
+				std::array<UINT64, 3> handles = {
+					m_Material.GetTextureHandle(i, TU_BASE_COLOR).ptr,
+					m_Material.GetTextureHandle(i, TU_ORM).ptr,
+					m_Material.GetTextureHandle(i, TU_NORMAL).ptr,
+				};
+
+				auto itr = ids.emplace(handles, uint32_t(ids.size())).first;
+				m_MaterialSortIds[i] = itr->second;
+			}
+		}
+
+		// バインドレス用のマテリアルのデータを作る (テクスチャの読み込み後にヒープ内の番号が決まる)
+		if (m_SupportBindless)
+		{
+			if (!m_BindlessMaterials.Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], m_Material))
+			{
+				ELOG("Error : BindlessMaterialTable::Init() Failed.");
+				return false;
+			}
+		}
+
+		// 描画ソートキーのメッシュ番号に収まらない場合は描画できない
+		if (m_pMeshes.size() > (size_t(1) << DrawKeyMeshBits))
+		{
+			ELOG("Error : Too Many Meshes. count = %zu", m_pMeshes.size());
+			return false;
+		}
+
+		// 並べ替えによる状態の切り替え回数の変化を出力する
+		{
+			BuildDrawKeys();
+			auto before = CountDrawStateChanges(m_DrawKeys.data(), m_DrawKeys.size());
+
+			RadixSortDrawKeysParallel(m_DrawKeys, m_DrawKeyWork);
+			auto after = CountDrawStateChanges(m_DrawKeys.data(), m_DrawKeys.size());
+
+			ILOG("Info : Draw Sort : meshes = %zu, materials = %zu (%zu tables), pipeline changes %u -> %u, material changes %u -> %u",
+				m_pMeshes.size(),
+				m_MaterialSortIds.size(),
+				size_t(m_MaterialSortIds.empty() ? 0 : *std::max_element(m_MaterialSortIds.begin(), m_MaterialSortIds.end()) + 1),
+				before.Pipeline, after.Pipeline,
+				before.Material, after.Material);
+		}
 	}
 
 	// ライトバッファの設定
 	{
 		//// ディレクショナルライト
-		//for (auto i = 0; i < Constants::FrameCount; ++i)
+		//for (auto i = 0; i < Constants::MaxFrameCount; ++i)
 		//{
 		//	if (!m_DirectionalLightCB[i].Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(CbDirectionalLight)))
 		//	{
@@ -784,7 +1121,7 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		//	}
 		//}
 
-		//for (auto i = 0; i < Constants::FrameCount; ++i)
+		//for (auto i = 0; i < Constants::MaxFrameCount; ++i)
 		//{
 		//	if (!m_LightCB[i].Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(CbLight)))
 		//	{
@@ -794,7 +1131,7 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		//}
 
 		// IBL
-		for (auto i = 0; i < Constants::FrameCount; ++i)
+		for (auto i = 0; i < Constants::MaxFrameCount; ++i)
 		{
 			if (!m_IBLCB[i].Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(CbIBL)))
 			{
@@ -806,7 +1143,7 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 
 	// カメラバッファの設定
 	{
-		for (auto i = 0; i < Constants::FrameCount; ++i)
+		for (auto i = 0; i < Constants::MaxFrameCount; ++i)
 		{
 			if (!m_CameraCB[i].Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(CbCamera)))
 			{
@@ -816,39 +1153,96 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		}
 	}
 
-	// シーン用カラーターゲットの生成
+	// クラスタードライティングの設定 (クラスターは m_Proj と同じ近クリップ面から遠クリップ面までを分割する)
+	{
+		ClusterGridDesc desc;
+		desc.NearZ = SceneNearZ;
+		desc.FarZ = SceneFarZ;
+
+		if (!m_ClusteredLighting.Init(m_pDevice.Get(), desc, SceneClusterLightCount, desc.GetClusterCount() * SceneClusterIndicesPerCluster))
+		{
+			ELOG("Error : ClusteredLighting::Init() Failed.");
+			return false;
+		}
+
+		m_ClusterLights = CreateSceneClusterLights(SceneClusterLightCount, 1);
+	}
+
+	// カスケードシャドウマップの設定 (影を落とす範囲はシーンの大きさに合わせて m_Proj より短くする)
 	{
-		float clearColor[4] = { 0.2f, 0.2f, 0.2f, 1.0f };
+		m_ShadowDesc.NearZ = SceneNearZ;
 
-		if (!m_SceneColorTarget.Init(
+		if (!m_ShadowMap.Init(
 			m_pDevice.Get(),
-			m_pPool[POOL_TYPE_RTV],
+			m_pPool[POOL_TYPE_DSV],
 			m_pPool[POOL_TYPE_RES],
-			Constants::WindowWidth,
-			Constants::WindowHeight,
-			DXGI_FORMAT_R10G10B10A2_UNORM,
-			clearColor))
+			m_ShadowDesc.Resolution * 2,
+			m_ShadowDesc.Resolution * 2,
+			ShadowMapFormat,
+			1.0f,
+			0))
 		{
-			ELOG("Error : ColorTarget::Init() Failed.");
+			ELOG("Error : DepthTarget::Init() Failed.");
 			return false;
 		}
+
+		for (auto i = 0; i < Constants::MaxFrameCount; ++i)
+		{
+			for (auto j = 0u; j < MaxShadowCascadeCount; ++j)
+			{
+				if (!m_ShadowTransformCB[i][j].Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(CbTransform)))
+				{
+					ELOG("Error : ConstantBuffer::Init() Failed.");
+					return false;
+				}
+			}
+		}
+
+		// メッシュは動かないので, バウンディングボックスは一度だけ求める
+		m_ShadowCasters.resize(m_pMeshes.size());
+		for (size_t i = 0; i < m_pMeshes.size(); ++i)
+		{
+			m_ShadowCasters[i].Min = m_pMeshes[i]->GetBoundsMin();
+			m_ShadowCasters[i].Max = m_pMeshes[i]->GetBoundsMax();
+		}
 	}
 
-	// シーン用深度ステンシルバッファの生成
+	// スポットライトの影のアトラスの設定 (タイルは描画したものだけ参照するので, 全体はクリアしない)
 	{
-		if (!m_SceneDepthTarget.Init(
+		if (!m_SpotShadowMap.Init(
 			m_pDevice.Get(),
 			m_pPool[POOL_TYPE_DSV],
-			nullptr,
-			Constants::WindowWidth,
-			Constants::WindowHeight,
-			DXGI_FORMAT_D32_FLOAT,
-			1.0,
+			m_pPool[POOL_TYPE_RES],
+			SpotShadowAtlasSize,
+			SpotShadowAtlasSize,
+			ShadowMapFormat,
+			1.0f,
 			0))
 		{
 			ELOG("Error : DepthTarget::Init() Failed.");
 			return false;
 		}
+
+		ShadowAtlasSettings settings;
+		settings.AtlasSize = SpotShadowAtlasSize;
+
+		if (!m_SpotShadowAtlas.Init(m_pDevice.Get(), settings, SceneClusterLightCount))
+		{
+			ELOG("Error : SpotShadowAtlas::Init() Failed.");
+			return false;
+		}
+
+		for (auto i = 0; i < Constants::MaxFrameCount; ++i)
+		{
+			for (auto j = 0u; j < MaxSpotShadowRenderCount; ++j)
+			{
+				if (!m_SpotShadowTransformCB[i][j].Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(CbTransform)))
+				{
+					ELOG("Error : ConstantBuffer::Init() Failed.");
+					return false;
+				}
+			}
+		}
 	}
 
 	// シーン用ルートシグネチャの生成
@@ -871,7 +1265,7 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		//	.AllowIL()
 		//	.End();
 
-		desc.Begin(11)
+		desc.Begin(m_SupportBindless ? 19 : 17)
 			.SetCBV(ShaderStage::VS, 0, 0)
 			.SetCBV(ShaderStage::VS, 1, 1)
 			.SetCBV(ShaderStage::PS, 2, 1)
@@ -880,16 +1274,30 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 			.SetSRV(ShaderStage::PS, 5, 1)
 			.SetSRV(ShaderStage::PS, 6, 2)
 			.SetSRV(ShaderStage::PS, 7, 3)
-			.SetSRV(ShaderStage::PS, 8, 4)
+			.SetSRV(ShaderStage::PS, 8, 4) // ORMマップ
 			.SetSRV(ShaderStage::PS, 9, 5)
-			.SetSRV(ShaderStage::PS, 10, 6)
-			.AddStaticSmp(ShaderStage::PS, 0, SamplerState::LinearWrap)
+			.SetConstants(ShaderStage::ALL, SceneDrawConstantsParam, 3, IndirectDrawConstantCount) // 描画番号, マテリアル番号
+			.SetRootSRV(ShaderStage::PS, SceneClusterLightParam, 7)
+			.SetRootSRV(ShaderStage::PS, SceneClusterRangeParam, 8)
+			.SetRootSRV(ShaderStage::PS, SceneClusterIndexParam, 9)
+			.SetSRV(ShaderStage::PS, SceneShadowMapParam, 10)
+			.SetRootSRV(ShaderStage::PS, SceneSpotShadowDataParam, 11)
+			.SetSRV(ShaderStage::PS, SceneSpotShadowMapParam, 12);
+
+		if (m_SupportBindless)
+		{
+			desc.SetSRVArray(ShaderStage::PS, SceneTextureArrayParam, 0, 1, m_pPool[POOL_TYPE_RES]->GetHandleCount())
+				.SetSRV(ShaderStage::PS, SceneMaterialTableParam, 6);
+		}
+
+		desc.AddStaticSmp(ShaderStage::PS, 0, SamplerState::LinearWrap)
 			.AddStaticSmp(ShaderStage::PS, 1, SamplerState::LinearWrap)
 			.AddStaticSmp(ShaderStage::PS, 2, SamplerState::LinearWrap)
 			.AddStaticSmp(ShaderStage::PS, 3, SamplerState::LinearWrap)
 			.AddStaticSmp(ShaderStage::PS, 4, SamplerState::LinearWrap)
 			.AddStaticSmp(ShaderStage::PS, 5, SamplerState::LinearWrap)
-			.AddStaticSmp(ShaderStage::PS, 6, SamplerState::LinearWrap)
+			.AddStaticSmp(ShaderStage::PS, 6, SamplerState::ShadowCompare)
+			.AddStaticSmp(ShaderStage::PS, 7, SamplerState::ShadowCompare)
 			.AllowIL()
 			.End();
 
@@ -900,47 +1308,44 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		}
 	}
 
-	// シーン用パイプラインステートの生成
+	// 間接描画の設定 (メッシュのバッファは変化しないので元データは一度だけ作る)
+	if (!m_pMeshes.empty())
 	{
-		std::wstring vsPath;
-		std::wstring psPath;
-
-		// 頂点シェーダーを検索
-		if (!SearchFilePath(L"BasicVS.cso", vsPath))
+		m_IndirectSources.resize(m_pMeshes.size());
+		for (size_t i = 0; i < m_pMeshes.size(); ++i)
 		{
-			ELOG("Error : Vertex Shader Not Found.");
-			return false;
+			m_IndirectSources[i].VertexBuffer = m_pMeshes[i]->GetVertexBufferView();
+			m_IndirectSources[i].InstanceBuffer = m_pMeshes[i]->GetInstanceBufferView();
+			m_IndirectSources[i].IndexBuffer = m_pMeshes[i]->GetIndexBufferView();
+			m_IndirectSources[i].IndexCount = m_pMeshes[i]->GetIndexCount();
+			m_IndirectSources[i].InstanceCount = m_pMeshes[i]->GetInstanceCount();
+			m_IndirectSources[i].MaterialId = m_pMeshes[i]->GetMaterialId();
 		}
 
-		// ピクセルシェーダーを検索
-		/*if (!SearchFilePath(L"BasicPS.cso", psPath))
-		{
-			ELOG("Error : Pixel Shader Not Found.");
-			return false;
-		}*/
-
-		if (!SearchFilePath(L"IBLPS.cso", psPath))
+		if (!m_IndirectDraw.Init(m_pDevice.Get(), m_SceneRootSignature.GetPtr(), SceneDrawConstantsParam, uint32_t(m_pMeshes.size())))
 		{
-			ELOG("Error : Pixel Shader Not Found.");
+			ELOG("Error : IndirectDrawBuffer::Init() Failed.");
 			return false;
 		}
+	}
 
-		ComPtr<ID3DBlob> pVSBlob;
-		ComPtr<ID3DBlob> pPSBlob;
+	// シーン用パイプラインステートの生成
+	{
+		D3D12_SHADER_BYTECODE vs = {};
+		D3D12_SHADER_BYTECODE ps = {};
 
 		// 頂点シェーダー読み込み
-		auto hr = D3DReadFileToBlob(vsPath.c_str(), pVSBlob.GetAddressOf());
-		if (FAILED(hr))
+		if (!m_PipelineCache.LoadShader(L"BasicVS.cso", vs))
 		{
-			ELOG("Error : D3DReadFiledToBlob() Failed. path = %ls", vsPath.c_str());
+			ELOG("Error : Vertex Shader Load Failed.");
 			return false;
 		}
 
 		// ピクセルシェーダー読み込み
-		hr = D3DReadFileToBlob(psPath.c_str(), pPSBlob.GetAddressOf());
-		if (FAILED(hr))
+		//if (!m_PipelineCache.LoadShader(L"BasicPS.cso", ps))
+		if (!m_PipelineCache.LoadShader(L"IBLPS.cso", ps))
 		{
-			ELOG("Error : D3DReadFileToBlob() Failed. path = %ls", psPath.c_str());
+			ELOG("Error : Pixel Shader Load Failed.");
 			return false;
 		}
 
@@ -948,33 +1353,65 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 			{ "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+			{ "TANGENT",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "INSTANCE_WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,  D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCE_WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCE_WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCE_WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
 		};
 
 		// パイプラインステートの設定
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
-		desc.InputLayout = { elements, 4 };
+		desc.InputLayout = { elements, _countof(elements) };
 		desc.pRootSignature = m_SceneRootSignature.GetPtr();
-		desc.VS = { pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize() };
-		desc.PS = { pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize() };
+		desc.VS = vs;
+		desc.PS = ps;
 		desc.RasterizerState = DirectX::CommonStates::CullNone;
 		desc.BlendState = DirectX::CommonStates::Opaque;
 		desc.DepthStencilState = DirectX::CommonStates::DepthDefault;
 		desc.SampleMask = UINT_MAX;
 		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
 		desc.NumRenderTargets = 1;
-		desc.RTVFormats[0] = m_SceneColorTarget.GetRTVDesc().Format;
-		desc.DSVFormat = m_SceneDepthTarget.GetDSVDesc().Format;
+		desc.RTVFormats[0] = SceneColorFormat;
+		desc.DSVFormat = SceneDepthFormat;
 		desc.SampleDesc.Count = 1;
 		desc.SampleDesc.Quality = 0;
 
 		// パイプラインステートを生成
-		hr = m_pDevice->CreateGraphicsPipelineState(
-			&desc,
-			IID_PPV_ARGS(m_pScenePSO.GetAddressOf()));
-		if (FAILED(hr))
+		if (!CreateGraphicsPipeline(m_pDevice.Get(), &m_PipelineCache, desc, m_SceneRootSignature.GetHash(), m_pScenePSO.GetAddressOf()))
+		{
+			return false;
+		}
+
+		// マテリアルをバインドレスで参照するパイプライン (ピクセルシェーダーのみ異なる)
+		if (m_SupportBindless)
+		{
+			if (!m_PipelineCache.LoadShader(L"IBLBindlessPS.cso", ps))
+			{
+				ELOG("Error : Pixel Shader Load Failed.");
+				return false;
+			}
+
+			desc.PS = ps;
+
+			if (!CreateGraphicsPipeline(m_pDevice.Get(), &m_PipelineCache, desc, m_SceneRootSignature.GetHash(), m_pSceneBindlessPSO.GetAddressOf()))
+			{
+				return false;
+			}
+		}
+
+		// シャドウマップ用パイプライン (頂点シェーダーとルートシグネチャはシーンと共通で, 深度のみ書き込む)
+		// 両面を描画し, 自己遮蔽はスロープスケールのバイアスとシェーダーの法線方向のオフセットで抑える
+		desc.PS = D3D12_SHADER_BYTECODE{};
+		desc.RasterizerState = DirectX::CommonStates::CullNone;
+		desc.RasterizerState.SlopeScaledDepthBias = 2.0f;
+		desc.RasterizerState.DepthBiasClamp = 0.01f;
+		desc.NumRenderTargets = 0;
+		desc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
+		desc.DSVFormat = ShadowMapFormat;
+
+		if (!CreateGraphicsPipeline(m_pDevice.Get(), &m_PipelineCache, desc, m_SceneRootSignature.GetHash(), m_pShadowPSO.GetAddressOf()))
 		{
-			ELOG("Error : ID3D12Device::CreateGraphicsPipelineState() Failed. retcode = 0x%x", hr);
 			return false;
 		}
 	}
@@ -982,10 +1419,12 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 	// トーンマップ用ルートシグネチャの生成
 	{
 		RootSignature::Desc desc;
-		desc.Begin(2)
+		desc.Begin(4)
 			.SetCBV(ShaderStage::PS, 0, 0)
 			.SetSRV(ShaderStage::PS, 1, 0)
-			.AddStaticSmp(ShaderStage::PS, 0, SamplerState::LinearWrap)
+			.SetSRV(ShaderStage::PS, 2, 1)
+			.SetSRV(ShaderStage::PS, 3, 2)
+			.AddStaticSmp(ShaderStage::PS, 1, SamplerState::LinearClamp)
 			.AllowIL()
 			.End();
 
@@ -998,53 +1437,34 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 
 	// トーンマップ用パイプラインステートの生成
 	{
-		std::wstring vsPath;
-		std::wstring psPath;
+		D3D12_SHADER_BYTECODE vs = {};
+		D3D12_SHADER_BYTECODE ps = {};
 
-		// 頂点シェーダを検索
-		if (!SearchFilePath(L"TonemapVS.cso", vsPath))
+		// 頂点シェーダを読み込む
+		if (!m_PipelineCache.LoadShader(L"TonemapVS.cso", vs))
 		{
-			ELOG("Error : Vertex Shader Not Found.");
+			ELOG("Error : Vertex Shader Load Failed.");
 			return false;
 		}
 
-		// ピクセルシェーダを検索
-		if (!SearchFilePath(L"TonemapPS.cso", psPath))
+		// ピクセルシェーダを読み込む
+		if (!m_PipelineCache.LoadShader(L"TonemapPS.cso", ps))
 		{
-			ELOG("Error : Pixel Shader Node Found.");
+			ELOG("Error : Pixel Shader Load Failed.");
 			return false;
 		}
 
-		ComPtr<ID3DBlob> pVSBlob;
-		ComPtr<ID3DBlob> pPSBlob;
-
-		// 頂点シェーダを読み込む
-		auto hr = D3DReadFileToBlob(vsPath.c_str(), pVSBlob.GetAddressOf());
-		if (FAILED(hr))
-		{
-			ELOG("Error : D3DReadFiledToBlob() Failed. path = %ls", vsPath.c_str());
-			return false;
-		}
-
-		// ピクセルシェーダを読み込む
-		hr = D3DReadFileToBlob(psPath.c_str(), pPSBlob.GetAddressOf());
-		if (FAILED(hr))
-		{
-			ELOG("Error : D3DReadFileToBlob() Failed. path = %ls", psPath.c_str());
-			return false;
-		}
-
-		D3D12_INPUT_ELEMENT_DESC elements[] = {
-			{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		};
+		D3D12_INPUT_ELEMENT_DESC elements[] = {
+			{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+		};
 
 		// グラフィックスパイプラインステートを設定.
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
 		desc.InputLayout = { elements, 2 };
 		desc.pRootSignature = m_TonemapRootSignature.GetPtr();
-		desc.VS = { pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize() };
-		desc.PS = { pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize() };
+		desc.VS = vs;
+		desc.PS = ps;
 		desc.RasterizerState = DirectX::CommonStates::CullNone;
 		desc.BlendState = DirectX::CommonStates::Opaque;
 		desc.DepthStencilState = DirectX::CommonStates::DepthDefault;
@@ -1057,10 +1477,8 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		desc.SampleDesc.Quality = 0;
 
 		// パイプラインステートを生成.
-		hr = m_pDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(m_pTonemapPSO.GetAddressOf()));
-		if (FAILED(hr))
+		if (!CreateGraphicsPipeline(m_pDevice.Get(), &m_PipelineCache, desc, m_TonemapRootSignature.GetHash(), m_pTonemapPSO.GetAddressOf()))
 		{
-			ELOG("Error : ID3D12Device::CreateGraphicsPipelineState() Failed. retcode = 0x%x", hr);
 			return false;
 		}
 	}
@@ -1090,7 +1508,7 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		m_QuadVB.Unmap();
 	}
 
-	for (auto i = 0; i < Constants::FrameCount; ++i)
+	for (auto i = 0; i < Constants::MaxFrameCount; ++i)
 	{
 		if (!m_TonemapCB[i].Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(CbTonemap)))
 		{
@@ -1099,9 +1517,47 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		}
 	}
 
+	// 自動露出の生成
+	if (!m_AutoExposure.Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], Constants::WindowWidth, Constants::WindowHeight, &m_PipelineCache))
+	{
+		ELOG("Error : AutoExposure::Init() Failed.");
+		return false;
+	}
+
+	m_LastFrameTime = std::chrono::steady_clock::now();
+	m_FrameBeginTime = m_LastFrameTime;
+
+	// ブルームの生成
+	if (!m_Bloom.Init(
+		m_pDevice.Get(),
+		m_pPool[POOL_TYPE_RES],
+		m_pPool[POOL_TYPE_RTV],
+		Constants::WindowWidth,
+		Constants::WindowHeight,
+		BloomParam(),
+		&m_PipelineCache))
+	{
+		ELOG("Error : Bloom::Init() Failed.");
+		return false;
+	}
+
+	// フレームグラフの構築
+	if (!BuildFrameGraph())
+	{
+		ELOG("Error : BuildFrameGraph() Failed.");
+		return false;
+	}
+
+	// トーンマップのLUTの生成 (PQ出力でも誤差が10bitの2LSB程度に収まるサイズにする)
+	if (!m_TonemapLUT.Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], TonemapLUTSizeHDR))
+	{
+		ELOG("Error : TonemapLUT::Init() Failed.");
+		return false;
+	}
+
 	// 変換行列用の定数バッファの生成.
 	{
-		for (auto i = 0u; i < Constants::FrameCount; ++i)
+		for (auto i = 0u; i < Constants::MaxFrameCount; ++i)
 		{
 			// 定数バッファ初期化.
 			if (!m_TransformCB[i].Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(CbTransform)))
@@ -1130,7 +1586,7 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 
 	// メッシュ用バッファの生成.
 	{
-		for (auto i = 0; i < Constants::FrameCount; ++i)
+		for (auto i = 0; i < Constants::MaxFrameCount; ++i)
 		{
 			if (!m_MeshCB[i].Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], sizeof(CbMesh)))
 			{
@@ -1145,29 +1601,102 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 
 	// IBLベイク処理の初期化
 	{
-		if (!m_IBLBaker.Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], m_pPool[POOL_TYPE_RTV]))
+		if (!m_IBLBaker.Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], m_pPool[POOL_TYPE_RTV], &m_PipelineCache))
 		{
 			ELOG("Error : IBLBaker::Init() Failed.");
 			return false;
 		}
+
+		if (!m_IBLBaker.InitRebake(m_pDevice.Get(), m_pQueue.Get(), IBLRebakeBudget))
+		{
+			ELOG("Error : IBLBaker::InitRebake() Failed.");
+			return false;
+		}
 	}
 
+	IBLBakerCPU iblBakerCPU;
+
 	// テクスチャのロード
 	{
+		// 元画像の .hdr / .exr があれば優先して独自デコーダーで読み込む
+		const wchar_t* sphereMapCandidates[] = {
+			L"Assets/Textures/venice_sunset_1k.hdr",
+			L"Assets/Textures/venice_sunset_1k.exr",
+			L"Assets/Textures/venice_sunset_1k.dds",
+		};
+
+		std::wstring sphereMapPath;
+		bool foundSphereMap = false;
+		for (auto candidate : sphereMapCandidates)
+		{
+			if (SearchFilePathW(candidate, sphereMapPath))
+			{
+				foundSphereMap = true;
+				break;
+			}
+		}
+
+		if (!foundSphereMap)
+		{
+			ELOG("Error : File Not Found.");
+			return false;
+		}
+
+		// CPUでキューブマップに変換 (キャッシュがあれば変換を省略)
+		SphereMapConverterCPU converter;
+		m_UseCpuCubeMap = converter.Convert(sphereMapPath.c_str());
+
+		// CPUでIBLをベイク (キャッシュがあればベイクを省略)
+		auto useCpuIBL = m_UseCpuCubeMap && iblBakerCPU.Bake(converter);
+
+		// 放射照度を球面調和関数に射影
+		if (useCpuIBL)
+		{
+			m_HasIrradianceSH = iblBakerCPU.ProjectIrradianceSH(converter, m_IrradianceSH);
+			m_UseSHIrradiance = m_HasIrradianceSH;
+		}
+
 		DirectX::ResourceUploadBatch batch(m_pDevice.Get());
 
 		// バッチ開始.
 		batch.Begin();
 
-		// スフィアマップ読み込み.
+		// キューブマップ読み込み.
+		if (m_UseCpuCubeMap)
+		{
+			if (!m_CubeMap.Init(
+				m_pDevice.Get(),
+				m_pPool[POOL_TYPE_RES],
+				converter.GetCubeMapPath().c_str(),
+				false,
+				batch))
+			{
+				ELOG("Error : Texture::Init() Failed.");
+				m_CubeMap.Term();
+				m_UseCpuCubeMap = false;
+				useCpuIBL = false;
+			}
+		}
+
+		// CPUでベイクしたIBLテクスチャ読み込み.
+		if (useCpuIBL)
 		{
-			std::wstring sphereMapPath;
-			if (!SearchFilePathW(L"Assets/Textures/venice_sunset_1k.dds", sphereMapPath))
+			if (!m_IBLBaker.LoadBakedTextures(
+				m_pDevice.Get(),
+				m_pPool[POOL_TYPE_RES],
+				iblBakerCPU.GetDFGPath().c_str(),
+				iblBakerCPU.GetDiffuseLDPath().c_str(),
+				iblBakerCPU.GetSpecularLDPath().c_str(),
+				batch))
 			{
-				ELOG("Error : File Not Found.");
+				ELOG("Error : IBLBaker::LoadBakedTextures() Failed.");
 				return false;
 			}
+		}
 
+		// スフィアマップ読み込み (GPUで変換する場合).
+		if (!m_UseCpuCubeMap)
+		{
 			// テクスチャ初期化.
 			if (!m_SphereMap.Init(
 				m_pDevice.Get(),
@@ -1188,29 +1717,41 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		future.wait();
 	}
 
-	// スフィアマップコンバーター初期化
-	if (!m_SphereMapConverter.Init(
-		m_pDevice.Get(),
-		m_pPool[POOL_TYPE_RTV],
-		m_pPool[POOL_TYPE_RES],
-		m_SphereMap.GetComPtr().Get()->GetDesc()))
+	// スフィアマップコンバーター初期化 (CPUでの変換に失敗した場合のみ)
+	if (!m_UseCpuCubeMap)
 	{
-		ELOG("Error : SphereMapConverter::Init() Failed.");
-		return false;
+		if (!m_SphereMapConverter.Init(
+			m_pDevice.Get(),
+			m_pPool[POOL_TYPE_RTV],
+			m_pPool[POOL_TYPE_RES],
+			m_SphereMap.GetComPtr().Get()->GetDesc(),
+			-1,
+			&m_PipelineCache))
+		{
+			ELOG("Error : SphereMapConverter::Init() Failed.");
+			return false;
+		}
 	}
 
 	// スカイボックス初期化
 	if (!m_SkyBox.Init(
 		m_pDevice.Get(),
 		m_pPool[POOL_TYPE_RES],
-		DXGI_FORMAT_R10G10B10A2_UNORM,
-		DXGI_FORMAT_D32_FLOAT))
+		SceneColorFormat,
+		SceneDepthFormat,
+		&m_PipelineCache))
 	{
 		ELOG("Error : SkyBox::Init() Failed.");
 		return false;
 	}
 
+	// CPUでベイクした場合はGPUでのベイクを省略する
+	// ただしCPUで新たにベイクした場合は, GPUでもベイクして結果を検証する
+	auto validateIBL = m_IBLBaker.IsBakedTextureLoaded() && !iblBakerCPU.IsCacheHit();
+	auto bakeIBL = !m_IBLBaker.IsBakedTextureLoaded() || validateIBL;
+
 	// ベイク処理を実行
+	if (bakeIBL)
 	{
 		auto pCmd = m_CommandList.Reset();
 
@@ -1221,10 +1762,13 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		pCmd->SetDescriptorHeaps(1, pHeaps);
 
 		// キューブマップに変換
-		m_SphereMapConverter.DrawToCube(pCmd, m_SphereMap.GetHandleGPU());
+		if (!m_UseCpuCubeMap)
+		{
+			m_SphereMapConverter.DrawToCube(pCmd, m_SphereMap.GetHandleGPU());
+		}
 
-		auto desc = m_SphereMapConverter.GetCubeMapDesc();
-		auto handle = m_SphereMapConverter.GetCubeMapHandleGPU();
+		auto desc = m_UseCpuCubeMap ? m_CubeMap.GetDesc() : m_SphereMapConverter.GetCubeMapDesc();
+		auto handle = GetCubeMapHandleGPU();
 
 		// DFG項を積分
 		m_IBLBaker.IntegrateDFG(pCmd);
@@ -1240,6 +1784,22 @@ bool D3D12Wrapper::InitializeGraphicsPipeline()
 		m_Fence.Sync(m_pQueue.Get());
 	}
 
+	// CPUでのベイク結果を基準にGPUでのベイク結果を検証
+	if (validateIBL)
+	{
+		CpuImage dfg;
+		CpuCubeMap diffuseLD;
+		CpuCubeMap specularLD;
+
+		if (m_IBLBaker.CaptureResults(m_pQueue.Get(), dfg, diffuseLD, specularLD))
+		{
+			iblBakerCPU.Validate(dfg, diffuseLD, specularLD);
+		}
+	}
+
+	// 新たに生成したパイプラインを次回起動時に使えるように保存 (失敗しても動作は継続する)
+	m_PipelineCache.Save();
+
 	// 開始時間を記録
 	m_StartTime = std::chrono::system_clock::now();
 
@@ -1250,7 +1810,7 @@ void D3D12Wrapper::ReleaseGraphicsResources()
 {
 	m_QuadVB.Term();
 
-	for (auto i = 0; i < Constants::FrameCount; ++i)
+	for (auto i = 0; i < Constants::MaxFrameCount; ++i)
 	{
 		m_TonemapCB[i].Term();
 		m_DirectionalLightCB[i].Term();
@@ -1259,6 +1819,32 @@ void D3D12Wrapper::ReleaseGraphicsResources()
 		m_TransformCB[i].Term();
 	}
 
+	m_ClusteredLighting.Term();
+	m_ClusterLights.clear();
+
+	for (auto i = 0; i < Constants::MaxFrameCount; ++i)
+	{
+		for (auto j = 0u; j < MaxShadowCascadeCount; ++j)
+		{
+			m_ShadowTransformCB[i][j].Term();
+		}
+	}
+
+	m_ShadowMap.Term();
+	m_ShadowCasters.clear();
+
+	for (auto i = 0; i < Constants::MaxFrameCount; ++i)
+	{
+		for (auto j = 0u; j < MaxSpotShadowRenderCount; ++j)
+		{
+			m_SpotShadowTransformCB[i][j].Term();
+		}
+	}
+
+	m_SpotShadowAtlas.Term();
+	m_SpotShadowMap.Term();
+	m_SpotShadowVisible.clear();
+
 	// メッシュの破棄
 	for (size_t i = 0; i < m_pMeshes.size(); ++i)
 	{
@@ -1267,28 +1853,42 @@ void D3D12Wrapper::ReleaseGraphicsResources()
 
 	m_pMeshes.clear();
 	m_pMeshes.shrink_to_fit();
+	m_DrawKeys.clear();
+	m_DrawKeyWork.clear();
+	m_MaterialSortIds.clear();
+	m_IndirectSources.clear();
+	m_IndirectBuckets.clear();
+	m_IndirectDraw.Term();
+	m_BindlessMaterials.Term();
 
 	// マテリアルの破棄
 	m_Material.Term();
 
-	for (auto i = 0; i < Constants::FrameCount; ++i)
+	for (auto i = 0; i < Constants::MaxFrameCount; ++i)
 	{
 		m_MeshCB[i].Term();
 	}
 
-	m_SceneColorTarget.Term();
-	m_SceneDepthTarget.Term();
+	m_FrameGraphExecutor.Term();
+	m_FrameGraph.Reset();
 
 	m_pScenePSO.Reset();
+	m_pSceneBindlessPSO.Reset();
 	m_SceneRootSignature.Term();
 
 	m_pTonemapPSO.Reset();
 	m_TonemapRootSignature.Term();
+	m_TonemapLUT.Term();
+	m_AutoExposure.Term();
+	m_Bloom.Term();
 
 	m_IBLBaker.Term();
 	m_SphereMapConverter.Term();
 	m_SphereMap.Term();
+	m_CubeMap.Term();
 	m_SkyBox.Term();
+
+	m_PipelineCache.Term();
 }
 
 void D3D12Wrapper::SetHDRSupport(bool support)
@@ -1321,14 +1921,23 @@ void D3D12Wrapper::InitializeDebug()
 
 void D3D12Wrapper::Present(uint32_t interval)
 {
+	// 記録にかかったCPU時間 (待機は含まない)
+	auto cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_FrameBeginTime).count();
+
 	// 画面に表示
 	m_pSwapChain->Present(interval, 0);
 
-	// 完了待ち
-	m_Fence.Wait(m_pQueue.Get(), INFINITE);
+	// 完了は待たずにシグナルのみ発行し, フェンス値をフレームごとに記録する
+	auto fenceValue = m_Fence.Signal(m_pQueue.Get());
+	m_FramePacer.Submit(fenceValue, cpuMilliseconds);
+
+	// 先行フレーム数を超える場合のみ待機する
+	// (先行フレーム数はフレームバッファ数以下なので, 次に使うフレームバッファの完了もこれで保証される)
+	m_Fence.WaitForValue(m_FramePacer.GetWaitValue(), INFINITE);
 
 	// フレーム番号を更新
 	m_FrameIndex = m_pSwapChain->GetCurrentBackBufferIndex();
+	m_FrameBeginTime = std::chrono::steady_clock::now();
 }
 
 void D3D12Wrapper::ChangeDisplayMode(bool hdr)
@@ -1467,79 +2076,200 @@ void D3D12Wrapper::ChangeDisplayMode(bool hdr)
 	}
 }
 
-void D3D12Wrapper::DrawScene(ID3D12GraphicsCommandList* pCmdList)
+bool D3D12Wrapper::BuildFrameGraph()
 {
-	auto currTime = std::chrono::system_clock::now();
-	auto dt = float(std::chrono::duration_cast<std::chrono::milliseconds>(currTime - m_StartTime).count()) / 1000.0f;
-	auto lightColor = CalcLightColor(dt * 0.25f);
+	if (!m_FrameGraphExecutor.Init(m_pDevice.Get(), m_pPool[POOL_TYPE_RES], m_pPool[POOL_TYPE_RTV], m_pPool[POOL_TYPE_DSV]))
+	{
+		ELOG("Error : FrameGraphExecutor::Init() Failed.");
+		return false;
+	}
 
-	// ディレクショナルライトの更新
+	m_FrameGraph.Reset();
+
+	// シーンカラー
 	{
-		auto matrix = Matrix::CreateRotationY(m_RotateAngle);
+		FrameGraphTextureDesc desc;
+		desc.Width = Constants::WindowWidth;
+		desc.Height = Constants::WindowHeight;
+		desc.Format = SceneColorFormat;
+		desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+		desc.ClearColor[0] = 0.2f;
+		desc.ClearColor[1] = 0.2f;
+		desc.ClearColor[2] = 0.2f;
+		desc.ClearColor[3] = 1.0f;
+		FrameGraphExecutor::CalcAllocationInfo(m_pDevice.Get(), desc);
 
-		auto ptr = m_DirectionalLightCB[m_FrameIndex].GetPtr<CbDirectionalLight>();
-		ptr->LightColor = Vector3(1.0f, 1.0f, 1.0f);
-		//ptr->LightForward = Vector3::TransformNormal(Vector3(0.0f, 1.0f, 1.0f), matrix);
-		ptr->LightForward = Vector3(1.0f, 1.0f, 1.0f);
-		ptr->LightIntensity = 3.0f;
+		m_SceneColorHandle = m_FrameGraph.CreateTexture("SceneColor", desc);
+	}
 
-		m_RotateAngle += 0.01f;
+	// シーン深度
+	{
+		FrameGraphTextureDesc desc;
+		desc.Width = Constants::WindowWidth;
+		desc.Height = Constants::WindowHeight;
+		desc.Format = SceneDepthFormat;
+		desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL | D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
+		desc.ClearDepth = 1.0f;
+		desc.ClearStencil = 0;
+		FrameGraphExecutor::CalcAllocationInfo(m_pDevice.Get(), desc);
+
+		m_SceneDepthHandle = m_FrameGraph.CreateTexture("SceneDepth", desc);
 	}
 
-	// ライトバッファの更新
+	// ブルームは内部で状態を管理し, 記録後はピクセルシェーダーリソースの状態になる
+	m_BloomHandle = m_FrameGraph.ImportResource(
+		"BloomResult",
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+	m_BackBufferHandle = m_FrameGraph.ImportResource(
+		"BackBuffer",
+		D3D12_RESOURCE_STATE_PRESENT,
+		D3D12_RESOURCE_STATE_PRESENT);
+
+	// シャドウマップは DepthTarget が深度書き込みの状態で生成する
+	m_ShadowMapHandle = m_FrameGraph.ImportResource(
+		"ShadowMap",
+		D3D12_RESOURCE_STATE_DEPTH_WRITE,
+		D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+	m_SpotShadowMapHandle = m_FrameGraph.ImportResource(
+		"SpotShadowMap",
+		D3D12_RESOURCE_STATE_DEPTH_WRITE,
+		D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+	// カスケードシャドウマップ (無効の場合もクリアして, 影のない状態にしておく)
+	{
+		auto pass = m_FrameGraph.AddPass("Shadow", [this](ID3D12GraphicsCommandList* pCmd)
+		{
+			UpdateShadow();
+			DrawShadow(pCmd);
+		});
+		m_FrameGraph.Write(pass, m_ShadowMapHandle, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	}
+
+	// スポットライトの影 (変化したライトと新しく割り当てたタイルのみ描画する)
+	{
+		auto pass = m_FrameGraph.AddPass("SpotShadow", [this](ID3D12GraphicsCommandList* pCmd)
+		{
+			DrawSpotShadow(pCmd);
+		});
+		m_FrameGraph.Write(pass, m_SpotShadowMapHandle, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+	}
+
+	// シーン描画
 	{
-		auto pos = Vector3(-1.5f, 0.0f, 1.5f);
-		auto dir = Vector3(1.0f, -0.1f, -1.0f);
-		dir.Normalize();
+		m_ScenePass = m_FrameGraph.AddPass("Scene", [this](ID3D12GraphicsCommandList* pCmd)
+		{
+			auto handleRTV = m_FrameGraphExecutor.GetHandleRTV(m_SceneColorHandle);
+			auto handleDSV = m_FrameGraphExecutor.GetHandleDSV(m_SceneDepthHandle);
 
-		auto ptr = m_LightCB[m_FrameIndex].GetPtr<CbLight>();
-		*ptr = ComputeSpotLight(
-			m_LightType,
-			dir,
-			pos,
-			3.0f,
-			lightColor,
-			810.0f,
-			DirectX::XMConvertToRadians(5.0f),
-			DirectX::XMConvertToRadians(20.0f));
+			// レンダーゲットの設定
+			pCmd->OMSetRenderTargets(1, &handleRTV, FALSE, &handleDSV);
+
+			// レンダーターゲットをクリア
+			m_FrameGraphExecutor.ClearView(pCmd, m_SceneColorHandle);
+			m_FrameGraphExecutor.ClearView(pCmd, m_SceneDepthHandle);
+
+			// ビューポート設定 (動的解像度の場合はシーンカラーの左上のみに描画する)
+			pCmd->RSSetViewports(1, &m_SceneViewport);
+			pCmd->RSSetScissorRects(1, &m_SceneScissor);
+
+			// 背景描画
+			m_SkyBox.Draw(pCmd, GetCubeMapHandleGPU(), m_View, m_Proj, 100.0f);
+
+			// メッシュは RecordMeshes() で別のコマンドリストに記録するので, ここでは定数バッファの更新のみ行う
+			UpdateIBL();
+		});
+		m_FrameGraph.Read(m_ScenePass, m_ShadowMapHandle, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		m_FrameGraph.Read(m_ScenePass, m_SpotShadowMapHandle, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		m_FrameGraph.Write(m_ScenePass, m_SceneColorHandle, D3D12_RESOURCE_STATE_RENDER_TARGET);
+		m_FrameGraph.Write(m_ScenePass, m_SceneDepthHandle, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 	}
 
-	// カメラバッファの更新
+	// 輝度ヒストグラム (結果は自動露出がリードバックするので副作用として扱う)
 	{
-		auto ptr = m_CameraCB[m_FrameIndex].GetPtr<CbCamera>();
-		ptr->CameraPosition = m_CameraPos;
+		auto pass = m_FrameGraph.AddPass("Histogram", [this](ID3D12GraphicsCommandList* pCmd)
+		{
+			m_AutoExposure.Dispatch(
+				pCmd,
+				m_FrameGraphExecutor.GetHandleSRV(m_SceneColorHandle),
+				m_FrameIndex,
+				uint32_t(m_SceneScissor.right),
+				uint32_t(m_SceneScissor.bottom));
+		}, true);
+		m_FrameGraph.Read(pass, m_SceneColorHandle, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 	}
 
-	// メッシュのワールド行列の更新
+	// ブルーム
 	{
-		auto ptr = m_MeshCB[m_FrameIndex].GetPtr<CbMesh>();
-		ptr->World = Matrix::Identity;
+		auto pass = m_FrameGraph.AddPass("Bloom", [this](ID3D12GraphicsCommandList* pCmd)
+		{
+			auto uvScale = Vector2(
+				m_SceneViewport.Width / float(Constants::WindowWidth),
+				m_SceneViewport.Height / float(Constants::WindowHeight));
+
+			m_Bloom.Draw(pCmd, m_FrameGraphExecutor.GetHandleSRV(m_SceneColorHandle), m_FrameIndex, uvScale);
+		});
+		m_FrameGraph.Read(pass, m_SceneColorHandle, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		m_FrameGraph.Write(pass, m_BloomHandle, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 	}
 
-	// 変換パラメータの更新
+	// トーンマップ
 	{
-		auto ptr = m_TransformCB[m_FrameIndex].GetPtr<CbTransform>();
-		ptr->View = m_View;
-		ptr->Proj = m_Proj;
+		auto pass = m_FrameGraph.AddPass("Tonemap", [this](ID3D12GraphicsCommandList* pCmd)
+		{
+			// ディスクリプタを取得
+			auto handleRTV = m_RenderTarget[m_FrameIndex].GetHandleRTV();
+			auto handleDSV = m_DepthTarget.GetHandleDSV();
+
+			// レンダーターゲットの設定
+			pCmd->OMSetRenderTargets(1, &handleRTV->HandleCPU, FALSE, &handleDSV->HandleCPU);
+
+			// レンダーターゲットをクリア
+			m_RenderTarget[m_FrameIndex].ClearView(pCmd);
+			m_DepthTarget.ClearView(pCmd);
+
+			// トーンマップを適用
+			DrawTonemap(pCmd);
+		});
+		m_FrameGraph.Read(pass, m_SceneColorHandle, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		m_FrameGraph.Read(pass, m_BloomHandle, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		m_FrameGraph.Write(pass, m_BackBufferHandle, D3D12_RESOURCE_STATE_RENDER_TARGET);
 	}
 
-	pCmdList->SetGraphicsRootSignature(m_SceneRootSignature.GetPtr());
-	pCmdList->SetGraphicsRootDescriptorTable(0, m_TransformCB[m_FrameIndex].GetHandleGPU());
-	pCmdList->SetGraphicsRootDescriptorTable(8, m_DirectionalLightCB[m_FrameIndex].GetHandleGPU());
-	pCmdList->SetGraphicsRootDescriptorTable(2, m_LightCB[m_FrameIndex].GetHandleGPU());
-	pCmdList->SetGraphicsRootDescriptorTable(3, m_CameraCB[m_FrameIndex].GetHandleGPU());
-	pCmdList->SetPipelineState(m_pScenePSO.Get());
-	pCmdList->RSSetViewports(1, &m_Viewport);
-	pCmdList->RSSetScissorRects(1, &m_Scissor);
+	if (!m_FrameGraph.Compile())
+	{
+		ELOG("Error : FrameGraph::Compile() Failed.");
+		return false;
+	}
 
-	// 描画
+#if defined(DEBUG) || defined(_DEBUG)
+	if (!m_FrameGraph.Validate())
+	{
+		ELOG("Error : FrameGraph::Validate() Failed.");
+		return false;
+	}
+#endif
+
+	if (!m_FrameGraphExecutor.Realize(&m_FrameGraph))
 	{
-		pCmdList->SetGraphicsRootDescriptorTable(1, m_MeshCB[m_FrameIndex].GetHandleGPU());
-		DrawMesh(pCmdList);
+		ELOG("Error : FrameGraphExecutor::Realize() Failed.");
+		return false;
 	}
+
+	auto& stats = m_FrameGraph.GetStats();
+	ILOG("Info : FrameGraph Compiled. passes = %u (culled %u), transitions = %u, heap = %llu / %llu bytes",
+		stats.PassCount,
+		stats.CulledPassCount,
+		stats.TransitionCount,
+		stats.HeapSize,
+		stats.UnaliasedSize);
+
+	return true;
 }
 
-void D3D12Wrapper::DrawIBL(ID3D12GraphicsCommandList* pCmdList)
+void D3D12Wrapper::UpdateIBL()
 {
 	// ライトバッファの更新
 	{
@@ -1548,12 +2278,26 @@ void D3D12Wrapper::DrawIBL(ID3D12GraphicsCommandList* pCmdList)
 		ptr->MipCount = m_IBLBaker.MipCount;
 		ptr->LightDirection = Vector3(0.0f, -1.0f, 0.0f);
 		ptr->LightIntensity = 1.0f;
+		ptr->UseSHIrradiance = m_UseSHIrradiance ? 1 : 0;
+
+		for (auto i = 0; i < 9; ++i)
+		{
+			ptr->SHCoeffs[i] = Vector4(m_IrradianceSH.Coeffs[i].x, m_IrradianceSH.Coeffs[i].y, m_IrradianceSH.Coeffs[i].z, 0.0f);
+		}
+	}
+
+	// クラスターへのライトの割り当て (無効の場合はライトなしで更新する)
+	{
+		auto count = m_UseClusteredLights ? uint32_t(m_ClusterLights.size()) : 0u;
+		m_ClusteredLighting.Update(m_FrameIndex, m_View, m_Proj, m_ClusterLights.data(), count);
 	}
 
 	// カメラバッファの更新
 	{
 		auto ptr = m_CameraCB[m_FrameIndex].GetPtr<CbCamera>();
 		ptr->CameraPosition = m_CameraPos;
+		ptr->Cluster = m_ClusteredLighting.GetShaderParams(m_SceneViewport.Width, m_SceneViewport.Height);
+		ptr->Shadow = GetShadowShaderParams(m_UseShadows ? m_ShadowCascades : nullptr, m_ShadowDesc, SunDirection, SunColor, SunIntensity);
 	}
 
 	// 変換パラメータの更新
@@ -1568,55 +2312,433 @@ void D3D12Wrapper::DrawIBL(ID3D12GraphicsCommandList* pCmdList)
 		auto ptr = m_MeshCB[m_FrameIndex].GetPtr<CbMesh>();
 		ptr->World = Matrix::Identity;
 	}
+}
+
+void D3D12Wrapper::UpdateShadow()
+{
+	if (!m_UseShadows)
+	{
+		return;
+	}
+
+	// カメラの分割範囲にカスケードを合わせ, それぞれの範囲に入るメッシュを選ぶ
+	FitShadowCascades(m_View, m_Proj, SunDirection, m_ShadowDesc, m_ShadowCasters.data(), uint32_t(m_ShadowCasters.size()), m_ShadowCascades);
+
+	for (auto i = 0u; i < m_ShadowDesc.CascadeCount; ++i)
+	{
+		CullShadowCasters(m_ShadowCascades[i], m_ShadowCasters.data(), uint32_t(m_ShadowCasters.size()), m_ShadowVisible[i]);
+
+		auto ptr = m_ShadowTransformCB[m_FrameIndex][i].GetPtr<CbTransform>();
+		ptr->View = Matrix(m_ShadowCascades[i].View);
+		ptr->Proj = Matrix(m_ShadowCascades[i].Proj);
+	}
+}
+
+void D3D12Wrapper::DrawShadow(ID3D12GraphicsCommandList* pCmdList)
+{
+	auto handleDSV = m_ShadowMap.GetHandleDSV()->HandleCPU;
+
+	pCmdList->OMSetRenderTargets(0, nullptr, FALSE, &handleDSV);
+	m_ShadowMap.ClearView(pCmdList);
+
+	if (!m_UseShadows)
+	{
+		return;
+	}
+
+	CommandRecorder recorder(pCmdList);
+
+	recorder.SetGraphicsRootSignature(m_SceneRootSignature.GetPtr());
+	recorder.SetGraphicsRootDescriptorTable(1, m_MeshCB[m_FrameIndex].GetHandleGPU());
+	recorder.SetPipelineState(m_pShadowPSO.Get());
+
+	for (auto i = 0u; i < m_ShadowDesc.CascadeCount; ++i)
+	{
+		// アトラス内のカスケードのタイルに描画する
+		uint32_t x, y;
+		GetShadowCascadeTile(i, m_ShadowDesc.Resolution, x, y);
+
+		D3D12_VIEWPORT viewport = {};
+		viewport.TopLeftX = float(x);
+		viewport.TopLeftY = float(y);
+		viewport.Width = float(m_ShadowDesc.Resolution);
+		viewport.Height = float(m_ShadowDesc.Resolution);
+		viewport.MinDepth = 0.0f;
+		viewport.MaxDepth = 1.0f;
+
+		D3D12_RECT scissor = {};
+		scissor.left = LONG(x);
+		scissor.top = LONG(y);
+		scissor.right = LONG(x + m_ShadowDesc.Resolution);
+		scissor.bottom = LONG(y + m_ShadowDesc.Resolution);
+
+		recorder.RSSetViewports(1, &viewport);
+		recorder.RSSetScissorRects(1, &scissor);
+		recorder.SetGraphicsRootDescriptorTable(0, m_ShadowTransformCB[m_FrameIndex][i].GetHandleGPU());
+
+		for (auto index : m_ShadowVisible[i])
+		{
+			auto pMesh = m_pMeshes[index];
+
+			const uint32_t constants[IndirectDrawConstantCount] = { index, pMesh->GetMaterialId() };
+			recorder.SetGraphicsRoot32BitConstants(SceneDrawConstantsParam, IndirectDrawConstantCount, constants, 0);
+			pMesh->Draw(recorder);
+		}
+	}
+
+	m_RecorderStats.Add(recorder.GetStats());
+}
+
+void D3D12Wrapper::DrawSpotShadow(ID3D12GraphicsCommandList* pCmdList)
+{
+	// 無効の場合はライトなしで更新し, 全ての影を無効にする (タイルは一定期間保持される)
+	auto count = (m_UseClusteredLights && m_UseSpotShadows) ? uint32_t(m_ClusterLights.size()) : 0u;
+
+	// タイルの大きさは動的解像度で縮小したシーンの高さに合わせる
+	m_SpotShadowAtlas.Update(m_FrameIndex, m_View, m_Proj, m_SceneViewport.Height, m_ClusterLights.data(), count, MaxSpotShadowRenderCount);
+
+	const auto& items = m_SpotShadowAtlas.GetRenderItems();
+	if (items.empty())
+	{
+		return;
+	}
+
+	auto handleDSV = m_SpotShadowMap.GetHandleDSV()->HandleCPU;
+
+	CommandRecorder recorder(pCmdList);
+
+	recorder.OMSetRenderTargets(0, nullptr, FALSE, &handleDSV);
+	recorder.SetGraphicsRootSignature(m_SceneRootSignature.GetPtr());
+	recorder.SetGraphicsRootDescriptorTable(1, m_MeshCB[m_FrameIndex].GetHandleGPU());
+	recorder.SetPipelineState(m_pShadowPSO.Get());
+
+	for (size_t i = 0; i < items.size(); ++i)
+	{
+		const auto& item = items[i];
+
+		D3D12_RECT scissor = {};
+		scissor.left = LONG(item.Tile.X);
+		scissor.top = LONG(item.Tile.Y);
+		scissor.right = LONG(item.Tile.X + item.Tile.Size);
+		scissor.bottom = LONG(item.Tile.Y + item.Tile.Size);
+
+		D3D12_VIEWPORT viewport = {};
+		viewport.TopLeftX = float(item.Tile.X);
+		viewport.TopLeftY = float(item.Tile.Y);
+		viewport.Width = float(item.Tile.Size);
+		viewport.Height = float(item.Tile.Size);
+		viewport.MinDepth = 0.0f;
+		viewport.MaxDepth = 1.0f;
+
+		// 他のライトのタイルは残すため, 描画するタイルだけクリアする
+		pCmdList->ClearDepthStencilView(handleDSV, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 1, &scissor);
+
+		auto ptr = m_SpotShadowTransformCB[m_FrameIndex][i].GetPtr<CbTransform>();
+		ptr->View = Matrix(item.View);
+		ptr->Proj = Matrix(item.Proj);
 
-	pCmdList->SetGraphicsRootSignature(m_SceneRootSignature.GetPtr());
-	pCmdList->SetGraphicsRootDescriptorTable(0, m_TransformCB[m_FrameIndex].GetHandleGPU());
-	pCmdList->SetGraphicsRootDescriptorTable(2, m_IBLCB[m_FrameIndex].GetHandleGPU());
-	pCmdList->SetGraphicsRootDescriptorTable(3, m_CameraCB[m_FrameIndex].GetHandleGPU());
-	pCmdList->SetGraphicsRootDescriptorTable(4, m_IBLBaker.GetHandleGPU_DFG());
-	pCmdList->SetGraphicsRootDescriptorTable(5, m_IBLBaker.GetHandleGPU_DiffuseLD());
-	pCmdList->SetGraphicsRootDescriptorTable(6, m_IBLBaker.GetHandleGPU_SpecularLD());
-	pCmdList->SetPipelineState(m_pScenePSO.Get());
+		recorder.RSSetViewports(1, &viewport);
+		recorder.RSSetScissorRects(1, &scissor);
+		recorder.SetGraphicsRootDescriptorTable(0, m_SpotShadowTransformCB[m_FrameIndex][i].GetHandleGPU());
+
+		CullSpotShadowCasters(m_ClusterLights[item.LightId], m_ShadowCasters.data(), uint32_t(m_ShadowCasters.size()), m_SpotShadowVisible);
+
+		for (auto index : m_SpotShadowVisible)
+		{
+			auto pMesh = m_pMeshes[index];
+
+			const uint32_t constants[IndirectDrawConstantCount] = { index, pMesh->GetMaterialId() };
+			recorder.SetGraphicsRoot32BitConstants(SceneDrawConstantsParam, IndirectDrawConstantCount, constants, 0);
+			pMesh->Draw(recorder);
+		}
+	}
+
+	m_RecorderStats.Add(recorder.GetStats());
+}
+
+void D3D12Wrapper::DrawIBL(CommandRecorder& recorder, size_t begin, size_t end)
+{
+	SetIBLState(recorder);
 
 	// 描画
+	DrawMesh(recorder, begin, end);
+}
+
+void D3D12Wrapper::SetIBLState(CommandRecorder& recorder)
+{
+	recorder.SetGraphicsRootSignature(m_SceneRootSignature.GetPtr());
+	recorder.SetGraphicsRootDescriptorTable(0, m_TransformCB[m_FrameIndex].GetHandleGPU());
+	recorder.SetGraphicsRootDescriptorTable(1, m_MeshCB[m_FrameIndex].GetHandleGPU());
+	recorder.SetGraphicsRootDescriptorTable(2, m_IBLCB[m_FrameIndex].GetHandleGPU());
+	recorder.SetGraphicsRootDescriptorTable(3, m_CameraCB[m_FrameIndex].GetHandleGPU());
+	recorder.SetGraphicsRootDescriptorTable(4, m_IBLBaker.GetHandleGPU_DFG());
+	recorder.SetGraphicsRootDescriptorTable(5, m_IBLBaker.GetHandleGPU_DiffuseLD());
+	recorder.SetGraphicsRootDescriptorTable(6, m_IBLBaker.GetHandleGPU_SpecularLD());
+
+	// クラスタードライティングのバッファ
+	m_ClusteredLighting.SetRootParameters(recorder, m_FrameIndex, SceneClusterLightParam, SceneClusterRangeParam, SceneClusterIndexParam);
+
+	// カスケードシャドウマップ
+	recorder.SetGraphicsRootDescriptorTable(SceneShadowMapParam, m_ShadowMap.GetHandleSRV()->HandleGPU);
+
+	// スポットライトの影
+	m_SpotShadowAtlas.SetRootParameter(recorder, m_FrameIndex, SceneSpotShadowDataParam);
+	recorder.SetGraphicsRootDescriptorTable(SceneSpotShadowMapParam, m_SpotShadowMap.GetHandleSRV()->HandleGPU);
+
+	// バインドレス用のテクスチャ配列はヒープの先頭から始まる (テクスチャの番号はヒープ内の番号)
+	if (m_SupportBindless)
 	{
-		pCmdList->SetGraphicsRootDescriptorTable(1, m_MeshCB[m_FrameIndex].GetHandleGPU());
-		DrawMesh(pCmdList);
+		recorder.SetGraphicsRootDescriptorTable(SceneTextureArrayParam, m_pPool[POOL_TYPE_RES]->GetHeap()->GetGPUDescriptorHandleForHeapStart());
+		recorder.SetGraphicsRootDescriptorTable(SceneMaterialTableParam, m_BindlessMaterials.GetHandleGPU());
 	}
 }
 
-void D3D12Wrapper::DrawMesh(ID3D12GraphicsCommandList* pCmdList)
+void D3D12Wrapper::DrawMesh(CommandRecorder& recorder, size_t begin, size_t end)
 {
+	ID3D12PipelineState* const pPipelines[] = {
+		m_pScenePSO.Get(),			// ScenePipelineIBL
+		m_pSceneBindlessPSO.Get(),	// ScenePipelineBindless
+	};
+
+	// ソートキーの順に描画し, パイプラインとマテリアルはキーのフィールドが変化した場合のみ設定する
+	// アトラスを共有するマテリアルは同じハンドルになるので, ハンドルが変化しない設定はレコーダーが省略する
+	const Material::TEXTURE_USAGE usages[3] = { TU_BASE_COLOR, TU_ORM, TU_NORMAL };
+
+	DrawKeyFields prev;
+
+	for (auto i = begin; i < end; ++i)
+	{
+		auto fields = DecodeDrawKey(m_DrawKeys[i]);
+		auto pMesh = m_pMeshes[fields.Mesh];
+		auto pipelineChanged = (i == begin || fields.Pipeline != prev.Pipeline);
+
+		// パイプラインを設定
+		if (pipelineChanged && fields.Pipeline < _countof(pPipelines))
+		{
+			recorder.SetPipelineState(pPipelines[fields.Pipeline]);
+		}
+
+		// テクスチャを設定 (バインドレスの場合はルート定数のマテリアル番号からシェーダーが参照する)
+		if (fields.Pipeline != ScenePipelineBindless && (pipelineChanged || fields.Material != prev.Material))
+		{
+			auto id = pMesh->GetMaterialId();
+
+			for (auto j = 0; j < 3; ++j)
+			{
+				recorder.SetGraphicsRootDescriptorTable(UINT(7 + j), m_Material.GetTextureHandle(id, usages[j]));
+			}
+		}
+
+		// メッシュを描画 (間接描画と同じく描画番号とマテリアル番号をルート定数で渡す)
+		const uint32_t constants[IndirectDrawConstantCount] = { fields.Mesh, pMesh->GetMaterialId() };
+		recorder.SetGraphicsRoot32BitConstants(SceneDrawConstantsParam, IndirectDrawConstantCount, constants, 0);
+		pMesh->Draw(recorder);
+
+		prev = fields;
+	}
+}
+
+uint32_t D3D12Wrapper::RecordMeshes(uint32_t order)
+{
+	auto meshCount = m_DrawKeys.size();
+	if (meshCount == 0)
+	{
+		return order;
+	}
+
+	// リストの数はスレッド数までに抑え, リストごとに別のスレッド番号を割り当てる
+	auto maxListCount = (meshCount + MinMeshesPerCommandList - 1) / MinMeshesPerCommandList;
+	auto listCount = uint32_t(std::min<size_t>(maxListCount, m_CommandListPool.GetThreadCount()));
+	auto meshesPerList = (meshCount + listCount - 1) / listCount;
+
+	auto handleRTV = m_FrameGraphExecutor.GetHandleRTV(m_SceneColorHandle);
+	auto handleDSV = m_FrameGraphExecutor.GetHandleDSV(m_SceneDepthHandle);
+
+	ID3D12DescriptorHeap* const pHeaps[] = {
+		m_pPool[POOL_TYPE_RES]->GetHeap()
+	};
+
+	// 統計値はリストごとに書き込み, 記録が終わってから合計する
+	m_ListRecorderStats.assign(listCount, CommandRecorderStats());
+
+	ParallelFor(0, listCount, [&](uint32_t index)
+	{
+		auto begin = index * meshesPerList;
+		auto end = std::min(begin + meshesPerList, meshCount);
+
+		auto pCmd = m_CommandListPool.Allocate(index, order + index);
+		if (pCmd == nullptr)
+		{
+			return;
+		}
+
+		// コマンドリスト間で状態は引き継がれないので, リストごとにレコーダーを用意して設定し直す
+		CommandRecorder recorder(pCmd);
+		recorder.SetDescriptorHeaps(1, pHeaps);
+		recorder.OMSetRenderTargets(1, &handleRTV, FALSE, &handleDSV);
+		recorder.RSSetViewports(1, &m_SceneViewport);
+		recorder.RSSetScissorRects(1, &m_SceneScissor);
+
+		DrawIBL(recorder, begin, end);
+
+		pCmd->Close();
+
+		m_ListRecorderStats[index] = recorder.GetStats();
+	}, listCount);
+
+	for (const auto& stats : m_ListRecorderStats)
+	{
+		m_RecorderStats.Add(stats);
+	}
+
+	return order + listCount;
+}
+
+uint32_t D3D12Wrapper::RecordMeshesIndirect(uint32_t order)
+{
+	auto drawCount = m_DrawKeys.size();
+	auto pArgs = m_IndirectDraw.GetArgs(m_FrameIndex);
+	if (drawCount == 0 || pArgs == nullptr)
+	{
+		return order;
+	}
+
+	// 引数レコードをソート順に書き込む (フレームごとの領域なので, GPUが参照中の領域は上書きしない)
+	// バインドレスの場合はマテリアルもルート定数で切り替わるので, パイプラインごとに1回の発行で済む
+	BuildIndirectDrawBuckets(m_DrawKeys.data(), drawCount, m_IndirectBuckets, !m_UseBindless);
+	WriteIndirectDrawArgsParallel(m_DrawKeys.data(), drawCount, m_IndirectSources.data(), pArgs);
+
+	auto pCmd = m_CommandListPool.Allocate(0, order);
+	if (pCmd == nullptr)
+	{
+		return order;
+	}
+
+	ID3D12DescriptorHeap* const pHeaps[] = {
+		m_pPool[POOL_TYPE_RES]->GetHeap()
+	};
+
+	ID3D12PipelineState* const pPipelines[] = {
+		m_pScenePSO.Get(),			// ScenePipelineIBL
+		m_pSceneBindlessPSO.Get(),	// ScenePipelineBindless
+	};
+
+	auto handleRTV = m_FrameGraphExecutor.GetHandleRTV(m_SceneColorHandle);
+	auto handleDSV = m_FrameGraphExecutor.GetHandleDSV(m_SceneDepthHandle);
+
+	CommandRecorder recorder(pCmd);
+	recorder.SetDescriptorHeaps(1, pHeaps);
+	recorder.OMSetRenderTargets(1, &handleRTV, FALSE, &handleDSV);
+	recorder.RSSetViewports(1, &m_SceneViewport);
+	recorder.RSSetScissorRects(1, &m_SceneScissor);
+	recorder.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	SetIBLState(recorder);
+
+	// ディスクリプタテーブルはコマンドシグネチャで変更できないので, マテリアルごとに分けて発行する
+	const Material::TEXTURE_USAGE usages[3] = { TU_BASE_COLOR, TU_ORM, TU_NORMAL };
+
+	for (size_t i = 0; i < m_IndirectBuckets.size(); ++i)
+	{
+		const auto& bucket = m_IndirectBuckets[i];
+
+		if ((i == 0 || bucket.Pipeline != m_IndirectBuckets[i - 1].Pipeline) && bucket.Pipeline < _countof(pPipelines))
+		{
+			recorder.SetPipelineState(pPipelines[bucket.Pipeline]);
+		}
+
+		// アトラスを共有するマテリアルはハンドルが同じなので, レコーダーが省略する
+		if (bucket.Pipeline != ScenePipelineBindless)
+		{
+			auto id = m_pMeshes[bucket.FirstMesh]->GetMaterialId();
+			for (auto j = 0; j < 3; ++j)
+			{
+				recorder.SetGraphicsRootDescriptorTable(UINT(7 + j), m_Material.GetTextureHandle(id, usages[j]));
+			}
+		}
+
+		// コマンドシグネチャは頂点/インデックスバッファとルート定数をレコーダーを通さずに変更するので,
+		// 発行後はレコーダーが覚えている状態を破棄し, 次の設定を省略しないようにする
+		m_IndirectDraw.Execute(pCmd, m_FrameIndex, bucket.Offset, bucket.Count);
+		recorder.Invalidate();
+	}
+
+	pCmd->Close();
+
+	m_RecorderStats.Add(recorder.GetStats());
+
+	return order + 1;
+}
+
+void D3D12Wrapper::UpdateSceneViewport()
+{
+	// 無効の場合は最大解像度で描画する
+	auto scale = m_UseDynamicResolution ? m_DynamicResolution.GetScale() : 1.0f;
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	ComputeDynamicResolutionSize(scale, Constants::WindowWidth, Constants::WindowHeight, width, height);
+
+	// シーンカラーは最大解像度のまま, 左上の範囲に描画してトーンマップで拡大する
+	m_SceneViewport = m_Viewport;
+	m_SceneViewport.Width = static_cast<float>(width);
+	m_SceneViewport.Height = static_cast<float>(height);
+
+	m_SceneScissor = m_Scissor;
+	m_SceneScissor.right = LONG(width);
+	m_SceneScissor.bottom = LONG(height);
+}
+
+void D3D12Wrapper::BuildDrawKeys()
+{
+	m_DrawKeys.resize(m_pMeshes.size());
+
 	for (size_t i = 0; i < m_pMeshes.size(); ++i)
 	{
-		// マテリアルIDを取得
-		auto id = m_pMeshes[i]->GetMaterialId();
+		auto pMesh = m_pMeshes[i];
+		auto id = pMesh->GetMaterialId();
+
+		// 中心は全てのインスタンスを含むバウンディングボックスから求めている (メッシュのワールド行列は単位行列)
+		auto viewPos = Vector3::Transform(Vector3(pMesh->GetCenter()), m_View);
 
-		// テクスチャを設定
-		pCmdList->SetGraphicsRootDescriptorTable(7, m_Material.GetTextureHandle(id, TU_BASE_COLOR));
-		pCmdList->SetGraphicsRootDescriptorTable(8, m_Material.GetTextureHandle(id, TU_METALLIC));
-		pCmdList->SetGraphicsRootDescriptorTable(9, m_Material.GetTextureHandle(id, TU_ROUGHNESS));
-		pCmdList->SetGraphicsRootDescriptorTable(10, m_Material.GetTextureHandle(id, TU_NORMAL));
+		DrawKeyFields fields;
+		fields.Pass = DrawPassOpaque;
+		fields.Pipeline = m_UseBindless ? ScenePipelineBindless : ScenePipelineIBL;
+		fields.Material = (id < m_MaterialSortIds.size()) ? m_MaterialSortIds[id] : 0;
+		fields.Depth = QuantizeDrawDepth(-viewPos.z, SceneNearZ, SceneFarZ, false);	// 不透明は手前から描画する
+		fields.Mesh = uint32_t(i);
 
-		// メッシュを描画
-		m_pMeshes[i]->Draw(pCmdList);
+		m_DrawKeys[i] = EncodeDrawKey(fields);
 	}
 }
 
 void D3D12Wrapper::DrawTonemap(ID3D12GraphicsCommandList* pCmdList)
 {
-	// 定数バッファ更新
+	// 定数バッファ更新 (LUTの座標の変換は表のLUTのパラメータに合わせる)
 	{
+		auto lutParam = m_TonemapLUT.GetCoordParam();
+
 		auto ptr = m_TonemapCB[m_FrameIndex].GetPtr<CbTonemap>();
 		ptr->Type = m_TonemapType;
 		ptr->ColorSpace = m_ColorSpace;
 		ptr->BaseLuminance = m_BaseLuminance;
 		ptr->MaxLuminance = m_MaxLuminance;
+		ptr->LutOffset = lutParam.x;
+		ptr->LutLog2Min = lutParam.y;
+		ptr->LutInvLog2Range = lutParam.z;
+		ptr->LutUVScale = lutParam.w;
+		ptr->Exposure = m_Exposure;
+		ptr->BloomIntensity = m_Bloom.GetParam().Intensity;
+		ptr->SceneUVScale = Vector2(
+			m_SceneViewport.Width / float(Constants::WindowWidth),
+			m_SceneViewport.Height / float(Constants::WindowHeight));
 	}
 
 	pCmdList->SetGraphicsRootSignature(m_TonemapRootSignature.GetPtr());
 	pCmdList->SetGraphicsRootDescriptorTable(0, m_TonemapCB[m_FrameIndex].GetHandleGPU());
-	pCmdList->SetGraphicsRootDescriptorTable(1, m_SceneColorTarget.GetHandleSRV()->HandleGPU);
+	pCmdList->SetGraphicsRootDescriptorTable(1, m_FrameGraphExecutor.GetHandleSRV(m_SceneColorHandle));
+	pCmdList->SetGraphicsRootDescriptorTable(2, m_TonemapLUT.GetHandleGPU());
+	pCmdList->SetGraphicsRootDescriptorTable(3, m_Bloom.GetHandleGPU());
 
 	pCmdList->SetPipelineState(m_pTonemapPSO.Get());
 	pCmdList->RSSetViewports(1, &m_Viewport);
@@ -1627,3 +2749,13 @@ void D3D12Wrapper::DrawTonemap(ID3D12GraphicsCommandList* pCmdList)
 	pCmdList->IASetVertexBuffers(0, 1, &vbView);
 	pCmdList->DrawInstanced(3, 1, 0, 0);
 }
+
+D3D12_GPU_DESCRIPTOR_HANDLE D3D12Wrapper::GetCubeMapHandleGPU() const
+{
+	if (m_UseCpuCubeMap)
+	{
+		return m_CubeMap.GetHandleGPU();
+	}
+
+	return m_SphereMapConverter.GetCubeMapHandleGPU();
+}
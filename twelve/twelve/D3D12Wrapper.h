@@ -14,16 +14,33 @@
 #include "ColorTarget.h"
 #include "DepthTarget.h"
 #include "CommandList.h"
+#include "CommandListPool.h"
 #include "Fence.h"
 #include "Mesh.h"
 #include "ConstantBuffer.h"
 #include "Texture.h"
 #include "Material.h"
+#include "BindlessMaterial.h"
+#include "ClusteredLighting.h"
+#include "CascadedShadow.h"
+#include "ShadowAtlas.h"
 #include "RootSignature.h"
 #include "InlineUtil.h"
 #include "SphereMapConverter.h"
+#include "SphereMapConverterCPU.h"
+#include "IBLBakerCPU.h"
 #include "IBLBaker.h"
 #include "SkyBox.h"
+#include "TonemapLUT.h"
+#include "AutoExposure.h"
+#include "Bloom.h"
+#include "FrameGraph.h"
+#include "FrameGraphExecutor.h"
+#include "PipelineCache.h"
+#include "FramePacer.h"
+#include "IndirectDraw.h"
+#include "GpuTimer.h"
+#include "DynamicResolution.h"
 
 struct InputState;
 
@@ -33,7 +50,13 @@ public:
 	D3D12Wrapper();
 	~D3D12Wrapper();
 
-	bool Initialize(HWND hWind);
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="hWind">ウィンドウハンドル</param>
+	/// <param name="frameCount">フレームバッファ数 (Constants::MinFrameCount ～ Constants::MaxFrameCount に丸める)</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Initialize(HWND hWind, uint32_t frameCount = Constants::DefaultFrameCount);
 	void Terminate();
 	void Render();
 
@@ -62,34 +85,81 @@ private:
 	ComPtr<ID3D12Device>                m_pDevice;
 	ComPtr<ID3D12CommandQueue>          m_pQueue;
 	ComPtr<IDXGISwapChain4>             m_pSwapChain;
-	ColorTarget						    m_RenderTarget[Constants::FrameCount];
+	ColorTarget						    m_RenderTarget[Constants::MaxFrameCount];
+	uint32_t							m_FrameCount;			// フレームバッファ数 (同時に処理するフレーム数)
 	DepthTarget							m_DepthTarget;
 	DescriptorPool* m_pPool[POOL_COUNT];
 	CommandList							m_CommandList;
+	CommandListPool						m_CommandListPool;		// 描画用のスレッドごとのコマンドリスト
 	Fence								m_Fence;
+	FramePacer							m_FramePacer;			// フレームごとのフェンス値と先行フレーム数の管理
+	GpuTimer							m_GpuTimer;				// フレームごとのGPU時間の計測
+	DynamicResolutionController			m_DynamicResolution;	// GPU時間からシーンの描画解像度のスケールを決める
+	bool								m_UseDynamicResolution;	// 動的解像度を使うかどうか
 	uint32_t                            m_FrameIndex;
 	D3D12_VIEWPORT						m_Viewport;
 	D3D12_RECT							m_Scissor;
+	D3D12_VIEWPORT						m_SceneViewport;		// シーンの描画範囲 (動的解像度の場合はシーンカラーの左上に縮小する)
+	D3D12_RECT							m_SceneScissor;
 	DXGI_FORMAT							m_BackBufferFormat;
 
-
+	PipelineCache						m_PipelineCache;
 	ComPtr<ID3D12PipelineState>         m_pScenePSO;
+	ComPtr<ID3D12PipelineState>         m_pSceneBindlessPSO;	// マテリアルをバインドレスで参照するシーン用パイプライン
+	ComPtr<ID3D12PipelineState>         m_pShadowPSO;			// シャドウマップ用パイプライン (深度のみ)
 	RootSignature                       m_SceneRootSignature;
 	ComPtr<ID3D12PipelineState>         m_pTonemapPSO;
 	RootSignature                       m_TonemapRootSignature;
-	ColorTarget						    m_SceneColorTarget;
-	DepthTarget							m_SceneDepthTarget;
 	VertexBuffer					    m_QuadVB;
 	VertexBuffer                        m_WallVB;
 	VertexBuffer	                    m_FloorVB;
-	ConstantBuffer                      m_TonemapCB[Constants::FrameCount];
-	ConstantBuffer					    m_DirectionalLightCB[Constants::FrameCount];
-	ConstantBuffer                      m_LightCB[Constants::FrameCount];
-	ConstantBuffer					    m_IBLCB[Constants::FrameCount];
-	ConstantBuffer                      m_CameraCB[Constants::FrameCount];
-	ConstantBuffer                      m_TransformCB[Constants::FrameCount];
-	ConstantBuffer                      m_MeshCB[Constants::FrameCount];
+	ConstantBuffer                      m_TonemapCB[Constants::MaxFrameCount];
+	TonemapLUT							m_TonemapLUT;			// トーンマップのLUT
+	AutoExposure						m_AutoExposure;			// 自動露出
+	Bloom								m_Bloom;				// ブルーム
+	FrameGraph							m_FrameGraph;			// シーンからトーンマップまでのフレームグラフ
+	FrameGraphExecutor					m_FrameGraphExecutor;	// フレームグラフの一時テクスチャとバリアの実行
+	FrameGraphHandle					m_SceneColorHandle;		// シーンカラー (一時テクスチャ)
+	FrameGraphHandle					m_SceneDepthHandle;		// シーン深度 (一時テクスチャ)
+	FrameGraphHandle					m_BloomHandle;			// ブルームの結果 (インポート)
+	FrameGraphHandle					m_BackBufferHandle;		// バックバッファ (インポート)
+	FrameGraphHandle					m_ShadowMapHandle;		// シャドウマップのアトラス (インポート)
+	FrameGraphHandle					m_SpotShadowMapHandle;	// スポットライトの影のアトラス (インポート)
+	uint32_t							m_ScenePass;			// シーン描画のパス番号 (この後にメッシュの描画を挟む)
+	ConstantBuffer					    m_DirectionalLightCB[Constants::MaxFrameCount];
+	ConstantBuffer                      m_LightCB[Constants::MaxFrameCount];
+	ConstantBuffer					    m_IBLCB[Constants::MaxFrameCount];
+	ConstantBuffer                      m_CameraCB[Constants::MaxFrameCount];
+	ConstantBuffer                      m_TransformCB[Constants::MaxFrameCount];
+	ConstantBuffer                      m_MeshCB[Constants::MaxFrameCount];
 	std::vector<Mesh*>					m_pMeshes;
+	std::vector<uint32_t>				m_MaterialSortIds;		// マテリアルごとのソート用の番号 (同じディスクリプタテーブルのものは同じ番号)
+	std::vector<uint64_t>				m_DrawKeys;				// 描画ソートキー (描画順)
+	std::vector<uint64_t>				m_DrawKeyWork;			// 描画ソートキーの並べ替えの作業領域
+	IndirectDrawBuffer					m_IndirectDraw;			// 間接描画のコマンドシグネチャと引数バッファ
+	std::vector<IndirectDrawSource>		m_IndirectSources;		// メッシュごとの間接描画の元データ
+	std::vector<IndirectDrawBucket>		m_IndirectBuckets;		// ExecuteIndirect() ごとの描画範囲
+	std::vector<CommandRecorderStats>	m_ListRecorderStats;	// コマンドリストごとの状態設定の統計値 (ワーカースレッドごとに書き込む)
+	CommandRecorderStats				m_RecorderStats;		// 前回のフレームの状態設定の発行数と省略数
+	bool								m_UseIndirectDraw;		// メッシュを ExecuteIndirect() で描画するかどうか
+	BindlessMaterialTable				m_BindlessMaterials;	// バインドレス描画で参照するマテリアルのデータ
+	bool								m_SupportBindless;		// バインドレス描画に対応しているかどうか (Resource Binding Tier 2 以上)
+	bool								m_UseBindless;			// マテリアルをバインドレスで参照するかどうか
+	ClusteredLighting					m_ClusteredLighting;	// クラスタードライティングのライトの割り当てとバッファ
+	std::vector<ClusterLight>			m_ClusterLights;		// クラスタードライティングのライト
+	bool								m_UseClusteredLights;	// クラスタードライティングを行うかどうか
+	DepthTarget							m_ShadowMap;			// カスケードシャドウマップのアトラス (2x2 のタイルにカスケードを並べる)
+	ConstantBuffer						m_ShadowTransformCB[Constants::MaxFrameCount][MaxShadowCascadeCount];	// カスケードごとの変換行列
+	ShadowCascadeDesc					m_ShadowDesc;			// カスケードの構成設定
+	ShadowCascade						m_ShadowCascades[MaxShadowCascadeCount];	// 今回のフレームのカスケード
+	std::vector<ShadowCasterBounds>		m_ShadowCasters;		// 影を落とすメッシュのバウンディングボックス (メッシュと同じ並び)
+	std::vector<uint32_t>				m_ShadowVisible[MaxShadowCascadeCount];	// カスケードごとの影を落とすメッシュの番号
+	bool								m_UseShadows;			// 太陽光と影を描画するかどうか
+	DepthTarget							m_SpotShadowMap;		// スポットライトの影のアトラス (フレームをまたいで内容を保持する)
+	SpotShadowAtlas						m_SpotShadowAtlas;		// スポットライトの影のタイルの割り当てと影のデータ
+	ConstantBuffer						m_SpotShadowTransformCB[Constants::MaxFrameCount][MaxSpotShadowRenderCount];	// 描画するタイルごとの変換行列
+	std::vector<uint32_t>				m_SpotShadowVisible;	// 作業領域 : タイルに影を落とすメッシュの番号
+	bool								m_UseSpotShadows;		// クラスタードライティングのスポットライトに影を付けるかどうか
 	Material							m_Material;
 
 	float								m_RotateAngle;
@@ -102,9 +172,15 @@ private:
 	float								m_BaseLuminance;		// 基準輝度値
 	float								m_MaxLuminance;			// 最大輝度値
 	float								m_Exposure;				// 露光値
+	bool								m_UseAutoExposure;		// 自動露出を使うかどうか
 	int                                 m_LightType;            // ライトの種類
 
 	Texture								m_SphereMap;
+	Texture								m_CubeMap;				// CPUで変換したキューブマップ
+	bool								m_UseCpuCubeMap;		// CPUで変換したキューブマップを使用するかどうか
+	SH9Color							m_IrradianceSH;			// 放射照度 / π の球面調和関数の係数
+	bool								m_HasIrradianceSH;		// 球面調和関数の係数が求まっているかどうか
+	bool								m_UseSHIrradiance;		// ディフューズIBLを球面調和関数で評価するかどうか
 	SphereMapConverter					m_SphereMapConverter;
 	IBLBaker							m_IBLBaker;
 	SkyBox								m_SkyBox;
@@ -117,14 +193,28 @@ private:
 	float								m_CameraDistance;
 
 	std::chrono::system_clock::time_point m_StartTime;
+	std::chrono::steady_clock::time_point m_LastFrameTime;		// 前回のフレームの開始時刻
+	std::chrono::steady_clock::time_point m_FrameBeginTime;		// このフレームの記録の開始時刻 (待機の後)
 
 	void InitializeDebug();
 	void Present(uint32_t interval);
 
 	void ChangeDisplayMode(bool hdr);
 
-	void DrawScene(ID3D12GraphicsCommandList* pCmdList);
-	void DrawIBL(ID3D12GraphicsCommandList* pCmdList);
-	void DrawMesh(ID3D12GraphicsCommandList* pCmdList);
+	bool BuildFrameGraph();
+
+	void UpdateIBL();
+	void DrawIBL(CommandRecorder& recorder, size_t begin, size_t end);
+	void SetIBLState(CommandRecorder& recorder);
+	void UpdateShadow();
+	void DrawShadow(ID3D12GraphicsCommandList* pCmdList);
+	void DrawSpotShadow(ID3D12GraphicsCommandList* pCmdList);
+	void DrawMesh(CommandRecorder& recorder, size_t begin, size_t end);
+	uint32_t RecordMeshes(uint32_t order);
+	uint32_t RecordMeshesIndirect(uint32_t order);
+	void BuildDrawKeys();
+	void UpdateSceneViewport();
 	void DrawTonemap(ID3D12GraphicsCommandList* pCmdList);
+
+	D3D12_GPU_DESCRIPTOR_HANDLE GetCubeMapHandleGPU() const;
 };
@@ -3,6 +3,44 @@
 #include "DescriptorPool.h"
 #include "Logger.h"
 
+namespace
+{
+	/// <summary>
+	/// 深度フォーマットに対応するリソースのフォーマットとシェーダリソースビューのフォーマットを求める
+	/// 深度フォーマットのリソースにはシェーダリソースビューを作れないので, タイプレスで生成する
+	/// </summary>
+	void GetDepthResourceFormats(DXGI_FORMAT format, DXGI_FORMAT& resourceFormat, DXGI_FORMAT& srvFormat)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_D32_FLOAT:
+			resourceFormat = DXGI_FORMAT_R32_TYPELESS;
+			srvFormat = DXGI_FORMAT_R32_FLOAT;
+			break;
+
+		case DXGI_FORMAT_D24_UNORM_S8_UINT:
+			resourceFormat = DXGI_FORMAT_R24G8_TYPELESS;
+			srvFormat = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+			break;
+
+		case DXGI_FORMAT_D16_UNORM:
+			resourceFormat = DXGI_FORMAT_R16_TYPELESS;
+			srvFormat = DXGI_FORMAT_R16_UNORM;
+			break;
+
+		case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+			resourceFormat = DXGI_FORMAT_R32G8X24_TYPELESS;
+			srvFormat = DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS;
+			break;
+
+		default:
+			resourceFormat = format;
+			srvFormat = format;
+			break;
+		}
+	}
+}
+
 DepthTarget::DepthTarget()
 	: m_pTarget(nullptr)
 	, m_pHandleDSV(nullptr)
@@ -61,6 +99,14 @@ bool DepthTarget::Init(ID3D12Device* pDevice, DescriptorPool* pPoolDSV, Descript
 	prop.CreationNodeMask = 1;
 	prop.VisibleNodeMask = 1;
 
+	// シェーダリソースビューを作る場合はタイプレスで生成する
+	auto resourceFormat = format;
+	auto srvFormat = format;
+	if (m_pHandleSRV != nullptr)
+	{
+		GetDepthResourceFormats(format, resourceFormat, srvFormat);
+	}
+
 	// リソースの設定
 	D3D12_RESOURCE_DESC desc = {};
 	desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
@@ -69,7 +115,7 @@ bool DepthTarget::Init(ID3D12Device* pDevice, DescriptorPool* pPoolDSV, Descript
 	desc.Height = height;
 	desc.DepthOrArraySize = 1;
 	desc.MipLevels = 1;
-	desc.Format = format;
+	desc.Format = resourceFormat;
 	desc.SampleDesc.Count = 1;
 	desc.SampleDesc.Quality = 0;
 	desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
@@ -109,7 +155,7 @@ bool DepthTarget::Init(ID3D12Device* pDevice, DescriptorPool* pPoolDSV, Descript
 	// シェーダリソースビュー
 	if (m_pHandleSRV != nullptr)
 	{
-		m_SRVDesc.Format = format;
+		m_SRVDesc.Format = srvFormat;
 		m_SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
 		m_SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 		m_SRVDesc.Texture2D.MipLevels = 1;
@@ -123,6 +123,28 @@ uint32_t DescriptorPool::GetHandleCount() const
 	return m_Pool.GetSize();
 }
 
+uint32_t DescriptorPool::GetHandleIndex(D3D12_GPU_DESCRIPTOR_HANDLE handle) const
+{
+	if (handle.ptr == 0 || m_DescriptorSize == 0 || !(m_pHeap->GetDesc().Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE))
+	{
+		return UINT32_MAX;
+	}
+
+	auto start = m_pHeap->GetGPUDescriptorHandleForHeapStart();
+	if (handle.ptr < start.ptr)
+	{
+		return UINT32_MAX;
+	}
+
+	auto index = (handle.ptr - start.ptr) / m_DescriptorSize;
+	if (index >= m_Pool.GetSize())
+	{
+		return UINT32_MAX;
+	}
+
+	return uint32_t(index);
+}
+
 ID3D12DescriptorHeap* const DescriptorPool::GetHeap() const
 {
 	return m_pHeap.Get();
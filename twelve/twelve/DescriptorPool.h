@@ -77,6 +77,13 @@ public:
 	/// <returns></returns>
 	uint32_t GetHandleCount() const;
 
+	/// <summary>
+	/// ハンドルのヒープ先頭からの番号を取得する (バインドレスでディスクリプタを参照する添え字に使う)
+	/// </summary>
+	/// <param name="handle">このプールで割り当てたGPUディスクリプタハンドル</param>
+	/// <returns>ヒープ内の番号 (このプールのハンドルでない場合は UINT32_MAX)</returns>
+	uint32_t GetHandleIndex(D3D12_GPU_DESCRIPTOR_HANDLE handle) const;
+
 	/// <summary>
 	/// ディスクリプタヒープを取得する
 	/// </summary>
@@ -0,0 +1,278 @@
+﻿#include "DrawSortKey.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ParallelFor.h"
+
+namespace
+{
+	// 1パスで処理する桁のビット数 (ヒストグラムが L1 キャッシュに収まる大きさにする)
+	constexpr uint32_t RadixBits = 11;
+	constexpr uint32_t RadixSize = 1u << RadixBits;
+	constexpr uint32_t RadixPassCount = (64 + RadixBits - 1) / RadixBits;
+
+	// 並列化するスレッドあたりの最小のキー数 (これより少ない場合はスレッドの起動コストが上回る)
+	constexpr size_t MinKeysPerThread = 16384;
+
+	inline uint32_t GetDigit(uint64_t key, uint32_t pass)
+	{
+		return uint32_t(key >> (pass * RadixBits)) & (RadixSize - 1);
+	}
+
+	/// <summary>
+	/// 全パスのヒストグラムを1回の走査で求める (hist は RadixPassCount * RadixSize 個)
+	/// </summary>
+	void AddHistograms(const uint64_t* pKeys, size_t count, uint32_t* pHist)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto key = pKeys[i];
+			for (auto pass = 0u; pass < RadixPassCount; ++pass)
+			{
+				pHist[pass * RadixSize + GetDigit(key, pass)]++;
+			}
+		}
+	}
+
+	/// <summary>
+	/// 全てのキーが同じ桁を持つ (並べ替えても順序が変わらない) パスかどうか
+	/// </summary>
+	bool IsTrivialPass(const uint32_t* pHist, size_t count)
+	{
+		for (auto i = 0u; i < RadixSize; ++i)
+		{
+			if (pHist[i] != 0)
+			{
+				return pHist[i] == count;
+			}
+		}
+		return true;
+	}
+}
+
+uint32_t QuantizeDrawDepth(float viewDepth, float nearZ, float farZ, bool backToFront)
+{
+	const auto maxBucket = (1u << DrawKeyDepthBits) - 1;
+
+	if (nearZ <= 0.0f || farZ <= nearZ)
+	{
+		return 0;
+	}
+
+	auto t = 0.0f;
+	if (viewDepth >= farZ)
+	{
+		t = 1.0f;
+	}
+	else if (viewDepth > nearZ)
+	{
+		t = std::log(viewDepth / nearZ) / std::log(farZ / nearZ);
+	}
+
+	auto bucket = std::min(uint32_t(t * float(maxBucket) + 0.5f), maxBucket);
+	return backToFront ? maxBucket - bucket : bucket;
+}
+
+void RadixSortDrawKeys(std::vector<uint64_t>& keys, std::vector<uint64_t>& work)
+{
+	const auto count = keys.size();
+	if (count < 2)
+	{
+		return;
+	}
+
+	work.resize(count);
+
+	std::vector<uint32_t> hist(RadixPassCount * RadixSize, 0);
+	AddHistograms(keys.data(), count, hist.data());
+
+	auto pSrc = keys.data();
+	auto pDst = work.data();
+
+	std::vector<uint32_t> offsets(RadixSize);
+
+	for (auto pass = 0u; pass < RadixPassCount; ++pass)
+	{
+		const auto pHist = &hist[pass * RadixSize];
+		if (IsTrivialPass(pHist, count))
+		{
+			continue;
+		}
+
+		uint32_t sum = 0;
+		for (auto d = 0u; d < RadixSize; ++d)
+		{
+			offsets[d] = sum;
+			sum += pHist[d];
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto key = pSrc[i];
+			pDst[offsets[GetDigit(key, pass)]++] = key;
+		}
+
+		std::swap(pSrc, pDst);
+	}
+
+	// 奇数回書き込んだ場合は結果が作業領域にある
+	if (pSrc != keys.data())
+	{
+		keys.swap(work);
+	}
+}
+
+void RadixSortDrawKeysParallel(std::vector<uint64_t>& keys, std::vector<uint64_t>& work, uint32_t threadCount)
+{
+	const auto count = keys.size();
+
+	if (threadCount == 0)
+	{
+		threadCount = GetWorkerThreadCount();
+	}
+
+	auto chunkCount = uint32_t(std::min<size_t>(threadCount, (count + MinKeysPerThread - 1) / MinKeysPerThread));
+	if (chunkCount <= 1)
+	{
+		RadixSortDrawKeys(keys, work);
+		return;
+	}
+
+	work.resize(count);
+
+	const auto chunkSize = (count + chunkCount - 1) / chunkCount;
+	auto getRange = [&](uint32_t chunk, size_t& begin, size_t& end)
+	{
+		begin = std::min(size_t(chunk) * chunkSize, count);
+		end = std::min(begin + chunkSize, count);
+	};
+
+	// 全体のヒストグラムは並べ替えても変わらないので, 省略するパスの判定用に最初に求める
+	std::vector<uint32_t> chunkHist(size_t(chunkCount) * RadixPassCount * RadixSize, 0);
+	ParallelFor(0, chunkCount, [&](uint32_t chunk)
+	{
+		size_t begin, end;
+		getRange(chunk, begin, end);
+		AddHistograms(keys.data() + begin, end - begin, &chunkHist[size_t(chunk) * RadixPassCount * RadixSize]);
+	}, chunkCount);
+
+	std::vector<uint32_t> hist(RadixPassCount * RadixSize, 0);
+	for (auto chunk = 0u; chunk < chunkCount; ++chunk)
+	{
+		const auto pChunk = &chunkHist[size_t(chunk) * RadixPassCount * RadixSize];
+		for (size_t i = 0; i < hist.size(); ++i)
+		{
+			hist[i] += pChunk[i];
+		}
+	}
+
+	auto pSrc = keys.data();
+	auto pDst = work.data();
+
+	// offsets[chunk][digit] : 範囲ごとの書き込み位置
+	std::vector<uint32_t> offsets(size_t(chunkCount) * RadixSize);
+	auto firstPass = true;
+
+	for (auto pass = 0u; pass < RadixPassCount; ++pass)
+	{
+		if (IsTrivialPass(&hist[pass * RadixSize], count))
+		{
+			continue;
+		}
+
+		// 範囲ごとのヒストグラム (最初のパスは求めたものを使い, 以降は並べ替えで範囲の中身が変わるので数え直す)
+		if (firstPass)
+		{
+			for (auto chunk = 0u; chunk < chunkCount; ++chunk)
+			{
+				std::copy_n(
+					&chunkHist[(size_t(chunk) * RadixPassCount + pass) * RadixSize],
+					RadixSize,
+					&offsets[size_t(chunk) * RadixSize]);
+			}
+		}
+		else
+		{
+			ParallelFor(0, chunkCount, [&](uint32_t chunk)
+			{
+				size_t begin, end;
+				getRange(chunk, begin, end);
+
+				auto pOffsets = &offsets[size_t(chunk) * RadixSize];
+				std::fill_n(pOffsets, RadixSize, 0u);
+				for (auto i = begin; i < end; ++i)
+				{
+					pOffsets[GetDigit(pSrc[i], pass)]++;
+				}
+			}, chunkCount);
+		}
+		firstPass = false;
+
+		// 桁の順, 同じ桁の中では範囲の順に書き込み位置を割り当てる (安定ソートになる)
+		uint32_t sum = 0;
+		for (auto d = 0u; d < RadixSize; ++d)
+		{
+			for (auto chunk = 0u; chunk < chunkCount; ++chunk)
+			{
+				auto& offset = offsets[size_t(chunk) * RadixSize + d];
+				auto n = offset;
+				offset = sum;
+				sum += n;
+			}
+		}
+
+		ParallelFor(0, chunkCount, [&](uint32_t chunk)
+		{
+			size_t begin, end;
+			getRange(chunk, begin, end);
+
+			auto pOffsets = &offsets[size_t(chunk) * RadixSize];
+			for (auto i = begin; i < end; ++i)
+			{
+				auto key = pSrc[i];
+				pDst[pOffsets[GetDigit(key, pass)]++] = key;
+			}
+		}, chunkCount);
+
+		std::swap(pSrc, pDst);
+	}
+
+	if (pSrc != keys.data())
+	{
+		keys.swap(work);
+	}
+}
+
+DrawStateChanges CountDrawStateChanges(const uint64_t* pKeys, size_t count)
+{
+	DrawStateChanges result;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto curr = DecodeDrawKey(pKeys[i]);
+		if (i == 0)
+		{
+			result.Pass++;
+			result.Pipeline++;
+			result.Material++;
+			continue;
+		}
+
+		auto prev = DecodeDrawKey(pKeys[i - 1]);
+		if (curr.Pass != prev.Pass)
+		{
+			result.Pass++;
+		}
+		if (curr.Pipeline != prev.Pipeline)
+		{
+			result.Pipeline++;
+		}
+		if (curr.Material != prev.Material)
+		{
+			result.Material++;
+		}
+	}
+
+	return result;
+}
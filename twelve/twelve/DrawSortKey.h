@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 描画ソートキーのビット配置 (上位から パス | パイプライン | マテリアル | 深度 | メッシュ)
+// 上位のフィールドほど切り替えのコストが大きいので, 昇順に並べると同じ状態の描画がまとまる
+constexpr uint32_t DrawKeyPassBits = 4;
+constexpr uint32_t DrawKeyPipelineBits = 10;
+constexpr uint32_t DrawKeyMaterialBits = 16;
+constexpr uint32_t DrawKeyDepthBits = 14;
+constexpr uint32_t DrawKeyMeshBits = 20;
+
+constexpr uint32_t DrawKeyMeshShift = 0;
+constexpr uint32_t DrawKeyDepthShift = DrawKeyMeshShift + DrawKeyMeshBits;
+constexpr uint32_t DrawKeyMaterialShift = DrawKeyDepthShift + DrawKeyDepthBits;
+constexpr uint32_t DrawKeyPipelineShift = DrawKeyMaterialShift + DrawKeyMaterialBits;
+constexpr uint32_t DrawKeyPassShift = DrawKeyPipelineShift + DrawKeyPipelineBits;
+
+static_assert(DrawKeyPassShift + DrawKeyPassBits == 64, "Draw key layout must fill 64 bits.");
+
+/// <summary>
+/// 描画ソートキーの各フィールド
+/// </summary>
+struct DrawKeyFields
+{
+	uint32_t	Pass = 0;		// 描画パス
+	uint32_t	Pipeline = 0;	// パイプラインステートの番号
+	uint32_t	Material = 0;	// マテリアル (ディスクリプタテーブル) の番号
+	uint32_t	Depth = 0;		// 深度のバケット (QuantizeDrawDepth())
+	uint32_t	Mesh = 0;		// メッシュの番号 (描画リストの添え字)
+};
+
+/// <summary>
+/// フィールドの値を取り出す
+/// </summary>
+inline uint32_t GetDrawKeyField(uint64_t key, uint32_t shift, uint32_t bits)
+{
+	return uint32_t((key >> shift) & ((uint64_t(1) << bits) - 1));
+}
+
+/// <summary>
+/// 描画ソートキーを作る (各フィールドはビット数を超える部分を切り捨てる)
+/// </summary>
+inline uint64_t EncodeDrawKey(const DrawKeyFields& fields)
+{
+	auto field = [](uint32_t value, uint32_t shift, uint32_t bits)
+	{
+		return (uint64_t(value) & ((uint64_t(1) << bits) - 1)) << shift;
+	};
+
+	return field(fields.Pass, DrawKeyPassShift, DrawKeyPassBits)
+		| field(fields.Pipeline, DrawKeyPipelineShift, DrawKeyPipelineBits)
+		| field(fields.Material, DrawKeyMaterialShift, DrawKeyMaterialBits)
+		| field(fields.Depth, DrawKeyDepthShift, DrawKeyDepthBits)
+		| field(fields.Mesh, DrawKeyMeshShift, DrawKeyMeshBits);
+}
+
+/// <summary>
+/// 描画ソートキーを各フィールドに分解する
+/// </summary>
+inline DrawKeyFields DecodeDrawKey(uint64_t key)
+{
+	DrawKeyFields fields;
+	fields.Pass = GetDrawKeyField(key, DrawKeyPassShift, DrawKeyPassBits);
+	fields.Pipeline = GetDrawKeyField(key, DrawKeyPipelineShift, DrawKeyPipelineBits);
+	fields.Material = GetDrawKeyField(key, DrawKeyMaterialShift, DrawKeyMaterialBits);
+	fields.Depth = GetDrawKeyField(key, DrawKeyDepthShift, DrawKeyDepthBits);
+	fields.Mesh = GetDrawKeyField(key, DrawKeyMeshShift, DrawKeyMeshBits);
+	return fields;
+}
+
+/// <summary>
+/// ビュー空間の深度をバケットに量子化する
+/// 遠くほど粗くなるように対数で分割する
+/// </summary>
+/// <param name="viewDepth">ビュー空間の深度 (カメラからの距離)</param>
+/// <param name="nearZ">近クリップ面</param>
+/// <param name="farZ">遠クリップ面</param>
+/// <param name="backToFront">奥から手前の順にする場合はtrue (半透明用)</param>
+/// <returns>深度のバケット</returns>
+uint32_t QuantizeDrawDepth(float viewDepth, float nearZ, float farZ, bool backToFront);
+
+/// <summary>
+/// 描画ソートキーを昇順に並べ替える (LSD基数ソート, 11ビットずつ6パス)
+/// 全てのキーで桁が同じパスは省略するので, 上位のフィールドが揃っている場合は速くなる
+/// </summary>
+/// <param name="keys">キー</param>
+/// <param name="work">作業領域 (キーと同じ数に拡張する)</param>
+void RadixSortDrawKeys(std::vector<uint64_t>& keys, std::vector<uint64_t>& work);
+
+/// <summary>
+/// 描画ソートキーを並列に並べ替える
+/// キーを連続した範囲に分け, 範囲ごとのヒストグラムから書き込み位置を決めて並列に書き込む (結果は RadixSortDrawKeys() と同じ)
+/// </summary>
+/// <param name="keys">キー</param>
+/// <param name="work">作業領域 (キーと同じ数に拡張する)</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+void RadixSortDrawKeysParallel(std::vector<uint64_t>& keys, std::vector<uint64_t>& work, uint32_t threadCount = 0);
+
+/// <summary>
+/// 描画順に処理した場合の状態の切り替え回数
+/// </summary>
+struct DrawStateChanges
+{
+	uint32_t	Pass = 0;
+	uint32_t	Pipeline = 0;
+	uint32_t	Material = 0;
+
+	uint32_t GetTotal() const { return Pass + Pipeline + Material; }
+};
+
+/// <summary>
+/// 隣り合うキーでフィールドが変わる回数を数える (最初の描画は全て切り替えとして数える)
+/// </summary>
+/// <param name="pKeys">描画順のキー</param>
+/// <param name="count">キーの数</param>
+/// <returns>切り替え回数</returns>
+DrawStateChanges CountDrawStateChanges(const uint64_t* pKeys, size_t count);
@@ -0,0 +1,119 @@
+﻿#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Logger.h"
+
+namespace
+{
+	// 1回の更新で変える画素数の倍率の範囲 (計測の外れ値で極端に変えない)
+	constexpr double MinAreaRatio = 0.5;
+	constexpr double MaxAreaRatio = 1.5;
+}
+
+DynamicResolutionController::DynamicResolutionController()
+	: m_Area(1.0)
+	, m_Error{ 0.0, 0.0 }
+	, m_Scale(1.0f)
+{
+}
+
+DynamicResolutionController::~DynamicResolutionController()
+{
+	Term();
+}
+
+bool DynamicResolutionController::Init(const DynamicResolutionDesc& desc)
+{
+	if (desc.TargetMilliseconds <= 0.0 ||
+		desc.MinScale <= 0.0f ||
+		desc.MaxScale < desc.MinScale ||
+		desc.ScaleStep <= 0.0f ||
+		desc.IncreaseRate < 0.0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	m_Desc = desc;
+	Reset();
+
+	return true;
+}
+
+void DynamicResolutionController::Term()
+{
+	m_Desc = DynamicResolutionDesc();
+	Reset();
+}
+
+void DynamicResolutionController::Reset()
+{
+	m_Scale = m_Desc.MaxScale;
+	m_Area = double(m_Scale) * double(m_Scale);
+	m_Error[0] = 0.0;
+	m_Error[1] = 0.0;
+}
+
+float DynamicResolutionController::Update(double gpuMilliseconds)
+{
+	if (gpuMilliseconds <= 0.0)
+	{
+		return m_Scale;
+	}
+
+	// 余裕がある場合に正となる誤差 (目標に対する割合)
+	auto error = (m_Desc.TargetMilliseconds - gpuMilliseconds) / m_Desc.TargetMilliseconds;
+	error = std::max(-1.0, std::min(error, 1.0));
+
+	// 目標付近の揺らぎでは変更しない
+	// 誤差の履歴も破棄し, 不感帯に入った時の誤差の変化が比例項と微分項で逆向きの変化にならないようにする
+	if (std::abs(error) <= m_Desc.DeadZone)
+	{
+		m_Error[0] = 0.0;
+		m_Error[1] = 0.0;
+		return m_Scale;
+	}
+
+	// 速度形のPID: 積分項は誤差そのもの, 比例項は誤差の変化, 微分項は誤差の変化の変化で倍率を更新する
+	auto delta = m_Desc.Ki * error
+		+ m_Desc.Kp * (error - m_Error[0])
+		+ m_Desc.Kd * (error - 2.0 * m_Error[0] + m_Error[1]);
+
+	m_Error[1] = m_Error[0];
+	m_Error[0] = error;
+
+	// 予算超過は直ちに解消し, 解像度を上げる方向はゆっくり戻す
+	if (delta > 0.0)
+	{
+		delta *= m_Desc.IncreaseRate;
+	}
+
+	auto minArea = double(m_Desc.MinScale) * double(m_Desc.MinScale);
+	auto maxArea = double(m_Desc.MaxScale) * double(m_Desc.MaxScale);
+
+	auto ratio = std::max(MinAreaRatio, std::min(1.0 + delta, MaxAreaRatio));
+	m_Area = std::max(minArea, std::min(m_Area * ratio, maxArea));
+
+	// 刻み以上の差が付いた場合のみ反映する (反映後も端は上下限に合わせる)
+	auto scale = float(std::sqrt(m_Area));
+	if (std::abs(scale - m_Scale) >= m_Desc.ScaleStep || scale <= m_Desc.MinScale || scale >= m_Desc.MaxScale)
+	{
+		auto quantized = std::round(scale / m_Desc.ScaleStep) * m_Desc.ScaleStep;
+		m_Scale = std::max(m_Desc.MinScale, std::min(quantized, m_Desc.MaxScale));
+	}
+
+	return m_Scale;
+}
+
+void ComputeDynamicResolutionSize(float scale, uint32_t maxWidth, uint32_t maxHeight, uint32_t& width, uint32_t& height)
+{
+	scale = std::max(0.0f, std::min(scale, 1.0f));
+
+	width = uint32_t(std::lround(float(maxWidth) * scale));
+	height = uint32_t(std::lround(float(maxHeight) * scale));
+
+	width = std::max(1u, std::min(width, maxWidth));
+	height = std::max(1u, std::min(height, maxHeight));
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <cstdint>
+
+/// <summary>
+/// 動的解像度の設定
+/// </summary>
+struct DynamicResolutionDesc
+{
+	double	TargetMilliseconds = 14.0;	// GPU時間の目標 [ms] (60Hzの周期に揺らぎの分の余裕を残す)
+	float	MinScale = 0.5f;			// 解像度のスケールの下限 (縦横それぞれに掛ける)
+	float	MaxScale = 1.0f;			// 解像度のスケールの上限
+	float	ScaleStep = 1.0f / 32.0f;	// スケールの刻み (これより小さな変化は反映しない)
+	double	Kp = 0.1;					// 比例ゲイン
+	double	Ki = 0.15;					// 積分ゲイン
+	double	Kd = 0.02;					// 微分ゲイン
+	double	DeadZone = 0.05;			// 目標との差 (目標に対する割合) がこれ以下の場合は変更しない
+	double	IncreaseRate = 0.5;			// 解像度を上げる方向の変化に掛ける係数 (下げる方向は直ちに下げる)
+};
+
+/// <summary>
+/// GPU時間から動的解像度のスケールを求めるコントローラー (デバイスに依存しない部分)
+/// 画素数 (スケールの2乗) に比例してGPU時間が変わるとみなし, 目標との差 (割合) から画素数の倍率を速度形のPIDで更新する
+/// 画素数は上下限でクランプするので, 積分項が飽和して戻りが遅れることはない
+/// </summary>
+class DynamicResolutionController
+{
+public:
+	DynamicResolutionController();
+	~DynamicResolutionController();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="desc">設定</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Init(const DynamicResolutionDesc& desc);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// スケールを上限に戻し, 履歴を破棄する
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// 完了したフレームのGPU時間からスケールを更新する
+	/// </summary>
+	/// <param name="gpuMilliseconds">GPU時間 [ms]</param>
+	/// <returns>更新後のスケール</returns>
+	float Update(double gpuMilliseconds);
+
+	float GetScale() const { return m_Scale; }
+	const DynamicResolutionDesc& GetDesc() const { return m_Desc; }
+
+private:
+	DynamicResolutionDesc	m_Desc;			// 設定
+	double					m_Area;			// 画素数の倍率 (量子化前のスケールの2乗)
+	double					m_Error[2];		// 前回と前々回の誤差
+	float					m_Scale;		// 量子化したスケール
+};
+
+/// <summary>
+/// スケールを適用した描画範囲の大きさを求める (1ピクセル以上, 最大サイズ以下)
+/// </summary>
+/// <param name="scale">解像度のスケール</param>
+/// <param name="maxWidth">最大の幅</param>
+/// <param name="maxHeight">最大の高さ</param>
+/// <param name="width">描画範囲の幅の格納先</param>
+/// <param name="height">描画範囲の高さの格納先</param>
+void ComputeDynamicResolutionSize(float scale, uint32_t maxWidth, uint32_t maxHeight, uint32_t& width, uint32_t& height);
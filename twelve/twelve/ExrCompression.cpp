@@ -0,0 +1,712 @@
+﻿#include "ExrCompression.h"
+
+#include <cstring>
+#include <vector>
+
+#include "InflateUtil.h"
+
+namespace
+{
+	const uint32_t HufEncBits = 16;							// 符号化するシンボルのビット数
+	const uint32_t HufDecBits = 14;							// テーブル引きで復号する符号長の最大値
+	const uint32_t HufEncSize = (1 << HufEncBits) + 1;		// シンボル数 (ランレングス用のシンボルを含む)
+	const uint32_t HufDecSize = 1 << HufDecBits;
+	const uint32_t HufDecMask = HufDecSize - 1;
+	const int ShortZeroCodeRun = 59;
+	const int LongZeroCodeRun = 63;
+	const int ShortestLongRun = 2 + LongZeroCodeRun - ShortZeroCodeRun;
+	const uint32_t UShortRange = 1 << 16;
+	const uint32_t BitmapSize = UShortRange >> 3;
+
+	/// <summary>
+	/// 差分予測を元に戻し, 前半と後半に分けて格納されたバイト列を交互に並べ直す (ZIP / RLE 共通の後処理)
+	/// </summary>
+	void ReconstructBytes(uint8_t* pTmp, uint8_t* pDst, size_t size)
+	{
+		for (size_t i = 1; i < size; ++i)
+		{
+			pTmp[i] = uint8_t(int(pTmp[i - 1]) + int(pTmp[i]) - 128);
+		}
+
+		const uint8_t* t1 = pTmp;
+		const uint8_t* t2 = pTmp + (size + 1) / 2;
+		for (size_t i = 0; i < size; ++i)
+		{
+			pDst[i] = (i & 1) ? *t2++ : *t1++;
+		}
+	}
+
+	// ---- PIZ : ハフマン符号 ----
+
+	inline uint32_t ReadUInt32(const uint8_t* p)
+	{
+		return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+	}
+
+	inline int HufLength(int64_t code) { return int(code & 63); }
+	inline int64_t HufCode(int64_t code) { return code >> 6; }
+
+	/// <summary>
+	/// MSBから順に読み出すビットリーダー (OpenEXR のハフマン符号用)
+	/// </summary>
+	struct HufBitReader
+	{
+		const uint8_t*	pCur;
+		const uint8_t*	pEnd;
+		uint64_t		Buffer;
+		int				Count;
+
+		bool GetChar()
+		{
+			if (pCur >= pEnd)
+			{
+				return false;
+			}
+
+			Buffer = (Buffer << 8) | *pCur++;
+			Count += 8;
+			return true;
+		}
+
+		bool GetBits(int bits, int64_t& value)
+		{
+			while (Count < bits)
+			{
+				if (!GetChar())
+				{
+					return false;
+				}
+			}
+
+			Count -= bits;
+			value = int64_t((Buffer >> Count) & ((uint64_t(1) << bits) - 1));
+			return true;
+		}
+	};
+
+	/// <summary>
+	/// 符号長の一覧から正準ハフマン符号を求める
+	/// 結果は (符号 << 6) | 符号長 の形式で格納する
+	/// </summary>
+	void BuildCanonicalCodeTable(int64_t* hcode)
+	{
+		int64_t n[59] = {};
+		for (auto i = 0u; i < HufEncSize; ++i)
+		{
+			n[hcode[i]] += 1;
+		}
+
+		int64_t c = 0;
+		for (auto i = 58; i > 0; --i)
+		{
+			auto nc = (c + n[i]) >> 1;
+			n[i] = c;
+			c = nc;
+		}
+
+		for (auto i = 0u; i < HufEncSize; ++i)
+		{
+			auto l = int(hcode[i]);
+			if (l > 0)
+			{
+				hcode[i] = l | (n[l]++ << 6);
+			}
+		}
+	}
+
+	/// <summary>
+	/// 符号長の一覧を読み込む
+	/// </summary>
+	bool UnpackEncodingTable(HufBitReader& reader, uint32_t im, uint32_t iM, int64_t* hcode)
+	{
+		for (; im <= iM; im++)
+		{
+			int64_t l = 0;
+			if (!reader.GetBits(6, l))
+			{
+				return false;
+			}
+
+			hcode[im] = l;
+
+			if (l == LongZeroCodeRun)
+			{
+				int64_t run = 0;
+				if (!reader.GetBits(8, run))
+				{
+					return false;
+				}
+
+				run += ShortestLongRun;
+				if (im + run > iM + 1)
+				{
+					return false;
+				}
+
+				while (run-- > 0)
+				{
+					hcode[im++] = 0;
+				}
+				im--;
+			}
+			else if (l >= ShortZeroCodeRun)
+			{
+				auto run = l - ShortZeroCodeRun + 2;
+				if (im + run > iM + 1)
+				{
+					return false;
+				}
+
+				while (run-- > 0)
+				{
+					hcode[im++] = 0;
+				}
+				im--;
+			}
+		}
+
+		BuildCanonicalCodeTable(hcode);
+		return true;
+	}
+
+	/// <summary>
+	/// 復号テーブルのエントリ
+	/// Length が0の場合は HufDecBits より長い符号の候補を LongSymbols[First] から Literal 個持つ
+	/// </summary>
+	struct HufDecodeEntry
+	{
+		int			Length;
+		int			Literal;
+		uint32_t	First;
+	};
+
+	bool BuildDecodingTable(
+		const int64_t* hcode,
+		uint32_t im,
+		uint32_t iM,
+		std::vector<HufDecodeEntry>& table,
+		std::vector<int>& longSymbols)
+	{
+		table.assign(HufDecSize, HufDecodeEntry{ 0, 0, 0 });
+
+		// 長い符号の候補数を数えてから格納先を割り当てる
+		for (auto i = im; i <= iM; ++i)
+		{
+			auto c = HufCode(hcode[i]);
+			auto l = HufLength(hcode[i]);
+
+			if ((c >> l) != 0)
+			{
+				return false;
+			}
+
+			if (l > int(HufDecBits))
+			{
+				auto& entry = table[size_t(c >> (l - HufDecBits))];
+				if (entry.Length != 0)
+				{
+					return false;
+				}
+
+				entry.Literal++;
+			}
+			else if (l != 0)
+			{
+				auto first = size_t(c << (HufDecBits - l));
+				auto count = size_t(1) << (HufDecBits - l);
+				for (auto j = first; j < first + count; ++j)
+				{
+					auto& entry = table[j];
+					if (entry.Length != 0 || entry.Literal != 0)
+					{
+						return false;
+					}
+
+					entry.Length = l;
+					entry.Literal = int(i);
+				}
+			}
+		}
+
+		uint32_t total = 0;
+		for (auto& entry : table)
+		{
+			if (entry.Length == 0)
+			{
+				entry.First = total;
+				total += uint32_t(entry.Literal);
+				entry.Literal = 0;
+			}
+		}
+
+		longSymbols.resize(total);
+
+		for (auto i = im; i <= iM; ++i)
+		{
+			auto l = HufLength(hcode[i]);
+			if (l > int(HufDecBits))
+			{
+				auto& entry = table[size_t(HufCode(hcode[i]) >> (l - HufDecBits))];
+				longSymbols[entry.First + entry.Literal] = int(i);
+				entry.Literal++;
+			}
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// 復号したシンボルを出力する (ランレングス用のシンボルの場合は直前の値を繰り返す)
+	/// </summary>
+	inline bool EmitSymbol(int symbol, int rlc, HufBitReader& reader, uint16_t*& pOut, const uint16_t* pBegin, const uint16_t* pEnd)
+	{
+		if (symbol == rlc)
+		{
+			if (reader.Count < 8 && !reader.GetChar())
+			{
+				return false;
+			}
+
+			reader.Count -= 8;
+			auto count = uint8_t(reader.Buffer >> reader.Count);
+
+			if (pOut + count > pEnd || pOut == pBegin)
+			{
+				return false;
+			}
+
+			auto value = pOut[-1];
+			while (count-- > 0)
+			{
+				*pOut++ = value;
+			}
+		}
+		else
+		{
+			if (pOut >= pEnd)
+			{
+				return false;
+			}
+
+			*pOut++ = uint16_t(symbol);
+		}
+
+		return true;
+	}
+
+	bool HufDecode(
+		const int64_t* hcode,
+		const std::vector<HufDecodeEntry>& table,
+		const std::vector<int>& longSymbols,
+		const uint8_t* pSrc,
+		uint32_t bitCount,
+		int rlc,
+		uint16_t* pOut,
+		size_t outCount)
+	{
+		HufBitReader reader = { pSrc, pSrc + (bitCount + 7) / 8, 0, 0 };
+		auto pBegin = pOut;
+		auto pEnd = pOut + outCount;
+
+		while (reader.pCur < reader.pEnd)
+		{
+			reader.GetChar();
+
+			while (reader.Count >= int(HufDecBits))
+			{
+				const auto& entry = table[size_t((reader.Buffer >> (reader.Count - HufDecBits)) & HufDecMask)];
+
+				if (entry.Length != 0)
+				{
+					reader.Count -= entry.Length;
+					if (!EmitSymbol(entry.Literal, rlc, reader, pOut, pBegin, pEnd))
+					{
+						return false;
+					}
+					continue;
+				}
+
+				if (entry.Literal == 0)
+				{
+					return false;
+				}
+
+				// 長い符号は候補を順に照合する
+				auto found = false;
+				for (auto j = 0; j < entry.Literal; ++j)
+				{
+					auto symbol = longSymbols[entry.First + j];
+					auto l = HufLength(hcode[symbol]);
+
+					while (reader.Count < l && reader.pCur < reader.pEnd)
+					{
+						reader.GetChar();
+					}
+
+					if (reader.Count >= l
+						&& HufCode(hcode[symbol]) == int64_t((reader.Buffer >> (reader.Count - l)) & ((uint64_t(1) << l) - 1)))
+					{
+						reader.Count -= l;
+						if (!EmitSymbol(symbol, rlc, reader, pOut, pBegin, pEnd))
+						{
+							return false;
+						}
+
+						found = true;
+						break;
+					}
+				}
+
+				if (!found)
+				{
+					return false;
+				}
+			}
+		}
+
+		// 末尾の端数ビットを処理する
+		auto i = (8 - int(bitCount)) & 7;
+		reader.Buffer >>= i;
+		reader.Count -= i;
+
+		while (reader.Count > 0)
+		{
+			const auto& entry = table[size_t((reader.Buffer << (HufDecBits - reader.Count)) & HufDecMask)];
+			if (entry.Length == 0 || entry.Length > reader.Count)
+			{
+				return false;
+			}
+
+			reader.Count -= entry.Length;
+			if (!EmitSymbol(entry.Literal, rlc, reader, pOut, pBegin, pEnd))
+			{
+				return false;
+			}
+		}
+
+		return pOut == pEnd;
+	}
+
+	bool HufUncompress(const uint8_t* pSrc, size_t srcSize, uint16_t* pOut, size_t outCount)
+	{
+		if (srcSize == 0)
+		{
+			return outCount == 0;
+		}
+
+		if (srcSize < 20)
+		{
+			return false;
+		}
+
+		auto im = ReadUInt32(pSrc);
+		auto iM = ReadUInt32(pSrc + 4);
+		auto bitCount = ReadUInt32(pSrc + 12);
+
+		if (im >= HufEncSize || iM >= HufEncSize || im > iM)
+		{
+			return false;
+		}
+
+		HufBitReader reader = { pSrc + 20, pSrc + srcSize, 0, 0 };
+
+		std::vector<int64_t> hcode(HufEncSize, 0);
+		if (!UnpackEncodingTable(reader, im, iM, hcode.data()))
+		{
+			return false;
+		}
+
+		if (uint64_t(bitCount) > 8 * uint64_t(reader.pEnd - reader.pCur))
+		{
+			return false;
+		}
+
+		std::vector<HufDecodeEntry> table;
+		std::vector<int> longSymbols;
+		if (!BuildDecodingTable(hcode.data(), im, iM, table, longSymbols))
+		{
+			return false;
+		}
+
+		return HufDecode(hcode.data(), table, longSymbols, reader.pCur, bitCount, int(iM), pOut, outCount);
+	}
+
+	// ---- PIZ : ウェーブレット変換 ----
+
+	inline void Wdec14(uint16_t l, uint16_t h, uint16_t& a, uint16_t& b)
+	{
+		auto ls = int16_t(l);
+		auto hs = int16_t(h);
+		int hi = hs;
+		int ai = ls + (hi & 1) + (hi >> 1);
+
+		a = uint16_t(int16_t(ai));
+		b = uint16_t(int16_t(ai - hi));
+	}
+
+	inline void Wdec16(uint16_t l, uint16_t h, uint16_t& a, uint16_t& b)
+	{
+		const int ModMask = (1 << 16) - 1;
+		const int AOffset = 1 << 15;
+
+		int m = l;
+		int d = h;
+		int bb = (m - (d >> 1)) & ModMask;
+		int aa = (d + bb - AOffset) & ModMask;
+
+		b = uint16_t(bb);
+		a = uint16_t(aa);
+	}
+
+	inline void Wdec(bool w14, uint16_t l, uint16_t h, uint16_t& a, uint16_t& b)
+	{
+		if (w14)
+		{
+			Wdec14(l, h, a, b);
+		}
+		else
+		{
+			Wdec16(l, h, a, b);
+		}
+	}
+
+	/// <summary>
+	/// 2次元ウェーブレット変換を元に戻す
+	/// </summary>
+	void Wav2Decode(uint16_t* pIn, int nx, int ox, int ny, int oy, uint16_t maxValue)
+	{
+		auto w14 = (maxValue < (1 << 14));
+		auto n = (nx > ny) ? ny : nx;
+		auto p = 1;
+
+		while (p <= n)
+		{
+			p <<= 1;
+		}
+
+		p >>= 1;
+		auto p2 = p;
+		p >>= 1;
+
+		while (p >= 1)
+		{
+			auto py = pIn;
+			auto ey = pIn + oy * (ny - p2);
+			auto oy1 = oy * p;
+			auto oy2 = oy * p2;
+			auto ox1 = ox * p;
+			auto ox2 = ox * p2;
+			uint16_t i00, i01, i10, i11;
+
+			for (; py <= ey; py += oy2)
+			{
+				auto px = py;
+				auto ex = py + ox * (nx - p2);
+
+				for (; px <= ex; px += ox2)
+				{
+					auto p01 = px + ox1;
+					auto p10 = px + oy1;
+					auto p11 = p10 + ox1;
+
+					Wdec(w14, *px, *p10, i00, i10);
+					Wdec(w14, *p01, *p11, i01, i11);
+					Wdec(w14, i00, i01, *px, *p01);
+					Wdec(w14, i10, i11, *p10, *p11);
+				}
+
+				if (nx & p)
+				{
+					auto p10 = px + oy1;
+					Wdec(w14, *px, *p10, i00, *p10);
+					*px = i00;
+				}
+			}
+
+			if (ny & p)
+			{
+				auto px = py;
+				auto ex = py + ox * (nx - p2);
+
+				for (; px <= ex; px += ox2)
+				{
+					auto p01 = px + ox1;
+					Wdec(w14, *px, *p01, i00, *p01);
+					*px = i00;
+				}
+			}
+
+			p2 = p;
+			p >>= 1;
+		}
+	}
+}
+
+bool DecompressExrRLE(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize)
+{
+	std::vector<uint8_t> tmp(dstSize);
+	size_t pos = 0;
+	size_t in = 0;
+
+	while (in < srcSize)
+	{
+		auto count = int(int8_t(pSrc[in++]));
+		if (count < 0)
+		{
+			auto n = size_t(-count);
+			if (in + n > srcSize || pos + n > dstSize)
+			{
+				return false;
+			}
+
+			memcpy(tmp.data() + pos, pSrc + in, n);
+			in += n;
+			pos += n;
+		}
+		else
+		{
+			auto n = size_t(count) + 1;
+			if (in >= srcSize || pos + n > dstSize)
+			{
+				return false;
+			}
+
+			memset(tmp.data() + pos, pSrc[in++], n);
+			pos += n;
+		}
+	}
+
+	if (pos != dstSize)
+	{
+		return false;
+	}
+
+	ReconstructBytes(tmp.data(), pDst, dstSize);
+	return true;
+}
+
+bool DecompressExrZIP(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize)
+{
+	std::vector<uint8_t> tmp(dstSize);
+	if (!Inflate(pSrc, srcSize, tmp.data(), dstSize, true))
+	{
+		return false;
+	}
+
+	ReconstructBytes(tmp.data(), pDst, dstSize);
+	return true;
+}
+
+bool DecompressExrPIZ(
+	const uint8_t* pSrc,
+	size_t srcSize,
+	uint8_t* pDst,
+	size_t dstSize,
+	uint32_t width,
+	uint32_t lineCount,
+	const uint32_t* pChannelSizes,
+	uint32_t channelCount)
+{
+	if ((dstSize & 1) != 0 || srcSize < 4)
+	{
+		return false;
+	}
+
+	// ビットマップ (出現した値の集合) を読み込む
+	std::vector<uint8_t> bitmap(BitmapSize, 0);
+
+	auto minNonZero = uint32_t(pSrc[0]) | (uint32_t(pSrc[1]) << 8);
+	auto maxNonZero = uint32_t(pSrc[2]) | (uint32_t(pSrc[3]) << 8);
+	size_t pos = 4;
+
+	if (maxNonZero >= BitmapSize)
+	{
+		return false;
+	}
+
+	if (minNonZero <= maxNonZero)
+	{
+		auto n = size_t(maxNonZero - minNonZero + 1);
+		if (pos + n > srcSize)
+		{
+			return false;
+		}
+
+		memcpy(bitmap.data() + minNonZero, pSrc + pos, n);
+		pos += n;
+	}
+
+	// ビットマップから逆引きテーブルを生成する
+	std::vector<uint16_t> lut(UShortRange, 0);
+	uint32_t k = 0;
+	for (auto i = 0u; i < UShortRange; ++i)
+	{
+		if (i == 0 || (bitmap[i >> 3] & (1 << (i & 7))))
+		{
+			lut[k++] = uint16_t(i);
+		}
+	}
+	auto maxValue = uint16_t(k - 1);
+
+	if (pos + 4 > srcSize)
+	{
+		return false;
+	}
+
+	auto length = size_t(ReadUInt32(pSrc + pos));
+	pos += 4;
+
+	if (pos + length > srcSize)
+	{
+		return false;
+	}
+
+	// ハフマン符号を復号する
+	std::vector<uint16_t> tmp(dstSize / 2);
+	if (!HufUncompress(pSrc + pos, length, tmp.data(), tmp.size()))
+	{
+		return false;
+	}
+
+	// チャンネルごとにウェーブレット変換を元に戻す
+	size_t offset = 0;
+	for (auto c = 0u; c < channelCount; ++c)
+	{
+		auto size = int(pChannelSizes[c] / 2);
+		auto nx = int(width);
+		auto ny = int(lineCount);
+
+		if (offset + size_t(nx) * ny * size > tmp.size())
+		{
+			return false;
+		}
+
+		for (auto j = 0; j < size; ++j)
+		{
+			Wav2Decode(tmp.data() + offset + j, nx, size, ny, nx * size, maxValue);
+		}
+
+		offset += size_t(nx) * ny * size;
+	}
+
+	for (auto& value : tmp)
+	{
+		value = lut[value];
+	}
+
+	// チャンネルごとの平面を行ごとのチャンネル順に並べ直す
+	auto pOut = reinterpret_cast<uint16_t*>(pDst);
+	for (auto y = 0u; y < lineCount; ++y)
+	{
+		size_t planeOffset = 0;
+		for (auto c = 0u; c < channelCount; ++c)
+		{
+			auto n = size_t(width) * (pChannelSizes[c] / 2);
+			memcpy(pOut, tmp.data() + planeOffset + n * y, n * sizeof(uint16_t));
+			pOut += n;
+			planeOffset += n * lineCount;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// OpenEXR のRLE圧縮ブロックを展開する
+/// </summary>
+/// <param name="pSrc">圧縮データ</param>
+/// <param name="srcSize">圧縮データのサイズ</param>
+/// <param name="pDst">展開先</param>
+/// <param name="dstSize">展開先のサイズ (ブロックの無圧縮サイズ)</param>
+/// <returns>展開に成功した場合はtrue</returns>
+bool DecompressExrRLE(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize);
+
+/// <summary>
+/// OpenEXR のZIP / ZIPS圧縮ブロックを展開する
+/// </summary>
+/// <param name="pSrc">圧縮データ</param>
+/// <param name="srcSize">圧縮データのサイズ</param>
+/// <param name="pDst">展開先</param>
+/// <param name="dstSize">展開先のサイズ (ブロックの無圧縮サイズ)</param>
+/// <returns>展開に成功した場合はtrue</returns>
+bool DecompressExrZIP(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize);
+
+/// <summary>
+/// OpenEXR のPIZ圧縮ブロックを展開する
+/// 全てのチャンネルのサンプリングが1であることを前提とする
+/// </summary>
+/// <param name="pSrc">圧縮データ</param>
+/// <param name="srcSize">圧縮データのサイズ</param>
+/// <param name="pDst">展開先</param>
+/// <param name="dstSize">展開先のサイズ (ブロックの無圧縮サイズ)</param>
+/// <param name="width">ブロックの横幅 (ピクセル数)</param>
+/// <param name="lineCount">ブロックの行数</param>
+/// <param name="pChannelSizes">チャンネルごとの1サンプルのバイト数 (2または4)</param>
+/// <param name="channelCount">チャンネル数</param>
+/// <returns>展開に成功した場合はtrue</returns>
+bool DecompressExrPIZ(
+	const uint8_t* pSrc,
+	size_t srcSize,
+	uint8_t* pDst,
+	size_t dstSize,
+	uint32_t width,
+	uint32_t lineCount,
+	const uint32_t* pChannelSizes,
+	uint32_t channelCount);
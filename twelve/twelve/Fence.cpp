@@ -131,3 +131,60 @@ void Fence::Sync(ID3D12CommandQueue* pQueue)
 	// カウンターを増やす
 	m_Counter++;
 }
+
+UINT64 Fence::Signal(ID3D12CommandQueue* pQueue)
+{
+	if (pQueue == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return 0;
+	}
+
+	const auto fenceValue = m_Counter;
+
+	// シグナル処理
+	auto hr = pQueue->Signal(m_pFence.Get(), fenceValue);
+	if (FAILED(hr))
+	{
+		ELOG("Error : ID3D12CommandQueue::Signal() Failed. retcode = 0x%x", hr);
+		return 0;
+	}
+
+	// カウンターを増やす
+	m_Counter++;
+
+	return fenceValue;
+}
+
+void Fence::WaitForValue(UINT64 value, UINT timeout)
+{
+	if (value == 0 || m_pFence->GetCompletedValue() >= value)
+	{
+		return;
+	}
+
+	// 完了時にイベントを設定
+	auto hr = m_pFence->SetEventOnCompletion(value, m_Event);
+	if (FAILED(hr))
+	{
+		ELOG("Error : ID3D12Fence::SetEventOnCompletion() Failed. retcode = 0x%x", hr);
+		return;
+	}
+
+	// イベントを待機
+	if (WAIT_OBJECT_0 != WaitForSingleObjectEx(m_Event, timeout, FALSE))
+	{
+		ELOG("Error : WaitForSingleObjectEx() Failed.");
+		return;
+	}
+}
+
+UINT64 Fence::GetCompletedValue() const
+{
+	if (m_pFence == nullptr)
+	{
+		return 0;
+	}
+
+	return m_pFence->GetCompletedValue();
+}
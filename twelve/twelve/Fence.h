@@ -35,6 +35,30 @@ public:
 	/// <param name="pQueue"></param>
 	void Sync(ID3D12CommandQueue* pQueue);
 
+	/// <summary>
+	/// シグナルのみ発行する (待機しない)
+	/// </summary>
+	/// <param name="pQueue">コマンドキュー</param>
+	/// <returns>シグナルしたフェンス値 (失敗した場合は0)</returns>
+	UINT64 Signal(ID3D12CommandQueue* pQueue);
+
+	/// <summary>
+	/// 指定したフェンス値に達するまで待機する (達している場合は待機しない)
+	/// </summary>
+	/// <param name="value">フェンス値</param>
+	/// <param name="timeout">タイムアウト時間(ミリ秒)</param>
+	void WaitForValue(UINT64 value, UINT timeout);
+
+	/// <summary>
+	/// GPUが完了したフェンス値を取得する
+	/// </summary>
+	UINT64 GetCompletedValue() const;
+
+	/// <summary>
+	/// 次の Wait() または Sync() でシグナルするフェンス値を取得する
+	/// </summary>
+	UINT64 GetNextValue() const { return m_Counter; }
+
 private:
 	ComPtr<ID3D12Fence> m_pFence; // フェンス
 	HANDLE m_Event; // イベント
@@ -0,0 +1,773 @@
+﻿#include "FrameGraph.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+
+namespace
+{
+	// 読み込み専用の状態 (同時に複数指定できる)
+	const D3D12_RESOURCE_STATES ReadOnlyStates = D3D12_RESOURCE_STATES(
+		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER
+		| D3D12_RESOURCE_STATE_INDEX_BUFFER
+		| D3D12_RESOURCE_STATE_DEPTH_READ
+		| D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
+		| D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
+		| D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT
+		| D3D12_RESOURCE_STATE_COPY_SOURCE
+		| D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
+
+	/// <summary>
+	/// アライメントに切り上げる
+	/// </summary>
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		alignment = std::max(alignment, uint64_t(1));
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	/// <summary>
+	/// 状態遷移を生成する
+	/// </summary>
+	FrameGraphBarrier MakeTransition(
+		FrameGraphHandle resource,
+		D3D12_RESOURCE_STATES before,
+		D3D12_RESOURCE_STATES after,
+		D3D12_RESOURCE_BARRIER_FLAGS flags)
+	{
+		FrameGraphBarrier barrier;
+		barrier.Type = FRAME_GRAPH_BARRIER_TRANSITION;
+		barrier.Resource = resource;
+		barrier.StateBefore = before;
+		barrier.StateAfter = after;
+		barrier.Flags = flags;
+		return barrier;
+	}
+
+	/// <summary>
+	/// 同じ状態が続くリソースの使用区間 (連続する読み込みは1つの区間にまとめる)
+	/// </summary>
+	struct Segment
+	{
+		uint32_t				First;		// 最初の実行順
+		uint32_t				Last;		// 最後の実行順
+		D3D12_RESOURCE_STATES	State;
+		bool					Write;
+	};
+}
+
+FrameGraph::FrameGraph()
+	: m_Compiled(false)
+	, m_HasError(false)
+{
+}
+
+FrameGraph::~FrameGraph()
+{
+	Reset();
+}
+
+void FrameGraph::Reset()
+{
+	m_Passes.clear();
+	m_Resources.clear();
+	m_ExecutionOrder.clear();
+	m_FinalBarriers.clear();
+	m_Stats = FrameGraphStats();
+	m_Compiled = false;
+	m_HasError = false;
+}
+
+FrameGraphHandle FrameGraph::CreateTexture(const char* name, const FrameGraphTextureDesc& desc)
+{
+	Resource resource;
+	resource.Name = (name != nullptr) ? name : "";
+	resource.Desc = desc;
+	resource.Imported = false;
+
+	m_Resources.push_back(resource);
+	m_Compiled = false;
+	return FrameGraphHandle(m_Resources.size() - 1);
+}
+
+FrameGraphHandle FrameGraph::ImportResource(const char* name, D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_STATES finalState)
+{
+	Resource resource;
+	resource.Name = (name != nullptr) ? name : "";
+	resource.Imported = true;
+	resource.InitialState = initialState;
+	resource.FinalState = finalState;
+
+	m_Resources.push_back(resource);
+	m_Compiled = false;
+	return FrameGraphHandle(m_Resources.size() - 1);
+}
+
+uint32_t FrameGraph::AddPass(const char* name, ExecuteFunc func, bool hasSideEffect)
+{
+	Pass pass;
+	pass.Name = (name != nullptr) ? name : "";
+	pass.Func = std::move(func);
+	pass.HasSideEffect = hasSideEffect;
+
+	m_Passes.push_back(std::move(pass));
+	m_Compiled = false;
+	return uint32_t(m_Passes.size() - 1);
+}
+
+void FrameGraph::Read(uint32_t pass, FrameGraphHandle resource, D3D12_RESOURCE_STATES state)
+{
+	if (pass >= m_Passes.size() || resource >= m_Resources.size())
+	{
+		ELOG("Error : Invalid Argument.");
+		m_HasError = true;
+		return;
+	}
+
+	if ((state & ~ReadOnlyStates) != 0)
+	{
+		ELOG("Error : Write State Is Used For Read. pass = %s, resource = %s, state = 0x%x",
+			m_Passes[pass].Name.c_str(), m_Resources[resource].Name.c_str(), state);
+		m_HasError = true;
+		return;
+	}
+
+	// 同じパスでの読み込みは状態をまとめる
+	for (auto& access : m_Passes[pass].Accesses)
+	{
+		if (access.Resource != resource)
+		{
+			continue;
+		}
+
+		if (access.Write)
+		{
+			if ((access.State & state) != state)
+			{
+				ELOG("Error : Conflicting Access. pass = %s, resource = %s",
+					m_Passes[pass].Name.c_str(), m_Resources[resource].Name.c_str());
+				m_HasError = true;
+			}
+			return;
+		}
+
+		access.State = D3D12_RESOURCE_STATES(access.State | state);
+		m_Compiled = false;
+		return;
+	}
+
+	m_Passes[pass].Accesses.push_back({ resource, state, false });
+	m_Compiled = false;
+}
+
+void FrameGraph::Write(uint32_t pass, FrameGraphHandle resource, D3D12_RESOURCE_STATES state)
+{
+	if (pass >= m_Passes.size() || resource >= m_Resources.size())
+	{
+		ELOG("Error : Invalid Argument.");
+		m_HasError = true;
+		return;
+	}
+
+	for (auto& access : m_Passes[pass].Accesses)
+	{
+		if (access.Resource != resource)
+		{
+			continue;
+		}
+
+		// 読み書きを同時に行う場合は書き込みの状態に読み込みの状態が含まれている必要がある
+		if (access.State != state && (access.Write || (state & access.State) != access.State))
+		{
+			ELOG("Error : Conflicting Access. pass = %s, resource = %s",
+				m_Passes[pass].Name.c_str(), m_Resources[resource].Name.c_str());
+			m_HasError = true;
+			return;
+		}
+
+		access.State = state;
+		access.Write = true;
+		m_Compiled = false;
+		return;
+	}
+
+	m_Passes[pass].Accesses.push_back({ resource, state, true });
+	m_Compiled = false;
+}
+
+bool FrameGraph::Compile()
+{
+	m_Compiled = false;
+	m_ExecutionOrder.clear();
+	m_FinalBarriers.clear();
+	m_Stats = FrameGraphStats();
+
+	if (m_HasError)
+	{
+		ELOG("Error : Frame Graph Has Invalid Declarations.");
+		return false;
+	}
+
+	for (auto& pass : m_Passes)
+	{
+		pass.Culled = false;
+		pass.Barriers.clear();
+	}
+
+	for (auto& resource : m_Resources)
+	{
+		resource.FirstUse = UINT32_MAX;
+		resource.LastUse = UINT32_MAX;
+		resource.HeapOffset = UINT64_MAX;
+	}
+
+	// 出力に寄与しないパスを削除
+	CullPasses();
+
+	// 寿命を求める
+	if (!CalcLifetimes())
+	{
+		return false;
+	}
+
+	// 一時テクスチャの配置を求める
+	std::vector<FrameGraphHandle> aliasBefore;
+	std::vector<bool> aliased;
+	PlaceResources(aliasBefore, aliased);
+
+	// バリアを求める
+	BuildBarriers(aliasBefore, aliased);
+
+	// 統計値
+	m_Stats.PassCount = uint32_t(m_Passes.size());
+	m_Stats.CulledPassCount = uint32_t(m_Passes.size() - m_ExecutionOrder.size());
+	m_Stats.ResourceCount = uint32_t(m_Resources.size());
+
+	for (auto& resource : m_Resources)
+	{
+		if (resource.Imported)
+		{
+			continue;
+		}
+
+		if (resource.FirstUse == UINT32_MAX)
+		{
+			m_Stats.CulledResourceCount++;
+			continue;
+		}
+
+		m_Stats.UnaliasedSize += AlignUp(resource.Desc.SizeInBytes, resource.Desc.Alignment);
+	}
+
+	for (auto index : m_ExecutionOrder)
+	{
+		if (!m_Passes[index].Barriers.empty())
+		{
+			m_Stats.BarrierBatchCount++;
+		}
+	}
+
+	if (!m_FinalBarriers.empty())
+	{
+		m_Stats.BarrierBatchCount++;
+	}
+
+	m_Compiled = true;
+	return true;
+}
+
+uint32_t FrameGraph::GetExecutionIndex(uint32_t pass) const
+{
+	for (auto i = 0u; i < m_ExecutionOrder.size(); ++i)
+	{
+		if (m_ExecutionOrder[i] == pass)
+		{
+			return i;
+		}
+	}
+
+	return UINT32_MAX;
+}
+
+void FrameGraph::CullPasses()
+{
+	auto passCount = m_Passes.size();
+	auto resourceCount = m_Resources.size();
+
+	// パスの参照数 = 書き込むリソースの数, リソースの参照数 = 読み込むパスの数
+	std::vector<uint32_t> passRefs(passCount, 0);
+	std::vector<uint32_t> resourceRefs(resourceCount, 0);
+	std::vector<std::vector<uint32_t>> writers(resourceCount);
+
+	for (auto p = 0u; p < passCount; ++p)
+	{
+		for (auto& access : m_Passes[p].Accesses)
+		{
+			if (access.Write)
+			{
+				passRefs[p]++;
+				writers[access.Resource].push_back(p);
+			}
+			else
+			{
+				resourceRefs[access.Resource]++;
+			}
+		}
+
+		// 副作用のあるパスは削除しない
+		if (m_Passes[p].HasSideEffect)
+		{
+			passRefs[p]++;
+		}
+	}
+
+	// インポートしたリソースは外部から読まれるものとみなす
+	for (auto r = 0u; r < resourceCount; ++r)
+	{
+		if (m_Resources[r].Imported)
+		{
+			resourceRefs[r]++;
+		}
+	}
+
+	std::vector<FrameGraphHandle> stack;
+	for (auto r = 0u; r < resourceCount; ++r)
+	{
+		if (resourceRefs[r] == 0)
+		{
+			stack.push_back(r);
+		}
+	}
+
+	auto cull = [&](uint32_t p)
+	{
+		m_Passes[p].Culled = true;
+
+		for (auto& access : m_Passes[p].Accesses)
+		{
+			if (!access.Write && --resourceRefs[access.Resource] == 0)
+			{
+				stack.push_back(access.Resource);
+			}
+		}
+	};
+
+	for (auto p = 0u; p < passCount; ++p)
+	{
+		if (passRefs[p] == 0)
+		{
+			cull(p);
+		}
+	}
+
+	// 参照されなくなったリソースを書き込むパスの参照数を減らす
+	while (!stack.empty())
+	{
+		auto r = stack.back();
+		stack.pop_back();
+
+		for (auto p : writers[r])
+		{
+			if (!m_Passes[p].Culled && --passRefs[p] == 0)
+			{
+				cull(p);
+			}
+		}
+	}
+
+	for (auto p = 0u; p < passCount; ++p)
+	{
+		if (!m_Passes[p].Culled)
+		{
+			m_ExecutionOrder.push_back(p);
+		}
+	}
+}
+
+bool FrameGraph::CalcLifetimes()
+{
+	for (auto i = 0u; i < m_ExecutionOrder.size(); ++i)
+	{
+		auto& pass = m_Passes[m_ExecutionOrder[i]];
+
+		for (auto& access : pass.Accesses)
+		{
+			auto& resource = m_Resources[access.Resource];
+
+			// 一時テクスチャは書き込み前に読み込めない
+			if (resource.FirstUse == UINT32_MAX && !resource.Imported && !access.Write)
+			{
+				ELOG("Error : Transient Resource Is Read Before Written. pass = %s, resource = %s",
+					pass.Name.c_str(), resource.Name.c_str());
+				return false;
+			}
+
+			if (resource.FirstUse == UINT32_MAX)
+			{
+				resource.FirstUse = i;
+			}
+
+			resource.LastUse = i;
+		}
+	}
+
+	return true;
+}
+
+void FrameGraph::PlaceResources(std::vector<FrameGraphHandle>& aliasBefore, std::vector<bool>& aliased)
+{
+	aliasBefore.assign(m_Resources.size(), FrameGraphInvalidHandle);
+	aliased.assign(m_Resources.size(), false);
+
+	std::vector<FrameGraphHandle> order;
+	for (auto r = 0u; r < m_Resources.size(); ++r)
+	{
+		if (!m_Resources[r].Imported && m_Resources[r].FirstUse != UINT32_MAX)
+		{
+			order.push_back(r);
+		}
+	}
+
+	// 大きいものから配置する
+	std::stable_sort(order.begin(), order.end(), [&](FrameGraphHandle a, FrameGraphHandle b)
+	{
+		return m_Resources[a].Desc.SizeInBytes > m_Resources[b].Desc.SizeInBytes;
+	});
+
+	auto lifetimeOverlaps = [&](const Resource& a, const Resource& b)
+	{
+		return a.FirstUse <= b.LastUse && b.FirstUse <= a.LastUse;
+	};
+
+	auto memoryOverlaps = [](uint64_t offsetA, uint64_t sizeA, uint64_t offsetB, uint64_t sizeB)
+	{
+		return offsetA < offsetB + sizeB && offsetB < offsetA + sizeA;
+	};
+
+	std::vector<FrameGraphHandle> placed;
+	std::vector<FrameGraphHandle> conflicts;
+	std::vector<uint64_t> candidates;
+
+	for (auto r : order)
+	{
+		auto& resource = m_Resources[r];
+		auto size = std::max(resource.Desc.SizeInBytes, uint64_t(1));
+
+		// 寿命が重なるものとはメモリを重ねられない
+		conflicts.clear();
+		candidates.clear();
+		candidates.push_back(0);
+
+		for (auto other : placed)
+		{
+			auto& o = m_Resources[other];
+			if (lifetimeOverlaps(resource, o))
+			{
+				conflicts.push_back(other);
+				candidates.push_back(AlignUp(o.HeapOffset + std::max(o.Desc.SizeInBytes, uint64_t(1)), resource.Desc.Alignment));
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+
+		for (auto offset : candidates)
+		{
+			auto fits = true;
+			for (auto other : conflicts)
+			{
+				auto& o = m_Resources[other];
+				if (memoryOverlaps(offset, size, o.HeapOffset, std::max(o.Desc.SizeInBytes, uint64_t(1))))
+				{
+					fits = false;
+					break;
+				}
+			}
+
+			if (fits)
+			{
+				resource.HeapOffset = offset;
+				break;
+			}
+		}
+
+		m_Stats.HeapSize = std::max(m_Stats.HeapSize, resource.HeapOffset + size);
+		placed.push_back(r);
+	}
+
+	// メモリを共有するリソースはエイリアシングバリアで切り替える
+	for (auto r : placed)
+	{
+		auto& resource = m_Resources[r];
+		auto size = std::max(resource.Desc.SizeInBytes, uint64_t(1));
+		auto count = 0u;
+
+		for (auto other : placed)
+		{
+			if (other == r)
+			{
+				continue;
+			}
+
+			auto& o = m_Resources[other];
+			if (memoryOverlaps(resource.HeapOffset, size, o.HeapOffset, std::max(o.Desc.SizeInBytes, uint64_t(1))))
+			{
+				aliasBefore[r] = other;
+				count++;
+			}
+		}
+
+		aliased[r] = (count > 0);
+
+		// 複数のリソースと重なる場合は直前のリソースを特定しない
+		if (count != 1)
+		{
+			aliasBefore[r] = FrameGraphInvalidHandle;
+		}
+	}
+}
+
+void FrameGraph::BuildBarriers(const std::vector<FrameGraphHandle>& aliasBefore, const std::vector<bool>& aliased)
+{
+	auto passCount = uint32_t(m_ExecutionOrder.size());
+
+	// 実行順ごとのバリア (エイリアシング ---> 遷移 (分割の終了を含む) ---> 分割の開始 の順に発行する)
+	std::vector<std::vector<FrameGraphBarrier>> aliasing(passCount);
+	std::vector<std::vector<FrameGraphBarrier>> transitions(passCount);
+	std::vector<std::vector<FrameGraphBarrier>> begins(passCount);
+
+	std::vector<std::vector<Segment>> segments(m_Resources.size());
+
+	for (auto i = 0u; i < passCount; ++i)
+	{
+		for (auto& access : m_Passes[m_ExecutionOrder[i]].Accesses)
+		{
+			auto& list = segments[access.Resource];
+
+			// 連続する読み込みは状態をまとめて1つの区間にする
+			if (!access.Write && !list.empty() && !list.back().Write)
+			{
+				auto& last = list.back();
+				if ((last.State & access.State) != access.State)
+				{
+					m_Stats.MergedReadCount++;
+				}
+
+				last.State = D3D12_RESOURCE_STATES(last.State | access.State);
+				last.Last = i;
+				continue;
+			}
+
+			list.push_back({ i, i, access.State, access.Write });
+		}
+	}
+
+	for (auto r = 0u; r < m_Resources.size(); ++r)
+	{
+		auto& resource = m_Resources[r];
+		auto& list = segments[r];
+
+		if (list.empty())
+		{
+			continue;
+		}
+
+		// 一時テクスチャは前回の実行終了時の状態から始まる
+		if (!resource.Imported)
+		{
+			resource.FinalState = list.back().State;
+			resource.InitialState = resource.FinalState;
+
+			if (aliased[r])
+			{
+				FrameGraphBarrier barrier;
+				barrier.Type = FRAME_GRAPH_BARRIER_ALIASING;
+				barrier.Resource = r;
+				barrier.AliasBefore = aliasBefore[r];
+				aliasing[list.front().First].push_back(barrier);
+				m_Stats.AliasingBarrierCount++;
+			}
+		}
+
+		auto state = resource.InitialState;
+		auto prevLast = UINT32_MAX;
+		auto prevWrite = false;
+
+		for (auto& segment : list)
+		{
+			if (segment.State != state)
+			{
+				// 前回の使用から間が空いている場合は分割バリアにする
+				if (prevLast != UINT32_MAX && prevLast + 1 < segment.First)
+				{
+					begins[prevLast + 1].push_back(MakeTransition(r, state, segment.State, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY));
+					transitions[segment.First].push_back(MakeTransition(r, state, segment.State, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+					m_Stats.SplitBarrierCount++;
+				}
+				else
+				{
+					transitions[segment.First].push_back(MakeTransition(r, state, segment.State, D3D12_RESOURCE_BARRIER_FLAG_NONE));
+				}
+
+				m_Stats.TransitionCount++;
+			}
+			else if (prevWrite && segment.Write && state == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+			{
+				// UAVへの連続した書き込み
+				FrameGraphBarrier barrier;
+				barrier.Type = FRAME_GRAPH_BARRIER_UAV;
+				barrier.Resource = r;
+				transitions[segment.First].push_back(barrier);
+			}
+
+			state = segment.State;
+			prevLast = segment.Last;
+			prevWrite = segment.Write;
+		}
+
+		if (resource.Imported && state != resource.FinalState)
+		{
+			m_FinalBarriers.push_back(MakeTransition(r, state, resource.FinalState, D3D12_RESOURCE_BARRIER_FLAG_NONE));
+			m_Stats.TransitionCount++;
+		}
+	}
+
+	for (auto i = 0u; i < passCount; ++i)
+	{
+		auto& barriers = m_Passes[m_ExecutionOrder[i]].Barriers;
+		barriers.insert(barriers.end(), aliasing[i].begin(), aliasing[i].end());
+		barriers.insert(barriers.end(), transitions[i].begin(), transitions[i].end());
+		barriers.insert(barriers.end(), begins[i].begin(), begins[i].end());
+	}
+}
+
+bool FrameGraph::Validate() const
+{
+	if (!m_Compiled)
+	{
+		ELOG("Error : Frame Graph Is Not Compiled.");
+		return false;
+	}
+
+	// 寿命が重なる一時テクスチャのメモリが重なっていないこと
+	for (auto a = 0u; a < m_Resources.size(); ++a)
+	{
+		auto& ra = m_Resources[a];
+		if (ra.Imported || ra.FirstUse == UINT32_MAX)
+		{
+			continue;
+		}
+
+		for (auto b = a + 1; b < m_Resources.size(); ++b)
+		{
+			auto& rb = m_Resources[b];
+			if (rb.Imported || rb.FirstUse == UINT32_MAX)
+			{
+				continue;
+			}
+
+			auto lifetime = ra.FirstUse <= rb.LastUse && rb.FirstUse <= ra.LastUse;
+			auto memory = ra.HeapOffset < rb.HeapOffset + std::max(rb.Desc.SizeInBytes, uint64_t(1))
+				&& rb.HeapOffset < ra.HeapOffset + std::max(ra.Desc.SizeInBytes, uint64_t(1));
+
+			if (lifetime && memory)
+			{
+				ELOG("Error : Overlapping Resources. %s, %s", ra.Name.c_str(), rb.Name.c_str());
+				return false;
+			}
+		}
+	}
+
+	// バリアを順に適用して状態を追跡する
+	std::vector<D3D12_RESOURCE_STATES> states(m_Resources.size());
+	std::vector<bool> pending(m_Resources.size(), false);
+	for (auto r = 0u; r < m_Resources.size(); ++r)
+	{
+		states[r] = m_Resources[r].InitialState;
+	}
+
+	auto apply = [&](const std::vector<FrameGraphBarrier>& barriers)
+	{
+		for (auto& barrier : barriers)
+		{
+			if (barrier.Type != FRAME_GRAPH_BARRIER_TRANSITION)
+			{
+				continue;
+			}
+
+			auto r = barrier.Resource;
+			if (barrier.StateBefore != states[r])
+			{
+				ELOG("Error : State Mismatch. resource = %s, expected = 0x%x, before = 0x%x",
+					m_Resources[r].Name.c_str(), states[r], barrier.StateBefore);
+				return false;
+			}
+
+			if (barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY)
+			{
+				pending[r] = true;
+				continue;
+			}
+
+			if (barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_END_ONLY)
+			{
+				if (!pending[r])
+				{
+					ELOG("Error : Split Barrier Is Not Begun. resource = %s", m_Resources[r].Name.c_str());
+					return false;
+				}
+				pending[r] = false;
+			}
+
+			states[r] = barrier.StateAfter;
+		}
+
+		return true;
+	};
+
+	for (auto index : m_ExecutionOrder)
+	{
+		auto& pass = m_Passes[index];
+		if (!apply(pass.Barriers))
+		{
+			return false;
+		}
+
+		for (auto& access : pass.Accesses)
+		{
+			auto r = access.Resource;
+			auto ok = access.Write
+				? (states[r] == access.State)
+				: ((states[r] & access.State) == access.State);
+
+			if (!ok || pending[r])
+			{
+				ELOG("Error : Resource Is Not Ready. pass = %s, resource = %s, state = 0x%x, required = 0x%x",
+					pass.Name.c_str(), m_Resources[r].Name.c_str(), states[r], access.State);
+				return false;
+			}
+		}
+	}
+
+	if (!apply(m_FinalBarriers))
+	{
+		return false;
+	}
+
+	// 終了時の状態が次回の開始時の状態と一致すること
+	for (auto r = 0u; r < m_Resources.size(); ++r)
+	{
+		auto& resource = m_Resources[r];
+		if (resource.FirstUse == UINT32_MAX)
+		{
+			continue;
+		}
+
+		if (states[r] != resource.FinalState || (!resource.Imported && states[r] != resource.InitialState))
+		{
+			ELOG("Error : Final State Mismatch. resource = %s", resource.Name.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,236 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <d3d12.h>
+
+/// <summary>
+/// フレームグラフのリソースのハンドル
+/// </summary>
+using FrameGraphHandle = uint32_t;
+
+/// <summary>
+/// 無効なハンドル
+/// </summary>
+const FrameGraphHandle FrameGraphInvalidHandle = UINT32_MAX;
+
+/// <summary>
+/// 一時テクスチャの構成設定
+/// </summary>
+struct FrameGraphTextureDesc
+{
+	uint32_t				Width = 0;
+	uint32_t				Height = 0;
+	DXGI_FORMAT				Format = DXGI_FORMAT_UNKNOWN;
+	D3D12_RESOURCE_FLAGS	Flags = D3D12_RESOURCE_FLAG_NONE;
+	float					ClearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };	// レンダーターゲットのクリアカラー
+	float					ClearDepth = 1.0f;							// 深度ステンシルのクリア値
+	uint8_t					ClearStencil = 0;
+	uint64_t				SizeInBytes = 0;		// ヒープ上で必要なサイズ (FrameGraphExecutor::CalcAllocationInfo() で求める)
+	uint64_t				Alignment = 65536;		// ヒープ上のアライメント
+};
+
+/// <summary>
+/// バリアの種類
+/// </summary>
+enum FRAME_GRAPH_BARRIER_TYPE
+{
+	FRAME_GRAPH_BARRIER_TRANSITION = 0,		// 状態遷移
+	FRAME_GRAPH_BARRIER_ALIASING,			// ヒープを共有するリソースの切り替え
+	FRAME_GRAPH_BARRIER_UAV,				// UAVへの連続した書き込みの同期
+};
+
+/// <summary>
+/// コンパイルで求めたバリア
+/// </summary>
+struct FrameGraphBarrier
+{
+	FRAME_GRAPH_BARRIER_TYPE		Type = FRAME_GRAPH_BARRIER_TRANSITION;
+	FrameGraphHandle				Resource = FrameGraphInvalidHandle;
+	FrameGraphHandle				AliasBefore = FrameGraphInvalidHandle;		// 直前に同じメモリを使っていたリソース (特定できない場合は無効値)
+	D3D12_RESOURCE_STATES			StateBefore = D3D12_RESOURCE_STATE_COMMON;
+	D3D12_RESOURCE_STATES			StateAfter = D3D12_RESOURCE_STATE_COMMON;
+	D3D12_RESOURCE_BARRIER_FLAGS	Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;	// 分割バリアの場合は BEGIN_ONLY / END_ONLY
+};
+
+/// <summary>
+/// コンパイル結果の統計値
+/// </summary>
+struct FrameGraphStats
+{
+	uint32_t	PassCount = 0;				// 登録されたパス数
+	uint32_t	CulledPassCount = 0;		// 削除されたパス数
+	uint32_t	ResourceCount = 0;			// 登録されたリソース数
+	uint32_t	CulledResourceCount = 0;	// 使われなくなった一時リソース数
+	uint32_t	TransitionCount = 0;		// 状態遷移の数 (分割バリアは1つと数える)
+	uint32_t	MergedReadCount = 0;		// 読み込み状態をまとめて省略した遷移の数
+	uint32_t	SplitBarrierCount = 0;		// 分割バリアにした遷移の数
+	uint32_t	AliasingBarrierCount = 0;	// エイリアシングバリアの数
+	uint32_t	BarrierBatchCount = 0;		// ResourceBarrier() の呼び出し回数
+	uint64_t	HeapSize = 0;				// エイリアシング後のヒープサイズ
+	uint64_t	UnaliasedSize = 0;			// エイリアシングしない場合のサイズ
+};
+
+/// <summary>
+/// フレームグラフ
+/// パスごとに読み書きするリソースと状態を宣言し, Compile() で次の処理を行う
+///  - 出力 (インポートしたリソースと副作用のあるパス) に寄与しないパスの削除
+///  - 状態遷移の自動挿入 (連続する読み込みは1回の遷移にまとめ, 間が空く場合は分割バリアにする)
+///  - 一時テクスチャの寿命からヒープ上の配置を決め, 寿命が重ならないもの同士でメモリを共有する
+/// コンパイルはCPUのみで完結するので, デバイスなしで検証や計測ができる (実行は FrameGraphExecutor で行う)
+/// パスは依存関係の順に追加すること (書き込み前のリソースを読み込むとコンパイルに失敗する)
+/// </summary>
+class FrameGraph
+{
+public:
+	using ExecuteFunc = std::function<void(ID3D12GraphicsCommandList*)>;
+
+	FrameGraph();
+	~FrameGraph();
+
+	/// <summary>
+	/// 登録したパスとリソースを全て破棄する
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// 一時テクスチャを登録する (ヒープはフレームグラフが管理する)
+	/// </summary>
+	/// <param name="name">名前</param>
+	/// <param name="desc">構成設定</param>
+	/// <returns>ハンドル</returns>
+	FrameGraphHandle CreateTexture(const char* name, const FrameGraphTextureDesc& desc);
+
+	/// <summary>
+	/// 外部で管理するリソースを登録する
+	/// インポートしたリソースへの書き込みは出力とみなされ, そのパスは削除されない
+	/// </summary>
+	/// <param name="name">名前</param>
+	/// <param name="initialState">実行開始時の状態</param>
+	/// <param name="finalState">実行終了時に戻す状態</param>
+	/// <returns>ハンドル</returns>
+	FrameGraphHandle ImportResource(const char* name, D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_STATES finalState);
+
+	/// <summary>
+	/// パスを追加する
+	/// </summary>
+	/// <param name="name">名前</param>
+	/// <param name="func">コマンドを記録する処理</param>
+	/// <param name="hasSideEffect">グラフ外に結果を出力するかどうか (trueの場合は削除されない)</param>
+	/// <returns>パス番号</returns>
+	uint32_t AddPass(const char* name, ExecuteFunc func, bool hasSideEffect = false);
+
+	/// <summary>
+	/// パスが読み込むリソースを宣言する
+	/// </summary>
+	void Read(uint32_t pass, FrameGraphHandle resource, D3D12_RESOURCE_STATES state);
+
+	/// <summary>
+	/// パスが書き込むリソースを宣言する
+	/// </summary>
+	void Write(uint32_t pass, FrameGraphHandle resource, D3D12_RESOURCE_STATES state);
+
+	/// <summary>
+	/// パスの削除, バリアの挿入, 一時テクスチャの配置を求める
+	/// </summary>
+	/// <returns>コンパイルに成功した場合はtrue</returns>
+	bool Compile();
+
+	/// <summary>
+	/// コンパイル結果を検証する
+	/// 寿命が重なる一時テクスチャのメモリが重なっていないこと, バリアの遷移前の状態が直前の状態と一致すること,
+	/// 各パスの開始時にリソースが宣言した状態になっていることを調べる
+	/// </summary>
+	/// <returns>問題がない場合はtrue</returns>
+	bool Validate() const;
+
+	bool IsCompiled() const { return m_Compiled; }
+	uint32_t GetPassCount() const { return uint32_t(m_Passes.size()); }
+	uint32_t GetResourceCount() const { return uint32_t(m_Resources.size()); }
+	const FrameGraphStats& GetStats() const { return m_Stats; }
+
+	/// <summary>
+	/// 削除されなかったパスを実行順に取得する
+	/// </summary>
+	const std::vector<uint32_t>& GetExecutionOrder() const { return m_ExecutionOrder; }
+
+	/// <summary>
+	/// パスの実行順の位置を取得する (削除されたパスの場合は UINT32_MAX)
+	/// </summary>
+	uint32_t GetExecutionIndex(uint32_t pass) const;
+
+	const char* GetPassName(uint32_t pass) const { return m_Passes[pass].Name.c_str(); }
+	bool IsPassCulled(uint32_t pass) const { return m_Passes[pass].Culled; }
+	const ExecuteFunc& GetExecuteFunc(uint32_t pass) const { return m_Passes[pass].Func; }
+
+	/// <summary>
+	/// パスの前に発行するバリアを取得する
+	/// </summary>
+	const std::vector<FrameGraphBarrier>& GetBarriers(uint32_t pass) const { return m_Passes[pass].Barriers; }
+
+	/// <summary>
+	/// 全てのパスの後に発行するバリアを取得する
+	/// </summary>
+	const std::vector<FrameGraphBarrier>& GetFinalBarriers() const { return m_FinalBarriers; }
+
+	const char* GetResourceName(FrameGraphHandle resource) const { return m_Resources[resource].Name.c_str(); }
+	bool IsTransient(FrameGraphHandle resource) const { return !m_Resources[resource].Imported; }
+	bool IsResourceUsed(FrameGraphHandle resource) const { return m_Resources[resource].FirstUse != UINT32_MAX; }
+	const FrameGraphTextureDesc& GetTextureDesc(FrameGraphHandle resource) const { return m_Resources[resource].Desc; }
+	uint64_t GetHeapOffset(FrameGraphHandle resource) const { return m_Resources[resource].HeapOffset; }
+
+	/// <summary>
+	/// 実行開始時の状態を取得する (一時テクスチャの場合は前回の実行終了時の状態で, 生成時の状態に使う)
+	/// </summary>
+	D3D12_RESOURCE_STATES GetInitialState(FrameGraphHandle resource) const { return m_Resources[resource].InitialState; }
+
+	/// <summary>
+	/// 実行終了時の状態を取得する
+	/// </summary>
+	D3D12_RESOURCE_STATES GetFinalState(FrameGraphHandle resource) const { return m_Resources[resource].FinalState; }
+
+private:
+	struct Access
+	{
+		FrameGraphHandle		Resource;
+		D3D12_RESOURCE_STATES	State;
+		bool					Write;
+	};
+
+	struct Pass
+	{
+		std::string						Name;
+		ExecuteFunc						Func;
+		bool							HasSideEffect = false;
+		bool							Culled = false;
+		std::vector<Access>				Accesses;
+		std::vector<FrameGraphBarrier>	Barriers;
+	};
+
+	struct Resource
+	{
+		std::string				Name;
+		FrameGraphTextureDesc	Desc;
+		bool					Imported = false;
+		D3D12_RESOURCE_STATES	InitialState = D3D12_RESOURCE_STATE_COMMON;
+		D3D12_RESOURCE_STATES	FinalState = D3D12_RESOURCE_STATE_COMMON;
+		uint32_t				FirstUse = UINT32_MAX;		// 最初に使う実行順
+		uint32_t				LastUse = UINT32_MAX;		// 最後に使う実行順
+		uint64_t				HeapOffset = UINT64_MAX;
+	};
+
+	std::vector<Pass>				m_Passes;
+	std::vector<Resource>			m_Resources;
+	std::vector<uint32_t>			m_ExecutionOrder;
+	std::vector<FrameGraphBarrier>	m_FinalBarriers;
+	FrameGraphStats					m_Stats;
+	bool							m_Compiled;
+	bool							m_HasError;		// 宣言に矛盾があったかどうか
+
+	void CullPasses();
+	bool CalcLifetimes();
+	void PlaceResources(std::vector<FrameGraphHandle>& aliasBefore, std::vector<bool>& aliased);
+	void BuildBarriers(const std::vector<FrameGraphHandle>& aliasBefore, const std::vector<bool>& aliased);
+};
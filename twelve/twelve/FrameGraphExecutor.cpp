@@ -0,0 +1,449 @@
+﻿#include "FrameGraphExecutor.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+
+namespace
+{
+	/// <summary>
+	/// 一時テクスチャのリソースの構成設定を生成する
+	/// </summary>
+	D3D12_RESOURCE_DESC MakeResourceDesc(const FrameGraphTextureDesc& desc)
+	{
+		D3D12_RESOURCE_DESC result = {};
+		result.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		result.Alignment = 0;
+		result.Width = desc.Width;
+		result.Height = desc.Height;
+		result.DepthOrArraySize = 1;
+		result.MipLevels = 1;
+		result.Format = desc.Format;
+		result.SampleDesc.Count = 1;
+		result.SampleDesc.Quality = 0;
+		result.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		result.Flags = desc.Flags;
+		return result;
+	}
+
+	bool IsRenderTarget(const FrameGraphTextureDesc& desc)
+	{
+		return (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) != 0;
+	}
+
+	bool IsDepthStencil(const FrameGraphTextureDesc& desc)
+	{
+		return (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) != 0;
+	}
+}
+
+FrameGraphExecutor::FrameGraphExecutor()
+	: m_HeapSize(0)
+	, m_pPoolRes(nullptr)
+	, m_pPoolRTV(nullptr)
+	, m_pPoolDSV(nullptr)
+	, m_pGraph(nullptr)
+{
+}
+
+FrameGraphExecutor::~FrameGraphExecutor()
+{
+	Term();
+}
+
+void FrameGraphExecutor::CalcAllocationInfo(ID3D12Device* pDevice, FrameGraphTextureDesc& desc)
+{
+	auto resDesc = MakeResourceDesc(desc);
+	auto info = pDevice->GetResourceAllocationInfo(0, 1, &resDesc);
+
+	desc.SizeInBytes = info.SizeInBytes;
+	desc.Alignment = info.Alignment;
+}
+
+bool FrameGraphExecutor::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorPool* pPoolRTV, DescriptorPool* pPoolDSV)
+{
+	if (pDevice == nullptr || pPoolRes == nullptr || pPoolRTV == nullptr || pPoolDSV == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	m_pDevice = pDevice;
+
+	m_pPoolRes = pPoolRes;
+	m_pPoolRes->AddRef();
+
+	m_pPoolRTV = pPoolRTV;
+	m_pPoolRTV->AddRef();
+
+	m_pPoolDSV = pPoolDSV;
+	m_pPoolDSV->AddRef();
+
+	return true;
+}
+
+void FrameGraphExecutor::Term()
+{
+	ReleaseEntries();
+
+	m_pHeap.Reset();
+	m_HeapSize = 0;
+
+	if (m_pPoolRes != nullptr)
+	{
+		m_pPoolRes->Release();
+		m_pPoolRes = nullptr;
+	}
+
+	if (m_pPoolRTV != nullptr)
+	{
+		m_pPoolRTV->Release();
+		m_pPoolRTV = nullptr;
+	}
+
+	if (m_pPoolDSV != nullptr)
+	{
+		m_pPoolDSV->Release();
+		m_pPoolDSV = nullptr;
+	}
+
+	m_pDevice.Reset();
+	m_pGraph = nullptr;
+}
+
+bool FrameGraphExecutor::Realize(const FrameGraph* pGraph)
+{
+	if (pGraph == nullptr || !pGraph->IsCompiled() || m_pDevice == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	ReleaseEntries();
+
+	m_pGraph = pGraph;
+	m_Entries.resize(pGraph->GetResourceCount());
+
+	// ヒープリソース階層1ではレンダーターゲットと深度ステンシル以外を同じヒープに置けない
+	D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+	auto hr = m_pDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options));
+	auto tier1 = FAILED(hr) || options.ResourceHeapTier == D3D12_RESOURCE_HEAP_TIER_1;
+
+	// ヒープが足りない場合は作り直す
+	auto heapSize = pGraph->GetStats().HeapSize;
+	if (heapSize > m_HeapSize)
+	{
+		m_pHeap.Reset();
+		m_HeapSize = 0;
+
+		D3D12_HEAP_DESC desc = {};
+		desc.SizeInBytes = heapSize;
+		desc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		desc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		desc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		desc.Flags = tier1 ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_NONE;
+
+		hr = m_pDevice->CreateHeap(&desc, IID_PPV_ARGS(m_pHeap.GetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreateHeap() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		m_HeapSize = heapSize;
+	}
+
+	for (auto r = 0u; r < pGraph->GetResourceCount(); ++r)
+	{
+		if (!pGraph->IsTransient(r) || !pGraph->IsResourceUsed(r))
+		{
+			continue;
+		}
+
+		auto& desc = pGraph->GetTextureDesc(r);
+		auto& entry = m_Entries[r];
+
+		if (tier1 && !IsRenderTarget(desc) && !IsDepthStencil(desc))
+		{
+			ELOG("Error : Transient Texture Must Be Render Target Or Depth Stencil. name = %s", pGraph->GetResourceName(r));
+			return false;
+		}
+
+		// 最適化クリア値
+		D3D12_CLEAR_VALUE clearValue = {};
+		clearValue.Format = desc.Format;
+		if (IsDepthStencil(desc))
+		{
+			clearValue.DepthStencil.Depth = desc.ClearDepth;
+			clearValue.DepthStencil.Stencil = desc.ClearStencil;
+		}
+		else
+		{
+			for (auto i = 0; i < 4; ++i)
+			{
+				clearValue.Color[i] = desc.ClearColor[i];
+			}
+		}
+
+		auto resDesc = MakeResourceDesc(desc);
+		hr = m_pDevice->CreatePlacedResource(
+			m_pHeap.Get(),
+			pGraph->GetHeapOffset(r),
+			&resDesc,
+			pGraph->GetInitialState(r),
+			(IsRenderTarget(desc) || IsDepthStencil(desc)) ? &clearValue : nullptr,
+			IID_PPV_ARGS(entry.pResource.GetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreatePlacedResource() Failed. name = %s, retcode = 0x%x", pGraph->GetResourceName(r), hr);
+			return false;
+		}
+
+		if (IsRenderTarget(desc))
+		{
+			entry.pHandleRTV = m_pPoolRTV->AllocHandle();
+			if (entry.pHandleRTV == nullptr)
+			{
+				ELOG("Error : Descriptor Handle Allocate Failed.");
+				return false;
+			}
+
+			m_pDevice->CreateRenderTargetView(entry.pResource.Get(), nullptr, entry.pHandleRTV->HandleCPU);
+		}
+
+		if (IsDepthStencil(desc))
+		{
+			entry.pHandleDSV = m_pPoolDSV->AllocHandle();
+			if (entry.pHandleDSV == nullptr)
+			{
+				ELOG("Error : Descriptor Handle Allocate Failed.");
+				return false;
+			}
+
+			m_pDevice->CreateDepthStencilView(entry.pResource.Get(), nullptr, entry.pHandleDSV->HandleCPU);
+		}
+		else if ((desc.Flags & D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE) == 0)
+		{
+			entry.pHandleSRV = m_pPoolRes->AllocHandle();
+			if (entry.pHandleSRV == nullptr)
+			{
+				ELOG("Error : Descriptor Handle Allocate Failed.");
+				return false;
+			}
+
+			m_pDevice->CreateShaderResourceView(entry.pResource.Get(), nullptr, entry.pHandleSRV->HandleCPU);
+		}
+	}
+
+	return true;
+}
+
+void FrameGraphExecutor::SetImportedResource(FrameGraphHandle resource, ID3D12Resource* pResource)
+{
+	if (resource >= m_Entries.size())
+	{
+		ELOG("Error : Invalid Argument.");
+		return;
+	}
+
+	m_Entries[resource].pImported = pResource;
+}
+
+void FrameGraphExecutor::Execute(ID3D12GraphicsCommandList* pCmd)
+{
+	if (m_pGraph == nullptr)
+	{
+		return;
+	}
+
+	Execute(pCmd, 0, uint32_t(m_pGraph->GetExecutionOrder().size()));
+}
+
+void FrameGraphExecutor::Execute(ID3D12GraphicsCommandList* pCmd, uint32_t begin, uint32_t end)
+{
+	if (m_pGraph == nullptr)
+	{
+		return;
+	}
+
+	auto& order = m_pGraph->GetExecutionOrder();
+	end = std::min(end, uint32_t(order.size()));
+
+	for (auto i = begin; i < end; ++i)
+	{
+		auto index = order[i];
+		auto& barriers = m_pGraph->GetBarriers(index);
+		IssueBarriers(pCmd, barriers);
+
+		// メモリを引き継いだレンダーターゲットと深度ステンシルは最初に内容を破棄する
+		for (auto& barrier : barriers)
+		{
+			if (barrier.Type != FRAME_GRAPH_BARRIER_ALIASING)
+			{
+				continue;
+			}
+
+			auto state = m_pGraph->GetInitialState(barrier.Resource);
+			for (auto& other : barriers)
+			{
+				if (other.Type == FRAME_GRAPH_BARRIER_TRANSITION && other.Resource == barrier.Resource)
+				{
+					state = other.StateAfter;
+				}
+			}
+
+			if (state == D3D12_RESOURCE_STATE_RENDER_TARGET || state == D3D12_RESOURCE_STATE_DEPTH_WRITE)
+			{
+				pCmd->DiscardResource(GetResource(barrier.Resource), nullptr);
+			}
+		}
+
+		auto& func = m_pGraph->GetExecuteFunc(index);
+		if (func)
+		{
+			func(pCmd);
+		}
+	}
+
+	if (end == order.size())
+	{
+		IssueBarriers(pCmd, m_pGraph->GetFinalBarriers());
+	}
+}
+
+void FrameGraphExecutor::ClearView(ID3D12GraphicsCommandList* pCmd, FrameGraphHandle resource)
+{
+	if (m_pGraph == nullptr || resource >= m_Entries.size())
+	{
+		return;
+	}
+
+	auto& desc = m_pGraph->GetTextureDesc(resource);
+	auto& entry = m_Entries[resource];
+
+	if (entry.pHandleRTV != nullptr)
+	{
+		pCmd->ClearRenderTargetView(entry.pHandleRTV->HandleCPU, desc.ClearColor, 0, nullptr);
+	}
+
+	if (entry.pHandleDSV != nullptr)
+	{
+		pCmd->ClearDepthStencilView(
+			entry.pHandleDSV->HandleCPU,
+			D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL,
+			desc.ClearDepth,
+			desc.ClearStencil,
+			0,
+			nullptr);
+	}
+}
+
+ID3D12Resource* FrameGraphExecutor::GetResource(FrameGraphHandle resource) const
+{
+	if (resource >= m_Entries.size())
+	{
+		return nullptr;
+	}
+
+	auto& entry = m_Entries[resource];
+	return (entry.pImported != nullptr) ? entry.pImported : entry.pResource.Get();
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE FrameGraphExecutor::GetHandleRTV(FrameGraphHandle resource) const
+{
+	if (resource >= m_Entries.size() || m_Entries[resource].pHandleRTV == nullptr)
+	{
+		return D3D12_CPU_DESCRIPTOR_HANDLE();
+	}
+
+	return m_Entries[resource].pHandleRTV->HandleCPU;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE FrameGraphExecutor::GetHandleDSV(FrameGraphHandle resource) const
+{
+	if (resource >= m_Entries.size() || m_Entries[resource].pHandleDSV == nullptr)
+	{
+		return D3D12_CPU_DESCRIPTOR_HANDLE();
+	}
+
+	return m_Entries[resource].pHandleDSV->HandleCPU;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE FrameGraphExecutor::GetHandleSRV(FrameGraphHandle resource) const
+{
+	if (resource >= m_Entries.size() || m_Entries[resource].pHandleSRV == nullptr)
+	{
+		return D3D12_GPU_DESCRIPTOR_HANDLE();
+	}
+
+	return m_Entries[resource].pHandleSRV->HandleGPU;
+}
+
+void FrameGraphExecutor::ReleaseEntries()
+{
+	for (auto& entry : m_Entries)
+	{
+		if (entry.pHandleRTV != nullptr && m_pPoolRTV != nullptr)
+		{
+			m_pPoolRTV->FreeHandle(entry.pHandleRTV);
+		}
+
+		if (entry.pHandleDSV != nullptr && m_pPoolDSV != nullptr)
+		{
+			m_pPoolDSV->FreeHandle(entry.pHandleDSV);
+		}
+
+		if (entry.pHandleSRV != nullptr && m_pPoolRes != nullptr)
+		{
+			m_pPoolRes->FreeHandle(entry.pHandleSRV);
+		}
+
+		entry.pResource.Reset();
+	}
+
+	m_Entries.clear();
+}
+
+void FrameGraphExecutor::IssueBarriers(ID3D12GraphicsCommandList* pCmd, const std::vector<FrameGraphBarrier>& barriers)
+{
+	if (barriers.empty())
+	{
+		return;
+	}
+
+	m_Barriers.clear();
+
+	for (auto& barrier : barriers)
+	{
+		D3D12_RESOURCE_BARRIER desc = {};
+
+		switch (barrier.Type)
+		{
+		case FRAME_GRAPH_BARRIER_TRANSITION:
+			desc.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+			desc.Flags = barrier.Flags;
+			desc.Transition.pResource = GetResource(barrier.Resource);
+			desc.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+			desc.Transition.StateBefore = barrier.StateBefore;
+			desc.Transition.StateAfter = barrier.StateAfter;
+			break;
+
+		case FRAME_GRAPH_BARRIER_ALIASING:
+			desc.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+			desc.Aliasing.pResourceBefore = (barrier.AliasBefore != FrameGraphInvalidHandle) ? GetResource(barrier.AliasBefore) : nullptr;
+			desc.Aliasing.pResourceAfter = GetResource(barrier.Resource);
+			break;
+
+		case FRAME_GRAPH_BARRIER_UAV:
+			desc.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+			desc.UAV.pResource = GetResource(barrier.Resource);
+			break;
+		}
+
+		m_Barriers.push_back(desc);
+	}
+
+	// パスごとに1回の呼び出しにまとめる
+	pCmd->ResourceBarrier(UINT(m_Barriers.size()), m_Barriers.data());
+}
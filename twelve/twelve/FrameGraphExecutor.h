@@ -0,0 +1,109 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <vector>
+
+#include "ComPtr.h"
+#include "DescriptorPool.h"
+#include "FrameGraph.h"
+
+/// <summary>
+/// コンパイル済みのフレームグラフを実行する
+/// 一時テクスチャは1つのヒープ上に配置リソースとして生成し, 寿命が重ならないもの同士でメモリを共有する
+/// </summary>
+class FrameGraphExecutor
+{
+public:
+	FrameGraphExecutor();
+	~FrameGraphExecutor();
+
+	/// <summary>
+	/// 一時テクスチャのヒープ上のサイズとアライメントを求める (FrameGraph::CreateTexture() の前に呼ぶ)
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="desc">構成設定 (SizeInBytes と Alignment を更新する)</param>
+	static void CalcAllocationInfo(ID3D12Device* pDevice, FrameGraphTextureDesc& desc);
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="pPoolRes">ディスクリプタプール (CBV/SRV/UAV)</param>
+	/// <param name="pPoolRTV">ディスクリプタプール (RTV)</param>
+	/// <param name="pPoolDSV">ディスクリプタプール (DSV)</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorPool* pPoolRTV, DescriptorPool* pPoolDSV);
+
+	void Term();
+
+	/// <summary>
+	/// コンパイル済みのグラフの一時テクスチャとビューを生成する
+	/// グラフを再コンパイルした場合は呼び直すこと
+	/// </summary>
+	/// <param name="pGraph">コンパイル済みのフレームグラフ</param>
+	/// <returns>生成に成功した場合はtrue</returns>
+	bool Realize(const FrameGraph* pGraph);
+
+	/// <summary>
+	/// インポートしたリソースの実体を設定する
+	/// </summary>
+	void SetImportedResource(FrameGraphHandle resource, ID3D12Resource* pResource);
+
+	/// <summary>
+	/// バリアを発行しながら各パスを実行する
+	/// </summary>
+	/// <param name="pCmd">コマンドリスト</param>
+	void Execute(ID3D12GraphicsCommandList* pCmd);
+
+	/// <summary>
+	/// 実行順で [begin, end) の範囲のパスを実行する (end が実行するパスの数の場合は最後のバリアも発行する)
+	/// 途中でコマンドリストを切り替えて, 間に別のコマンドリストを挟む場合に使う
+	/// </summary>
+	/// <param name="pCmd">コマンドリスト</param>
+	/// <param name="begin">開始位置</param>
+	/// <param name="end">終了位置 (含まない)</param>
+	void Execute(ID3D12GraphicsCommandList* pCmd, uint32_t begin, uint32_t end);
+
+	/// <summary>
+	/// 一時テクスチャを構成設定のクリア値でクリアする
+	/// </summary>
+	void ClearView(ID3D12GraphicsCommandList* pCmd, FrameGraphHandle resource);
+
+	ID3D12Resource* GetResource(FrameGraphHandle resource) const;
+	D3D12_CPU_DESCRIPTOR_HANDLE GetHandleRTV(FrameGraphHandle resource) const;
+	D3D12_CPU_DESCRIPTOR_HANDLE GetHandleDSV(FrameGraphHandle resource) const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GetHandleSRV(FrameGraphHandle resource) const;
+
+private:
+	struct Entry
+	{
+		ComPtr<ID3D12Resource>	pResource;
+		ID3D12Resource*			pImported = nullptr;
+		DescriptorHandle*		pHandleRTV = nullptr;
+		DescriptorHandle*		pHandleDSV = nullptr;
+		DescriptorHandle*		pHandleSRV = nullptr;
+	};
+
+	ComPtr<ID3D12Device>				m_pDevice;
+	ComPtr<ID3D12Heap>					m_pHeap;
+	uint64_t							m_HeapSize;
+	DescriptorPool*						m_pPoolRes;
+	DescriptorPool*						m_pPoolRTV;
+	DescriptorPool*						m_pPoolDSV;
+	const FrameGraph*					m_pGraph;
+	std::vector<Entry>					m_Entries;
+	std::vector<D3D12_RESOURCE_BARRIER>	m_Barriers;		// 発行用の作業領域
+
+	/// <summary>
+	/// 一時テクスチャとビューを破棄する
+	/// </summary>
+	void ReleaseEntries();
+
+	/// <summary>
+	/// バリアをまとめて発行する
+	/// </summary>
+	void IssueBarriers(ID3D12GraphicsCommandList* pCmd, const std::vector<FrameGraphBarrier>& barriers);
+
+	FrameGraphExecutor(const FrameGraphExecutor&) = delete;
+	void operator=(const FrameGraphExecutor&) = delete;
+};
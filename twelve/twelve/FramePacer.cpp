@@ -0,0 +1,224 @@
+﻿#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include "Logger.h"
+
+namespace
+{
+	// 処理時間の指数移動平均の係数
+	constexpr double TimeSmoothing = 0.1;
+
+	// 直列化 (レイテンシ1) を選ぶスループットの低下の上限 (律速でない側の時間 / フレーム全体)
+	constexpr double MaxSerialThroughputLoss = 0.1;
+
+	// 揺らぎとして吸収する標準偏差の倍数
+	constexpr double DeviationScale = 2.0;
+
+	// レイテンシを下げるまでに望ましい値が続く必要があるフレーム数 (上げる場合は直ちに上げる)
+	constexpr uint32_t LatencyDecreaseFrames = 30;
+}
+
+void FramePacer::TimeStats::Add(double value)
+{
+	if (Count == 0)
+	{
+		Mean = value;
+		Variance = 0.0;
+	}
+	else
+	{
+		auto diff = value - Mean;
+		Mean += TimeSmoothing * diff;
+		Variance = (1.0 - TimeSmoothing) * (Variance + TimeSmoothing * diff * diff);
+	}
+
+	Count++;
+}
+
+double FramePacer::TimeStats::GetDeviation() const
+{
+	return std::sqrt(Variance);
+}
+
+FramePacer::FramePacer()
+	: m_SubmittedCount(0)
+	, m_FrameCount(0)
+	, m_Latency(0)
+	, m_LowerCount(0)
+	, m_Mode(FRAME_PACING_AUTO)
+{
+	std::fill(std::begin(m_FenceValues), std::end(m_FenceValues), 0);
+}
+
+FramePacer::~FramePacer()
+{
+	Term();
+}
+
+bool FramePacer::Init(uint32_t frameCount, FramePacingMode mode)
+{
+	if (frameCount < Constants::MinFrameCount || frameCount > Constants::MaxFrameCount || mode >= FRAME_PACING_COUNT)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	std::fill(std::begin(m_FenceValues), std::end(m_FenceValues), 0);
+	m_SubmittedCount = 0;
+	m_FrameCount = frameCount;
+	m_Cpu = TimeStats();
+	m_Gpu = TimeStats();
+
+	// 処理時間が分かるまではフレームバッファ数まで先行させる
+	m_Latency = frameCount;
+	m_LowerCount = 0;
+
+	SetMode(mode);
+
+	return true;
+}
+
+void FramePacer::Term()
+{
+	std::fill(std::begin(m_FenceValues), std::end(m_FenceValues), 0);
+	m_SubmittedCount = 0;
+	m_FrameCount = 0;
+	m_Latency = 0;
+	m_LowerCount = 0;
+}
+
+void FramePacer::SetMode(FramePacingMode mode)
+{
+	if (mode >= FRAME_PACING_COUNT)
+	{
+		return;
+	}
+
+	m_Mode = mode;
+	m_LowerCount = 0;
+
+	if (m_FrameCount > 0)
+	{
+		UpdateLatency();
+	}
+}
+
+uint64_t FramePacer::GetWaitValue() const
+{
+	// レイテンシ分だけ前のフレームがまだない
+	if (m_Latency == 0 || m_SubmittedCount < m_Latency)
+	{
+		return 0;
+	}
+
+	return m_FenceValues[(m_SubmittedCount - m_Latency) % Constants::MaxFrameCount];
+}
+
+void FramePacer::Submit(uint64_t fenceValue, double cpuMilliseconds)
+{
+	m_FenceValues[m_SubmittedCount % Constants::MaxFrameCount] = fenceValue;
+	m_SubmittedCount++;
+
+	m_Cpu.Add(cpuMilliseconds);
+
+	UpdateLatency();
+}
+
+void FramePacer::ReportGpuTime(double gpuMilliseconds)
+{
+	m_Gpu.Add(gpuMilliseconds);
+}
+
+void FramePacer::UpdateLatency()
+{
+	uint32_t desired = m_FrameCount;
+
+	switch (m_Mode)
+	{
+	case FRAME_PACING_LATENCY:
+		desired = 1;
+		break;
+
+	case FRAME_PACING_THROUGHPUT:
+		desired = m_FrameCount;
+		break;
+
+	case FRAME_PACING_AUTO:
+		if (m_Cpu.Count > 0 && m_Gpu.Count > 0)
+		{
+			desired = ComputeFramePacingLatency(
+				m_FrameCount,
+				m_Cpu.Mean,
+				m_Cpu.GetDeviation(),
+				m_Gpu.Mean,
+				m_Gpu.GetDeviation());
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	// 固定の方針はそのまま使う
+	if (m_Mode != FRAME_PACING_AUTO)
+	{
+		m_Latency = desired;
+		m_LowerCount = 0;
+		return;
+	}
+
+	// 上げる場合は待機が発生しないように直ちに上げ, 下げる場合は一時的な揺らぎで振動しないように様子を見る
+	if (desired > m_Latency)
+	{
+		m_Latency = desired;
+		m_LowerCount = 0;
+	}
+	else if (desired < m_Latency)
+	{
+		m_LowerCount++;
+		if (m_LowerCount >= LatencyDecreaseFrames)
+		{
+			m_Latency = desired;
+			m_LowerCount = 0;
+		}
+	}
+	else
+	{
+		m_LowerCount = 0;
+	}
+}
+
+uint32_t ComputeFramePacingLatency(uint32_t frameCount, double cpuMean, double cpuDeviation, double gpuMean, double gpuDeviation)
+{
+	if (frameCount <= 1)
+	{
+		return 1;
+	}
+
+	auto total = cpuMean + gpuMean;
+	if (total <= 0.0)
+	{
+		return frameCount;
+	}
+
+	// 直列化した場合の周期は CPU + GPU, 並列化した場合は律速側の時間になるので,
+	// 差 (律速でない側の時間) が小さければ直列化して遅延を最小にする
+	auto cpuBound = cpuMean >= gpuMean;
+	auto slow = cpuBound ? cpuMean : gpuMean;
+	auto fast = cpuBound ? gpuMean : cpuMean;
+	auto fastDeviation = cpuBound ? gpuDeviation : cpuDeviation;
+
+	if (fast / total <= MaxSerialThroughputLoss)
+	{
+		return 1;
+	}
+
+	// 律速でない側が (latency - 1) フレーム分の律速側の時間に収まれば律速側は待たない
+	auto required = 1.0 + std::ceil((fast + DeviationScale * fastDeviation) / slow);
+	auto latency = uint32_t(std::min(required, double(frameCount)));
+
+	return std::max(latency, 2u);
+}
@@ -0,0 +1,115 @@
+﻿#pragma once
+
+#include <cstdint>
+
+#include "Constants.h"
+
+/// <summary>
+/// フレームペーシングの方針
+/// </summary>
+enum FramePacingMode
+{
+	FRAME_PACING_LATENCY = 0,	// 前のフレームの完了を待ってから記録する (遅延が最小)
+	FRAME_PACING_THROUGHPUT,	// フレームバッファ数まで先行して記録する (スループットが最大)
+	FRAME_PACING_AUTO,			// CPU/GPUの処理時間から先行フレーム数を選ぶ
+
+	FRAME_PACING_COUNT
+};
+
+/// <summary>
+/// フレームペーシング (デバイスに依存しない部分)
+/// 提出したフレームのフェンス値をフレーム番号ごとのリングに記録し, 次のフレームの記録を始める前に
+/// 先行フレーム数 (レイテンシ) だけ前のフレームの完了を待つ
+/// レイテンシはフレームバッファ数以下なので, 再利用するフレームバッファの完了も保証される
+/// </summary>
+class FramePacer
+{
+public:
+	FramePacer();
+	~FramePacer();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="frameCount">フレームバッファ数 (Constants::MinFrameCount ～ Constants::MaxFrameCount)</param>
+	/// <param name="mode">ペーシングの方針</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Init(uint32_t frameCount, FramePacingMode mode);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// ペーシングの方針を設定する
+	/// </summary>
+	void SetMode(FramePacingMode mode);
+
+	/// <summary>
+	/// 次のフレームの記録を始める前に完了を待つフェンス値を取得する
+	/// </summary>
+	/// <returns>フェンス値 (待つ必要がない場合は0)</returns>
+	uint64_t GetWaitValue() const;
+
+	/// <summary>
+	/// フレームの提出を記録する
+	/// </summary>
+	/// <param name="fenceValue">フレームの完了時にシグナルされるフェンス値</param>
+	/// <param name="cpuMilliseconds">フレームの記録にかかったCPU時間 (待機は含まない) [ms]</param>
+	void Submit(uint64_t fenceValue, double cpuMilliseconds);
+
+	/// <summary>
+	/// 完了したフレームのGPU時間を報告する
+	/// </summary>
+	/// <param name="gpuMilliseconds">GPU時間 [ms]</param>
+	void ReportGpuTime(double gpuMilliseconds);
+
+	FramePacingMode GetMode() const { return m_Mode; }
+	uint32_t GetFrameCount() const { return m_FrameCount; }
+	uint32_t GetLatency() const { return m_Latency; }
+	uint64_t GetSubmittedCount() const { return m_SubmittedCount; }
+	double GetCpuTime() const { return m_Cpu.Mean; }
+	double GetGpuTime() const { return m_Gpu.Mean; }
+
+private:
+	/// <summary>
+	/// 処理時間の指数移動平均と分散
+	/// </summary>
+	struct TimeStats
+	{
+		double		Mean = 0.0;
+		double		Variance = 0.0;
+		uint32_t	Count = 0;
+
+		void Add(double value);
+		double GetDeviation() const;
+	};
+
+	uint64_t			m_FenceValues[Constants::MaxFrameCount];	// フレーム番号ごとの提出したフェンス値
+	uint64_t			m_SubmittedCount;							// 提出したフレーム数
+	uint32_t			m_FrameCount;								// フレームバッファ数
+	uint32_t			m_Latency;									// 先行して記録するフレーム数
+	uint32_t			m_LowerCount;								// 望ましいレイテンシが現在より小さいフレームが続いた数
+	FramePacingMode		m_Mode;
+	TimeStats			m_Cpu;
+	TimeStats			m_Gpu;
+
+	/// <summary>
+	/// 処理時間から望ましいレイテンシを求めて更新する
+	/// </summary>
+	void UpdateLatency();
+};
+
+/// <summary>
+/// CPU/GPUの処理時間からペーシング (FRAME_PACING_AUTO) で選ぶレイテンシを求める
+///  - 直列化 (レイテンシ1) で失うスループットが小さい場合は1
+///  - それ以外は律速でない側の処理時間の揺らぎを吸収し, 律速側を待たせない最小の数 (2以上)
+/// </summary>
+/// <param name="frameCount">フレームバッファ数</param>
+/// <param name="cpuMean">CPU時間の平均 [ms]</param>
+/// <param name="cpuDeviation">CPU時間の標準偏差 [ms]</param>
+/// <param name="gpuMean">GPU時間の平均 [ms]</param>
+/// <param name="gpuDeviation">GPU時間の標準偏差 [ms]</param>
+/// <returns>レイテンシ (1 ～ frameCount)</returns>
+uint32_t ComputeFramePacingLatency(uint32_t frameCount, double cpuMean, double cpuDeviation, double gpuMean, double gpuDeviation);
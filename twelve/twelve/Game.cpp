@@ -17,7 +17,7 @@ Game::~Game()
 {
 }
 
-bool Game::Initialize()
+bool Game::Initialize(uint32_t frameCount)
 {
 	// プラットフォーム層の初期化
 	if (!m_Window.Initialize(Constants::WindowWidth, Constants::WindowHeight, "twelve"))
@@ -37,7 +37,7 @@ bool Game::Initialize()
 
 	// D3D12の初期化
 	m_pD3D12 = std::make_shared<D3D12Wrapper>();
-	if (!m_pD3D12->Initialize(m_Window.GetHandle()))
+	if (!m_pD3D12->Initialize(m_Window.GetHandle(), frameCount))
 	{
 		return false;
 	}
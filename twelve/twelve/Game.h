@@ -3,6 +3,7 @@
 #include <Windows.h>
 #include <cstdint>
 #include <memory>
+#include "Constants.h"
 #include "PlatformWindow.h"
 
 class D3D12Wrapper;
@@ -21,7 +22,12 @@ public:
 	Game();
 	~Game();
 
-	bool Initialize();
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="frameCount">フレームバッファ数 (同時に処理するフレーム数)</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Initialize(uint32_t frameCount = Constants::DefaultFrameCount);
 	void RunLoop();
 	void Terminate();
 
@@ -0,0 +1,163 @@
+﻿#include "GpuTimer.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+
+namespace
+{
+	constexpr uint32_t QueryCountPerFrame = 2;
+}
+
+GpuTimer::GpuTimer()
+	: m_Frequency(0)
+{
+	std::fill(std::begin(m_Recorded), std::end(m_Recorded), false);
+}
+
+GpuTimer::~GpuTimer()
+{
+	Term();
+}
+
+bool GpuTimer::Init(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue)
+{
+	if (pDevice == nullptr || pQueue == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	const auto queryCount = QueryCountPerFrame * Constants::MaxFrameCount;
+
+	// タイムスタンプクエリの生成
+	{
+		D3D12_QUERY_HEAP_DESC desc = {};
+		desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+		desc.Count = queryCount;
+		desc.NodeMask = 0;
+
+		auto hr = pDevice->CreateQueryHeap(&desc, IID_PPV_ARGS(m_pQueryHeap.ReleaseAndGetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreateQueryHeap() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+	}
+
+	// 読み戻し用バッファの生成
+	{
+		D3D12_HEAP_PROPERTIES props = {};
+		props.Type = D3D12_HEAP_TYPE_READBACK;
+		props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Width = sizeof(uint64_t) * queryCount;
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		auto hr = pDevice->CreateCommittedResource(
+			&props,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(m_pReadback.ReleaseAndGetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreateCommittedResource() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+	}
+
+	auto hr = pQueue->GetTimestampFrequency(&m_Frequency);
+	if (FAILED(hr))
+	{
+		ELOG("Error : ID3D12CommandQueue::GetTimestampFrequency() Failed. retcode = 0x%x", hr);
+		return false;
+	}
+
+	std::fill(std::begin(m_Recorded), std::end(m_Recorded), false);
+
+	return true;
+}
+
+void GpuTimer::Term()
+{
+	m_pQueryHeap.Reset();
+	m_pReadback.Reset();
+	m_Frequency = 0;
+	std::fill(std::begin(m_Recorded), std::end(m_Recorded), false);
+}
+
+void GpuTimer::Begin(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex)
+{
+	if (pCmd == nullptr || m_pQueryHeap == nullptr || frameIndex >= Constants::MaxFrameCount)
+	{
+		return;
+	}
+
+	pCmd->EndQuery(m_pQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * QueryCountPerFrame);
+}
+
+void GpuTimer::End(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex)
+{
+	if (pCmd == nullptr || m_pQueryHeap == nullptr || frameIndex >= Constants::MaxFrameCount)
+	{
+		return;
+	}
+
+	const auto queryOffset = frameIndex * QueryCountPerFrame;
+
+	pCmd->EndQuery(m_pQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, queryOffset + 1);
+	pCmd->ResolveQueryData(
+		m_pQueryHeap.Get(),
+		D3D12_QUERY_TYPE_TIMESTAMP,
+		queryOffset,
+		QueryCountPerFrame,
+		m_pReadback.Get(),
+		sizeof(uint64_t) * queryOffset);
+
+	m_Recorded[frameIndex] = true;
+}
+
+bool GpuTimer::Resolve(uint32_t frameIndex, double& milliseconds)
+{
+	if (m_pReadback == nullptr || frameIndex >= Constants::MaxFrameCount || !m_Recorded[frameIndex] || m_Frequency == 0)
+	{
+		return false;
+	}
+
+	const auto queryOffset = frameIndex * QueryCountPerFrame;
+
+	D3D12_RANGE range = {};
+	range.Begin = sizeof(uint64_t) * queryOffset;
+	range.End = range.Begin + sizeof(uint64_t) * QueryCountPerFrame;
+
+	uint64_t* pTimestamps = nullptr;
+	auto hr = m_pReadback->Map(0, &range, reinterpret_cast<void**>(&pTimestamps));
+	if (FAILED(hr))
+	{
+		ELOG("Error : ID3D12Resource::Map() Failed. retcode = 0x%x", hr);
+		return false;
+	}
+
+	pTimestamps += queryOffset;
+	auto ticks = (pTimestamps[1] > pTimestamps[0]) ? pTimestamps[1] - pTimestamps[0] : 0;
+	milliseconds = double(ticks) * 1000.0 / double(m_Frequency);
+
+	D3D12_RANGE written = {};
+	m_pReadback->Unmap(0, &written);
+
+	m_Recorded[frameIndex] = false;
+
+	return true;
+}
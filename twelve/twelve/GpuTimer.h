@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <cstdint>
+
+#include "ComPtr.h"
+#include "Constants.h"
+
+/// <summary>
+/// フレームごとのGPU時間をタイムスタンプクエリで計測する
+/// 結果はフレーム番号ごとの読み戻し用バッファに解決し, 同じフレーム番号を再利用する時 (完了後) に読み出す
+/// </summary>
+class GpuTimer
+{
+public:
+	GpuTimer();
+	~GpuTimer();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="pQueue">コマンドキュー (タイムスタンプの周波数の取得に使用する)</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Init(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// 計測を開始する (フレームの最初のコマンドリストに記録する)
+	/// </summary>
+	/// <param name="pCmd">コマンドリスト</param>
+	/// <param name="frameIndex">フレーム番号</param>
+	void Begin(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex);
+
+	/// <summary>
+	/// 計測を終了し, 結果を読み戻し用バッファに解決する (フレームの最後のコマンドリストに記録する)
+	/// </summary>
+	/// <param name="pCmd">コマンドリスト</param>
+	/// <param name="frameIndex">フレーム番号</param>
+	void End(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex);
+
+	/// <summary>
+	/// 前回このフレーム番号で計測した結果を取得する (そのフレームの完了を待ってから呼び出す)
+	/// </summary>
+	/// <param name="frameIndex">フレーム番号</param>
+	/// <param name="milliseconds">GPU時間 [ms]</param>
+	/// <returns>結果がある場合はtrue</returns>
+	bool Resolve(uint32_t frameIndex, double& milliseconds);
+
+private:
+	ComPtr<ID3D12QueryHeap>	m_pQueryHeap;							// タイムスタンプクエリ (フレームごとに開始と終了)
+	ComPtr<ID3D12Resource>	m_pReadback;							// クエリ結果の読み戻し用バッファ
+	uint64_t				m_Frequency;							// タイムスタンプの周波数
+	bool					m_Recorded[Constants::MaxFrameCount];	// フレームごとに記録済みかどうか
+
+	GpuTimer(const GpuTimer&) = delete;
+	void operator=(const GpuTimer&) = delete;
+};
@@ -0,0 +1,953 @@
+﻿#include "HDRImageLoader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include "ExrCompression.h"
+#include "ParallelFor.h"
+#include "Logger.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	const uint16_t HalfOne = 0x3c00;	// 半精度浮動小数点数の1.0
+
+	/// <summary>
+	/// ファイルパスの拡張子を小文字で取得する
+	/// </summary>
+	std::wstring GetExtension(const wchar_t* path)
+	{
+		std::wstring result(path);
+		auto pos = result.find_last_of(L'.');
+		if (pos == std::wstring::npos)
+		{
+			return std::wstring();
+		}
+
+		result = result.substr(pos + 1);
+		for (auto& c : result) { c = towlower(c); }
+
+		return result;
+	}
+
+	/// <summary>
+	/// ファイルの内容を全て読み込む
+	/// </summary>
+	bool ReadFileData(const wchar_t* path, std::vector<uint8_t>& data)
+	{
+		std::ifstream stream(std::filesystem::path(path), std::ios::binary | std::ios::ate);
+		if (!stream)
+		{
+			return false;
+		}
+
+		auto size = size_t(stream.tellg());
+		stream.seekg(0, std::ios::beg);
+
+		data.resize(size);
+		return size == 0 || bool(stream.read(reinterpret_cast<char*>(data.data()), std::streamsize(size)));
+	}
+
+	// ---- Radiance HDR ----
+
+	/// <summary>
+	/// ヘッダの1行を読み込む
+	/// </summary>
+	bool ReadLine(const uint8_t* pData, size_t size, size_t& pos, std::string& line)
+	{
+		line.clear();
+		while (pos < size)
+		{
+			auto c = char(pData[pos++]);
+			if (c == '\n')
+			{
+				return true;
+			}
+
+			line.push_back(c);
+		}
+
+		return false;
+	}
+
+	/// <summary>
+	/// 解像度の行を読み込む
+	/// </summary>
+	bool ParseResolution(const std::string& line, const char* format, int& height, int& width)
+	{
+#if defined(_WIN32)
+		return sscanf_s(line.c_str(), format, &height, &width) == 2;
+#else
+		return sscanf(line.c_str(), format, &height, &width) == 2;
+#endif
+	}
+
+	/// <summary>
+	/// 1走査線分のデータの終端を求める
+	/// </summary>
+	bool SkipScanline(const uint8_t* pData, size_t size, uint32_t width, size_t& pos)
+	{
+		const auto flatSize = size_t(width) * 4;
+
+		// 新形式のランレングス圧縮は 2, 2, 横幅の上位, 下位 で始まる
+		auto isRLE = width >= 8 && width < 0x8000 && pos + 4 <= size
+			&& pData[pos] == 2 && pData[pos + 1] == 2
+			&& ((uint32_t(pData[pos + 2]) << 8) | pData[pos + 3]) == width;
+
+		if (!isRLE)
+		{
+			pos += flatSize;
+			return pos <= size;
+		}
+
+		pos += 4;
+		for (auto c = 0; c < 4; ++c)
+		{
+			auto x = 0u;
+			while (x < width)
+			{
+				if (pos >= size)
+				{
+					return false;
+				}
+
+				auto count = uint32_t(pData[pos++]);
+				if (count > 128)
+				{
+					count -= 128;
+					pos += 1;
+				}
+				else
+				{
+					if (count == 0)
+					{
+						return false;
+					}
+
+					pos += count;
+				}
+
+				x += count;
+			}
+
+			if (x != width || pos > size)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/// <summary>
+	/// 1走査線分のデータをRGBEのバイト列に展開する
+	/// </summary>
+	void ExpandScanline(const uint8_t* pData, size_t pos, uint32_t width, uint8_t* pRGBE)
+	{
+		auto isRLE = width >= 8 && width < 0x8000
+			&& pData[pos] == 2 && pData[pos + 1] == 2
+			&& ((uint32_t(pData[pos + 2]) << 8) | pData[pos + 3]) == width;
+
+		if (!isRLE)
+		{
+			memcpy(pRGBE, pData + pos, size_t(width) * 4);
+			return;
+		}
+
+		// チャンネルごとに圧縮されているため, 展開しながらインターリーブする
+		pos += 4;
+		for (auto c = 0; c < 4; ++c)
+		{
+			auto x = 0u;
+			while (x < width)
+			{
+				auto count = uint32_t(pData[pos++]);
+				if (count > 128)
+				{
+					count -= 128;
+					auto value = pData[pos++];
+					for (auto i = 0u; i < count; ++i)
+					{
+						pRGBE[(x + i) * 4 + c] = value;
+					}
+				}
+				else
+				{
+					for (auto i = 0u; i < count; ++i)
+					{
+						pRGBE[(x + i) * 4 + c] = pData[pos++];
+					}
+				}
+
+				x += count;
+			}
+		}
+	}
+
+	/// <summary>
+	/// 共有指数の倍率のテーブル (Ward の colr_color() と同じく 2^(e - 136))
+	/// </summary>
+	struct RGBEScaleTable
+	{
+		float Scale[256];
+
+		RGBEScaleTable()
+		{
+			Scale[0] = 0.0f;
+			for (auto e = 1; e < 256; ++e)
+			{
+				Scale[e] = std::ldexp(1.0f, e - (128 + 8));
+			}
+		}
+	};
+
+	/// <summary>
+	/// RGBEのバイト列を RGBA16F に変換する
+	/// </summary>
+	void ConvertRGBEToHalf(const uint8_t* pRGBE, uint32_t width, XMFLOAT4* pTmp, uint16_t* pDst)
+	{
+		static const RGBEScaleTable table;
+
+		const auto bias = XMVectorSet(0.5f, 0.5f, 0.5f, 0.0f);
+		const auto alpha = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+		const auto mask = XMVectorSelectControl(1, 1, 1, 0);
+
+		for (auto x = 0u; x < width; ++x)
+		{
+			auto p = pRGBE + x * 4;
+
+			// (仮数 + 0.5) * 2^(指数 - 136)
+			auto mantissa = XMLoadUByte4(reinterpret_cast<const XMUBYTE4*>(p));
+			auto color = XMVectorMultiply(XMVectorAdd(mantissa, bias), XMVectorReplicate(table.Scale[p[3]]));
+			XMStoreFloat4(&pTmp[x], XMVectorSelect(alpha, color, mask));
+		}
+
+		XMConvertFloatToHalfStream(pDst, sizeof(HALF), &pTmp[0].x, sizeof(float), size_t(width) * 4);
+	}
+
+	// ---- OpenEXR ----
+
+	enum EXR_PIXEL_TYPE
+	{
+		EXR_PIXEL_UINT = 0,
+		EXR_PIXEL_HALF = 1,
+		EXR_PIXEL_FLOAT = 2,
+	};
+
+	enum EXR_COMPRESSION
+	{
+		EXR_COMPRESSION_NONE = 0,
+		EXR_COMPRESSION_RLE = 1,
+		EXR_COMPRESSION_ZIPS = 2,
+		EXR_COMPRESSION_ZIP = 3,
+		EXR_COMPRESSION_PIZ = 4,
+	};
+
+	const uint32_t ExrMagic = 20000630;
+	const uint32_t ExrFlagTiled = 0x200;
+	const uint32_t ExrFlagDeep = 0x800;
+	const uint32_t ExrFlagMultiPart = 0x1000;
+
+	struct ExrChannel
+	{
+		std::string Name;
+		int         PixelType;
+		int         XSampling;
+		int         YSampling;
+		int         Target;		// 出力先の要素 (0:R 1:G 2:B 3:A -1:未使用 4:輝度をRGBに複製)
+	};
+
+	struct ExrHeader
+	{
+		std::vector<ExrChannel> Channels;
+		int         Compression = EXR_COMPRESSION_NONE;
+		int         MinX = 0;
+		int         MinY = 0;
+		int         MaxX = -1;
+		int         MaxY = -1;
+		bool        Tiled = false;
+		uint32_t    TileWidth = 0;
+		uint32_t    TileHeight = 0;
+		size_t      HeaderSize = 0;
+	};
+
+	inline int32_t ReadInt32(const uint8_t* p)
+	{
+		return int32_t(uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24));
+	}
+
+	inline uint64_t ReadUInt64(const uint8_t* p)
+	{
+		return uint64_t(uint32_t(ReadInt32(p))) | (uint64_t(uint32_t(ReadInt32(p + 4))) << 32);
+	}
+
+	uint32_t GetPixelSize(int pixelType)
+	{
+		return (pixelType == EXR_PIXEL_HALF) ? 2 : 4;
+	}
+
+	uint32_t GetLinesPerBlock(int compression)
+	{
+		switch (compression)
+		{
+			case EXR_COMPRESSION_ZIP: return 16;
+			case EXR_COMPRESSION_PIZ: return 32;
+			default: return 1;
+		}
+	}
+
+	/// <summary>
+	/// 終端文字までの文字列を読み込む
+	/// </summary>
+	bool ReadString(const uint8_t* pData, size_t size, size_t& pos, std::string& value)
+	{
+		auto pEnd = static_cast<const uint8_t*>(memchr(pData + pos, 0, size - pos));
+		if (pEnd == nullptr)
+		{
+			return false;
+		}
+
+		value.assign(reinterpret_cast<const char*>(pData + pos), pEnd - (pData + pos));
+		pos = size_t(pEnd - pData) + 1;
+		return true;
+	}
+
+	bool ParseChannels(const uint8_t* pData, size_t size, ExrHeader& header)
+	{
+		size_t pos = 0;
+		for (;;)
+		{
+			if (pos >= size)
+			{
+				return false;
+			}
+
+			if (pData[pos] == 0)
+			{
+				break;
+			}
+
+			ExrChannel channel = {};
+			if (!ReadString(pData, size, pos, channel.Name) || pos + 16 > size)
+			{
+				return false;
+			}
+
+			channel.PixelType = ReadInt32(pData + pos);
+			channel.XSampling = ReadInt32(pData + pos + 8);
+			channel.YSampling = ReadInt32(pData + pos + 12);
+			channel.Target = -1;
+			pos += 16;
+
+			if (channel.PixelType < EXR_PIXEL_UINT || channel.PixelType > EXR_PIXEL_FLOAT)
+			{
+				return false;
+			}
+
+			header.Channels.push_back(channel);
+		}
+
+		// レイヤー名を除いたチャンネル名で出力先を決める (同じ名前が複数ある場合は先頭を使用する)
+		bool used[5] = {};
+		for (auto& channel : header.Channels)
+		{
+			auto pos = channel.Name.find_last_of('.');
+			auto name = (pos == std::string::npos) ? channel.Name : channel.Name.substr(pos + 1);
+
+			int target = -1;
+			if (name == "R") { target = 0; }
+			else if (name == "G") { target = 1; }
+			else if (name == "B") { target = 2; }
+			else if (name == "A") { target = 3; }
+			else if (name == "Y") { target = 4; }
+
+			if (target >= 0 && !used[target])
+			{
+				channel.Target = target;
+				used[target] = true;
+			}
+		}
+
+		// RGBがある場合は輝度チャンネルを使用しない
+		if (used[0] || used[1] || used[2])
+		{
+			for (auto& channel : header.Channels)
+			{
+				if (channel.Target == 4)
+				{
+					channel.Target = -1;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool ParseExrHeader(const uint8_t* pData, size_t size, ExrHeader& header)
+	{
+		if (size < 8 || uint32_t(ReadInt32(pData)) != ExrMagic)
+		{
+			ELOG("Error : Invalid EXR Magic Number.");
+			return false;
+		}
+
+		auto version = uint32_t(ReadInt32(pData + 4));
+		if ((version & 0xff) != 2)
+		{
+			ELOG("Error : Unsupported EXR Version. version = %u", version & 0xff);
+			return false;
+		}
+
+		if (version & (ExrFlagDeep | ExrFlagMultiPart))
+		{
+			ELOG("Error : Deep / Multi-Part EXR is not supported.");
+			return false;
+		}
+
+		header.Tiled = (version & ExrFlagTiled) != 0;
+
+		auto hasChannels = false;
+		auto hasDataWindow = false;
+		size_t pos = 8;
+
+		for (;;)
+		{
+			if (pos >= size)
+			{
+				ELOG("Error : Unexpected End Of EXR Header.");
+				return false;
+			}
+
+			if (pData[pos] == 0)
+			{
+				pos++;
+				break;
+			}
+
+			std::string name;
+			std::string type;
+			if (!ReadString(pData, size, pos, name) || !ReadString(pData, size, pos, type) || pos + 4 > size)
+			{
+				ELOG("Error : Invalid EXR Attribute.");
+				return false;
+			}
+
+			auto attrSize = size_t(uint32_t(ReadInt32(pData + pos)));
+			pos += 4;
+
+			if (pos + attrSize > size)
+			{
+				ELOG("Error : Invalid EXR Attribute Size. name = %s", name.c_str());
+				return false;
+			}
+
+			auto pValue = pData + pos;
+
+			if (name == "channels" && type == "chlist")
+			{
+				if (!ParseChannels(pValue, attrSize, header))
+				{
+					ELOG("Error : Invalid EXR Channel List.");
+					return false;
+				}
+
+				hasChannels = true;
+			}
+			else if (name == "compression" && attrSize >= 1)
+			{
+				header.Compression = pValue[0];
+			}
+			else if (name == "dataWindow" && attrSize >= 16)
+			{
+				header.MinX = ReadInt32(pValue);
+				header.MinY = ReadInt32(pValue + 4);
+				header.MaxX = ReadInt32(pValue + 8);
+				header.MaxY = ReadInt32(pValue + 12);
+				hasDataWindow = true;
+			}
+			else if (name == "tiles" && attrSize >= 9)
+			{
+				header.TileWidth = uint32_t(ReadInt32(pValue));
+				header.TileHeight = uint32_t(ReadInt32(pValue + 4));
+			}
+
+			pos += attrSize;
+		}
+
+		if (!hasChannels || !hasDataWindow || header.MaxX < header.MinX || header.MaxY < header.MinY)
+		{
+			ELOG("Error : Missing EXR Required Attribute.");
+			return false;
+		}
+
+		if (header.Tiled && (header.TileWidth == 0 || header.TileHeight == 0))
+		{
+			ELOG("Error : Invalid EXR Tile Description.");
+			return false;
+		}
+
+		for (const auto& channel : header.Channels)
+		{
+			if (channel.XSampling != 1 || channel.YSampling != 1)
+			{
+				ELOG("Error : Subsampled EXR Channel is not supported. channel = %s", channel.Name.c_str());
+				return false;
+			}
+		}
+
+		switch (header.Compression)
+		{
+			case EXR_COMPRESSION_NONE:
+			case EXR_COMPRESSION_RLE:
+			case EXR_COMPRESSION_ZIPS:
+			case EXR_COMPRESSION_ZIP:
+			case EXR_COMPRESSION_PIZ:
+				break;
+
+			default:
+				ELOG("Error : Unsupported EXR Compression. compression = %d", header.Compression);
+				return false;
+		}
+
+		header.HeaderSize = pos;
+		return true;
+	}
+
+	/// <summary>
+	/// 展開済みのブロックを RGBA16F の画像に書き込む
+	/// ブロック内は行ごとに全チャンネルの値が順に並ぶ
+	/// </summary>
+	void StoreExrBlock(
+		const ExrHeader& header,
+		const uint8_t* pBlock,
+		uint32_t blockX,
+		uint32_t blockY,
+		uint32_t width,
+		uint32_t lineCount,
+		CpuImageHalf& image)
+	{
+		const auto pixelSize = [&]()
+		{
+			uint32_t result = 0;
+			for (const auto& channel : header.Channels)
+			{
+				result += GetPixelSize(channel.PixelType);
+			}
+			return result;
+		}();
+
+		for (auto y = 0u; y < lineCount; ++y)
+		{
+			auto pSrc = pBlock + size_t(width) * pixelSize * y;
+			auto pDst = image.GetRow(blockY + y) + size_t(blockX) * 4;
+
+			for (const auto& channel : header.Channels)
+			{
+				auto channelSize = size_t(width) * GetPixelSize(channel.PixelType);
+
+				if (channel.Target >= 0)
+				{
+					auto first = (channel.Target == 4) ? 0 : channel.Target;
+					auto last = (channel.Target == 4) ? 2 : channel.Target;
+
+					for (auto c = first; c <= last; ++c)
+					{
+						switch (channel.PixelType)
+						{
+							case EXR_PIXEL_HALF:
+							{
+								// 半精度はそのままインターリーブする
+								for (auto x = 0u; x < width; ++x)
+								{
+									memcpy(&pDst[x * 4 + c], pSrc + x * 2, 2);
+								}
+							}
+							break;
+
+							case EXR_PIXEL_FLOAT:
+							{
+								XMConvertFloatToHalfStream(
+									pDst + c, sizeof(HALF) * 4,
+									reinterpret_cast<const float*>(pSrc), sizeof(float),
+									width);
+							}
+							break;
+
+							default:
+							{
+								for (auto x = 0u; x < width; ++x)
+								{
+									uint32_t value;
+									memcpy(&value, pSrc + x * 4, 4);
+									pDst[x * 4 + c] = XMConvertFloatToHalf(float(value));
+								}
+							}
+							break;
+						}
+					}
+				}
+
+				pSrc += channelSize;
+			}
+		}
+	}
+
+	/// <summary>
+	/// 1ブロック (走査線ブロックまたはタイル) を復号する
+	/// </summary>
+	bool DecodeExrBlock(
+		const ExrHeader& header,
+		const uint8_t* pSrc,
+		size_t srcSize,
+		uint32_t blockX,
+		uint32_t blockY,
+		uint32_t width,
+		uint32_t lineCount,
+		CpuImageHalf& image)
+	{
+		std::vector<uint32_t> channelSizes;
+		uint32_t pixelSize = 0;
+		for (const auto& channel : header.Channels)
+		{
+			channelSizes.push_back(GetPixelSize(channel.PixelType));
+			pixelSize += channelSizes.back();
+		}
+
+		const auto rawSize = size_t(width) * lineCount * pixelSize;
+
+		// 圧縮後の方が大きくなる場合は無圧縮で格納されている
+		if (srcSize == rawSize || header.Compression == EXR_COMPRESSION_NONE)
+		{
+			if (srcSize != rawSize)
+			{
+				return false;
+			}
+
+			StoreExrBlock(header, pSrc, blockX, blockY, width, lineCount, image);
+			return true;
+		}
+
+		std::vector<uint8_t> raw(rawSize);
+		auto result = false;
+
+		switch (header.Compression)
+		{
+			case EXR_COMPRESSION_RLE:
+				result = DecompressExrRLE(pSrc, srcSize, raw.data(), rawSize);
+				break;
+
+			case EXR_COMPRESSION_ZIPS:
+			case EXR_COMPRESSION_ZIP:
+				result = DecompressExrZIP(pSrc, srcSize, raw.data(), rawSize);
+				break;
+
+			case EXR_COMPRESSION_PIZ:
+				result = DecompressExrPIZ(
+					pSrc, srcSize, raw.data(), rawSize,
+					width, lineCount, channelSizes.data(), uint32_t(channelSizes.size()));
+				break;
+
+			default:
+				break;
+		}
+
+		if (!result)
+		{
+			return false;
+		}
+
+		StoreExrBlock(header, raw.data(), blockX, blockY, width, lineCount, image);
+		return true;
+	}
+}
+
+void CpuImageHalf::Resize(uint32_t width, uint32_t height)
+{
+	Width = width;
+	Height = height;
+	Pixels.resize(size_t(width) * height * 4);
+}
+
+bool DecodeRGBE(const uint8_t* pData, size_t size, CpuImageHalf& image, uint32_t threadCount)
+{
+	if (pData == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	size_t pos = 0;
+	std::string line;
+
+	if (!ReadLine(pData, size, pos, line) || line.compare(0, 2, "#?") != 0)
+	{
+		ELOG("Error : Invalid Radiance HDR Signature.");
+		return false;
+	}
+
+	// 空行までがヘッダ
+	for (;;)
+	{
+		if (!ReadLine(pData, size, pos, line))
+		{
+			ELOG("Error : Unexpected End Of Radiance HDR Header.");
+			return false;
+		}
+
+		if (line.empty())
+		{
+			break;
+		}
+
+		if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe")
+		{
+			ELOG("Error : Unsupported Radiance HDR Format. %s", line.c_str());
+			return false;
+		}
+	}
+
+	// 解像度 (上から下への -Y と, 下から上への +Y に対応する)
+	if (!ReadLine(pData, size, pos, line))
+	{
+		ELOG("Error : Missing Radiance HDR Resolution.");
+		return false;
+	}
+
+	auto flipY = false;
+	int width = 0;
+	int height = 0;
+	if (!ParseResolution(line, "-Y %d +X %d", height, width))
+	{
+		flipY = true;
+		if (!ParseResolution(line, "+Y %d +X %d", height, width))
+		{
+			width = 0;
+		}
+	}
+
+	if (width <= 0 || height <= 0)
+	{
+		ELOG("Error : Unsupported Radiance HDR Resolution. %s", line.c_str());
+		return false;
+	}
+
+	const auto w = uint32_t(width);
+	const auto h = uint32_t(height);
+
+	// 走査線の開始位置を求める (ランレングスの長さを読むだけなので展開より十分軽い)
+	std::vector<size_t> offsets(h);
+	for (auto y = 0u; y < h; ++y)
+	{
+		offsets[y] = pos;
+		if (!SkipScanline(pData, size, w, pos))
+		{
+			ELOG("Error : Invalid Radiance HDR Scanline. y = %u", y);
+			return false;
+		}
+	}
+
+	image.Resize(w, h);
+
+	ParallelFor(0, h, [&](uint32_t y)
+	{
+		thread_local std::vector<uint8_t> rgbe;
+		thread_local std::vector<XMFLOAT4> tmp;
+		rgbe.resize(size_t(w) * 4);
+		tmp.resize(w);
+
+		ExpandScanline(pData, offsets[y], w, rgbe.data());
+
+		auto dstY = flipY ? (h - 1 - y) : y;
+		ConvertRGBEToHalf(rgbe.data(), w, tmp.data(), image.GetRow(dstY));
+	}, threadCount);
+
+	return true;
+}
+
+bool DecodeEXR(const uint8_t* pData, size_t size, CpuImageHalf& image, uint32_t threadCount)
+{
+	if (pData == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	ExrHeader header;
+	if (!ParseExrHeader(pData, size, header))
+	{
+		return false;
+	}
+
+	const auto width = uint32_t(header.MaxX - header.MinX + 1);
+	const auto height = uint32_t(header.MaxY - header.MinY + 1);
+
+	// 最上位のミップのブロック数 (ミップマップ付きのタイル形式でも最上位のブロックが先頭に並ぶ)
+	uint32_t blockCountX = 1;
+	uint32_t blockCountY = 0;
+	uint32_t blockHeight = 0;
+
+	if (header.Tiled)
+	{
+		blockCountX = (width + header.TileWidth - 1) / header.TileWidth;
+		blockCountY = (height + header.TileHeight - 1) / header.TileHeight;
+		blockHeight = header.TileHeight;
+	}
+	else
+	{
+		blockHeight = GetLinesPerBlock(header.Compression);
+		blockCountY = (height + blockHeight - 1) / blockHeight;
+	}
+
+	const auto blockCount = blockCountX * blockCountY;
+	const auto tableOffset = header.HeaderSize;
+
+	if (tableOffset + size_t(blockCount) * 8 > size)
+	{
+		ELOG("Error : Invalid EXR Offset Table.");
+		return false;
+	}
+
+	// 出力先を初期化する (存在しないチャンネルは RGB = 0, A = 1)
+	image.Resize(width, height);
+	for (size_t i = 0; i < image.Pixels.size(); i += 4)
+	{
+		image.Pixels[i + 0] = 0;
+		image.Pixels[i + 1] = 0;
+		image.Pixels[i + 2] = 0;
+		image.Pixels[i + 3] = HalfOne;
+	}
+
+	std::atomic<bool> failed(false);
+
+	ParallelFor(0, blockCount, [&](uint32_t index)
+	{
+		if (failed)
+		{
+			return;
+		}
+
+		auto offset = size_t(ReadUInt64(pData + tableOffset + size_t(index) * 8));
+		auto headerSize = header.Tiled ? size_t(20) : size_t(8);
+
+		if (offset + headerSize > size)
+		{
+			failed = true;
+			return;
+		}
+
+		auto pChunk = pData + offset;
+		uint32_t blockX = 0;
+		uint32_t blockY = 0;
+		uint32_t blockW = width;
+		uint32_t lineCount = 0;
+
+		if (header.Tiled)
+		{
+			auto tileX = ReadInt32(pChunk);
+			auto tileY = ReadInt32(pChunk + 4);
+			auto levelX = ReadInt32(pChunk + 8);
+			auto levelY = ReadInt32(pChunk + 12);
+
+			if (levelX != 0 || levelY != 0 || tileX < 0 || tileY < 0
+				|| uint32_t(tileX) >= blockCountX || uint32_t(tileY) >= blockCountY)
+			{
+				failed = true;
+				return;
+			}
+
+			blockX = uint32_t(tileX) * header.TileWidth;
+			blockY = uint32_t(tileY) * header.TileHeight;
+			blockW = std::min(header.TileWidth, width - blockX);
+			lineCount = std::min(header.TileHeight, height - blockY);
+		}
+		else
+		{
+			auto y = ReadInt32(pChunk) - header.MinY;
+			if (y < 0 || uint32_t(y) >= height)
+			{
+				failed = true;
+				return;
+			}
+
+			blockY = uint32_t(y);
+			lineCount = std::min(blockHeight, height - blockY);
+		}
+
+		auto dataSize = size_t(uint32_t(ReadInt32(pChunk + headerSize - 4)));
+		if (offset + headerSize + dataSize > size)
+		{
+			failed = true;
+			return;
+		}
+
+		if (!DecodeExrBlock(header, pChunk + headerSize, dataSize, blockX, blockY, blockW, lineCount, image))
+		{
+			failed = true;
+		}
+	}, threadCount);
+
+	if (failed)
+	{
+		ELOG("Error : EXR Block Decode Failed.");
+		return false;
+	}
+
+	return true;
+}
+
+bool IsHDRImageFile(const wchar_t* path)
+{
+	if (path == nullptr)
+	{
+		return false;
+	}
+
+	auto ext = GetExtension(path);
+	return ext == L"hdr" || ext == L"exr";
+}
+
+bool LoadHDRImage(const wchar_t* path, CpuImageHalf& image, uint32_t threadCount)
+{
+	if (path == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	std::vector<uint8_t> data;
+	if (!ReadFileData(path, data))
+	{
+		ELOG("Error : File Open Failed. path = %ls", path);
+		return false;
+	}
+
+	auto ext = GetExtension(path);
+	auto result = false;
+
+	if (ext == L"hdr")
+	{
+		result = DecodeRGBE(data.data(), data.size(), image, threadCount);
+	}
+	else if (ext == L"exr")
+	{
+		result = DecodeEXR(data.data(), data.size(), image, threadCount);
+	}
+
+	if (!result)
+	{
+		ELOG("Error : HDR Image Decode Failed. path = %ls", path);
+		return false;
+	}
+
+	return true;
+}
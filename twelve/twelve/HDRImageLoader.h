@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/// <summary>
+/// CPU側で扱う半精度浮動小数点画像 (RGBA16F)
+/// DXGI_FORMAT_R16G16B16A16_FLOAT と同じ並びで格納する
+/// </summary>
+struct CpuImageHalf
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<uint16_t> Pixels;	// 1ピクセルあたり4要素
+
+	/// <summary>
+	/// 画像サイズを変更する
+	/// </summary>
+	/// <param name="width">横幅</param>
+	/// <param name="height">縦幅</param>
+	void Resize(uint32_t width, uint32_t height);
+
+	uint16_t* GetRow(uint32_t y) { return Pixels.data() + size_t(y) * Width * 4; }
+	const uint16_t* GetRow(uint32_t y) const { return Pixels.data() + size_t(y) * Width * 4; }
+	size_t GetRowPitch() const { return size_t(Width) * 4 * sizeof(uint16_t); }
+};
+
+/// <summary>
+/// Radiance HDR (RGBE) 形式の画像を復号する
+/// 新形式のランレングス圧縮と無圧縮の走査線に対応する. 走査線の位置を先に求め, 走査線単位で並列に復号する
+/// </summary>
+/// <param name="pData">ファイルの内容</param>
+/// <param name="size">ファイルのサイズ</param>
+/// <param name="image">復号結果の格納先</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+/// <returns>復号に成功した場合はtrue</returns>
+bool DecodeRGBE(const uint8_t* pData, size_t size, CpuImageHalf& image, uint32_t threadCount = 0);
+
+/// <summary>
+/// OpenEXR 形式の画像を復号する
+/// 走査線形式とタイル形式 (最上位のミップのみ), HALF / FLOAT / UINT のチャンネル, NONE / RLE / ZIPS / ZIP / PIZ 圧縮に対応する
+/// オフセットテーブルを使ってブロック単位で並列に復号する
+/// </summary>
+/// <param name="pData">ファイルの内容</param>
+/// <param name="size">ファイルのサイズ</param>
+/// <param name="image">復号結果の格納先 (データウィンドウの範囲)</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+/// <returns>復号に成功した場合はtrue</returns>
+bool DecodeEXR(const uint8_t* pData, size_t size, CpuImageHalf& image, uint32_t threadCount = 0);
+
+/// <summary>
+/// 拡張子が .hdr / .exr のファイルかどうか
+/// </summary>
+bool IsHDRImageFile(const wchar_t* path);
+
+/// <summary>
+/// .hdr / .exr ファイルを読み込む
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="image">復号結果の格納先</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+/// <returns>読み込みに成功した場合はtrue</returns>
+bool LoadHDRImage(const wchar_t* path, CpuImageHalf& image, uint32_t threadCount = 0);
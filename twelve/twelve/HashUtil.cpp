@@ -0,0 +1,71 @@
+﻿#include "HashUtil.h"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	static const uint64_t HashPrime = 0x100000001b3ull;
+}
+
+uint64_t ComputeHash(const void* pData, size_t size, uint64_t seed)
+{
+	auto ptr = static_cast<const uint8_t*>(pData);
+	auto hash = seed;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= ptr[i];
+		hash *= HashPrime;
+	}
+
+	return hash;
+}
+
+bool ComputeFileHash(const wchar_t* path, uint64_t& result)
+{
+	if (path == nullptr)
+	{
+		return false;
+	}
+
+	std::ifstream stream(std::filesystem::path(path), std::ios::binary);
+	if (!stream.is_open())
+	{
+		return false;
+	}
+
+	// 64KBずつ読み込んでハッシュを更新
+	std::vector<char> buffer(64 * 1024);
+	auto hash = HashOffsetBasis;
+
+	while (stream)
+	{
+		stream.read(buffer.data(), buffer.size());
+		auto count = size_t(stream.gcount());
+		if (count == 0)
+		{
+			break;
+		}
+
+		hash = ComputeHash(buffer.data(), count, hash);
+	}
+
+	result = hash;
+	return true;
+}
+
+std::wstring ToHexString(uint64_t hash)
+{
+	static const wchar_t Digits[] = L"0123456789abcdef";
+
+	std::wstring result(16, L'0');
+	for (auto i = 0; i < 16; ++i)
+	{
+		result[15 - i] = Digits[hash & 0xf];
+		hash >>= 4;
+	}
+
+	return result;
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// FNV-1a (64bit) の初期値
+/// </summary>
+static const uint64_t HashOffsetBasis = 0xcbf29ce484222325ull;
+
+/// <summary>
+/// バイト列のハッシュ値を計算する (FNV-1a 64bit)
+/// </summary>
+/// <param name="pData">データ</param>
+/// <param name="size">データサイズ</param>
+/// <param name="seed">初期値 (続けて計算する場合は前回の結果を渡す)</param>
+/// <returns>ハッシュ値</returns>
+uint64_t ComputeHash(const void* pData, size_t size, uint64_t seed = HashOffsetBasis);
+
+/// <summary>
+/// 値のハッシュ値を計算する
+/// </summary>
+/// <typeparam name="T">トリビアルにコピー可能な型</typeparam>
+/// <param name="value">値</param>
+/// <param name="seed">初期値</param>
+/// <returns>ハッシュ値</returns>
+template<typename T>
+inline uint64_t ComputeHash(const T& value, uint64_t seed = HashOffsetBasis)
+{
+	return ComputeHash(&value, sizeof(T), seed);
+}
+
+/// <summary>
+/// ファイル内容のハッシュ値を計算する
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="result">ハッシュ値の格納先</param>
+/// <returns>ファイルを読み込めた場合はtrue</returns>
+bool ComputeFileHash(const wchar_t* path, uint64_t& result);
+
+/// <summary>
+/// ハッシュ値を16桁の16進数文字列に変換する
+/// </summary>
+/// <param name="hash">ハッシュ値</param>
+/// <returns>16進数文字列</returns>
+std::wstring ToHexString(uint64_t hash);
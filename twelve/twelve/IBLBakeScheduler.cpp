@@ -0,0 +1,185 @@
+﻿#include "IBLBakeScheduler.h"
+
+#include <chrono>
+
+#include "Logger.h"
+
+const double IBLBakeScheduler::CostSmoothing = 0.25;
+
+double IBLBakeScheduler::SteadyClock::GetMilliseconds() const
+{
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration<double, std::milli>(now).count();
+}
+
+IBLBakeScheduler::IBLBakeScheduler()
+	: m_pClock(&m_DefaultClock)
+	, m_Budget(0.0)
+	, m_MaxItemsPerFrame(1)
+	, m_Next(0)
+	, m_FrameCount(0)
+	, m_Baking(false)
+	, m_FrameStart(0.0)
+	, m_FrameCost(0.0)
+	, m_FrameItems(0)
+{
+}
+
+IBLBakeScheduler::~IBLBakeScheduler()
+{
+}
+
+bool IBLBakeScheduler::Init(uint32_t mipCount, double budgetMilliseconds, uint32_t maxItemsPerFrame, const Clock* pClock)
+{
+	if (mipCount == 0 || budgetMilliseconds <= 0.0 || maxItemsPerFrame == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	m_pClock = (pClock != nullptr) ? pClock : &m_DefaultClock;
+	m_Budget = budgetMilliseconds;
+	m_MaxItemsPerFrame = maxItemsPerFrame;
+
+	// Diffuse LD項の各面, Specular LD項の各面の順に処理する
+	// Specular LD項は面ごとに低ラフネスのミップから処理する
+	m_Items.clear();
+	for (auto face = 0u; face < 6; ++face)
+	{
+		m_Items.push_back({ true, face, 0 });
+	}
+
+	for (auto face = 0u; face < 6; ++face)
+	{
+		for (auto mip = 0u; mip < mipCount; ++mip)
+		{
+			m_Items.push_back({ false, face, mip });
+		}
+	}
+
+	// 推定コストは未計測の状態から始める
+	m_Costs.assign(1 + mipCount, -1.0);
+
+	m_Next = 0;
+	m_FrameCount = 0;
+	m_Baking = false;
+
+	return true;
+}
+
+void IBLBakeScheduler::Request()
+{
+	m_Next = 0;
+	m_FrameCount = 0;
+	m_Baking = !m_Items.empty();
+}
+
+void IBLBakeScheduler::BeginFrame()
+{
+	m_FrameStart = m_pClock->GetMilliseconds();
+	m_FrameCost = 0.0;
+	m_FrameItems = 0;
+}
+
+bool IBLBakeScheduler::Acquire(WorkItem& item)
+{
+	if (!m_Baking || m_Next >= m_Items.size())
+	{
+		return false;
+	}
+
+	if (m_FrameItems >= m_MaxItemsPerFrame)
+	{
+		return false;
+	}
+
+	const auto& next = m_Items[m_Next];
+	auto cost = GetEstimatedCost(next);
+
+	// 進行を保証するため, 1フレームに最低1つは払い出す
+	if (m_FrameItems > 0)
+	{
+		auto elapsed = m_pClock->GetMilliseconds() - m_FrameStart;
+		if (elapsed + m_FrameCost + cost > m_Budget)
+		{
+			return false;
+		}
+	}
+
+	item = next;
+	m_FrameCost += cost;
+	m_FrameItems++;
+	m_Next++;
+
+	return true;
+}
+
+bool IBLBakeScheduler::EndFrame()
+{
+	if (!m_Baking)
+	{
+		return false;
+	}
+
+	if (m_FrameItems > 0)
+	{
+		m_FrameCount++;
+	}
+
+	if (m_Next < m_Items.size())
+	{
+		return false;
+	}
+
+	m_Baking = false;
+	return true;
+}
+
+void IBLBakeScheduler::ReportCost(const WorkItem& item, double milliseconds)
+{
+	auto index = GetCostIndex(item);
+	if (index >= m_Costs.size() || milliseconds < 0.0)
+	{
+		return;
+	}
+
+	auto& cost = m_Costs[index];
+	cost = (cost < 0.0) ? milliseconds : (cost + (milliseconds - cost) * CostSmoothing);
+}
+
+double IBLBakeScheduler::GetEstimatedCost(const WorkItem& item) const
+{
+	auto index = GetCostIndex(item);
+	if (index >= m_Costs.size() || m_Costs[index] < 0.0)
+	{
+		// 未計測の場合は予算全体を見込んでおく
+		return m_Budget;
+	}
+
+	return m_Costs[index];
+}
+
+bool IBLBakeScheduler::IsBaking() const
+{
+	return m_Baking;
+}
+
+uint32_t IBLBakeScheduler::GetItemCount() const
+{
+	return uint32_t(m_Items.size());
+}
+
+uint32_t IBLBakeScheduler::GetIssuedCount() const
+{
+	return m_Next;
+}
+
+uint32_t IBLBakeScheduler::GetFrameCount() const
+{
+	return m_FrameCount;
+}
+
+uint32_t IBLBakeScheduler::GetCostIndex(const WorkItem& item) const
+{
+	return item.Diffuse ? 0 : 1 + item.Mip;
+}
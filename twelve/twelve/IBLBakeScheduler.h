@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// IBLの再ベイクを複数フレームに分割するスケジューラー
+/// 1回の処理単位 (Diffuse LD項の1面, Specular LD項の1面1ミップ) をフレームごとの予算の範囲で払い出す
+/// GPUに依存しないため, 時計を差し替えることで単体で動作を確認できる
+/// </summary>
+class IBLBakeScheduler
+{
+public:
+	/// <summary>
+	/// 時計 (ミリ秒単位)
+	/// </summary>
+	class Clock
+	{
+	public:
+		virtual ~Clock() {}
+		virtual double GetMilliseconds() const = 0;
+	};
+
+	/// <summary>
+	/// std::chrono::steady_clock を使用する時計
+	/// </summary>
+	class SteadyClock : public Clock
+	{
+	public:
+		double GetMilliseconds() const override;
+	};
+
+	/// <summary>
+	/// 処理単位
+	/// </summary>
+	struct WorkItem
+	{
+		bool		Diffuse;	// Diffuse LD項の場合はtrue
+		uint32_t	Face;		// 面番号
+		uint32_t	Mip;		// ミップレベル (Diffuse LD項の場合は0)
+	};
+
+	IBLBakeScheduler();
+	~IBLBakeScheduler();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="mipCount">Specular LD項のミップレベル数</param>
+	/// <param name="budgetMilliseconds">1フレームあたりの予算 (ミリ秒)</param>
+	/// <param name="maxItemsPerFrame">1フレームあたりの最大処理数</param>
+	/// <param name="pClock">時計 (nullptrの場合は SteadyClock を使用する)</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Init(uint32_t mipCount, double budgetMilliseconds, uint32_t maxItemsPerFrame, const Clock* pClock = nullptr);
+
+	/// <summary>
+	/// 再ベイクを要求する (実行中の場合は最初からやり直す)
+	/// </summary>
+	void Request();
+
+	/// <summary>
+	/// フレームの開始を通知する
+	/// </summary>
+	void BeginFrame();
+
+	/// <summary>
+	/// 今フレームで処理する次の処理単位を取得する
+	/// 今フレームの経過時間と推定コストの合計が予算を超える場合は払い出さない (ただし1フレームに最低1つは払い出す)
+	/// </summary>
+	/// <param name="item">処理単位の格納先</param>
+	/// <returns>処理単位を払い出した場合はtrue</returns>
+	bool Acquire(WorkItem& item);
+
+	/// <summary>
+	/// フレームの終了を通知する
+	/// </summary>
+	/// <returns>全ての処理単位を払い出し終えた場合はtrue (バッファを入れ替えるタイミング)</returns>
+	bool EndFrame();
+
+	/// <summary>
+	/// 処理単位の実測コストを通知する (推定コストの更新に使用する)
+	/// </summary>
+	/// <param name="item">処理単位</param>
+	/// <param name="milliseconds">実測コスト (ミリ秒)</param>
+	void ReportCost(const WorkItem& item, double milliseconds);
+
+	/// <summary>
+	/// 処理単位の推定コストを取得する
+	/// </summary>
+	double GetEstimatedCost(const WorkItem& item) const;
+
+	bool IsBaking() const;
+	uint32_t GetItemCount() const;
+	uint32_t GetIssuedCount() const;
+	uint32_t GetFrameCount() const;
+
+private:
+	static const double CostSmoothing;	// 推定コストの指数移動平均の係数
+
+	SteadyClock				m_DefaultClock;		// 既定の時計
+	const Clock*			m_pClock;			// 時計
+	std::vector<WorkItem>	m_Items;			// 処理単位の一覧 (処理順)
+	std::vector<double>		m_Costs;			// 推定コスト (Diffuse LD項, Specular LD項のミップごと. 負の値は未計測)
+	double					m_Budget;			// 1フレームあたりの予算
+	uint32_t				m_MaxItemsPerFrame;	// 1フレームあたりの最大処理数
+	uint32_t				m_Next;				// 次に払い出す処理単位
+	uint32_t				m_FrameCount;		// 再ベイクに要したフレーム数
+	bool					m_Baking;			// 再ベイク中かどうか
+	double					m_FrameStart;		// フレームの開始時刻
+	double					m_FrameCost;		// 今フレームで払い出した処理単位の推定コストの合計
+	uint32_t				m_FrameItems;		// 今フレームで払い出した処理単位の数
+
+	uint32_t GetCostIndex(const WorkItem& item) const;
+};
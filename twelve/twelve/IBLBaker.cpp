@@ -4,6 +4,8 @@
 #include <CommonStates.h>
 #include <DirectXHelpers.h>
 #include <pix_win.h>
+#include <DirectXTex.h>
+#include "IBLBakerCPU.h"
 #include "Logger.h"
 
 using namespace DirectX::SimpleMath;
@@ -22,23 +24,44 @@ namespace
 		float Width;
 		float MipCount;
 	};
+
+	// CPUł̃xCNʂ̂܂܎g悤ɃTCY𑵂Ă
+	static_assert(IBLBaker::DFGTextureSize == IBLBakerCPU::DFGTextureSize, "DFG texture size mismatch.");
+	static_assert(IBLBaker::LDTextureSize == IBLBakerCPU::LDTextureSize, "LD texture size mismatch.");
+	static_assert(IBLBaker::MipCount == IBLBakerCPU::MipCount, "Mip count mismatch.");
+
+	// 1t[Ŏgp^CX^vNG̐ (Jn + PʂƂ̏I)
+	const uint32_t QueryCountPerFrame = IBLBaker::MaxRebakeItemsPerFrame + 1;
 }
 
 IBLBaker::IBLBaker()
 	: m_pPoolRes(nullptr)
 	, m_pPoolRTV(nullptr)
+	, m_pHandleRTV_DFG(nullptr)
 	, m_pHandleSRV_DFG(nullptr)
-	, m_pHandleSRV_DiffuseLD(nullptr)
-	, m_pHandleSRV_SpecularLD(nullptr)
+	, m_UseBakedTexture(false)
+	, m_UseBakedLD(false)
+	, m_FrontIndex(0)
+	, m_TimestampFrequency(0)
+	, m_RebakeSource()
+	, m_RebakeTargetWritable(false)
+	, m_BakeMapSize(0)
+	, m_BakeMipCount(0)
 {
-	for (auto i = 0; i < MipCount * 6; i++)
+	for (auto b = 0; b < BufferCount; b++)
 	{
-		m_pHandleRTV_SpecularLD[i] = nullptr;
-	}
+		for (auto i = 0; i < MipCount * 6; i++)
+		{
+			m_pHandleRTV_SpecularLD[b][i] = nullptr;
+		}
 
-	for (auto i = 0; i < 6; i++)
-	{
-		m_pHandleRTV_DiffuseLD[i] = nullptr;
+		for (auto i = 0; i < 6; i++)
+		{
+			m_pHandleRTV_DiffuseLD[b][i] = nullptr;
+		}
+
+		m_pHandleSRV_DiffuseLD[b] = nullptr;
+		m_pHandleSRV_SpecularLD[b] = nullptr;
 	}
 }
 
@@ -47,7 +70,7 @@ IBLBaker::~IBLBaker()
 	Term();
 }
 
-bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorPool* pPoolRTV)
+bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorPool* pPoolRTV, PipelineCache* pPipelineCache)
 {
 	// _obt@̐
 	{
@@ -114,7 +137,7 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
 	};
 
-	auto format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	auto format = LDFormat;
 
 	// DFGϕppCvCXe[g̐
 	{
@@ -134,10 +157,8 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 		desc.SampleDesc.Count = 1;
 		desc.SampleDesc.Quality = 0;
 
-		auto hr = pDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(m_pDFG_PSO.GetAddressOf()));
-		if (FAILED(hr))
+		if (!CreateGraphicsPipeline(pDevice, pPipelineCache, desc, m_DFG_RootSignature.GetHash(), m_pDFG_PSO.GetAddressOf()))
 		{
-			ELOG("Error : ID3D12Device::CreateGraphicsPipelineState() Failed. retcode = 0x%x", hr);
 			return false;
 		}
 	}
@@ -160,10 +181,8 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 		desc.SampleDesc.Count = 1;
 		desc.SampleDesc.Quality = 0;
 
-		auto hr = pDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(m_pDiffuseLD_PSO.GetAddressOf()));
-		if (FAILED(hr))
+		if (!CreateGraphicsPipeline(pDevice, pPipelineCache, desc, m_LD_RootSignature.GetHash(), m_pDiffuseLD_PSO.GetAddressOf()))
 		{
-			ELOG("Error : ID3D12Device::CreateGraphicsPipelineState() Failed. retcode = 0x%x", hr);
 			return false;
 		}
 	}
@@ -186,10 +205,8 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 		desc.SampleDesc.Count = 1;
 		desc.SampleDesc.Quality = 0;
 
-		auto hr = pDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(m_pSpecularLD_PSO.GetAddressOf()));
-		if (FAILED(hr))
+		if (!CreateGraphicsPipeline(pDevice, pPipelineCache, desc, m_LD_RootSignature.GetHash(), m_pSpecularLD_PSO.GetAddressOf()))
 		{
-			ELOG("Error : ID3D12Device::CreateGraphicsPipelineState() Failed. retcode = 0x%x", hr);
 			return false;
 		}
 	}
@@ -268,6 +285,8 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 	}
 
 	// Diffuse LDϕp_[^[Qbg̐.
+	// ăxCN\pł悤, LD͕\pƍăxCNp2pӂ
+	for (auto b = 0; b < BufferCount; ++b)
 	{
 		D3D12_RESOURCE_DESC texDesc = {};
 		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
@@ -299,7 +318,7 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 			&texDesc,
 			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
 			&clearValue,
-			IID_PPV_ARGS(m_pTexDiffuseLD.GetAddressOf()));
+			IID_PPV_ARGS(m_pTexDiffuseLD[b].GetAddressOf()));
 		if (FAILED(hr))
 		{
 			ELOG("Error : ID3D12Device::CreateCommittedResource() Failed.");
@@ -316,14 +335,14 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 			rtvDesc.Texture2DArray.MipSlice = 0;
 			rtvDesc.Texture2DArray.PlaneSlice = 0;
 
-			m_pHandleRTV_DiffuseLD[i] = m_pPoolRTV->AllocHandle();
-			if (m_pHandleRTV_DiffuseLD[i] == nullptr)
+			m_pHandleRTV_DiffuseLD[b][i] = m_pPoolRTV->AllocHandle();
+			if (m_pHandleRTV_DiffuseLD[b][i] == nullptr)
 			{
 				ELOG("Error : Descriptor Handle Allocate Failed.");
 				return false;
 			}
 
-			pDevice->CreateRenderTargetView(m_pTexDiffuseLD.Get(), &rtvDesc, m_pHandleRTV_DiffuseLD[i]->HandleCPU);
+			pDevice->CreateRenderTargetView(m_pTexDiffuseLD[b].Get(), &rtvDesc, m_pHandleRTV_DiffuseLD[b][i]->HandleCPU);
 		}
 
 		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
@@ -334,17 +353,18 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 		srvDesc.TextureCube.MostDetailedMip = 0;
 		srvDesc.TextureCube.ResourceMinLODClamp = 0;
 
-		m_pHandleSRV_DiffuseLD = m_pPoolRes->AllocHandle();
-		if (m_pHandleSRV_DiffuseLD == nullptr)
+		m_pHandleSRV_DiffuseLD[b] = m_pPoolRes->AllocHandle();
+		if (m_pHandleSRV_DiffuseLD[b] == nullptr)
 		{
 			ELOG("Error : Descriptor Handle Allocate Failed.");
 			return false;
 		}
 
-		pDevice->CreateShaderResourceView(m_pTexDiffuseLD.Get(), &srvDesc, m_pHandleSRV_DiffuseLD->HandleCPU);
+		pDevice->CreateShaderResourceView(m_pTexDiffuseLD[b].Get(), &srvDesc, m_pHandleSRV_DiffuseLD[b]->HandleCPU);
 	}
 
 	// Specular LDϕp_[^[Qbg̐.
+	for (auto b = 0; b < BufferCount; ++b)
 	{
 		D3D12_RESOURCE_DESC texDesc = {};
 		texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
@@ -376,7 +396,7 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 			&texDesc,
 			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
 			&clearValue,
-			IID_PPV_ARGS(m_pTexSpecularLD.GetAddressOf()));
+			IID_PPV_ARGS(m_pTexSpecularLD[b].GetAddressOf()));
 		if (FAILED(hr))
 		{
 			ELOG("Error : ID3D12Device::CreateCommittedResource() Failed.");
@@ -396,14 +416,14 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 				rtvDesc.Texture2DArray.MipSlice = m;
 				rtvDesc.Texture2DArray.PlaneSlice = 0;
 
-				m_pHandleRTV_SpecularLD[idx] = m_pPoolRTV->AllocHandle();
-				if (m_pHandleRTV_SpecularLD[idx] == nullptr)
+				m_pHandleRTV_SpecularLD[b][idx] = m_pPoolRTV->AllocHandle();
+				if (m_pHandleRTV_SpecularLD[b][idx] == nullptr)
 				{
 					ELOG("Error : Descriptor Handle Allocate Failed.");
 					return false;
 				}
 
-				pDevice->CreateRenderTargetView(m_pTexSpecularLD.Get(), &rtvDesc, m_pHandleRTV_SpecularLD[idx]->HandleCPU);
+				pDevice->CreateRenderTargetView(m_pTexSpecularLD[b].Get(), &rtvDesc, m_pHandleRTV_SpecularLD[b][idx]->HandleCPU);
 				idx++;
 			}
 		}
@@ -416,42 +436,45 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 		srvDesc.TextureCube.MostDetailedMip = 0;
 		srvDesc.TextureCube.ResourceMinLODClamp = 0;
 
-		m_pHandleSRV_SpecularLD = m_pPoolRes->AllocHandle();
-		if (m_pHandleSRV_SpecularLD == nullptr)
+		m_pHandleSRV_SpecularLD[b] = m_pPoolRes->AllocHandle();
+		if (m_pHandleSRV_SpecularLD[b] == nullptr)
 		{
 			ELOG("Error : Descriptor Handle Allocate Failed.");
 			return false;
 		}
 
-		pDevice->CreateShaderResourceView(m_pTexSpecularLD.Get(), &srvDesc, m_pHandleSRV_SpecularLD->HandleCPU);
+		pDevice->CreateShaderResourceView(m_pTexSpecularLD[b].Get(), &srvDesc, m_pHandleSRV_SpecularLD[b]->HandleCPU);
 	}
 
-	// 萔obt@̐
+	// 萔obt@̐ (t[ԍ)
 	{
 		const auto RoughnessStep = 1.0f / float(MipCount - 1);
 
-		auto idx = 0;
-		for (auto i = 0; i < 6; ++i)
+		for (auto f = 0u; f < Constants::MaxFrameCount; ++f)
 		{
-			auto roughness = 0.0f;
-
-			for (auto m = 0; m < MipCount; ++m)
+			auto idx = 0;
+			for (auto i = 0; i < 6; ++i)
 			{
-				if (!m_BakeCB[idx].Init(pDevice, pPoolRes, sizeof(CbBake)))
+				auto roughness = 0.0f;
+
+				for (auto m = 0; m < MipCount; ++m)
 				{
-					ELOG("Error : ConstantBuffer::Init() Failed.");
-					return false;
-				}
+					if (!m_BakeCB[f][idx].Init(pDevice, pPoolRes, sizeof(CbBake)))
+					{
+						ELOG("Error : ConstantBuffer::Init() Failed.");
+						return false;
+					}
 
-				auto ptr = m_BakeCB[idx].GetPtr<CbBake>();
-				ptr->FaceIndex = i;
-				ptr->MipCount = MipCount - 1;
-				ptr->Roughness = roughness;
-				ptr->Width = LDTextureSize;
+					auto ptr = m_BakeCB[f][idx].GetPtr<CbBake>();
+					ptr->FaceIndex = i;
+					ptr->MipCount = MipCount - 1;
+					ptr->Roughness = roughness;
+					ptr->Width = LDTextureSize;
 
-				idx++;
+					idx++;
 
-				roughness += RoughnessStep;
+					roughness += RoughnessStep;
+				}
 			}
 		}
 	}
@@ -461,55 +484,67 @@ bool IBLBaker::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DescriptorP
 
 void IBLBaker::Term()
 {
-	for (auto i = 0; i < 6; ++i)
+	for (auto f = 0u; f < Constants::MaxFrameCount; ++f)
 	{
-		if (m_pPoolRTV != nullptr)
+		for (auto i = 0; i < MipCount * 6; ++i)
 		{
-			if (m_pHandleRTV_DiffuseLD[i] != nullptr)
-			{
-				m_pPoolRTV->FreeHandle(m_pHandleRTV_DiffuseLD[i]);
-			}
+			m_BakeCB[f][i].Term();
 		}
 	}
 
-	for (auto i = 0; i < MipCount * 6; ++i)
+	if (m_pPoolRTV != nullptr)
 	{
-		m_BakeCB[i].Term();
-
-		if (m_pPoolRTV != nullptr)
+		for (auto b = 0; b < BufferCount; ++b)
 		{
-			if (m_pHandleRTV_SpecularLD[i] != nullptr)
+			for (auto i = 0; i < 6; ++i)
 			{
-				m_pPoolRTV->FreeHandle(m_pHandleRTV_SpecularLD[i]);
+				if (m_pHandleRTV_DiffuseLD[b][i] != nullptr)
+				{
+					m_pPoolRTV->FreeHandle(m_pHandleRTV_DiffuseLD[b][i]);
+					m_pHandleRTV_DiffuseLD[b][i] = nullptr;
+				}
 			}
-		}
-	}
 
-	m_QuadVB.Term();
+			for (auto i = 0; i < MipCount * 6; ++i)
+			{
+				if (m_pHandleRTV_SpecularLD[b][i] != nullptr)
+				{
+					m_pPoolRTV->FreeHandle(m_pHandleRTV_SpecularLD[b][i]);
+					m_pHandleRTV_SpecularLD[b][i] = nullptr;
+				}
+			}
+		}
 
-	if (m_pPoolRTV != nullptr)
-	{
 		if (m_pHandleRTV_DFG != nullptr)
 		{
 			m_pPoolRTV->FreeHandle(m_pHandleRTV_DFG);
+			m_pHandleRTV_DFG = nullptr;
 		}
 	}
 
+	m_QuadVB.Term();
+
 	if (m_pPoolRes != nullptr)
 	{
 		if (m_pHandleSRV_DFG != nullptr)
 		{
 			m_pPoolRes->FreeHandle(m_pHandleSRV_DFG);
+			m_pHandleSRV_DFG = nullptr;
 		}
 
-		if (m_pHandleSRV_DiffuseLD != nullptr)
+		for (auto b = 0; b < BufferCount; ++b)
 		{
-			m_pPoolRes->FreeHandle(m_pHandleSRV_DiffuseLD);
-		}
+			if (m_pHandleSRV_DiffuseLD[b] != nullptr)
+			{
+				m_pPoolRes->FreeHandle(m_pHandleSRV_DiffuseLD[b]);
+				m_pHandleSRV_DiffuseLD[b] = nullptr;
+			}
 
-		if (m_pHandleRTV_SpecularLD != nullptr)
-		{
-			m_pPoolRes->FreeHandle(m_pHandleSRV_SpecularLD);
+			if (m_pHandleSRV_SpecularLD[b] != nullptr)
+			{
+				m_pPoolRes->FreeHandle(m_pHandleSRV_SpecularLD[b]);
+				m_pHandleSRV_SpecularLD[b] = nullptr;
+			}
 		}
 	}
 
@@ -526,13 +561,30 @@ void IBLBaker::Term()
 	}
 
 	m_pTexDFG.Reset();
-	m_pTexDiffuseLD.Reset();
-	m_pTexSpecularLD.Reset();
+	for (auto b = 0; b < BufferCount; ++b)
+	{
+		m_pTexDiffuseLD[b].Reset();
+		m_pTexSpecularLD[b].Reset();
+	}
 	m_pDFG_PSO.Reset();
 	m_pDiffuseLD_PSO.Reset();
 	m_pSpecularLD_PSO.Reset();
 	m_DFG_RootSignature.Term();
 	m_LD_RootSignature.Term();
+	m_BakedDFG.Term();
+	m_BakedDiffuseLD.Term();
+	m_BakedSpecularLD.Term();
+	m_UseBakedTexture = false;
+	m_UseBakedLD = false;
+	m_pQueryHeap.Reset();
+	m_pQueryReadback.Reset();
+	m_FrontIndex = 0;
+	m_RebakeTargetWritable = false;
+
+	for (auto i = 0u; i < Constants::MaxFrameCount; ++i)
+	{
+		m_RebakeItems[i].clear();
+	}
 }
 
 void IBLBaker::IntegrateDFG(ID3D12GraphicsCommandList* pCmd)
@@ -580,181 +632,522 @@ void IBLBaker::IntegrateDFG(ID3D12GraphicsCommandList* pCmd)
 
 void IBLBaker::IntegrateLD(ID3D12GraphicsCommandList* pCmd, uint32_t mapSize, uint32_t mipCount, D3D12_GPU_DESCRIPTOR_HANDLE handle)
 {
-	auto idx = 0;
+	// ̃xCN͊҂Ăt[̏n߂̂, t[ԍ0̒萔obt@g
+	m_BakeMapSize = mapSize;
+	m_BakeMipCount = mipCount;
+	SetBakeParams(0);
 
-	// o̓eNX`̃~bv}bvŊăXebv߂
-	//  ̓eNX`TCYɂ mipCount != MipCount ƂȂ邱Ƃɒ
-	const auto RoughnessStep = 1.0f / (MipCount - 1);
+	// [gVOl`ݒ
+	pCmd->SetGraphicsRootSignature(m_LD_RootSignature.GetPtr());
 
-	for (auto i = 0; i < 6; ++i)
+	IntegrateDiffuseLD(pCmd, handle);
+	IntegrateSpecularLD(pCmd, handle);
+}
+
+bool IBLBaker::InitRebake(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue, double budgetMilliseconds)
+{
+	if (pDevice == nullptr || pQueue == nullptr)
 	{
-		auto roughness = 0.0f;
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
 
-		// o̓eNX`̃~bv}bv[v
-		for (auto m = 0; m < MipCount; ++m)
+	if (!m_Scheduler.Init(MipCount, budgetMilliseconds, MaxRebakeItemsPerFrame))
+	{
+		ELOG("Error : IBLBakeScheduler::Init() Failed.");
+		return false;
+	}
+
+	const auto queryCount = QueryCountPerFrame * Constants::MaxFrameCount;
+
+	// ^CX^vNG̐
+	{
+		D3D12_QUERY_HEAP_DESC desc = {};
+		desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+		desc.Count = queryCount;
+		desc.NodeMask = 0;
+
+		auto hr = pDevice->CreateQueryHeap(&desc, IID_PPV_ARGS(m_pQueryHeap.ReleaseAndGetAddressOf()));
+		if (FAILED(hr))
 		{
-			auto ptr = m_BakeCB[idx].GetPtr<CbBake>();
-			ptr->FaceIndex = i;
-			ptr->MipCount = float(mipCount - 1);
-			ptr->Width = float(mapSize);
-			ptr->Roughness = roughness * roughness;
+			ELOG("Error : ID3D12Device::CreateQueryHeap() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+	}
 
-			idx++;
-			roughness += RoughnessStep;
+	// ǂݖ߂pobt@̐
+	{
+		D3D12_HEAP_PROPERTIES props = {};
+		props.Type = D3D12_HEAP_TYPE_READBACK;
+		props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Width = sizeof(uint64_t) * queryCount;
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		auto hr = pDevice->CreateCommittedResource(
+			&props,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(m_pQueryReadback.ReleaseAndGetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreateCommittedResource() Failed. retcode = 0x%x", hr);
+			return false;
 		}
 	}
 
-	// [gVOl`ݒ
-	pCmd->SetGraphicsRootSignature(m_LD_RootSignature.GetPtr());
+	auto hr = pQueue->GetTimestampFrequency(&m_TimestampFrequency);
+	if (FAILED(hr))
+	{
+		ELOG("Error : ID3D12CommandQueue::GetTimestampFrequency() Failed. retcode = 0x%x", hr);
+		return false;
+	}
 
-	IntegrateDiffuseLD(pCmd, handle);
-	IntegrateSpecularLD(pCmd, handle);
+	return true;
+}
+
+void IBLBaker::RequestRebake(uint32_t mapSize, uint32_t mipCount, D3D12_GPU_DESCRIPTOR_HANDLE handle)
+{
+	if (m_pQueryHeap == nullptr)
+	{
+		return;
+	}
+
+	// 萔obt@͏̃t[QƂĂ\̂, ł͏܂ UpdateRebake() ŏ
+	m_BakeMapSize = mapSize;
+	m_BakeMipCount = mipCount;
+	m_RebakeSource = handle;
+	m_Scheduler.Request();
+}
+
+void IBLBaker::UpdateRebake(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex)
+{
+	if (m_pQueryHeap == nullptr || frameIndex >= Constants::MaxFrameCount)
+	{
+		return;
+	}
+
+	const auto queryOffset = frameIndex * QueryCountPerFrame;
+	auto& items = m_RebakeItems[frameIndex];
+
+	// O񂱂̃t[ԍŋL^Pʂ̎RXgʒm
+	// (̃t[ԍėpO Present() GPŮ҂Ă邽, ǂݖ߂pobt@̓e͊m肵Ă)
+	if (!items.empty() && m_TimestampFrequency > 0)
+	{
+		D3D12_RANGE range = {};
+		range.Begin = sizeof(uint64_t) * queryOffset;
+		range.End = range.Begin + sizeof(uint64_t) * (items.size() + 1);
+
+		uint64_t* pTimestamps = nullptr;
+		auto hr = m_pQueryReadback->Map(0, &range, reinterpret_cast<void**>(&pTimestamps));
+		if (SUCCEEDED(hr))
+		{
+			pTimestamps += queryOffset;
+			const auto toMilliseconds = 1000.0 / double(m_TimestampFrequency);
+
+			for (size_t i = 0; i < items.size(); ++i)
+			{
+				auto ticks = pTimestamps[i + 1] - pTimestamps[i];
+				m_Scheduler.ReportCost(items[i], double(ticks) * toMilliseconds);
+			}
+
+			D3D12_RANGE written = {};
+			m_pQueryReadback->Unmap(0, &written);
+		}
+	}
+
+	items.clear();
+
+	if (!m_Scheduler.IsBaking())
+	{
+		return;
+	}
+
+	const auto back = 1 - m_FrontIndex.load();
+
+	// ̃t[ԍ̒萔obt@͑O̎gp̊҂Ă̂ŏ
+	SetBakeParams(frameIndex);
+
+	m_Scheduler.BeginFrame();
+
+	IBLBakeScheduler::WorkItem item;
+	while (m_Scheduler.Acquire(item))
+	{
+		if (items.empty())
+		{
+			if (!m_RebakeTargetWritable)
+			{
+				DirectX::TransitionResource(
+					pCmd,
+					m_pTexDiffuseLD[back].Get(),
+					D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+					D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+				DirectX::TransitionResource(
+					pCmd,
+					m_pTexSpecularLD[back].Get(),
+					D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+					D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+				m_RebakeTargetWritable = true;
+			}
+
+			pCmd->SetGraphicsRootSignature(m_LD_RootSignature.GetPtr());
+			pCmd->EndQuery(m_pQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, queryOffset);
+		}
+
+		if (item.Diffuse)
+		{
+			DrawDiffuseLD(pCmd, frameIndex, back, item.Face, m_RebakeSource);
+		}
+		else
+		{
+			DrawSpecularLD(pCmd, frameIndex, back, item.Face, item.Mip, m_RebakeSource);
+		}
+
+		items.push_back(item);
+		pCmd->EndQuery(m_pQueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, queryOffset + uint32_t(items.size()));
+	}
+
+	if (!items.empty())
+	{
+		pCmd->ResolveQueryData(
+			m_pQueryHeap.Get(),
+			D3D12_QUERY_TYPE_TIMESTAMP,
+			queryOffset,
+			uint32_t(items.size() + 1),
+			m_pQueryReadback.Get(),
+			sizeof(uint64_t) * queryOffset);
+	}
+
+	if (m_Scheduler.EndFrame())
+	{
+		DirectX::TransitionResource(
+			pCmd,
+			m_pTexDiffuseLD[back].Get(),
+			D3D12_RESOURCE_STATE_RENDER_TARGET,
+			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+		DirectX::TransitionResource(
+			pCmd,
+			m_pTexSpecularLD[back].Get(),
+			D3D12_RESOURCE_STATE_RENDER_TARGET,
+			D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+		m_RebakeTargetWritable = false;
+
+		// SĂ̏PʂL^Îŕ\p̃obt@ւ
+		// R}hXǧ㑱̕`悩VLDQƂ
+		m_FrontIndex.store(back);
+		m_UseBakedLD = false;
+
+		ILOG("Info : IBL rebake completed. frames = %u", m_Scheduler.GetFrameCount());
+	}
+}
+
+bool IBLBaker::IsRebaking() const
+{
+	return m_Scheduler.IsBaking();
+}
+
+bool IBLBaker::LoadBakedTextures(
+	ID3D12Device* pDevice,
+	DescriptorPool* pPoolRes,
+	const wchar_t* dfgPath,
+	const wchar_t* diffuseLDPath,
+	const wchar_t* specularLDPath,
+	DirectX::ResourceUploadBatch& batch)
+{
+	if (!m_BakedDFG.Init(pDevice, pPoolRes, dfgPath, false, batch))
+	{
+		ELOG("Error : Texture::Init() Failed. path = %ls", dfgPath);
+		return false;
+	}
+
+	if (!m_BakedDiffuseLD.Init(pDevice, pPoolRes, diffuseLDPath, false, batch))
+	{
+		ELOG("Error : Texture::Init() Failed. path = %ls", diffuseLDPath);
+		return false;
+	}
+
+	if (!m_BakedSpecularLD.Init(pDevice, pPoolRes, specularLDPath, false, batch))
+	{
+		ELOG("Error : Texture::Init() Failed. path = %ls", specularLDPath);
+		return false;
+	}
+
+	m_UseBakedTexture = true;
+	m_UseBakedLD = true;
+	return true;
+}
+
+bool IBLBaker::IsBakedTextureLoaded() const
+{
+	return m_UseBakedTexture;
+}
+
+bool IBLBaker::CaptureResults(ID3D12CommandQueue* pQueue, CpuImage& dfg, CpuCubeMap& diffuseLD, CpuCubeMap& specularLD)
+{
+	const auto state = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+
+	// DFG
+	{
+		DirectX::ScratchImage image;
+		auto hr = DirectX::CaptureTexture(pQueue, m_pTexDFG.Get(), false, image, state, state);
+		if (FAILED(hr) || !LoadFromScratchImage(image, dfg))
+		{
+			ELOG("Error : DirectX::CaptureTexture() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+	}
+
+	// Diffuse LD
+	{
+		DirectX::ScratchImage image;
+		auto hr = DirectX::CaptureTexture(pQueue, m_pTexDiffuseLD[m_FrontIndex].Get(), true, image, state, state);
+		if (FAILED(hr) || !LoadFromScratchImage(image, diffuseLD))
+		{
+			ELOG("Error : DirectX::CaptureTexture() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+	}
+
+	// Specular LD
+	{
+		DirectX::ScratchImage image;
+		auto hr = DirectX::CaptureTexture(pQueue, m_pTexSpecularLD[m_FrontIndex].Get(), true, image, state, state);
+		if (FAILED(hr) || !LoadFromScratchImage(image, specularLD))
+		{
+			ELOG("Error : DirectX::CaptureTexture() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+	}
+
+	return true;
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE IBLBaker::GetHandleCPU_DFG() const
 {
+	if (m_UseBakedTexture)
+	{
+		return m_BakedDFG.GetHandleCPU();
+	}
+
 	return m_pHandleSRV_DFG->HandleCPU;
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE IBLBaker::GetHandleCPU_DiffuseLD() const
 {
-	return m_pHandleSRV_DiffuseLD->HandleCPU;
+	if (m_UseBakedLD)
+	{
+		return m_BakedDiffuseLD.GetHandleCPU();
+	}
+
+	return m_pHandleSRV_DiffuseLD[m_FrontIndex]->HandleCPU;
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE IBLBaker::GetHandleCPU_SpecularLD() const
 {
-	return m_pHandleSRV_SpecularLD->HandleCPU;
+	if (m_UseBakedLD)
+	{
+		return m_BakedSpecularLD.GetHandleCPU();
+	}
+
+	return m_pHandleSRV_SpecularLD[m_FrontIndex]->HandleCPU;
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE IBLBaker::GetHandleGPU_DFG() const
 {
+	if (m_UseBakedTexture)
+	{
+		return m_BakedDFG.GetHandleGPU();
+	}
+
 	return m_pHandleSRV_DFG->HandleGPU;
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE IBLBaker::GetHandleGPU_DiffuseLD() const
 {
-	return m_pHandleSRV_DiffuseLD->HandleGPU;
+	if (m_UseBakedLD)
+	{
+		return m_BakedDiffuseLD.GetHandleGPU();
+	}
+
+	return m_pHandleSRV_DiffuseLD[m_FrontIndex]->HandleGPU;
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE IBLBaker::GetHandleGPU_SpecularLD() const
 {
-	return m_pHandleSRV_SpecularLD->HandleGPU;
+	if (m_UseBakedLD)
+	{
+		return m_BakedSpecularLD.GetHandleGPU();
+	}
+
+	return m_pHandleSRV_SpecularLD[m_FrontIndex]->HandleGPU;
 }
 
 void IBLBaker::IntegrateDiffuseLD(ID3D12GraphicsCommandList* pCmd, D3D12_GPU_DESCRIPTOR_HANDLE handle)
 {
-	auto pVBV = m_QuadVB.GetView();
+	const auto front = m_FrontIndex.load();
 
 	DirectX::TransitionResource(
 		pCmd,
-		m_pTexDiffuseLD.Get(),
+		m_pTexDiffuseLD[front].Get(),
 		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
 		D3D12_RESOURCE_STATE_RENDER_TARGET);
 
-	D3D12_VIEWPORT viewport = {};
-	viewport.TopLeftX = 0.0f;
-	viewport.TopLeftY = 0.0f;
-	viewport.Width = LDTextureSize;
-	viewport.Height = LDTextureSize;
-	viewport.MinDepth = 0.0f;
-	viewport.MaxDepth = 1.0f;
-
-	D3D12_RECT scissor = {};
-	scissor.left = 0;
-	scissor.right = LDTextureSize;
-	scissor.top = 0;
-	scissor.bottom = LDTextureSize;
-
-	for (auto i = 0; i < 6; ++i)
+	for (auto i = 0u; i < 6; ++i)
 	{
-		PIXBeginEvent(pCmd, 0, "IntegrateDiffuseLD%d", i);
-		auto pRTV = m_pHandleRTV_DiffuseLD[i]->HandleCPU;
-		pCmd->OMSetRenderTargets(1, &pRTV, FALSE, nullptr);
-		pCmd->RSSetViewports(1, &viewport);
-		pCmd->RSSetScissorRects(1, &scissor);
-		pCmd->SetPipelineState(m_pDiffuseLD_PSO.Get());
-		pCmd->SetGraphicsRootDescriptorTable(0, m_BakeCB[i * MipCount].GetHandleGPU());
-		pCmd->SetGraphicsRootDescriptorTable(1, handle);
-
-		pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		pCmd->IASetVertexBuffers(0, 1, &pVBV);
-		pCmd->IASetIndexBuffer(nullptr);
-		pCmd->DrawInstanced(3, 1, 0, 0);
-		PIXEndEvent(pCmd);
+		DrawDiffuseLD(pCmd, 0, front, i, handle);
 	}
 
 	DirectX::TransitionResource(
 		pCmd,
-		m_pTexDiffuseLD.Get(),
+		m_pTexDiffuseLD[front].Get(),
 		D3D12_RESOURCE_STATE_RENDER_TARGET,
 		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 }
 
 void IBLBaker::IntegrateSpecularLD(ID3D12GraphicsCommandList* pCmd, D3D12_GPU_DESCRIPTOR_HANDLE handle)
 {
-	auto pVBV = m_QuadVB.GetView();
+	const auto front = m_FrontIndex.load();
 
 	DirectX::TransitionResource(
 		pCmd,
-		m_pTexSpecularLD.Get(),
+		m_pTexSpecularLD[front].Get(),
 		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
 		D3D12_RESOURCE_STATE_RENDER_TARGET);
 
+	for (auto i = 0u; i < 6; ++i)
+	{
+		for (auto m = 0u; m < MipCount; ++m)
+		{
+			DrawSpecularLD(pCmd, 0, front, i, m, handle);
+		}
+	}
+
+	DirectX::TransitionResource(
+		pCmd,
+		m_pTexSpecularLD[front].Get(),
+		D3D12_RESOURCE_STATE_RENDER_TARGET,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
+
+void IBLBaker::SetBakeParams(uint32_t frameIndex)
+{
 	auto idx = 0;
+
+	// o̓eNX`̃~bv}bvŊăXebv߂
+	//  ̓eNX`TCYɂ mipCount != MipCount ƂȂ邱Ƃɒ
+	const auto RoughnessStep = 1.0f / (MipCount - 1);
+
 	for (auto i = 0; i < 6; ++i)
 	{
-		auto w = LDTextureSize;
-		auto h = LDTextureSize;
+		auto roughness = 0.0f;
 
+		// o̓eNX`̃~bv}bv[v
 		for (auto m = 0; m < MipCount; ++m)
 		{
-			D3D12_VIEWPORT viewport = {};
-			viewport.TopLeftX = 0.0f;
-			viewport.TopLeftY = 0.0f;
-			viewport.Width = float(w);
-			viewport.Height = float(h);
-			viewport.MinDepth = 0.0f;
-			viewport.MaxDepth = 1.0f;
-
-			D3D12_RECT scissor = {};
-			scissor.left = 0;
-			scissor.right = w;
-			scissor.top = 0;
-			scissor.bottom = h;
-
-			auto pRTV = m_pHandleRTV_SpecularLD[idx]->HandleCPU;
-			pCmd->OMSetRenderTargets(1, &pRTV, FALSE, nullptr);
-			pCmd->RSSetViewports(1, &viewport);
-			pCmd->RSSetScissorRects(1, &scissor);
-			pCmd->SetPipelineState(m_pSpecularLD_PSO.Get());
-			pCmd->SetGraphicsRootDescriptorTable(0, m_BakeCB[idx].GetHandleGPU());
-			pCmd->SetGraphicsRootDescriptorTable(1, handle);
-
-			pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			pCmd->IASetVertexBuffers(0, 1, &pVBV);
-			pCmd->IASetIndexBuffer(nullptr);
-			pCmd->DrawInstanced(3, 1, 0, 0);
-
-			w >>= 1;
-			h >>= 1;
-
-			if (w < 1)
-			{
-				w = 1;
-			}
-
-			if (h < 1)
-			{
-				h = 1;
-			}
+			auto ptr = m_BakeCB[frameIndex][idx].GetPtr<CbBake>();
+			ptr->FaceIndex = i;
+			ptr->MipCount = float(m_BakeMipCount - 1);
+			ptr->Width = float(m_BakeMapSize);
+			ptr->Roughness = roughness * roughness;
 
 			idx++;
+			roughness += RoughnessStep;
 		}
 	}
+}
 
-	DirectX::TransitionResource(
-		pCmd,
-		m_pTexSpecularLD.Get(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET,
-		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+void IBLBaker::DrawDiffuseLD(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex, uint32_t buffer, uint32_t face, D3D12_GPU_DESCRIPTOR_HANDLE handle)
+{
+	auto pVBV = m_QuadVB.GetView();
+
+	D3D12_VIEWPORT viewport = {};
+	viewport.TopLeftX = 0.0f;
+	viewport.TopLeftY = 0.0f;
+	viewport.Width = LDTextureSize;
+	viewport.Height = LDTextureSize;
+	viewport.MinDepth = 0.0f;
+	viewport.MaxDepth = 1.0f;
+
+	D3D12_RECT scissor = {};
+	scissor.left = 0;
+	scissor.right = LDTextureSize;
+	scissor.top = 0;
+	scissor.bottom = LDTextureSize;
+
+	PIXBeginEvent(pCmd, 0, "IntegrateDiffuseLD%d", face);
+	auto pRTV = m_pHandleRTV_DiffuseLD[buffer][face]->HandleCPU;
+	pCmd->OMSetRenderTargets(1, &pRTV, FALSE, nullptr);
+	pCmd->RSSetViewports(1, &viewport);
+	pCmd->RSSetScissorRects(1, &scissor);
+	pCmd->SetPipelineState(m_pDiffuseLD_PSO.Get());
+	pCmd->SetGraphicsRootDescriptorTable(0, m_BakeCB[frameIndex][face * MipCount].GetHandleGPU());
+	pCmd->SetGraphicsRootDescriptorTable(1, handle);
+
+	pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	pCmd->IASetVertexBuffers(0, 1, &pVBV);
+	pCmd->IASetIndexBuffer(nullptr);
+	pCmd->DrawInstanced(3, 1, 0, 0);
+	PIXEndEvent(pCmd);
+}
+
+void IBLBaker::DrawSpecularLD(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex, uint32_t buffer, uint32_t face, uint32_t mip, D3D12_GPU_DESCRIPTOR_HANDLE handle)
+{
+	auto pVBV = m_QuadVB.GetView();
+	auto idx = face * MipCount + mip;
+
+	auto w = LDTextureSize >> mip;
+	auto h = LDTextureSize >> mip;
+
+	if (w < 1)
+	{
+		w = 1;
+	}
+
+	if (h < 1)
+	{
+		h = 1;
+	}
+
+	D3D12_VIEWPORT viewport = {};
+	viewport.TopLeftX = 0.0f;
+	viewport.TopLeftY = 0.0f;
+	viewport.Width = float(w);
+	viewport.Height = float(h);
+	viewport.MinDepth = 0.0f;
+	viewport.MaxDepth = 1.0f;
+
+	D3D12_RECT scissor = {};
+	scissor.left = 0;
+	scissor.right = w;
+	scissor.top = 0;
+	scissor.bottom = h;
+
+	auto pRTV = m_pHandleRTV_SpecularLD[buffer][idx]->HandleCPU;
+	pCmd->OMSetRenderTargets(1, &pRTV, FALSE, nullptr);
+	pCmd->RSSetViewports(1, &viewport);
+	pCmd->RSSetScissorRects(1, &scissor);
+	pCmd->SetPipelineState(m_pSpecularLD_PSO.Get());
+	pCmd->SetGraphicsRootDescriptorTable(0, m_BakeCB[frameIndex][idx].GetHandleGPU());
+	pCmd->SetGraphicsRootDescriptorTable(1, handle);
+
+	pCmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	pCmd->IASetVertexBuffers(0, 1, &pVBV);
+	pCmd->IASetIndexBuffer(nullptr);
+	pCmd->DrawInstanced(3, 1, 0, 0);
 }
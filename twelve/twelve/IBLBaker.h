@@ -1,11 +1,20 @@
 #pragma once
 
+#include <atomic>
+#include <vector>
+
 #include "VertexBuffer.h"
 #include "ConstantBuffer.h"
 #include "DescriptorPool.h"
 #include "RootSignature.h"
+#include "PipelineCache.h"
 #include "Texture.h"
 #include "ColorTarget.h"
+#include "IBLBakeScheduler.h"
+#include "Constants.h"
+
+struct CpuImage;
+struct CpuCubeMap;
 
 class IBLBaker
 {
@@ -13,6 +22,10 @@ public:
 	static const int    DFGTextureSize = 512;
 	static const int    LDTextureSize = 256;
 	static const int    MipCount = 8;
+	static const int    BufferCount = 2;				// LD項のバッファ数 (表示用と再ベイク用)
+	static const int    MaxRebakeItemsPerFrame = 8;	// 再ベイクで1フレームに処理する最大数
+
+	static const DXGI_FORMAT LDFormat = DXGI_FORMAT_R11G11B10_FLOAT;	// LD項のフォーマット (アルファは使用しない)
 
 	IBLBaker();
 	~IBLBaker();
@@ -20,7 +33,8 @@ public:
 	bool Init(
 		ID3D12Device* pDevice,
 		DescriptorPool* pPoolRes,
-		DescriptorPool* pPoolRTV);
+		DescriptorPool* pPoolRTV,
+		PipelineCache* pPipelineCache = nullptr);
 
 	void Term();
 
@@ -32,6 +46,64 @@ public:
 		uint32_t mipCount,
 		D3D12_GPU_DESCRIPTOR_HANDLE handle);
 
+	/// <summary>
+	/// 再ベイク用の初期化処理 (時間計測用のクエリを生成する)
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="pQueue">コマンドキュー (タイムスタンプの周波数の取得に使用する)</param>
+	/// <param name="budgetMilliseconds">1フレームあたりの予算 (ミリ秒)</param>
+	bool InitRebake(
+		ID3D12Device* pDevice,
+		ID3D12CommandQueue* pQueue,
+		double budgetMilliseconds);
+
+	/// <summary>
+	/// LD項の再ベイクを要求する
+	/// 再ベイクは UpdateRebake() で複数フレームに分割して裏バッファに行い, 完了時に表バッファと入れ替える
+	/// </summary>
+	void RequestRebake(
+		uint32_t mapSize,
+		uint32_t mipCount,
+		D3D12_GPU_DESCRIPTOR_HANDLE handle);
+
+	/// <summary>
+	/// 予算の範囲で再ベイクを進める (毎フレーム呼び出す)
+	/// </summary>
+	/// <param name="pCmd">コマンドリスト</param>
+	/// <param name="frameIndex">フレーム番号 (計測結果の読み戻しに使用する)</param>
+	void UpdateRebake(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex);
+
+	/// <summary>
+	/// 再ベイク中かどうか
+	/// </summary>
+	bool IsRebaking() const;
+
+	/// <summary>
+	/// CPUでベイクしたテクスチャを読み込む
+	/// 読み込み後は各ハンドルの取得関数が読み込んだテクスチャのハンドルを返す
+	/// </summary>
+	bool LoadBakedTextures(
+		ID3D12Device* pDevice,
+		DescriptorPool* pPoolRes,
+		const wchar_t* dfgPath,
+		const wchar_t* diffuseLDPath,
+		const wchar_t* specularLDPath,
+		DirectX::ResourceUploadBatch& batch);
+
+	/// <summary>
+	/// CPUでベイクしたテクスチャを使用しているかどうか
+	/// </summary>
+	bool IsBakedTextureLoaded() const;
+
+	/// <summary>
+	/// GPUでベイクした結果をCPU側に読み戻す (完了まで待機する)
+	/// </summary>
+	bool CaptureResults(
+		ID3D12CommandQueue* pQueue,
+		CpuImage& dfg,
+		CpuCubeMap& diffuseLD,
+		CpuCubeMap& specularLD);
+
 	D3D12_CPU_DESCRIPTOR_HANDLE GetHandleCPU_DFG() const;
 	D3D12_CPU_DESCRIPTOR_HANDLE GetHandleCPU_DiffuseLD() const;
 	D3D12_CPU_DESCRIPTOR_HANDLE GetHandleCPU_SpecularLD() const;
@@ -40,24 +112,39 @@ public:
 	D3D12_GPU_DESCRIPTOR_HANDLE GetHandleGPU_SpecularLD() const;
 
 private:
-	ConstantBuffer m_BakeCB[MipCount * 6];
+	ConstantBuffer m_BakeCB[Constants::MaxFrameCount][MipCount * 6];	// フレーム番号ごとのベイク用定数バッファ (GPUが参照中のものを書き換えないように分ける)
 	VertexBuffer m_QuadVB;
 	ComPtr<ID3D12Resource> m_pTexDFG;
-	ComPtr<ID3D12Resource> m_pTexDiffuseLD;
-	ComPtr<ID3D12Resource> m_pTexSpecularLD;
+	ComPtr<ID3D12Resource> m_pTexDiffuseLD[BufferCount];
+	ComPtr<ID3D12Resource> m_pTexSpecularLD[BufferCount];
 	DescriptorPool* m_pPoolRes;
 	DescriptorPool* m_pPoolRTV;
 	DescriptorHandle* m_pHandleRTV_DFG;
-	DescriptorHandle* m_pHandleRTV_DiffuseLD[6];
-	DescriptorHandle* m_pHandleRTV_SpecularLD[MipCount * 6];
+	DescriptorHandle* m_pHandleRTV_DiffuseLD[BufferCount][6];
+	DescriptorHandle* m_pHandleRTV_SpecularLD[BufferCount][MipCount * 6];
 	DescriptorHandle* m_pHandleSRV_DFG;
-	DescriptorHandle* m_pHandleSRV_DiffuseLD;
-	DescriptorHandle* m_pHandleSRV_SpecularLD;
+	DescriptorHandle* m_pHandleSRV_DiffuseLD[BufferCount];
+	DescriptorHandle* m_pHandleSRV_SpecularLD[BufferCount];
 	ComPtr<ID3D12PipelineState> m_pDFG_PSO;
 	ComPtr<ID3D12PipelineState> m_pDiffuseLD_PSO;
 	ComPtr<ID3D12PipelineState> m_pSpecularLD_PSO;
 	RootSignature m_DFG_RootSignature;
 	RootSignature m_LD_RootSignature;
+	Texture m_BakedDFG;
+	Texture m_BakedDiffuseLD;
+	Texture m_BakedSpecularLD;
+	bool m_UseBakedTexture;
+	bool m_UseBakedLD;						// LD項にCPUでベイクしたテクスチャを使用するかどうか
+	std::atomic<uint32_t> m_FrontIndex;		// 表示に使用するLD項のバッファ番号
+	IBLBakeScheduler m_Scheduler;			// 再ベイクのスケジューラー
+	ComPtr<ID3D12QueryHeap> m_pQueryHeap;	// 再ベイクの時間計測用クエリ
+	ComPtr<ID3D12Resource> m_pQueryReadback;	// クエリ結果の読み戻し用バッファ
+	uint64_t m_TimestampFrequency;			// タイムスタンプの周波数
+	std::vector<IBLBakeScheduler::WorkItem> m_RebakeItems[Constants::MaxFrameCount];	// フレームごとに記録した処理単位
+	D3D12_GPU_DESCRIPTOR_HANDLE m_RebakeSource;	// 再ベイクの入力キューブマップ
+	bool m_RebakeTargetWritable;			// 裏バッファがレンダーターゲット状態かどうか
+	uint32_t m_BakeMapSize;					// ベイクの入力キューブマップのサイズ
+	uint32_t m_BakeMipCount;				// ベイクの入力キューブマップのミップマップ数
 
 	void IntegrateDiffuseLD(
 		ID3D12GraphicsCommandList* pCmd,
@@ -66,4 +153,25 @@ private:
 	void IntegrateSpecularLD(
 		ID3D12GraphicsCommandList* pCmd,
 		D3D12_GPU_DESCRIPTOR_HANDLE handle);
+
+	/// <summary>
+	/// 指定したフレーム番号の定数バッファにベイクのパラメータを書き込む
+	/// (そのフレーム番号で前回記録したコマンドのGPUの完了後に呼び出す)
+	/// </summary>
+	void SetBakeParams(uint32_t frameIndex);
+
+	void DrawDiffuseLD(
+		ID3D12GraphicsCommandList* pCmd,
+		uint32_t frameIndex,
+		uint32_t buffer,
+		uint32_t face,
+		D3D12_GPU_DESCRIPTOR_HANDLE handle);
+
+	void DrawSpecularLD(
+		ID3D12GraphicsCommandList* pCmd,
+		uint32_t frameIndex,
+		uint32_t buffer,
+		uint32_t face,
+		uint32_t mip,
+		D3D12_GPU_DESCRIPTOR_HANDLE handle);
 };
@@ -0,0 +1,702 @@
+﻿#include "IBLBakerCPU.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+
+#include "SphereMapConverterCPU.h"
+#include "CompactCubeMap.h"
+#include "ParallelFor.h"
+#include "Logger.h"
+
+using namespace DirectX;
+
+const double IBLBakerCPU::ValidationPSNR = 40.0;
+
+namespace
+{
+	/// <summary>
+	/// 経過時間をミリ秒で取得する
+	/// </summary>
+	double GetElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	/// <summary>
+	/// ビット列を反転する (HLSL の reversebits() と同じ)
+	/// </summary>
+	uint32_t ReverseBits(uint32_t value)
+	{
+		value = ((value & 0x55555555u) << 1) | ((value >> 1) & 0x55555555u);
+		value = ((value & 0x33333333u) << 2) | ((value >> 2) & 0x33333333u);
+		value = ((value & 0x0f0f0f0fu) << 4) | ((value >> 4) & 0x0f0f0f0fu);
+		value = ((value & 0x00ff00ffu) << 8) | ((value >> 8) & 0x00ff00ffu);
+		return (value << 16) | (value >> 16);
+	}
+
+	/// <summary>
+	/// Hammersley点群をサンプルする (BakeUtil.hlsli の Hammersley() と同じ)
+	/// </summary>
+	XMFLOAT2 Hammersley(uint32_t i, uint32_t n)
+	{
+		return XMFLOAT2(float(i) / float(n), float(ReverseBits(i)) * 2.3283064365386963e-10f);
+	}
+
+	/// <summary>
+	/// 正規直交基底を求める (BakeUtil.hlsli の TangentSpace() と同じ)
+	/// </summary>
+	void TangentSpace(const XMFLOAT3& n, XMFLOAT3& t, XMFLOAT3& b)
+	{
+		auto s = (n.z >= 0.0f) ? 1.0f : -1.0f;
+		auto a = -1.0f / (s + n.z);
+		auto c = n.x * n.y * a;
+		t = XMFLOAT3(1.0f + s * n.x * n.x * a, s * c, -s * n.x);
+		b = XMFLOAT3(c, s + n.y * n.y * a, -n.y);
+	}
+
+	/// <summary>
+	/// 接空間でのサンプル方向 (4個単位でロードできるようにSoAで保持する)
+	/// </summary>
+	struct SampleSet
+	{
+		std::vector<float> X;
+		std::vector<float> Y;
+		std::vector<float> Z;
+
+		void Resize(uint32_t count)
+		{
+			X.resize(count);
+			Y.resize(count);
+			Z.resize(count);
+		}
+
+		uint32_t GetCount() const { return uint32_t(X.size()); }
+	};
+
+	/// <summary>
+	/// GGX分布に基づくハーフベクトルを接空間で求める (BakeUtil.hlsli の SampleGGX() の回転前まで)
+	/// </summary>
+	void BuildGGXSamples(float a, uint32_t count, SampleSet& result)
+	{
+		result.Resize(count);
+
+		for (auto i = 0u; i < count; ++i)
+		{
+			auto u = Hammersley(i, IBLBakerCPU::SampleCount);
+
+			auto phi = 2.0f * XM_PI * u.x;
+			auto cosTheta = sqrtf((1.0f - u.y) / std::max(u.y * (a * a - 1.0f) + 1.0f, 1e-8f));
+			auto sinTheta = sqrtf(std::max(1.0f - cosTheta * cosTheta, 0.0f));
+
+			result.X[i] = sinTheta * cosf(phi);
+			result.Y[i] = sinTheta * sinf(phi);
+			result.Z[i] = cosTheta;
+		}
+	}
+
+	/// <summary>
+	/// Lambert分布に基づくライトベクトルを接空間で求める (BakeUtil.hlsli の SampleLambert() の回転前まで)
+	/// </summary>
+	void BuildLambertSamples(uint32_t count, SampleSet& result)
+	{
+		result.Resize(count);
+
+		for (auto i = 0u; i < count; ++i)
+		{
+			auto u = Hammersley(i, IBLBakerCPU::SampleCount);
+
+			auto r = sqrtf(u.y);
+			auto phi = 2.0f * XM_PI * u.x;
+
+			result.X[i] = r * cosf(phi);
+			result.Y[i] = r * sinf(phi);
+			result.Z[i] = sqrtf(1.0f - u.y);
+		}
+	}
+
+	/// <summary>
+	/// 4個分のサンプル方向を読み込む
+	/// </summary>
+	void LoadSamples(const SampleSet& samples, uint32_t i, XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+	{
+		x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&samples.X[i]));
+		y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&samples.Y[i]));
+		z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&samples.Z[i]));
+	}
+
+	/// <summary>
+	/// 4個分のベクトルを正規化する
+	/// </summary>
+	void Normalize(XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+	{
+		auto lenSq = XMVectorMultiplyAdd(x, x, XMVectorMultiplyAdd(y, y, XMVectorMultiply(z, z)));
+		auto invLen = XMVectorDivide(XMVectorSplatOne(), XMVectorSqrt(lenSq));
+		x = XMVectorMultiply(x, invLen);
+		y = XMVectorMultiply(y, invLen);
+		z = XMVectorMultiply(z, invLen);
+	}
+
+	/// <summary>
+	/// 接空間のベクトル4個をワールド空間に変換して正規化する
+	/// </summary>
+	void ToWorld(
+		const XMFLOAT3& t, const XMFLOAT3& b, const XMFLOAT3& n,
+		FXMVECTOR hx, FXMVECTOR hy, FXMVECTOR hz,
+		XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+	{
+		x = XMVectorMultiplyAdd(XMVectorReplicate(t.x), hx, XMVectorMultiplyAdd(XMVectorReplicate(b.x), hy, XMVectorMultiply(XMVectorReplicate(n.x), hz)));
+		y = XMVectorMultiplyAdd(XMVectorReplicate(t.y), hx, XMVectorMultiplyAdd(XMVectorReplicate(b.y), hy, XMVectorMultiply(XMVectorReplicate(n.y), hz)));
+		z = XMVectorMultiplyAdd(XMVectorReplicate(t.z), hx, XMVectorMultiplyAdd(XMVectorReplicate(b.z), hy, XMVectorMultiply(XMVectorReplicate(n.z), hz)));
+		Normalize(x, y, z);
+	}
+
+	/// <summary>
+	/// ミップマップフィルタ重点サンプリングで参照するミップレベルを求める
+	/// </summary>
+	XMVECTOR CalcMipLevel(FXMVECTOR pdf, float omegaP, float mipCount)
+	{
+		auto omegaS = XMVectorReciprocal(XMVectorMax(XMVectorScale(pdf, float(IBLBakerCPU::SampleCount)), XMVectorReplicate(1e-8f)));
+		auto l = XMVectorAdd(
+			XMVectorScale(XMVectorSubtract(XMVectorLog2(omegaS), XMVectorReplicate(log2f(omegaP))), 0.5f),
+			XMVectorSplatOne());
+		return XMVectorClamp(l, XMVectorZero(), XMVectorReplicate(mipCount));
+	}
+
+	/// <summary>
+	/// DFG項の1行分を積分する (IntegrateDFG_PS.hlsl と同じ計算)
+	/// 行内でラフネスが一定となるため, ハーフベクトルは行単位で求めておく
+	/// </summary>
+	void IntegrateDFGRow(uint32_t y, CpuImage& result)
+	{
+		const auto size = result.Width;
+
+		// QuadVS のテクスチャ座標は上端が1となる
+		auto roughness = 1.0f - (float(y) + 0.5f) / float(result.Height);
+		auto a = roughness * roughness;
+
+		SampleSet samples;
+		BuildGGXSamples(a, IBLBakerCPU::DFGSampleCount, samples);
+
+		// N = (0, 0, 1) の接空間は単位行列となる
+		const auto zero = XMVectorZero();
+		const auto one = XMVectorSplatOne();
+		const auto two = XMVectorReplicate(2.0f);
+		const auto epsilon = XMVectorReplicate(1e-8f);
+		const auto a2 = XMVectorReplicate(roughness * roughness);
+
+		auto row = result.GetRow(y);
+
+		for (auto x = 0u; x < size; ++x)
+		{
+			auto NdotV = (float(x) + 0.5f) / float(size);
+
+			const auto vx = XMVectorReplicate(sqrtf(1.0f - NdotV * NdotV));
+			const auto vz = XMVectorReplicate(NdotV);
+			const auto NdotVs = XMVectorReplicate(NdotV);
+
+			// G2_Smith() のうち NdotV のみに依存する項
+			auto NV2 = NdotV * NdotV;
+			auto lambdaL = XMVectorReplicate((-1.0f + sqrtf(roughness * roughness * (1.0f - NV2) / std::max(NV2, 1e-8f) + 1.0f)) * 0.5f);
+
+			auto accX = zero;
+			auto accY = zero;
+
+			for (auto i = 0u; i < samples.GetCount(); i += 4)
+			{
+				XMVECTOR hx, hy, hz;
+				LoadSamples(samples, i, hx, hy, hz);
+				Normalize(hx, hy, hz);
+
+				auto VdotH = XMVectorMultiplyAdd(vx, hx, XMVectorMultiply(vz, hz));
+
+				// L = normalize(2 * dot(V, H) * H - V)
+				auto s = XMVectorMultiply(two, VdotH);
+				auto lx = XMVectorSubtract(XMVectorMultiply(s, hx), vx);
+				auto ly = XMVectorMultiply(s, hy);
+				auto lz = XMVectorSubtract(XMVectorMultiply(s, hz), vz);
+				Normalize(lx, ly, lz);
+
+				auto NdotL = lz;
+				auto mask = XMVectorGreater(NdotL, zero);
+
+				auto NdotH = XMVectorSaturate(hz);
+				VdotH = XMVectorSaturate(VdotH);
+
+				// G2_Smith(NdotL, NdotV, roughness)
+				auto NL2 = XMVectorMultiply(NdotL, NdotL);
+				auto lambdaV = XMVectorScale(
+					XMVectorSubtract(XMVectorSqrt(XMVectorAdd(XMVectorDivide(XMVectorMultiply(a2, XMVectorSubtract(one, NL2)), XMVectorMax(NL2, epsilon)), one)), one),
+					0.5f);
+				auto G = XMVectorReciprocal(XMVectorMax(XMVectorAdd(one, XMVectorAdd(lambdaV, lambdaL)), epsilon));
+
+				auto GVis = XMVectorDivide(XMVectorMultiply(G, VdotH), XMVectorMax(XMVectorMultiply(NdotVs, NdotH), epsilon));
+
+				// Fc = pow(1 - VdotH, 5)
+				auto t = XMVectorSubtract(one, VdotH);
+				auto t2 = XMVectorMultiply(t, t);
+				auto Fc = XMVectorMultiply(XMVectorMultiply(t2, t2), t);
+
+				accX = XMVectorAdd(accX, XMVectorSelect(zero, XMVectorMultiply(XMVectorSubtract(one, Fc), GVis), mask));
+				accY = XMVectorAdd(accY, XMVectorSelect(zero, XMVectorMultiply(Fc, GVis), mask));
+			}
+
+			XMFLOAT4 sx, sy;
+			XMStoreFloat4(&sx, accX);
+			XMStoreFloat4(&sy, accY);
+
+			auto invCount = 1.0f / float(samples.GetCount());
+			row[x].x = (sx.x + sx.y + sx.z + sx.w) * invCount;
+			row[x].y = (sy.x + sy.y + sy.z + sy.w) * invCount;
+			row[x].z = 0.0f;
+			row[x].w = 1.0f;
+		}
+	}
+
+	/// <summary>
+	/// Diffuse LD項の1行分を積分する (IntegrateDiffuseLD_PS.hlsl と同じ計算)
+	/// </summary>
+	void IntegrateDiffuseRow(const CpuCubeMap& env, const SampleSet& samples, uint32_t face, uint32_t y, CpuImage& result)
+	{
+		const auto size = result.Width;
+		const auto width = float(env.Size);
+		const auto omegaP = (4.0f * XM_PI) / (6.0f * width * width);
+		const auto mipCount = float(env.MipCount - 1);
+		const auto zero = XMVectorZero();
+
+		auto row = result.GetRow(y);
+
+		for (auto x = 0u; x < size; ++x)
+		{
+			XMFLOAT3 n, t, b;
+			XMStoreFloat3(&n, CalcCubeDirection(face, (float(x) + 0.5f) / float(size), (float(y) + 0.5f) / float(size)));
+			TangentSpace(n, t, b);
+
+			auto acc = zero;
+			auto accWeight = 0.0f;
+
+			for (auto i = 0u; i < samples.GetCount(); i += 4)
+			{
+				XMVECTOR hx, hy, hz;
+				LoadSamples(samples, i, hx, hy, hz);
+
+				XMVECTOR lx, ly, lz;
+				ToWorld(t, b, n, hx, hy, hz, lx, ly, lz);
+
+				auto NdotL = XMVectorSaturate(XMVectorMultiplyAdd(XMVectorReplicate(n.x), lx, XMVectorMultiplyAdd(XMVectorReplicate(n.y), ly, XMVectorMultiply(XMVectorReplicate(n.z), lz))));
+				auto lod = CalcMipLevel(XMVectorScale(NdotL, XM_1DIVPI), omegaP, mipCount);
+
+				XMFLOAT4 sx, sy, sz, sn, sl;
+				XMStoreFloat4(&sx, lx);
+				XMStoreFloat4(&sy, ly);
+				XMStoreFloat4(&sz, lz);
+				XMStoreFloat4(&sn, NdotL);
+				XMStoreFloat4(&sl, lod);
+
+				for (auto j = 0; j < 4; ++j)
+				{
+					if ((&sn.x)[j] > 0.0f)
+					{
+						auto dir = XMVectorSet((&sx.x)[j], (&sy.x)[j], (&sz.x)[j], 0.0f);
+						acc = XMVectorAdd(acc, SampleCube(env, dir, (&sl.x)[j]));
+						accWeight += 1.0f;
+					}
+				}
+			}
+
+			if (accWeight > 0.0f)
+			{
+				acc = XMVectorScale(acc, 1.0f / accWeight);
+			}
+
+			XMStoreFloat4(&row[x], XMVectorSetW(acc, 1.0f));
+		}
+	}
+
+	/// <summary>
+	/// Specular LD項の1行分を積分する (IntegrateSpecularLD_PS.hlsl と同じ計算)
+	/// </summary>
+	void IntegrateSpecularRow(const CpuCubeMap& env, const SampleSet& samples, float a, uint32_t face, uint32_t y, CpuImage& result)
+	{
+		const auto size = result.Width;
+		const auto width = float(env.Size);
+		const auto omegaP = (4.0f * XM_PI) / (6.0f * width * width);
+		const auto mipCount = float(env.MipCount - 1);
+		const auto zero = XMVectorZero();
+		const auto one = XMVectorSplatOne();
+		const auto two = XMVectorReplicate(2.0f);
+
+		// D_GGX(NdotL, a) のうちサンプルに依存しない項 (シェーダーと同じ引数順で評価する)
+		const auto NH = XMVectorReplicate(a);
+		const auto NH2 = XMVectorReplicate(a * a);
+
+		auto row = result.GetRow(y);
+
+		for (auto x = 0u; x < size; ++x)
+		{
+			auto dir = CalcCubeDirection(face, (float(x) + 0.5f) / float(size), (float(y) + 0.5f) / float(size));
+
+			// ラフネスが0の場合は入力をそのまま参照する
+			if (a == 0.0f)
+			{
+				XMStoreFloat4(&row[x], XMVectorSetW(SampleCube(env, dir, 0.0f), 1.0f));
+				continue;
+			}
+
+			XMFLOAT3 n, t, b;
+			XMStoreFloat3(&n, dir);
+			TangentSpace(n, t, b);
+
+			const auto nx = XMVectorReplicate(n.x);
+			const auto ny = XMVectorReplicate(n.y);
+			const auto nz = XMVectorReplicate(n.z);
+
+			auto acc = zero;
+			auto accWeight = 0.0f;
+
+			for (auto i = 0u; i < samples.GetCount(); i += 4)
+			{
+				XMVECTOR sx, sy, sz;
+				LoadSamples(samples, i, sx, sy, sz);
+
+				XMVECTOR hx, hy, hz;
+				ToWorld(t, b, n, sx, sy, sz, hx, hy, hz);
+
+				// V = N として L = normalize(2 * dot(V, H) * H - V)
+				auto VdotH = XMVectorMultiplyAdd(nx, hx, XMVectorMultiplyAdd(ny, hy, XMVectorMultiply(nz, hz)));
+				auto s = XMVectorMultiply(two, VdotH);
+				auto lx = XMVectorSubtract(XMVectorMultiply(s, hx), nx);
+				auto ly = XMVectorSubtract(XMVectorMultiply(s, hy), ny);
+				auto lz = XMVectorSubtract(XMVectorMultiply(s, hz), nz);
+				Normalize(lx, ly, lz);
+
+				auto NdotL = XMVectorSaturate(XMVectorMultiplyAdd(nx, lx, XMVectorMultiplyAdd(ny, ly, XMVectorMultiply(nz, lz))));
+
+				// pdf = D_GGX(NdotL, a) * NdotL
+				auto a2 = XMVectorMultiply(NdotL, NdotL);
+				auto f = XMVectorMultiply(NH2, XMVectorMultiplyAdd(XMVectorSubtract(a2, one), NH, one));
+				auto D = XMVectorDivide(a2, XMVectorScale(XMVectorMultiply(f, f), XM_PI));
+				auto lod = CalcMipLevel(XMVectorMultiply(D, NdotL), omegaP, mipCount);
+
+				XMFLOAT4 fx, fy, fz, fn, fl;
+				XMStoreFloat4(&fx, lx);
+				XMStoreFloat4(&fy, ly);
+				XMStoreFloat4(&fz, lz);
+				XMStoreFloat4(&fn, NdotL);
+				XMStoreFloat4(&fl, lod);
+
+				for (auto j = 0; j < 4; ++j)
+				{
+					auto weight = (&fn.x)[j];
+					if (weight > 0.0f)
+					{
+						auto L = XMVectorSet((&fx.x)[j], (&fy.x)[j], (&fz.x)[j], 0.0f);
+						acc = XMVectorMultiplyAdd(SampleCube(env, L, (&fl.x)[j]), XMVectorReplicate(weight), acc);
+						accWeight += weight;
+					}
+				}
+			}
+
+			if (accWeight > 0.0f)
+			{
+				acc = XMVectorScale(acc, 1.0f / accWeight);
+			}
+
+			XMStoreFloat4(&row[x], XMVectorSetW(acc, 1.0f));
+		}
+	}
+}
+
+IBLBakerCPU::IBLBakerCPU()
+	: m_CacheHit(false)
+{
+}
+
+IBLBakerCPU::~IBLBakerCPU()
+{
+}
+
+bool IBLBakerCPU::Bake(SphereMapConverterCPU& converter)
+{
+	if (converter.GetCubeMapPath().empty())
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	m_CacheHit = false;
+	m_DFG = CpuImage();
+	m_DiffuseLD = CpuCubeMap();
+	m_SpecularLD = CpuCubeMap();
+
+	// キャッシュファイルのパスを決定
+	// 環境マップのキャッシュ名 (ソースのハッシュ値とサイズを含む) に出力サイズとミップレベル数を付加する
+	// DFG項は環境マップに依存しないため共通とする
+	std::filesystem::path cubeMapPath(converter.GetCubeMapPath());
+	auto cacheDir = cubeMapPath.parent_path();
+	auto envKey = cubeMapPath.stem().wstring();
+
+	m_DFGPath = (cacheDir / (L"IBL_DFG_" + std::to_wstring(DFGTextureSize) + L"_" + std::to_wstring(DFGSampleCount) + L".dds")).wstring();
+	m_DiffuseLDPath = (cacheDir / (envKey + L"_DiffuseLD_" + std::to_wstring(LDTextureSize) + L".dds")).wstring();
+	m_SpecularLDPath = (cacheDir / (envKey + L"_SpecularLD_" + std::to_wstring(LDTextureSize) + L"_" + std::to_wstring(MipCount) + L".dds")).wstring();
+
+	std::error_code error;
+	auto hasDFG = std::filesystem::exists(m_DFGPath, error);
+	auto hasDiffuseLD = std::filesystem::exists(m_DiffuseLDPath, error);
+	auto hasSpecularLD = std::filesystem::exists(m_SpecularLDPath, error);
+
+	if (hasDFG && hasDiffuseLD && hasSpecularLD)
+	{
+		m_CacheHit = true;
+		ILOG("IBLBakerCPU : Cache Hit. path = %ls", m_SpecularLDPath.c_str());
+		return true;
+	}
+
+	std::filesystem::create_directories(cacheDir, error);
+
+	// DFG項
+	if (!hasDFG)
+	{
+		auto start = std::chrono::steady_clock::now();
+		IntegrateDFG(DFGTextureSize, m_DFG);
+		auto elapsed = GetElapsedMilliseconds(start);
+
+		ILOG("IBLBakerCPU : DFG %ux%u, %u samples, %.3f ms", DFGTextureSize, DFGTextureSize, DFGSampleCount, elapsed);
+
+		if (!SaveImageToDDS(m_DFGPath.c_str(), m_DFG, DFGCacheFormat))
+		{
+			ELOG("Error : SaveImageToDDS() Failed. path = %ls", m_DFGPath.c_str());
+			return false;
+		}
+	}
+
+	if (hasDiffuseLD && hasSpecularLD)
+	{
+		return true;
+	}
+
+	// 入力キューブマップを取得
+	CpuCubeMap env;
+	if (!converter.GetCubeMap(env))
+	{
+		ELOG("Error : SphereMapConverterCPU::GetCubeMap() Failed.");
+		return false;
+	}
+
+	// Diffuse LD項
+	if (!hasDiffuseLD)
+	{
+		auto start = std::chrono::steady_clock::now();
+		IntegrateDiffuseLD(env, LDTextureSize, m_DiffuseLD);
+		auto elapsed = GetElapsedMilliseconds(start);
+
+		ILOG("IBLBakerCPU : DiffuseLD %ux%u, %.3f ms", LDTextureSize, LDTextureSize, elapsed);
+
+		CompactCubeMapReport report;
+		if (!SaveCubeMapCompact(m_DiffuseLDPath.c_str(), m_DiffuseLD, &report))
+		{
+			ELOG("Error : SaveCubeMapCompact() Failed. path = %ls", m_DiffuseLDPath.c_str());
+			return false;
+		}
+
+		LogCompactCubeMapReport(std::filesystem::path(m_DiffuseLDPath).filename().wstring().c_str(), report);
+	}
+
+	// Specular LD項
+	if (!hasSpecularLD)
+	{
+		auto start = std::chrono::steady_clock::now();
+		IntegrateSpecularLD(env, LDTextureSize, MipCount, m_SpecularLD);
+		auto elapsed = GetElapsedMilliseconds(start);
+
+		ILOG("IBLBakerCPU : SpecularLD %ux%u (%u mips), %.3f ms", LDTextureSize, LDTextureSize, MipCount, elapsed);
+
+		CompactCubeMapReport report;
+		if (!SaveCubeMapCompact(m_SpecularLDPath.c_str(), m_SpecularLD, &report))
+		{
+			ELOG("Error : SaveCubeMapCompact() Failed. path = %ls", m_SpecularLDPath.c_str());
+			return false;
+		}
+
+		LogCompactCubeMapReport(std::filesystem::path(m_SpecularLDPath).filename().wstring().c_str(), report);
+	}
+
+	return true;
+}
+
+bool IBLBakerCPU::Validate(const CpuImage& dfg, const CpuCubeMap& diffuseLD, const CpuCubeMap& specularLD)
+{
+	if (!LoadResults())
+	{
+		ELOG("Error : IBLBakerCPU::LoadResults() Failed.");
+		return false;
+	}
+
+	auto result = true;
+
+	auto check = [&](const char* name, const ImageError& error)
+	{
+		ILOG("  %-14s RMSE = %.6f, MaxError = %.6f, PSNR = %.2f dB", name, error.RMSE, error.MaxError, error.PSNR);
+		if (error.RMSE < 0.0 || error.PSNR < ValidationPSNR)
+		{
+			result = false;
+		}
+	};
+
+	ILOG("IBLBakerCPU::Validate() : CPU reference vs GPU bake");
+
+	check("DFG", CompareImages(m_DFG, dfg));
+	check("DiffuseLD", CompareCubeMaps(m_DiffuseLD, diffuseLD, 0));
+
+	for (auto mip = 0u; mip < m_SpecularLD.MipCount; ++mip)
+	{
+		char name[32];
+		sprintf_s(name, "SpecularLD[%u]", mip);
+		check(name, CompareCubeMaps(m_SpecularLD, specularLD, mip));
+	}
+
+	if (!result)
+	{
+		ELOG("Warning : IBL bake mismatch. threshold = %.1f dB", ValidationPSNR);
+	}
+
+	return result;
+}
+
+bool IBLBakerCPU::ProjectIrradianceSH(SphereMapConverterCPU& converter, SH9Color& result)
+{
+	CpuCubeMap env;
+	if (!converter.GetCubeMap(env))
+	{
+		ELOG("Error : SphereMapConverterCPU::GetCubeMap() Failed.");
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	ProjectSH9(env, 0, result);
+	ConvolveCosineLobe(result);
+	auto elapsed = GetElapsedMilliseconds(start);
+
+	ILOG("IBLBakerCPU : SH9 projection %ux%u, %.3f ms", env.Size, env.Size, elapsed);
+
+	// Diffuse LD項との誤差を求める
+	if (m_DiffuseLD.Images.empty() && !LoadCubeMapFromDDS(m_DiffuseLDPath.c_str(), m_DiffuseLD))
+	{
+		ELOG("Error : LoadCubeMapFromDDS() Failed. path = %ls", m_DiffuseLDPath.c_str());
+		return true;
+	}
+
+	CpuCubeMap irradiance;
+	EvaluateSH9ToCube(result, m_DiffuseLD.Size, irradiance);
+
+	auto error = CompareCubeMaps(m_DiffuseLD, irradiance, 0);
+	ILOG("  SH9 vs DiffuseLD : RMSE = %.6f, MaxError = %.6f, PSNR = %.2f dB", error.RMSE, error.MaxError, error.PSNR);
+
+	return true;
+}
+
+const std::wstring& IBLBakerCPU::GetDFGPath() const
+{
+	return m_DFGPath;
+}
+
+const std::wstring& IBLBakerCPU::GetDiffuseLDPath() const
+{
+	return m_DiffuseLDPath;
+}
+
+const std::wstring& IBLBakerCPU::GetSpecularLDPath() const
+{
+	return m_SpecularLDPath;
+}
+
+bool IBLBakerCPU::IsCacheHit() const
+{
+	return m_CacheHit;
+}
+
+void IBLBakerCPU::IntegrateDFG(uint32_t size, CpuImage& result, uint32_t threadCount)
+{
+	result.Resize(size, size);
+
+	ParallelFor(0, size, [&](uint32_t y)
+	{
+		IntegrateDFGRow(y, result);
+	}, threadCount);
+}
+
+void IBLBakerCPU::IntegrateDiffuseLD(const CpuCubeMap& env, uint32_t size, CpuCubeMap& result, uint32_t threadCount)
+{
+	result.Resize(size, 1);
+
+	SampleSet samples;
+	BuildLambertSamples(SampleCount, samples);
+
+	ParallelFor(0, 6 * size, [&](uint32_t index)
+	{
+		auto face = index / size;
+		auto y = index % size;
+		IntegrateDiffuseRow(env, samples, face, y, result.GetImage(face, 0));
+	}, threadCount);
+}
+
+void IBLBakerCPU::IntegrateSpecularLD(const CpuCubeMap& env, uint32_t size, uint32_t mipCount, CpuCubeMap& result, uint32_t threadCount)
+{
+	result.Resize(size, mipCount);
+
+	// IBLBaker::IntegrateLD() と同じくラフネスを加算で求め, 2乗した値をシェーダーに渡す
+	std::vector<float> alpha(mipCount);
+	std::vector<SampleSet> samples(mipCount);
+	std::vector<uint32_t> rowOffset(mipCount + 1);
+
+	const auto roughnessStep = 1.0f / float(mipCount - 1);
+	auto roughness = 0.0f;
+
+	for (auto mip = 0u; mip < mipCount; ++mip)
+	{
+		alpha[mip] = roughness * roughness;
+		BuildGGXSamples(alpha[mip], SampleCount, samples[mip]);
+
+		rowOffset[mip + 1] = rowOffset[mip] + 6 * result.GetImage(0, mip).Height;
+		roughness += roughnessStep;
+	}
+
+	// 全ミップの面と行をまとめて並列に処理する
+	ParallelFor(0, rowOffset[mipCount], [&](uint32_t index)
+	{
+		auto mip = 0u;
+		while (index >= rowOffset[mip + 1])
+		{
+			mip++;
+		}
+
+		auto local = index - rowOffset[mip];
+		auto height = result.GetImage(0, mip).Height;
+		auto face = local / height;
+		auto y = local % height;
+
+		IntegrateSpecularRow(env, samples[mip], alpha[mip], face, y, result.GetImage(face, mip));
+	}, threadCount);
+}
+
+bool IBLBakerCPU::LoadResults()
+{
+	if (m_DFG.Pixels.empty() && !LoadImageRGBA32F(m_DFGPath.c_str(), m_DFG))
+	{
+		return false;
+	}
+
+	if (m_DiffuseLD.Images.empty() && !LoadCubeMapFromDDS(m_DiffuseLDPath.c_str(), m_DiffuseLD))
+	{
+		return false;
+	}
+
+	if (m_SpecularLD.Images.empty() && !LoadCubeMapFromDDS(m_SpecularLDPath.c_str(), m_SpecularLD))
+	{
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,106 @@
+﻿#pragma once
+
+#include <string>
+
+#include "CubeMapUtil.h"
+#include "SphericalHarmonics.h"
+
+class SphereMapConverterCPU;
+
+/// <summary>
+/// IBLBaker と同じ分割和近似 (DFG項, Diffuse LD項, Specular LD項) のベイクをCPUで行う
+/// シェーダー (IntegrateDFG_PS, IntegrateDiffuseLD_PS, IntegrateSpecularLD_PS) と同じ計算を行うため, GPUベイクの検証用の基準値として使用できる
+/// ベイク結果は環境マップのハッシュ値とミップレベル数をキーにDDSとしてキャッシュする (LD項は BC6H / R11G11B10_FLOAT に圧縮する)
+/// </summary>
+class IBLBakerCPU
+{
+public:
+	static const uint32_t DFGTextureSize = 512;		// IBLBaker::DFGTextureSize と同じ
+	static const uint32_t LDTextureSize = 256;		// IBLBaker::LDTextureSize と同じ
+	static const uint32_t MipCount = 8;				// IBLBaker::MipCount と同じ
+	static const uint32_t SampleCount = 128;		// BakeUtil.hlsli の SampleCount と同じ
+	static const uint32_t DFGSampleCount = 1024;	// IntegrateDFG_PS.hlsl のサンプル数と同じ
+
+	static const DXGI_FORMAT DFGCacheFormat = DXGI_FORMAT_R32G32_FLOAT;
+
+	IBLBakerCPU();
+	~IBLBakerCPU();
+
+	/// <summary>
+	/// キャッシュを検索し, 見つからなかった項をベイクしてキャッシュを生成する
+	/// </summary>
+	/// <param name="converter">変換済みのスフィアマップコンバーター (キャッシュのキーと入力キューブマップに使用する)</param>
+	/// <returns>全ての項のDDSが用意できた場合はtrue</returns>
+	bool Bake(SphereMapConverterCPU& converter);
+
+	/// <summary>
+	/// GPUでベイクした結果とCPUでのベイク結果を比較してログに出力する
+	/// </summary>
+	/// <param name="dfg">GPUでベイクしたDFG項</param>
+	/// <param name="diffuseLD">GPUでベイクしたDiffuse LD項</param>
+	/// <param name="specularLD">GPUでベイクしたSpecular LD項</param>
+	/// <returns>全ての項のPSNRが ValidationPSNR 以上の場合はtrue</returns>
+	bool Validate(const CpuImage& dfg, const CpuCubeMap& diffuseLD, const CpuCubeMap& specularLD);
+
+	/// <summary>
+	/// 環境マップを球面調和関数 (SH9) に射影し, Diffuse LD項の代わりに使える放射照度の係数を求める
+	/// 射影時間と Diffuse LD項との誤差をログに出力する
+	/// </summary>
+	/// <param name="converter">変換済みのスフィアマップコンバーター</param>
+	/// <param name="result">放射照度 / π の係数の格納先</param>
+	/// <returns>射影に成功した場合はtrue</returns>
+	bool ProjectIrradianceSH(SphereMapConverterCPU& converter, SH9Color& result);
+
+	const std::wstring& GetDFGPath() const;
+	const std::wstring& GetDiffuseLDPath() const;
+	const std::wstring& GetSpecularLDPath() const;
+
+	/// <summary>
+	/// 全ての項がキャッシュにヒットしたかどうか
+	/// </summary>
+	bool IsCacheHit() const;
+
+	/// <summary>
+	/// DFG項を積分する
+	/// </summary>
+	/// <param name="size">テクスチャサイズ</param>
+	/// <param name="result">積分結果の格納先 (xにスケール, yにバイアスを格納する)</param>
+	/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+	static void IntegrateDFG(uint32_t size, CpuImage& result, uint32_t threadCount = 0);
+
+	/// <summary>
+	/// Diffuse LD項を積分する
+	/// </summary>
+	/// <param name="env">入力キューブマップ (ミップマップ付き)</param>
+	/// <param name="size">出力キューブマップ1面の横幅</param>
+	/// <param name="result">積分結果の格納先</param>
+	/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+	static void IntegrateDiffuseLD(const CpuCubeMap& env, uint32_t size, CpuCubeMap& result, uint32_t threadCount = 0);
+
+	/// <summary>
+	/// Specular LD項を積分する
+	/// ミップレベル m には線形ラフネス m / (mipCount - 1) の結果を格納する
+	/// </summary>
+	/// <param name="env">入力キューブマップ (ミップマップ付き)</param>
+	/// <param name="size">出力キューブマップ1面の横幅</param>
+	/// <param name="mipCount">出力キューブマップのミップレベル数</param>
+	/// <param name="result">積分結果の格納先</param>
+	/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+	static void IntegrateSpecularLD(const CpuCubeMap& env, uint32_t size, uint32_t mipCount, CpuCubeMap& result, uint32_t threadCount = 0);
+
+private:
+	static const double ValidationPSNR;	// 検証で許容するPSNR [dB]
+
+	std::wstring	m_DFGPath;			// DFG項のキャッシュのファイルパス
+	std::wstring	m_DiffuseLDPath;	// Diffuse LD項のキャッシュのファイルパス
+	std::wstring	m_SpecularLDPath;	// Specular LD項のキャッシュのファイルパス
+	bool			m_CacheHit;			// 全ての項がキャッシュにヒットしたかどうか
+	CpuImage		m_DFG;				// DFG項 (キャッシュにヒットした場合は空)
+	CpuCubeMap		m_DiffuseLD;		// Diffuse LD項 (キャッシュにヒットした場合は空)
+	CpuCubeMap		m_SpecularLD;		// Specular LD項 (キャッシュにヒットした場合は空)
+
+	bool LoadResults();
+
+	IBLBakerCPU(const IBLBakerCPU&) = delete;
+	void operator=(const IBLBakerCPU&) = delete;
+};
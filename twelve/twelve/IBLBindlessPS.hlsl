@@ -0,0 +1,11 @@
+//-----------------------------------------------------------------------------
+// File : IBLBindlessPS.hlsl
+// Desc : Pixel Shader (Bindless Material).
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#define BINDLESS_MATERIAL
+#include "IBLPS.hlsl"
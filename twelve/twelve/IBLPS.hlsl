@@ -38,6 +38,8 @@ cbuffer CbLight : register(b1)
     float MipCount : packoffset(c0.y); // ~bvJEgł.
     float LightIntensity : packoffset(c0.z); // Cgx(XP[l).
     float3 LightDirection : packoffset(c1); // fBNViCg̕.
+    int UseSHIrradiance : packoffset(c1.w); // ʒa֐ŕˏƓx]邩ǂ.
+    float4 SHCoeffs[9] : packoffset(c2); // ˏƓx/΂̋ʒa֐̌W(rgb̂ݎgp).
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -46,8 +48,27 @@ cbuffer CbLight : register(b1)
 cbuffer CbCamera : register(b2)
 {
     float3 CameraPosition : packoffset(c0); // Jʒuł.
+    uint ClusterTileCountX : packoffset(c1); // NX^[̉̕ł.
+    uint ClusterTileCountY : packoffset(c1.y); // NX^[̏c̕ł.
+    uint ClusterSliceCount : packoffset(c1.z); // NX^[̉s̕ł.
+    uint ClusterLightCount : packoffset(c1.w); // NX^[hCeBÕCgł.
+    float ClusterTileScaleX : packoffset(c2); // sNZW^Cԍւ̔{ł.
+    float ClusterTileScaleY : packoffset(c2.y); // sNZW^Cԍւ̔{ł.
+    float ClusterSliceScale : packoffset(c2.z); // [x̑ΐXCXԍւ̔{ł.
+    float ClusterSliceBias : packoffset(c2.w); // [x̑ΐXCXԍւ̃oCAXł.
+    float4x4 ShadowViewProj[4] : packoffset(c3); // [hԂAgX̃eNX`WƐ[xւ̕ϊł.
+    float4 ShadowSplitFar : packoffset(c19); // eJXP[h̏Ił (r[).
+    float4 ShadowNormalOffset : packoffset(c20); // eJXP[h̖@̃ItZbgł.
+    float3 SunDirection : packoffset(c21); // z̏Ǝ˕ł.
+    float SunIntensity : packoffset(c21.w); // z̋xł.
+    float3 SunColor : packoffset(c22); // z̐Fł.
+    uint ShadowCascadeCount : packoffset(c22.w); // JXP[hł (0̏ꍇ͑z]܂).
+    float ShadowAtlasTexelSize : packoffset(c23); // AgX1eNZ̃eNX`W̑傫ł.
 }
 
+#include "ClusteredLighting.hlsli"
+#include "CascadedShadow.hlsli"
+
 //-----------------------------------------------------------------------------
 // Textures and Samplers
 //-----------------------------------------------------------------------------
@@ -67,17 +88,65 @@ SamplerState SpecularLDSmp : register(s2);
 Texture2D BaseColorMap : register(t3);
 SamplerState BaseColorSmp : register(s3);
 
-// ^bN}bv.
-Texture2D MetallicMap : register(t4);
-SamplerState MetallicSmp : register(s4);
-
-// tlX}bv.
-Texture2D RoughnessMap : register(t5);
-SamplerState RoughnessSmp : register(s5);
+// ORM}bv (R:ArGgIN[W, G:tlX, B:^bN).
+Texture2D ORMMap : register(t4);
+SamplerState ORMSmp : register(s4);
 
 // @}bv.
-Texture2D NormalMap : register(t6);
-SamplerState NormalSmp : register(s6);
+Texture2D NormalMap : register(t5);
+SamplerState NormalSmp : register(s5);
+
+#ifdef BINDLESS_MATERIAL
+///////////////////////////////////////////////////////////////////////////////
+// MaterialData structure
+///////////////////////////////////////////////////////////////////////////////
+struct MaterialData
+{
+    uint BaseColorMap; // x[XJ[}bv̔ԍł.
+    uint ORMMap; // ORM}bv̔ԍł.
+    uint NormalMap; // @}bv̔ԍł.
+    uint Reserved; // \̈ł.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CbDraw constant buffer
+///////////////////////////////////////////////////////////////////////////////
+cbuffer CbDraw : register(b3)
+{
+    uint DrawId; // `ԍł.
+    uint MaterialId; // }eAԍł (}eAe[u̓Y).
+};
+
+// }eAe[u.
+StructuredBuffer<MaterialData> Materials : register(t6);
+
+// \[Xpq[vŜ̃eNX`z (}eAe[u̔ԍŎQƂ܂).
+Texture2D Textures[] : register(t0, space1);
+
+//-----------------------------------------------------------------------------
+//      }eÃeNX`Tv܂.
+//-----------------------------------------------------------------------------
+float4 SampleBaseColorMap(float2 uv)
+{ return Textures[Materials[MaterialId].BaseColorMap].Sample(BaseColorSmp, uv); }
+
+float4 SampleORMMap(float2 uv)
+{ return Textures[Materials[MaterialId].ORMMap].Sample(ORMSmp, uv); }
+
+float4 SampleNormalMap(float2 uv)
+{ return Textures[Materials[MaterialId].NormalMap].Sample(NormalSmp, uv); }
+#else
+//-----------------------------------------------------------------------------
+//      }eÃeNX`Tv܂.
+//-----------------------------------------------------------------------------
+float4 SampleBaseColorMap(float2 uv)
+{ return BaseColorMap.Sample(BaseColorSmp, uv); }
+
+float4 SampleORMMap(float2 uv)
+{ return ORMMap.Sample(ORMSmp, uv); }
+
+float4 SampleNormalMap(float2 uv)
+{ return NormalMap.Sample(NormalSmp, uv); }
+#endif
 
 
 //-----------------------------------------------------------------------------
@@ -90,11 +159,34 @@ float3 GetSpecularDomiantDir(float3 N, float3 R, float roughness)
     return lerp(N, R, lerpFactor);
 }
 
+//-----------------------------------------------------------------------------
+//      ʒa֐(L2)]܂.
+//-----------------------------------------------------------------------------
+float3 EvaluateSH9(float3 N)
+{
+    float3 result = SHCoeffs[0].rgb * 0.282094792f;
+    result += SHCoeffs[1].rgb * (0.488602512f * N.y);
+    result += SHCoeffs[2].rgb * (0.488602512f * N.z);
+    result += SHCoeffs[3].rgb * (0.488602512f * N.x);
+    result += SHCoeffs[4].rgb * (1.092548431f * N.x * N.y);
+    result += SHCoeffs[5].rgb * (1.092548431f * N.y * N.z);
+    result += SHCoeffs[6].rgb * (0.315391565f * (3.0f * N.z * N.z - 1.0f));
+    result += SHCoeffs[7].rgb * (1.092548431f * N.x * N.z);
+    result += SHCoeffs[8].rgb * (0.546274215f * (N.x * N.x - N.y * N.y));
+    return max(result, 0.0f);
+}
+
 //-----------------------------------------------------------------------------
 //      fBt[YIBL]܂.
 //-----------------------------------------------------------------------------
 float3 EvaluateIBLDiffuse(float3 N)
 {
+    // WCPUŃRTC[uƏݍݍς݂Ȃ̂ŁCLDƓl
+    if (UseSHIrradiance)
+    {
+        return EvaluateSH9(N);
+    }
+
     // Lambert BRDFDFG͐ϕ1.0ƂȂ̂ŁCLD݂̂ԋpΗǂ
     return DiffuseLDMap.Sample(DiffuseLDSmp, N).rgb;
 }
@@ -141,6 +233,15 @@ float3 EvaluateIBLSpecular
 }
 
 
+//-----------------------------------------------------------------------------
+//      ArGgIN[WXyL[IN[W߂܂.
+//-----------------------------------------------------------------------------
+float ComputeSpecularOcclusion(float NdotV, float ao, float roughness)
+{
+    // Lagarde and de Rousiers, "Moving Frostbite to PBR".
+    return saturate(pow(NdotV + ao, exp2(-16.0f * roughness - 1.0f)) - 1.0f + ao);
+}
+
 //-----------------------------------------------------------------------------
 //      sNZVF[_̃CGg[|Cgł.
 //-----------------------------------------------------------------------------
@@ -149,22 +250,26 @@ PSOutput main(VSOutput input)
     PSOutput output = (PSOutput) 0;
 
     float3 V = normalize(input.WorldPos.xyz - CameraPosition);
-    float3 N = NormalMap.Sample(NormalSmp, input.TexCoord).xyz * 2.0f - 1.0f;
+    float3 N = SampleNormalMap(input.TexCoord).xyz * 2.0f - 1.0f;
     N = mul(input.InvTangentBasis, N);
     float3 R = normalize(reflect(V, N));
 
     float NV = saturate(dot(N, V));
 
-    float3 baseColor = BaseColorMap.Sample(BaseColorSmp, input.TexCoord).rgb;
-    float metallic = MetallicMap.Sample(MetallicSmp, input.TexCoord).r;
-    float roughness = RoughnessMap.Sample(RoughnessSmp, input.TexCoord).r;
+    float3 baseColor = SampleBaseColorMap(input.TexCoord).rgb;
+    float3 orm = SampleORMMap(input.TexCoord).rgb;
+    float ao = orm.r;
+    float roughness = orm.g;
+    float metallic = orm.b;
 
     float3 Kd = baseColor * (1.0f - metallic);
     float3 Ks = baseColor * metallic;
 
     float3 lit = 0;
-    lit += EvaluateIBLDiffuse(N) * Kd;
-    lit += EvaluateIBLSpecular(NV, N, R, Ks, roughness, TextureSize, MipCount);
+    lit += EvaluateIBLDiffuse(N) * Kd * ao;
+    lit += EvaluateIBLSpecular(NV, N, R, Ks, roughness, TextureSize, MipCount) * ComputeSpecularOcclusion(NV, ao, roughness);
+    lit += EvaluateClusteredLights(input.Position, input.WorldPos, N, -V, Kd, Ks, roughness);
+    lit += EvaluateSunLight(input.Position, input.WorldPos, N, -V, Kd, Ks, roughness);
 
     output.Color.rgb = lit * LightIntensity;
     output.Color.a = 1.0f;
@@ -0,0 +1,131 @@
+﻿#include "IndirectDraw.h"
+
+#include "Logger.h"
+
+IndirectDrawBuffer::IndirectDrawBuffer()
+	: m_pArgs(nullptr)
+	, m_MaxDrawCount(0)
+{
+}
+
+IndirectDrawBuffer::~IndirectDrawBuffer()
+{
+	Term();
+}
+
+bool IndirectDrawBuffer::Init(ID3D12Device* pDevice, ID3D12RootSignature* pRootSignature, uint32_t rootConstantIndex, uint32_t maxDrawCount)
+{
+	if (pDevice == nullptr || pRootSignature == nullptr || maxDrawCount == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	// コマンドシグネチャの生成 (並びは IndirectDrawArgs と一致させる)
+	{
+		D3D12_INDIRECT_ARGUMENT_DESC args[5] = {};
+		args[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+		args[0].VertexBuffer.Slot = 0;
+		args[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+		args[1].VertexBuffer.Slot = 1;
+		args[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+		args[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+		args[3].Constant.RootParameterIndex = rootConstantIndex;
+		args[3].Constant.DestOffsetIn32BitValues = 0;
+		args[3].Constant.Num32BitValuesToSet = IndirectDrawConstantCount;
+		args[4].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+		D3D12_COMMAND_SIGNATURE_DESC desc = {};
+		desc.ByteStride = sizeof(IndirectDrawArgs);
+		desc.NumArgumentDescs = _countof(args);
+		desc.pArgumentDescs = args;
+		desc.NodeMask = 0;
+
+		// ルート引数を変更する場合はルートシグネチャが必要
+		auto hr = pDevice->CreateCommandSignature(&desc, pRootSignature, IID_PPV_ARGS(m_pSignature.ReleaseAndGetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreateCommandSignature() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+	}
+
+	// 引数バッファの生成 (アップロードヒープは INDIRECT_ARGUMENT を含む GENERIC_READ のまま使える)
+	{
+		D3D12_HEAP_PROPERTIES props = {};
+		props.Type = D3D12_HEAP_TYPE_UPLOAD;
+		props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Width = uint64_t(sizeof(IndirectDrawArgs)) * maxDrawCount * Constants::MaxFrameCount;
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		auto hr = pDevice->CreateCommittedResource(
+			&props,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(m_pBuffer.ReleaseAndGetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreateCommittedResource() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		hr = m_pBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_pArgs));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Resource::Map() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+	}
+
+	m_MaxDrawCount = maxDrawCount;
+
+	return true;
+}
+
+void IndirectDrawBuffer::Term()
+{
+	if (m_pBuffer != nullptr && m_pArgs != nullptr)
+	{
+		m_pBuffer->Unmap(0, nullptr);
+	}
+
+	m_pArgs = nullptr;
+	m_pBuffer.Reset();
+	m_pSignature.Reset();
+	m_MaxDrawCount = 0;
+}
+
+IndirectDrawArgs* IndirectDrawBuffer::GetArgs(uint32_t frameIndex) const
+{
+	if (m_pArgs == nullptr || frameIndex >= Constants::MaxFrameCount)
+	{
+		return nullptr;
+	}
+
+	return m_pArgs + size_t(frameIndex) * m_MaxDrawCount;
+}
+
+void IndirectDrawBuffer::Execute(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex, uint32_t offset, uint32_t count)
+{
+	if (pCmd == nullptr || m_pSignature == nullptr || frameIndex >= Constants::MaxFrameCount || offset + count > m_MaxDrawCount)
+	{
+		return;
+	}
+
+	auto offsetInBytes = (uint64_t(frameIndex) * m_MaxDrawCount + offset) * sizeof(IndirectDrawArgs);
+
+	pCmd->ExecuteIndirect(m_pSignature.Get(), count, m_pBuffer.Get(), offsetInBytes, nullptr, 0);
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <cstdint>
+
+#include "ComPtr.h"
+#include "Constants.h"
+#include "IndirectDrawArgs.h"
+
+/// <summary>
+/// 間接描画のコマンドシグネチャと, フレームごとの引数バッファ (アップロードヒープ)
+/// </summary>
+class IndirectDrawBuffer
+{
+public:
+	IndirectDrawBuffer();
+	~IndirectDrawBuffer();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="pRootSignature">ルートシグネチャ (ルート定数の引数を含むもの)</param>
+	/// <param name="rootConstantIndex">描画番号を設定するルート定数の引数番号</param>
+	/// <param name="maxDrawCount">1フレームの最大描画数</param>
+	/// <returns>初期化に成功した場合はtrue</returns>
+	bool Init(ID3D12Device* pDevice, ID3D12RootSignature* pRootSignature, uint32_t rootConstantIndex, uint32_t maxDrawCount);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// フレームの引数レコードの書き込み先を取得する (マップしたまま保持している)
+	/// </summary>
+	/// <param name="frameIndex">フレーム番号</param>
+	IndirectDrawArgs* GetArgs(uint32_t frameIndex) const;
+
+	/// <summary>
+	/// 引数レコードの範囲を描画する
+	/// </summary>
+	/// <param name="pCmd">コマンドリスト</param>
+	/// <param name="frameIndex">フレーム番号</param>
+	/// <param name="offset">最初の引数レコードの番号</param>
+	/// <param name="count">引数レコードの数</param>
+	void Execute(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex, uint32_t offset, uint32_t count);
+
+	uint32_t GetMaxDrawCount() const { return m_MaxDrawCount; }
+
+private:
+	ComPtr<ID3D12CommandSignature>	m_pSignature;	// コマンドシグネチャ
+	ComPtr<ID3D12Resource>			m_pBuffer;		// 引数バッファ (フレームごとに最大描画数分)
+	IndirectDrawArgs*				m_pArgs;		// マップした先頭
+	uint32_t						m_MaxDrawCount;	// 1フレームの最大描画数
+
+	IndirectDrawBuffer(const IndirectDrawBuffer&) = delete;
+	void operator=(const IndirectDrawBuffer&) = delete;
+};
@@ -0,0 +1,97 @@
+﻿#include "IndirectDrawArgs.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "DrawSortKey.h"
+#include "ParallelFor.h"
+
+namespace
+{
+	// 並列化するスレッドあたりの最小の描画数
+	constexpr size_t MinDrawsPerThread = 4096;
+}
+
+void BuildIndirectDrawBuckets(const uint64_t* pKeys, size_t count, std::vector<IndirectDrawBucket>& buckets, bool splitMaterial)
+{
+	buckets.clear();
+
+	// パス, パイプライン (, マテリアル) のフィールド (キーの上位) が同じ間は同じ範囲にする
+	const auto shift = splitMaterial ? DrawKeyMaterialShift : DrawKeyPipelineShift;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (i == 0 || (pKeys[i] >> shift) != (pKeys[i - 1] >> shift))
+		{
+			auto fields = DecodeDrawKey(pKeys[i]);
+
+			IndirectDrawBucket bucket;
+			bucket.Pipeline = fields.Pipeline;
+			bucket.Material = fields.Material;
+			bucket.FirstMesh = fields.Mesh;
+			bucket.Offset = uint32_t(i);
+			bucket.Count = 0;
+			buckets.push_back(bucket);
+		}
+
+		buckets.back().Count++;
+	}
+}
+
+void WriteIndirectDrawArgs(
+	const uint64_t* pKeys,
+	size_t begin,
+	size_t end,
+	const IndirectDrawSource* pSources,
+	IndirectDrawArgs* pArgs)
+{
+	for (auto i = begin; i < end; ++i)
+	{
+		auto mesh = GetDrawKeyField(pKeys[i], DrawKeyMeshShift, DrawKeyMeshBits);
+		const auto& source = pSources[mesh];
+
+		// アップロードヒープへは読み戻さずに1レコード分をまとめて書き込む (パディングも0にする)
+		IndirectDrawArgs args = {};
+		args.VertexBuffer = source.VertexBuffer;
+		args.InstanceBuffer = source.InstanceBuffer;
+		args.IndexBuffer = source.IndexBuffer;
+		args.DrawId = mesh;
+		args.MaterialId = source.MaterialId;
+		args.Draw.IndexCountPerInstance = source.IndexCount;
+		args.Draw.InstanceCount = source.InstanceCount;
+		args.Draw.StartIndexLocation = 0;
+		args.Draw.BaseVertexLocation = 0;
+		args.Draw.StartInstanceLocation = 0;
+
+		memcpy(&pArgs[i], &args, sizeof(args));
+	}
+}
+
+void WriteIndirectDrawArgsParallel(
+	const uint64_t* pKeys,
+	size_t count,
+	const IndirectDrawSource* pSources,
+	IndirectDrawArgs* pArgs,
+	uint32_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = GetWorkerThreadCount();
+	}
+
+	auto chunkCount = uint32_t(std::min<size_t>(threadCount, (count + MinDrawsPerThread - 1) / MinDrawsPerThread));
+	if (chunkCount <= 1)
+	{
+		WriteIndirectDrawArgs(pKeys, 0, count, pSources, pArgs);
+		return;
+	}
+
+	const auto chunkSize = (count + chunkCount - 1) / chunkCount;
+
+	ParallelFor(0, chunkCount, [&](uint32_t chunk)
+	{
+		auto begin = std::min(size_t(chunk) * chunkSize, count);
+		auto end = std::min(begin + chunkSize, count);
+		WriteIndirectDrawArgs(pKeys, begin, end, pSources, pArgs);
+	}, chunkCount);
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// 間接描画の引数レコード (コマンドシグネチャの引数の並びと一致させる)
+/// 頂点/インスタンス/インデックスバッファビュー, ルート定数 (描画番号, マテリアル番号), 描画引数の順に並べる
+/// </summary>
+struct IndirectDrawArgs
+{
+	D3D12_VERTEX_BUFFER_VIEW		VertexBuffer;	// 頂点バッファビュー (スロット0)
+	D3D12_VERTEX_BUFFER_VIEW		InstanceBuffer;	// インスタンスバッファビュー (スロット1)
+	D3D12_INDEX_BUFFER_VIEW			IndexBuffer;	// インデックスバッファビュー
+	uint32_t						DrawId;			// ルート定数 (描画番号)
+	uint32_t						MaterialId;		// ルート定数 (マテリアル番号. バインドレスの場合に参照する)
+	D3D12_DRAW_INDEXED_ARGUMENTS	Draw;			// 描画引数
+};
+
+// 末尾の4バイトはアラインメントのパディング (ByteStride に含める)
+static_assert(sizeof(IndirectDrawArgs) == 80, "IndirectDrawArgs layout mismatch.");
+
+// ルート定数で設定する値の数 (描画番号, マテリアル番号)
+constexpr uint32_t IndirectDrawConstantCount = 2;
+
+/// <summary>
+/// メッシュごとの描画の元データ
+/// </summary>
+struct IndirectDrawSource
+{
+	D3D12_VERTEX_BUFFER_VIEW	VertexBuffer = {};
+	D3D12_VERTEX_BUFFER_VIEW	InstanceBuffer = {};
+	D3D12_INDEX_BUFFER_VIEW		IndexBuffer = {};
+	uint32_t					IndexCount = 0;
+	uint32_t					InstanceCount = 1;
+	uint32_t					MaterialId = 0;
+};
+
+/// <summary>
+/// 1回の ExecuteIndirect で描画する範囲 (パス, パイプライン, マテリアルが同じ描画のまとまり)
+/// </summary>
+struct IndirectDrawBucket
+{
+	uint32_t	Pipeline = 0;	// パイプラインステートの番号
+	uint32_t	Material = 0;	// マテリアルのソート用の番号
+	uint32_t	FirstMesh = 0;	// 最初の描画のメッシュ番号 (ディスクリプタテーブルの取得に使う)
+	uint32_t	Offset = 0;		// 最初の引数レコードの番号
+	uint32_t	Count = 0;		// 引数レコードの数
+};
+
+/// <summary>
+/// ソート済みの描画キーを, パス, パイプライン, マテリアルが同じ連続した範囲に分ける
+/// </summary>
+/// <param name="pKeys">ソート済みの描画キー (DrawSortKey.h)</param>
+/// <param name="count">キーの数</param>
+/// <param name="buckets">範囲の格納先</param>
+/// <param name="splitMaterial">マテリアルでも分ける場合はtrue (バインドレスの場合はルート定数で切り替えるので不要)</param>
+void BuildIndirectDrawBuckets(const uint64_t* pKeys, size_t count, std::vector<IndirectDrawBucket>& buckets, bool splitMaterial = true);
+
+/// <summary>
+/// [begin, end) の描画キーの引数レコードを書き込む
+/// 範囲が重ならなければ複数のスレッドから呼び出してよい
+/// </summary>
+/// <param name="pKeys">描画キー</param>
+/// <param name="begin">開始番号</param>
+/// <param name="end">終了番号 (含まない)</param>
+/// <param name="pSources">メッシュごとの元データ (キーのメッシュ番号で参照する)</param>
+/// <param name="pArgs">引数レコードの書き込み先 (キーと同じ番号に書き込む)</param>
+void WriteIndirectDrawArgs(
+	const uint64_t* pKeys,
+	size_t begin,
+	size_t end,
+	const IndirectDrawSource* pSources,
+	IndirectDrawArgs* pArgs);
+
+/// <summary>
+/// 引数レコードをワーカースレッドで分担して書き込む
+/// </summary>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+void WriteIndirectDrawArgsParallel(
+	const uint64_t* pKeys,
+	size_t count,
+	const IndirectDrawSource* pSources,
+	IndirectDrawArgs* pArgs,
+	uint32_t threadCount = 0);
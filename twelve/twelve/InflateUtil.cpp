@@ -0,0 +1,518 @@
+﻿#include "InflateUtil.h"
+
+#include <cstring>
+
+namespace
+{
+	const uint32_t MaxBits = 15;		// 符号長の最大値
+	const uint32_t FastBits = 9;		// テーブル引きで復号する符号長の最大値
+	const uint32_t MaxLitLenCodes = 288;
+	const uint32_t MaxDistCodes = 32;
+
+	const uint16_t LengthBase[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t LengthExtra[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DistBase[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DistExtra[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	/// <summary>
+	/// LSBから順に読み出すビットリーダー
+	/// </summary>
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* pSrc, size_t size)
+			: m_pCur(pSrc)
+			, m_pEnd(pSrc + size)
+			, m_Buffer(0)
+			, m_Count(0)
+			, m_Overrun(0)
+		{
+		}
+
+		void Refill()
+		{
+			while (m_Count <= 56)
+			{
+				uint64_t value = 0;
+				if (m_pCur < m_pEnd)
+				{
+					value = *m_pCur++;
+				}
+				else
+				{
+					// 末尾の先読みは0で埋める
+					m_Overrun++;
+				}
+
+				m_Buffer |= value << m_Count;
+				m_Count += 8;
+			}
+		}
+
+		uint32_t Peek(uint32_t bits) const
+		{
+			return uint32_t(m_Buffer & ((uint64_t(1) << bits) - 1));
+		}
+
+		void Consume(uint32_t bits)
+		{
+			m_Buffer >>= bits;
+			m_Count -= bits;
+		}
+
+		uint32_t Get(uint32_t bits)
+		{
+			if (m_Count < bits)
+			{
+				Refill();
+			}
+
+			auto value = Peek(bits);
+			Consume(bits);
+			return value;
+		}
+
+		void AlignToByte()
+		{
+			Consume(m_Count & 7);
+		}
+
+		/// <summary>
+		/// バイト境界に揃えた状態からバイト列をそのまま読み出す
+		/// </summary>
+		bool CopyBytes(uint8_t* pDst, size_t size)
+		{
+			// ビットバッファに残っている分を先に読み出す
+			while (size > 0 && m_Count >= 8)
+			{
+				*pDst++ = uint8_t(Get(8));
+				size--;
+			}
+
+			if (IsOverrun() || size_t(m_pEnd - m_pCur) < size)
+			{
+				return false;
+			}
+
+			memcpy(pDst, m_pCur, size);
+			m_pCur += size;
+			return true;
+		}
+
+		uint64_t GetBuffer() const
+		{
+			return m_Buffer;
+		}
+
+		/// <summary>
+		/// 入力の終端を超えて読み進めたかどうか
+		/// </summary>
+		bool IsOverrun() const
+		{
+			// 先読み分を除いて, 実際に消費したビットが入力を超えているかを判定する
+			return m_Overrun * 8 > m_Count;
+		}
+
+	private:
+		const uint8_t*	m_pCur;
+		const uint8_t*	m_pEnd;
+		uint64_t		m_Buffer;
+		uint32_t		m_Count;
+		uint32_t		m_Overrun;
+	};
+
+	/// <summary>
+	/// 正準ハフマン符号の復号テーブル
+	/// 短い符号は FastBits ビットのテーブルで一度に引き, 長い符号のみ1ビットずつ復号する
+	/// </summary>
+	struct HuffmanTable
+	{
+		uint16_t Fast[1 << FastBits];		// (シンボル << 4) | 符号長 (0は該当なし)
+		uint16_t Count[MaxBits + 1];		// 符号長ごとのシンボル数
+		uint16_t Symbol[MaxLitLenCodes];	// 符号順に並べたシンボル
+
+		bool Build(const uint8_t* lengths, uint32_t count)
+		{
+			memset(Fast, 0, sizeof(Fast));
+			memset(Count, 0, sizeof(Count));
+
+			for (auto i = 0u; i < count; ++i)
+			{
+				Count[lengths[i]]++;
+			}
+			Count[0] = 0;
+
+			// 符号の過剰割り当てを検出する (不完全な符号は許容する)
+			int left = 1;
+			for (auto len = 1u; len <= MaxBits; ++len)
+			{
+				left <<= 1;
+				left -= Count[len];
+				if (left < 0)
+				{
+					return false;
+				}
+			}
+
+			uint16_t offsets[MaxBits + 2] = {};
+			for (auto len = 1u; len <= MaxBits; ++len)
+			{
+				offsets[len + 1] = offsets[len] + Count[len];
+			}
+
+			uint32_t nextCode[MaxBits + 1] = {};
+			uint32_t code = 0;
+			for (auto len = 1u; len <= MaxBits; ++len)
+			{
+				code = (code + Count[len - 1]) << 1;
+				nextCode[len] = code;
+			}
+
+			for (auto i = 0u; i < count; ++i)
+			{
+				auto len = lengths[i];
+				if (len == 0)
+				{
+					continue;
+				}
+
+				Symbol[offsets[len]++] = uint16_t(i);
+
+				// ビット列はLSBから読むため, 符号を反転してテーブルに登録する
+				auto c = nextCode[len]++;
+				if (len <= FastBits)
+				{
+					uint32_t reversed = 0;
+					for (auto b = 0u; b < len; ++b)
+					{
+						reversed |= ((c >> b) & 1) << (len - 1 - b);
+					}
+
+					for (auto j = reversed; j < (1u << FastBits); j += (1u << len))
+					{
+						Fast[j] = uint16_t((i << 4) | len);
+					}
+				}
+			}
+
+			return true;
+		}
+
+		int Decode(BitReader& reader) const
+		{
+			reader.Refill();
+
+			auto entry = Fast[reader.Peek(FastBits)];
+			if (entry != 0)
+			{
+				reader.Consume(entry & 15);
+				return entry >> 4;
+			}
+
+			// 長い符号は正準符号の性質を使って1ビットずつ復号する
+			auto bits = reader.GetBuffer();
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (auto len = 1u; len <= MaxBits; ++len)
+			{
+				code |= int((bits >> (len - 1)) & 1);
+				int count = Count[len];
+				if (code - first < count)
+				{
+					reader.Consume(len);
+					return Symbol[index + (code - first)];
+				}
+
+				index += count;
+				first += count;
+				first <<= 1;
+				code <<= 1;
+			}
+
+			return -1;
+		}
+	};
+
+	/// <summary>
+	/// 固定ハフマン符号のテーブルを取得する
+	/// </summary>
+	void GetFixedTables(const HuffmanTable*& pLitLen, const HuffmanTable*& pDist)
+	{
+		struct FixedTables
+		{
+			HuffmanTable LitLen;
+			HuffmanTable Dist;
+
+			FixedTables()
+			{
+				uint8_t lengths[MaxLitLenCodes];
+				for (auto i = 0; i < 144; ++i) { lengths[i] = 8; }
+				for (auto i = 144; i < 256; ++i) { lengths[i] = 9; }
+				for (auto i = 256; i < 280; ++i) { lengths[i] = 7; }
+				for (auto i = 280; i < 288; ++i) { lengths[i] = 8; }
+				LitLen.Build(lengths, MaxLitLenCodes);
+
+				for (auto i = 0u; i < MaxDistCodes; ++i) { lengths[i] = 5; }
+				Dist.Build(lengths, 30);
+			}
+		};
+
+		static const FixedTables tables;
+		pLitLen = &tables.LitLen;
+		pDist = &tables.Dist;
+	}
+
+	/// <summary>
+	/// 動的ハフマン符号のテーブルを読み込む
+	/// </summary>
+	bool ReadDynamicTables(BitReader& reader, HuffmanTable& litLen, HuffmanTable& dist)
+	{
+		static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		auto hlit = reader.Get(5) + 257;
+		auto hdist = reader.Get(5) + 1;
+		auto hclen = reader.Get(4) + 4;
+
+		if (hlit > 286 || hdist > 30)
+		{
+			return false;
+		}
+
+		uint8_t codeLengths[19] = {};
+		for (auto i = 0u; i < hclen; ++i)
+		{
+			codeLengths[order[i]] = uint8_t(reader.Get(3));
+		}
+
+		HuffmanTable lenTable;
+		if (!lenTable.Build(codeLengths, 19))
+		{
+			return false;
+		}
+
+		uint8_t lengths[MaxLitLenCodes + MaxDistCodes] = {};
+		auto index = 0u;
+		while (index < hlit + hdist)
+		{
+			auto sym = lenTable.Decode(reader);
+			if (sym < 0)
+			{
+				return false;
+			}
+
+			if (sym < 16)
+			{
+				lengths[index++] = uint8_t(sym);
+				continue;
+			}
+
+			uint8_t value = 0;
+			uint32_t repeat = 0;
+			if (sym == 16)
+			{
+				if (index == 0)
+				{
+					return false;
+				}
+
+				value = lengths[index - 1];
+				repeat = 3 + reader.Get(2);
+			}
+			else if (sym == 17)
+			{
+				repeat = 3 + reader.Get(3);
+			}
+			else
+			{
+				repeat = 11 + reader.Get(7);
+			}
+
+			if (index + repeat > hlit + hdist)
+			{
+				return false;
+			}
+
+			while (repeat-- > 0)
+			{
+				lengths[index++] = value;
+			}
+		}
+
+		// ブロック終端の符号が無い場合は不正
+		if (lengths[256] == 0)
+		{
+			return false;
+		}
+
+		return litLen.Build(lengths, hlit) && dist.Build(lengths + hlit, hdist);
+	}
+
+	/// <summary>
+	/// ハフマン符号化されたブロックを展開する
+	/// </summary>
+	bool InflateBlock(BitReader& reader, const HuffmanTable& litLen, const HuffmanTable& dist, uint8_t* pDst, size_t dstSize, size_t& pos)
+	{
+		for (;;)
+		{
+			auto sym = litLen.Decode(reader);
+			if (sym < 0)
+			{
+				return false;
+			}
+
+			if (sym < 256)
+			{
+				if (pos >= dstSize)
+				{
+					return false;
+				}
+
+				pDst[pos++] = uint8_t(sym);
+				continue;
+			}
+
+			if (sym == 256)
+			{
+				return !reader.IsOverrun();
+			}
+
+			sym -= 257;
+			if (sym >= 29)
+			{
+				return false;
+			}
+
+			auto length = size_t(LengthBase[sym]) + reader.Get(LengthExtra[sym]);
+
+			auto distSym = dist.Decode(reader);
+			if (distSym < 0 || distSym >= 30)
+			{
+				return false;
+			}
+
+			auto distance = size_t(DistBase[distSym]) + reader.Get(DistExtra[distSym]);
+			if (distance > pos || pos + length > dstSize)
+			{
+				return false;
+			}
+
+			// 重複する範囲のコピーがあるため1バイトずつ複製する
+			auto pFrom = pDst + pos - distance;
+			auto pTo = pDst + pos;
+			if (distance >= length)
+			{
+				memcpy(pTo, pFrom, length);
+			}
+			else
+			{
+				for (size_t i = 0; i < length; ++i)
+				{
+					pTo[i] = pFrom[i];
+				}
+			}
+
+			pos += length;
+		}
+	}
+}
+
+bool Inflate(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize, bool hasZlibHeader)
+{
+	if (pSrc == nullptr || pDst == nullptr)
+	{
+		return false;
+	}
+
+	if (hasZlibHeader)
+	{
+		if (srcSize < 2)
+		{
+			return false;
+		}
+
+		auto cmf = pSrc[0];
+		auto flg = pSrc[1];
+
+		// 圧縮方式はDeflateのみ. プリセット辞書は非対応
+		if ((cmf & 0x0f) != 8 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20) != 0)
+		{
+			return false;
+		}
+
+		pSrc += 2;
+		srcSize -= 2;
+	}
+
+	BitReader reader(pSrc, srcSize);
+	HuffmanTable litLen;
+	HuffmanTable dist;
+	size_t pos = 0;
+
+	for (;;)
+	{
+		auto final = reader.Get(1);
+		auto type = reader.Get(2);
+
+		if (type == 0)
+		{
+			// 無圧縮ブロック
+			reader.AlignToByte();
+			auto len = reader.Get(16);
+			auto nlen = reader.Get(16);
+			if ((len ^ 0xffff) != nlen || pos + len > dstSize)
+			{
+				return false;
+			}
+
+			if (!reader.CopyBytes(pDst + pos, len))
+			{
+				return false;
+			}
+
+			pos += len;
+		}
+		else if (type == 1)
+		{
+			const HuffmanTable* pLitLen = nullptr;
+			const HuffmanTable* pDist = nullptr;
+			GetFixedTables(pLitLen, pDist);
+
+			if (!InflateBlock(reader, *pLitLen, *pDist, pDst, dstSize, pos))
+			{
+				return false;
+			}
+		}
+		else if (type == 2)
+		{
+			if (!ReadDynamicTables(reader, litLen, dist))
+			{
+				return false;
+			}
+
+			if (!InflateBlock(reader, litLen, dist, pDst, dstSize, pos))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			return false;
+		}
+
+		if (final != 0)
+		{
+			break;
+		}
+	}
+
+	return pos == dstSize;
+}
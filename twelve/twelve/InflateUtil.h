@@ -0,0 +1,16 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Deflate形式 (RFC 1951) で圧縮されたデータを展開する
+/// 展開後のサイズが既知のデータ (EXRのZIP圧縮ブロックなど) を対象とし, 出力バッファを使い切った時点で終了する
+/// </summary>
+/// <param name="pSrc">圧縮データ</param>
+/// <param name="srcSize">圧縮データのサイズ</param>
+/// <param name="pDst">展開先</param>
+/// <param name="dstSize">展開先のサイズ</param>
+/// <param name="hasZlibHeader">zlib形式 (RFC 1950) のヘッダが付いている場合はtrue</param>
+/// <returns>展開先をちょうど埋めた場合はtrue</returns>
+bool Inflate(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize, bool hasZlibHeader = true);
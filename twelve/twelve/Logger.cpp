@@ -9,7 +9,11 @@
 //-----------------------------------------------------------------------------
 #include <cstdio>
 #include <cstdarg>
+#include <cstring>
+
+#if defined(_WIN32)
 #include <Windows.h>
+#endif
 
 
 //-----------------------------------------------------------------------------
@@ -22,12 +26,21 @@ void OutputLog(const char* format, ...)
 	va_list arg;
 
 	va_start(arg, format);
+#if defined(_WIN32)
 	vsprintf_s(msg, format, arg);
+#else
+	vsnprintf(msg, sizeof(msg), format, arg);
+#endif
 	va_end(arg);
 
+#if defined(_WIN32)
 	// コンソールに出力.
 	printf_s("%s", msg);
 
 	// Visual Studioの出力ウィンドウにも表示.
 	OutputDebugStringA(msg);
+#else
+	// コンソールに出力.
+	printf("%s", msg);
+#endif
 }
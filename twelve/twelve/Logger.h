@@ -22,6 +22,10 @@ void OutputLog(const char* format, ...);
 #endif
 #endif//DLOG
 
+#ifndef ILOG
+#define ILOG( x, ... ) OutputLog( x "\n", ##__VA_ARGS__ )
+#endif//ILOG
+
 #ifndef ELOG
 #define ELOG( x, ... ) OutputLog( "[File : %s, Line : %d] " x "\n", __FILE__, __LINE__, ##__VA_ARGS__ )
 #endif//ELOG
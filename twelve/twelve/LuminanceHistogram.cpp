@@ -0,0 +1,280 @@
+﻿#include "LuminanceHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+#include "ParallelFor.h"
+
+namespace
+{
+	// 輝度の係数 (BT.709, 合計が256になるように丸めた値)
+	const uint32_t LumaWeightR = 54;
+	const uint32_t LumaWeightG = 183;
+	const uint32_t LumaWeightB = 19;
+
+	// チャンネルの上限 (固定小数にしたときに輝度が32bitに収まるようにする)
+	const float MaxChannelValue = 4096.0f;
+
+	/// <summary>
+	/// チャンネルを 1/1024 単位の固定小数に変換する
+	/// UNORMから変換した値が数ULPずれても, 四捨五入の境界からは十分離れているので結果は変わらない
+	/// </summary>
+	uint32_t QuantizeChannel(float value)
+	{
+		// NaNと負の値は0にする (HLSLの max(value, 0) と同じ)
+		if (!(value > 0.0f))
+		{
+			return 0;
+		}
+
+		value = std::min(value, MaxChannelValue);
+		return uint32_t(value * 1024.0f + 0.5f);
+	}
+
+	/// <summary>
+	/// 最上位ビットの位置を求める (HLSLの firstbithigh と同じ, value > 0)
+	/// </summary>
+	uint32_t FindHighestBit(uint32_t value)
+	{
+		uint32_t result = 0;
+		while (value >>= 1)
+		{
+			result++;
+		}
+		return result;
+	}
+}
+
+uint32_t CalcLuminanceHistogramBin(float r, float g, float b)
+{
+	auto luma = QuantizeChannel(r) * LumaWeightR
+		+ QuantizeChannel(g) * LumaWeightG
+		+ QuantizeChannel(b) * LumaWeightB;
+
+	if (luma == 0)
+	{
+		return 0;
+	}
+
+	// 整数部は最上位ビットの位置, 小数部はその下の3ビットで log2 を近似する
+	auto e = FindHighestBit(luma);
+	auto m = (e >= 3) ? (luma >> (e - 3)) & 7 : (luma << (3 - e)) & 7;
+
+	return 1 + e * LuminanceHistogramBinsPerStop + m;
+}
+
+float CalcLuminanceHistogramBinLog2(uint32_t bin)
+{
+	// 輝度0のピクセルは最も暗いビンの1段下として扱う
+	if (bin == 0)
+	{
+		return -float(LuminanceHistogramLog2Scale) - 1.0f;
+	}
+
+	auto e = (bin - 1) / LuminanceHistogramBinsPerStop;
+	auto m = (bin - 1) % LuminanceHistogramBinsPerStop;
+	auto mantissa = 1.0 + (m + 0.5) / LuminanceHistogramBinsPerStop;
+
+	return float(e + std::log2(mantissa) - LuminanceHistogramLog2Scale);
+}
+
+void BuildLuminanceHistogram(const CpuImage& image, std::vector<uint32_t>& histogram, uint32_t threadCount)
+{
+	histogram.assign(LuminanceHistogramBinCount, 0);
+	if (image.Width == 0 || image.Height == 0)
+	{
+		return;
+	}
+
+	if (threadCount == 0)
+	{
+		threadCount = GetWorkerThreadCount();
+	}
+
+	// 行をブロックに分けてブロックごとにヒストグラムを求め, 最後に合計する (整数の加算なので順序に依存しない)
+	auto blockCount = std::min(image.Height, threadCount * 4);
+	std::vector<std::vector<uint32_t>> partials(blockCount);
+
+	ParallelFor(0, blockCount, [&](uint32_t block)
+	{
+		auto& partial = partials[block];
+		partial.assign(LuminanceHistogramBinCount, 0);
+
+		auto beginY = uint64_t(image.Height) * block / blockCount;
+		auto endY = uint64_t(image.Height) * (block + 1) / blockCount;
+
+		for (auto y = uint32_t(beginY); y < uint32_t(endY); ++y)
+		{
+			auto row = image.GetRow(y);
+			for (auto x = 0u; x < image.Width; ++x)
+			{
+				partial[CalcLuminanceHistogramBin(row[x].x, row[x].y, row[x].z)]++;
+			}
+		}
+	}, threadCount);
+
+	for (const auto& partial : partials)
+	{
+		for (auto i = 0u; i < LuminanceHistogramBinCount; ++i)
+		{
+			histogram[i] += partial[i];
+		}
+	}
+}
+
+float CalcHistogramAverageLog2(const uint32_t* histogram, const AutoExposureParam& param)
+{
+	if (histogram == nullptr)
+	{
+		return 0.0f;
+	}
+
+	uint64_t total = 0;
+	for (auto i = 0u; i < LuminanceHistogramBinCount; ++i)
+	{
+		total += histogram[i];
+	}
+
+	if (total == 0)
+	{
+		return 0.0f;
+	}
+
+	auto lowPercent = std::clamp(double(param.LowPercent), 0.0, 1.0);
+	auto highPercent = std::clamp(double(param.HighPercent), lowPercent, 1.0);
+	auto low = double(total) * lowPercent;
+	auto high = double(total) * highPercent;
+
+	// [low, high) に入るピクセルだけで平均する (ビンの一部が範囲に入る場合はその分だけ重みを付ける)
+	double sum = 0.0;
+	double weight = 0.0;
+	double accum = 0.0;
+	uint32_t lastBin = 0;
+
+	for (auto i = 0u; i < LuminanceHistogramBinCount; ++i)
+	{
+		if (histogram[i] == 0)
+		{
+			continue;
+		}
+
+		auto begin = accum;
+		auto end = accum + double(histogram[i]);
+		accum = end;
+
+		auto w = std::min(end, high) - std::max(begin, low);
+		if (w > 0.0)
+		{
+			sum += w * CalcLuminanceHistogramBinLog2(i);
+			weight += w;
+		}
+
+		if (begin <= low)
+		{
+			lastBin = i;
+		}
+	}
+
+	// 範囲の幅が0の場合は下限の位置のビンを使う
+	if (weight <= 0.0)
+	{
+		return CalcLuminanceHistogramBinLog2(lastBin);
+	}
+
+	return float(sum / weight);
+}
+
+float CalcTargetExposure(float averageLog2, const AutoExposureParam& param)
+{
+	auto log2Exposure = std::log2(double(param.KeyValue)) - double(averageLog2);
+	log2Exposure = std::clamp(log2Exposure, double(param.MinLog2Exposure), double(param.MaxLog2Exposure));
+	return float(std::exp2(log2Exposure));
+}
+
+float AdaptExposure(float current, float target, float deltaTime, const AutoExposureParam& param)
+{
+	if (!(current > 0.0f))
+	{
+		return target;
+	}
+
+	auto currentLog2 = std::log2(double(current));
+	auto targetLog2 = std::log2(double(target));
+
+	auto speed = (targetLog2 > currentLog2) ? double(param.SpeedUp) : double(param.SpeedDown);
+	auto t = 1.0 - std::exp(-std::max(double(deltaTime), 0.0) * speed);
+
+	return float(std::exp2(currentLog2 + (targetLog2 - currentLog2) * t));
+}
+
+bool CompareLuminanceHistogram
+(
+	const CpuImage& image,
+	const uint32_t* captured,
+	const AutoExposureParam& param,
+	AutoExposureReport& report
+)
+{
+	report = AutoExposureReport();
+
+	if (captured == nullptr)
+	{
+		return false;
+	}
+
+	std::vector<uint32_t> reference;
+	BuildLuminanceHistogram(image, reference);
+
+	for (auto i = 0u; i < LuminanceHistogramBinCount; ++i)
+	{
+		auto diff = (reference[i] > captured[i]) ? reference[i] - captured[i] : captured[i] - reference[i];
+		if (diff != 0)
+		{
+			report.MismatchBins++;
+			report.MaxCountDiff = std::max(report.MaxCountDiff, uint64_t(diff));
+		}
+
+		report.PixelCount += reference[i];
+	}
+
+	report.AverageLog2 = CalcHistogramAverageLog2(reference.data(), param);
+	report.TargetExposure = CalcTargetExposure(report.AverageLog2, param);
+
+	return report.MismatchBins == 0;
+}
+
+bool SaveLuminanceHistogram(const wchar_t* path, const uint32_t* histogram)
+{
+	if (path == nullptr || histogram == nullptr)
+	{
+		return false;
+	}
+
+	std::ofstream stream(std::filesystem::path(path), std::ios::binary);
+	if (!stream)
+	{
+		return false;
+	}
+
+	stream.write(reinterpret_cast<const char*>(histogram), std::streamsize(LuminanceHistogramBinCount * sizeof(uint32_t)));
+	return bool(stream);
+}
+
+bool LoadLuminanceHistogram(const wchar_t* path, std::vector<uint32_t>& histogram)
+{
+	if (path == nullptr)
+	{
+		return false;
+	}
+
+	std::ifstream stream(std::filesystem::path(path), std::ios::binary);
+	if (!stream)
+	{
+		return false;
+	}
+
+	histogram.resize(LuminanceHistogramBinCount);
+	return bool(stream.read(reinterpret_cast<char*>(histogram.data()), std::streamsize(histogram.size() * sizeof(uint32_t))));
+}
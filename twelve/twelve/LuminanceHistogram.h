@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CubeMapImage.h"
+
+/// <summary>
+/// 輝度ヒストグラムのビン数 (LuminanceHistogramCS.hlsl と同じ)
+/// </summary>
+static const uint32_t LuminanceHistogramBinCount = 256;
+
+/// <summary>
+/// ヒストグラムの1段 (輝度2倍) あたりのビン数
+/// </summary>
+static const uint32_t LuminanceHistogramBinsPerStop = 8;
+
+/// <summary>
+/// 輝度を整数化するときのスケール (log2). ビン1の下限の輝度は 2^-LuminanceHistogramLog2Scale になる
+/// </summary>
+static const int LuminanceHistogramLog2Scale = 18;
+
+/// <summary>
+/// 自動露出の設定
+/// </summary>
+struct AutoExposureParam
+{
+	float	LowPercent = 0.5f;			// 平均から除外する暗い側の割合
+	float	HighPercent = 0.95f;		// 平均に含める明るい側の上限の割合
+	float	KeyValue = 0.18f;			// 平均輝度を合わせる値 (中間グレー)
+	float	MinLog2Exposure = -8.0f;	// 露出の下限 (log2)
+	float	MaxLog2Exposure = 8.0f;		// 露出の上限 (log2)
+	float	SpeedUp = 3.0f;				// 明るくする方向の順応速度 [1/s]
+	float	SpeedDown = 1.0f;			// 暗くする方向の順応速度 [1/s]
+};
+
+/// <summary>
+/// キャプチャしたフレームの検証結果
+/// </summary>
+struct AutoExposureReport
+{
+	uint64_t	PixelCount = 0;			// ピクセル数
+	uint32_t	MismatchBins = 0;		// GPUとCPUでカウントが異なるビンの数
+	uint64_t	MaxCountDiff = 0;		// ビンのカウントの最大差
+	float		AverageLog2 = 0.0f;		// 平均輝度 (log2)
+	float		TargetExposure = 1.0f;	// 平均輝度から求めた露出
+};
+
+/// <summary>
+/// 線形RGBからヒストグラムのビン番号を求める (LuminanceHistogramCS.hlsl と同じ)
+/// 各チャンネルを固定小数 (1/1024単位, 四捨五入) にしてから整数演算だけで輝度とその log2 を求めるので,
+/// 入力の値が同じであればGPUとCPUで必ず同じビンになる
+/// ビン0は輝度0, ビン b (>= 1) は log2(輝度) が (b - 1) / 8 - 18 付近のピクセル
+/// </summary>
+/// <param name="r">赤</param>
+/// <param name="g">緑</param>
+/// <param name="b">青</param>
+/// <returns>ビン番号</returns>
+uint32_t CalcLuminanceHistogramBin(float r, float g, float b);
+
+/// <summary>
+/// ビンの中央の輝度 (log2) を求める
+/// </summary>
+/// <param name="bin">ビン番号</param>
+/// <returns>輝度 (log2)</returns>
+float CalcLuminanceHistogramBinLog2(uint32_t bin);
+
+/// <summary>
+/// 画像の輝度ヒストグラムを求める (GPU版の基準実装)
+/// </summary>
+/// <param name="image">シーンの線形カラー</param>
+/// <param name="histogram">ヒストグラムの格納先 (LuminanceHistogramBinCount 個)</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+void BuildLuminanceHistogram(const CpuImage& image, std::vector<uint32_t>& histogram, uint32_t threadCount = 0);
+
+/// <summary>
+/// ヒストグラムの暗い側と明るい側を除外した平均輝度 (log2) を求める
+/// </summary>
+/// <param name="histogram">ヒストグラム (LuminanceHistogramBinCount 個)</param>
+/// <param name="param">自動露出の設定</param>
+/// <returns>平均輝度 (log2). ピクセルがない場合は0</returns>
+float CalcHistogramAverageLog2(const uint32_t* histogram, const AutoExposureParam& param);
+
+/// <summary>
+/// 平均輝度から目標の露出を求める
+/// </summary>
+/// <param name="averageLog2">平均輝度 (log2)</param>
+/// <param name="param">自動露出の設定</param>
+/// <returns>露出 (シーンのカラーに乗算する値)</returns>
+float CalcTargetExposure(float averageLog2, const AutoExposureParam& param);
+
+/// <summary>
+/// 露出を目標に向けて時間的に順応させる (log2 空間で指数的に近づける)
+/// </summary>
+/// <param name="current">現在の露出</param>
+/// <param name="target">目標の露出</param>
+/// <param name="deltaTime">経過時間 [s]</param>
+/// <param name="param">自動露出の設定</param>
+/// <returns>順応後の露出</returns>
+float AdaptExposure(float current, float target, float deltaTime, const AutoExposureParam& param);
+
+/// <summary>
+/// 画像から求めたヒストグラムを, 同じ画像からGPUが求めたヒストグラムと比較する
+/// </summary>
+/// <param name="image">シーンカラーの線形カラー</param>
+/// <param name="captured">GPUのヒストグラム (LuminanceHistogramBinCount 個)</param>
+/// <param name="param">自動露出の設定</param>
+/// <param name="report">検証結果の格納先</param>
+/// <returns>全てのビンが一致した場合はtrue</returns>
+bool CompareLuminanceHistogram(
+	const CpuImage& image,
+	const uint32_t* captured,
+	const AutoExposureParam& param,
+	AutoExposureReport& report);
+
+/// <summary>
+/// ヒストグラムをファイルに保存する
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="histogram">ヒストグラム (LuminanceHistogramBinCount 個)</param>
+/// <returns>保存に成功した場合はtrue</returns>
+bool SaveLuminanceHistogram(const wchar_t* path, const uint32_t* histogram);
+
+/// <summary>
+/// ファイルからヒストグラムを読み込む
+/// </summary>
+/// <param name="path">ファイルパス</param>
+/// <param name="histogram">ヒストグラムの格納先 (LuminanceHistogramBinCount 個)</param>
+/// <returns>読み込みに成功した場合はtrue</returns>
+bool LoadLuminanceHistogram(const wchar_t* path, std::vector<uint32_t>& histogram);
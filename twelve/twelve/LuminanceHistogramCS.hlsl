@@ -0,0 +1,84 @@
+//-----------------------------------------------------------------------------
+// File : LuminanceHistogramCS.hlsl
+// Desc : Compute Shader For Luminance Histogram.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint BIN_COUNT = 256; // ビン数です (LuminanceHistogram.h と同じ).
+static const uint BINS_PER_STOP = 8; // 1段あたりのビン数です.
+static const uint THREAD_SIZE = 16; // スレッドグループの1辺のサイズです.
+static const float MAX_CHANNEL_VALUE = 4096.0f; // チャンネルの上限です.
+
+///////////////////////////////////////////////////////////////////////////////
+// CbHistogram constant buffer
+///////////////////////////////////////////////////////////////////////////////
+cbuffer CbHistogram : register(b0)
+{
+    uint Width; // 入力の横幅です.
+    uint Height; // 入力の縦幅です.
+};
+
+//-----------------------------------------------------------------------------
+// Resources
+//-----------------------------------------------------------------------------
+Texture2D<float4> ColorMap : register(t0);
+RWByteAddressBuffer Histogram : register(u0);
+
+groupshared uint LocalHistogram[BIN_COUNT];
+
+//-----------------------------------------------------------------------------
+//      チャンネルを 1/1024 単位の固定小数に変換します.
+//-----------------------------------------------------------------------------
+uint QuantizeChannel(float value)
+{
+    // max() は NaN の場合に 0 を返します.
+    return (uint)(min(max(value, 0.0f), MAX_CHANNEL_VALUE) * 1024.0f + 0.5f);
+}
+
+//-----------------------------------------------------------------------------
+//      ビン番号を求めます (CalcLuminanceHistogramBin() と同じ).
+//-----------------------------------------------------------------------------
+uint CalcBin(float3 color)
+{
+    uint luma = QuantizeChannel(color.r) * 54
+        + QuantizeChannel(color.g) * 183
+        + QuantizeChannel(color.b) * 19;
+
+    if (luma == 0)
+    {
+        return 0;
+    }
+
+    uint e = firstbithigh(luma);
+    uint m = (e >= 3) ? (luma >> (e - 3)) & 7 : (luma << (3 - e)) & 7;
+
+    return 1 + e * BINS_PER_STOP + m;
+}
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+[numthreads(THREAD_SIZE, THREAD_SIZE, 1)]
+void main(uint3 dispatchId : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+    // 共有メモリのヒストグラムをクリア.
+    LocalHistogram[groupIndex] = 0;
+    GroupMemoryBarrierWithGroupSync();
+
+    // ピクセルのビンをカウント.
+    if (dispatchId.x < Width && dispatchId.y < Height)
+    {
+        float3 color = ColorMap.Load(int3(dispatchId.xy, 0)).rgb;
+        InterlockedAdd(LocalHistogram[CalcBin(color)], 1);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // グループの結果を加算 (スレッド数とビン数は同じ).
+    uint count = LocalHistogram[groupIndex];
+    if (count > 0)
+    {
+        Histogram.InterlockedAdd(groupIndex * 4, count);
+    }
+}
@@ -232,6 +232,17 @@ D3D12_GPU_DESCRIPTOR_HANDLE Material::GetTextureHandle(size_t index, TEXTURE_USA
 	return m_Subsets[index].TextureHandle[usage];
 }
 
+D3D12_GPU_DESCRIPTOR_HANDLE Material::GetDummyTextureHandle() const
+{
+	auto itr = m_pTextures.find(DummyTag);
+	if (itr == m_pTextures.end())
+	{
+		return D3D12_GPU_DESCRIPTOR_HANDLE();
+	}
+
+	return itr->second->GetHandleGPU();
+}
+
 size_t Material::GetCount() const
 {
 	return m_Subsets.size();
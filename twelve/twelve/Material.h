@@ -20,6 +20,7 @@ public:
 		TEXTURE_USAGE_BASE_COLOR,   // ベースカラーマップとして利用
 		TEXTURE_USAGE_METALLIC,     // メタリックマップとして利用
 		TEXTURE_USAGE_ROUGHNESS,    // ラフネスマップとして利用
+		TEXTURE_USAGE_ORM,          // ORMマップ (R:AO, G:ラフネス, B:メタリック) として利用
 
 		TEXTURE_USAGE_COUNT
 	};
@@ -83,6 +84,11 @@ public:
 
 	D3D12_GPU_DESCRIPTOR_HANDLE GetTextureHandle(size_t index, TEXTURE_USAGE usage) const;
 
+	/// <summary>
+	/// テクスチャが設定されていない用途に使うダミーテクスチャのハンドルを取得する
+	/// </summary>
+	D3D12_GPU_DESCRIPTOR_HANDLE GetDummyTextureHandle() const;
+
 	size_t GetCount() const;
 
 private:
@@ -110,3 +116,4 @@ constexpr auto TU_NORMAL = Material::TEXTURE_USAGE_NORMAL;
 constexpr auto TU_BASE_COLOR = Material::TEXTURE_USAGE_BASE_COLOR;
 constexpr auto TU_METALLIC = Material::TEXTURE_USAGE_METALLIC;
 constexpr auto TU_ROUGHNESS = Material::TEXTURE_USAGE_ROUGHNESS;
+constexpr auto TU_ORM = Material::TEXTURE_USAGE_ORM;
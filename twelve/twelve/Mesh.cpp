@@ -1,10 +1,17 @@
 ﻿#include "Mesh.h"
 
+#include <algorithm>
+#include <cfloat>
+
 #include "Logger.h"
 
 Mesh::Mesh()
 	: m_MaterialId(INT32_MAX)
 	, m_IndexCount(0)
+	, m_InstanceCount(0)
+	, m_Center(0.0f, 0.0f, 0.0f)
+	, m_BoundsMin(0.0f, 0.0f, 0.0f)
+	, m_BoundsMax(0.0f, 0.0f, 0.0f)
 {
 }
 
@@ -33,8 +40,62 @@ bool Mesh::Init(ID3D12Device* pDevice, const ResMesh& resourse)
 		return false;
 	}
 
+	// インスタンスバッファの生成 (インスタンスがない場合は単位行列の1インスタンス)
+	std::vector<MeshInstance> instances = resourse.Instances;
+	if (instances.empty())
+	{
+		MeshInstance identity;
+		DirectX::XMStoreFloat4x4(&identity.World, DirectX::XMMatrixIdentity());
+		instances.push_back(identity);
+	}
+
+	if (!m_InstanceVB.Init<MeshInstance>(pDevice, instances.size(), instances.data()))
+	{
+		ELOG("Error : VertexBuffer::Init() Failed.");
+		return false;
+	}
+
 	m_MaterialId = resourse.MaterialId;
 	m_IndexCount = uint32_t(resourse.Indices.size());
+	m_InstanceCount = uint32_t(instances.size());
+
+	// 全てのインスタンスを含むバウンディングボックスの中心を求める
+	if (!resourse.Vertices.empty())
+	{
+		auto minPos = resourse.Vertices[0].Position;
+		auto maxPos = resourse.Vertices[0].Position;
+		for (const auto& vertex : resourse.Vertices)
+		{
+			minPos.x = std::min(minPos.x, vertex.Position.x);
+			minPos.y = std::min(minPos.y, vertex.Position.y);
+			minPos.z = std::min(minPos.z, vertex.Position.z);
+			maxPos.x = std::max(maxPos.x, vertex.Position.x);
+			maxPos.y = std::max(maxPos.y, vertex.Position.y);
+			maxPos.z = std::max(maxPos.z, vertex.Position.z);
+		}
+
+		auto localMin = DirectX::XMLoadFloat3(&minPos);
+		auto localMax = DirectX::XMLoadFloat3(&maxPos);
+		auto worldMin = DirectX::XMVectorReplicate(FLT_MAX);
+		auto worldMax = DirectX::XMVectorReplicate(-FLT_MAX);
+
+		// ローカルのバウンディングボックスの8頂点を変換して広げる
+		for (const auto& instance : instances)
+		{
+			auto world = DirectX::XMLoadFloat4x4(&instance.World);
+			for (auto corner = 0; corner < 8; ++corner)
+			{
+				auto select = DirectX::XMVectorSelectControl(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1, 0);
+				auto pos = DirectX::XMVector3TransformCoord(DirectX::XMVectorSelect(localMin, localMax, select), world);
+				worldMin = DirectX::XMVectorMin(worldMin, pos);
+				worldMax = DirectX::XMVectorMax(worldMax, pos);
+			}
+		}
+
+		DirectX::XMStoreFloat3(&m_Center, DirectX::XMVectorScale(DirectX::XMVectorAdd(worldMin, worldMax), 0.5f));
+		DirectX::XMStoreFloat3(&m_BoundsMin, worldMin);
+		DirectX::XMStoreFloat3(&m_BoundsMax, worldMax);
+	}
 
 	return true;
 }
@@ -42,21 +103,29 @@ bool Mesh::Init(ID3D12Device* pDevice, const ResMesh& resourse)
 void Mesh::Term()
 {
 	m_VB.Term();
+	m_InstanceVB.Term();
 	m_IB.Term();
 	m_MaterialId = UINT32_MAX;
 	m_IndexCount = 0;
+	m_InstanceCount = 0;
+	m_Center = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	m_BoundsMin = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	m_BoundsMax = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
 }
 
-void Mesh::Draw(ID3D12GraphicsCommandList* pCmdList)
+void Mesh::Draw(CommandRecorder& recorder)
 {
-	auto VBV = m_VB.GetView();
+	D3D12_VERTEX_BUFFER_VIEW VBV[2] = {
+		m_VB.GetView(),
+		m_InstanceVB.GetView(),
+	};
 	auto IBV = m_IB.GetView();
 
-	pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	pCmdList->IASetVertexBuffers(0, 1, &VBV);
-	pCmdList->IASetIndexBuffer(&IBV);
+	recorder.IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	recorder.IASetVertexBuffers(0, 2, VBV);
+	recorder.IASetIndexBuffer(&IBV);
 
-	pCmdList->DrawIndexedInstanced(m_IndexCount, 1, 0, 0, 0);
+	recorder.DrawIndexedInstanced(m_IndexCount, m_InstanceCount, 0, 0, 0);
 }
 
 uint32_t Mesh::GetMaterialId() const
@@ -3,6 +3,7 @@
 #include "ResMesh.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include "CommandRecorder.h"
 
 class Mesh
 {
@@ -26,18 +27,41 @@ public:
 	void Term();
 
 	/// <summary>
-	/// 描画処理
+	/// 描画処理 (全てのインスタンスを1回の描画で描く)
+	/// 同じメッシュが続く場合は, バッファの設定をレコーダーが省略する
 	/// </summary>
-	/// <param name="pCmdList">コマンドリスト</param>
-	void Draw(ID3D12GraphicsCommandList* pCmdList);
+	/// <param name="recorder">コマンドレコーダー</param>
+	void Draw(CommandRecorder& recorder);
 
 	uint32_t GetMaterialId() const;
 
+	/// <summary>
+	/// 全てのインスタンスを含むバウンディングボックスの中心 (描画順の深度に使用する)
+	/// </summary>
+	const DirectX::XMFLOAT3& GetCenter() const { return m_Center; }
+
+	/// <summary>
+	/// 全てのインスタンスを含むワールド空間のバウンディングボックス (影を落とす範囲の判定に使用する)
+	/// </summary>
+	const DirectX::XMFLOAT3& GetBoundsMin() const { return m_BoundsMin; }
+	const DirectX::XMFLOAT3& GetBoundsMax() const { return m_BoundsMax; }
+
+	D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView() const { return m_VB.GetView(); }
+	D3D12_VERTEX_BUFFER_VIEW GetInstanceBufferView() const { return m_InstanceVB.GetView(); }
+	D3D12_INDEX_BUFFER_VIEW GetIndexBufferView() const { return m_IB.GetView(); }
+	uint32_t GetIndexCount() const { return m_IndexCount; }
+	uint32_t GetInstanceCount() const { return m_InstanceCount; }
+
 private:
 	VertexBuffer m_VB; // 頂点バッファ
+	VertexBuffer m_InstanceVB; // インスタンスバッファ (スロット1)
 	IndexBuffer m_IB; // インデックスバッファ
 	uint32_t m_MaterialId; // マテリアル番号
 	uint32_t m_IndexCount; // インデックス数
+	uint32_t m_InstanceCount; // インスタンス数
+	DirectX::XMFLOAT3 m_Center; // バウンディングボックスの中心
+	DirectX::XMFLOAT3 m_BoundsMin; // バウンディングボックスの最小値
+	DirectX::XMFLOAT3 m_BoundsMax; // バウンディングボックスの最大値
 
 	Mesh(const Mesh&) = delete;
 	void operator=(const Mesh&) = delete;
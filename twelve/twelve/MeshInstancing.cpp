@@ -0,0 +1,135 @@
+﻿#include "MeshInstancing.h"
+
+#include <cstring>
+#include <unordered_map>
+
+#include "HashUtil.h"
+#include "Logger.h"
+
+namespace
+{
+	size_t GetMeshDataSize(const ResMesh& mesh)
+	{
+		return mesh.Vertices.size() * sizeof(MeshVertex) + mesh.Indices.size() * sizeof(uint32_t);
+	}
+
+	uint32_t GetInstanceCount(const ResMesh& mesh)
+	{
+		return mesh.Instances.empty() ? 1 : uint32_t(mesh.Instances.size());
+	}
+
+	MeshInstance MakeTranslation(float x, float y, float z)
+	{
+		MeshInstance instance;
+		DirectX::XMStoreFloat4x4(&instance.World, DirectX::XMMatrixTranslation(x, y, z));
+		return instance;
+	}
+}
+
+uint64_t ComputeMeshDataHash(const ResMesh& mesh)
+{
+	auto hash = ComputeHash(mesh.MaterialId);
+	hash = ComputeHash(mesh.Vertices.data(), mesh.Vertices.size() * sizeof(MeshVertex), hash);
+	hash = ComputeHash(mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t), hash);
+	return hash;
+}
+
+bool IsSameMeshData(const ResMesh& a, const ResMesh& b)
+{
+	if (a.MaterialId != b.MaterialId
+		|| a.Vertices.size() != b.Vertices.size()
+		|| a.Indices.size() != b.Indices.size())
+	{
+		return false;
+	}
+
+	// MeshVertex はパディングを含まないのでバイト列で比較できる
+	return memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size() * sizeof(MeshVertex)) == 0
+		&& memcmp(a.Indices.data(), b.Indices.data(), a.Indices.size() * sizeof(uint32_t)) == 0;
+}
+
+uint32_t DeduplicateMeshes(std::vector<ResMesh>& meshes, std::vector<uint32_t>& remap)
+{
+	std::vector<ResMesh> unique;
+	std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;	// ハッシュ値 -> 同じハッシュ値の (まとめた後の) メッシュ番号
+
+	unique.reserve(meshes.size());
+	remap.resize(meshes.size());
+
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		auto& mesh = meshes[i];
+		auto& candidates = buckets[ComputeMeshDataHash(mesh)];
+
+		auto found = UINT32_MAX;
+		for (auto index : candidates)
+		{
+			if (IsSameMeshData(unique[index], mesh))
+			{
+				found = index;
+				break;
+			}
+		}
+
+		if (found == UINT32_MAX)
+		{
+			found = uint32_t(unique.size());
+			candidates.push_back(found);
+			unique.push_back(std::move(mesh));
+		}
+		else
+		{
+			// インスタンスを移す (空の場合は単位行列の1インスタンスとして扱う)
+			auto& dst = unique[found].Instances;
+			if (dst.empty())
+			{
+				dst.push_back(MakeTranslation(0.0f, 0.0f, 0.0f));
+			}
+
+			if (mesh.Instances.empty())
+			{
+				dst.push_back(MakeTranslation(0.0f, 0.0f, 0.0f));
+			}
+			else
+			{
+				dst.insert(dst.end(), mesh.Instances.begin(), mesh.Instances.end());
+			}
+		}
+
+		remap[i] = found;
+	}
+
+	auto removed = uint32_t(meshes.size() - unique.size());
+	meshes = std::move(unique);
+
+	return removed;
+}
+
+MeshInstancingStats ComputeMeshInstancingStats(const std::vector<ResMesh>& meshes)
+{
+	MeshInstancingStats stats;
+	stats.MeshCount = uint32_t(meshes.size());
+
+	for (const auto& mesh : meshes)
+	{
+		auto instanceCount = GetInstanceCount(mesh);
+		auto dataSize = GetMeshDataSize(mesh);
+
+		stats.InstanceCount += instanceCount;
+		stats.BakedBytes += dataSize * instanceCount;
+		stats.InstancedBytes += dataSize + sizeof(MeshInstance) * instanceCount;
+	}
+
+	return stats;
+}
+
+void LogMeshInstancingStats(const wchar_t* name, const MeshInstancingStats& stats)
+{
+	ILOG("MeshInstancing : %ls -> %u mesh(es), %u instance(s)", name, stats.MeshCount, stats.InstanceCount);
+	ILOG("  Draws       %u -> %u", stats.InstanceCount, stats.MeshCount);
+	ILOG("  Memory      %.2f MB -> %.2f MB (%.1f%%)",
+		double(stats.BakedBytes) / (1024.0 * 1024.0),
+		double(stats.InstancedBytes) / (1024.0 * 1024.0),
+		(stats.BakedBytes > 0) ? 100.0 * double(stats.InstancedBytes) / double(stats.BakedBytes) : 100.0);
+}
+
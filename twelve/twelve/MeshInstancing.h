@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ResMesh.h"
+
+/// <summary>
+/// メッシュのインスタンス化の集計結果
+/// </summary>
+struct MeshInstancingStats
+{
+	uint32_t	MeshCount = 0;			// メッシュ数 (インスタンス化した場合の描画数)
+	uint32_t	InstanceCount = 0;		// インスタンス数 (変換を焼き込んだ場合の描画数)
+	size_t		BakedBytes = 0;			// 変換を焼き込んだ場合の頂点/インデックスデータのサイズ
+	size_t		InstancedBytes = 0;		// インスタンス化した場合の頂点/インデックス/インスタンスデータのサイズ
+};
+
+/// <summary>
+/// メッシュの頂点, インデックス, マテリアル番号のハッシュ値を計算する (インスタンスのデータは含めない)
+/// </summary>
+uint64_t ComputeMeshDataHash(const ResMesh& mesh);
+
+/// <summary>
+/// メッシュの頂点, インデックス, マテリアル番号が一致するかどうか
+/// </summary>
+bool IsSameMeshData(const ResMesh& a, const ResMesh& b);
+
+/// <summary>
+/// データが同じメッシュを1つにまとめ, まとめたメッシュのインスタンスを残すメッシュに移す
+/// ハッシュ値で候補を絞り, 内容を比較して一致したものだけをまとめる
+/// </summary>
+/// <param name="meshes">メッシュ (まとめた結果で置き換える. 順序は最初に現れた順)</param>
+/// <param name="remap">元のメッシュ番号からまとめた後のメッシュ番号への対応の格納先</param>
+/// <returns>取り除いたメッシュの数</returns>
+uint32_t DeduplicateMeshes(std::vector<ResMesh>& meshes, std::vector<uint32_t>& remap);
+
+/// <summary>
+/// メッシュのインスタンス化によるメモリと描画数を集計する
+/// </summary>
+MeshInstancingStats ComputeMeshInstancingStats(const std::vector<ResMesh>& meshes);
+
+/// <summary>
+/// 集計結果をログに出力する
+/// </summary>
+void LogMeshInstancingStats(const wchar_t* name, const MeshInstancingStats& stats);
+
@@ -0,0 +1,365 @@
+﻿#include "NormalMipGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+
+#include "FileUtil.h"
+#include "HashUtil.h"
+#include "ParallelFor.h"
+#include "Logger.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t CacheVersion = 1;		// キャッシュの形式を変えた場合に更新する
+	const float MaxAverageLength = 0.9999f;	// これ以上の長さは分散なしとみなす
+	const float MinAverageLength = 1e-4f;	// これ未満の長さは法線が打ち消し合ったとみなす
+
+	/// <summary>
+	/// 経過時間をミリ秒で取得する
+	/// </summary>
+	double GetElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	/// <summary>
+	/// 下位ミップのサイズを求める
+	/// </summary>
+	uint32_t CalcNextMipSize(uint32_t size)
+	{
+		return (size > 1) ? (size >> 1) : 1;
+	}
+
+	/// <summary>
+	/// 2x2ボックスフィルタの参照元ピクセルを求める (奇数サイズの端はクランプ)
+	/// </summary>
+	void GetBoxTaps(uint32_t x, uint32_t srcSize, uint32_t& x0, uint32_t& x1)
+	{
+		x0 = std::min(x * 2, srcSize - 1);
+		x1 = std::min(x * 2 + 1, srcSize - 1);
+	}
+
+	/// <summary>
+	/// 平均したベクトル (長さ付きの単位法線) を取り出す
+	/// </summary>
+	XMVECTOR LoadMeanNormal(const XMFLOAT4& texel)
+	{
+		auto n = XMVectorSet(texel.x * 2.0f - 1.0f, texel.y * 2.0f - 1.0f, texel.z * 2.0f - 1.0f, 0.0f);
+		return XMVectorScale(n, texel.w);
+	}
+
+	/// <summary>
+	/// 平均したベクトルを再正規化してエンコードする
+	/// </summary>
+	XMFLOAT4 StoreMeanNormal(FXMVECTOR mean)
+	{
+		auto length = XMVectorGetX(XMVector3Length(mean));
+
+		XMFLOAT3 n;
+		if (length < MinAverageLength)
+		{
+			n = XMFLOAT3(0.0f, 0.0f, 1.0f);
+			length = 0.0f;
+		}
+		else
+		{
+			XMStoreFloat3(&n, XMVectorScale(mean, 1.0f / length));
+		}
+
+		return XMFLOAT4(
+			n.x * 0.5f + 0.5f,
+			n.y * 0.5f + 0.5f,
+			n.z * 0.5f + 0.5f,
+			std::min(length, 1.0f));
+	}
+
+	/// <summary>
+	/// 値の配列から指定チャンネルを参照する
+	/// </summary>
+	float& GetChannel(XMFLOAT4& value, uint32_t channel)
+	{
+		switch (channel)
+		{
+		case 0:		return value.x;
+		case 1:		return value.y;
+		case 2:		return value.z;
+		default:	return value.w;
+		}
+	}
+
+	/// <summary>
+	/// テクセルの大きさが近い法線マップのミップレベルを求める
+	/// </summary>
+	uint32_t FindNormalMipLevel(const std::vector<CpuImage>& normalMips, uint32_t width)
+	{
+		auto ratio = double(normalMips[0].Width) / double(std::max(width, 1u));
+		auto level = int(std::lround(std::log2(std::max(ratio, 1.0))));
+		return uint32_t(std::clamp(level, 0, int(normalMips.size()) - 1));
+	}
+}
+
+float CalcVMFKappa(float averageLength)
+{
+	auto r = std::clamp(averageLength, 0.0f, 1.0f);
+	if (r >= 1.0f)
+	{
+		return INFINITY;
+	}
+
+	return (3.0f * r - r * r * r) / (1.0f - r * r);
+}
+
+float ApplyNormalVariance(float roughness, float averageLength)
+{
+	roughness = std::clamp(roughness, 0.0f, 1.0f);
+	if (averageLength >= MaxAverageLength)
+	{
+		return roughness;
+	}
+
+	auto a = roughness * roughness;
+	auto a2 = a * a;
+
+	// 法線が打ち消し合う場合は κ = 0 となるので最大の粗さにする
+	auto kappa = CalcVMFKappa(std::max(averageLength, MinAverageLength));
+	a2 = std::min(a2 + 2.0f / std::max(kappa, 1e-6f), 1.0f);
+
+	return std::sqrt(std::sqrt(a2));
+}
+
+void GenerateNormalMips(const CpuImage& normalMap, std::vector<CpuImage>& mips, uint32_t threadCount)
+{
+	mips.clear();
+	if (normalMap.Width == 0 || normalMap.Height == 0)
+	{
+		return;
+	}
+
+	auto mipCount = CalcMipCount(std::max(normalMap.Width, normalMap.Height));
+	mips.resize(mipCount);
+
+	// 最上位ミップは入力を正規化する
+	auto& top = mips[0];
+	top.Resize(normalMap.Width, normalMap.Height);
+
+	ParallelFor(0, top.Height, [&](uint32_t y)
+	{
+		auto pSrc = normalMap.GetRow(y);
+		auto pDst = top.GetRow(y);
+
+		for (auto x = 0u; x < top.Width; ++x)
+		{
+			auto n = XMVectorSet(pSrc[x].x * 2.0f - 1.0f, pSrc[x].y * 2.0f - 1.0f, pSrc[x].z * 2.0f - 1.0f, 0.0f);
+			auto texel = StoreMeanNormal(n);
+			texel.w = (texel.w > 0.0f) ? 1.0f : 0.0f;
+			pDst[x] = texel;
+		}
+	}, threadCount);
+
+	// 長さ付きのベクトルを平均するので, どのミップでも最上位の単位法線の平均になる
+	for (auto mip = 1u; mip < mipCount; ++mip)
+	{
+		const auto& src = mips[mip - 1];
+		auto& dst = mips[mip];
+		dst.Resize(CalcNextMipSize(src.Width), CalcNextMipSize(src.Height));
+
+		ParallelFor(0, dst.Height, [&](uint32_t y)
+		{
+			uint32_t y0, y1;
+			GetBoxTaps(y, src.Height, y0, y1);
+
+			auto pRow0 = src.GetRow(y0);
+			auto pRow1 = src.GetRow(y1);
+			auto pDst = dst.GetRow(y);
+
+			for (auto x = 0u; x < dst.Width; ++x)
+			{
+				uint32_t x0, x1;
+				GetBoxTaps(x, src.Width, x0, x1);
+
+				auto sum = LoadMeanNormal(pRow0[x0]);
+				sum = XMVectorAdd(sum, LoadMeanNormal(pRow0[x1]));
+				sum = XMVectorAdd(sum, LoadMeanNormal(pRow1[x0]));
+				sum = XMVectorAdd(sum, LoadMeanNormal(pRow1[x1]));
+
+				pDst[x] = StoreMeanNormal(XMVectorScale(sum, 0.25f));
+			}
+		}, threadCount);
+	}
+}
+
+void GenerateRoughnessMips
+(
+	const CpuImage& image,
+	uint32_t roughnessChannel,
+	const std::vector<CpuImage>& normalMips,
+	std::vector<CpuImage>& mips,
+	uint32_t threadCount
+)
+{
+	mips.clear();
+	if (image.Width == 0 || image.Height == 0)
+	{
+		return;
+	}
+
+	auto mipCount = CalcMipCount(std::max(image.Width, image.Height));
+	roughnessChannel = std::min(roughnessChannel, 3u);
+
+	// 粗さのチャンネルを α^2 にした画像のミップを作る
+	std::vector<CpuImage> base(mipCount);
+	base[0] = image;
+
+	ParallelFor(0, image.Height, [&](uint32_t y)
+	{
+		auto pRow = base[0].GetRow(y);
+		for (auto x = 0u; x < image.Width; ++x)
+		{
+			auto& r = GetChannel(pRow[x], roughnessChannel);
+			r = std::clamp(r, 0.0f, 1.0f);
+			r = (r * r) * (r * r);
+		}
+	}, threadCount);
+
+	for (auto mip = 1u; mip < mipCount; ++mip)
+	{
+		const auto& src = base[mip - 1];
+		auto& dst = base[mip];
+		dst.Resize(CalcNextMipSize(src.Width), CalcNextMipSize(src.Height));
+
+		ParallelFor(0, dst.Height, [&](uint32_t y)
+		{
+			uint32_t y0, y1;
+			GetBoxTaps(y, src.Height, y0, y1);
+
+			auto pRow0 = src.GetRow(y0);
+			auto pRow1 = src.GetRow(y1);
+			auto pDst = dst.GetRow(y);
+
+			for (auto x = 0u; x < dst.Width; ++x)
+			{
+				uint32_t x0, x1;
+				GetBoxTaps(x, src.Width, x0, x1);
+
+				auto sum = XMLoadFloat4(&pRow0[x0]);
+				sum = XMVectorAdd(sum, XMLoadFloat4(&pRow0[x1]));
+				sum = XMVectorAdd(sum, XMLoadFloat4(&pRow1[x0]));
+				sum = XMVectorAdd(sum, XMLoadFloat4(&pRow1[x1]));
+
+				XMStoreFloat4(&pDst[x], XMVectorScale(sum, 0.25f));
+			}
+		}, threadCount);
+	}
+
+	// α^2 を線形ラフネスに戻しながら法線の分散を加算する
+	mips.resize(mipCount);
+	for (auto mip = 0u; mip < mipCount; ++mip)
+	{
+		const auto& src = base[mip];
+		auto& dst = mips[mip];
+		dst.Resize(src.Width, src.Height);
+
+		const CpuImage* pNormal = nullptr;
+		if (!normalMips.empty())
+		{
+			pNormal = &normalMips[FindNormalMipLevel(normalMips, src.Width)];
+		}
+
+		ParallelFor(0, dst.Height, [&](uint32_t y)
+		{
+			auto pSrc = src.GetRow(y);
+			auto pDst = dst.GetRow(y);
+			auto v = (float(y) + 0.5f) / float(dst.Height);
+
+			for (auto x = 0u; x < dst.Width; ++x)
+			{
+				pDst[x] = pSrc[x];
+
+				auto& r = GetChannel(pDst[x], roughnessChannel);
+				r = std::sqrt(std::sqrt(std::max(r, 0.0f)));
+
+				if (pNormal != nullptr)
+				{
+					auto u = (float(x) + 0.5f) / float(dst.Width);
+					auto length = XMVectorGetW(SampleBilinear(*pNormal, u, v, true));
+					r = ApplyNormalVariance(r, length);
+				}
+			}
+		}, threadCount);
+	}
+}
+
+bool CookNormalMap(const std::wstring& directory, const std::wstring& normalMap, std::wstring& result)
+{
+	std::wstring path;
+	if (!SearchFilePathW((directory + normalMap).c_str(), path))
+	{
+		ELOG("Error : File Not Found. path = %ls", (directory + normalMap).c_str());
+		return false;
+	}
+
+	uint64_t fileHash = 0;
+	if (!ComputeFileHash(path.c_str(), fileHash))
+	{
+		ELOG("Error : File Read Failed. path = %ls", path.c_str());
+		return false;
+	}
+
+	auto hash = ComputeHash(CacheVersion);
+	hash = ComputeHash(fileHash, hash);
+
+	// キャッシュファイルのパスを決定
+	// <入力のディレクトリ>/Cache/<入力のファイル名>_nmip_<ハッシュ値>.dds
+	auto cacheName = std::filesystem::path(normalMap).stem().wstring() + L"_nmip_" + ToHexString(hash) + L".dds";
+	auto cacheDir = std::filesystem::path(path).parent_path() / L"Cache";
+	auto cachePath = (cacheDir / cacheName).wstring();
+
+	result = (std::filesystem::path(normalMap).parent_path() / L"Cache" / cacheName).generic_wstring();
+
+	std::error_code error;
+	if (std::filesystem::exists(cachePath, error))
+	{
+		return true;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	CpuImage image;
+	if (!LoadImageRGBA32F(path.c_str(), image))
+	{
+		ELOG("Error : LoadImageRGBA32F() Failed. path = %ls", path.c_str());
+		return false;
+	}
+
+	std::vector<CpuImage> mips;
+	GenerateNormalMips(image, mips);
+
+	// アルファには平均の長さが入っているので, テクスチャとしては1にしておく
+	for (auto& mip : mips)
+	{
+		for (auto& texel : mip.Pixels)
+		{
+			texel.w = 1.0f;
+		}
+	}
+
+	std::filesystem::create_directories(cacheDir, error);
+
+	auto format = ((image.Width % 4) == 0 && (image.Height % 4) == 0)
+		? DXGI_FORMAT_BC7_UNORM
+		: DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	if (!SaveMipChainToDDS(cachePath.c_str(), mips, format))
+	{
+		ELOG("Error : SaveMipChainToDDS() Failed. path = %ls", cachePath.c_str());
+		return false;
+	}
+
+	ILOG("NormalMipGenerator : %ls, %ux%u, %u mips, %.3f ms", cacheName.c_str(), image.Width, image.Height, uint32_t(mips.size()), GetElapsedMilliseconds(start));
+	return true;
+}
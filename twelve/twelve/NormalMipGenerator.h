@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+#include "CubeMapUtil.h"
+
+/// <summary>
+/// 平均法線の長さから von Mises-Fisher 分布の集中度 κ を求める
+/// </summary>
+/// <param name="averageLength">単位法線を平均したベクトルの長さ [0, 1]</param>
+/// <returns>集中度 (長さが1の場合は無限大)</returns>
+float CalcVMFKappa(float averageLength);
+
+/// <summary>
+/// 法線の分散を粗さに加算する (Toksvig)
+/// 法線分布を vMF で近似し, GGX の α^2 に 2/κ を加算する
+/// </summary>
+/// <param name="roughness">線形ラフネス (シェーダで α = roughness^2 として扱う値)</param>
+/// <param name="averageLength">単位法線を平均したベクトルの長さ [0, 1]</param>
+/// <returns>分散を加算した線形ラフネス</returns>
+float ApplyNormalVariance(float roughness, float averageLength);
+
+/// <summary>
+/// 法線マップのミップマップを生成する
+/// 下位のミップは上位の法線を2x2ボックスフィルタで平均したあと再正規化し, 平均したベクトルの長さをアルファに格納する
+/// 長さは最上位ミップの単位法線を平均したものになるので, 1に近いほど法線がそろっていることを表す
+/// </summary>
+/// <param name="normalMap">法線マップ ([0, 1] にエンコードされたもの)</param>
+/// <param name="mips">ミップマップの格納先 (RGB:エンコードされた単位法線, A:平均したベクトルの長さ)</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+void GenerateNormalMips(const CpuImage& normalMap, std::vector<CpuImage>& mips, uint32_t threadCount = 0);
+
+/// <summary>
+/// 法線マップのミップで失われた分散を粗さに加算しながら画像のミップマップを生成する
+/// 粗さのチャンネルは α^2 の空間で平均し, それ以外のチャンネルは線形に平均する
+/// 法線マップとサイズが異なる場合は, テクセルの大きさが近い法線マップのミップを参照する
+/// </summary>
+/// <param name="image">最上位ミップの画像</param>
+/// <param name="roughnessChannel">線形ラフネスを格納したチャンネル (0:R, 1:G, 2:B, 3:A)</param>
+/// <param name="normalMips">GenerateNormalMips() で生成した法線マップのミップ (空の場合は分散を加算しない)</param>
+/// <param name="mips">ミップマップの格納先</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+void GenerateRoughnessMips(
+	const CpuImage& image,
+	uint32_t roughnessChannel,
+	const std::vector<CpuImage>& normalMips,
+	std::vector<CpuImage>& mips,
+	uint32_t threadCount = 0);
+
+/// <summary>
+/// 再正規化したミップを持つ法線マップを BC7 で <入力のディレクトリ>/Cache にDDSとしてキャッシュする
+/// </summary>
+/// <param name="directory">法線マップのパスの基準ディレクトリ</param>
+/// <param name="normalMap">directory からの法線マップの相対パス</param>
+/// <param name="result">キャッシュの directory からの相対パスの格納先</param>
+/// <returns>キャッシュが用意できた場合はtrue</returns>
+bool CookNormalMap(const std::wstring& directory, const std::wstring& normalMap, std::wstring& result);
@@ -0,0 +1,476 @@
+﻿#include "ORMTexturePacker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <DirectXTex.h>
+
+#include "FileUtil.h"
+#include "HashUtil.h"
+#include "NormalMipGenerator.h"
+#include "ParallelFor.h"
+#include "Logger.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const double MinBC1PSNR = 40.0;			// BC1 を採用するPSNRの下限 [dB]
+	const uint32_t CacheVersion = 2;		// キャッシュの形式を変えた場合に更新する
+
+	/// <summary>
+	/// パックに使う入力ファイル
+	/// </summary>
+	struct SourceFile
+	{
+		std::wstring	RelativePath;	// 基準ディレクトリからの相対パス
+		std::wstring	Path;			// 検索したファイルパス
+		uint32_t		Channel;		// 取り出すチャンネル
+		float			DefaultValue;	// ファイルがない場合の値
+	};
+
+	/// <summary>
+	/// 経過時間をミリ秒で取得する
+	/// </summary>
+	double GetElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	/// <summary>
+	/// 拡張子がDDSかどうか
+	/// </summary>
+	bool IsDDSFile(const std::wstring& path)
+	{
+		auto ext = std::filesystem::path(path).extension().wstring();
+		for (auto& c : ext)
+		{
+			c = towlower(c);
+		}
+		return ext == L".dds";
+	}
+
+	/// <summary>
+	/// ミップを含むテクスチャのメモリ量を求める
+	/// </summary>
+	uint64_t CalcTextureBytes(DXGI_FORMAT format, size_t width, size_t height, size_t mipLevels)
+	{
+		uint64_t bytes = 0;
+		for (size_t mip = 0; mip < mipLevels; ++mip)
+		{
+			size_t rowPitch = 0;
+			size_t slicePitch = 0;
+			if (FAILED(ComputePitch(format, width, height, rowPitch, slicePitch)))
+			{
+				break;
+			}
+
+			bytes += slicePitch;
+			width = (width > 1) ? (width >> 1) : 1;
+			height = (height > 1) ? (height >> 1) : 1;
+		}
+		return bytes;
+	}
+
+	/// <summary>
+	/// テクスチャとして読み込んだ場合のメモリ量と1テクセルのビット数を求める
+	/// WIC形式はテクスチャの読み込み時と同じくミップマップを全て生成するものとして扱う
+	/// </summary>
+	bool GetTextureFootprint(const std::wstring& path, uint64_t& bytes, double& bitsPerTexel)
+	{
+		TexMetadata metadata = {};
+		HRESULT hr = S_OK;
+
+		if (IsDDSFile(path))
+		{
+			hr = GetMetadataFromDDSFile(path.c_str(), DDS_FLAGS_NONE, metadata);
+		}
+		else
+		{
+			hr = GetMetadataFromWICFile(path.c_str(), WIC_FLAGS_NONE, metadata);
+			metadata.mipLevels = CalcMipCount(uint32_t(std::max(metadata.width, metadata.height)));
+		}
+
+		if (FAILED(hr))
+		{
+			return false;
+		}
+
+		bytes = CalcTextureBytes(metadata.format, metadata.width, metadata.height, metadata.mipLevels) * metadata.arraySize;
+		bitsPerTexel = double(BitsPerPixel(metadata.format));
+		return true;
+	}
+
+	/// <summary>
+	/// ミップマップを指定フォーマットに圧縮し, 最上位ミップの誤差を求める
+	/// </summary>
+	bool CompressORM(const std::vector<CpuImage>& mips, DXGI_FORMAT format, ScratchImage& result, ImageError& error)
+	{
+		const auto& image = mips[0];
+
+		ScratchImage mipChain;
+		auto hr = mipChain.Initialize2D(DXGI_FORMAT_R32G32B32A32_FLOAT, image.Width, image.Height, 1, mips.size());
+		if (FAILED(hr))
+		{
+			ELOG("Error : ScratchImage::Initialize2D() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		for (size_t mip = 0; mip < mips.size(); ++mip)
+		{
+			auto pDst = mipChain.GetImage(mip, 0, 0);
+			for (auto y = 0u; y < mips[mip].Height; ++y)
+			{
+				memcpy(pDst->pixels + pDst->rowPitch * y, mips[mip].GetRow(y), sizeof(XMFLOAT4) * mips[mip].Width);
+			}
+		}
+
+		hr = Compress(
+			mipChain.GetImages(),
+			mipChain.GetImageCount(),
+			mipChain.GetMetadata(),
+			format,
+			TEX_COMPRESS_PARALLEL,
+			TEX_THRESHOLD_DEFAULT,
+			result);
+		if (FAILED(hr))
+		{
+			ELOG("Error : DirectX::Compress() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		// 最上位ミップを展開して誤差を求める
+		ScratchImage decompressed;
+		hr = Decompress(*result.GetImage(0, 0, 0), DXGI_FORMAT_R32G32B32A32_FLOAT, decompressed);
+		if (FAILED(hr))
+		{
+			ELOG("Error : DirectX::Decompress() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		CpuImage decoded;
+		if (!LoadFromScratchImage(decompressed, decoded))
+		{
+			return false;
+		}
+
+		error = CompareImages(image, decoded);
+		return true;
+	}
+
+	/// <summary>
+	/// DXGIフォーマットの表示名
+	/// </summary>
+	const char* GetFormatName(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:	return "BC1_UNORM";
+		case DXGI_FORMAT_BC7_UNORM:	return "BC7_UNORM";
+		default:					return "UNKNOWN";
+		}
+	}
+}
+
+void PackORMImage(const ORMChannelSource sources[3], CpuImage& result, uint32_t threadCount)
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	for (auto i = 0; i < 3; ++i)
+	{
+		if (sources[i].pImage != nullptr)
+		{
+			width = std::max(width, sources[i].pImage->Width);
+			height = std::max(height, sources[i].pImage->Height);
+		}
+	}
+
+	// ブロック圧縮するため4の倍数に切り上げる
+	width = std::max((width + 3) & ~3u, 4u);
+	height = std::max((height + 3) & ~3u, 4u);
+
+	result.Resize(width, height);
+
+	ParallelFor(0, height, [&](uint32_t y)
+	{
+		auto pRow = result.GetRow(y);
+		auto v = (float(y) + 0.5f) / float(height);
+
+		for (auto x = 0u; x < width; ++x)
+		{
+			auto u = (float(x) + 0.5f) / float(width);
+			float values[3];
+
+			for (auto i = 0; i < 3; ++i)
+			{
+				const auto& source = sources[i];
+				if (source.pImage == nullptr || source.pImage->Width == 0 || source.pImage->Height == 0)
+				{
+					values[i] = source.DefaultValue;
+					continue;
+				}
+
+				XMFLOAT4 texel;
+				if (source.pImage->Width == width && source.pImage->Height == height)
+				{
+					texel = source.pImage->GetRow(y)[x];
+				}
+				else
+				{
+					XMStoreFloat4(&texel, SampleBilinear(*source.pImage, u, v, true));
+				}
+
+				const float channels[4] = { texel.x, texel.y, texel.z, texel.w };
+				values[i] = std::clamp(channels[std::min(source.Channel, 3u)], 0.0f, 1.0f);
+			}
+
+			pRow[x] = XMFLOAT4(values[0], values[1], values[2], 1.0f);
+		}
+	}, threadCount);
+}
+
+bool PackMaterialORM(const std::wstring& directory, ResMaterial& material, ORMPackReport* pReport)
+{
+	material.ORMMap.clear();
+
+	// 入力を決める (R:AO, G:粗さ, B:金属度)
+	// 金属度と粗さが同じファイルの場合はglTFの metallicRoughness テクスチャとして扱う
+	auto metallicMap = material.MetallicMap.empty() ? material.MetallicRoughnessMap : material.MetallicMap;
+	auto roughnessMap = material.RoughnessMap.empty() ? material.MetallicRoughnessMap : material.RoughnessMap;
+	auto isCombined = !metallicMap.empty() && (metallicMap == roughnessMap);
+
+	SourceFile sources[3] = {
+		{ material.OcclusionMap,	L"", 0,						1.0f },
+		{ roughnessMap,				L"", isCombined ? 1u : 0u,	material.Roughness },
+		{ metallicMap,				L"", isCombined ? 2u : 0u,	material.Metallic },
+	};
+
+	ORMPackReport report;
+
+	// 入力ファイルを検索してキャッシュのキーを計算する
+	auto hash = ComputeHash(CacheVersion);
+	const SourceFile* pFirst = nullptr;
+
+	for (auto& source : sources)
+	{
+		if (!source.RelativePath.empty() && SearchFilePathW((directory + source.RelativePath).c_str(), source.Path))
+		{
+			uint64_t fileHash = 0;
+			if (!ComputeFileHash(source.Path.c_str(), fileHash))
+			{
+				ELOG("Error : File Read Failed. path = %ls", source.Path.c_str());
+				return false;
+			}
+
+			hash = ComputeHash(fileHash, hash);
+			hash = ComputeHash(source.Channel, hash);
+
+			// 金属度と粗さが同じファイルの場合はバインドもフェッチも1回分
+			auto isShared = isCombined && (&source == &sources[2]);
+			if (!isShared)
+			{
+				uint64_t bytes = 0;
+				double bits = 0.0;
+				if (GetTextureFootprint(source.Path, bytes, bits))
+				{
+					report.SourceBytes += bytes;
+					report.SourceBitsPerTexel += bits;
+				}
+
+				++report.SourceBindCount;
+			}
+
+			if (pFirst == nullptr)
+			{
+				pFirst = &source;
+			}
+		}
+		else
+		{
+			source.Path.clear();
+			hash = ComputeHash(source.DefaultValue, hash);
+		}
+	}
+
+	// 法線マップがあれば, ミップで失われる法線の分散を粗さのミップに加算する
+	std::wstring normalPath;
+	if (!material.NormalMap.empty() && SearchFilePathW((directory + material.NormalMap).c_str(), normalPath))
+	{
+		uint64_t fileHash = 0;
+		if (!ComputeFileHash(normalPath.c_str(), fileHash))
+		{
+			ELOG("Error : File Read Failed. path = %ls", normalPath.c_str());
+			return false;
+		}
+
+		hash = ComputeHash(fileHash, hash);
+		report.NormalVariance = true;
+	}
+	else
+	{
+		normalPath.clear();
+	}
+
+	// キャッシュファイルのパスを決定
+	// <入力のディレクトリ>/Cache/<入力のファイル名>_orm_<ハッシュ値>.dds
+	std::filesystem::path relativeDir;
+	std::filesystem::path cacheDir;
+	std::wstring stem = L"default";
+
+	if (pFirst != nullptr)
+	{
+		relativeDir = std::filesystem::path(pFirst->RelativePath).parent_path() / L"Cache";
+		cacheDir = std::filesystem::path(pFirst->Path).parent_path() / L"Cache";
+		stem = std::filesystem::path(pFirst->RelativePath).stem().wstring();
+	}
+	else
+	{
+		std::wstring foundDir;
+		if (!SearchFilePathW(directory.c_str(), foundDir))
+		{
+			ELOG("Error : Directory Not Found. path = %ls", directory.c_str());
+			return false;
+		}
+
+		relativeDir = L"Cache";
+		cacheDir = std::filesystem::path(foundDir) / L"Cache";
+	}
+
+	auto cacheName = stem + L"_orm_" + ToHexString(hash) + L".dds";
+	auto cachePath = (cacheDir / cacheName).wstring();
+	auto relativePath = (relativeDir / cacheName).generic_wstring();
+
+	std::error_code error;
+	if (std::filesystem::exists(cachePath, error))
+	{
+		TexMetadata metadata = {};
+		if (SUCCEEDED(GetMetadataFromDDSFile(cachePath.c_str(), DDS_FLAGS_NONE, metadata)))
+		{
+			report.Format = metadata.format;
+			report.Width = uint32_t(metadata.width);
+			report.Height = uint32_t(metadata.height);
+			report.PackedBytes = CalcTextureBytes(metadata.format, metadata.width, metadata.height, metadata.mipLevels);
+			report.PackedBitsPerTexel = double(BitsPerPixel(metadata.format));
+		}
+
+		report.CacheHit = true;
+		material.ORMMap = relativePath;
+
+		if (pReport != nullptr)
+		{
+			*pReport = report;
+		}
+		return true;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	// 入力を読み込む
+	CpuImage images[3];
+	ORMChannelSource channels[3];
+	for (auto i = 0; i < 3; ++i)
+	{
+		channels[i].Channel = sources[i].Channel;
+		channels[i].DefaultValue = sources[i].DefaultValue;
+
+		if (sources[i].Path.empty())
+		{
+			continue;
+		}
+
+		if (!LoadImageRGBA32F(sources[i].Path.c_str(), images[i]))
+		{
+			ELOG("Error : LoadImageRGBA32F() Failed. path = %ls", sources[i].Path.c_str());
+			return false;
+		}
+
+		channels[i].pImage = &images[i];
+	}
+
+	CpuImage packed;
+	PackORMImage(channels, packed);
+
+	std::vector<CpuImage> normalMips;
+	if (!normalPath.empty())
+	{
+		CpuImage normalMap;
+		if (!LoadImageRGBA32F(normalPath.c_str(), normalMap))
+		{
+			ELOG("Error : LoadImageRGBA32F() Failed. path = %ls", normalPath.c_str());
+			return false;
+		}
+
+		GenerateNormalMips(normalMap, normalMips);
+	}
+
+	// 粗さ (Gチャンネル) は法線の分散を加算しながらミップを作る
+	std::vector<CpuImage> mips;
+	GenerateRoughnessMips(packed, 1, normalMips, mips);
+
+	// BC1で品質が足りなければBC7で圧縮する
+	ScratchImage compressed;
+	report.Format = DXGI_FORMAT_BC1_UNORM;
+	if (!CompressORM(mips, report.Format, compressed, report.Error))
+	{
+		return false;
+	}
+
+	if (report.Error.PSNR < MinBC1PSNR)
+	{
+		report.Format = DXGI_FORMAT_BC7_UNORM;
+		if (!CompressORM(mips, report.Format, compressed, report.Error))
+		{
+			return false;
+		}
+	}
+
+	std::filesystem::create_directories(cacheDir, error);
+
+	auto hr = SaveToDDSFile(
+		compressed.GetImages(),
+		compressed.GetImageCount(),
+		compressed.GetMetadata(),
+		DDS_FLAGS_NONE,
+		cachePath.c_str());
+	if (FAILED(hr))
+	{
+		ELOG("Error : DirectX::SaveToDDSFile() Failed. path = %ls, retcode = 0x%x", cachePath.c_str(), hr);
+		return false;
+	}
+
+	const auto& metadata = compressed.GetMetadata();
+	report.Width = packed.Width;
+	report.Height = packed.Height;
+	report.PackedBytes = CalcTextureBytes(metadata.format, metadata.width, metadata.height, metadata.mipLevels);
+	report.PackedBitsPerTexel = double(BitsPerPixel(metadata.format));
+
+	ILOG("ORMTexturePacker : %ls, %.3f ms", cacheName.c_str(), GetElapsedMilliseconds(start));
+
+	material.ORMMap = relativePath;
+
+	if (pReport != nullptr)
+	{
+		*pReport = report;
+	}
+	return true;
+}
+
+void LogORMPackReport(const wchar_t* name, const ORMPackReport& report)
+{
+	auto bandwidthRatio = (report.SourceBitsPerTexel > 0.0)
+		? 100.0 * (1.0 - report.PackedBitsPerTexel / report.SourceBitsPerTexel)
+		: 0.0;
+
+	ILOG("ORMTexturePacker : %ls -> %s %ux%u%s", name, GetFormatName(report.Format), report.Width, report.Height, report.CacheHit ? " (cache hit)" : "");
+	ILOG("  Specular AA %s", report.NormalVariance ? "normal variance folded into roughness mips" : "off (no normal map)");
+	ILOG("  Descriptors %u -> 1, Fetches %u -> 1 per pixel", report.SourceBindCount, report.SourceBindCount);
+	ILOG("  Bandwidth   %.1f -> %.1f bits/texel (%.1f%% saved)", report.SourceBitsPerTexel, report.PackedBitsPerTexel, bandwidthRatio);
+	ILOG("  Memory      %.2f MB -> %.2f MB", double(report.SourceBytes) / (1024.0 * 1024.0), double(report.PackedBytes) / (1024.0 * 1024.0));
+
+	if (!report.CacheHit)
+	{
+		ILOG("  Error       RMSE = %.6f, MaxError = %.6f, PSNR = %.2f dB", report.Error.RMSE, report.Error.MaxError, report.Error.PSNR);
+	}
+}
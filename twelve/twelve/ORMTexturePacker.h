@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <string>
+
+#include "CubeMapUtil.h"
+#include "ResMesh.h"
+
+/// <summary>
+/// ORMテクスチャの1チャンネル分の入力
+/// </summary>
+struct ORMChannelSource
+{
+	const CpuImage*	pImage = nullptr;		// 入力画像 (nullptrの場合は DefaultValue で埋める)
+	uint32_t		Channel = 0;			// 取り出すチャンネル (0:R, 1:G, 2:B, 3:A)
+	float			DefaultValue = 0.0f;	// 入力画像がない場合の値
+};
+
+/// <summary>
+/// ORMテクスチャのパック結果
+/// </summary>
+struct ORMPackReport
+{
+	DXGI_FORMAT	Format = DXGI_FORMAT_UNKNOWN;	// 保存したフォーマット
+	uint32_t	Width = 0;						// 横幅
+	uint32_t	Height = 0;						// 縦幅
+	uint32_t	SourceBindCount = 0;			// まとめる前のバインド数 (ディスクリプタ数, 1ピクセルあたりのフェッチ数)
+	uint64_t	SourceBytes = 0;				// まとめる前のテクスチャのメモリ量 (ミップを含む)
+	uint64_t	PackedBytes = 0;				// まとめた後のテクスチャのメモリ量 (ミップを含む)
+	double		SourceBitsPerTexel = 0.0;		// まとめる前に1ピクセルでフェッチするビット数の合計
+	double		PackedBitsPerTexel = 0.0;		// まとめた後に1ピクセルでフェッチするビット数
+	ImageError	Error;							// 圧縮前後の誤差 (キャッシュにヒットした場合は計測しない)
+	bool		NormalVariance = false;			// 法線マップの分散を粗さのミップに加算したかどうか
+	bool		CacheHit = false;				// キャッシュにヒットしたかどうか
+};
+
+/// <summary>
+/// AO・粗さ・金属度を1枚のRGB画像 (R:AO, G:粗さ, B:金属度, A:1) にまとめる
+/// 出力サイズは入力の最大サイズを4の倍数に切り上げたもの (入力がない場合は4x4) で, サイズの異なる入力はバイリニア補間で拡縮する
+/// </summary>
+/// <param name="sources">R, G, B チャンネルの入力</param>
+/// <param name="result">出力画像の格納先</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+void PackORMImage(const ORMChannelSource sources[3], CpuImage& result, uint32_t threadCount = 0);
+
+/// <summary>
+/// マテリアルのAO・粗さ・金属度マップを1枚のORMテクスチャ (BC1 / BC7) にまとめ, ResMaterial::ORMMap に設定する
+/// BC1で基準のPSNRを満たす場合はBC1, 満たさない場合はBC7で保存する
+/// 結果は入力ファイルのハッシュ値をキーに <入力のディレクトリ>/Cache にDDSとしてキャッシュする
+/// glTFのように金属度と粗さが同じファイルの場合は, 粗さをG, 金属度をBチャンネルから取り出す
+/// ResMaterial::NormalMap がある場合は, 法線マップのミップで失われる分散を粗さのミップに加算する (Toksvig)
+/// </summary>
+/// <param name="directory">マテリアルのテクスチャパスの基準ディレクトリ</param>
+/// <param name="material">マテリアル (ORMMap に directory からの相対パスを設定する)</param>
+/// <param name="pReport">パック結果の格納先 (nullptrの場合は格納しない)</param>
+/// <returns>ORMテクスチャが用意できた場合はtrue</returns>
+bool PackMaterialORM(const std::wstring& directory, ResMaterial& material, ORMPackReport* pReport = nullptr);
+
+/// <summary>
+/// パック結果 (削減したディスクリプタ数, 帯域, メモリ量, 誤差) をログに出力する
+/// </summary>
+/// <param name="name">ログに表示する名前</param>
+/// <param name="report">パック結果</param>
+void LogORMPackReport(const wchar_t* name, const ORMPackReport& report);
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// 利用するワーカースレッド数を取得する
+/// </summary>
+/// <returns>ハードウェアスレッド数 (取得できない場合は1)</returns>
+inline uint32_t GetWorkerThreadCount()
+{
+	auto count = std::thread::hardware_concurrency();
+	return (count == 0) ? 1 : count;
+}
+
+/// <summary>
+/// [begin, end) の各インデックスに対して処理を並列実行する
+/// インデックスはアトミックカウンタで配るため, 処理量に偏りがあっても負荷が分散される
+/// </summary>
+/// <param name="begin">開始インデックス</param>
+/// <param name="end">終了インデックス (含まない)</param>
+/// <param name="func">void(uint32_t index) の形式の処理</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+template<typename Func>
+inline void ParallelFor(uint32_t begin, uint32_t end, const Func& func, uint32_t threadCount = 0)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	auto count = end - begin;
+
+	if (threadCount == 0)
+	{
+		threadCount = GetWorkerThreadCount();
+	}
+
+	threadCount = std::min(threadCount, count);
+
+	// 1スレッドで済む場合はそのまま実行
+	if (threadCount <= 1)
+	{
+		for (auto i = begin; i < end; ++i)
+		{
+			func(i);
+		}
+		return;
+	}
+
+	std::atomic<uint32_t> next(begin);
+
+	auto worker = [&]()
+	{
+		for (;;)
+		{
+			auto i = next.fetch_add(1);
+			if (i >= end)
+			{
+				break;
+			}
+
+			func(i);
+		}
+	};
+
+	// 呼び出し元スレッドも処理に参加する
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+
+	for (auto i = 1u; i < threadCount; ++i)
+	{
+		threads.emplace_back(worker);
+	}
+
+	worker();
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+}
@@ -0,0 +1,349 @@
+﻿#include "PipelineCache.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <d3dcompiler.h>
+
+#include "FileUtil.h"
+#include "HashUtil.h"
+#include "Logger.h"
+
+namespace
+{
+	double GetElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+}
+
+PipelineCache::PipelineCache()
+	: m_Dirty(false)
+{
+}
+
+PipelineCache::~PipelineCache()
+{
+	Term();
+}
+
+bool PipelineCache::Init(ID3D12Device* pDevice, const wchar_t* path)
+{
+	if (pDevice == nullptr || path == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	m_pDevice = pDevice;
+	m_Path = path;
+	m_Dirty = false;
+	m_Stats = PipelineCacheStats();
+
+	// パイプラインライブラリは ID3D12Device1 以降で使える
+	auto hr = pDevice->QueryInterface(IID_PPV_ARGS(m_pDevice1.GetAddressOf()));
+	if (FAILED(hr))
+	{
+		ILOG("Info : ID3D12PipelineLibrary Not Supported. Pipelines are cached in memory only.");
+		return true;
+	}
+
+	// 保存したライブラリを読み込む
+	{
+		std::ifstream stream(m_Path, std::ios::binary);
+		if (stream)
+		{
+			stream.seekg(0, std::ios::end);
+			auto size = size_t(stream.tellg());
+			stream.seekg(0, std::ios::beg);
+
+			m_LibraryData.resize(size);
+			stream.read(reinterpret_cast<char*>(m_LibraryData.data()), size);
+			if (!stream)
+			{
+				m_LibraryData.clear();
+			}
+		}
+	}
+
+	if (!m_LibraryData.empty())
+	{
+		hr = m_pDevice1->CreatePipelineLibrary(
+			m_LibraryData.data(),
+			m_LibraryData.size(),
+			IID_PPV_ARGS(m_pLibrary.GetAddressOf()));
+		if (SUCCEEDED(hr))
+		{
+			return true;
+		}
+
+		// ドライバーやアダプターが変わった場合は作り直す
+		ILOG("Info : Pipeline Library Discarded. path = %ls, retcode = 0x%x", m_Path.c_str(), hr);
+		m_pLibrary.Reset();
+		m_LibraryData.clear();
+	}
+
+	hr = m_pDevice1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(m_pLibrary.GetAddressOf()));
+	if (FAILED(hr))
+	{
+		// ドライバーが対応していない場合はメモリ上のキャッシュのみ使う
+		ILOG("Info : ID3D12Device1::CreatePipelineLibrary() Failed. retcode = 0x%x", hr);
+		m_pLibrary.Reset();
+	}
+
+	return true;
+}
+
+void PipelineCache::Term()
+{
+	std::lock_guard<std::mutex> locker(m_Mutex);
+
+	m_Pipelines.clear();
+	m_Shaders.clear();
+	m_pLibrary.Reset();
+	m_LibraryData.clear();
+	m_LibraryData.shrink_to_fit();
+	m_pDevice1.Reset();
+	m_pDevice.Reset();
+	m_Dirty = false;
+}
+
+bool PipelineCache::Save()
+{
+	std::lock_guard<std::mutex> locker(m_Mutex);
+
+	if (m_pLibrary == nullptr || !m_Dirty)
+	{
+		return true;
+	}
+
+	std::vector<uint8_t> data(m_pLibrary->GetSerializedSize());
+
+	auto hr = m_pLibrary->Serialize(data.data(), data.size());
+	if (FAILED(hr))
+	{
+		ELOG("Error : ID3D12PipelineLibrary::Serialize() Failed. retcode = 0x%x", hr);
+		return false;
+	}
+
+	std::error_code error;
+	auto directory = std::filesystem::path(m_Path).parent_path();
+	if (!directory.empty())
+	{
+		std::filesystem::create_directories(directory, error);
+	}
+
+	std::ofstream stream(m_Path, std::ios::binary);
+	if (!stream)
+	{
+		ELOG("Error : File Open Failed. path = %ls", m_Path.c_str());
+		return false;
+	}
+
+	stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+	if (!stream)
+	{
+		ELOG("Error : File Write Failed. path = %ls", m_Path.c_str());
+		return false;
+	}
+
+	m_Dirty = false;
+
+	ILOG("Info : Pipeline Library Saved. path = %ls, size = %zu bytes, memory hit = %u, library hit = %u (%.2f ms), created = %u (%.2f ms)",
+		m_Path.c_str(),
+		data.size(),
+		m_Stats.MemoryHitCount,
+		m_Stats.LibraryHitCount,
+		m_Stats.LibraryMs,
+		m_Stats.CreateCount,
+		m_Stats.CreateMs);
+
+	return true;
+}
+
+bool PipelineCache::LoadShader(const wchar_t* filename, D3D12_SHADER_BYTECODE& result)
+{
+	std::lock_guard<std::mutex> locker(m_Mutex);
+
+	auto itr = m_Shaders.find(filename);
+	if (itr != m_Shaders.end())
+	{
+		result.pShaderBytecode = itr->second->GetBufferPointer();
+		result.BytecodeLength = itr->second->GetBufferSize();
+		m_Stats.ShaderHitCount++;
+		return true;
+	}
+
+	std::wstring path;
+	if (!SearchFilePath(filename, path))
+	{
+		ELOG("Error : Shader Not Found. filename = %ls", filename);
+		return false;
+	}
+
+	ComPtr<ID3DBlob> pBlob;
+	auto hr = D3DReadFileToBlob(path.c_str(), pBlob.GetAddressOf());
+	if (FAILED(hr))
+	{
+		ELOG("Error : D3DReadFileToBlob() Failed. path = %ls", path.c_str());
+		return false;
+	}
+
+	result.pShaderBytecode = pBlob->GetBufferPointer();
+	result.BytecodeLength = pBlob->GetBufferSize();
+
+	m_Shaders[filename] = pBlob;
+	m_Stats.ShaderLoadCount++;
+
+	return true;
+}
+
+template<typename LoadFunc, typename CreateFunc>
+bool PipelineCache::GetPipeline(uint64_t key, ID3D12PipelineState** ppPSO, LoadFunc load, CreateFunc create)
+{
+	if (ppPSO == nullptr || m_pDevice == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	std::lock_guard<std::mutex> locker(m_Mutex);
+
+	// 生成済み
+	auto itr = m_Pipelines.find(key);
+	if (itr != m_Pipelines.end())
+	{
+		*ppPSO = itr->second.Get();
+		(*ppPSO)->AddRef();
+		m_Stats.MemoryHitCount++;
+		return true;
+	}
+
+	auto name = ToHexString(key);
+	ComPtr<ID3D12PipelineState> pPSO;
+
+	// ライブラリから読み込む (登録されていない場合や構成設定が一致しない場合は失敗する)
+	if (m_pLibrary != nullptr)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto hr = load(name.c_str(), pPSO.GetAddressOf());
+		if (SUCCEEDED(hr))
+		{
+			m_Stats.LibraryHitCount++;
+			m_Stats.LibraryMs += GetElapsedMilliseconds(start);
+		}
+		else
+		{
+			pPSO.Reset();
+		}
+	}
+
+	if (pPSO == nullptr)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto hr = create(pPSO.GetAddressOf());
+		if (FAILED(hr))
+		{
+			ELOG("Error : Pipeline State Create Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		m_Stats.CreateCount++;
+		m_Stats.CreateMs += GetElapsedMilliseconds(start);
+
+		if (m_pLibrary != nullptr)
+		{
+			hr = m_pLibrary->StorePipeline(name.c_str(), pPSO.Get());
+			if (SUCCEEDED(hr))
+			{
+				m_Dirty = true;
+			}
+			else
+			{
+				ELOG("Error : ID3D12PipelineLibrary::StorePipeline() Failed. name = %ls, retcode = 0x%x", name.c_str(), hr);
+			}
+		}
+	}
+
+	m_Pipelines[key] = pPSO;
+
+	*ppPSO = pPSO.Get();
+	(*ppPSO)->AddRef();
+
+	return true;
+}
+
+bool PipelineCache::GetGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** ppPSO)
+{
+	auto key = ComputeGraphicsPipelineKey(desc, rootSignatureHash);
+
+	return GetPipeline(key, ppPSO,
+		[&](const wchar_t* name, ID3D12PipelineState** ppResult)
+		{
+			return m_pLibrary->LoadGraphicsPipeline(name, &desc, IID_PPV_ARGS(ppResult));
+		},
+		[&](ID3D12PipelineState** ppResult)
+		{
+			return m_pDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(ppResult));
+		});
+}
+
+bool PipelineCache::GetComputePipeline(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** ppPSO)
+{
+	auto key = ComputeComputePipelineKey(desc, rootSignatureHash);
+
+	return GetPipeline(key, ppPSO,
+		[&](const wchar_t* name, ID3D12PipelineState** ppResult)
+		{
+			return m_pLibrary->LoadComputePipeline(name, &desc, IID_PPV_ARGS(ppResult));
+		},
+		[&](ID3D12PipelineState** ppResult)
+		{
+			return m_pDevice->CreateComputePipelineState(&desc, IID_PPV_ARGS(ppResult));
+		});
+}
+
+bool CreateGraphicsPipeline(
+	ID3D12Device* pDevice,
+	PipelineCache* pCache,
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+	uint64_t rootSignatureHash,
+	ID3D12PipelineState** ppPSO)
+{
+	if (pCache != nullptr)
+	{
+		return pCache->GetGraphicsPipeline(desc, rootSignatureHash, ppPSO);
+	}
+
+	auto hr = pDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(ppPSO));
+	if (FAILED(hr))
+	{
+		ELOG("Error : ID3D12Device::CreateGraphicsPipelineState() Failed. retcode = 0x%x", hr);
+		return false;
+	}
+
+	return true;
+}
+
+bool CreateComputePipeline(
+	ID3D12Device* pDevice,
+	PipelineCache* pCache,
+	const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc,
+	uint64_t rootSignatureHash,
+	ID3D12PipelineState** ppPSO)
+{
+	if (pCache != nullptr)
+	{
+		return pCache->GetComputePipeline(desc, rootSignatureHash, ppPSO);
+	}
+
+	auto hr = pDevice->CreateComputePipelineState(&desc, IID_PPV_ARGS(ppPSO));
+	if (FAILED(hr))
+	{
+		ELOG("Error : ID3D12Device::CreateComputePipelineState() Failed. retcode = 0x%x", hr);
+		return false;
+	}
+
+	return true;
+}
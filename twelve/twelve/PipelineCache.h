@@ -0,0 +1,141 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <d3dcommon.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ComPtr.h"
+#include "PipelineKey.h"
+
+/// <summary>
+/// パイプラインキャッシュの統計値
+/// </summary>
+struct PipelineCacheStats
+{
+	uint32_t	MemoryHitCount = 0;		// 生成済みのものを返した数
+	uint32_t	LibraryHitCount = 0;	// パイプラインライブラリから読み込んだ数
+	uint32_t	CreateCount = 0;		// 新たに生成した数
+	uint32_t	ShaderLoadCount = 0;	// シェーダーファイルを読み込んだ数
+	uint32_t	ShaderHitCount = 0;		// 読み込み済みのシェーダーを返した数
+	double		LibraryMs = 0.0;		// パイプラインライブラリからの読み込みにかかった時間 [ms]
+	double		CreateMs = 0.0;			// 生成にかかった時間 [ms]
+};
+
+/// <summary>
+/// パイプラインステートのキャッシュ
+/// 構成設定を正規化したキー (ComputeGraphicsPipelineKey()) でパイプラインステートを共有し,
+/// 生成したものは ID3D12PipelineLibrary に登録して Save() でファイルに書き出す
+/// 次回起動時はファイルから読み込んだライブラリを使うので, ドライバーでのシェーダーのコンパイルを省略できる
+/// ドライバーやアダプターが変わってライブラリが使えない場合は作り直す
+/// </summary>
+class PipelineCache
+{
+public:
+	PipelineCache();
+	~PipelineCache();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="path">パイプラインライブラリの保存先</param>
+	/// <returns>初期化に成功した場合はtrue (ライブラリが使えない環境でもキャッシュとしては動作する)</returns>
+	bool Init(ID3D12Device* pDevice, const wchar_t* path);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// 新たに登録したパイプラインがあればライブラリをファイルに保存する
+	/// </summary>
+	/// <returns>保存に成功した場合 (または保存の必要がない場合) はtrue</returns>
+	bool Save();
+
+	/// <summary>
+	/// コンパイル済みシェーダー (.cso) を読み込む
+	/// 同じファイルは一度だけ読み込み, バイトコードはキャッシュの終了処理まで有効
+	/// </summary>
+	/// <param name="filename">ファイル名 (SearchFilePath() で検索する)</param>
+	/// <param name="result">バイトコードの格納先</param>
+	/// <returns>読み込みに成功した場合はtrue</returns>
+	bool LoadShader(const wchar_t* filename, D3D12_SHADER_BYTECODE& result);
+
+	/// <summary>
+	/// グラフィックスパイプラインステートを取得する
+	/// </summary>
+	/// <param name="desc">構成設定</param>
+	/// <param name="rootSignatureHash">ルートシグネチャのハッシュ値 (RootSignature::GetHash())</param>
+	/// <param name="ppPSO">パイプラインステートの格納先</param>
+	/// <returns>取得に成功した場合はtrue</returns>
+	bool GetGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** ppPSO);
+
+	/// <summary>
+	/// コンピュートパイプラインステートを取得する
+	/// </summary>
+	/// <param name="desc">構成設定</param>
+	/// <param name="rootSignatureHash">ルートシグネチャのハッシュ値 (RootSignature::GetHash())</param>
+	/// <param name="ppPSO">パイプラインステートの格納先</param>
+	/// <returns>取得に成功した場合はtrue</returns>
+	bool GetComputePipeline(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash, ID3D12PipelineState** ppPSO);
+
+	const PipelineCacheStats& GetStats() const { return m_Stats; }
+
+private:
+	ComPtr<ID3D12Device>											m_pDevice;
+	ComPtr<ID3D12Device1>											m_pDevice1;
+	ComPtr<ID3D12PipelineLibrary>									m_pLibrary;
+	std::vector<uint8_t>											m_LibraryData;		// ライブラリが参照するので破棄まで保持する
+	std::wstring													m_Path;
+	std::unordered_map<uint64_t, ComPtr<ID3D12PipelineState>>		m_Pipelines;
+	std::unordered_map<std::wstring, ComPtr<ID3DBlob>>				m_Shaders;
+	PipelineCacheStats												m_Stats;
+	bool															m_Dirty;			// ライブラリに新たに登録したかどうか
+	std::mutex														m_Mutex;
+
+	/// <summary>
+	/// キーに対応するパイプラインを返す (生成済みのものがない場合は load, create の順に試す)
+	/// </summary>
+	template<typename LoadFunc, typename CreateFunc>
+	bool GetPipeline(uint64_t key, ID3D12PipelineState** ppPSO, LoadFunc load, CreateFunc create);
+
+	PipelineCache(const PipelineCache&) = delete;
+	void operator=(const PipelineCache&) = delete;
+};
+
+/// <summary>
+/// グラフィックスパイプラインステートを生成する (キャッシュが指定されていればキャッシュから取得する)
+/// </summary>
+/// <param name="pDevice">デバイス</param>
+/// <param name="pCache">パイプラインキャッシュ (nullptrの場合は直接生成する)</param>
+/// <param name="desc">構成設定</param>
+/// <param name="rootSignatureHash">ルートシグネチャのハッシュ値</param>
+/// <param name="ppPSO">パイプラインステートの格納先</param>
+/// <returns>生成に成功した場合はtrue</returns>
+bool CreateGraphicsPipeline(
+	ID3D12Device* pDevice,
+	PipelineCache* pCache,
+	const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+	uint64_t rootSignatureHash,
+	ID3D12PipelineState** ppPSO);
+
+/// <summary>
+/// コンピュートパイプラインステートを生成する (キャッシュが指定されていればキャッシュから取得する)
+/// </summary>
+/// <param name="pDevice">デバイス</param>
+/// <param name="pCache">パイプラインキャッシュ (nullptrの場合は直接生成する)</param>
+/// <param name="desc">構成設定</param>
+/// <param name="rootSignatureHash">ルートシグネチャのハッシュ値</param>
+/// <param name="ppPSO">パイプラインステートの格納先</param>
+/// <returns>生成に成功した場合はtrue</returns>
+bool CreateComputePipeline(
+	ID3D12Device* pDevice,
+	PipelineCache* pCache,
+	const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc,
+	uint64_t rootSignatureHash,
+	ID3D12PipelineState** ppPSO);
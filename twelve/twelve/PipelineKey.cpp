@@ -0,0 +1,329 @@
+﻿#include "PipelineKey.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "HashUtil.h"
+
+namespace
+{
+	const uint32_t PipelineKeyVersion = 1;	// 正規化の方法を変えた場合は更新する
+
+	/// <summary>
+	/// 項目ごとにハッシュ値を積み上げる (構造体のパディングを含めないようにする)
+	/// </summary>
+	class KeyBuilder
+	{
+	public:
+		KeyBuilder()
+			: m_Hash(HashOffsetBasis)
+		{
+		}
+
+		template<typename T>
+		void Add(T value)
+		{
+			static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "T must be arithmetic or enum.");
+			m_Hash = ComputeHash(value, m_Hash);
+		}
+
+		/// <summary>
+		/// セマンティクス名を追加する (大文字と小文字を区別しないので大文字にそろえる)
+		/// </summary>
+		void AddSemantic(const char* name)
+		{
+			auto length = 0u;
+			if (name != nullptr)
+			{
+				for (auto p = name; *p != '\0'; ++p, ++length)
+				{
+					auto c = *p;
+					if (c >= 'a' && c <= 'z')
+					{
+						c = char(c - 'a' + 'A');
+					}
+					Add(c);
+				}
+			}
+			Add(length);
+		}
+
+		uint64_t GetHash() const { return m_Hash; }
+
+	private:
+		uint64_t m_Hash;
+	};
+
+	/// <summary>
+	/// 頂点フォーマットのバイト数を取得する (D3D12_APPEND_ALIGNED_ELEMENT の解決に使う)
+	/// </summary>
+	/// <returns>バイト数 (対応していないフォーマットの場合は0)</returns>
+	uint32_t GetVertexFormatSize(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		case DXGI_FORMAT_R32G32B32A32_UINT:
+		case DXGI_FORMAT_R32G32B32A32_SINT:
+			return 16;
+
+		case DXGI_FORMAT_R32G32B32_FLOAT:
+		case DXGI_FORMAT_R32G32B32_UINT:
+		case DXGI_FORMAT_R32G32B32_SINT:
+			return 12;
+
+		case DXGI_FORMAT_R32G32_FLOAT:
+		case DXGI_FORMAT_R32G32_UINT:
+		case DXGI_FORMAT_R32G32_SINT:
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+		case DXGI_FORMAT_R16G16B16A16_UINT:
+		case DXGI_FORMAT_R16G16B16A16_SNORM:
+		case DXGI_FORMAT_R16G16B16A16_SINT:
+			return 8;
+
+		case DXGI_FORMAT_R32_FLOAT:
+		case DXGI_FORMAT_R32_UINT:
+		case DXGI_FORMAT_R32_SINT:
+		case DXGI_FORMAT_R16G16_FLOAT:
+		case DXGI_FORMAT_R16G16_UNORM:
+		case DXGI_FORMAT_R16G16_UINT:
+		case DXGI_FORMAT_R16G16_SNORM:
+		case DXGI_FORMAT_R16G16_SINT:
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UINT:
+		case DXGI_FORMAT_R8G8B8A8_SNORM:
+		case DXGI_FORMAT_R8G8B8A8_SINT:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+		case DXGI_FORMAT_R10G10B10A2_UINT:
+		case DXGI_FORMAT_R11G11B10_FLOAT:
+			return 4;
+
+		case DXGI_FORMAT_R16_FLOAT:
+		case DXGI_FORMAT_R16_UNORM:
+		case DXGI_FORMAT_R16_UINT:
+		case DXGI_FORMAT_R16_SNORM:
+		case DXGI_FORMAT_R16_SINT:
+		case DXGI_FORMAT_R8G8_UNORM:
+		case DXGI_FORMAT_R8G8_UINT:
+		case DXGI_FORMAT_R8G8_SNORM:
+		case DXGI_FORMAT_R8G8_SINT:
+			return 2;
+
+		default:
+			return 0;
+		}
+	}
+
+	void AddInputLayout(KeyBuilder& builder, const D3D12_INPUT_LAYOUT_DESC& layout)
+	{
+		const auto slotCount = D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+		uint32_t nextOffset[slotCount] = {};
+
+		builder.Add(layout.NumElements);
+
+		for (auto i = 0u; i < layout.NumElements; ++i)
+		{
+			auto& element = layout.pInputElementDescs[i];
+
+			auto offset = element.AlignedByteOffset;
+			if (element.InputSlot < slotCount)
+			{
+				if (offset == D3D12_APPEND_ALIGNED_ELEMENT)
+				{
+					offset = nextOffset[element.InputSlot];
+				}
+				nextOffset[element.InputSlot] = offset + GetVertexFormatSize(element.Format);
+			}
+
+			builder.AddSemantic(element.SemanticName);
+			builder.Add(element.SemanticIndex);
+			builder.Add(element.Format);
+			builder.Add(element.InputSlot);
+			builder.Add(offset);
+			builder.Add(element.InputSlotClass);
+			builder.Add((element.InputSlotClass == D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA) ? element.InstanceDataStepRate : 0u);
+		}
+	}
+
+	void AddStreamOutput(KeyBuilder& builder, const D3D12_STREAM_OUTPUT_DESC& so)
+	{
+		builder.Add(so.NumEntries);
+		for (auto i = 0u; i < so.NumEntries; ++i)
+		{
+			auto& entry = so.pSODeclaration[i];
+			builder.Add(entry.Stream);
+			builder.AddSemantic(entry.SemanticName);
+			builder.Add(entry.SemanticIndex);
+			builder.Add(entry.StartComponent);
+			builder.Add(entry.ComponentCount);
+			builder.Add(entry.OutputSlot);
+		}
+
+		builder.Add(so.NumStrides);
+		for (auto i = 0u; i < so.NumStrides; ++i)
+		{
+			builder.Add(so.pBufferStrides[i]);
+		}
+
+		builder.Add((so.NumEntries > 0) ? so.RasterizedStream : 0u);
+	}
+
+	void AddBlend(KeyBuilder& builder, const D3D12_BLEND_DESC& blend, uint32_t renderTargetCount)
+	{
+		// レンダーターゲットが1つ以下の場合は IndependentBlendEnable に意味がない
+		auto independent = (blend.IndependentBlendEnable != FALSE) && (renderTargetCount > 1);
+		auto count = (renderTargetCount == 0) ? 0u : (independent ? renderTargetCount : 1u);
+
+		builder.Add(blend.AlphaToCoverageEnable != FALSE);
+		builder.Add(independent);
+
+		for (auto i = 0u; i < count; ++i)
+		{
+			auto& rt = blend.RenderTarget[i];
+			auto blendEnable = (rt.BlendEnable != FALSE);
+			auto logicOpEnable = (rt.LogicOpEnable != FALSE);
+
+			builder.Add(blendEnable);
+			if (blendEnable)
+			{
+				builder.Add(rt.SrcBlend);
+				builder.Add(rt.DestBlend);
+				builder.Add(rt.BlendOp);
+				builder.Add(rt.SrcBlendAlpha);
+				builder.Add(rt.DestBlendAlpha);
+				builder.Add(rt.BlendOpAlpha);
+			}
+
+			builder.Add(logicOpEnable);
+			if (logicOpEnable)
+			{
+				builder.Add(rt.LogicOp);
+			}
+
+			builder.Add(rt.RenderTargetWriteMask);
+		}
+	}
+
+	void AddRasterizer(KeyBuilder& builder, const D3D12_RASTERIZER_DESC& raster)
+	{
+		builder.Add(raster.FillMode);
+		builder.Add(raster.CullMode);
+		builder.Add(raster.FrontCounterClockwise != FALSE);
+		builder.Add(raster.DepthBias);
+		builder.Add(raster.DepthBiasClamp);
+		builder.Add(raster.SlopeScaledDepthBias);
+		builder.Add(raster.DepthClipEnable != FALSE);
+		builder.Add(raster.MultisampleEnable != FALSE);
+		builder.Add(raster.AntialiasedLineEnable != FALSE);
+		builder.Add(raster.ForcedSampleCount);
+		builder.Add(raster.ConservativeRaster);
+	}
+
+	void AddStencilOp(KeyBuilder& builder, const D3D12_DEPTH_STENCILOP_DESC& op)
+	{
+		builder.Add(op.StencilFailOp);
+		builder.Add(op.StencilDepthFailOp);
+		builder.Add(op.StencilPassOp);
+		builder.Add(op.StencilFunc);
+	}
+
+	void AddDepthStencil(KeyBuilder& builder, const D3D12_DEPTH_STENCIL_DESC& ds)
+	{
+		auto depthEnable = (ds.DepthEnable != FALSE);
+		auto stencilEnable = (ds.StencilEnable != FALSE);
+
+		builder.Add(depthEnable);
+		if (depthEnable)
+		{
+			builder.Add(ds.DepthWriteMask);
+			builder.Add(ds.DepthFunc);
+		}
+
+		builder.Add(stencilEnable);
+		if (stencilEnable)
+		{
+			builder.Add(ds.StencilReadMask);
+			builder.Add(ds.StencilWriteMask);
+			AddStencilOp(builder, ds.FrontFace);
+			AddStencilOp(builder, ds.BackFace);
+		}
+	}
+}
+
+uint64_t ComputeShaderHash(const D3D12_SHADER_BYTECODE& shader)
+{
+	if (shader.pShaderBytecode == nullptr || shader.BytecodeLength == 0)
+	{
+		return 0;
+	}
+
+	auto pBytes = static_cast<const uint8_t*>(shader.pShaderBytecode);
+	auto size = uint64_t(shader.BytecodeLength);
+
+	// DXBCコンテナはヘッダーの4バイト目から16バイトのチェックサムを持つ
+	const size_t ChecksumOffset = 4;
+	const size_t ChecksumSize = 16;
+	if (shader.BytecodeLength >= ChecksumOffset + ChecksumSize && memcmp(pBytes, "DXBC", 4) == 0)
+	{
+		auto hash = ComputeHash(static_cast<const void*>(pBytes + ChecksumOffset), ChecksumSize);
+		return ComputeHash(size, hash);
+	}
+
+	auto hash = ComputeHash(shader.pShaderBytecode, shader.BytecodeLength);
+	return ComputeHash(size, hash);
+}
+
+uint64_t ComputeGraphicsPipelineKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash)
+{
+	KeyBuilder builder;
+	builder.Add(PipelineKeyVersion);
+	builder.Add(uint32_t(0));		// グラフィックス
+	builder.Add(rootSignatureHash);
+
+	builder.Add(ComputeShaderHash(desc.VS));
+	builder.Add(ComputeShaderHash(desc.PS));
+	builder.Add(ComputeShaderHash(desc.DS));
+	builder.Add(ComputeShaderHash(desc.HS));
+	builder.Add(ComputeShaderHash(desc.GS));
+
+	AddStreamOutput(builder, desc.StreamOutput);
+
+	auto renderTargetCount = std::min<uint32_t>(desc.NumRenderTargets, D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
+	AddBlend(builder, desc.BlendState, renderTargetCount);
+
+	builder.Add(desc.SampleMask);
+	AddRasterizer(builder, desc.RasterizerState);
+	AddDepthStencil(builder, desc.DepthStencilState);
+	AddInputLayout(builder, desc.InputLayout);
+
+	builder.Add(desc.IBStripCutValue);
+	builder.Add(desc.PrimitiveTopologyType);
+
+	builder.Add(renderTargetCount);
+	for (auto i = 0u; i < renderTargetCount; ++i)
+	{
+		builder.Add(desc.RTVFormats[i]);
+	}
+
+	builder.Add(desc.DSVFormat);
+	builder.Add(desc.SampleDesc.Count);
+	builder.Add(desc.SampleDesc.Quality);
+	builder.Add(desc.Flags);
+
+	return builder.GetHash();
+}
+
+uint64_t ComputeComputePipelineKey(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash)
+{
+	KeyBuilder builder;
+	builder.Add(PipelineKeyVersion);
+	builder.Add(uint32_t(1));		// コンピュート
+	builder.Add(rootSignatureHash);
+	builder.Add(ComputeShaderHash(desc.CS));
+	builder.Add(desc.Flags);
+
+	return builder.GetHash();
+}
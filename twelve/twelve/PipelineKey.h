@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <d3d12.h>
+
+/// <summary>
+/// シェーダーのバイトコードのハッシュ値を計算する
+/// DXBCコンテナの場合はヘッダーのチェックサムとサイズのみを使うので, 内容全体を走査しない
+/// </summary>
+/// <param name="shader">バイトコード</param>
+/// <returns>ハッシュ値 (空の場合は0)</returns>
+uint64_t ComputeShaderHash(const D3D12_SHADER_BYTECODE& shader);
+
+/// <summary>
+/// グラフィックスパイプラインステートのキーを計算する
+/// ポインタではなく指す先の内容を使い, 結果に影響しない項目を正規化してから計算するので,
+/// 同じパイプラインになる構成設定は (別々に組み立てたものでも) 同じキーになる
+///  - 無効なレンダーターゲット (NumRenderTargets 以降) のフォーマットとブレンドを無視する
+///  - IndependentBlendEnable が無効の場合は RenderTarget[0] のみを使う
+///  - ブレンドが無効なレンダーターゲットのブレンド係数, 無効な深度/ステンシルの設定を無視する
+///  - D3D12_APPEND_ALIGNED_ELEMENT を実際のオフセットに置き換える
+///  - NodeMask と CachedPSO は無視する
+/// </summary>
+/// <param name="desc">構成設定</param>
+/// <param name="rootSignatureHash">ルートシグネチャのハッシュ値 (RootSignature::GetHash())</param>
+/// <returns>キー</returns>
+uint64_t ComputeGraphicsPipelineKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+/// <summary>
+/// コンピュートパイプラインステートのキーを計算する
+/// </summary>
+/// <param name="desc">構成設定</param>
+/// <param name="rootSignatureHash">ルートシグネチャのハッシュ値 (RootSignature::GetHash())</param>
+/// <returns>キー</returns>
+uint64_t ComputeComputePipelineKey(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
@@ -4,10 +4,12 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <assimp/cimport.h>
+#include <algorithm>
 #include <codecvt>
 #include <cassert>
 
 #include "Logger.h"
+#include "MeshInstancing.h"
 
 namespace
 {
@@ -35,6 +37,16 @@ namespace
 		return std::wstring(temp);
 	}
 
+	// assimp の行列 (列ベクトル形式) を行ベクトル形式に変換する
+	DirectX::XMFLOAT4X4 ToRowVectorMatrix(const aiMatrix4x4& m)
+	{
+		return DirectX::XMFLOAT4X4(
+			m.a1, m.b1, m.c1, m.d1,
+			m.a2, m.b2, m.c2, m.d2,
+			m.a3, m.b3, m.c3, m.d3,
+			m.a4, m.b4, m.c4, m.d4);
+	}
+
 	class MeshLoader
 	{
 	public:
@@ -44,12 +56,15 @@ namespace
 		bool Load(
 			const wchar_t* fileName,
 			std::vector<ResMesh>& meshes,
-			std::vector<ResMaterial>& materials);
+			std::vector<ResMaterial>& materials,
+			MeshImportMode mode);
 
 	private:
 		const aiScene* m_pScene = nullptr;
 
 		void ParseMesh(ResMesh& dstMesh, const aiMesh* pSrcMesh);
+		void ParseNode(std::vector<ResMesh>& meshes, const aiNode* pNode, const aiMatrix4x4& parentTransform);
+		void BuildInstances(std::vector<ResMesh>& meshes);
 		void ParseMaterial(ResMaterial& dstMaterial, const aiMaterial* pSrcMaterial);
 	};
 
@@ -62,7 +77,7 @@ namespace
 	{
 	}
 
-	bool MeshLoader::Load(const wchar_t* fileName, std::vector<ResMesh>& meshes, std::vector<ResMaterial>& materials)
+	bool MeshLoader::Load(const wchar_t* fileName, std::vector<ResMesh>& meshes, std::vector<ResMaterial>& materials, MeshImportMode mode)
 	{
 		if (fileName == nullptr)
 		{
@@ -76,13 +91,18 @@ namespace
 		Assimp::Importer importer;
 		int flag = 0;
 		flag |= aiProcess_Triangulate;
-		flag |= aiProcess_PreTransformVertices;
 		flag |= aiProcess_CalcTangentSpace;
 		flag |= aiProcess_GenSmoothNormals;
 		flag |= aiProcess_GenUVCoords;
 		flag |= aiProcess_RemoveRedundantMaterials;
 		flag |= aiProcess_OptimizeMeshes;
 
+		// インスタンス化する場合はノード階層を残し, 変換はインスタンスのデータとして持つ
+		if (mode == MESH_IMPORT_PRETRANSFORM)
+		{
+			flag |= aiProcess_PreTransformVertices;
+		}
+
 		// ファイルを読み込み
 		m_pScene = importer.ReadFile(path, flag);
 
@@ -103,6 +123,13 @@ namespace
 			ParseMesh(meshes[i], m_pScene->mMeshes[i]);
 		}
 
+		// ノード階層からインスタンスを作り, 同じデータのメッシュをまとめる
+		if (mode == MESH_IMPORT_INSTANCED)
+		{
+			BuildInstances(meshes);
+			LogMeshInstancingStats(fileName, ComputeMeshInstancingStats(meshes));
+		}
+
 		// マテリアルのメモリを確保
 		materials.clear();
 		materials.resize(m_pScene->mNumMaterials);
@@ -159,6 +186,49 @@ namespace
 		}
 	}
 
+	void MeshLoader::ParseNode(std::vector<ResMesh>& meshes, const aiNode* pNode, const aiMatrix4x4& parentTransform)
+	{
+		if (pNode == nullptr)
+		{
+			return;
+		}
+
+		// 親からの変換を累積する (列ベクトル形式なので親を左から掛ける)
+		auto transform = parentTransform * pNode->mTransformation;
+
+		MeshInstance instance;
+		instance.World = ToRowVectorMatrix(transform);
+
+		for (auto i = 0u; i < pNode->mNumMeshes; ++i)
+		{
+			auto index = pNode->mMeshes[i];
+			if (index < meshes.size())
+			{
+				meshes[index].Instances.push_back(instance);
+			}
+		}
+
+		for (auto i = 0u; i < pNode->mNumChildren; ++i)
+		{
+			ParseNode(meshes, pNode->mChildren[i], transform);
+		}
+	}
+
+	void MeshLoader::BuildInstances(std::vector<ResMesh>& meshes)
+	{
+		ParseNode(meshes, m_pScene->mRootNode, aiMatrix4x4());
+
+		// ノードから参照されないメッシュは描画されないので取り除く
+		// (インスタンスが空のメッシュは単位行列で描画されてしまう)
+		meshes.erase(
+			std::remove_if(meshes.begin(), meshes.end(), [](const ResMesh& mesh) { return mesh.Instances.empty(); }),
+			meshes.end());
+
+		// 別のメッシュとして複製された同じデータをまとめる
+		std::vector<uint32_t> remap;
+		DeduplicateMeshes(meshes, remap);
+	}
+
 	void MeshLoader::ParseMaterial(ResMaterial& dstMaterial, const aiMaterial* pSrcMaterial)
 	{
 		// 拡散反射成分
@@ -376,6 +446,24 @@ namespace
 				dstMaterial.RoughnessMap.clear();
 			}
 		}
+
+		// アンビエントオクルージョンマップ (glTFのオクルージョンはライトマップとして読み込まれる)
+		{
+			aiString path;
+
+			if (pSrcMaterial->GetTexture(aiTextureType_AMBIENT_OCCLUSION, 0, &path) == AI_SUCCESS
+				|| pSrcMaterial->GetTexture(aiTextureType_LIGHTMAP, 0, &path) == AI_SUCCESS)
+			{
+				dstMaterial.OcclusionMap = Convert(path);
+			}
+			else
+			{
+				dstMaterial.OcclusionMap.clear();
+			}
+
+			// パック済みのマップはクック時に設定する
+			dstMaterial.ORMMap.clear();
+		}
 	}
 }
 
@@ -392,9 +480,21 @@ const D3D12_INPUT_LAYOUT_DESC MeshVertex::InputLayout = {
 };
 static_assert(sizeof(MeshVertex) == 44, "Vertex struct/layout mismatch");
 
+const D3D12_INPUT_ELEMENT_DESC MeshInstance::InputElements[] = {
+	{ "INSTANCE_WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+	{ "INSTANCE_WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+	{ "INSTANCE_WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+	{ "INSTANCE_WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
+};
+const D3D12_INPUT_LAYOUT_DESC MeshInstance::InputLayout = {
+	MeshInstance::InputElements,
+	MeshInstance::InputElementCount
+};
+static_assert(sizeof(MeshInstance) == 64, "Instance struct/layout mismatch");
+
 
-bool LoadMesh(const wchar_t* fileName, std::vector<ResMesh>& meshes, std::vector<ResMaterial>& materials)
+bool LoadMesh(const wchar_t* fileName, std::vector<ResMesh>& meshes, std::vector<ResMaterial>& materials, MeshImportMode mode)
 {
 	MeshLoader loader;
-	return loader.Load(fileName, meshes, materials);
+	return loader.Load(fileName, meshes, materials, mode);
 }
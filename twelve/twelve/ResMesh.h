@@ -21,6 +21,8 @@ struct ResMaterial
 	float Roughness;					// 粗さ
 	std::wstring BaseColorMap;			// ベースカラーマップファイルパス
 	std::wstring MetallicRoughnessMap;	// 金属度・粗さマップファイルパス
+	std::wstring OcclusionMap;			// アンビエントオクルージョンマップファイルパス
+	std::wstring ORMMap;				// AO・粗さ・金属度をまとめたマップファイルパス (PackMaterialORM() で設定する)
 
 	// TODO: 後で削除
 	std::wstring MetallicMap;
@@ -56,11 +58,35 @@ private:
 	static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
 };
 
+/// <summary>
+/// メッシュのインスタンスごとのデータ (頂点バッファのスロット1に並べる)
+/// </summary>
+struct MeshInstance
+{
+	DirectX::XMFLOAT4X4 World; // ワールド行列 (行ベクトル形式, 頂点に右から掛ける)
+
+	static const D3D12_INPUT_LAYOUT_DESC InputLayout;
+
+private:
+	static const int InputElementCount = 4;
+	static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
+};
+
 struct ResMesh
 {
-	std::vector<MeshVertex> Vertices; // 頂点データ
-	std::vector<uint32_t> Indices;    // インデックスデータ
-	uint32_t MaterialId;              // マテリアル番号
+	std::vector<MeshVertex> Vertices;     // 頂点データ
+	std::vector<uint32_t> Indices;        // インデックスデータ
+	uint32_t MaterialId;                  // マテリアル番号
+	std::vector<MeshInstance> Instances;  // インスタンスのデータ (空の場合は単位行列の1インスタンスとして扱う)
+};
+
+/// <summary>
+/// メッシュの読み込み方法
+/// </summary>
+enum MeshImportMode
+{
+	MESH_IMPORT_PRETRANSFORM = 0,	// ノードの変換を頂点に焼き込み, 参照ごとに別のメッシュにする
+	MESH_IMPORT_INSTANCED,			// ノード階層を辿り, 同じデータのメッシュを1つにまとめてインスタンスの変換を持たせる
 };
 
 /// <summary>
@@ -69,8 +95,10 @@ struct ResMesh
 /// <param name="fileName">ファイルパス</param>
 /// <param name="meshes">メッシュの格納先</param>
 /// <param name="materials">マテリアルの格納先</param>
+/// <param name="mode">読み込み方法</param>
 /// <returns></returns>
 bool LoadMesh(
 	const wchar_t* fileName,
 	std::vector<ResMesh>& meshes,
-	std::vector<ResMaterial>& materials);
+	std::vector<ResMaterial>& materials,
+	MeshImportMode mode = MESH_IMPORT_PRETRANSFORM);
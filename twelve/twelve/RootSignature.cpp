@@ -1,5 +1,6 @@
 ﻿#include "RootSignature.h"
 
+#include "HashUtil.h"
 #include "Logger.h"
 
 RootSignature::Desc::Desc()
@@ -60,6 +61,55 @@ RootSignature::Desc& RootSignature::Desc::SetSmp(ShaderStage stage, int index, u
 	return *this;
 }
 
+RootSignature::Desc& RootSignature::Desc::SetConstants(ShaderStage stage, int index, uint32_t reg, uint32_t count)
+{
+	if (index >= m_Params.size())
+	{
+		return *this;
+	}
+
+	m_Params[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	m_Params[index].Constants.ShaderRegister = reg;
+	m_Params[index].Constants.RegisterSpace = 0;
+	m_Params[index].Constants.Num32BitValues = count;
+	m_Params[index].ShaderVisibility = D3D12_SHADER_VISIBILITY(stage);
+
+	CheckStage(stage);
+
+	return *this;
+}
+
+RootSignature::Desc& RootSignature::Desc::SetSRVArray(ShaderStage stage, int index, uint32_t reg, uint32_t space, uint32_t count)
+{
+	SetParam(stage, index, reg, D3D12_DESCRIPTOR_RANGE_TYPE_SRV);
+
+	if (index < m_Params.size())
+	{
+		m_Ranges[index].NumDescriptors = count;
+		m_Ranges[index].RegisterSpace = space;
+	}
+
+	return *this;
+}
+
+RootSignature::Desc& RootSignature::Desc::SetRootSRV(ShaderStage stage, int index, uint32_t reg)
+{
+	if (index >= m_Params.size())
+	{
+		return *this;
+	}
+
+	// ディスクリプタを使わずにバッファのアドレスを直接設定する
+	m_Params[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	m_Params[index].Descriptor.ShaderRegister = reg;
+	m_Params[index].Descriptor.RegisterSpace = 0;
+	m_Params[index].ShaderVisibility = D3D12_SHADER_VISIBILITY(stage);
+
+	CheckStage(stage);
+
+	return *this;
+}
+
 RootSignature::Desc& RootSignature::Desc::AddStaticSmp(ShaderStage stage, uint32_t reg, SamplerState state)
 {
 	D3D12_STATIC_SAMPLER_DESC desc = {};
@@ -125,6 +175,16 @@ RootSignature::Desc& RootSignature::Desc::AddStaticSmp(ShaderStage stage, uint32
 			desc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
 			desc.MaxAnisotropy = D3D12_MAX_MAXANISOTROPY;
 		} break;
+
+		case SamplerState::ShadowCompare:
+		{
+			// シャドウマップの比較サンプル (参照値がシャドウマップの深度以下なら1)
+			desc.Filter = D3D12_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+			desc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+			desc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+			desc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+			desc.ComparisonFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
+		} break;
 	}
 
 	m_Samplers.push_back(desc);
@@ -211,6 +271,7 @@ void RootSignature::Desc::SetParam(ShaderStage stage, int index, uint32_t reg, D
 }
 
 RootSignature::RootSignature()
+	: m_Hash(0)
 {
 }
 
@@ -240,10 +301,13 @@ bool RootSignature::Init(ID3D12Device* pDevice, const D3D12_ROOT_SIGNATURE_DESC*
 		return false;
 	}
 
+	m_Hash = ComputeHash(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), HashOffsetBasis);
+
 	return true;
 }
 
 void RootSignature::Term()
 {
 	m_pRootSignature.Reset();
+	m_Hash = 0;
 }
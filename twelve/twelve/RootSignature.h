@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <d3d12.h>
+#include <cstdint>
 #include <vector>
 
 #include "ComPtr.h"
@@ -23,6 +24,7 @@ enum SamplerState
 	LinearClamp,
 	AnisotropicWrap,
 	AnisotropicClamp,
+	ShadowCompare,
 };
 
 class RootSignature
@@ -39,6 +41,9 @@ public:
 		Desc& SetSRV(ShaderStage stage, int index, uint32_t reg);
 		Desc& SetUAV(ShaderStage stage, int index, uint32_t reg);
 		Desc& SetSmp(ShaderStage stage, int index, uint32_t reg);
+		Desc& SetConstants(ShaderStage stage, int index, uint32_t reg, uint32_t count);
+		Desc& SetSRVArray(ShaderStage stage, int index, uint32_t reg, uint32_t space, uint32_t count);
+		Desc& SetRootSRV(ShaderStage stage, int index, uint32_t reg);
 		Desc& AddStaticSmp(ShaderStage stage, uint32_t reg, SamplerState state);
 		Desc& AllowIL();
 		Desc& AllowSO();
@@ -66,6 +71,12 @@ public:
 
 	ID3D12RootSignature* GetPtr() const { return m_pRootSignature.Get(); }
 
+	/// <summary>
+	/// シリアライズしたルートシグネチャのハッシュ値を取得する (パイプラインキャッシュのキーに使う)
+	/// </summary>
+	uint64_t GetHash() const { return m_Hash; }
+
 private:
 	ComPtr<ID3D12RootSignature> m_pRootSignature;
+	uint64_t m_Hash;
 };
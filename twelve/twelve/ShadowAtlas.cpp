@@ -0,0 +1,308 @@
+﻿#include "ShadowAtlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Logger.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// ライトのデータからバージョンを求める (FNV-1a, 位置や向きが変わると値が変わる)
+	/// </summary>
+	uint32_t HashClusterLight(const ClusterLight& light)
+	{
+		auto hash = 2166136261u;
+		auto ptr = reinterpret_cast<const uint8_t*>(&light);
+		for (size_t i = 0; i < sizeof(light); ++i)
+		{
+			hash = (hash ^ ptr[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	/// <summary>
+	/// 永続的にマップするアップロードバッファを生成する
+	/// </summary>
+	bool CreateMappedBuffer(ID3D12Device* pDevice, uint64_t size, ComPtr<ID3D12Resource>& buffer, void** ppMapped)
+	{
+		D3D12_HEAP_PROPERTIES props = {};
+		props.Type = D3D12_HEAP_TYPE_UPLOAD;
+		props.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		props.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+
+		D3D12_RESOURCE_DESC desc = {};
+		desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		desc.Width = size;
+		desc.Height = 1;
+		desc.DepthOrArraySize = 1;
+		desc.MipLevels = 1;
+		desc.Format = DXGI_FORMAT_UNKNOWN;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		auto hr = pDevice->CreateCommittedResource(
+			&props,
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(buffer.ReleaseAndGetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreateCommittedResource() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		hr = buffer->Map(0, nullptr, ppMapped);
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Resource::Map() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		return true;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Spot Light Shadow
+///////////////////////////////////////////////////////////////////////////////
+void ComputeSpotShadowMatrices(const ClusterLight& light, XMFLOAT4X4& view, XMFLOAT4X4& proj)
+{
+	auto position = XMLoadFloat3(&light.Position);
+	auto forward = XMVector3Normalize(XMLoadFloat3(&light.Forward));
+
+	// 照射方向が上方向とほぼ平行な場合は別の軸を上方向にする
+	auto up = (fabsf(XMVectorGetY(forward)) > 0.99f)
+		? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f)
+		: XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	auto fovY = 2.0f * acosf(std::max(-1.0f, std::min(1.0f, light.CosOuterAngle)));
+	fovY = std::max(XMConvertToRadians(1.0f), std::min(fovY, XMConvertToRadians(170.0f)));
+
+	auto farZ = light.Radius;
+	auto nearZ = std::max(farZ * 0.02f, 0.001f);
+
+	XMStoreFloat4x4(&view, XMMatrixLookToRH(position, forward, up));
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovRH(fovY, 1.0f, nearZ, farZ));
+}
+
+void CullSpotShadowCasters(
+	const ClusterLight& light,
+	const ShadowCasterBounds* pCasters,
+	uint32_t casterCount,
+	std::vector<uint32_t>& visible)
+{
+	visible.clear();
+
+	if (pCasters == nullptr)
+	{
+		return;
+	}
+
+	auto sqrRadius = light.Radius * light.Radius;
+
+	for (auto i = 0u; i < casterCount; ++i)
+	{
+		const auto& bounds = pCasters[i];
+
+		// バウンディングボックス上の最も近い点までの距離で判定する
+		auto dx = std::max(std::max(bounds.Min.x - light.Position.x, light.Position.x - bounds.Max.x), 0.0f);
+		auto dy = std::max(std::max(bounds.Min.y - light.Position.y, light.Position.y - bounds.Max.y), 0.0f);
+		auto dz = std::max(std::max(bounds.Min.z - light.Position.z, light.Position.z - bounds.Max.z), 0.0f);
+
+		if (dx * dx + dy * dy + dz * dz <= sqrRadius)
+		{
+			visible.push_back(i);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SpotShadowAtlas
+///////////////////////////////////////////////////////////////////////////////
+SpotShadowAtlas::SpotShadowAtlas()
+	: m_pData(nullptr)
+	, m_MaxLightCount(0)
+{
+	memset(m_DataCounts, 0, sizeof(m_DataCounts));
+}
+
+SpotShadowAtlas::~SpotShadowAtlas()
+{
+	Term();
+}
+
+bool SpotShadowAtlas::Init(ID3D12Device* pDevice, const ShadowAtlasSettings& settings, uint32_t maxLightCount)
+{
+	if (pDevice == nullptr || maxLightCount == 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	Term();
+
+	if (!m_Cache.Init(settings, maxLightCount))
+	{
+		ELOG("Error : ShadowAtlasCache::Init() Failed.");
+		return false;
+	}
+
+	// フレームごとの領域を並べて確保する
+	auto size = sizeof(SpotShadowData) * maxLightCount * uint64_t(Constants::MaxFrameCount);
+	if (!CreateMappedBuffer(pDevice, size, m_pDataBuffer, reinterpret_cast<void**>(&m_pData)))
+	{
+		return false;
+	}
+
+	memset(m_pData, 0, size_t(size));
+
+	m_Settings = settings;
+	m_MaxLightCount = maxLightCount;
+	m_Requests.reserve(maxLightCount);
+
+	return true;
+}
+
+void SpotShadowAtlas::Term()
+{
+	if (m_pDataBuffer != nullptr && m_pData != nullptr)
+	{
+		m_pDataBuffer->Unmap(0, nullptr);
+	}
+
+	m_pData = nullptr;
+	m_pDataBuffer.Reset();
+
+	m_Cache.Term();
+	m_Requests.clear();
+	m_RenderList.clear();
+	m_RenderItems.clear();
+	m_MaxLightCount = 0;
+	memset(m_DataCounts, 0, sizeof(m_DataCounts));
+}
+
+void SpotShadowAtlas::Update(
+	uint32_t frameIndex,
+	const XMFLOAT4X4& view,
+	const XMFLOAT4X4& proj,
+	float screenHeight,
+	const ClusterLight* pLights,
+	uint32_t count,
+	uint32_t renderBudget)
+{
+	m_RenderItems.clear();
+
+	if (m_pData == nullptr || frameIndex >= Constants::MaxFrameCount)
+	{
+		return;
+	}
+
+	if (pLights == nullptr)
+	{
+		count = 0;
+	}
+
+	count = std::min(count, m_MaxLightCount);
+
+	// スポットライトの要求を求める (重要度は強度と色の最大成分の積にする)
+	m_Requests.clear();
+	for (auto i = 0u; i < count; ++i)
+	{
+		const auto& light = pLights[i];
+		if (light.Type != CLUSTER_LIGHT_SPOT)
+		{
+			continue;
+		}
+
+		auto coverage = ComputeShadowLightCoverage(view, proj, light.Position, light.Radius);
+		auto importance = light.Intensity * std::max(light.Color.x, std::max(light.Color.y, light.Color.z));
+
+		auto request = ComputeShadowLightRequest(m_Settings, i, HashClusterLight(light), coverage, importance, screenHeight);
+		if (request.Size > 0)
+		{
+			m_Requests.push_back(request);
+		}
+	}
+
+	m_Cache.Update(m_Requests.data(), uint32_t(m_Requests.size()), renderBudget, m_RenderList);
+
+	for (auto id : m_RenderList)
+	{
+		SpotShadowRenderItem item;
+		item.LightId = id;
+		item.Tile = m_Cache.GetTile(id);
+		ComputeSpotShadowMatrices(pLights[id], item.View, item.Proj);
+
+		m_RenderItems.push_back(item);
+	}
+
+	// 描画済みのタイルを持つライトだけ影を有効にする
+	auto pDst = m_pData + size_t(frameIndex) * m_MaxLightCount;
+	auto atlasSize = float(m_Settings.AtlasSize);
+
+	for (auto i = 0u; i < count; ++i)
+	{
+		auto& data = pDst[i];
+
+		if (!m_Cache.IsReady(i))
+		{
+			data = SpotShadowData();
+			continue;
+		}
+
+		auto tile = m_Cache.GetTile(i);
+
+		XMFLOAT4X4 lightView, lightProj;
+		ComputeSpotShadowMatrices(pLights[i], lightView, lightProj);
+
+		// クリップ座標をタイルのテクスチャ座標に変換する (w で割った後に範囲に収まる)
+		auto scale = 0.5f * float(tile.Size) / atlasSize;
+		auto tileMatrix = XMMatrixScaling(scale, -scale, 1.0f);
+		tileMatrix.r[3] = XMVectorSet(
+			(float(tile.X) + 0.5f * float(tile.Size)) / atlasSize,
+			(float(tile.Y) + 0.5f * float(tile.Size)) / atlasSize,
+			0.0f,
+			1.0f);
+
+		auto viewProj = XMMatrixMultiply(XMLoadFloat4x4(&lightView), XMLoadFloat4x4(&lightProj));
+		XMStoreFloat4x4(&data.ViewProj, XMMatrixMultiply(viewProj, tileMatrix));
+
+		data.Rect = XMFLOAT4(
+			float(tile.X) / atlasSize,
+			float(tile.Y) / atlasSize,
+			float(tile.X + tile.Size) / atlasSize,
+			float(tile.Y + tile.Size) / atlasSize);
+
+		// 距離 1 あたりのテクセルの大きさ (射影行列の _22 は 1 / tan(fovY / 2))
+		data.NormalOffsetScale = 1.5f * 2.0f / (lightProj._22 * float(tile.Size));
+		data.Padding[0] = 0.0f;
+		data.Padding[1] = 0.0f;
+		data.Padding[2] = 0.0f;
+	}
+
+	// 前回このフレームの領域に書き込んだ分のうち, 今回のライト数を超える分は影なしにする
+	for (auto i = count; i < m_DataCounts[frameIndex]; ++i)
+	{
+		pDst[i] = SpotShadowData();
+	}
+
+	m_DataCounts[frameIndex] = count;
+}
+
+void SpotShadowAtlas::SetRootParameter(CommandRecorder& recorder, uint32_t frameIndex, uint32_t param) const
+{
+	if (m_pDataBuffer == nullptr || frameIndex >= Constants::MaxFrameCount)
+	{
+		return;
+	}
+
+	recorder.SetGraphicsRootShaderResourceView(param, m_pDataBuffer->GetGPUVirtualAddress() + sizeof(SpotShadowData) * m_MaxLightCount * frameIndex);
+}
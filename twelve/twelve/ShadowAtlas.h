@@ -0,0 +1,127 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+#include "ComPtr.h"
+#include "Constants.h"
+#include "ClusteredLighting.h"
+#include "CascadedShadow.h"
+#include "CommandRecorder.h"
+#include "ShadowAtlasCache.h"
+
+// 1フレームに描画するスポットライトの影の最大数 (描画用の定数バッファの数)
+constexpr uint32_t MaxSpotShadowRenderCount = 4;
+
+/// <summary>
+/// シェーダーで参照するスポットライトの影のデータ (ShadowAtlas.hlsli の構造化バッファと並びを一致させる)
+/// </summary>
+struct SpotShadowData
+{
+	DirectX::XMFLOAT4X4	ViewProj;			// ワールド空間からアトラスのテクスチャ座標と深度への変換
+	DirectX::XMFLOAT4	Rect;				// タイルのテクスチャ座標の範囲 (最小u, 最小v, 最大u, 最大v, 影なしの場合は全て0)
+	float				NormalOffsetScale;	// 法線方向のオフセットのライトからの距離に対する倍率
+	float				Padding[3];			// パディング
+};
+
+static_assert(sizeof(SpotShadowData) == 96, "SpotShadowData layout mismatch.");
+
+/// <summary>
+/// 描画するスポットライトの影
+/// </summary>
+struct SpotShadowRenderItem
+{
+	uint32_t			LightId;	// ライト番号
+	ShadowAtlasTile		Tile;		// 描画先のタイル
+	DirectX::XMFLOAT4X4	View;		// ライトのビュー行列
+	DirectX::XMFLOAT4X4	Proj;		// ライトの射影行列
+};
+
+/// <summary>
+/// スポットライトの影のビュー行列と射影行列を求める (外側の角度を画角にし, 影響半径を遠クリップ面にする)
+/// </summary>
+/// <param name="light">スポットライト</param>
+/// <param name="view">ビュー行列の格納先</param>
+/// <param name="proj">射影行列の格納先</param>
+void ComputeSpotShadowMatrices(const ClusterLight& light, DirectX::XMFLOAT4X4& view, DirectX::XMFLOAT4X4& proj);
+
+/// <summary>
+/// スポットライトの影響範囲 (球) に入る影を落とすオブジェクトを求める
+/// </summary>
+/// <param name="light">ライト</param>
+/// <param name="pCasters">影を落とすオブジェクト</param>
+/// <param name="casterCount">影を落とすオブジェクトの数</param>
+/// <param name="visible">範囲に入るオブジェクトの番号の格納先</param>
+void CullSpotShadowCasters(
+	const ClusterLight& light,
+	const ShadowCasterBounds* pCasters,
+	uint32_t casterCount,
+	std::vector<uint32_t>& visible);
+
+/// <summary>
+/// クラスタードライティングのスポットライトの影を描くシャドウアトラス
+/// アトラスはフレームをまたいで内容を保持し, 影のデータはフレームごとのバッファ (アップロードヒープ) にルートSRVで設定する
+/// </summary>
+class SpotShadowAtlas
+{
+public:
+	SpotShadowAtlas();
+	~SpotShadowAtlas();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="settings">構成設定 (アトラスの深度ターゲットは呼び出し側で settings.AtlasSize の大きさで生成する)</param>
+	/// <param name="maxLightCount">ライトの最大数</param>
+	/// <returns></returns>
+	bool Init(ID3D12Device* pDevice, const ShadowAtlasSettings& settings, uint32_t maxLightCount);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// タイルを割り当て直し, 描画するライトと影のデータを求める
+	/// </summary>
+	/// <param name="frameIndex">フレーム番号</param>
+	/// <param name="view">カメラのビュー行列</param>
+	/// <param name="proj">カメラの射影行列</param>
+	/// <param name="screenHeight">画面の高さ [pixel]</param>
+	/// <param name="pLights">ライト (スポットライトのみ影を持つ)</param>
+	/// <param name="count">ライトの数 (0の場合は全ての影を無効にする)</param>
+	/// <param name="renderBudget">1フレームに描画するライトの最大数</param>
+	void Update(
+		uint32_t frameIndex,
+		const DirectX::XMFLOAT4X4& view,
+		const DirectX::XMFLOAT4X4& proj,
+		float screenHeight,
+		const ClusterLight* pLights,
+		uint32_t count,
+		uint32_t renderBudget);
+
+	/// <summary>
+	/// 影のデータのバッファをルートSRVに設定する
+	/// </summary>
+	void SetRootParameter(CommandRecorder& recorder, uint32_t frameIndex, uint32_t param) const;
+
+	const std::vector<SpotShadowRenderItem>& GetRenderItems() const { return m_RenderItems; }
+	const ShadowAtlasCache& GetCache() const { return m_Cache; }
+
+private:
+	ShadowAtlasSettings					m_Settings;			// 構成設定
+	ShadowAtlasCache					m_Cache;			// タイルのキャッシュ
+	std::vector<ShadowLightRequest>		m_Requests;			// 今回のフレームの要求
+	std::vector<uint32_t>				m_RenderList;		// 今回のフレームに描画するライト番号
+	std::vector<SpotShadowRenderItem>	m_RenderItems;		// 今回のフレームに描画するタイル
+	ComPtr<ID3D12Resource>				m_pDataBuffer;		// 影のデータ (フレームごとに最大ライト数分)
+	SpotShadowData*						m_pData;			// マップしたアドレス
+	uint32_t							m_MaxLightCount;	// ライトの最大数
+	uint32_t							m_DataCounts[Constants::MaxFrameCount];	// フレームごとに書き込んだライト数
+
+	SpotShadowAtlas(const SpotShadowAtlas&) = delete;
+	void operator=(const SpotShadowAtlas&) = delete;
+};
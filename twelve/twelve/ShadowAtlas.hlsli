@@ -0,0 +1,75 @@
+//-----------------------------------------------------------------------------
+// File : ShadowAtlas.hlsli
+// Desc : Spot Light Shadow Atlas.
+// Copyright(c) Pocol. All right reserved.
+//-----------------------------------------------------------------------------
+#ifndef SHADOW_ATLAS_HLSLI
+#define SHADOW_ATLAS_HLSLI
+
+///////////////////////////////////////////////////////////////////////////////
+// SpotShadowData structure
+///////////////////////////////////////////////////////////////////////////////
+struct SpotShadowData
+{
+    float4x4 ViewProj; // ワールド空間からアトラスのテクスチャ座標と深度への変換です.
+    float4 Rect; // タイルのテクスチャ座標の範囲です (影なしの場合は全て0).
+    float NormalOffsetScale; // 法線方向のオフセットのライトからの距離に対する倍率です.
+    float3 Padding; // パディングです.
+};
+
+//-----------------------------------------------------------------------------
+// Buffers, Textures and Samplers
+//-----------------------------------------------------------------------------
+// ライトごとの影のデータ (ClusterLights と同じ番号で参照します).
+StructuredBuffer<SpotShadowData> SpotShadows : register(t11);
+
+// スポットライトの影のアトラス (タイルはフレームをまたいで保持されます).
+Texture2D SpotShadowMap : register(t12);
+SamplerComparisonState SpotShadowSmp : register(s7);
+
+//-----------------------------------------------------------------------------
+//      スポットライトの影の可視率を求めます (3x3 の比較サンプル).
+//-----------------------------------------------------------------------------
+float SampleSpotShadow(uint lightIndex, float3 worldPos, float3 N, float lightDistance)
+{
+    SpotShadowData data = SpotShadows[lightIndex];
+    if (data.Rect.z <= data.Rect.x)
+    {
+        return 1.0f;
+    }
+
+    // 自己遮蔽を抑えるため, ライトからの距離でのテクセルの大きさだけ法線方向にずらします.
+    float3 pos = worldPos + N * (data.NormalOffsetScale * lightDistance);
+    float4 shadowPos = mul(data.ViewProj, float4(pos, 1.0f));
+    if (shadowPos.w <= 0.0f)
+    {
+        return 1.0f;
+    }
+
+    shadowPos.xyz /= shadowPos.w;
+
+    float2 size;
+    SpotShadowMap.GetDimensions(size.x, size.y);
+    float2 texelSize = 1.0f / size;
+
+    // 隣のタイルをサンプルしないように, ライトのタイル内に制限します.
+    float2 margin = texelSize * 1.5f;
+    float2 uv = clamp(shadowPos.xy, data.Rect.xy + margin, data.Rect.zw - margin);
+
+    float visibility = 0.0f;
+
+    [unroll]
+    for (int y = -1; y <= 1; ++y)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; ++x)
+        {
+            float2 offset = float2(x, y) * texelSize;
+            visibility += SpotShadowMap.SampleCmpLevelZero(SpotShadowSmp, uv + offset, shadowPos.z);
+        }
+    }
+
+    return visibility / 9.0f;
+}
+
+#endif//SHADOW_ATLAS_HLSLI
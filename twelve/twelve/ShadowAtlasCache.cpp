@@ -0,0 +1,655 @@
+﻿#include "ShadowAtlasCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Logger.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// ノード番号の階層のシフト量
+	constexpr uint32_t NodeLevelShift = 24;
+	constexpr uint32_t NodeIndexMask = (1u << NodeLevelShift) - 1;
+
+	uint32_t EncodeNode(uint32_t level, uint32_t index)
+	{
+		return (level << NodeLevelShift) | index;
+	}
+
+	bool IsPowerOfTwo(uint32_t value)
+	{
+		return value != 0 && (value & (value - 1)) == 0;
+	}
+
+	uint32_t Log2(uint32_t value)
+	{
+		auto result = 0u;
+		while (value > 1)
+		{
+			value >>= 1;
+			++result;
+		}
+		return result;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ShadowAtlasAllocator
+///////////////////////////////////////////////////////////////////////////////
+ShadowAtlasAllocator::ShadowAtlasAllocator()
+	: m_AtlasSize(0)
+	, m_MinTileSize(0)
+	, m_LevelCount(0)
+	, m_UsedArea(0)
+{
+}
+
+ShadowAtlasAllocator::~ShadowAtlasAllocator()
+{
+	Term();
+}
+
+bool ShadowAtlasAllocator::Init(uint32_t atlasSize, uint32_t minTileSize)
+{
+	if (!IsPowerOfTwo(atlasSize) || !IsPowerOfTwo(minTileSize) || minTileSize > atlasSize)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	m_AtlasSize = atlasSize;
+	m_MinTileSize = minTileSize;
+	m_LevelCount = Log2(atlasSize / minTileSize) + 1;
+
+	if (2 * (m_LevelCount - 1) > NodeLevelShift)
+	{
+		ELOG("Error : Too many shadow atlas levels. (%u)", m_LevelCount);
+		Term();
+		return false;
+	}
+
+	// 階層ごとに 4^level 個のノードを並べる
+	m_LevelOffsets.resize(m_LevelCount);
+	auto total = 0u;
+	for (auto level = 0u; level < m_LevelCount; ++level)
+	{
+		m_LevelOffsets[level] = total;
+		total += 1u << (2 * level);
+	}
+
+	m_States.resize(total);
+	m_FreeSlots.resize(total);
+	m_FreeLists.resize(m_LevelCount);
+
+	Reset();
+
+	return true;
+}
+
+void ShadowAtlasAllocator::Term()
+{
+	m_LevelOffsets.clear();
+	m_States.clear();
+	m_FreeSlots.clear();
+	m_FreeLists.clear();
+	m_AtlasSize = 0;
+	m_MinTileSize = 0;
+	m_LevelCount = 0;
+	m_UsedArea = 0;
+}
+
+void ShadowAtlasAllocator::Reset()
+{
+	if (m_LevelCount == 0)
+	{
+		return;
+	}
+
+	std::fill(m_States.begin(), m_States.end(), uint8_t(NODE_NONE));
+	std::fill(m_FreeSlots.begin(), m_FreeSlots.end(), UINT32_MAX);
+	for (auto& list : m_FreeLists)
+	{
+		list.clear();
+	}
+
+	// 根だけが空いている状態
+	m_States[0] = NODE_FREE;
+	PushFree(0, 0);
+	m_UsedArea = 0;
+}
+
+uint32_t ShadowAtlasAllocator::RoundSize(uint32_t size) const
+{
+	auto result = m_MinTileSize;
+	while (result < size && result < m_AtlasSize)
+	{
+		result <<= 1;
+	}
+	return result;
+}
+
+uint32_t ShadowAtlasAllocator::Allocate(uint32_t size)
+{
+	if (m_LevelCount == 0)
+	{
+		return ShadowAtlasInvalidNode;
+	}
+
+	auto tileSize = RoundSize(size);
+	auto level = Log2(m_AtlasSize / tileSize);
+
+	auto index = TakeFreeNode(level);
+	if (index == UINT32_MAX)
+	{
+		return ShadowAtlasInvalidNode;
+	}
+
+	m_States[m_LevelOffsets[level] + index] = NODE_USED;
+	m_UsedArea += uint64_t(tileSize) * tileSize;
+
+	return EncodeNode(level, index);
+}
+
+void ShadowAtlasAllocator::Free(uint32_t node)
+{
+	auto level = node >> NodeLevelShift;
+	auto index = node & NodeIndexMask;
+	if (level >= m_LevelCount || m_States[m_LevelOffsets[level] + index] != NODE_USED)
+	{
+		return;
+	}
+
+	auto tileSize = m_AtlasSize >> level;
+	m_UsedArea -= uint64_t(tileSize) * tileSize;
+
+	m_States[m_LevelOffsets[level] + index] = NODE_FREE;
+	PushFree(level, index);
+
+	// 4つの兄弟が全て空いた場合は親にまとめる
+	while (level > 0)
+	{
+		auto width = 1u << level;
+		auto x = (index % width) & ~1u;
+		auto y = (index / width) & ~1u;
+
+		const uint32_t siblings[4] = {
+			y * width + x,
+			y * width + x + 1,
+			(y + 1) * width + x,
+			(y + 1) * width + x + 1,
+		};
+
+		auto allFree = true;
+		for (auto sibling : siblings)
+		{
+			allFree &= (m_States[m_LevelOffsets[level] + sibling] == NODE_FREE);
+		}
+
+		if (!allFree)
+		{
+			break;
+		}
+
+		for (auto sibling : siblings)
+		{
+			RemoveFree(level, sibling);
+			m_States[m_LevelOffsets[level] + sibling] = NODE_NONE;
+		}
+
+		--level;
+		index = (y / 2) * (width / 2) + (x / 2);
+
+		m_States[m_LevelOffsets[level] + index] = NODE_FREE;
+		PushFree(level, index);
+	}
+}
+
+ShadowAtlasTile ShadowAtlasAllocator::GetTile(uint32_t node) const
+{
+	ShadowAtlasTile result;
+
+	auto level = node >> NodeLevelShift;
+	auto index = node & NodeIndexMask;
+	if (node == ShadowAtlasInvalidNode || level >= m_LevelCount)
+	{
+		return result;
+	}
+
+	auto width = 1u << level;
+	result.Size = m_AtlasSize >> level;
+	result.X = (index % width) * result.Size;
+	result.Y = (index / width) * result.Size;
+
+	return result;
+}
+
+uint32_t ShadowAtlasAllocator::TakeFreeNode(uint32_t level)
+{
+	auto& list = m_FreeLists[level];
+	if (!list.empty())
+	{
+		auto index = list.back();
+		list.pop_back();
+		m_FreeSlots[m_LevelOffsets[level] + index] = UINT32_MAX;
+		return index;
+	}
+
+	if (level == 0)
+	{
+		return UINT32_MAX;
+	}
+
+	// 親の階層から空きを取り出して4つに分割し, 残りの3つを空きにする
+	auto parent = TakeFreeNode(level - 1);
+	if (parent == UINT32_MAX)
+	{
+		return UINT32_MAX;
+	}
+
+	m_States[m_LevelOffsets[level - 1] + parent] = NODE_SPLIT;
+
+	auto parentWidth = 1u << (level - 1);
+	auto width = 1u << level;
+	auto x = (parent % parentWidth) * 2;
+	auto y = (parent / parentWidth) * 2;
+
+	const uint32_t children[3] = {
+		y * width + x + 1,
+		(y + 1) * width + x,
+		(y + 1) * width + x + 1,
+	};
+
+	for (auto child : children)
+	{
+		m_States[m_LevelOffsets[level] + child] = NODE_FREE;
+		PushFree(level, child);
+	}
+
+	return y * width + x;
+}
+
+void ShadowAtlasAllocator::PushFree(uint32_t level, uint32_t index)
+{
+	m_FreeSlots[m_LevelOffsets[level] + index] = uint32_t(m_FreeLists[level].size());
+	m_FreeLists[level].push_back(index);
+}
+
+void ShadowAtlasAllocator::RemoveFree(uint32_t level, uint32_t index)
+{
+	auto& list = m_FreeLists[level];
+	auto slot = m_FreeSlots[m_LevelOffsets[level] + index];
+	if (slot == UINT32_MAX)
+	{
+		return;
+	}
+
+	// 末尾と入れ替えて削除する
+	auto last = list.back();
+	list[slot] = last;
+	m_FreeSlots[m_LevelOffsets[level] + last] = slot;
+	list.pop_back();
+	m_FreeSlots[m_LevelOffsets[level] + index] = UINT32_MAX;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Heuristics
+///////////////////////////////////////////////////////////////////////////////
+float ComputeShadowLightCoverage(const XMFLOAT4X4& view, const XMFLOAT4X4& proj, const XMFLOAT3& position, float radius)
+{
+	XMFLOAT3 viewPos;
+	XMStoreFloat3(&viewPos, XMVector3TransformCoord(XMLoadFloat3(&position), XMLoadFloat4x4(&view)));
+
+	// 奥行きは正の距離にする (右手系では -z が前方)
+	auto depthSign = (proj._34 < 0.0f) ? -1.0f : 1.0f;
+	auto depth = depthSign * viewPos.z;
+	if (depth + radius <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	// 左右上下の面の外側にある場合は見えない (対称な射影を前提にする)
+	auto tanX = 1.0f / proj._11;
+	auto tanY = 1.0f / proj._22;
+	auto invLenX = 1.0f / sqrtf(1.0f + tanX * tanX);
+	auto invLenY = 1.0f / sqrtf(1.0f + tanY * tanY);
+
+	if ((fabsf(viewPos.x) - depth * tanX) * invLenX > radius
+	 || (fabsf(viewPos.y) - depth * tanY) * invLenY > radius)
+	{
+		return 0.0f;
+	}
+
+	// 直径が画面の高さに占める割合 (カメラが球の内側にある場合は画面全体)
+	return std::min(1.0f, radius * proj._22 / std::max(depth, radius));
+}
+
+ShadowLightRequest ComputeShadowLightRequest(
+	const ShadowAtlasSettings& settings,
+	uint32_t lightId,
+	uint32_t version,
+	float coverage,
+	float importance,
+	float screenHeight)
+{
+	ShadowLightRequest result = {};
+	result.LightId = lightId;
+	result.Version = version;
+
+	if (coverage <= 0.0f || importance <= 0.0f)
+	{
+		return result;
+	}
+
+	// 大きさは画面上の大きさに合わせ, 優先度は画面上の大きさと重要度の積にする
+	auto texels = coverage * screenHeight * settings.ResolutionScale;
+	auto size = uint32_t(std::min(texels, float(settings.MaxTileSize)));
+
+	result.Size = std::max(std::min(size, settings.MaxTileSize), settings.MinTileSize);
+	result.Priority = coverage * importance;
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ShadowAtlasCache
+///////////////////////////////////////////////////////////////////////////////
+ShadowAtlasCache::ShadowAtlasCache()
+	: m_Frame(0)
+{
+}
+
+ShadowAtlasCache::~ShadowAtlasCache()
+{
+	Term();
+}
+
+bool ShadowAtlasCache::Init(const ShadowAtlasSettings& settings, uint32_t maxLightCount)
+{
+	if (maxLightCount == 0 || settings.MaxTileSize < settings.MinTileSize)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	if (!m_Allocator.Init(settings.AtlasSize, settings.MinTileSize))
+	{
+		ELOG("Error : ShadowAtlasAllocator::Init() Failed.");
+		return false;
+	}
+
+	m_Settings = settings;
+	m_Entries.assign(maxLightCount, Entry());
+	m_Allocated.clear();
+	m_Allocated.reserve(maxLightCount);
+	m_Stats = ShadowAtlasStats();
+	m_Frame = 0;
+
+	return true;
+}
+
+void ShadowAtlasCache::Term()
+{
+	m_Allocator.Term();
+	m_Entries.clear();
+	m_Allocated.clear();
+	m_Pending.clear();
+	m_Victims.clear();
+	m_Stats = ShadowAtlasStats();
+	m_Frame = 0;
+}
+
+void ShadowAtlasCache::Update(const ShadowLightRequest* pRequests, uint32_t count, uint32_t renderBudget, std::vector<uint32_t>& renderList)
+{
+	renderList.clear();
+
+	if (m_Entries.empty())
+	{
+		return;
+	}
+
+	if (pRequests == nullptr)
+	{
+		count = 0;
+	}
+
+	++m_Frame;
+	m_Stats.AllocationCount = 0;
+	m_Stats.EvictionCount = 0;
+	m_Stats.FailureCount = 0;
+	m_Pending.clear();
+
+	// 要求を反映する
+	for (auto i = 0u; i < count; ++i)
+	{
+		const auto& request = pRequests[i];
+		if (request.LightId >= m_Entries.size())
+		{
+			continue;
+		}
+
+		auto& entry = m_Entries[request.LightId];
+
+		if (request.Size == 0)
+		{
+			Release(request.LightId);
+			continue;
+		}
+
+		entry.Size = m_Allocator.RoundSize(request.Size);
+		entry.Priority = request.Priority;
+		entry.LastRequested = m_Frame;
+
+		if (entry.Version != request.Version)
+		{
+			entry.Version = request.Version;
+			entry.Rendered = false;
+		}
+
+		if (entry.Node != ShadowAtlasInvalidNode)
+		{
+			auto current = m_Allocator.GetTile(entry.Node).Size;
+
+			// 大きくする場合は空きがある場合だけ移す (追い出してまで大きくすると毎フレーム入れ替わるため)
+			if (entry.Size > current)
+			{
+				auto node = m_Allocator.Allocate(entry.Size);
+				if (node != ShadowAtlasInvalidNode)
+				{
+					m_Allocator.Free(entry.Node);
+					entry.Node = node;
+					entry.Rendered = false;
+					++m_Stats.AllocationCount;
+				}
+				continue;
+			}
+
+			// 小さくする場合は半分以下で足りる場合だけ割り当て直す (小さな変化では描画し直さない)
+			if (entry.Size * 2 >= current)
+			{
+				continue;
+			}
+
+			Release(request.LightId);
+		}
+
+		m_Pending.push_back(request.LightId);
+	}
+
+	// 要求されなかったライトは最も低い優先度にし, 一定期間を過ぎたら解放する
+	for (size_t i = 0; i < m_Allocated.size();)
+	{
+		auto id = m_Allocated[i];
+		auto& entry = m_Entries[id];
+
+		if (entry.LastRequested != m_Frame)
+		{
+			entry.Priority = -1.0f;
+
+			if (m_Frame - entry.LastRequested > m_Settings.RetainFrames)
+			{
+				Release(id);
+				continue;
+			}
+		}
+
+		++i;
+	}
+
+	// 追い出しの候補は優先度の低い順に並べる
+	m_Victims = m_Allocated;
+	std::sort(m_Victims.begin(), m_Victims.end(), [this](uint32_t a, uint32_t b)
+	{
+		return m_Entries[a].Priority < m_Entries[b].Priority;
+	});
+
+	// 優先度の高い順に割り当てる
+	std::stable_sort(m_Pending.begin(), m_Pending.end(), [this](uint32_t a, uint32_t b)
+	{
+		return m_Entries[a].Priority > m_Entries[b].Priority;
+	});
+
+	size_t victim = 0;
+	for (size_t i = 0; i < m_Pending.size(); ++i)
+	{
+		auto id = m_Pending[i];
+		if (Allocate(id, victim))
+		{
+			++m_Stats.AllocationCount;
+		}
+		else
+		{
+			++m_Stats.FailureCount;
+		}
+	}
+
+	// 描画していないタイルを優先度の高い順に予算まで描画する
+	for (auto id : m_Allocated)
+	{
+		const auto& entry = m_Entries[id];
+		if (!entry.Rendered && entry.LastRequested == m_Frame)
+		{
+			renderList.push_back(id);
+		}
+	}
+
+	std::sort(renderList.begin(), renderList.end(), [this](uint32_t a, uint32_t b)
+	{
+		return m_Entries[a].Priority > m_Entries[b].Priority;
+	});
+
+	m_Stats.PendingCount = 0;
+	if (renderList.size() > renderBudget)
+	{
+		m_Stats.PendingCount = uint32_t(renderList.size() - renderBudget);
+		renderList.resize(renderBudget);
+	}
+
+	for (auto id : renderList)
+	{
+		m_Entries[id].Rendered = true;
+	}
+
+	m_Stats.AllocatedCount = uint32_t(m_Allocated.size());
+	m_Stats.UsedArea = m_Allocator.GetUsedArea();
+}
+
+bool ShadowAtlasCache::IsReady(uint32_t lightId) const
+{
+	if (lightId >= m_Entries.size())
+	{
+		return false;
+	}
+
+	const auto& entry = m_Entries[lightId];
+	return entry.Node != ShadowAtlasInvalidNode && entry.Rendered;
+}
+
+ShadowAtlasTile ShadowAtlasCache::GetTile(uint32_t lightId) const
+{
+	if (lightId >= m_Entries.size())
+	{
+		return ShadowAtlasTile();
+	}
+
+	return m_Allocator.GetTile(m_Entries[lightId].Node);
+}
+
+void ShadowAtlasCache::Release(uint32_t lightId)
+{
+	auto& entry = m_Entries[lightId];
+	if (entry.Node == ShadowAtlasInvalidNode)
+	{
+		return;
+	}
+
+	m_Allocator.Free(entry.Node);
+
+	// 末尾と入れ替えて削除する
+	auto last = m_Allocated.back();
+	m_Allocated[entry.Slot] = last;
+	m_Entries[last].Slot = entry.Slot;
+	m_Allocated.pop_back();
+
+	entry.Node = ShadowAtlasInvalidNode;
+	entry.Slot = UINT32_MAX;
+	entry.Rendered = false;
+}
+
+bool ShadowAtlasCache::Allocate(uint32_t lightId, size_t& victim)
+{
+	auto& entry = m_Entries[lightId];
+
+	for (;;)
+	{
+		auto node = m_Allocator.Allocate(entry.Size);
+
+		// 空きがない場合は優先度の低いライトから追い出す
+		while (node == ShadowAtlasInvalidNode && victim < m_Victims.size())
+		{
+			auto id = m_Victims[victim];
+			const auto& candidate = m_Entries[id];
+
+			if (candidate.Node == ShadowAtlasInvalidNode)
+			{
+				++victim;
+				continue;
+			}
+
+			if (candidate.Priority >= entry.Priority)
+			{
+				break;
+			}
+
+			Release(id);
+			++victim;
+			++m_Stats.EvictionCount;
+
+			// 今回も要求されたライトは, 残りの空きで割り当て直す
+			if (candidate.LastRequested == m_Frame)
+			{
+				m_Pending.push_back(id);
+			}
+
+			node = m_Allocator.Allocate(entry.Size);
+		}
+
+		if (node != ShadowAtlasInvalidNode)
+		{
+			entry.Node = node;
+			entry.Slot = uint32_t(m_Allocated.size());
+			entry.Rendered = false;
+			m_Allocated.push_back(lightId);
+			return true;
+		}
+
+		// 追い出せるライトがない場合は小さくして試す
+		if (entry.Size <= m_Allocator.GetMinTileSize())
+		{
+			return false;
+		}
+
+		entry.Size >>= 1;
+	}
+}
@@ -0,0 +1,239 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// 無効なノード
+constexpr uint32_t ShadowAtlasInvalidNode = UINT32_MAX;
+
+/// <summary>
+/// アトラス内のタイル (テクセル単位)
+/// </summary>
+struct ShadowAtlasTile
+{
+	uint32_t	X = 0;		// 左端
+	uint32_t	Y = 0;		// 上端
+	uint32_t	Size = 0;	// 一辺の大きさ (0の場合は割り当てなし)
+};
+
+/// <summary>
+/// 四分木によるシャドウアトラスのタイルの割り当て
+/// タイルの大きさは2のべき乗で, 空いたノードは4つの兄弟が全て空いた時点で親にまとめる
+/// ノード番号は上位8bitが階層, 下位24bitが階層内の番号 (y * 階層の幅 + x)
+/// </summary>
+class ShadowAtlasAllocator
+{
+public:
+	ShadowAtlasAllocator();
+	~ShadowAtlasAllocator();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="atlasSize">アトラスの一辺の大きさ (2のべき乗)</param>
+	/// <param name="minTileSize">タイルの最小の大きさ (2のべき乗)</param>
+	/// <returns></returns>
+	bool Init(uint32_t atlasSize, uint32_t minTileSize);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// 全てのタイルを解放する
+	/// </summary>
+	void Reset();
+
+	/// <summary>
+	/// タイルを割り当てる
+	/// </summary>
+	/// <param name="size">一辺の大きさ (2のべき乗に切り上げ, 最小と最大の範囲に収める)</param>
+	/// <returns>ノード番号 (空きがない場合は ShadowAtlasInvalidNode)</returns>
+	uint32_t Allocate(uint32_t size);
+
+	/// <summary>
+	/// タイルを解放する
+	/// </summary>
+	/// <param name="node">ノード番号</param>
+	void Free(uint32_t node);
+
+	/// <summary>
+	/// ノードのタイルを取得する
+	/// </summary>
+	ShadowAtlasTile GetTile(uint32_t node) const;
+
+	/// <summary>
+	/// 大きさを割り当て可能な大きさ (2のべき乗) に丸める
+	/// </summary>
+	uint32_t RoundSize(uint32_t size) const;
+
+	uint32_t GetAtlasSize() const { return m_AtlasSize; }
+	uint32_t GetMinTileSize() const { return m_MinTileSize; }
+	uint64_t GetUsedArea() const { return m_UsedArea; }
+
+private:
+	enum NODE_STATE : uint8_t
+	{
+		NODE_NONE = 0,	// 親が分割されていない (ノードとして存在しない)
+		NODE_FREE,		// 空き
+		NODE_SPLIT,		// 4つの子に分割済み
+		NODE_USED,		// 割り当て済み
+	};
+
+	uint32_t						m_AtlasSize;	// アトラスの一辺の大きさ
+	uint32_t						m_MinTileSize;	// タイルの最小の大きさ
+	uint32_t						m_LevelCount;	// 階層数
+	uint64_t						m_UsedArea;		// 割り当て済みの面積 [texel^2]
+	std::vector<uint32_t>			m_LevelOffsets;	// 階層ごとのノードの状態の開始位置
+	std::vector<uint8_t>			m_States;		// ノードの状態 (NODE_STATE)
+	std::vector<uint32_t>			m_FreeSlots;	// ノードの空きリスト内の位置 (リストにない場合は UINT32_MAX)
+	std::vector<std::vector<uint32_t>>	m_FreeLists;	// 階層ごとの空きノード
+
+	uint32_t TakeFreeNode(uint32_t level);
+	void PushFree(uint32_t level, uint32_t index);
+	void RemoveFree(uint32_t level, uint32_t index);
+
+	ShadowAtlasAllocator(const ShadowAtlasAllocator&) = delete;
+	void operator=(const ShadowAtlasAllocator&) = delete;
+};
+
+/// <summary>
+/// シャドウアトラスの構成設定
+/// </summary>
+struct ShadowAtlasSettings
+{
+	uint32_t	AtlasSize = 4096;		// アトラスの一辺の大きさ
+	uint32_t	MinTileSize = 64;		// タイルの最小の大きさ
+	uint32_t	MaxTileSize = 1024;		// タイルの最大の大きさ
+	float		ResolutionScale = 1.0f;	// 画面上の大きさ [pixel] に対するタイルの大きさの倍率
+	uint32_t	RetainFrames = 60;		// 要求されなくなったライトのタイルを保持するフレーム数 (その間は優先度が最も低い)
+};
+
+/// <summary>
+/// ライトごとの影の要求
+/// </summary>
+struct ShadowLightRequest
+{
+	uint32_t	LightId;	// ライト番号 (キャッシュのキー)
+	uint32_t	Version;	// ライトや影を落とすオブジェクトが変化した場合に変える値
+	uint32_t	Size;		// 希望するタイルの大きさ (0の場合は影なし)
+	float		Priority;	// 優先度 (大きいほど先に割り当て, 空きがない場合は小さいものから追い出す)
+};
+
+/// <summary>
+/// ライトの画面上の大きさを求める (球の直径が画面の高さに占める割合, 視錐台の外側の場合は0)
+/// </summary>
+/// <param name="view">カメラのビュー行列</param>
+/// <param name="proj">カメラの射影行列</param>
+/// <param name="position">影響範囲の球の中心</param>
+/// <param name="radius">影響範囲の球の半径</param>
+float ComputeShadowLightCoverage(
+	const DirectX::XMFLOAT4X4& view,
+	const DirectX::XMFLOAT4X4& proj,
+	const DirectX::XMFLOAT3& position,
+	float radius);
+
+/// <summary>
+/// 画面上の大きさと重要度から影の要求を求める
+/// </summary>
+/// <param name="settings">構成設定</param>
+/// <param name="lightId">ライト番号</param>
+/// <param name="version">ライトのバージョン</param>
+/// <param name="coverage">画面上の大きさ (ComputeShadowLightCoverage() の値)</param>
+/// <param name="importance">重要度 (強度などから呼び出し側で決める)</param>
+/// <param name="screenHeight">画面の高さ [pixel]</param>
+ShadowLightRequest ComputeShadowLightRequest(
+	const ShadowAtlasSettings& settings,
+	uint32_t lightId,
+	uint32_t version,
+	float coverage,
+	float importance,
+	float screenHeight);
+
+/// <summary>
+/// シャドウアトラスのキャッシュの統計値
+/// </summary>
+struct ShadowAtlasStats
+{
+	uint32_t	AllocatedCount = 0;		// タイルを持つライト数
+	uint32_t	AllocationCount = 0;	// 今回のフレームで割り当てたタイル数
+	uint32_t	EvictionCount = 0;		// 今回のフレームで追い出したタイル数
+	uint32_t	FailureCount = 0;		// 今回のフレームで割り当てられなかったライト数
+	uint32_t	PendingCount = 0;		// 描画待ちのライト数 (予算を超えて次のフレームに回したもの)
+	uint64_t	UsedArea = 0;			// 割り当て済みの面積 [texel^2]
+};
+
+/// <summary>
+/// フレームをまたいでライトのタイルを保持するキャッシュ
+/// 大きさが変わらずバージョンも同じライトはタイルと描画結果を使い回し, 新しく割り当てたものと変化したものだけを描画する
+/// </summary>
+class ShadowAtlasCache
+{
+public:
+	/// <summary>
+	/// ライトのタイルの状態
+	/// </summary>
+	struct Entry
+	{
+		uint32_t	Node = ShadowAtlasInvalidNode;	// ノード番号
+		uint32_t	Slot = UINT32_MAX;				// タイルを持つライトのリスト内の位置
+		uint32_t	Size = 0;						// 希望するタイルの大きさ
+		uint32_t	Version = 0;					// 最後に要求されたバージョン
+		float		Priority = 0.0f;				// 今回のフレームの優先度 (要求されなかった場合は負)
+		uint32_t	LastRequested = 0;				// 最後に要求されたフレーム
+		bool		Rendered = false;				// 現在のタイルとバージョンで描画済みかどうか
+	};
+
+	ShadowAtlasCache();
+	~ShadowAtlasCache();
+
+	/// <summary>
+	/// 初期化処理
+	/// </summary>
+	/// <param name="settings">構成設定</param>
+	/// <param name="maxLightCount">ライト番号の最大値 + 1</param>
+	/// <returns></returns>
+	bool Init(const ShadowAtlasSettings& settings, uint32_t maxLightCount);
+
+	/// <summary>
+	/// 終了処理
+	/// </summary>
+	void Term();
+
+	/// <summary>
+	/// 要求に合わせてタイルを割り当て直し, 描画するライトを求める
+	/// </summary>
+	/// <param name="pRequests">要求</param>
+	/// <param name="count">要求の数</param>
+	/// <param name="renderBudget">1フレームに描画するライトの最大数 (超えた分は次のフレームに回す)</param>
+	/// <param name="renderList">描画するライト番号の格納先 (優先度の高い順, 描画済みとして扱う)</param>
+	void Update(const ShadowLightRequest* pRequests, uint32_t count, uint32_t renderBudget, std::vector<uint32_t>& renderList);
+
+	/// <summary>
+	/// 影を参照できる (タイルを持ち描画済みの) ライトかどうか
+	/// </summary>
+	bool IsReady(uint32_t lightId) const;
+
+	const Entry& GetEntry(uint32_t lightId) const { return m_Entries[lightId]; }
+	ShadowAtlasTile GetTile(uint32_t lightId) const;
+	const ShadowAtlasStats& GetStats() const { return m_Stats; }
+	const ShadowAtlasAllocator& GetAllocator() const { return m_Allocator; }
+
+private:
+	ShadowAtlasSettings			m_Settings;		// 構成設定
+	ShadowAtlasAllocator		m_Allocator;	// タイルの割り当て
+	std::vector<Entry>			m_Entries;		// ライトごとの状態 (ライト番号で参照する)
+	std::vector<uint32_t>		m_Allocated;	// タイルを持つライト番号
+	std::vector<uint32_t>		m_Pending;		// 割り当てを待つライト番号 (作業領域)
+	std::vector<uint32_t>		m_Victims;		// 追い出しの候補 (作業領域)
+	ShadowAtlasStats			m_Stats;		// 統計値
+	uint32_t					m_Frame;		// フレーム番号
+
+	void Release(uint32_t lightId);
+	bool Allocate(uint32_t lightId, size_t& victim);
+
+	ShadowAtlasCache(const ShadowAtlasCache&) = delete;
+	void operator=(const ShadowAtlasCache&) = delete;
+};
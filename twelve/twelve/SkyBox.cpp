@@ -29,7 +29,7 @@ SkyBox::~SkyBox()
 	Term();
 }
 
-bool SkyBox::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DXGI_FORMAT colorFormat, DXGI_FORMAT depthFormat)
+bool SkyBox::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DXGI_FORMAT colorFormat, DXGI_FORMAT depthFormat, PipelineCache* pPipelineCache)
 {
 	if (pDevice == nullptr || pPoolRes == nullptr)
 	{
@@ -80,11 +80,8 @@ bool SkyBox::Init(ID3D12Device* pDevice, DescriptorPool* pPoolRes, DXGI_FORMAT c
 		desc.SampleDesc.Quality = 0;
 		desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
 
-		auto hr = pDevice->CreateGraphicsPipelineState(
-			&desc, IID_PPV_ARGS(m_pPSO.GetAddressOf()));
-		if (FAILED(hr))
+		if (!CreateGraphicsPipeline(pDevice, pPipelineCache, desc, m_RootSignature.GetHash(), m_pPSO.GetAddressOf()))
 		{
-			ELOG("Error : ID3D12Device::CreateGraphicsPipelineState() Failed. retcode = 0x%x", hr);
 			return false;
 		}
 	}
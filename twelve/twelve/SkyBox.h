@@ -6,6 +6,7 @@
 #include "ConstantBuffer.h"
 #include "VertexBuffer.h"
 #include "RootSignature.h"
+#include "PipelineCache.h"
 
 class SkyBox
 {
@@ -17,7 +18,8 @@ public:
 		ID3D12Device* pDevice,
 		DescriptorPool* pPoolRes,
 		DXGI_FORMAT colorFormat,
-		DXGI_FORMAT depthFormat);
+		DXGI_FORMAT depthFormat,
+		PipelineCache* pPipelineCache = nullptr);
 
 	void Term();
 
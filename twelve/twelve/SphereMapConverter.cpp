@@ -8,6 +8,7 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include "SphereMapConverter.h"
+#include "HashUtil.h"
 #include "Logger.h"
 #include <CommonStates.h>
 #include <DirectXHelpers.h>
@@ -49,6 +50,7 @@ SphereMapConverter::SphereMapConverter()
 	: m_pPoolRes(nullptr)
 	, m_pPoolRTV(nullptr)
 	, m_pCubeSRV(nullptr)
+	, m_RootSigHash(0)
 { /* DO_NOTHING */
 }
 
@@ -69,7 +71,8 @@ bool SphereMapConverter::Init
 	DescriptorPool* pPoolRTV,
 	DescriptorPool* pPoolRes,
 	const D3D12_RESOURCE_DESC& sphereMapDesc,
-	int                         mapSize
+	int                         mapSize,
+	PipelineCache*              pPipelineCache
 )
 {
 	if (pDevice == nullptr || pPoolRTV == nullptr || pPoolRes == nullptr)
@@ -163,6 +166,8 @@ bool SphereMapConverter::Init
 			ELOG("Error : ID3D12Device::CreateRootSignature() Failed. retcode = 0x%x", hr);
 			return false;
 		}
+
+		m_RootSigHash = ComputeHash(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), HashOffsetBasis);
 	}
 
 	// pCvCXe[g̐.
@@ -183,16 +188,14 @@ bool SphereMapConverter::Init
 		desc.InputLayout = { elements, 2 };
 		desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
 		desc.NumRenderTargets = 1;
-		desc.RTVFormats[0] = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		desc.RTVFormats[0] = CubeMapFormat;
 		desc.DSVFormat = DXGI_FORMAT_UNKNOWN;
 		desc.SampleDesc.Count = 1;
 		desc.SampleDesc.Quality = 0;
 		desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
 
-		auto hr = pDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(m_pPSO.GetAddressOf()));
-		if (FAILED(hr))
+		if (!CreateGraphicsPipeline(pDevice, pPipelineCache, desc, m_RootSigHash, m_pPSO.GetAddressOf()))
 		{
-			ELOG("Error : ID3D12Device::CreateGraphicsPipelineState() Failed. retcode = 0x%x", hr);
 			return false;
 		}
 	}
@@ -239,7 +242,7 @@ bool SphereMapConverter::Init
 		desc.Height = UINT(size);
 		desc.DepthOrArraySize = 6;
 		desc.MipLevels = m_MipCount;
-		desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		desc.Format = CubeMapFormat;
 		desc.SampleDesc.Count = 1;
 		desc.SampleDesc.Quality = 0;
 		desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
@@ -251,7 +254,7 @@ bool SphereMapConverter::Init
 		prop.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
 
 		D3D12_CLEAR_VALUE clearValue = {};
-		clearValue.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		clearValue.Format = CubeMapFormat;
 		clearValue.Color[0] = 0.0f;
 		clearValue.Color[1] = 0.0f;
 		clearValue.Color[2] = 0.0f;
@@ -281,7 +284,7 @@ bool SphereMapConverter::Init
 		}
 
 		D3D12_SHADER_RESOURCE_VIEW_DESC desc = {};
-		desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		desc.Format = CubeMapFormat;
 		desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
 		desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 		desc.TextureCube.MipLevels = m_MipCount;
@@ -310,7 +313,7 @@ bool SphereMapConverter::Init
 				m_pCubeRTV[idx] = pHandle;
 
 				D3D12_RENDER_TARGET_VIEW_DESC desc = {};
-				desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+				desc.Format = CubeMapFormat;
 				desc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2DARRAY;
 				desc.Texture2DArray.ArraySize = 1;
 				desc.Texture2DArray.FirstArraySlice = i;
@@ -464,6 +467,7 @@ void SphereMapConverter::Term()
 	m_VB.Term();
 	m_IB.Term();
 	m_pRootSig.Reset();
+	m_RootSigHash = 0;
 	m_pPSO.Reset();
 
 	for (auto i = 0; i < 6; ++i)
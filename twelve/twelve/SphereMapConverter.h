@@ -13,6 +13,7 @@
 #include "ConstantBuffer.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include "PipelineCache.h"
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -29,7 +30,7 @@ public:
 	//=========================================================================
 	// public variables.
 	//=========================================================================
-	/* NOTHING */
+	static const DXGI_FORMAT CubeMapFormat = DXGI_FORMAT_R11G11B10_FLOAT;    //!< L[u}bṽtH[}bg (At@͎gpȂ).
 
 	//=========================================================================
 	// public methods.
@@ -52,6 +53,8 @@ public:
 	//! @param[in]      pPoolRTV        _[^[QbgpfBXNv^v[ł.
 	//! @param[in]      pPoolRes        \[XpfBXNv^v[ł.
 	//! @param[in]      sphereMapDesc   XtBA}bv̍\ݒł.
+	//! @param[in]      mapSize         L[u}bṽTCYł (-1̏ꍇ̓XtBA}bv猈肵܂).
+	//! @param[in]      pPipelineCache  pCvCLbVł (nullptȑꍇ͒ڐ܂).
 	//! @retval true    ɐ.
 	//! @retval false   Ɏs.
 	//-------------------------------------------------------------------------
@@ -60,7 +63,8 @@ public:
 		DescriptorPool* pPoolRTV,
 		DescriptorPool* pPoolRes,
 		const D3D12_RESOURCE_DESC& sphereMapDesc,
-		int                         mapSize = -1);
+		int                         mapSize = -1,
+		PipelineCache*              pPipelineCache = nullptr);
 
 	//-------------------------------------------------------------------------
 	//! @brief      Is܂.
@@ -105,6 +109,7 @@ private:
 	DescriptorPool* m_pPoolRes;         //!< \[XpfBXNv^v[.
 	DescriptorPool* m_pPoolRTV;         //!< _[^[QbgpfBXNv^v[.
 	ComPtr<ID3D12RootSignature>     m_pRootSig;         //!< [gVOj`ł.
+	uint64_t                        m_RootSigHash;      //!< [gVOj`̃nbVlł.
 	ComPtr<ID3D12PipelineState>     m_pPSO;             //!< pCvCXe[gł.
 	ComPtr<ID3D12Resource>          m_pCubeTex;         //!< L[u}bveNX`ł.
 	DescriptorHandle* m_pCubeSRV;         //!< VF[_\[Xr[ł.
@@ -0,0 +1,138 @@
+﻿#include "SphereMapConverterCPU.h"
+
+#include <chrono>
+#include <filesystem>
+
+#include "CompactCubeMap.h"
+#include "HashUtil.h"
+#include "ParallelFor.h"
+#include "SphereMapProjection.h"
+#include "Logger.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 経過時間をミリ秒で取得する
+	/// </summary>
+	double GetElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+}
+
+SphereMapConverterCPU::SphereMapConverterCPU()
+	: m_SourceHash(0)
+	, m_CacheHit(false)
+{
+}
+
+SphereMapConverterCPU::~SphereMapConverterCPU()
+{
+}
+
+bool SphereMapConverterCPU::Convert(const wchar_t* sphereMapPath, int mapSize)
+{
+	if (sphereMapPath == nullptr)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	m_CacheHit = false;
+	m_CubeMap = CpuCubeMap();
+
+	// ソースファイルのハッシュ値を計算
+	if (!ComputeFileHash(sphereMapPath, m_SourceHash))
+	{
+		ELOG("Error : File Read Failed. path = %ls", sphereMapPath);
+		return false;
+	}
+
+	// キャッシュファイルのパスを決定
+	// <ソースのディレクトリ>/Cache/<ファイル名>_<ハッシュ値>_<サイズ>_compact.dds
+	std::filesystem::path source(sphereMapPath);
+	auto cacheDir = source.parent_path() / L"Cache";
+
+	auto sizeKey = (mapSize == -1) ? std::wstring(L"auto") : std::to_wstring(mapSize);
+	auto cacheName = source.stem().wstring() + L"_" + ToHexString(m_SourceHash) + L"_" + sizeKey + L"_compact.dds";
+
+	m_CubeMapPath = (cacheDir / cacheName).wstring();
+
+	std::error_code error;
+	if (std::filesystem::exists(m_CubeMapPath, error))
+	{
+		m_CacheHit = true;
+		ILOG("SphereMapConverterCPU : Cache Hit. path = %ls", m_CubeMapPath.c_str());
+		return true;
+	}
+
+	// スフィアマップを読み込み
+	CpuImage sphereMap;
+	if (!LoadImageRGBA32F(sphereMapPath, sphereMap))
+	{
+		ELOG("Error : LoadImageRGBA32F() Failed. path = %ls", sphereMapPath);
+		return false;
+	}
+
+	auto size = (mapSize == -1) ? CalcSphereMapCubeSize(sphereMap.Width) : uint32_t(mapSize);
+
+	// 変換
+	auto start = std::chrono::steady_clock::now();
+	ConvertSphereMapToCube(sphereMap, size, m_CubeMap);
+	auto elapsed = GetElapsedMilliseconds(start);
+
+	ILOG("SphereMapConverterCPU : %ux%u -> %ux%u (%u mips), %u threads, %.3f ms",
+		sphereMap.Width, sphereMap.Height, size, size, m_CubeMap.MipCount, GetWorkerThreadCount(), elapsed);
+
+	// キャッシュに保存
+	std::filesystem::create_directories(cacheDir, error);
+	CompactCubeMapReport report;
+	if (!SaveCubeMapCompact(m_CubeMapPath.c_str(), m_CubeMap, &report))
+	{
+		ELOG("Error : SaveCubeMapCompact() Failed. path = %ls", m_CubeMapPath.c_str());
+		return false;
+	}
+
+	LogCompactCubeMapReport(source.filename().wstring().c_str(), report);
+
+	return true;
+}
+
+const std::wstring& SphereMapConverterCPU::GetCubeMapPath() const
+{
+	return m_CubeMapPath;
+}
+
+uint64_t SphereMapConverterCPU::GetSourceHash() const
+{
+	return m_SourceHash;
+}
+
+bool SphereMapConverterCPU::IsCacheHit() const
+{
+	return m_CacheHit;
+}
+
+bool SphereMapConverterCPU::GetCubeMap(CpuCubeMap& cube)
+{
+	if (m_CubeMap.Images.empty())
+	{
+		if (m_CubeMapPath.empty())
+		{
+			ELOG("Error : Not Converted.");
+			return false;
+		}
+
+		if (!LoadCubeMapFromDDS(m_CubeMapPath.c_str(), m_CubeMap))
+		{
+			ELOG("Error : LoadCubeMapFromDDS() Failed. path = %ls", m_CubeMapPath.c_str());
+			return false;
+		}
+	}
+
+	cube = m_CubeMap;
+	return true;
+}
@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <string>
+
+#include "CubeMapUtil.h"
+
+/// <summary>
+/// スフィアマップ (正距円筒図法) からキューブマップへの変換をCPUで行う
+/// 変換結果はソースファイルのハッシュ値をキーにDDSとしてキャッシュし, 2回目以降の起動では変換を省略する
+/// キャッシュは BC6H (適さない場合は R11G11B10_FLOAT) で保存する (SaveCubeMapCompact() を参照)
+/// </summary>
+class SphereMapConverterCPU
+{
+public:
+	SphereMapConverterCPU();
+	~SphereMapConverterCPU();
+
+	/// <summary>
+	/// キャッシュを検索し, 見つからなければ変換してキャッシュを生成する
+	/// </summary>
+	/// <param name="sphereMapPath">スフィアマップのファイルパス</param>
+	/// <param name="mapSize">キューブマップ1面の横幅 (-1の場合はスフィアマップの横幅から決定)</param>
+	/// <returns>キューブマップのDDSが用意できた場合はtrue</returns>
+	bool Convert(const wchar_t* sphereMapPath, int mapSize = -1);
+
+	/// <summary>
+	/// キャッシュされたキューブマップのファイルパスを取得する
+	/// </summary>
+	const std::wstring& GetCubeMapPath() const;
+
+	/// <summary>
+	/// ソースファイルのハッシュ値を取得する
+	/// </summary>
+	uint64_t GetSourceHash() const;
+
+	/// <summary>
+	/// キャッシュにヒットしたかどうか
+	/// </summary>
+	bool IsCacheHit() const;
+
+	/// <summary>
+	/// 変換結果のキューブマップを取得する
+	/// キャッシュにヒットした場合はDDSから読み込んでから返す
+	/// </summary>
+	/// <param name="cube">キューブマップの格納先</param>
+	/// <returns>取得に成功した場合はtrue</returns>
+	bool GetCubeMap(CpuCubeMap& cube);
+
+private:
+	std::wstring	m_CubeMapPath;	// キャッシュのファイルパス
+	uint64_t		m_SourceHash;	// ソースファイルのハッシュ値
+	bool			m_CacheHit;		// キャッシュにヒットしたかどうか
+	CpuCubeMap		m_CubeMap;		// 変換結果 (キャッシュにヒットした場合は空)
+
+	SphereMapConverterCPU(const SphereMapConverterCPU&) = delete;
+	void operator=(const SphereMapConverterCPU&) = delete;
+};
@@ -0,0 +1,99 @@
+﻿#include "SphereMapProjection.h"
+
+#include "ParallelFor.h"
+
+using namespace DirectX;
+
+namespace
+{
+	/// <summary>
+	/// 1行分のテクセルをスフィアマップからサンプリングする
+	/// 4テクセル分の方向ベクトルをSoAで求め, 逆三角関数をまとめて評価する
+	/// </summary>
+	void ConvertRow(const CpuImage& sphereMap, uint32_t face, uint32_t y, CpuImage& dst)
+	{
+		const auto size = dst.Width;
+		const auto invSize = 1.0f / float(size);
+
+		const auto offset = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+		const auto scale = XMVectorReplicate(2.0f * invSize);
+		const auto one = XMVectorReplicate(1.0f);
+		const auto invTwoPi = XMVectorReplicate(XM_1DIV2PI);
+		const auto invPi = XMVectorReplicate(XM_1DIVPI);
+		const auto half = XMVectorReplicate(0.5f);
+
+		// 行内で一定の成分
+		auto t = XMVectorReplicate(1.0f - (float(y) + 0.5f) * 2.0f * invSize);
+
+		auto row = dst.GetRow(y);
+
+		for (auto x = 0u; x < size; x += 4)
+		{
+			auto s = XMVectorSubtract(XMVectorMultiply(XMVectorAdd(XMVectorReplicate(float(x)), offset), scale), one);
+
+			// CalcCubeDirection() と同じ規約で方向ベクトルを求める
+			XMVECTOR dx, dy, dz;
+			switch (face)
+			{
+				case 0: { dx = one;                 dy = t;                 dz = XMVectorNegate(s); } break;
+				case 1: { dx = XMVectorNegate(one); dy = t;                 dz = s;                 } break;
+				case 2: { dx = s;                   dy = one;               dz = XMVectorNegate(t); } break;
+				case 3: { dx = s;                   dy = XMVectorNegate(one); dz = t;               } break;
+				case 4: { dx = s;                   dy = t;                 dz = one;               } break;
+				default: { dx = XMVectorNegate(s);  dy = t;                 dz = XMVectorNegate(one); } break;
+			}
+
+			auto lenSq = XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz)));
+			auto invLen = XMVectorReciprocalSqrt(lenSq);
+			dy = XMVectorMultiply(dy, invLen);
+
+			// GPU版(SphereMapConverter)はZ軸が反転した向きで描画しているため, 見た目を合わせる
+			auto u = XMVectorMultiply(XMVectorATan2(dx, XMVectorNegate(dz)), invTwoPi);
+			u = XMVectorSelect(u, XMVectorAdd(u, one), XMVectorLess(u, XMVectorZero()));
+
+			auto v = XMVectorSubtract(half, XMVectorMultiply(XMVectorASin(XMVectorClamp(dy, XMVectorNegate(one), one)), invPi));
+
+			XMFLOAT4 uu, vv;
+			XMStoreFloat4(&uu, u);
+			XMStoreFloat4(&vv, v);
+
+			const float* pu = &uu.x;
+			const float* pv = &vv.x;
+
+			auto count = (size - x < 4) ? (size - x) : 4;
+			for (auto i = 0u; i < count; ++i)
+			{
+				XMStoreFloat4(&row[x + i], SampleBilinear(sphereMap, pu[i], pv[i], true));
+			}
+		}
+	}
+}
+
+uint32_t CalcSphereMapCubeSize(uint32_t sphereMapWidth)
+{
+	auto tempSize = sphereMapWidth / 4;
+
+	uint32_t size = 1;
+	while (size < tempSize)
+	{
+		size <<= 1;
+	}
+
+	return size;
+}
+
+void ConvertSphereMapToCube(const CpuImage& sphereMap, uint32_t size, CpuCubeMap& cube)
+{
+	cube.Resize(size, CalcMipCount(size));
+
+	// ミップレベル0を面と行単位で並列に変換
+	ParallelFor(0, 6 * size, [&](uint32_t index)
+	{
+		auto face = index / size;
+		auto y = index % size;
+		ConvertRow(sphereMap, face, y, cube.GetImage(face, 0));
+	});
+
+	// 下位ミップはボックスフィルタで縮小
+	GenerateCubeMips(cube);
+}
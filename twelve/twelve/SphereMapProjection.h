@@ -0,0 +1,21 @@
+﻿#pragma once
+
+#include <cstdint>
+
+#include "CubeMapImage.h"
+
+/// <summary>
+/// スフィアマップの横幅からキューブマップのサイズを求める (SphereMapConverterと同じ規則)
+/// </summary>
+/// <param name="sphereMapWidth">スフィアマップの横幅</param>
+/// <returns>キューブマップ1面の横幅 (2のべき乗)</returns>
+uint32_t CalcSphereMapCubeSize(uint32_t sphereMapWidth);
+
+/// <summary>
+/// スフィアマップ (正距円筒図法) をキューブマップに変換する
+/// 面と行単位でスレッドに分配し, バイリニア補間でサンプリングした後にミップマップを生成する
+/// </summary>
+/// <param name="sphereMap">スフィアマップ</param>
+/// <param name="size">キューブマップ1面の横幅</param>
+/// <param name="cube">キューブマップの格納先</param>
+void ConvertSphereMapToCube(const CpuImage& sphereMap, uint32_t size, CpuCubeMap& cube);
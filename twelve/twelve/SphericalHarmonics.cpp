@@ -0,0 +1,243 @@
+﻿#include "SphericalHarmonics.h"
+
+#include <cmath>
+#include <vector>
+
+#include "ParallelFor.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// 実球面調和関数の正規化定数
+	const float SH_C0 = 0.282094792f;	// 1 / (2 sqrt(π))
+	const float SH_C1 = 0.488602512f;	// sqrt(3 / (4π))
+	const float SH_C2 = 1.092548431f;	// sqrt(15 / (4π))
+	const float SH_C3 = 0.315391565f;	// sqrt(5 / (16π))
+	const float SH_C4 = 0.546274215f;	// sqrt(15 / (16π))
+
+	/// <summary>
+	/// 1行分の射影結果 (倍精度で集計する)
+	/// </summary>
+	struct RowSum
+	{
+		double Coeffs[9][3];
+		double Weight;
+	};
+
+	/// <summary>
+	/// 4テクセル分の基底関数を評価する
+	/// </summary>
+	void EvaluateBasis(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, XMVECTOR basis[9])
+	{
+		basis[0] = XMVectorReplicate(SH_C0);
+		basis[1] = XMVectorScale(y, SH_C1);
+		basis[2] = XMVectorScale(z, SH_C1);
+		basis[3] = XMVectorScale(x, SH_C1);
+		basis[4] = XMVectorScale(XMVectorMultiply(x, y), SH_C2);
+		basis[5] = XMVectorScale(XMVectorMultiply(y, z), SH_C2);
+		basis[6] = XMVectorScale(XMVectorSubtract(XMVectorScale(XMVectorMultiply(z, z), 3.0f), XMVectorSplatOne()), SH_C3);
+		basis[7] = XMVectorScale(XMVectorMultiply(x, z), SH_C2);
+		basis[8] = XMVectorScale(XMVectorSubtract(XMVectorMultiply(x, x), XMVectorMultiply(y, y)), SH_C4);
+	}
+
+	/// <summary>
+	/// 1行分のテクセルを射影する
+	/// 4テクセル分の方向ベクトルと立体角をSoAで求め, 基底関数との積を累積する
+	/// </summary>
+	void ProjectRow(const CpuImage& image, uint32_t face, uint32_t y, RowSum& result)
+	{
+		const auto size = image.Width;
+		const auto invSize = 1.0f / float(size);
+
+		const auto offset = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+		const auto scale = XMVectorReplicate(2.0f * invSize);
+		const auto one = XMVectorSplatOne();
+		const auto texelArea = XMVectorReplicate(4.0f * invSize * invSize);
+
+		auto t = XMVectorReplicate(1.0f - (float(y) + 0.5f) * 2.0f * invSize);
+
+		XMVECTOR accR[9], accG[9], accB[9];
+		for (auto i = 0; i < 9; ++i)
+		{
+			accR[i] = accG[i] = accB[i] = XMVectorZero();
+		}
+
+		auto accWeight = XMVectorZero();
+		auto row = image.GetRow(y);
+
+		for (auto x = 0u; x < size; x += 4)
+		{
+			auto s = XMVectorSubtract(XMVectorMultiply(XMVectorAdd(XMVectorReplicate(float(x)), offset), scale), one);
+
+			// CalcCubeDirection() と同じ規約で方向ベクトルを求める
+			XMVECTOR dx, dy, dz;
+			switch (face)
+			{
+				case 0: { dx = one;                 dy = t;                 dz = XMVectorNegate(s); } break;
+				case 1: { dx = XMVectorNegate(one); dy = t;                 dz = s;                 } break;
+				case 2: { dx = s;                   dy = one;               dz = XMVectorNegate(t); } break;
+				case 3: { dx = s;                   dy = XMVectorNegate(one); dz = t;               } break;
+				case 4: { dx = s;                   dy = t;                 dz = one;               } break;
+				default: { dx = XMVectorNegate(s);  dy = t;                 dz = XMVectorNegate(one); } break;
+			}
+
+			// 立体角 dω = (2 / size)^2 / (1 + s^2 + t^2)^(3/2)
+			auto lenSq = XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dz, dz)));
+			auto invLen = XMVectorReciprocalSqrt(lenSq);
+			auto weight = XMVectorMultiply(texelArea, XMVectorMultiply(invLen, XMVectorMultiply(invLen, invLen)));
+
+			dx = XMVectorMultiply(dx, invLen);
+			dy = XMVectorMultiply(dy, invLen);
+			dz = XMVectorMultiply(dz, invLen);
+
+			// 行末の余りは重みを0にする
+			auto count = (size - x < 4) ? (size - x) : 4;
+			XMFLOAT4 r(0.0f, 0.0f, 0.0f, 0.0f), g(0.0f, 0.0f, 0.0f, 0.0f), b(0.0f, 0.0f, 0.0f, 0.0f);
+			float* pr = &r.x;
+			float* pg = &g.x;
+			float* pb = &b.x;
+
+			for (auto i = 0u; i < count; ++i)
+			{
+				pr[i] = row[x + i].x;
+				pg[i] = row[x + i].y;
+				pb[i] = row[x + i].z;
+			}
+
+			if (count < 4)
+			{
+				auto lane = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+				weight = XMVectorSelect(XMVectorZero(), weight, XMVectorLess(lane, XMVectorReplicate(float(count))));
+			}
+
+			auto wr = XMVectorMultiply(XMLoadFloat4(&r), weight);
+			auto wg = XMVectorMultiply(XMLoadFloat4(&g), weight);
+			auto wb = XMVectorMultiply(XMLoadFloat4(&b), weight);
+
+			XMVECTOR basis[9];
+			EvaluateBasis(dx, dy, dz, basis);
+
+			for (auto i = 0; i < 9; ++i)
+			{
+				accR[i] = XMVectorMultiplyAdd(basis[i], wr, accR[i]);
+				accG[i] = XMVectorMultiplyAdd(basis[i], wg, accG[i]);
+				accB[i] = XMVectorMultiplyAdd(basis[i], wb, accB[i]);
+			}
+
+			accWeight = XMVectorAdd(accWeight, weight);
+		}
+
+		auto sum = [](FXMVECTOR v)
+		{
+			XMFLOAT4 f;
+			XMStoreFloat4(&f, v);
+			return double(f.x) + double(f.y) + double(f.z) + double(f.w);
+		};
+
+		for (auto i = 0; i < 9; ++i)
+		{
+			result.Coeffs[i][0] = sum(accR[i]);
+			result.Coeffs[i][1] = sum(accG[i]);
+			result.Coeffs[i][2] = sum(accB[i]);
+		}
+
+		result.Weight = sum(accWeight);
+	}
+}
+
+void ProjectSH9(const CpuCubeMap& cube, uint32_t mip, SH9Color& result)
+{
+	result = SH9Color();
+
+	if (cube.Images.empty() || mip >= cube.MipCount)
+	{
+		return;
+	}
+
+	const auto size = cube.GetImage(0, mip).Width;
+
+	// 行ごとの結果を個別に保持し, 最後に合算する (スレッド数によらず結果を一定にする)
+	std::vector<RowSum> rows(6 * size_t(size));
+
+	ParallelFor(0, 6 * size, [&](uint32_t index)
+	{
+		auto face = index / size;
+		auto y = index % size;
+		ProjectRow(cube.GetImage(face, mip), face, y, rows[index]);
+	});
+
+	double coeffs[9][3] = {};
+	double weight = 0.0;
+
+	for (const auto& row : rows)
+	{
+		for (auto i = 0; i < 9; ++i)
+		{
+			coeffs[i][0] += row.Coeffs[i][0];
+			coeffs[i][1] += row.Coeffs[i][1];
+			coeffs[i][2] += row.Coeffs[i][2];
+		}
+
+		weight += row.Weight;
+	}
+
+	// 立体角の近似誤差を補正して全球の面積を4πに合わせる
+	auto normalize = (weight > 0.0) ? (4.0 * XM_PI / weight) : 0.0;
+
+	for (auto i = 0; i < 9; ++i)
+	{
+		result.Coeffs[i].x = float(coeffs[i][0] * normalize);
+		result.Coeffs[i].y = float(coeffs[i][1] * normalize);
+		result.Coeffs[i].z = float(coeffs[i][2] * normalize);
+	}
+}
+
+void ConvolveCosineLobe(SH9Color& sh)
+{
+	// コサインローブの帯域ごとの係数 A_l = (π, 2π/3, π/4) をπで割ったもの
+	static const float bands[9] = {
+		1.0f,
+		2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+		0.25f, 0.25f, 0.25f, 0.25f, 0.25f,
+	};
+
+	for (auto i = 0; i < 9; ++i)
+	{
+		sh.Coeffs[i].x *= bands[i];
+		sh.Coeffs[i].y *= bands[i];
+		sh.Coeffs[i].z *= bands[i];
+	}
+}
+
+XMVECTOR EvaluateSH9(const SH9Color& sh, FXMVECTOR dir)
+{
+	XMVECTOR basis[9];
+	EvaluateBasis(XMVectorSplatX(dir), XMVectorSplatY(dir), XMVectorSplatZ(dir), basis);
+
+	auto result = XMVectorZero();
+	for (auto i = 0; i < 9; ++i)
+	{
+		result = XMVectorMultiplyAdd(XMLoadFloat3(&sh.Coeffs[i]), basis[i], result);
+	}
+
+	return result;
+}
+
+void EvaluateSH9ToCube(const SH9Color& sh, uint32_t size, CpuCubeMap& result)
+{
+	result.Resize(size, 1);
+
+	ParallelFor(0, 6 * size, [&](uint32_t index)
+	{
+		auto face = index / size;
+		auto y = index % size;
+		auto row = result.GetImage(face, 0).GetRow(y);
+
+		for (auto x = 0u; x < size; ++x)
+		{
+			auto dir = CalcCubeDirection(face, (float(x) + 0.5f) / float(size), (float(y) + 0.5f) / float(size));
+			XMStoreFloat4(&row[x], XMVectorSetW(EvaluateSH9(sh, dir), 1.0f));
+		}
+	});
+}
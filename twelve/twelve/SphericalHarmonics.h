@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include "CubeMapUtil.h"
+
+/// <summary>
+/// 3次 (L2) までの球面調和関数の係数 (RGB × 9)
+/// 係数の並びは (l, m) = (0, 0), (1, -1), (1, 0), (1, 1), (2, -2), (2, -1), (2, 0), (2, 1), (2, 2)
+/// </summary>
+struct SH9Color
+{
+	DirectX::XMFLOAT3 Coeffs[9] = {};
+};
+
+/// <summary>
+/// キューブマップを球面調和関数に射影する
+/// 面と行単位でスレッドに分配し, 4テクセル分の基底関数をSoAでまとめて評価する
+/// </summary>
+/// <param name="cube">キューブマップ</param>
+/// <param name="mip">射影に使用するミップレベル</param>
+/// <param name="result">射影結果の格納先 (放射輝度の係数)</param>
+void ProjectSH9(const CpuCubeMap& cube, uint32_t mip, SH9Color& result);
+
+/// <summary>
+/// 放射輝度の係数をコサインローブで畳み込み, 放射照度 / π の係数に変換する
+/// 変換後の係数は Diffuse LD項 (Lambert BRDFの重点サンプリング結果) と同じ値を表す
+/// </summary>
+/// <param name="sh">球面調和関数の係数</param>
+void ConvolveCosineLobe(SH9Color& sh);
+
+/// <summary>
+/// 指定方向の値を評価する (IBLPS.hlsl の EvaluateSH9() と同じ計算)
+/// </summary>
+/// <param name="sh">球面調和関数の係数</param>
+/// <param name="dir">正規化された方向ベクトル</param>
+/// <returns>評価結果</returns>
+DirectX::XMVECTOR EvaluateSH9(const SH9Color& sh, DirectX::FXMVECTOR dir);
+
+/// <summary>
+/// 球面調和関数をキューブマップに展開する (誤差評価用)
+/// </summary>
+/// <param name="sh">球面調和関数の係数</param>
+/// <param name="size">キューブマップ1面の横幅</param>
+/// <param name="result">キューブマップの格納先</param>
+void EvaluateSH9ToCube(const SH9Color& sh, uint32_t size, CpuCubeMap& result);
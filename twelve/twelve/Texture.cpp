@@ -2,8 +2,10 @@
 
 #include <DDSTextureLoader.h>
 #include <WICTextureLoader.h>
+#include <BufferHelpers.h>
 
 #include "DescriptorPool.h"
+#include "HDRImageLoader.h"
 #include "Logger.h"
 
 namespace
@@ -108,7 +110,31 @@ bool Texture::Init(ID3D12Device* pDevice, DescriptorPool* pPool, const wchar_t*
 	bool isCube = false;
 	HRESULT hr = S_OK;
 
-	if (isDDS)
+	if (IsHDRImageFile(filename))
+	{
+		// .hdr / .exr は独自のデコーダーでRGBA16Fに復号してから転送する
+		// 転送データはCreateTextureFromMemory内でアップロードバッファにコピーされる
+		CpuImageHalf image;
+		if (!LoadHDRImage(filename, image))
+		{
+			return false;
+		}
+
+		D3D12_SUBRESOURCE_DATA data = {};
+		data.pData = image.Pixels.data();
+		data.RowPitch = LONG_PTR(image.GetRowPitch());
+		data.SlicePitch = LONG_PTR(image.GetRowPitch() * image.Height);
+
+		hr = DirectX::CreateTextureFromMemory(
+			pDevice,
+			batch,
+			image.Width,
+			image.Height,
+			DXGI_FORMAT_R16G16B16A16_FLOAT,
+			data,
+			m_pTex.GetAddressOf());
+	}
+	else if (isDDS)
 	{
 		// DDSの場合
 		hr = hr = DirectX::CreateDDSTextureFromFile(
@@ -0,0 +1,554 @@
+﻿#include "TextureAtlasPacker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <set>
+#include <DirectXTex.h>
+
+#include "CubeMapUtil.h"
+#include "FileUtil.h"
+#include "HashUtil.h"
+#include "HDRImageLoader.h"
+#include "NormalMipGenerator.h"
+#include "ParallelFor.h"
+#include "Logger.h"
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t CacheVersion = 1;	// キャッシュの形式を変えた場合に更新する
+
+	// 用途ごとのキャッシュファイル名
+	const wchar_t* UsageNames[ATLAS_USAGE_COUNT] = {
+		L"bc",
+		L"n",
+		L"orm",
+	};
+
+	/// <summary>
+	/// アトラスにまとめるマテリアル
+	/// </summary>
+	struct AtlasSource
+	{
+		uint32_t		MaterialIndex = 0;				// マテリアル番号
+		std::wstring	Paths[ATLAS_USAGE_COUNT];		// 検索したファイルパス (ない場合は空)
+		bool			IsSRGB[ATLAS_USAGE_COUNT] = {};	// sRGBフォーマットかどうか
+		AtlasRectSize	Size;							// 用途の中で最大のサイズ
+	};
+
+	/// <summary>
+	/// 経過時間をミリ秒で取得する
+	/// </summary>
+	double GetElapsedMilliseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	/// <summary>
+	/// 値を指定の倍数に切り上げる
+	/// </summary>
+	uint32_t AlignUp(uint32_t value, uint32_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	/// <summary>
+	/// 画像ファイルのサイズとフォーマットを取得する (画素は読み込まない)
+	/// </summary>
+	bool GetImageInfo(const std::wstring& path, AtlasRectSize& size, bool& isSRGB)
+	{
+		if (IsHDRImageFile(path.c_str()))
+		{
+			return false;
+		}
+
+		auto ext = std::filesystem::path(path).extension().wstring();
+		for (auto& c : ext)
+		{
+			c = towlower(c);
+		}
+
+		TexMetadata metadata = {};
+		auto hr = (ext == L".dds")
+			? GetMetadataFromDDSFile(path.c_str(), DDS_FLAGS_NONE, metadata)
+			: GetMetadataFromWICFile(path.c_str(), WIC_FLAGS_NONE, metadata);
+		if (FAILED(hr) || metadata.dimension != TEX_DIMENSION_TEXTURE2D || metadata.IsCubemap())
+		{
+			return false;
+		}
+
+		size.Width = uint32_t(metadata.width);
+		size.Height = uint32_t(metadata.height);
+		isSRGB = IsSRGB(metadata.format);
+		return true;
+	}
+
+	/// <summary>
+	/// 線形の値をsRGBにエンコードする
+	/// </summary>
+	float EncodeSRGB(float value)
+	{
+		value = std::clamp(value, 0.0f, 1.0f);
+		return (value <= 0.0031308f)
+			? value * 12.92f
+			: 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	/// <summary>
+	/// 画像をバイリニア補間で拡縮する
+	/// </summary>
+	void ResizeImage(const CpuImage& src, uint32_t width, uint32_t height, CpuImage& dst)
+	{
+		if (src.Width == width && src.Height == height)
+		{
+			dst = src;
+			return;
+		}
+
+		dst.Resize(width, height);
+		for (auto y = 0u; y < height; ++y)
+		{
+			auto pRow = dst.GetRow(y);
+			auto v = (float(y) + 0.5f) / float(height);
+
+			for (auto x = 0u; x < width; ++x)
+			{
+				auto u = (float(x) + 0.5f) / float(width);
+				XMStoreFloat4(&pRow[x], SampleBilinear(src, u, v, false));
+			}
+		}
+	}
+
+	/// <summary>
+	/// 2x2ボックスフィルタで指定数のミップを生成する
+	/// </summary>
+	void GenerateBoxMips(const CpuImage& image, uint32_t mipCount, std::vector<CpuImage>& mips)
+	{
+		mips.resize(mipCount);
+		mips[0] = image;
+
+		for (auto mip = 1u; mip < mipCount; ++mip)
+		{
+			const auto& src = mips[mip - 1];
+			auto& dst = mips[mip];
+			dst.Resize(std::max(src.Width >> 1, 1u), std::max(src.Height >> 1, 1u));
+
+			for (auto y = 0u; y < dst.Height; ++y)
+			{
+				auto pRow0 = src.GetRow(std::min(y * 2, src.Height - 1));
+				auto pRow1 = src.GetRow(std::min(y * 2 + 1, src.Height - 1));
+				auto pDst = dst.GetRow(y);
+
+				for (auto x = 0u; x < dst.Width; ++x)
+				{
+					auto x0 = std::min(x * 2, src.Width - 1);
+					auto x1 = std::min(x * 2 + 1, src.Width - 1);
+
+					auto sum = XMLoadFloat4(&pRow0[x0]);
+					sum = XMVectorAdd(sum, XMLoadFloat4(&pRow0[x1]));
+					sum = XMVectorAdd(sum, XMLoadFloat4(&pRow1[x0]));
+					sum = XMVectorAdd(sum, XMLoadFloat4(&pRow1[x1]));
+
+					XMStoreFloat4(&pDst[x], XMVectorScale(sum, 0.25f));
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// 用途ごとの入力画像を読み込み配置サイズに拡縮する (ない場合は既定値で埋める)
+	/// </summary>
+	bool LoadUsageImage(const AtlasSource& source, const ResMaterial& material, ATLAS_USAGE usage, CpuImage& result)
+	{
+		auto width = source.Size.Width;
+		auto height = source.Size.Height;
+		const auto& path = source.Paths[usage];
+
+		if (path.empty())
+		{
+			XMFLOAT4 value(1.0f, 1.0f, 1.0f, 1.0f);
+			if (usage == ATLAS_USAGE_NORMAL)
+			{
+				value = XMFLOAT4(0.5f, 0.5f, 1.0f, 1.0f);
+			}
+			else if (usage == ATLAS_USAGE_ORM)
+			{
+				value = XMFLOAT4(1.0f, material.Roughness, material.Metallic, 1.0f);
+			}
+
+			result.Resize(width, height);
+			std::fill(result.Pixels.begin(), result.Pixels.end(), value);
+			return true;
+		}
+
+		CpuImage image;
+		if (!LoadImageRGBA32F(path.c_str(), image))
+		{
+			ELOG("Error : LoadImageRGBA32F() Failed. path = %ls", path.c_str());
+			return false;
+		}
+
+		// sRGBのファイルは読み込み時に線形に変換されるので, 元のエンコードに戻す
+		if (source.IsSRGB[usage])
+		{
+			for (auto& texel : image.Pixels)
+			{
+				texel.x = EncodeSRGB(texel.x);
+				texel.y = EncodeSRGB(texel.y);
+				texel.z = EncodeSRGB(texel.z);
+			}
+		}
+
+		ResizeImage(image, width, height, result);
+		return true;
+	}
+
+	/// <summary>
+	/// 1つのマテリアルを全ての用途のページに書き込む
+	/// </summary>
+	bool BlitAtlasSource
+	(
+		const AtlasSource& source,
+		const ResMaterial& material,
+		const AtlasPlacement& placement,
+		const AtlasPackDesc& desc,
+		std::vector<std::vector<CpuImage>>* pPages
+	)
+	{
+		CpuImage images[ATLAS_USAGE_COUNT];
+		for (auto usage = 0; usage < ATLAS_USAGE_COUNT; ++usage)
+		{
+			if (!LoadUsageImage(source, material, ATLAS_USAGE(usage), images[usage]))
+			{
+				return false;
+			}
+		}
+
+		// 内側の処理は呼び出し元で並列化しているので1スレッドで実行する
+		std::vector<CpuImage> normalMips;
+		GenerateNormalMips(images[ATLAS_USAGE_NORMAL], normalMips, 1);
+
+		std::vector<CpuImage> mips[ATLAS_USAGE_COUNT];
+		GenerateBoxMips(images[ATLAS_USAGE_BASE_COLOR], desc.MipCount, mips[ATLAS_USAGE_BASE_COLOR]);
+		GenerateRoughnessMips(images[ATLAS_USAGE_ORM], 1, normalMips, mips[ATLAS_USAGE_ORM], 1);
+
+		mips[ATLAS_USAGE_NORMAL] = normalMips;
+		for (auto& mip : mips[ATLAS_USAGE_NORMAL])
+		{
+			for (auto& texel : mip.Pixels)
+			{
+				texel.w = 1.0f;
+			}
+		}
+
+		for (auto usage = 0; usage < ATLAS_USAGE_COUNT; ++usage)
+		{
+			mips[usage].resize(desc.MipCount);
+			BlitAtlasMips(mips[usage], placement, desc, pPages[usage][placement.Page]);
+		}
+
+		return true;
+	}
+}
+
+bool BuildMaterialAtlas
+(
+	const std::wstring& directory,
+	std::vector<ResMesh>& meshes,
+	std::vector<ResMaterial>& materials,
+	const AtlasPackDesc& desc,
+	std::vector<AtlasPlacement>& placements,
+	AtlasPackReport* pReport
+)
+{
+	placements.assign(materials.size(), AtlasPlacement());
+
+	if (desc.MipCount == 0 || desc.PageSize == 0 || (desc.PageSize & (desc.PageSize - 1)) != 0)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	// メッシュのテクスチャ座標が [0, 1] に収まっているマテリアルを調べる
+	std::vector<uint8_t> isUVInRange(materials.size(), 1);
+	std::vector<uint8_t> isUsed(materials.size(), 0);
+	for (const auto& mesh : meshes)
+	{
+		if (mesh.MaterialId >= materials.size())
+		{
+			continue;
+		}
+
+		isUsed[mesh.MaterialId] = 1;
+		if (!IsUVInUnitRange(mesh))
+		{
+			isUVInRange[mesh.MaterialId] = 0;
+		}
+	}
+
+	// まとめる対象のマテリアルを集める
+	std::vector<AtlasSource> sources;
+	std::set<std::wstring> sourceTextures;
+
+	for (uint32_t i = 0; i < uint32_t(materials.size()); ++i)
+	{
+		if (!isUsed[i] || !isUVInRange[i])
+		{
+			continue;
+		}
+
+		const auto& material = materials[i];
+		const std::wstring* pRelativePaths[ATLAS_USAGE_COUNT] = {
+			&material.BaseColorMap,
+			&material.NormalMap,
+			&material.ORMMap,
+		};
+
+		AtlasSource source;
+		source.MaterialIndex = i;
+
+		auto isCandidate = true;
+		for (auto usage = 0; usage < ATLAS_USAGE_COUNT && isCandidate; ++usage)
+		{
+			if (pRelativePaths[usage]->empty())
+			{
+				continue;
+			}
+
+			std::wstring path;
+			if (!SearchFilePathW((directory + *pRelativePaths[usage]).c_str(), path))
+			{
+				continue;
+			}
+
+			AtlasRectSize size;
+			if (!GetImageInfo(path, size, source.IsSRGB[usage]) || size.Width > desc.MaxSourceSize || size.Height > desc.MaxSourceSize)
+			{
+				isCandidate = false;
+				break;
+			}
+
+			source.Paths[usage] = path;
+			source.Size.Width = std::max(source.Size.Width, size.Width);
+			source.Size.Height = std::max(source.Size.Height, size.Height);
+		}
+
+		// ベースカラーがないマテリアルはまとめない
+		if (!isCandidate || source.Paths[ATLAS_USAGE_BASE_COLOR].empty())
+		{
+			continue;
+		}
+
+		// 全ての用途を同じ配置にするので, アラインメント後のサイズで読み込む
+		auto alignment = CalcAtlasAlignment(desc);
+		source.Size.Width = AlignUp(source.Size.Width, alignment);
+		source.Size.Height = AlignUp(source.Size.Height, alignment);
+
+		for (const auto& path : source.Paths)
+		{
+			if (!path.empty())
+			{
+				sourceTextures.insert(path);
+			}
+		}
+
+		sources.push_back(source);
+	}
+
+	AtlasPackReport report;
+	report.SourceTextureCount = uint32_t(sourceTextures.size());
+
+	if (sources.size() < 2)
+	{
+		// まとめても効果がないので何もしない
+		report.AtlasTextureCount = report.SourceTextureCount;
+		if (pReport != nullptr)
+		{
+			*pReport = report;
+		}
+		return true;
+	}
+
+	// 配置を決める
+	std::vector<AtlasRectSize> sizes;
+	sizes.reserve(sources.size());
+	for (const auto& source : sources)
+	{
+		sizes.push_back(source.Size);
+	}
+
+	std::vector<AtlasPlacement> sourcePlacements;
+	PackAtlasRects(sizes, desc, sourcePlacements, &report);
+	report.SourceTextureCount = uint32_t(sourceTextures.size());
+
+	// キャッシュのキーを計算する
+	auto hash = ComputeHash(CacheVersion);
+	hash = ComputeHash(desc.PageSize, hash);
+	hash = ComputeHash(desc.MaxSourceSize, hash);
+	hash = ComputeHash(desc.MipCount, hash);
+	hash = ComputeHash(desc.Gutter, hash);
+	hash = ComputeHash(desc.Heuristic, hash);
+
+	for (size_t i = 0; i < sources.size(); ++i)
+	{
+		const auto& source = sources[i];
+		const auto& material = materials[source.MaterialIndex];
+
+		hash = ComputeHash(source.MaterialIndex, hash);
+		hash = ComputeHash(material.Roughness, hash);
+		hash = ComputeHash(material.Metallic, hash);
+
+		for (const auto& path : source.Paths)
+		{
+			uint64_t fileHash = 0;
+			if (!path.empty() && !ComputeFileHash(path.c_str(), fileHash))
+			{
+				ELOG("Error : File Read Failed. path = %ls", path.c_str());
+				return false;
+			}
+
+			hash = ComputeHash(fileHash, hash);
+		}
+	}
+
+	// キャッシュファイルのパスを決定
+	// <directory>/Cache/atlas_<ハッシュ値>_<用途>_<ページ番号>.dds
+	std::wstring foundDir;
+	if (!SearchFilePathW(directory.c_str(), foundDir))
+	{
+		ELOG("Error : Directory Not Found. path = %ls", directory.c_str());
+		return false;
+	}
+
+	auto cacheDir = std::filesystem::path(foundDir) / L"Cache";
+	std::vector<std::wstring> cacheNames[ATLAS_USAGE_COUNT];
+
+	auto isCached = true;
+	std::error_code error;
+	for (auto usage = 0; usage < ATLAS_USAGE_COUNT; ++usage)
+	{
+		for (auto page = 0u; page < report.PageCount; ++page)
+		{
+			auto name = L"atlas_" + ToHexString(hash) + L"_" + UsageNames[usage] + L"_" + std::to_wstring(page) + L".dds";
+			cacheNames[usage].push_back(name);
+
+			if (!std::filesystem::exists(cacheDir / name, error))
+			{
+				isCached = false;
+			}
+		}
+	}
+
+	report.CacheHit = isCached;
+
+	if (!isCached)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		// ページのミップを用意する
+		std::vector<std::vector<CpuImage>> pages[ATLAS_USAGE_COUNT];
+		for (auto usage = 0; usage < ATLAS_USAGE_COUNT; ++usage)
+		{
+			pages[usage].resize(report.PageCount);
+			for (auto& mips : pages[usage])
+			{
+				mips.resize(desc.MipCount);
+				for (auto mip = 0u; mip < desc.MipCount; ++mip)
+				{
+					auto size = std::max(report.PageSize >> mip, 1u);
+					mips[mip].Resize(size, size);
+					std::fill(mips[mip].Pixels.begin(), mips[mip].Pixels.end(), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+				}
+			}
+		}
+
+		// 配置した矩形はガターを含めて重ならないので, マテリアルごとに並列に書き込める
+		std::atomic<bool> isSucceeded(true);
+		ParallelFor(0, uint32_t(sources.size()), [&](uint32_t i)
+		{
+			const auto& placement = sourcePlacements[i];
+			if (!placement.IsPacked())
+			{
+				return;
+			}
+
+			const auto& source = sources[i];
+			if (!BlitAtlasSource(source, materials[source.MaterialIndex], placement, desc, pages))
+			{
+				isSucceeded = false;
+			}
+		});
+
+		if (!isSucceeded)
+		{
+			return false;
+		}
+
+		std::filesystem::create_directories(cacheDir, error);
+
+		for (auto usage = 0; usage < ATLAS_USAGE_COUNT; ++usage)
+		{
+			for (auto page = 0u; page < report.PageCount; ++page)
+			{
+				auto path = (cacheDir / cacheNames[usage][page]).wstring();
+				if (!SaveMipChainToDDS(path.c_str(), pages[usage][page], DXGI_FORMAT_BC7_UNORM))
+				{
+					ELOG("Error : SaveMipChainToDDS() Failed. path = %ls", path.c_str());
+					return false;
+				}
+			}
+		}
+
+		report.BuildMilliseconds = GetElapsedMilliseconds(start);
+	}
+
+	// マテリアルのテクスチャとメッシュのテクスチャ座標を書き換える
+	std::set<std::wstring> remainTextures;
+	for (size_t i = 0; i < sources.size(); ++i)
+	{
+		const auto& source = sources[i];
+		const auto& placement = sourcePlacements[i];
+
+		if (!placement.IsPacked())
+		{
+			for (const auto& path : source.Paths)
+			{
+				if (!path.empty())
+				{
+					remainTextures.insert(path);
+				}
+			}
+			continue;
+		}
+
+		auto& material = materials[source.MaterialIndex];
+		material.BaseColorMap = L"Cache/" + cacheNames[ATLAS_USAGE_BASE_COLOR][placement.Page];
+		material.NormalMap = L"Cache/" + cacheNames[ATLAS_USAGE_NORMAL][placement.Page];
+		material.ORMMap = L"Cache/" + cacheNames[ATLAS_USAGE_ORM][placement.Page];
+
+		placements[source.MaterialIndex] = placement;
+
+		auto scaleBias = placement.CalcUVScaleBias(report.PageSize);
+		for (auto& mesh : meshes)
+		{
+			if (mesh.MaterialId == source.MaterialIndex)
+			{
+				RemapMeshUV(mesh, scaleBias);
+			}
+		}
+	}
+
+	report.AtlasTextureCount = report.PageCount * ATLAS_USAGE_COUNT + uint32_t(remainTextures.size());
+
+	if (pReport != nullptr)
+	{
+		*pReport = report;
+	}
+
+	return true;
+}
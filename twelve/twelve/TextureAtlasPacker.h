@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+#include "AtlasRectPacker.h"
+
+/// <summary>
+/// アトラスにまとめるテクスチャの用途
+/// </summary>
+enum ATLAS_USAGE
+{
+	ATLAS_USAGE_BASE_COLOR = 0,		// ベースカラーマップ
+	ATLAS_USAGE_NORMAL,				// 法線マップ
+	ATLAS_USAGE_ORM,				// ORMマップ
+	ATLAS_USAGE_COUNT
+};
+
+/// <summary>
+/// 小さなマテリアルテクスチャを用途ごとのアトラスにまとめ, マテリアルのテクスチャパスとメッシュのテクスチャ座標を書き換える
+/// 1つのマテリアルの全ての用途は同じ配置を共有するので, メッシュのテクスチャ座標の書き換えは1回で済む
+/// 対象は MaxSourceSize 以下のテクスチャを持ち, 参照する全てのメッシュのテクスチャ座標が [0, 1] に収まるマテリアル
+/// ORMマップは PackMaterialORM() の結果 (ResMaterial::ORMMap) を使う
+/// 結果は <directory>/Cache にDDSとしてキャッシュする
+/// </summary>
+/// <param name="directory">マテリアルのテクスチャパスの基準ディレクトリ</param>
+/// <param name="meshes">メッシュ (テクスチャ座標を書き換える)</param>
+/// <param name="materials">マテリアル (まとめたテクスチャのパスを directory からの相対パスに書き換える)</param>
+/// <param name="desc">アトラスの設定</param>
+/// <param name="placements">マテリアルごとの配置結果の格納先</param>
+/// <param name="pReport">作成結果の格納先 (nullptrの場合は格納しない)</param>
+/// <returns>処理に成功した場合はtrue (まとめる対象がない場合も含む)</returns>
+bool BuildMaterialAtlas(
+	const std::wstring& directory,
+	std::vector<ResMesh>& meshes,
+	std::vector<ResMaterial>& materials,
+	const AtlasPackDesc& desc,
+	std::vector<AtlasPlacement>& placements,
+	AtlasPackReport* pReport = nullptr);
@@ -0,0 +1,253 @@
+﻿#include "TonemapLUT.h"
+
+#include <chrono>
+#include <cstring>
+#include <DirectXHelpers.h>
+
+#include "Constants.h"
+#include "Logger.h"
+
+TonemapLUT::TonemapLUT()
+	: m_pUploadData(nullptr)
+	, m_Footprint()
+	, m_UploadPitch(0)
+	, m_RowCount(0)
+	, m_RowSize(0)
+	, m_PendingValue(0)
+	, m_Size(0)
+	, m_FrontIndex(0)
+	, m_HasFront(false)
+	, m_IsBaked(false)
+	, m_NeedsUpload(false)
+{
+}
+
+TonemapLUT::~TonemapLUT()
+{
+	Term();
+}
+
+bool TonemapLUT::Init(ID3D12Device* pDevice, DescriptorPool* pPool, uint32_t size)
+{
+	if (pDevice == nullptr || pPool == nullptr || size < 2)
+	{
+		ELOG("Error : Invalid Argument.");
+		return false;
+	}
+
+	D3D12_RESOURCE_DESC desc = {};
+	desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+	desc.Alignment = 0;
+	desc.Width = size;
+	desc.Height = size;
+	desc.DepthOrArraySize = UINT16(size);
+	desc.MipLevels = 1;
+	desc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	for (auto i = 0u; i < BufferCount; ++i)
+	{
+		if (!m_Texture[i].Init(pDevice, pPool, &desc, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, false))
+		{
+			ELOG("Error : Texture::Init() Failed.");
+			return false;
+		}
+	}
+
+	// アップロード用バッファの生成 (フレームごとに1枚分の領域を持つ)
+	{
+		UINT64 totalBytes = 0;
+		pDevice->GetCopyableFootprints(&desc, 0, 1, 0, &m_Footprint, &m_RowCount, &m_RowSize, &totalBytes);
+
+		const UINT64 alignment = D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+		m_UploadPitch = (totalBytes + alignment - 1) & ~(alignment - 1);
+
+		D3D12_HEAP_PROPERTIES prop = {};
+		prop.Type = D3D12_HEAP_TYPE_UPLOAD;
+		prop.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		prop.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		prop.CreationNodeMask = 1;
+		prop.VisibleNodeMask = 1;
+
+		D3D12_RESOURCE_DESC bufferDesc = {};
+		bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		bufferDesc.Alignment = 0;
+		bufferDesc.Width = m_UploadPitch * Constants::MaxFrameCount;
+		bufferDesc.Height = 1;
+		bufferDesc.DepthOrArraySize = 1;
+		bufferDesc.MipLevels = 1;
+		bufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+		bufferDesc.SampleDesc.Count = 1;
+		bufferDesc.SampleDesc.Quality = 0;
+		bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		bufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		auto hr = pDevice->CreateCommittedResource(
+			&prop,
+			D3D12_HEAP_FLAG_NONE,
+			&bufferDesc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(m_pUploadBuffer.GetAddressOf()));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Device::CreateCommittedResource() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+
+		// アップロードヒープは開放するまでマップしたままにする
+		hr = m_pUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_pUploadData));
+		if (FAILED(hr))
+		{
+			ELOG("Error : ID3D12Resource::Map() Failed. retcode = 0x%x", hr);
+			return false;
+		}
+	}
+
+	m_Size = size;
+	m_FrontIndex = 0;
+	m_PendingValue = 0;
+	m_HasFront = false;
+	m_IsBaked = false;
+	m_NeedsUpload = false;
+
+	return true;
+}
+
+void TonemapLUT::Term()
+{
+	if (m_pUploadBuffer != nullptr && m_pUploadData != nullptr)
+	{
+		m_pUploadBuffer->Unmap(0, nullptr);
+	}
+
+	m_pUploadBuffer.Reset();
+	m_pUploadData = nullptr;
+
+	for (auto i = 0u; i < BufferCount; ++i)
+	{
+		m_Texture[i].Term();
+	}
+
+	m_Texels.clear();
+	m_Texels.shrink_to_fit();
+	m_Size = 0;
+	m_FrontIndex = 0;
+	m_PendingValue = 0;
+	m_HasFront = false;
+	m_IsBaked = false;
+	m_NeedsUpload = false;
+}
+
+bool TonemapLUT::Update(const TonemapParam& param, uint64_t completedValue)
+{
+	if (m_Size == 0)
+	{
+		return false;
+	}
+
+	// 裏のテクスチャへのコピーが完了していれば表と入れ替える
+	if (m_PendingValue != 0 && completedValue >= m_PendingValue)
+	{
+		m_FrontIndex = 1 - m_FrontIndex;
+		m_PendingValue = 0;
+	}
+
+	if (m_IsBaked && m_BakedParam == param)
+	{
+		return true;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	BakeTonemapLUT(param, m_Size, m_Texels);
+
+	auto end = std::chrono::steady_clock::now();
+
+	m_BakedParam = param;
+	m_IsBaked = true;
+	m_NeedsUpload = true;
+
+	ILOG("Info : TonemapLUT baked. size = %u^3, bake = %.3f ms",
+		m_Size,
+		std::chrono::duration<double, std::milli>(end - start).count());
+
+	return true;
+}
+
+void TonemapLUT::RecordUpload(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex, uint64_t fenceValue)
+{
+	if (!m_NeedsUpload || pCmd == nullptr || m_pUploadData == nullptr || frameIndex >= Constants::MaxFrameCount)
+	{
+		return;
+	}
+
+	// 表のテクスチャを参照する描画が残っていても, 書き込むのは裏のテクスチャのみ
+	// 表がまだない場合も裏に書き込み, 同じコマンドリストの後の描画から参照する
+	const auto back = m_HasFront ? 1 - m_FrontIndex : m_FrontIndex;
+
+	// このフレーム番号の領域は, 前回の使用が完了してから再利用される
+	auto footprint = m_Footprint;
+	footprint.Offset += m_UploadPitch * frameIndex;
+
+	{
+		const auto rowPitch = size_t(footprint.Footprint.RowPitch);
+		const auto slicePitch = rowPitch * m_RowCount;
+		const auto srcRowPitch = size_t(m_Size) * 4;
+
+		auto pDst = m_pUploadData + footprint.Offset;
+		for (auto z = 0u; z < m_Size; ++z)
+		{
+			for (auto y = 0u; y < m_RowCount; ++y)
+			{
+				memcpy(
+					pDst + slicePitch * z + rowPitch * y,
+					m_Texels.data() + srcRowPitch * (size_t(m_Size) * z + y),
+					size_t(m_RowSize));
+			}
+		}
+	}
+
+	auto pResource = m_Texture[back].GetComPtr().Get();
+
+	D3D12_TEXTURE_COPY_LOCATION dst = {};
+	dst.pResource = pResource;
+	dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	dst.SubresourceIndex = 0;
+
+	D3D12_TEXTURE_COPY_LOCATION src = {};
+	src.pResource = m_pUploadBuffer.Get();
+	src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	src.PlacedFootprint = footprint;
+
+	DirectX::TransitionResource(pCmd, pResource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+	pCmd->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+	DirectX::TransitionResource(pCmd, pResource, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+	m_Param[back] = m_BakedParam;
+	m_NeedsUpload = false;
+
+	if (m_HasFront)
+	{
+		m_PendingValue = fenceValue;
+	}
+	else
+	{
+		m_HasFront = true;
+	}
+}
+
+DirectX::XMFLOAT4 TonemapLUT::GetCoordParam() const
+{
+	auto domain = GetTonemapLUTDomain(m_Param[m_FrontIndex].ColorSpace);
+	auto scale = (m_Size > 0) ? float(m_Size - 1) / float(m_Size) : 1.0f;
+	return DirectX::XMFLOAT4(domain.GetOffset(), domain.Log2Min, domain.GetInvLog2Range(), scale);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE TonemapLUT::GetHandleGPU() const
+{
+	return m_Texture[m_FrontIndex].GetHandleGPU();
+}
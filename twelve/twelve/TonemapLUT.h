@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include <d3d12.h>
+#include <vector>
+#include "ComPtr.h"
+#include "Texture.h"
+#include "TonemapLUTBaker.h"
+
+/// <summary>
+/// 色域変換, トーンマップ, OETFをベイクした 3D LUT
+/// パラメータが変わったときだけCPUでベイクし直し, フレームのコマンドリストで裏のテクスチャにアップロードする
+/// 表のテクスチャは, アップロードを記録したフレームのフェンスが完了するまで使い続ける
+/// </summary>
+class TonemapLUT
+{
+public:
+	static constexpr uint32_t BufferCount = 2;	// テクスチャの数 (表と裏)
+
+	TonemapLUT();
+	~TonemapLUT();
+
+	/// <summary>
+	/// LUTのテクスチャとアップロード用のバッファを生成する
+	/// </summary>
+	/// <param name="pDevice">デバイス</param>
+	/// <param name="pPool">ディスクリプタプール</param>
+	/// <param name="size">1辺のサイズ</param>
+	/// <returns>生成に成功した場合はtrue</returns>
+	bool Init(ID3D12Device* pDevice, DescriptorPool* pPool, uint32_t size);
+
+	void Term();
+
+	/// <summary>
+	/// アップロードが完了した裏のテクスチャを表にし, パラメータが前回と異なる場合はLUTをベイクし直す
+	/// コマンドの記録前に呼ぶこと (アップロードは RecordUpload() で記録する)
+	/// </summary>
+	/// <param name="param">パラメータ</param>
+	/// <param name="completedValue">GPUが完了したフェンス値</param>
+	/// <returns>初期化済みの場合はtrue</returns>
+	bool Update(const TonemapParam& param, uint64_t completedValue);
+
+	/// <summary>
+	/// ベイクし直したLUTを裏のテクスチャにコピーするコマンドを記録する (アップロードするものがない場合は何もしない)
+	/// LUTを参照する描画より前に記録すること
+	/// </summary>
+	/// <param name="pCmd">フレームのコマンドリスト</param>
+	/// <param name="frameIndex">フレーム番号 (アップロード用バッファの領域を選ぶ)</param>
+	/// <param name="fenceValue">このフレームの完了時に通知するフェンス値</param>
+	void RecordUpload(ID3D12GraphicsCommandList* pCmd, uint32_t frameIndex, uint64_t fenceValue);
+
+	/// <summary>
+	/// シェーダで入力をLUTの座標に変換するための定数を取得する (表のテクスチャのパラメータ)
+	/// </summary>
+	/// <returns>(オフセット, log2の下限, log2の範囲の逆数, テクセル中心の補正のスケール)</returns>
+	DirectX::XMFLOAT4 GetCoordParam() const;
+
+	D3D12_GPU_DESCRIPTOR_HANDLE GetHandleGPU() const;
+
+private:
+	Texture								m_Texture[BufferCount];		// LUTのテクスチャ
+	TonemapParam						m_Param[BufferCount];		// テクスチャごとのベイクしたときのパラメータ
+	ComPtr<ID3D12Resource>				m_pUploadBuffer;			// アップロード用バッファ (フレームごとの領域を持つ)
+	uint8_t*							m_pUploadData;				// マップしたアドレス
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT	m_Footprint;				// 1フレーム分の領域のテクスチャの配置
+	uint64_t							m_UploadPitch;				// フレームごとの領域の間隔
+	uint32_t							m_RowCount;					// スライスごとの行数
+	uint64_t							m_RowSize;					// 1行のバイト数
+	std::vector<uint16_t>				m_Texels;					// ベイク結果
+	TonemapParam						m_BakedParam;				// 最後にベイクしたパラメータ
+	uint64_t							m_PendingValue;				// 裏のテクスチャのアップロードを記録したフレームのフェンス値 (0の場合は待ちなし)
+	uint32_t							m_Size;						// 1辺のサイズ
+	uint32_t							m_FrontIndex;				// 表のテクスチャの番号
+	bool								m_HasFront;					// 表のテクスチャにLUTがあるかどうか
+	bool								m_IsBaked;					// ベイク済みかどうか
+	bool								m_NeedsUpload;				// ベイク結果をアップロードしていないかどうか
+
+	TonemapLUT(const TonemapLUT&) = delete;
+	void operator=(const TonemapLUT&) = delete;
+};
@@ -0,0 +1,416 @@
+﻿#include "TonemapLUTBaker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <DirectXPackedVector.h>
+
+#include "ParallelFor.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// BT.709 ---> BT.2020 の変換行列 (TonemapPS.hlsl と同じ, 行優先)
+	const double BT709ToBT2020[3][3] = {
+		{ 0.627404, 0.329283, 0.043313 },
+		{ 0.069097, 0.919540, 0.011362 },
+		{ 0.016391, 0.088013, 0.895595 },
+	};
+
+	// PQ の定数
+	const double PQ_M1 = 2610.0 / 4096.0 / 4;
+	const double PQ_M2 = 2523.0 / 4096.0 * 128;
+	const double PQ_C1 = 3424.0 / 4096.0;
+	const double PQ_C2 = 2413.0 / 4096.0 * 32;
+	const double PQ_C3 = 2392.0 / 4096.0 * 32;
+
+	// GTトーンマップの制御パラメータ
+	const double GT_A = 1.0;
+	const double GT_M = 0.22;
+	const double GT_L = 0.4;
+	const double GT_C = 1.33;
+	const double GT_B = 0.0;
+
+	/// <summary>
+	/// パラメータから求まるトーンマップの定数
+	/// </summary>
+	struct TonemapConstants
+	{
+		double	ReinhardK;	// Reinhard の k
+		double	P;			// GT の最大値
+		double	L0;			// GT の線形区間の長さ
+		double	S0;			// GT の肩の開始位置
+		double	S1;			// GT の肩の開始値
+		double	CP;			// GT の肩の指数
+	};
+
+	/// <summary>
+	/// トーンマップの定数を求める
+	/// </summary>
+	TonemapConstants CalcTonemapConstants(const TonemapParam& param)
+	{
+		TonemapConstants result = {};
+
+		double base = param.BaseLuminance;
+		double lz = double(param.MaxLuminance) / base;
+		result.ReinhardK = base * lz / (base - lz);
+
+		result.P = double(param.MaxLuminance) / base;
+		result.L0 = ((result.P - GT_M) * GT_L) / GT_A;
+		result.S0 = GT_M + result.L0;
+		result.S1 = GT_M + GT_A * result.L0;
+
+		auto C2 = (GT_A * result.P) / (result.P - result.S1);
+		result.CP = -C2 / result.P;
+
+		return result;
+	}
+
+	/// <summary>
+	/// 1チャンネルのトーンマップ (倍精度)
+	/// </summary>
+	double TonemapChannel(int type, const TonemapConstants& k, double x)
+	{
+		switch (type)
+		{
+		case TONEMAP_REINHARD:
+			return x * k.ReinhardK / (x + k.ReinhardK);
+
+		case TONEMAP_GT:
+			{
+				auto t = std::clamp(x / GT_M, 0.0, 1.0);
+				auto w0 = 1.0 - t * t * (3.0 - 2.0 * t);
+				auto w2 = (x >= k.S0) ? 1.0 : 0.0;
+				auto w1 = 1.0 - w0 - w2;
+
+				auto T = GT_M * std::pow(x / GT_M, GT_C) + GT_B;
+				auto S = k.P - (k.P - k.S1) * std::exp(k.CP * (x - k.S0));
+				auto L = GT_M + GT_A * (x - GT_M);
+
+				return T * w0 + L * w1 + S * w2;
+			}
+
+		default:
+			return x;
+		}
+	}
+
+	/// <summary>
+	/// 1チャンネルのOETF (倍精度)
+	/// </summary>
+	double OETFChannel(int colorSpace, double x)
+	{
+		if (colorSpace == COLOR_SPACE_BT2100_PQ)
+		{
+			auto cp = std::pow(std::abs(x), PQ_M1);
+			return std::pow((PQ_C1 + PQ_C2 * cp) / (1.0 + PQ_C3 * cp), PQ_M2);
+		}
+
+		return (x <= 0.018) ? 4.5 * x : 1.099 * std::pow(std::abs(x), 0.45) - 0.099;
+	}
+
+	/// <summary>
+	/// SIMD版の評価で使う定数 (全てのレーンに同じ値を格納する)
+	/// </summary>
+	struct TonemapVectorConstants
+	{
+		XMVECTOR	Columns[3];		// 色域変換の行列の列
+		XMVECTOR	ReinhardK;
+		XMVECTOR	P;
+		XMVECTOR	S0;
+		XMVECTOR	S1;
+		XMVECTOR	CPLog2E;		// CP * log2(e) (exp を exp2 で計算するため)
+		int			Type;
+		int			ColorSpace;
+	};
+
+	/// <summary>
+	/// SIMD版の定数を求める
+	/// </summary>
+	TonemapVectorConstants CalcVectorConstants(const TonemapParam& param)
+	{
+		auto k = CalcTonemapConstants(param);
+
+		TonemapVectorConstants result;
+		for (auto i = 0; i < 3; ++i)
+		{
+			result.Columns[i] = XMVectorSet(
+				float(BT709ToBT2020[0][i]),
+				float(BT709ToBT2020[1][i]),
+				float(BT709ToBT2020[2][i]),
+				0.0f);
+		}
+
+		result.ReinhardK = XMVectorReplicate(float(k.ReinhardK));
+		result.P = XMVectorReplicate(float(k.P));
+		result.S0 = XMVectorReplicate(float(k.S0));
+		result.S1 = XMVectorReplicate(float(k.S1));
+		result.CPLog2E = XMVectorReplicate(float(k.CP * 1.4426950408889634));
+		result.Type = param.Type;
+		result.ColorSpace = param.ColorSpace;
+		return result;
+	}
+
+	/// <summary>
+	/// x^y を求める (x > 0)
+	/// </summary>
+	XMVECTOR PowPositive(FXMVECTOR x, FXMVECTOR y)
+	{
+		return XMVectorExp2(XMVectorMultiply(XMVectorLog2(x), y));
+	}
+
+	/// <summary>
+	/// 色域変換, トーンマップ, OETFをRGBまとめて評価する
+	/// </summary>
+	XMVECTOR EvaluateTonemapVector(const TonemapVectorConstants& k, FXMVECTOR color)
+	{
+		static const XMVECTOR Tiny = XMVectorReplicate(1e-20f);
+		static const XMVECTOR One = XMVectorSplatOne();
+
+		auto x = XMVectorMax(color, XMVectorZero());
+
+		// 色域変換
+		if (k.ColorSpace == COLOR_SPACE_BT2100_PQ)
+		{
+			auto r = XMVectorMultiply(k.Columns[0], XMVectorSplatX(x));
+			r = XMVectorMultiplyAdd(k.Columns[1], XMVectorSplatY(x), r);
+			x = XMVectorMultiplyAdd(k.Columns[2], XMVectorSplatZ(x), r);
+		}
+
+		// トーンマップ
+		if (k.Type == TONEMAP_REINHARD)
+		{
+			x = XMVectorDivide(XMVectorMultiply(x, k.ReinhardK), XMVectorAdd(x, k.ReinhardK));
+		}
+		else if (k.Type == TONEMAP_GT)
+		{
+			static const XMVECTOR M = XMVectorReplicate(float(GT_M));
+			static const XMVECTOR InvM = XMVectorReplicate(float(1.0 / GT_M));
+			static const XMVECTOR C = XMVectorReplicate(float(GT_C));
+			static const XMVECTOR Two = XMVectorReplicate(2.0f);
+			static const XMVECTOR Three = XMVectorReplicate(3.0f);
+
+			auto t = XMVectorSaturate(XMVectorMultiply(x, InvM));
+			auto w0 = XMVectorSubtract(One, XMVectorMultiply(XMVectorMultiply(t, t), XMVectorNegativeMultiplySubtract(Two, t, Three)));
+			auto w2 = XMVectorSelect(XMVectorZero(), One, XMVectorGreaterOrEqual(x, k.S0));
+			auto w1 = XMVectorSubtract(XMVectorSubtract(One, w0), w2);
+
+			auto T = XMVectorMultiply(M, PowPositive(XMVectorMax(XMVectorMultiply(x, InvM), Tiny), C));
+			auto S = XMVectorNegativeMultiplySubtract(
+				XMVectorSubtract(k.P, k.S1),
+				XMVectorExp2(XMVectorMultiply(k.CPLog2E, XMVectorSubtract(x, k.S0))),
+				k.P);
+			auto L = x;	// m + a * (x - m) で a = 1
+
+			x = XMVectorMultiply(T, w0);
+			x = XMVectorMultiplyAdd(L, w1, x);
+			x = XMVectorMultiplyAdd(S, w2, x);
+		}
+
+		// OETF
+		if (k.ColorSpace == COLOR_SPACE_BT2100_PQ)
+		{
+			static const XMVECTOR M1 = XMVectorReplicate(float(PQ_M1));
+			static const XMVECTOR M2 = XMVectorReplicate(float(PQ_M2));
+			static const XMVECTOR C1 = XMVectorReplicate(float(PQ_C1));
+			static const XMVECTOR C2 = XMVectorReplicate(float(PQ_C2));
+			static const XMVECTOR C3 = XMVectorReplicate(float(PQ_C3));
+
+			auto cp = PowPositive(XMVectorMax(XMVectorAbs(x), Tiny), M1);
+			auto n = XMVectorDivide(XMVectorMultiplyAdd(C2, cp, C1), XMVectorMultiplyAdd(C3, cp, One));
+			x = PowPositive(n, M2);
+		}
+		else
+		{
+			static const XMVECTOR Threshold = XMVectorReplicate(0.018f);
+			static const XMVECTOR Slope = XMVectorReplicate(4.5f);
+			static const XMVECTOR Scale = XMVectorReplicate(1.099f);
+			static const XMVECTOR Offset = XMVectorReplicate(0.099f);
+			static const XMVECTOR Gamma = XMVectorReplicate(0.45f);
+
+			auto linear = XMVectorMultiply(x, Slope);
+			auto curve = XMVectorSubtract(XMVectorMultiply(Scale, PowPositive(XMVectorMax(XMVectorAbs(x), Tiny), Gamma)), Offset);
+			x = XMVectorSelect(curve, linear, XMVectorLessOrEqual(x, Threshold));
+		}
+
+		return XMVectorSetW(x, 1.0f);
+	}
+
+	/// <summary>
+	/// 出力のコード値を [0, 1] にクランプする (UNORMのバックバッファに書き込まれる値)
+	/// </summary>
+	double SaturateCode(double value)
+	{
+		return std::clamp(value, 0.0, 1.0);
+	}
+}
+
+XMFLOAT3 EvaluateTonemapReference(const TonemapParam& param, const XMFLOAT3& color)
+{
+	auto k = CalcTonemapConstants(param);
+
+	double x[3] = {
+		std::max(double(color.x), 0.0),
+		std::max(double(color.y), 0.0),
+		std::max(double(color.z), 0.0),
+	};
+
+	// 色域変換
+	if (param.ColorSpace == COLOR_SPACE_BT2100_PQ)
+	{
+		double converted[3];
+		for (auto i = 0; i < 3; ++i)
+		{
+			converted[i] = BT709ToBT2020[i][0] * x[0] + BT709ToBT2020[i][1] * x[1] + BT709ToBT2020[i][2] * x[2];
+		}
+		std::copy(converted, converted + 3, x);
+	}
+
+	// トーンマップとOETF
+	for (auto i = 0; i < 3; ++i)
+	{
+		x[i] = OETFChannel(param.ColorSpace, TonemapChannel(param.Type, k, x[i]));
+	}
+
+	return XMFLOAT3(float(x[0]), float(x[1]), float(x[2]));
+}
+
+float CalcTonemapLUTCoord(const TonemapLUTDomain& domain, float value)
+{
+	auto u = (std::log2(std::max(value, 0.0f) + domain.GetOffset()) - domain.Log2Min) * domain.GetInvLog2Range();
+	return std::clamp(u, 0.0f, 1.0f);
+}
+
+void BakeTonemapLUT(const TonemapParam& param, uint32_t size, std::vector<uint16_t>& texels, uint32_t threadCount)
+{
+	size = std::max(size, 2u);
+	texels.resize(size_t(size) * size * size * 4);
+
+	auto k = CalcVectorConstants(param);
+	auto domain = GetTonemapLUTDomain(param.ColorSpace);
+
+	// 各軸の入力値 (テクセル i は座標 i / (size - 1) の位置)
+	std::vector<float> inputs(size);
+	for (auto i = 0u; i < size; ++i)
+	{
+		auto u = float(i) / float(size - 1);
+		inputs[i] = std::max(std::exp2(domain.Log2Min + u * (domain.Log2Max - domain.Log2Min)) - domain.GetOffset(), 0.0f);
+	}
+	inputs[0] = 0.0f;
+
+	ParallelFor(0, size, [&](uint32_t b)
+	{
+		std::vector<XMFLOAT4> row(size);
+
+		for (auto g = 0u; g < size; ++g)
+		{
+			for (auto r = 0u; r < size; ++r)
+			{
+				auto color = XMVectorSet(inputs[r], inputs[g], inputs[b], 1.0f);
+				XMStoreFloat4(&row[r], EvaluateTonemapVector(k, color));
+			}
+
+			auto offset = (size_t(b) * size + g) * size * 4;
+			PackedVector::XMConvertFloatToHalfStream(
+				&texels[offset],
+				sizeof(uint16_t),
+				reinterpret_cast<const float*>(row.data()),
+				sizeof(float),
+				size_t(size) * 4);
+		}
+	}, threadCount);
+}
+
+XMFLOAT3 SampleTonemapLUT(const TonemapParam& param, const std::vector<uint16_t>& texels, uint32_t size, const XMFLOAT3& color)
+{
+	const float input[3] = { color.x, color.y, color.z };
+	auto domain = GetTonemapLUTDomain(param.ColorSpace);
+
+	// テクセル中心の補正を含めた座標 u * (N - 1) / N + 0.5 / N をテクセル単位にすると u * (N - 1) になる
+	// ハードウェアの補間の重みは8bit精度なので, 重みを 1/256 単位に丸める
+	uint32_t i0[3];
+	uint32_t i1[3];
+	float w[3];
+	for (auto axis = 0; axis < 3; ++axis)
+	{
+		auto t = CalcTonemapLUTCoord(domain, input[axis]) * float(size - 1);
+		auto f = std::floor(t);
+		i0[axis] = std::min(uint32_t(f), size - 1);
+		i1[axis] = std::min(i0[axis] + 1, size - 1);
+		w[axis] = std::round((t - f) * 256.0f) / 256.0f;
+	}
+
+	auto fetch = [&](uint32_t r, uint32_t g, uint32_t b)
+	{
+		auto offset = ((size_t(b) * size + g) * size + r) * 4;
+		return XMVectorSet(
+			PackedVector::XMConvertHalfToFloat(texels[offset + 0]),
+			PackedVector::XMConvertHalfToFloat(texels[offset + 1]),
+			PackedVector::XMConvertHalfToFloat(texels[offset + 2]),
+			1.0f);
+	};
+
+	auto c00 = XMVectorLerp(fetch(i0[0], i0[1], i0[2]), fetch(i1[0], i0[1], i0[2]), w[0]);
+	auto c10 = XMVectorLerp(fetch(i0[0], i1[1], i0[2]), fetch(i1[0], i1[1], i0[2]), w[0]);
+	auto c01 = XMVectorLerp(fetch(i0[0], i0[1], i1[2]), fetch(i1[0], i0[1], i1[2]), w[0]);
+	auto c11 = XMVectorLerp(fetch(i0[0], i1[1], i1[2]), fetch(i1[0], i1[1], i1[2]), w[0]);
+
+	auto c0 = XMVectorLerp(c00, c10, w[1]);
+	auto c1 = XMVectorLerp(c01, c11, w[1]);
+
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, XMVectorLerp(c0, c1, w[2]));
+	return result;
+}
+
+TonemapLUTError ValidateTonemapLUT
+(
+	const TonemapParam& param,
+	const std::vector<uint16_t>& texels,
+	uint32_t size,
+	uint32_t sampleCount,
+	uint32_t seed
+)
+{
+	TonemapLUTError result;
+	if (sampleCount == 0 || texels.size() < size_t(size) * size * size * 4)
+	{
+		return result;
+	}
+
+	auto domain = GetTonemapLUTDomain(param.ColorSpace);
+
+	std::mt19937 engine(seed);
+	std::uniform_real_distribution<float> log2Dist(domain.Log2Min, domain.Log2Max);
+	std::uniform_int_distribution<uint32_t> zeroDist(0, 15);
+
+	double sum = 0.0;
+	for (auto i = 0u; i < sampleCount; ++i)
+	{
+		float input[3];
+		for (auto& value : input)
+		{
+			// 彩度の高い暗部も含めるため, 一部のチャンネルは0にする
+			value = (zeroDist(engine) == 0) ? 0.0f : std::exp2(log2Dist(engine));
+		}
+
+		XMFLOAT3 color(input[0], input[1], input[2]);
+		auto reference = EvaluateTonemapReference(param, color);
+		auto sampled = SampleTonemapLUT(param, texels, size, color);
+
+		const double ref[3] = { reference.x, reference.y, reference.z };
+		const double lut[3] = { sampled.x, sampled.y, sampled.z };
+		for (auto c = 0; c < 3; ++c)
+		{
+			auto diff = std::abs(SaturateCode(lut[c]) - SaturateCode(ref[c]));
+			result.MaxError = std::max(result.MaxError, diff);
+			sum += diff * diff;
+		}
+	}
+
+	result.RMSE = std::sqrt(sum / (double(sampleCount) * 3.0));
+	result.MaxErrorLSB8 = result.MaxError * 255.0;
+	result.MaxErrorLSB10 = result.MaxError * 1023.0;
+	return result;
+}
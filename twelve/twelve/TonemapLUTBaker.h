@@ -0,0 +1,146 @@
+﻿#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+/// <summary>
+/// 出力色空間
+/// </summary>
+enum COLOR_SPACE_TYPE
+{
+	COLOR_SPACE_BT709,      // ITU-R BT.709
+	COLOR_SPACE_BT2100_PQ,  // ITU-R BT.2100 PQ System
+};
+
+/// <summary>
+/// トーンマップの種類
+/// </summary>
+enum TONEMAP_TYPE
+{
+	TONEMAP_NONE = 0,   // トーンマップなし
+	TONEMAP_REINHARD,   // Reinhardトーンマップ
+	TONEMAP_GT,         // GTトーンマップ
+};
+
+/// <summary>
+/// LUTの入力の範囲
+/// 各軸の座標は (log2(x + 2^Log2Min) - Log2Min) / (Log2Max - Log2Min) で, 最初のテクセルがちょうど0になる
+/// 0付近の傾きが大きいPQは下限を小さくする
+/// </summary>
+struct TonemapLUTDomain
+{
+	float	Log2Min;	// 下限のオフセット (log2)
+	float	Log2Max;	// 上限 (log2). これより大きい入力は端の値にクランプされる
+
+	float GetOffset() const { return std::exp2(Log2Min); }
+	float GetInvLog2Range() const { return 1.0f / (Log2Max - Log2Min); }
+};
+
+/// <summary>
+/// 出力色空間に応じたLUTの入力の範囲を取得する
+/// </summary>
+inline TonemapLUTDomain GetTonemapLUTDomain(int colorSpace)
+{
+	return (colorSpace == COLOR_SPACE_BT2100_PQ)
+		? TonemapLUTDomain{ -24.0f, 8.0f }
+		: TonemapLUTDomain{ -12.0f, 8.0f };
+}
+
+/// <summary>
+/// LUTの1辺のサイズ (SDR向け / HDR向け)
+/// </summary>
+static const uint32_t TonemapLUTSizeSDR = 32;
+static const uint32_t TonemapLUTSizeHDR = 64;
+
+/// <summary>
+/// トーンマップのパラメータ (TonemapPS.hlsl の CbTonemap と同じ意味)
+/// </summary>
+struct TonemapParam
+{
+	int		Type = TONEMAP_GT;					// トーンマップの種類
+	int		ColorSpace = COLOR_SPACE_BT709;		// 出力色空間
+	float	BaseLuminance = 100.0f;				// 基準輝度値 [nit]
+	float	MaxLuminance = 100.0f;				// 最大輝度値 [nit]
+
+	bool operator == (const TonemapParam& value) const
+	{
+		return Type == value.Type
+			&& ColorSpace == value.ColorSpace
+			&& BaseLuminance == value.BaseLuminance
+			&& MaxLuminance == value.MaxLuminance;
+	}
+
+	bool operator != (const TonemapParam& value) const
+	{
+		return !(*this == value);
+	}
+};
+
+/// <summary>
+/// LUTの誤差
+/// </summary>
+struct TonemapLUTError
+{
+	double	MaxError = 0.0;		// 最大絶対誤差 (出力のコード値 [0, 1] 単位)
+	double	RMSE = 0.0;			// 二乗平均平方根誤差
+	double	MaxErrorLSB8 = 0.0;	// 最大絶対誤差 (8bitのコード値単位)
+	double	MaxErrorLSB10 = 0.0;// 最大絶対誤差 (10bitのコード値単位)
+};
+
+/// <summary>
+/// 色域変換, トーンマップ, OETFを解析的に評価する (LUTの検証用の基準実装, 倍精度)
+/// TonemapPS.hlsl の分岐で行っていた処理と同じ
+/// </summary>
+/// <param name="param">パラメータ</param>
+/// <param name="color">シーンの線形カラー (BT.709)</param>
+/// <returns>出力のコード値</returns>
+DirectX::XMFLOAT3 EvaluateTonemapReference(const TonemapParam& param, const DirectX::XMFLOAT3& color);
+
+/// <summary>
+/// 入力をLUTのテクスチャ座標 (テクセル中心の補正前, [0, 1]) に変換する
+/// </summary>
+/// <param name="domain">LUTの入力の範囲</param>
+/// <param name="value">シーンの線形カラーの1チャンネル</param>
+/// <returns>正規化した座標</returns>
+float CalcTonemapLUTCoord(const TonemapLUTDomain& domain, float value);
+
+/// <summary>
+/// 色域変換, トーンマップ, OETFの全体を 3D LUT (RGBA16F) にベイクする
+/// 各軸は GetTonemapLUTDomain() の範囲を等間隔に分割する
+/// 1テクセルのRGBをSIMDレジスタで同時に計算し, スライスごとに並列化する
+/// </summary>
+/// <param name="param">パラメータ</param>
+/// <param name="size">1辺のサイズ</param>
+/// <param name="texels">出力先 (size^3 * 4 個の半精度浮動小数, R が最も内側の軸)</param>
+/// <param name="threadCount">使用するスレッド数 (0の場合はハードウェアスレッド数)</param>
+void BakeTonemapLUT(const TonemapParam& param, uint32_t size, std::vector<uint16_t>& texels, uint32_t threadCount = 0);
+
+/// <summary>
+/// GPUと同じ座標計算とトライリニア補間でLUTをサンプリングする
+/// </summary>
+/// <param name="param">ベイクしたときのパラメータ</param>
+/// <param name="texels">LUT</param>
+/// <param name="size">1辺のサイズ</param>
+/// <param name="color">シーンの線形カラー (BT.709)</param>
+/// <returns>出力のコード値</returns>
+DirectX::XMFLOAT3 SampleTonemapLUT(const TonemapParam& param, const std::vector<uint16_t>& texels, uint32_t size, const DirectX::XMFLOAT3& color);
+
+/// <summary>
+/// LUTを基準実装と比較する
+/// 入力はLUTの範囲内で log2 空間に一様に分布する乱数を使い, 出力は [0, 1] にクランプして比較する
+/// </summary>
+/// <param name="param">パラメータ</param>
+/// <param name="texels">LUT</param>
+/// <param name="size">1辺のサイズ</param>
+/// <param name="sampleCount">比較するサンプル数</param>
+/// <param name="seed">乱数のシード</param>
+/// <returns>誤差</returns>
+TonemapLUTError ValidateTonemapLUT(
+	const TonemapParam& param,
+	const std::vector<uint16_t>& texels,
+	uint32_t size,
+	uint32_t sampleCount = 65536,
+	uint32_t seed = 1);
+
@@ -1,5 +1,40 @@
 ﻿#include "Game.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "Logger.h"
+
+namespace
+{
+	/// <summary>
+	/// コマンドライン引数からフレームバッファ数を取得する
+	/// "-frames N" を指定した場合はフレームペーサーが対応する範囲に丸め, 指定しない場合は既定値を返す
+	/// </summary>
+	uint32_t GetFrameCountOption(int argc, char** argv)
+	{
+		for (auto i = 1; i + 1 < argc; ++i)
+		{
+			if (strcmp(argv[i], "-frames") != 0)
+			{
+				continue;
+			}
+
+			auto value = strtol(argv[i + 1], nullptr, 10);
+			auto frameCount = uint32_t(std::clamp<long>(value, Constants::MinFrameCount, Constants::MaxFrameCount));
+			if (long(frameCount) != value)
+			{
+				ILOG("Info : -frames %s is out of range. Using %u (%u - %u).",
+					argv[i + 1], frameCount, Constants::MinFrameCount, Constants::MaxFrameCount);
+			}
+			return frameCount;
+		}
+
+		return Constants::DefaultFrameCount;
+	}
+}
+
 #ifndef _DEBUG
 int main()
 {
@@ -10,7 +45,8 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 #endif
 	Game game;
 
-	if (game.Initialize())
+	// __argc, __argv は main と WinMain のどちらで起動しても CRT が設定する
+	if (game.Initialize(GetFrameCountOption(__argc, __argv)))
 	{
 		game.RunLoop();
 	}